@@ -0,0 +1,133 @@
+#include <Logme/Backend/Backend.h>
+#include <Logme/Channel.h>
+#include <Logme/Logme.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#pragma warning(disable: 4840)
+#endif
+
+namespace
+{
+  std::atomic<std::uint64_t> Sink{0};
+
+  struct BenchBackend : public Logme::Backend
+  {
+    bool Concurrent;
+    int Work;
+
+    BenchBackend(Logme::ChannelPtr owner, bool concurrent, int work)
+      : Backend(owner, "BenchBackend")
+      , Concurrent(concurrent)
+      , Work(work)
+    {
+    }
+
+    bool IsConcurrentDisplaySupported() const override
+    {
+      return Concurrent;
+    }
+
+    void Display(Logme::Context& context) override
+    {
+      int nc = 0;
+      const char* text = context.Apply(Owner, Owner->GetFlags(), nc);
+
+      // Simulate sink cost without touching shared state
+      std::uint64_t hash = 1469598103934665603ULL;
+      for (int round = 0; round < Work; ++round)
+      {
+        for (int i = 0; i < nc; ++i)
+          hash = (hash ^ (unsigned char)text[i]) * 1099511628211ULL;
+      }
+
+      if (hash == 0)
+        Sink.fetch_add(1, std::memory_order_relaxed);
+    }
+  };
+
+  double Run(int threads, int backends, int records, int work, bool concurrent)
+  {
+    Logme::ID id{ "channel-contention" };
+    auto ch = Logme::Instance->CreateChannel(id);
+    ch->RemoveBackends();
+
+    Logme::OutputFlags flags;
+    flags.Value = 0;
+    ch->SetFlags(flags);
+    ch->SetFilterLevel(Logme::LEVEL_DEBUG);
+
+    for (int i = 0; i < backends; ++i)
+      ch->AddBackend(std::make_shared<BenchBackend>(ch, concurrent, work));
+
+    std::atomic<bool> start{false};
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+
+    for (int t = 0; t < threads; ++t)
+    {
+      workers.emplace_back([&, t]()
+      {
+        while (!start.load(std::memory_order_acquire))
+          std::this_thread::yield();
+
+        for (int i = 0; i < records; ++i)
+          LogmeI(ch, "thread=%d record=%d", t, i);
+      });
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+
+    for (auto& w : workers)
+      w.join();
+
+    auto t1 = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(t1 - t0).count();
+
+    ch->RemoveBackends();
+    Logme::Instance->DeleteChannel(id);
+
+    return seconds > 0 ? double(threads) * records / seconds : 0;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int maxThreads = argc > 1 ? atoi(argv[1]) : 8;
+  int maxBackends = argc > 2 ? atoi(argv[2]) : 4;
+  int records = argc > 3 ? atoi(argv[3]) : 100000;
+  int work = argc > 4 ? atoi(argv[4]) : 64;
+
+  printf("%-10s %8s %8s %16s\n", "mode", "threads", "backends", "records/s");
+
+  for (int mode = 0; mode < 2; ++mode)
+  {
+    bool concurrent = mode == 1;
+
+    for (int backends = 1; backends <= maxBackends; backends *= 2)
+    {
+      for (int threads = 1; threads <= maxThreads; threads *= 2)
+      {
+        double rate = Run(threads, backends, records, work, concurrent);
+        printf(
+          "%-10s %8d %8d %16.0f\n"
+          , concurrent ? "concurrent" : "serialized"
+          , threads
+          , backends
+          , rate
+        );
+      }
+    }
+  }
+
+  return 0;
+}
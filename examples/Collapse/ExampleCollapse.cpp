@@ -76,6 +76,24 @@ static void IgnoreChangingRequestEvery()
   std::this_thread::sleep_for(std::chrono::milliseconds(120));
 
   LogRequestFailureEvery(4);
+  LogmeI("\n");
+}
+
+static void VolatileAndKeys()
+{
+  LogmeI("built-in normalizer with two keys follows: handles change, two messages alternate");
+
+  for (int i = 0; i < 6; i++)
+  {
+    LogmeW_CollapseKeys(
+      2
+      , Logme::CollapseNormalizer::VOLATILE
+      , 2
+      , "%s: handle=0x%04x"
+      , (i & 1) ? "write failed" : "read failed"
+      , 0x100 + i
+    );
+  }
 }
 
 int main()
@@ -86,6 +104,7 @@ int main()
   IgnoreCorrelationId();
   SameTextEvery();
   IgnoreChangingRequestEvery();
+  VolatileAndKeys();
 
   return 0;
 }
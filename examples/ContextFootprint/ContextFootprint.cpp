@@ -0,0 +1,204 @@
+#include <Logme/Backend/Backend.h>
+#include <Logme/Channel.h>
+#include <Logme/Logme.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+#pragma warning(disable: 4840)
+#endif
+
+namespace
+{
+  std::atomic<std::uint64_t> Sink{0};
+
+  // Reads only the message text, so the cold part of the context is never
+  // needed, or renders the full line with Context::Apply.
+  struct BenchBackend : public Logme::Backend
+  {
+    bool Render;
+
+    BenchBackend(Logme::ChannelPtr owner, bool render)
+      : Backend(owner, "BenchBackend")
+      , Render(render)
+    {
+    }
+
+    void Display(Logme::Context& context) override
+    {
+      int nc = 0;
+      const char* text = Render
+        ? context.Apply(Owner, Owner->GetFlags(), nc)
+        : context.GetText();
+
+      if (text && *text == '\0')
+        Sink.fetch_add(1, std::memory_order_relaxed);
+    }
+  };
+
+  // L1 data cache read misses of the calling thread, when the kernel allows it
+  class MissCounter
+  {
+  public:
+    MissCounter()
+      : Fd(-1)
+    {
+#if defined(__linux__)
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_L1D
+        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+
+      Fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~MissCounter()
+    {
+#if defined(__linux__)
+      if (Fd >= 0)
+        close(Fd);
+#endif
+    }
+
+    bool Available() const
+    {
+      return Fd >= 0;
+    }
+
+    void Start()
+    {
+#if defined(__linux__)
+      if (Fd >= 0)
+      {
+        ioctl(Fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(Fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+#endif
+    }
+
+    std::uint64_t Stop()
+    {
+      std::uint64_t value = 0;
+#if defined(__linux__)
+      if (Fd >= 0)
+      {
+        ioctl(Fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(Fd, &value, sizeof(value)) != sizeof(value))
+          value = 0;
+      }
+#endif
+      return value;
+    }
+
+  private:
+    int Fd;
+  };
+
+  enum class Case
+  {
+    CONTEXT,
+    REJECTED,
+    TEXT,
+    RENDERED
+  };
+
+  const char* CaseName(Case c)
+  {
+    switch (c)
+    {
+    case Case::CONTEXT: return "context";
+    case Case::REJECTED: return "rejected";
+    case Case::TEXT: return "text";
+    default: return "rendered";
+    }
+  }
+
+  void Run(Case c, int records, MissCounter& misses)
+  {
+    Logme::ID id{ "context-footprint" };
+    auto ch = Logme::Instance->CreateChannel(id);
+    ch->RemoveBackends();
+
+    Logme::OutputFlags flags;
+    flags.Value = 0;
+    flags.Timestamp = Logme::TIME_FORMAT_LOCAL;
+    flags.ThreadID = true;
+    flags.Method = true;
+    ch->SetFlags(flags);
+
+    // Records of the "rejected" case pass the macro precheck and are dropped
+    // by the channel level after the context is built
+    ch->SetFilterLevel(c == Case::REJECTED ? Logme::LEVEL_ERROR : Logme::LEVEL_DEBUG);
+    ch->AddBackend(std::make_shared<BenchBackend>(ch, c == Case::RENDERED));
+
+    static Logme::ContextCache cache;
+
+    misses.Start();
+    auto t0 = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < records; ++i)
+    {
+      if (c == Case::CONTEXT)
+      {
+        Logme::Context context = LOGME_CONTEXT(cache, Logme::LEVEL_INFO, &id, &SUBSID);
+        Sink.fetch_add(context.Line == 0, std::memory_order_relaxed);
+      }
+      else
+      {
+        LogmeI_If(true, ch, "record=%d value=%s", i, "footprint");
+      }
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    std::uint64_t missCount = misses.Stop();
+
+    double seconds = std::chrono::duration<double>(t1 - t0).count();
+    double ns = records > 0 ? seconds * 1e9 / records : 0;
+
+    if (misses.Available() && records > 0)
+      printf("%-10s %12.1f %14.2f\n", CaseName(c), ns, double(missCount) / records);
+    else
+      printf("%-10s %12.1f %14s\n", CaseName(c), ns, "n/a");
+
+    ch->RemoveBackends();
+    Logme::Instance->DeleteChannel(id);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int records = argc > 1 ? atoi(argv[1]) : 1000000;
+
+  printf("sizeof(Context)       %zu\n", sizeof(Logme::Context));
+  printf("sizeof(Context::Cold) %zu\n\n", sizeof(Logme::Context::Cold));
+
+  MissCounter misses;
+  printf("%-10s %12s %14s\n", "case", "ns/record", "L1D miss/rec");
+
+  Run(Case::CONTEXT, records, misses);
+  Run(Case::REJECTED, records, misses);
+  Run(Case::TEXT, records, misses);
+  Run(Case::RENDERED, records, misses);
+
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include <Logme/Context.h>
+#include <Logme/FastFormat.h>
+#include <Logme/Logme.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#pragma warning(disable: 4840)
+#endif
+
+namespace
+{
+  std::atomic<std::uint64_t> Sink{0};
+
+  Logme::ID CH{ "fast-format" };
+
+  // One call site: the format program is built on the first call and
+  // reused from the context cache after that
+  size_t FormatFast(Logme::ContextCache& cache, char* buffer, size_t size, const char* format, ...)
+  {
+    Logme::Context context(cache, Logme::LEVEL_INFO, &CH, nullptr);
+    size_t len = 0;
+
+    va_list args;
+    va_start(args, format);
+    if (!Logme::TryFastFormat(context, buffer, size, format, args, &len))
+    {
+      // Not reached for the formats below
+      va_end(args);
+      va_start(args, format);
+      len = (size_t)vsnprintf(buffer, size, format, args);
+    }
+    va_end(args);
+
+    return len;
+  }
+
+  size_t FormatPrintf(Logme::ContextCache&, char* buffer, size_t size, const char* format, ...)
+  {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, size, format, args);
+    va_end(args);
+
+    return n > 0 ? (size_t)n : 0;
+  }
+
+  typedef size_t (*PfnFormat)(Logme::ContextCache&, char*, size_t, const char*, ...);
+
+  struct Case
+  {
+    const char* Name;
+    const char* Format;
+  };
+
+  const Case Cases[] =
+  {
+    { "int", "fd=%d" },
+    { "uint64", "offset=%llu" },
+    { "size", "%zu bytes" },
+    { "hex", "flags=%08x" },
+    { "string", "[%-10s]" },
+    { "fixed", "elapsed=%.3f ms" },
+    { "mixed", "id=%d name=%s size=%zu ratio=%.2f mask=%#x" },
+  };
+
+  double Run(PfnFormat proc, const Case& c, int index, int records)
+  {
+    Logme::ContextCache cache;
+    char buffer[256];
+    size_t total = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < records; ++i)
+    {
+      switch (index)
+      {
+      case 0: total += proc(cache, buffer, sizeof(buffer), c.Format, i); break;
+      case 1: total += proc(cache, buffer, sizeof(buffer), c.Format, 1234567890123ULL + i); break;
+      case 2: total += proc(cache, buffer, sizeof(buffer), c.Format, size_t(i) * 4096); break;
+      case 3: total += proc(cache, buffer, sizeof(buffer), c.Format, unsigned(i) * 2654435761u); break;
+      case 4: total += proc(cache, buffer, sizeof(buffer), c.Format, "worker"); break;
+      case 5: total += proc(cache, buffer, sizeof(buffer), c.Format, i * 0.001234); break;
+      default:
+        total += proc(
+          cache
+          , buffer
+          , sizeof(buffer)
+          , c.Format
+          , i
+          , "worker"
+          , size_t(i) * 16
+          , i / 7.0
+          , unsigned(i)
+        );
+        break;
+      }
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    Sink.fetch_add(total, std::memory_order_relaxed);
+
+    double seconds = std::chrono::duration<double>(t1 - t0).count();
+    return records > 0 ? seconds * 1e9 / records : 0;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int records = argc > 1 ? atoi(argv[1]) : 1000000;
+
+  printf("%-8s %14s %14s %8s\n", "case", "vsnprintf ns", "fast ns", "speedup");
+
+  int index = 0;
+  for (const auto& c : Cases)
+  {
+    double slow = Run(FormatPrintf, c, index, records);
+    double fast = Run(FormatFast, c, index, records);
+
+    printf(
+      "%-8s %14.1f %14.1f %7.2fx\n"
+      , c.Name
+      , slow
+      , fast
+      , fast > 0 ? slow / fast : 0
+    );
+
+    index++;
+  }
+
+  return 0;
+}
@@ -2,14 +2,19 @@
 #include <winsock2.h>
 #endif
 
+#include <Logme/Backend/CallbackBackend.h>
 #include <Logme/Backend/FileBackend.h>
 #include <Logme/Channel.h>
 #include <Logme/Logger.h>
 #include <Logme/Logme.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -108,6 +113,78 @@ namespace
     }
   }
 
+  void DiscardRecord(
+    Logme::Context&
+    , const Logme::ChannelPtr&
+    , void*
+  )
+  {
+  }
+
+  // Seconds needed by each of threads to write records from one call site
+  double MeasureHotSite(
+    const Logme::ChannelPtr& channel
+    , int threads
+    , int records
+  )
+  {
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+      workers.emplace_back([&channel, records, t]()
+      {
+        for (int i = 0; i < records; ++i)
+          LogmeI(channel, "hot site: thread=%d record=%d", t, i);
+      });
+    }
+
+    for (auto& worker : workers)
+      worker.join();
+
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count();
+  }
+
+  // Cost added by statistics collection to every record of a hot call site.
+  // The channel discards records, so the difference between the two runs is
+  // the collection overhead. It should stay flat as threads are added.
+  int RunBenchmark(int maxThreads, int records)
+  {
+    auto channel = CreateChannel("profiling.benchmark");
+    channel->AddBackend(std::make_shared<Logme::CallbackBackend>(channel, DiscardRecord));
+
+    int cores = (std::max)(1, (int)std::thread::hardware_concurrency());
+    printf("%8s %14s %14s %14s\n", "threads", "off rec/s", "on rec/s", "overhead ns");
+
+    // Warm up allocators and the call site caches
+    MeasureHotSite(channel, 1, records);
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+      double off = MeasureHotSite(channel, threads, records);
+
+      Logme::Instance->StartLogStatistics();
+      double on = MeasureHotSite(channel, threads, records);
+      Logme::Instance->StopLogStatistics();
+
+      // CPU time per record: threads beyond the number of cores only share them
+      double total = double(threads) * records;
+      double busy = (std::min)(threads, cores);
+      printf(
+        "%8d %14.0f %14.0f %14.1f\n"
+        , threads
+        , off > 0 ? total / off : 0
+        , on > 0 ? total / on : 0
+        , (on - off) * 1e9 * busy / total
+      );
+    }
+
+    channel->RemoveBackends();
+    return 0;
+  }
+
   void PrintInstructions()
   {
     std::cout
@@ -129,8 +206,15 @@ namespace
   }
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+  if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0)
+  {
+    int maxThreads = argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+    int records = argc > 3 ? atoi(argv[3]) : 200000;
+    return RunBenchmark(maxThreads < 1 ? 1 : maxThreads, records);
+  }
+
 #ifdef _WIN32
   WSADATA wsa = {0};
   const int rc = WSAStartup(MAKEWORD(2, 2), &wsa);
@@ -0,0 +1,183 @@
+#include <Logme/Backend/FileBackend.h>
+#include <Logme/Channel.h>
+#include <Logme/Logme.h>
+#include <Logme/Obfuscate.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#pragma warning(disable: 4840)
+#endif
+
+namespace
+{
+  enum Mode
+  {
+    MODE_PLAIN,
+    MODE_PER_RECORD,
+    MODE_BATCH,
+  };
+
+  const char* ModeName(Mode mode)
+  {
+    switch (mode)
+    {
+    case MODE_PLAIN: return "plain";
+    case MODE_PER_RECORD: return "per-record";
+    case MODE_BATCH: return "batch";
+    }
+    return "";
+  }
+
+  const char* KernelName(ObfKernel kernel)
+  {
+    switch (kernel)
+    {
+    case LOGOBF_KERNEL_SCALAR: return "scalar";
+    case LOGOBF_KERNEL_SSE2: return "sse2";
+    case LOGOBF_KERNEL_AVX2: return "avx2";
+    default: return "auto";
+    }
+  }
+
+  ObfKey MakeKey()
+  {
+    ObfKey key;
+    for (int i = 0; i < LOGOBF_KEY_BYTES; ++i)
+      key.Bytes[i] = (uint8_t)(i * 7 + 1);
+    return key;
+  }
+
+  double KernelThroughput(const ObfKey& key, size_t recordSize, size_t totalBytes)
+  {
+    NonceGen gen;
+    NonceGenInit(&gen);
+
+    std::vector<uint8_t> text(recordSize, 'x');
+    std::vector<uint8_t> record(ObfCalcRecordSize(recordSize));
+
+    size_t iterations = totalBytes / recordSize;
+    auto t0 = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < iterations; ++i)
+    {
+      size_t size = 0;
+      ObfEncryptRecord(&key, &gen, text.data(), text.size(), record.data(), record.size(), &size);
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(t1 - t0).count();
+    return seconds > 0 ? double(iterations * recordSize) / seconds / (1024 * 1024) : 0;
+  }
+
+  double Run(
+    const std::string& file
+    , Mode mode
+    , int threads
+    , int records
+    , uintmax_t& fileSize
+  )
+  {
+    std::error_code ec;
+    std::filesystem::remove(file, ec);
+
+    Logme::ID id{ "obfuscation-throughput" };
+    auto ch = Logme::Instance->CreateChannel(id);
+    ch->RemoveBackends();
+
+    Logme::OutputFlags flags;
+    flags.Value = 0;
+    flags.Eol = true;
+    flags.Timestamp = Logme::TIME_FORMAT_LOCAL;
+    flags.ThreadID = true;
+    ch->SetFlags(flags);
+    ch->SetFilterLevel(Logme::LEVEL_DEBUG);
+
+    auto backend = std::make_shared<Logme::FileBackend>(ch);
+    auto config = std::make_shared<Logme::FileBackendConfig>();
+    config->Filename = file;
+    config->MaxSize = 0;
+    config->Append = false;
+    config->BatchObfuscation = mode == MODE_BATCH;
+    backend->ApplyConfig(config);
+    ch->AddBackend(backend);
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+      workers.emplace_back([&ch, records, t]()
+      {
+        for (int i = 0; i < records; ++i)
+          LogmeI(ch, "thread=%d record=%d some payload to make the line look like a real one", t, i);
+      });
+    }
+
+    for (auto& w : workers)
+      w.join();
+
+    backend->Flush();
+    auto t1 = std::chrono::steady_clock::now();
+
+    ch->RemoveBackends();
+    backend.reset();
+    Logme::Instance->DeleteChannel(id);
+
+    fileSize = std::filesystem::file_size(file, ec);
+    std::filesystem::remove(file, ec);
+
+    double seconds = std::chrono::duration<double>(t1 - t0).count();
+    return seconds > 0 ? double(threads) * records / seconds : 0;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int threads = argc > 1 ? atoi(argv[1]) : 4;
+  int records = argc > 2 ? atoi(argv[2]) : 200000;
+
+  std::string file = (std::filesystem::temp_directory_path() / "logme-obfuscation-throughput.log").string();
+  ObfKey key = MakeKey();
+
+  printf("ChaCha20 kernels, MB/s\n");
+  printf("%-8s %12s %12s\n", "kernel", "128 B", "64 KB");
+
+  const ObfKernel kernels[] = { LOGOBF_KERNEL_SCALAR, LOGOBF_KERNEL_SSE2, LOGOBF_KERNEL_AVX2 };
+  for (ObfKernel kernel : kernels)
+  {
+    if (!ObfSetKernel(kernel))
+      continue;
+
+    printf(
+      "%-8s %12.0f %12.0f\n"
+      , KernelName(kernel)
+      , KernelThroughput(key, 128, 256 * 1024 * 1024)
+      , KernelThroughput(key, LOGOBF_MAX_PLAINTEXT, 256 * 1024 * 1024)
+    );
+  }
+
+  ObfSetKernel(LOGOBF_KERNEL_AUTO);
+
+  printf("\nFileBackend, %d threads x %d records, kernel %s\n", threads, records, KernelName(ObfGetKernel()));
+  printf("%-12s %14s %14s\n", "mode", "records/s", "file bytes");
+
+  const Mode modes[] = { MODE_PLAIN, MODE_PER_RECORD, MODE_BATCH };
+  for (Mode mode : modes)
+  {
+    Logme::Instance->SetObfuscationKey(mode == MODE_PLAIN ? nullptr : &key);
+
+    uintmax_t size = 0;
+    double rate = Run(file, mode, threads, records, size);
+    printf("%-12s %14.0f %14ju\n", ModeName(mode), rate, size);
+  }
+
+  Logme::Instance->SetObfuscationKey(nullptr);
+  return 0;
+}
@@ -0,0 +1,186 @@
+#include <Logme/Backend/SharedFileBackend.h>
+#include <Logme/Channel.h>
+#include <Logme/Logme.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+#if defined(_MSC_VER)
+#pragma warning(disable: 4840)
+#endif
+
+namespace
+{
+  typedef std::vector<std::string> Args;
+
+#ifdef _WIN32
+  typedef intptr_t ProcessHandle;
+#else
+  typedef pid_t ProcessHandle;
+#endif
+
+  bool Spawn(const char* exe, const Args& args, ProcessHandle& handle)
+  {
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(exe));
+    for (auto& a : args)
+      argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+
+#ifdef _WIN32
+    handle = _spawnv(_P_NOWAIT, exe, argv.data());
+    return handle != -1;
+#else
+    return posix_spawn(&handle, exe, nullptr, nullptr, argv.data(), environ) == 0;
+#endif
+  }
+
+  void Wait(ProcessHandle handle)
+  {
+#ifdef _WIN32
+    int status = 0;
+    _cwait(&status, handle, 0);
+#else
+    int status = 0;
+    waitpid(handle, &status, 0);
+#endif
+  }
+
+  int RunChild(const char* file, bool persistent, int records, int interval)
+  {
+    Logme::ID id{ "shared-file-contention" };
+    auto ch = Logme::Instance->CreateChannel(id);
+
+    Logme::OutputFlags flags;
+    flags.Value = 0;
+    flags.Eol = true;
+    flags.ProcessID = true;
+    ch->SetFlags(flags);
+    ch->SetFilterLevel(Logme::LEVEL_DEBUG);
+
+    auto backend = std::make_shared<Logme::SharedFileBackend>(ch);
+
+    auto config = std::make_shared<Logme::SharedFileBackendConfig>();
+    config->Filename = file;
+    config->MaxSize = 0;
+    config->Timeout = 10000;
+    backend->ApplyConfig(config);
+
+    if (persistent)
+      backend->SetPersistent(true, size_t(interval));
+
+    ch->AddBackend(backend);
+
+    for (int i = 0; i < records; ++i)
+      LogmeI(ch, "record=%d some payload to make the line look like a real one", i);
+
+    backend->Flush();
+    ch->RemoveBackends();
+    return 0;
+  }
+
+  size_t CountLines(const std::string& file)
+  {
+    std::ifstream input(file, std::ios::binary);
+    size_t n = 0;
+    std::string line;
+    while (std::getline(input, line))
+      n++;
+    return n;
+  }
+
+  double Run(
+    const char* exe
+    , const std::string& file
+    , bool persistent
+    , int processes
+    , int records
+    , int interval
+    , size_t& lines
+  )
+  {
+    std::error_code ec;
+    std::filesystem::remove(file, ec);
+
+    Args args{
+      "--child"
+      , file
+      , persistent ? "persistent" : "per-record"
+      , std::to_string(records)
+      , std::to_string(interval)
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<ProcessHandle> children;
+    for (int i = 0; i < processes; ++i)
+    {
+      ProcessHandle h;
+      if (Spawn(exe, args, h))
+        children.push_back(h);
+      else
+        fprintf(stderr, "failed to start child process\n");
+    }
+
+    for (auto h : children)
+      Wait(h);
+
+    auto t1 = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(t1 - t0).count();
+
+    lines = CountLines(file);
+    std::filesystem::remove(file, ec);
+
+    return seconds > 0 ? double(children.size()) * records / seconds : 0;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc == 6 && strcmp(argv[1], "--child") == 0)
+    return RunChild(argv[2], strcmp(argv[3], "persistent") == 0, atoi(argv[4]), atoi(argv[5]));
+
+  int maxProcesses = argc > 1 ? atoi(argv[1]) : 8;
+  int records = argc > 2 ? atoi(argv[2]) : 20000;
+  int interval = argc > 3 ? atoi(argv[3]) : 100;
+
+  std::string file = (std::filesystem::temp_directory_path() / "logme-shared-file-contention.log").string();
+
+  printf("%-10s %9s %16s %10s\n", "mode", "processes", "records/s", "lines");
+
+  for (int mode = 0; mode < 2; ++mode)
+  {
+    bool persistent = mode == 1;
+
+    for (int processes = 1; processes <= maxProcesses; processes *= 2)
+    {
+      size_t lines = 0;
+      double rate = Run(argv[0], file, persistent, processes, records, interval, lines);
+      printf(
+        "%-10s %9d %16.0f %10zu\n"
+        , persistent ? "persistent" : "per-record"
+        , processes
+        , rate
+        , lines
+      );
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,123 @@
+#include <Logme/Backend/FileBackend.h>
+#include <Logme/Channel.h>
+#include <Logme/Logme.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#pragma warning(disable: 4840)
+#endif
+
+namespace
+{
+  size_t CountLines(const std::string& file)
+  {
+    std::ifstream input(file, std::ios::binary);
+    size_t n = 0;
+    std::string line;
+    while (std::getline(input, line))
+      n++;
+    return n;
+  }
+
+  double Run(
+    const std::string& file
+    , bool staging
+    , int threads
+    , int records
+    , size_t& lines
+  )
+  {
+    std::error_code ec;
+    std::filesystem::remove(file, ec);
+
+    Logme::ID id{ "thread-staging-scaling" };
+    auto ch = Logme::Instance->CreateChannel(id);
+    ch->RemoveBackends();
+
+    Logme::OutputFlags flags;
+    flags.Value = 0;
+    flags.Eol = true;
+    flags.Timestamp = Logme::TIME_FORMAT_LOCAL;
+    flags.ThreadID = true;
+    ch->SetFlags(flags);
+    ch->SetFilterLevel(Logme::LEVEL_DEBUG);
+
+    auto backend = std::make_shared<Logme::FileBackend>(ch);
+    auto config = std::make_shared<Logme::FileBackendConfig>();
+    config->Filename = file;
+    config->MaxSize = 0;
+    config->Append = false;
+    config->ThreadStaging = staging;
+    backend->ApplyConfig(config);
+    ch->AddBackend(backend);
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+      workers.emplace_back([&ch, records, t]()
+      {
+        for (int i = 0; i < records; ++i)
+          LogmeI(ch, "thread=%d record=%d some payload to make the line look like a real one", t, i);
+      });
+    }
+
+    for (auto& w : workers)
+      w.join();
+
+    backend->Flush();
+    auto t1 = std::chrono::steady_clock::now();
+
+    ch->RemoveBackends();
+    backend.reset();
+    Logme::Instance->DeleteChannel(id);
+
+    lines = CountLines(file);
+    std::filesystem::remove(file, ec);
+
+    double seconds = std::chrono::duration<double>(t1 - t0).count();
+    return seconds > 0 ? double(threads) * records / seconds : 0;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int maxThreads = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+  int records = argc > 2 ? atoi(argv[2]) : 200000;
+
+  if (maxThreads < 1)
+    maxThreads = 1;
+
+  std::string file = (std::filesystem::temp_directory_path() / "logme-thread-staging-scaling.log").string();
+
+  printf("%-8s %8s %14s %12s\n", "mode", "threads", "records/s", "lines");
+
+  for (int mode = 0; mode < 2; ++mode)
+  {
+    bool staging = mode == 1;
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+      size_t lines = 0;
+      double rate = Run(file, staging, threads, records, lines);
+      printf(
+        "%-8s %8d %14.0f %12zu\n"
+        , staging ? "staging" : "locked"
+        , threads
+        , rate
+        , lines
+      );
+    }
+  }
+
+  return 0;
+}
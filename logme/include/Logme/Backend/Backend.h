@@ -86,6 +86,18 @@ namespace Logme
     LOGMELNK virtual bool IsAsyncSupported() const;
     LOGMELNK virtual bool IsAsyncActive() const;
 
+    /// <summary>
+    /// Checks whether backend may receive records from several threads at once.
+    /// </summary>
+    /// <returns>true if Display synchronizes internally and can be called without channel data lock.</returns>
+    LOGMELNK virtual bool IsConcurrentDisplaySupported() const;
+
+    /// <summary>
+    /// Checks whether backend accepts records with captured printf arguments instead of text.
+    /// </summary>
+    /// <returns>true if Display handles Context::DeferredFormat and formats the message itself.</returns>
+    LOGMELNK virtual bool IsDeferredFormatSupported() const;
+
     LOGMELNK const char* GetType() const;
     LOGMELNK uint64_t GetStatisticsId() const;
 
@@ -42,6 +42,7 @@ namespace Logme
 
     LOGMELNK void Clear();
     LOGMELNK void Display(Logme::Context& context) override;
+    LOGMELNK bool IsConcurrentDisplaySupported() const override;
     LOGMELNK void Append(BufferBackend& bb);
     LOGMELNK void Append(const char* str, int nc);
 
@@ -75,6 +75,7 @@ namespace Logme
     LOGMELNK void SetAsync(bool async) override;
     LOGMELNK bool GetAsync() const override;
     LOGMELNK bool IsAsyncSupported() const override;
+    LOGMELNK bool IsConcurrentDisplaySupported() const override;
     LOGMELNK static void SetQueueLimits(size_t maxRecords, size_t maxBytes);
     LOGMELNK static void SetOverflowPolicy(ConsoleOverflowPolicy policy);
 
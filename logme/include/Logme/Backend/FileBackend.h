@@ -6,14 +6,19 @@
 #include <memory>
 #include <mutex>
 #include <regex>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include <Logme/Backend/MemoryTrackedBackend.h>
 #include <Logme/Buffer/BufferQueue.h>
+#include <Logme/Buffer/StagingQueue.h>
 #include <Logme/File/CompressionManager.h>
+#include <Logme/File/LogFileIndex.h>
 #include <Logme/File/buffered_file_io.h>
 #include <Logme/File/file_io.h>
 #include <Logme/Obfuscate.h>
+#include <Logme/OutputFlags.h>
 #include <Logme/Types.h>
 
 #ifndef FILE_ENABLE_FLUSH_SOURCE_COUNTERS
@@ -40,6 +45,17 @@ namespace Logme
     TIME_ROTATION_MONTHLY,
   };
 
+  // What an asynchronous FileBackend does with a record when its queue has
+  // no free buffer left
+  enum class FileOverflowPolicy
+  {
+    DROP_NEW,
+    BLOCK,
+    DROP_BY_LEVEL,
+    SPILL,
+    DROP_OLDEST,
+  };
+
   struct FileBackendConfig : public BackendConfig
   {
     bool Append;
@@ -55,6 +71,16 @@ namespace Logme
     uint64_t RetentionMaxTotalSize;
     bool RetentionCleanOnStart;
     bool GzipCompression;
+    bool ZstdCompression;
+    int CompressionLevel;
+    size_t CompressionThreads;
+    bool DeferredFormat;
+    bool BatchObfuscation;
+    bool ThreadStaging;
+    FileOverflowPolicy OverflowPolicy;
+    uint64_t OverflowTimeout;
+    Level OverflowKeepLevel;
+    std::string OverflowFilename;
 
     LOGMELNK FileBackendConfig();
     LOGMELNK ~FileBackendConfig();
@@ -137,6 +163,15 @@ namespace Logme
     std::uint64_t CompressionSubmitCalls = 0;
     std::uint64_t RetentionRuns = 0;
     std::uint64_t ShutdownCalls = 0;
+
+    // Queue overflow handling; collected regardless of FILE_ENABLE_COUNTERS
+    std::uint64_t OverflowDroppedRecords[LEVEL_CRITICAL + 1] = {};
+    std::uint64_t OverflowDroppedBytes = 0;
+    std::uint64_t OverflowBlockedRecords = 0;
+    std::uint64_t OverflowSpilledRecords = 0;
+    std::uint64_t OverflowSpilledBytes = 0;
+    std::uint64_t OverflowDroppedOldestBuffers = 0;
+    std::uint64_t OverflowDroppedOldestBytes = 0;
     BufferCounters Queue;
   };
 
@@ -170,6 +205,7 @@ namespace Logme
     std::string Name;
     std::string NameTemplate;
     std::unique_ptr<FileArchivePolicy> ArchivePolicy;
+    LogFileIndexPtr FileIndex;
 
     std::atomic<bool> Registered;
     std::atomic<bool> ShutdownFlag;
@@ -193,7 +229,8 @@ namespace Logme
     uint64_t RetentionMaxAge;
     uint64_t RetentionMaxTotalSize;
     bool RetentionCleanOnStart;
-    bool GzipCompression;
+    bool ArchiveCompression;
+    CompressionCodec ArchiveCodec;
     CompressionRegistrationPtr Compression;
 
     static size_t MaxSizeDefault;
@@ -210,6 +247,45 @@ namespace Logme
     std::vector<DataBufferPtr> ReadyData;
     std::atomic<BackendRuntimeStatistics*> RuntimeStatistics;
     std::atomic<uint64_t> RuntimeStatisticsGeneration;
+
+    // Deferred mode: queued data is a sequence of framed records which the
+    // worker formats (and obfuscates) into DeferredOutput before writing.
+    std::atomic<bool> DeferredFormat;
+    std::string DeferredOutput;
+    std::string DeferredText;
+
+    // Batch obfuscation: the caller queues plain text and the worker
+    // encrypts each batch into records of up to LOGOBF_MAX_PLAINTEXT bytes.
+    // Queued buffers are encrypted in place; BatchHeaders holds the record
+    // header written before every chunk.
+    std::atomic<bool> BatchObfuscation;
+    std::vector<uint8_t> BatchHeaders;
+    std::string BatchPlain;
+
+    // Thread staging: Display runs without DataLock and appends to the
+    // stripe of the calling thread; the worker merges staged records into
+    // Queue. A drain stops when Queue is full and the rest stays staged.
+    // Queued data is then obfuscated by the worker as in batch mode.
+    std::atomic<bool> ThreadStaging;
+    StagingQueue Staging;
+    uint64_t StagingDrainTime;
+
+    // Queue overflow: what happens to a record the queue cannot take. The
+    // spill file is opened on first use and written synchronously; waits
+    // and spill writes are done with DataLock released.
+    std::atomic<FileOverflowPolicy> OverflowPolicy;
+    std::atomic<uint64_t> OverflowTimeout;
+    std::atomic<Level> OverflowKeepLevel;
+    std::string OverflowFilename;
+    std::mutex SpillLock;
+    std::unique_ptr<FileIo> SpillIo;
+    bool SpillOpenFailed;
+    NonceGen SpillNonce;
+    std::string SpillBuffer;
+    std::atomic<uint64_t> OverflowDropped[LEVEL_CRITICAL + 1];
+    std::atomic<uint64_t> OverflowBlocked;
+    std::atomic<uint64_t> OverflowSpilled;
+    std::atomic<uint64_t> OverflowDroppedOldest;
   
   public:
     enum 
@@ -224,8 +300,11 @@ namespace Logme
       QUEUE_SIZE_LIMIT = QUEUE_BUFFER_SIZE * FLUSH_PRESSURE_BUFFERS,
       STAT_OUTPUT_PERIOD = 10 * 60 * 1000,  // 10 min
 
+      STAGING_BUFFER_SIZE = 64 * 1024,      // per-thread staging buffer size
+
       RIGHT_NOW = 1,                        // Force flush right now
       FLUSH_AFTER_DEFAULT = 500,
+      OVERFLOW_TIMEOUT_DEFAULT = 1000,      // max wait of BLOCK policies, ms
     };
 
     constexpr static const char* TYPE_ID = "FileBackend";
@@ -249,6 +328,64 @@ namespace Logme
     LOGMELNK void Flush() override;
     LOGMELNK std::string FormatDetails() override;
     LOGMELNK bool IsAsyncSupported() const override;
+    LOGMELNK bool IsDeferredFormatSupported() const override;
+
+    /// <summary>
+    /// Enables formatting of printf records on the FileManager worker thread. The caller only
+    /// captures arguments, timestamp and thread id; the message and the rest of the line are
+    /// rendered by the worker. Has effect only in asynchronous mode.
+    /// </summary>
+    /// <param name="enable">true to queue captured arguments instead of formatted lines.</param>
+    /// <returns>false if the mode cannot be changed because data is still queued.</returns>
+    LOGMELNK bool SetDeferredFormat(bool enable);
+    LOGMELNK bool GetDeferredFormat() const;
+
+    /// <summary>
+    /// Moves obfuscation to the FileManager worker. Queued data stays plain text and the worker
+    /// encrypts every batch taken from the queue as a few large records instead of one record
+    /// per line, which lets the multi-block ChaCha20 kernels work on long runs of data. Has effect
+    /// only in asynchronous mode with an obfuscation key set.
+    /// </summary>
+    /// <param name="enable">true to encrypt on the worker.</param>
+    /// <returns>false if the mode cannot be changed because data is still queued.</returns>
+    LOGMELNK bool SetBatchObfuscation(bool enable);
+    LOGMELNK bool GetBatchObfuscation() const;
+
+    /// <summary>
+    /// Lets producer threads queue records without the channel lock. Each thread appends into
+    /// its own staging buffer; full buffers are passed to the FileManager worker through a
+    /// lock-free list and the worker merges all staged records by the time they were staged.
+    /// Records of one thread keep their order. Has effect only in asynchronous mode; with an
+    /// obfuscation key set the worker encrypts the data as with SetBatchObfuscation().
+    /// </summary>
+    /// <param name="enable">true to stage records per thread.</param>
+    /// <returns>false if the mode cannot be changed because data is still queued.</returns>
+    LOGMELNK bool SetThreadStaging(bool enable);
+    LOGMELNK bool GetThreadStaging() const;
+    LOGMELNK bool IsConcurrentDisplaySupported() const override;
+
+    /// <summary>
+    /// Selects what happens to a record when the asynchronous queue has no free buffer.
+    /// DROP_NEW discards the record. BLOCK waits up to timeout milliseconds for the worker
+    /// to free a buffer and then discards it. DROP_BY_LEVEL waits only for records of
+    /// keepLevel and above and discards the rest at once. SPILL writes the record to the
+    /// overflow file synchronously. DROP_OLDEST discards the oldest buffer waiting for the
+    /// worker to make room. With thread staging the staging buffers are the limit; DROP_OLDEST
+    /// then discards the new record.
+    /// </summary>
+    LOGMELNK void SetOverflowPolicy(
+      FileOverflowPolicy policy
+      , uint64_t timeout = OVERFLOW_TIMEOUT_DEFAULT
+      , Level keepLevel = LEVEL_ERROR
+    );
+    LOGMELNK FileOverflowPolicy GetOverflowPolicy() const;
+
+    /// <summary>
+    /// Sets the file used by the SPILL policy. A relative name is resolved against the logger
+    /// home directory; an empty name selects the log file name with ".overflow" appended.
+    /// </summary>
+    LOGMELNK void SetOverflowFile(const std::string& name);
+    LOGMELNK std::string GetOverflowPathName();
 
     LOGMELNK static size_t GetMaxSizeDefault();
     LOGMELNK static void SetMaxSizeDefault(size_t size);
@@ -300,7 +437,7 @@ namespace Logme
   
   protected:
     LOGMELNK void Display(Context& context) override;
-    size_t AppendStringInternal(const char* text, size_t len);
+    size_t AppendStringInternal(const char* text, size_t len, Level level = LEVEL_INFO);
 
   private:
     class FileManagerFactory& GetFactory() const;
@@ -319,8 +456,50 @@ namespace Logme
     );
     bool ApplySizeLimit(size_t add);
     void Truncate();
-    size_t AppendObfuscated(const char* text, size_t add);
-    size_t AppendOutputData(const char* text, size_t add);
+    size_t AppendObfuscated(const char* text, size_t add, Level level);
+    size_t AppendOutputData(const char* text, size_t add, Level level);
+    bool IsFramed() const;
+    bool IsStaged() const;
+    bool IsWorkerObfuscation() const;
+    size_t AppendStaged(const char* text, size_t add, Level level);
+    struct DrainState
+    {
+      FileBackend* Self;
+      std::vector<std::pair<Level, std::string>> Spill;   // spilled without DataLock
+    };
+
+    size_t DrainStaging();
+    static bool AppendDrainedRecord(void* context, const char* text, size_t len, uint32_t tag);
+    size_t AppendFramed(
+      Context* context
+      , OutputFlags flags
+      , const char* text
+      , size_t len
+      , Level level = LEVEL_INFO
+    );
+    enum class OverflowSite
+    {
+      QUEUE,                                // producer, Queue is full
+      STAGING,                              // producer, staging buffers are full
+      DRAIN,                                // DrainStaging(), record is longer than a buffer
+    };
+
+    bool ResolveOverflow(
+      const char* text
+      , size_t add
+      , Level level
+      , OverflowSite site
+      , uint64_t& deadline
+    );
+    bool WaitOverflow(uint64_t& deadline, CS* dataLock);
+    bool DropOldestBuffer();
+    bool Spill(const char* text, size_t add);
+    void CountOverflowDrop(Level level, size_t add);
+    size_t RenderDeferred(std::vector<DataBufferPtr>& data);
+    void RenderDeferredRecord(const char* record, size_t size, const ObfKey* key);
+    void AppendRendered(const char* text, size_t len, const ObfKey* key);
+    size_t ObfuscateBatch(std::vector<DataBufferPtr>& data, const ObfKey* key);
+    void AppendBatchRecords(const char* text, size_t len, const ObfKey* key);
     enum class FlushRequestSource
     {
       UNKNOWN,
@@ -1,6 +1,9 @@
 #pragma once
 
-#include <list>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <mutex>
 
 #include <Logme/Backend/MemoryTrackedBackend.h>
@@ -10,31 +13,92 @@ namespace Logme
   struct RingBufferBackendConfig : public BackendConfig
   {
     size_t MaxItems;
-    enum { MAX_ITEMS_DEFAULT = 1000 };
+    size_t MaxBytes;                      // 0: storage grows to keep MaxItems records
+    enum
+    {
+      MAX_ITEMS_DEFAULT = 1000,
+      MAX_BYTES_DEFAULT = 0,
+      INITIAL_BYTES = 64 * 1024,          // First allocation when MaxBytes is 0
+    };
 
     LOGMELNK RingBufferBackendConfig();
 
     LOGMELNK bool Parse(const Json::Value* po) override;
   };
 
+  /// <summary>
+  /// Receives stored text without copying. A record that wraps around the end of the ring
+  /// is passed as two consecutive fragments.
+  /// </summary>
+  typedef std::function<void(const char* data, size_t size)> RingBufferVisitor;
+
   struct RingBufferBackend : public MemoryTrackedBackend
   {
+    struct Record
+    {
+      uint64_t Offset;
+      size_t Length;
+      std::atomic<bool> Ready;
+    };
+
     std::mutex Lock;
-    std::list<std::string> Ring;
     RingBufferBackendConfig Config;
 
+    // Preallocated storage: Capacity bytes of text and MaxItems record slots.
+    // Offsets grow monotonically; position in Data is Offset % Capacity.
+    // Without MaxBytes, Capacity is doubled when the records do not fit.
+    std::unique_ptr<char[]> Data;
+    std::unique_ptr<Record[]> Records;
+    size_t Capacity;
+    size_t Slots;
+    size_t First;
+    size_t Count;
+    uint64_t Head;
+    uint64_t Tail;
+
     constexpr static const char* TYPE_ID = "RingBufferBackend";
 
     LOGMELNK RingBufferBackend(ChannelPtr owner);
+    LOGMELNK ~RingBufferBackend();
 
     LOGMELNK void Display(Context& context) override;
+    LOGMELNK bool IsConcurrentDisplaySupported() const override;
 
     LOGMELNK void Clear();
+
+    /// <summary>
+    /// Stores a record. Space is reserved under the lock, the text is copied after the lock
+    /// is released, so concurrent writers copy in parallel. The oldest records are evicted
+    /// when MaxItems or MaxBytes would be exceeded; a record longer than MaxBytes is cut.
+    /// With MaxBytes set to 0 only MaxItems evicts records.
+    /// </summary>
     LOGMELNK void Append(const char* str, int nc);
-    LOGMELNK std::string Join();  
+    LOGMELNK std::string Join();
+
+    /// <summary>
+    /// Calls visitor for the stored records from the oldest to the newest while holding the
+    /// ring lock. Records that are still being copied by a writer are skipped.
+    /// </summary>
+    /// <returns>Number of records visited.</returns>
+    LOGMELNK size_t Visit(const RingBufferVisitor& visitor);
+
+    /// <summary>Returns number of stored records.</summary>
+    LOGMELNK size_t GetCount();
+
+    /// <summary>Returns number of bytes used by stored records.</summary>
+    LOGMELNK size_t GetUsedBytes();
 
     LOGMELNK BackendConfigPtr CreateConfig() override;
     LOGMELNK bool ApplyConfig(BackendConfigPtr c) override;
     LOGMELNK std::string FormatDetails() override;
+
+  private:
+    void Allocate(size_t capacity, size_t slots);
+    void Resize(size_t capacity, size_t slots);
+    void Release();
+    void WaitForWriters();
+    bool Reserve(size_t& length, size_t& slot, uint64_t& offset);
+    void CopyIn(uint64_t offset, const char* str, size_t length);
+    void VisitRecord(const Record& r, const RingBufferVisitor& visitor) const;
   };
 }
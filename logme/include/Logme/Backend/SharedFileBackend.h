@@ -1,7 +1,10 @@
 #pragma once
 
+#include <condition_variable>
+#include <cstdint>
 #include <mutex>
 #include <string>
+#include <thread>
 
 #include <Logme/Backend/Backend.h>
 #include <Logme/CritSection.h>
@@ -15,6 +18,9 @@ namespace Logme
     size_t MaxSize;
     size_t Timeout;
     std::string Filename;
+    bool Persistent;
+    size_t FlushInterval;
+    size_t BatchSize;
 
     LOGMELNK SharedFileBackendConfig();
     LOGMELNK ~SharedFileBackendConfig();
@@ -33,10 +39,29 @@ namespace Logme
     std::string Name;
     std::string NameTemplate;
 
+    // Persistent mode: descriptor stays open, records are batched in Pending
+    bool Persistent;
+    size_t FlushInterval;
+    size_t BatchSize;
+    std::string Pending;
+    size_t PendingRecords;
+    uint64_t PendingSince;
+    bool FlushFailed;
+    uint64_t DroppedRecords;
+    uint64_t DroppedBytes;
+    uint64_t FileDevice;
+    uint64_t FileInode;
+
+    std::condition_variable_any FlushCV;
+    std::thread Flusher;
+    bool StopFlusher;
+
   public:
     enum
     {
       MAX_SIZE_DEFAULT = 8 * 1024 * 1024,
+      FLUSH_INTERVAL_DEFAULT = 100,         // ms
+      BATCH_SIZE_DEFAULT = 64 * 1024,
     };
 
     constexpr static const char* TYPE_ID = "SharedFileBackend";
@@ -46,7 +71,35 @@ namespace Logme
 
     LOGMELNK void SetMaxSize(size_t size);
 
+    /// <summary>
+    /// Keeps the file open in append mode and writes records in batches instead of opening,
+    /// locking and closing the file for every record. Batches are written when BatchSize
+    /// bytes are pending or FlushInterval ms passed since the first pending record. Every
+    /// batch is written under an exclusive advisory lock, the same lock the per-record mode
+    /// holds while the file is open, so size truncation stays coordinated between processes.
+    /// The file is reopened when another process renames or deletes it.
+    /// </summary>
+    /// <param name="persistent">true to enable persistent mode.</param>
+    /// <param name="flushInterval">Maximal delay of a pending record in milliseconds; 0 writes every record immediately.</param>
+    /// <param name="batchSize">Pending bytes that trigger an immediate write.</param>
+    LOGMELNK void SetPersistent(
+      bool persistent
+      , size_t flushInterval = FLUSH_INTERVAL_DEFAULT
+      , size_t batchSize = BATCH_SIZE_DEFAULT
+    );
+    LOGMELNK bool GetPersistent();
+
+    /// <summary>
+    /// Records and bytes of persistent mode batches that were discarded because the file
+    /// could not be opened or locked. A failed batch is kept and retried until it grows
+    /// beyond MaxSize (MAX_SIZE_DEFAULT when MaxSize is 0) or the backend is reconfigured.
+    /// </summary>
+    LOGMELNK uint64_t GetDroppedRecords();
+    LOGMELNK uint64_t GetDroppedBytes();
+
     LOGMELNK void Display(Context& context) override;
+    LOGMELNK void Flush() override;
+    LOGMELNK bool IsConcurrentDisplaySupported() const override;
     LOGMELNK std::string GetPathName(int index = 0) override;
 
     LOGMELNK BackendConfigPtr CreateConfig() override;
@@ -57,6 +110,21 @@ namespace Logme
   private:
     bool CreateLog();
     void CloseLog();
+
+    std::string BuildName();
+    bool CreateDirectories();
+    bool OpenPersistent();
+    bool LockFile();
+    void UnlockFile();
+    bool IsFileReplaced();
+    void TruncatePersistent();
+    void FlushPending();
+    void KeepPending();
+    void DropPending();
+    size_t GetPendingLimit() const;
+    void StartFlusher();
+    void StopFlusherThread();
+    void FlusherThread();
   };
 
   typedef std::shared_ptr<class SharedFileBackend> SharedFileBackendPtr;
@@ -106,6 +106,7 @@ namespace Logme
     void SetCurrentFirstWriteTime(std::uint64_t value);
     bool TakeReady(std::vector<DataBufferPtr>& out);
     void Recycle(std::vector<DataBufferPtr>& buffers);
+    bool DropOldestReady(std::size_t& bytes);
 
     SoftFlushState PrepareSoftFlushCurrent(DataBuffer* &expected);
     bool PublishCurrent(bool& needSignal);
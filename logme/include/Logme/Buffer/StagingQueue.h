@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <Logme/Buffer/DataBuffer.h>
+
+namespace Logme
+{
+  class MemoryUsageTracker;
+
+  // Striped staging area in front of BufferQueue. Producer threads append
+  // records into the buffer of their own stripe without the channel lock;
+  // full buffers are handed to the consumer through a lock-free stack. The
+  // consumer drains all stripes and receives the records merged by the
+  // time they were staged. Records of one thread keep their order.
+  class StagingQueue
+  {
+  public:
+    // Returns false to stop the drain: the record and the ones after it
+    // stay staged and are passed first by the next Drain()
+    typedef bool (*RecordFunc)(
+      void* context
+      , const char* p
+      , std::size_t cb
+      , std::uint32_t tag
+    );
+
+    struct Options
+    {
+      std::size_t Stripes = 0;              // 0: number of hardware threads
+      std::size_t BufferSize = 64 * 1024;
+      std::size_t MaxBuffers = 0;           // 0: no limit
+    };
+
+  private:
+    struct Block
+    {
+      Block* Next;
+      DataBuffer Buffer;
+
+      Block(std::size_t capacity, MemoryUsageTracker* memoryTracker);
+    };
+
+    struct Cursor
+    {
+      Block* Owner;
+      const char* Pos;
+      const char* End;
+      std::uint64_t Key;
+    };
+
+    struct alignas(64) Stripe
+    {
+      std::atomic<bool> Busy;
+      std::atomic<bool> HasData;
+      Block* Current;
+      std::uint64_t LastKey;
+
+      Stripe();
+    };
+
+    Options OptionsValue;
+    MemoryUsageTracker* MemoryTracker;
+
+    std::unique_ptr<Stripe[]> Stripes;
+    std::size_t StripeMask;
+
+    std::atomic<Block*> Full;
+    std::atomic<std::size_t> FullBytes;
+    std::atomic<std::size_t> TotalBuffers;
+
+    std::mutex FreeLock;
+    std::vector<Block*> FreeList;
+
+    std::mutex DrainLock;
+    std::vector<Cursor> Pending;
+    std::atomic<bool> HasPendingFlag;
+
+  public:
+    StagingQueue(const Options& options, MemoryUsageTracker* memoryTracker);
+    ~StagingQueue();
+
+    StagingQueue(const StagingQueue&) = delete;
+    StagingQueue& operator=(const StagingQueue&) = delete;
+
+    // Called by producers. tag is passed back to the consumer with the record.
+    // firstData is set when the stripe had no pending records, handedOff when
+    // a full buffer was passed to the consumer.
+    bool Append(
+      const char* p
+      , std::size_t cb
+      , std::uint32_t tag
+      , bool& firstData
+      , bool& handedOff
+    );
+
+    // Called by the consumer. Takes everything staged so far and calls f for
+    // every record in staging order. Returns number of payload bytes passed
+    // to f before it stopped the drain.
+    std::size_t Drain(RecordFunc f, void* context);
+
+    bool HasData() const;
+    bool HasPending() const;
+    std::size_t GetHandedOffBytes() const;
+    std::size_t GetStripeCount() const;
+
+  private:
+    Stripe& GetStripe();
+    Block* TakeBlock(std::size_t cb);
+    void ReleaseBlock(Block* block);
+    void PushFull(Block* block);
+  };
+}
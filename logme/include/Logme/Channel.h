@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -59,8 +60,10 @@ namespace Logme
     std::atomic<bool> Linked;
     std::atomic<size_t> BackendCount;
     std::atomic<bool> Active;
+    std::atomic<bool> DeferredFormat;
 
     void UpdateActive();
+    static void BumpThreadNameGeneration();
 
     void SetThreadName(
       uint64_t id
@@ -90,6 +93,35 @@ namespace Logme
 
     TDisplayFilter DisplayFilter;
 
+    // Immutable view of backends, link and display filter used by Display.
+    // Writers rebuild it under DataLock; readers never take the lock to
+    // get it. Backends that cannot be entered concurrently are kept in a
+    // separate list and are still called with DataLock held.
+    struct DisplaySnapshot
+    {
+      BackendArray Concurrent;
+      BackendArray Serialized;
+      IDPtr Link;
+      ChannelPtr LinkTo;
+      TDisplayFilter DisplayFilter;
+    };
+
+    static constexpr int DISPLAY_SNAPSHOT_RECLAIM_SPINS = 64;
+
+    std::mutex DisplaySnapshotLock;
+    std::vector<std::unique_ptr<DisplaySnapshot>> DisplaySnapshots;
+    std::atomic<const DisplaySnapshot*> ActiveDisplaySnapshot;
+    std::atomic<bool> DisplaySnapshotReclamation;
+    std::atomic<std::uint32_t> DisplaySnapshotReaders;
+    std::atomic<bool> DisplaySnapshotsRetired;
+
+    const DisplaySnapshot* AcquireDisplaySnapshot();
+    void ReleaseDisplaySnapshot();
+    void PublishDisplaySnapshot();
+    void ReclaimDisplaySnapshots();
+    void DisplaySnapshotted(Context& context, const DisplaySnapshot& snapshot);
+    void DisplayTimed(Backend* backend, Context& context);
+
   public:
     /// <summary>
     /// Creates channel with initial output flags and level filter.
@@ -148,6 +180,17 @@ namespace Logme
     /// <returns>true when channel is linked or has enabled output with at least one backend.</returns>
     LOGMELNK bool GetActive() const;
 
+    /// <summary>
+    /// Checks whether records may be passed to backends with unformatted printf arguments.
+    /// </summary>
+    /// <returns>true when every backend supports deferred formatting and channel has no link or display filter.</returns>
+    LOGMELNK bool IsDeferredFormatEnabled() const;
+
+    /// <summary>
+    /// Re-reads backend capabilities after a backend setting that affects dispatch was changed.
+    /// </summary>
+    LOGMELNK void UpdateBackendCapabilities();
+
     /// <summary>
     /// Adds backend to channel if it is not already present.
     /// </summary>
@@ -271,6 +314,7 @@ namespace Logme
 
     /// <summary>
     /// Locks channel output until the returned guard is destroyed.
+    /// Backends that support concurrent display are not blocked by this lock.
     /// </summary>
     /// <returns>Guard that holds the channel data lock.</returns>
     LOGMELNK const CS::AutoLock LockOutput();
@@ -349,6 +393,13 @@ namespace Logme
       , std::optional<std::string>* transition = nullptr
       , bool clear = true
     );
+
+    /// <summary>
+    /// Returns process-wide counter changed whenever a thread name, a pending name transition
+    /// or a channel link changes, or a channel is destroyed. Used to validate cached
+    /// thread prefixes without taking channel locks.
+    /// </summary>
+    LOGMELNK static uint64_t GetThreadNameGeneration();
   };
 
   typedef std::vector<ChannelPtr> ChannelArray;
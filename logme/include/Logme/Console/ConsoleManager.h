@@ -5,6 +5,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <string>
@@ -48,30 +49,79 @@ namespace Logme
     uint64_t RedirectedBytes;
   };
 
+  // Records are queued in a bounded multi-producer single-consumer ring of
+  // 64 byte cells. A producer reserves the cells of a record with a CAS on
+  // Head, copies the record and publishes it by storing the position in the
+  // sequence slot of the first cell. The consumer takes published records
+  // from ReadPos and releases the cells by moving Tail after they are
+  // written. Lock is only used to start the worker, to wake it when it
+  // sleeps and for waiting on a full queue.
   class ConsoleManager
   {
     friend struct ConsoleBackend;
+
+    enum : size_t
+    {
+      CELL_SIZE = 64,
+      MIN_RING_SIZE = 64 * 1024,
+      MAX_RING_SIZE = 64 * 1024 * 1024,
+      MAX_BATCH_RECORDS = 256,
+    };
+
+    struct RingRecord
+    {
+      const ConsoleRecordHeader* Header;
+      const char* Text;
+    };
+
+#if CONSOLE_ENABLE_COUNTERS
+    struct QueueCounters
+    {
+      std::atomic<uint64_t> MaxQueuedRecords;
+      std::atomic<uint64_t> MaxQueuedBytes;
+      std::atomic<uint64_t> DroppedRecords;
+      std::atomic<uint64_t> DroppedBytes;
+      std::atomic<uint64_t> BlockedCalls;
+      std::atomic<uint64_t> RedirectedRecords;
+      std::atomic<uint64_t> RedirectedBytes;
+    };
+#endif
+
     std::atomic<bool> StopRequested;
     bool Reschedule;
     std::thread ManagerThread;
     std::atomic<bool> WorkerRunning;
+    std::atomic<bool> Sleeping;
 
     mutable std::mutex Lock;
     std::condition_variable CV;
     std::condition_variable NotFull;
     std::condition_variable Idle;
     std::set<ConsoleBackend*> Backends;
-    std::vector<unsigned char> Buffer;
-    bool Processing;
-    size_t QueuedRecords;
-    size_t QueuedBytes;
-    size_t NotFullWaiters;
-    size_t IdleWaiters;
+    std::atomic<size_t> NotFullWaiters;
+    std::atomic<size_t> IdleWaiters;
+
+    size_t CellMask;
+    std::unique_ptr<char[]> Cells;
+    std::unique_ptr<std::atomic<uint64_t>[]> Sequence;
+    alignas(64) std::atomic<uint64_t> Head;
+    alignas(64) std::atomic<uint64_t> Tail;
+    std::atomic<size_t> QueuedRecords;
+    std::atomic<size_t> QueuedBytes;
+
+    // ReadPos and InFlight belong to the consumer; DROP_OLDEST producers
+    // also move ReadPos. WriterLock keeps one consumer at a time.
+    alignas(64) std::mutex ReadLock;
+    std::atomic<uint64_t> ReadPos;
+    bool InFlight;
+    std::mutex WriterLock;
+    std::vector<RingRecord> Batch;
+
     static std::atomic<size_t> MaxRecords;
     static std::atomic<size_t> MaxBytes;
     static std::atomic<ConsoleOverflowPolicy> OverflowPolicy;
 #if CONSOLE_ENABLE_COUNTERS
-    ConsoleQueueCounters Counters;
+    QueueCounters Counters;
 #endif
 
     FileBackendPtr RedirectStdout;
@@ -123,7 +173,16 @@ namespace Logme
     static void SetQueueLimits(size_t maxRecords, size_t maxBytes);
     static void SetOverflowPolicy(ConsoleOverflowPolicy policy);
 
-    bool HasSpace(size_t recordSize) const;
+    static size_t GetCellCount(size_t bytes);
+    static const char* GetRecordEscape(const ConsoleRecordHeader* header);
+
+    bool HasQuota(size_t recordSize) const;
+    bool HasSpace(size_t recordSize, uint64_t tail) const;
+    bool ReserveQuota(size_t recordSize);
+    void ReleaseQuota(size_t records, size_t bytes);
+    bool TryAppend(const ConsoleRecordHeader& header, const char* text);
+    void PublishCell(uint64_t pos);
+    void WakeWorker();
     bool PushRecord(
       ConsoleTarget target
       , Level level
@@ -135,18 +194,22 @@ namespace Logme
     bool DropOldest(size_t recordSize);
     bool WorkerAvailableFastLocked() const;
     bool WorkerAvailableSlowLocked();
-    void WaitForSpaceLocked(std::unique_lock<std::mutex>& lock);
-    void WaitForIdleLocked(std::unique_lock<std::mutex>& lock);
+    void WaitForSpace(size_t recordSize);
+    void WaitForIdleLocked(std::unique_lock<std::mutex>& lock, uint64_t pos);
+    void NotifyNotFull();
     void NotifyNotFullLocked();
+    void NotifyIdle();
     void NotifyIdleLocked();
     void DrainPending();
+    void DrainUntil(uint64_t pos);
+    bool ProcessBatch();
     FileBackendPtr GetRedirectBackend(
       const ChannelPtr& owner
       , ConsoleTarget target
     );
     void StartWorkerLocked();
     void ManagementThread();
-    void ProcessBuffer(std::vector<unsigned char>& buffer);
+    void WriteBatch(const std::vector<RingRecord>& records);
     void ShutdownRedirectBackends();
   };
 }
@@ -32,16 +32,36 @@ namespace Logme
 
   struct ContextCache
   {
+    enum : uint64_t
+    {
+      CHANNEL_CACHE_EMPTY = 0,
+      CHANNEL_CACHE_BUSY = ~0ULL,
+    };
+
     std::atomic<ContextCacheState> State;
     FastFormatEntry Ffe;
     std::atomic<uint64_t> StatisticsGeneration;
     std::atomic<LogSiteStatistics*> Statistics;
 
+    // Channel resolved by ID at this call site and Logger channel generation
+    // it was resolved at. The pointer is used only while generation matches.
+    std::atomic<uint64_t> ChannelGeneration;
+    std::atomic<const char*> ChannelName;
+    std::atomic<Channel*> ChannelObject;
+
+    // Size of the longest std::format message produced at this call site
+    // when it did not fit into the stack buffer of the StdFormat overloads.
+    std::atomic<uint32_t> StdFormatSizeHint;
+
     ContextCache()
       : State(ContextCacheState::EMPTY)
       , Ffe{}
       , StatisticsGeneration(0)
       , Statistics(nullptr)
+      , ChannelGeneration(CHANNEL_CACHE_EMPTY)
+      , ChannelName(nullptr)
+      , ChannelObject(nullptr)
+      , StdFormatSizeHint(0)
     {
     }  
   };
@@ -56,19 +76,52 @@ namespace Logme
   {
   };
 
+  // Built-in normalizers of the collapse key. They are applied while the key
+  // is hashed and need no regular expression.
+  enum class CollapseNormalizer : uint8_t
+  {
+    NONE,
+    REGEX,      // IgnoreRegex (std::regex_replace)
+    DIGITS,     // decimal digits
+    VOLATILE    // decimal digits, hex words that contain a digit, UUIDs
+  };
+
+  // One repeat series: 64-bit hash of the normalized message and its counter
+  struct CollapseSlot
+  {
+    std::atomic<uint64_t> Hash;
+    std::atomic<uint64_t> RepeatCount;
+    std::atomic<uint64_t> LastOutputTime;
+
+    CollapseSlot()
+      : Hash(0)
+      , RepeatCount(0)
+      , LastOutputTime(0)
+    {
+    }
+  };
+
   struct CollapseContextCache : public ContextCache
   {
-    std::mutex Lock;
+    enum : uint32_t
+    {
+      COLLAPSE_KEYS_MAX = 16
+    };
+
     std::string IgnoreRegexText;
     std::regex IgnoreRegex;
-    std::string LastKey;
     CollapseMode Mode;
+    CollapseNormalizer Normalizer;
     uint64_t Limit;
     uint64_t IntervalMs;
-    uint64_t LastOutputTime;
-    uint64_t RepeatCount;
     bool IgnoreRegexEnabled;
 
+    // Last Keys distinct messages of the call site. A new message replaces
+    // the oldest one.
+    uint32_t Keys;
+    std::atomic<uint32_t> NextSlot;
+    std::unique_ptr<CollapseSlot[]> Slots;
+
     LOGMELNK CollapseContextCache(uint64_t limit);
 
     LOGMELNK CollapseContextCache(
@@ -76,15 +129,37 @@ namespace Logme
       , uint64_t intervalMs
     );
 
-    LOGMELNK CollapseContextCache(const char* ignoreRegex, uint64_t limit);
+    LOGMELNK CollapseContextCache(
+      const char* ignoreRegex
+      , uint64_t limit
+      , uint32_t keys = 1
+    );
 
     LOGMELNK CollapseContextCache(
       const char* ignoreRegex
       , CollapseEveryTag tag
       , uint64_t intervalMs
+      , uint32_t keys = 1
+    );
+
+    LOGMELNK CollapseContextCache(
+      CollapseNormalizer normalizer
+      , uint64_t limit
+      , uint32_t keys = 1
+    );
+
+    LOGMELNK CollapseContextCache(
+      CollapseNormalizer normalizer
+      , CollapseEveryTag tag
+      , uint64_t intervalMs
+      , uint32_t keys = 1
     );
 
     LOGMELNK void CompileIgnoreRegex();
+    LOGMELNK uint64_t CalcKeyHash(const char* text, size_t len) const;
+
+  private:
+    void InitSlots(uint32_t keys);
   };
 
   struct ShortenerContext
@@ -117,6 +192,31 @@ namespace Logme
       TZD_E_POS = 19,
     };
 
+    // Parts of the context needed only when a record is rendered. They are
+    // taken from a per-thread free list on first use, so a Context on the
+    // stack stays small and most records touch a few of its cache lines.
+    struct Cold
+    {
+      Cold* Next;
+
+      char Timestamp[TIMESTAMP_BUFFER_SIZE];
+      char ThreadProcessID[TID_BUFFER_SIZE + PID_BUFFER_SIZE + 1];
+
+      char Buffer[OUTPUT_BUFFER_SIZE];
+      std::unique_ptr<char[]> ExtBuffer;
+      size_t ExtBufferSize;
+
+      std::string Storage;
+      ShortenerContext MethodShortener;
+
+      Cold();
+    };
+
+    struct ColdRelease
+    {
+      LOGMELNK void operator()(Cold* cold) const;
+    };
+
     ContextCache& Cache;
 
     ID ChannelStg;
@@ -138,8 +238,6 @@ namespace Logme
     CollapseContextCache* CollapseCache;
     uint64_t CollapseRepeatCount;
 
-    char Timestamp[TIMESTAMP_BUFFER_SIZE];
-    char ThreadProcessID[TID_BUFFER_SIZE + PID_BUFFER_SIZE + 1];
     char Signature;
 
     OutputFlags Applied;
@@ -147,16 +245,26 @@ namespace Logme
     int LastLen;
     bool LoggedBytesCounted;
 
-    char Buffer[OUTPUT_BUFFER_SIZE];
-    std::unique_ptr<char[]> ExtBuffer;
-    size_t ExtBufferSize;
-
     const char* TempBuffer;
     size_t TempBufferSize;
     size_t TempBufferCapacity;
-    std::string Storage;
 
-    ShortenerContext MethodShortener;
+    // printf arguments captured by Logger when every backend of the channel
+    // formats the message later (see DeferredFormat.h). TempBuffer is not set
+    // while DeferredFormat is not nullptr.
+    const char* DeferredFormat;
+    const char* DeferredArgs;
+    size_t DeferredArgsSize;
+
+    // Set by Logger while latency timing of log statistics is enabled.
+    // ApplyTicks accumulates the time spent in Apply().
+    LogSiteStatistics* TimedSite;
+    uint64_t ApplyTicks;
+
+  private:
+    std::unique_ptr<Cold, ColdRelease> ColdPart;
+
+  public:
 
     struct Params
     {
@@ -184,13 +292,46 @@ namespace Logme
     LOGMELNK Context(ContextCache& cache, Level level, const ID* ch, const SID* sid);
     LOGMELNK Context(ContextCache& cache, Level level, const ID* chdef, const SID* siddef, const char* method, const char* module, int line, const Params& params);
 
+    Cold& GetCold()
+    {
+      return ColdPart ? *ColdPart : AcquireCold();
+    }
+
+    // Fields that were Context members before they moved to Cold
+    char* GetTimestamp()
+    {
+      return GetCold().Timestamp;
+    }
+
+    char* GetThreadProcessID()
+    {
+      return GetCold().ThreadProcessID;
+    }
+
+    char* GetBuffer()
+    {
+      return GetCold().Buffer;
+    }
+
+    std::string& GetStorage()
+    {
+      return GetCold().Storage;
+    }
+
+    ShortenerContext& GetMethodShortener()
+    {
+      return GetCold().MethodShortener;
+    }
+
     LOGMELNK void InitContext();
-    LOGMELNK void InitTimestamp(TimeFormat tf);
+    LOGMELNK void InitTimestamp(TimeFormat tf, TimePrecision precision = TIME_PRECISION_MILLISECONDS);
     LOGMELNK void InitSignature();
     LOGMELNK void InitThreadProcessID(const ChannelPtr& ch, OutputFlags flags);
     LOGMELNK void CreateTZD(char* tzd);
     LOGMELNK void SetText(const char* text);
     LOGMELNK void SetBuffer(const char* buffer, size_t size, size_t capacity);
+    LOGMELNK void SetDeferred(const char* format, const char* args, size_t size);
+    LOGMELNK void MaterializeDeferred();
     LOGMELNK bool ApplyCollapse();
 
     LOGMELNK const char* Apply(const ChannelPtr& ch, OutputFlags flags, int& nc);
@@ -198,6 +339,10 @@ namespace Logme
     LOGMELNK const char* ApplyXml(const ChannelPtr& ch, OutputFlags flags, int& nc);
   
     LOGMELNK const char* GetText() const;
+
+  private:
+    LOGMELNK Cold& AcquireCold();
+    const char* ApplyFlags(const ChannelPtr& ch, OutputFlags flags, int& nc);
   };
 }
 
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Logme
+{
+  /// <summary>
+  /// Copies printf arguments into a compact binary form so the message can be formatted later
+  /// on another thread. Integers are widened to 64 bits, floating point values are stored as
+  /// double, pointers as their address and strings are copied.
+  /// </summary>
+  /// <param name="format">printf format string.</param>
+  /// <param name="args">Arguments matching format. The list is consumed; pass a va_copy when the
+  /// caller needs it afterwards.</param>
+  /// <param name="buffer">Output buffer.</param>
+  /// <param name="size">Size of buffer in bytes.</param>
+  /// <param name="used">Receives number of bytes written to buffer.</param>
+  /// <returns>false if format uses a conversion that cannot be captured (%n, %ls, %Lf, positional
+  /// arguments) or the encoded arguments do not fit into buffer.</returns>
+  bool CaptureDeferredArgs(
+    const char* format
+    , va_list args
+    , char* buffer
+    , size_t size
+    , size_t* used
+  );
+
+  /// <summary>
+  /// Formats arguments captured by CaptureDeferredArgs() with the same format string.
+  /// </summary>
+  /// <param name="format">printf format string used for capture.</param>
+  /// <param name="data">Captured arguments.</param>
+  /// <param name="size">Size of captured arguments in bytes.</param>
+  /// <param name="out">Formatted text is appended to this string.</param>
+  /// <returns>false if data does not match format.</returns>
+  bool FormatDeferredArgs(
+    const char* format
+    , const char* data
+    , size_t size
+    , std::string& out
+  );
+}
@@ -1,6 +1,11 @@
 #pragma once
 
 #include <Logme/Context.h>
+#include <Logme/Detail/FormatString.h>
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace Logme
 {
@@ -39,7 +44,370 @@ namespace Logme
       return Context::Params(ch, sid);
     }
 
-    template<typename LoggerType, typename... Args>
+#if LOGME_COMPILE_TIME_FORMAT
+    // Arguments that Logger::Log accepts before a printf format
+    template<typename T>
+    concept FormatPrefix =
+      std::is_base_of_v<ID, std::remove_cvref_t<T>>
+      || std::is_same_v<std::remove_cvref_t<T>, ChannelPtr>
+      || std::is_same_v<std::remove_cvref_t<T>, SID>
+      || std::is_same_v<std::remove_cvref_t<T>, Override>;
+
+    template<typename T>
+    constexpr bool IsFormatLiteral =
+      std::is_same_v<std::remove_extent_t<std::remove_reference_t<T>>, const char>
+      && std::is_array_v<std::remove_reference_t<T>>;
+
+    // Position of a string literal that follows up to three prefix
+    // arguments, or -1
+    template<typename... Args>
+    struct LiteralFormatPos : std::integral_constant<int, -1>
+    {
+    };
+
+    template<typename First, typename... Rest>
+    struct LiteralFormatPos<First, Rest...>
+      : std::integral_constant<int, IsFormatLiteral<First> ? 0 : -1>
+    {
+    };
+
+    template<FormatPrefix P1, typename... Rest>
+    struct LiteralFormatPos<P1, Rest...>
+      : std::integral_constant<
+          int
+          , LiteralFormatPos<Rest...>::value < 0 || LiteralFormatPos<Rest...>::value >= 3
+            ? -1
+            : LiteralFormatPos<Rest...>::value + 1
+        >
+    {
+    };
+
+    // FormatArg is the argument the macro saw written as a string literal.
+    // An array forwarded through a function parameter has the same type but
+    // is not a constant expression, so it keeps the runtime path.
+    template<int FormatArg, typename... Args>
+    constexpr bool IsLiteralFormatCall =
+      FormatArg >= 0 && LiteralFormatPos<Args...>::value == FormatArg;
+
+    template<typename LoggerType, typename Prefix, typename... Args>
+    inline void DispatchFormat(
+      LoggerType&& logger
+      , ContextCache& cache
+      , CollapseContextCache* collapseCache
+      , Level level
+      , const ID* ch
+      , const SID* sid
+      , const char* method
+      , const char* file
+      , int line
+      , Prefix&& prefix
+      , const FastFormatEntry& entry
+      , const char* format
+      , Args&&... args
+    )
+    {
+      // The format program was built by the compiler, so the first call
+      // at this site does not parse the format
+      if (cache.State.load(std::memory_order_acquire) == ContextCacheState::EMPTY)
+        SetFastFormat(cache, entry);
+
+      std::apply(
+        [&](auto&&... p)
+        {
+          Context context(
+            cache
+            , level
+            , ch
+            , sid
+            , method
+            , file
+            , line
+            , MakeParams(p..., format, args...)
+          );
+
+          context.CollapseCache = collapseCache;
+
+          logger->Log(context, std::forward<decltype(p)>(p)..., format, std::forward<Args>(args)...);
+        }
+        , std::forward<Prefix>(prefix)
+      );
+    }
+
+    template<int FormatArg, typename LoggerType, typename... Args>
+    requires (FormatArg == 0)
+    inline void Dispatch(
+      LoggerType&& logger
+      , ContextCache& cache
+      , Level level
+      , const ID* ch
+      , const SID* sid
+      , const char* method
+      , const char* file
+      , int line
+      , const FormatString<std::type_identity_t<Args>...>& format
+      , Args&&... args
+    )
+    {
+      DispatchFormat(
+        logger
+        , cache
+        , nullptr
+        , level
+        , ch
+        , sid
+        , method
+        , file
+        , line
+        , std::forward_as_tuple()
+        , format.Entry
+        , format.Text
+        , std::forward<Args>(args)...
+      );
+    }
+
+    template<int FormatArg, typename LoggerType, FormatPrefix P1, typename... Args>
+    requires (FormatArg == 1)
+    inline void Dispatch(
+      LoggerType&& logger
+      , ContextCache& cache
+      , Level level
+      , const ID* ch
+      , const SID* sid
+      , const char* method
+      , const char* file
+      , int line
+      , P1&& p1
+      , const FormatString<std::type_identity_t<Args>...>& format
+      , Args&&... args
+    )
+    {
+      DispatchFormat(
+        logger
+        , cache
+        , nullptr
+        , level
+        , ch
+        , sid
+        , method
+        , file
+        , line
+        , std::forward_as_tuple(std::forward<P1>(p1))
+        , format.Entry
+        , format.Text
+        , std::forward<Args>(args)...
+      );
+    }
+
+    template<int FormatArg, typename LoggerType, FormatPrefix P1, FormatPrefix P2, typename... Args>
+    requires (FormatArg == 2)
+    inline void Dispatch(
+      LoggerType&& logger
+      , ContextCache& cache
+      , Level level
+      , const ID* ch
+      , const SID* sid
+      , const char* method
+      , const char* file
+      , int line
+      , P1&& p1
+      , P2&& p2
+      , const FormatString<std::type_identity_t<Args>...>& format
+      , Args&&... args
+    )
+    {
+      DispatchFormat(
+        logger
+        , cache
+        , nullptr
+        , level
+        , ch
+        , sid
+        , method
+        , file
+        , line
+        , std::forward_as_tuple(std::forward<P1>(p1), std::forward<P2>(p2))
+        , format.Entry
+        , format.Text
+        , std::forward<Args>(args)...
+      );
+    }
+
+    template<int FormatArg, typename LoggerType, FormatPrefix P1, FormatPrefix P2, FormatPrefix P3, typename... Args>
+    requires (FormatArg == 3)
+    inline void Dispatch(
+      LoggerType&& logger
+      , ContextCache& cache
+      , Level level
+      , const ID* ch
+      , const SID* sid
+      , const char* method
+      , const char* file
+      , int line
+      , P1&& p1
+      , P2&& p2
+      , P3&& p3
+      , const FormatString<std::type_identity_t<Args>...>& format
+      , Args&&... args
+    )
+    {
+      DispatchFormat(
+        logger
+        , cache
+        , nullptr
+        , level
+        , ch
+        , sid
+        , method
+        , file
+        , line
+        , std::forward_as_tuple(std::forward<P1>(p1), std::forward<P2>(p2), std::forward<P3>(p3))
+        , format.Entry
+        , format.Text
+        , std::forward<Args>(args)...
+      );
+    }
+
+    template<int FormatArg, typename LoggerType, typename... Args>
+    requires (FormatArg == 0)
+    inline void DispatchCollapse(
+      LoggerType&& logger
+      , CollapseContextCache& cache
+      , Level level
+      , const ID* ch
+      , const SID* sid
+      , const char* method
+      , const char* file
+      , int line
+      , const FormatString<std::type_identity_t<Args>...>& format
+      , Args&&... args
+    )
+    {
+      DispatchFormat(
+        logger
+        , cache
+        , &cache
+        , level
+        , ch
+        , sid
+        , method
+        , file
+        , line
+        , std::forward_as_tuple()
+        , format.Entry
+        , format.Text
+        , std::forward<Args>(args)...
+      );
+    }
+
+    template<int FormatArg, typename LoggerType, FormatPrefix P1, typename... Args>
+    requires (FormatArg == 1)
+    inline void DispatchCollapse(
+      LoggerType&& logger
+      , CollapseContextCache& cache
+      , Level level
+      , const ID* ch
+      , const SID* sid
+      , const char* method
+      , const char* file
+      , int line
+      , P1&& p1
+      , const FormatString<std::type_identity_t<Args>...>& format
+      , Args&&... args
+    )
+    {
+      DispatchFormat(
+        logger
+        , cache
+        , &cache
+        , level
+        , ch
+        , sid
+        , method
+        , file
+        , line
+        , std::forward_as_tuple(std::forward<P1>(p1))
+        , format.Entry
+        , format.Text
+        , std::forward<Args>(args)...
+      );
+    }
+
+    template<int FormatArg, typename LoggerType, FormatPrefix P1, FormatPrefix P2, typename... Args>
+    requires (FormatArg == 2)
+    inline void DispatchCollapse(
+      LoggerType&& logger
+      , CollapseContextCache& cache
+      , Level level
+      , const ID* ch
+      , const SID* sid
+      , const char* method
+      , const char* file
+      , int line
+      , P1&& p1
+      , P2&& p2
+      , const FormatString<std::type_identity_t<Args>...>& format
+      , Args&&... args
+    )
+    {
+      DispatchFormat(
+        logger
+        , cache
+        , &cache
+        , level
+        , ch
+        , sid
+        , method
+        , file
+        , line
+        , std::forward_as_tuple(std::forward<P1>(p1), std::forward<P2>(p2))
+        , format.Entry
+        , format.Text
+        , std::forward<Args>(args)...
+      );
+    }
+
+    template<int FormatArg, typename LoggerType, FormatPrefix P1, FormatPrefix P2, FormatPrefix P3, typename... Args>
+    requires (FormatArg == 3)
+    inline void DispatchCollapse(
+      LoggerType&& logger
+      , CollapseContextCache& cache
+      , Level level
+      , const ID* ch
+      , const SID* sid
+      , const char* method
+      , const char* file
+      , int line
+      , P1&& p1
+      , P2&& p2
+      , P3&& p3
+      , const FormatString<std::type_identity_t<Args>...>& format
+      , Args&&... args
+    )
+    {
+      DispatchFormat(
+        logger
+        , cache
+        , &cache
+        , level
+        , ch
+        , sid
+        , method
+        , file
+        , line
+        , std::forward_as_tuple(std::forward<P1>(p1), std::forward<P2>(p2), std::forward<P3>(p3))
+        , format.Entry
+        , format.Text
+        , std::forward<Args>(args)...
+      );
+    }
+
+#define LOGME_DISPATCH_REQUIRES(Args) requires (!IsLiteralFormatCall<FormatArg, Args...>)
+#else
+#define LOGME_DISPATCH_REQUIRES(Args)
+#endif
+
+    template<int FormatArg = -1, typename LoggerType, typename... Args>
+    LOGME_DISPATCH_REQUIRES(Args)
     inline decltype(auto) Dispatch(
       LoggerType&& logger
       , ContextCache& cache
@@ -66,8 +434,8 @@ namespace Logme
       return logger->Log(context, std::forward<Args>(args)...);
     }
 
-
-    template<typename LoggerType, typename... Args>
+    template<int FormatArg = -1, typename LoggerType, typename... Args>
+    LOGME_DISPATCH_REQUIRES(Args)
     inline decltype(auto) DispatchCollapse(
       LoggerType&& logger
       , CollapseContextCache& cache
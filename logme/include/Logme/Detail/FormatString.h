@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <type_traits>
+
+#include <Logme/FastFormat.h>
+
+// Literal printf formats of Logme macros are parsed and checked against the
+// argument types at compile time. Define as 0 to format them only at runtime.
+#ifndef LOGME_COMPILE_TIME_FORMAT
+  #if defined(__cpp_consteval) && defined(__cpp_concepts)
+    #define LOGME_COMPILE_TIME_FORMAT 1
+  #else
+    #define LOGME_COMPILE_TIME_FORMAT 0
+  #endif
+#endif
+
+#if LOGME_COMPILE_TIME_FORMAT
+
+namespace Logme
+{
+  namespace Detail
+  {
+    // Never defined. A call from the consteval constructor of FormatString
+    // stops compilation and the compiler error names the problem.
+    void FormatSpecifierIncomplete();
+    void FormatWritebackNotAllowed();
+    void FormatTooFewArguments();
+    void FormatTooManyArguments();
+    void FormatWidthNotInt();
+    void FormatArgumentTypeMismatch();
+
+    enum class FormatArgClass : uint8_t
+    {
+      INTEGER,
+      FLOAT,
+      LONG_DOUBLE,
+      STRING,
+      WIDE_STRING,
+      POINTER,
+      NULL_POINTER,
+      OTHER
+    };
+
+    // Argument type after the default argument promotions of "..."
+    struct FormatArgType
+    {
+      FormatArgClass Class;
+      uint8_t Size;
+    };
+
+    template<typename T>
+    constexpr FormatArgType GetFormatArgType()
+    {
+      using D = std::decay_t<T>;
+
+      if constexpr (std::is_same_v<D, std::nullptr_t>)
+        return {FormatArgClass::NULL_POINTER, sizeof(void*)};
+      else if constexpr (std::is_integral_v<D>)
+        return {FormatArgClass::INTEGER, sizeof(decltype(+D{}))};
+      else if constexpr (std::is_enum_v<D>)
+        return {FormatArgClass::INTEGER, sizeof(decltype(+std::underlying_type_t<D>{}))};
+      else if constexpr (std::is_same_v<D, long double>)
+        return {FormatArgClass::LONG_DOUBLE, sizeof(long double)};
+      else if constexpr (std::is_floating_point_v<D>)
+        return {FormatArgClass::FLOAT, sizeof(double)};
+      else if constexpr (std::is_pointer_v<D>)
+      {
+        using P = std::remove_cv_t<std::remove_pointer_t<D>>;
+
+        if constexpr (
+          std::is_same_v<P, char>
+          || std::is_same_v<P, signed char>
+          || std::is_same_v<P, unsigned char>
+        )
+          return {FormatArgClass::STRING, sizeof(D)};
+        else if constexpr (std::is_same_v<P, wchar_t>)
+          return {FormatArgClass::WIDE_STRING, sizeof(D)};
+        else
+          return {FormatArgClass::POINTER, sizeof(D)};
+      }
+      else
+        return {FormatArgClass::OTHER, 0};
+    }
+
+    constexpr size_t GetFormatIntegerSize(FastFormatLength length)
+    {
+      switch (length)
+      {
+      case FastFormatLength::LONG: return sizeof(long);
+      case FastFormatLength::LONG_LONG: return sizeof(long long);
+      case FastFormatLength::INTMAX: return sizeof(intmax_t);
+      case FastFormatLength::SIZE: return sizeof(size_t);
+      case FastFormatLength::PTRDIFF: return sizeof(ptrdiff_t);
+      default: return sizeof(int);
+      }
+    }
+
+    constexpr bool IsFormatInt(FormatArgType arg)
+    {
+      return arg.Class == FormatArgClass::INTEGER && arg.Size == sizeof(int);
+    }
+
+    // Signedness is not checked: "%u" with an int is common and harmless
+    constexpr bool MatchFormatArg(const FormatConversion& c, FormatArgType arg)
+    {
+      switch (c.Conversion)
+      {
+      case 'd':
+      case 'i':
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X':
+        return arg.Class == FormatArgClass::INTEGER
+          && arg.Size == GetFormatIntegerSize(c.Spec.Length);
+
+      case 'c':
+        return IsFormatInt(arg);
+
+      case 's':
+        if (arg.Class == FormatArgClass::NULL_POINTER)
+          return true;
+
+        return c.Spec.Length == FastFormatLength::LONG
+          ? arg.Class == FormatArgClass::WIDE_STRING
+          : arg.Class == FormatArgClass::STRING;
+
+      case 'p':
+        return arg.Class == FormatArgClass::POINTER
+          || arg.Class == FormatArgClass::STRING
+          || arg.Class == FormatArgClass::WIDE_STRING
+          || arg.Class == FormatArgClass::NULL_POINTER;
+
+      default:
+        return c.LongDouble
+          ? arg.Class == FormatArgClass::LONG_DOUBLE
+          : arg.Class == FormatArgClass::FLOAT;
+      }
+    }
+
+    // Conversions the parser does not know, such as "%I64d", stop the check
+    // and leave the rest of the format to the C runtime
+    constexpr void CheckFormatArgs(
+      const char* format
+      , size_t formatLen
+      , const FormatArgType* args
+      , size_t count
+    )
+    {
+      size_t n = 0;
+      for (size_t i = 0; i < formatLen; i++)
+      {
+        if (format[i] != '%')
+          continue;
+
+        FormatConversion c{};
+        i++;
+
+        FormatParseResult rc = ParseConversion(format, formatLen, i, c);
+        if (rc == FormatParseResult::AT_END)
+          FormatSpecifierIncomplete();
+
+        if (rc == FormatParseResult::UNKNOWN)
+          return;
+
+        if (c.Conversion == '%')
+          continue;
+
+        if (c.Conversion == 'n')
+          FormatWritebackNotAllowed();
+
+        for (bool star : {c.WidthArg, c.PrecisionArg})
+        {
+          if (!star)
+            continue;
+
+          if (n == count)
+            FormatTooFewArguments();
+
+          if (!IsFormatInt(args[n++]))
+            FormatWidthNotInt();
+        }
+
+        if (n == count)
+          FormatTooFewArguments();
+
+        if (!MatchFormatArg(c, args[n++]))
+          FormatArgumentTypeMismatch();
+      }
+
+      if (n != count)
+        FormatTooManyArguments();
+    }
+
+    // Index of the first macro argument written as a string literal, or -1.
+    // text is the stringized argument list of the macro.
+    constexpr int FindFormatArg(const char* text)
+    {
+      int index = 0;
+      int depth = 0;
+      bool start = true;
+
+      for (size_t i = 0; text[i] != '\0'; i++)
+      {
+        char ch = text[i];
+
+        if (ch == '"' || ch == '\'')
+        {
+          if (ch == '"' && depth == 0 && start)
+            return index;
+
+          for (i++; text[i] != '\0' && text[i] != ch; i++)
+          {
+            if (text[i] == '\\' && text[i + 1] != '\0')
+              i++;
+          }
+
+          if (text[i] == '\0')
+            break;
+
+          start = false;
+          continue;
+        }
+
+        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')
+          continue;
+
+        start = false;
+
+        if (ch == '(' || ch == '[' || ch == '{')
+          depth++;
+        else if (ch == ')' || ch == ']' || ch == '}')
+          depth--;
+        else if (ch == ',' && depth == 0)
+        {
+          index++;
+          start = true;
+        }
+      }
+
+      return -1;
+    }
+
+    // Literal printf format of a Logme macro. The format is compiled into the
+    // program that TryFastFormat executes and checked against Args when the
+    // call is compiled.
+    template<typename... Args>
+    struct FormatString
+    {
+      const char* Text;
+      FastFormatEntry Entry;
+
+      template<size_t N>
+      consteval FormatString(const char (&text)[N])
+        : Text(text)
+        , Entry{}
+      {
+        size_t len = FormatLength(text);
+        CompileFastFormat(text, len, Entry);
+
+        const FormatArgType types[] = {GetFormatArgType<Args>()..., {FormatArgClass::OTHER, 0}};
+        CheckFormatArgs(text, len, types, sizeof...(Args));
+      }
+    };
+  }
+}
+
+#define LOGME_FORMAT_ARG(...) Logme::Detail::FindFormatArg(#__VA_ARGS__)
+#else
+#define LOGME_FORMAT_ARG(...) -1
+#endif
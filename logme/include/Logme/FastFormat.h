@@ -4,36 +4,542 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <Logme/Types.h>
+
+#if __has_include(<version>)
+#include <version>
+#endif
+
+// Floating point conversions need std::to_chars for double
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define LOGME_FAST_FORMAT_FLOAT 1
+#else
+#define LOGME_FAST_FORMAT_FLOAT 0
+#endif
+
 namespace Logme
 {
   struct Context;
+  struct ContextCache;
+
+  enum class FastFormatType : uint8_t
+  {
+    NONE,                                   // Not supported, use vsnprintf
+    LITERAL,                                // No conversions
+    PROGRAM                                 // Specs[0..SpecCount)
+  };
 
   enum class FastFormatKind : uint8_t
   {
     NONE,
-    LITERAL,
     FORMAT_S,
     FORMAT_D,
     FORMAT_I,
     FORMAT_U,
-    FORMAT_P
+    FORMAT_P,
+    FORMAT_X,
+    FORMAT_O,
+    FORMAT_C,
+    FORMAT_F,
+    FORMAT_E,
+    FORMAT_G,
+    FORMAT_PERCENT
+  };
+
+  // Length modifier of an integer conversion
+  enum class FastFormatLength : uint8_t
+  {
+    DEFAULT,
+    CHAR,                                   // hh
+    SHORT,                                  // h
+    LONG,                                   // l
+    LONG_LONG,                              // ll
+    INTMAX,                                 // j
+    SIZE,                                   // z
+    PTRDIFF                                 // t
+  };
+
+  enum : uint8_t
+  {
+    FAST_FORMAT_FLAG_LEFT = 0x01,           // '-'
+    FAST_FORMAT_FLAG_ZERO = 0x02,           // '0'
+    FAST_FORMAT_FLAG_PLUS = 0x04,           // '+'
+    FAST_FORMAT_FLAG_SPACE = 0x08,          // ' '
+    FAST_FORMAT_FLAG_ALT = 0x10,            // '#'
+    FAST_FORMAT_FLAG_UPPER = 0x20,          // %X, %F, %E, %G
+  };
+
+  // One conversion of a precompiled format and the literal text before it
+  struct FastFormatSpec
+  {
+    uint16_t LiteralPos;
+    uint16_t LiteralLen;
+    FastFormatKind Kind;
+    FastFormatLength Length;
+    uint8_t Flags;
+    uint8_t Width;
+    int16_t Precision;                      // -1 when not specified
   };
 
   struct FastFormatEntry
   {
+    enum
+    {
+      MAX_SPECS = 16
+    };
+
     const char* Format;
-    FastFormatKind Kind1;
-    FastFormatKind Kind2;
-    uint16_t Part0Len;
-    uint16_t Part1Pos;
-    uint16_t Part1Len;
-    uint16_t Part2Pos;
-    uint16_t Part2Len;
-    uint16_t BufferSizeHint;
+    FastFormatType Type;
     uint8_t SpecCount;
+    uint16_t TailPos;
+    uint16_t TailLen;
+    uint16_t BufferSizeHint;
+    FastFormatSpec Specs[MAX_SPECS];
   };
 
-  bool TryFastFormat(
+  namespace Detail
+  {
+    enum
+    {
+      FAST_FORMAT_SCAN_LIMIT = 1024,
+      FAST_FORMAT_MAX_WIDTH = 255,
+      FAST_FORMAT_MAX_PRECISION = 128,
+      FAST_FORMAT_DEFAULT_PRECISION = 6,
+      FAST_FORMAT_MAX_FIXED = 311,          // "%f" of -DBL_MAX without fraction
+    };
+
+    enum class FormatParseResult : uint8_t
+    {
+      FAST,                                 // Executed by TryFastFormat
+      SLOW,                                 // Valid, formatted by vsnprintf
+      UNKNOWN,                              // Not a standard C conversion
+      AT_END                                // Format ends inside the conversion
+    };
+
+    enum class FastFormatBuildResult : uint8_t
+    {
+      OK,
+      TOO_LONG,
+      TOO_MANY_SPECS,
+      UNSUPPORTED_SPEC,
+      SPEC_AT_END
+    };
+
+    // One printf conversion with what is needed to check its arguments
+    struct FormatConversion
+    {
+      FastFormatSpec Spec;
+      char Conversion;
+      bool WidthArg;                        // '*'
+      bool PrecisionArg;                    // ".*"
+      bool LongDouble;                      // 'L'
+    };
+
+    constexpr bool IsFormatDigit(char ch)
+    {
+      return ch >= '0' && ch <= '9';
+    }
+
+    constexpr size_t FormatLength(const char* format)
+    {
+      size_t len = 0;
+      while (format[len] != '\0')
+        len++;
+
+      return len;
+    }
+
+    // Parses one conversion. i points after '%' and is left at the
+    // conversion character.
+    constexpr FormatParseResult ParseConversion(
+      const char* format
+      , size_t formatLen
+      , size_t& i
+      , FormatConversion& c
+    )
+    {
+      FastFormatSpec& spec = c.Spec;
+      spec.Kind = FastFormatKind::NONE;
+      spec.Length = FastFormatLength::DEFAULT;
+      spec.Flags = 0;
+      spec.Width = 0;
+      spec.Precision = -1;
+
+      c.Conversion = '\0';
+      c.WidthArg = false;
+      c.PrecisionArg = false;
+      c.LongDouble = false;
+
+      bool fast = true;
+
+      for (; i < formatLen; i++)
+      {
+        char ch = format[i];
+        if (ch == '-')
+          spec.Flags |= FAST_FORMAT_FLAG_LEFT;
+        else if (ch == '0')
+          spec.Flags |= FAST_FORMAT_FLAG_ZERO;
+        else if (ch == '+')
+          spec.Flags |= FAST_FORMAT_FLAG_PLUS;
+        else if (ch == ' ')
+          spec.Flags |= FAST_FORMAT_FLAG_SPACE;
+        else if (ch == '#')
+          spec.Flags |= FAST_FORMAT_FLAG_ALT;
+        else
+          break;
+      }
+
+      if (i < formatLen && format[i] == '*')
+      {
+        c.WidthArg = true;
+        fast = false;
+        i++;
+      }
+      else
+      {
+        int width = 0;
+        for (; i < formatLen && IsFormatDigit(format[i]); i++)
+        {
+          if (width <= FAST_FORMAT_MAX_WIDTH)
+            width = width * 10 + (format[i] - '0');
+        }
+
+        if (width > FAST_FORMAT_MAX_WIDTH)
+          fast = false;
+        else
+          spec.Width = (uint8_t)width;
+      }
+
+      if (i < formatLen && format[i] == '.')
+      {
+        i++;
+
+        if (i < formatLen && format[i] == '*')
+        {
+          c.PrecisionArg = true;
+          fast = false;
+          i++;
+        }
+        else
+        {
+          int precision = 0;
+          for (; i < formatLen && IsFormatDigit(format[i]); i++)
+          {
+            if (precision <= FAST_FORMAT_MAX_PRECISION)
+              precision = precision * 10 + (format[i] - '0');
+          }
+
+          if (precision > FAST_FORMAT_MAX_PRECISION)
+            fast = false;
+          else
+            spec.Precision = (int16_t)precision;
+        }
+      }
+
+      if (i < formatLen)
+      {
+        switch (format[i])
+        {
+        case 'h':
+          if (i + 1 < formatLen && format[i + 1] == 'h')
+          {
+            spec.Length = FastFormatLength::CHAR;
+            i++;
+          }
+          else
+            spec.Length = FastFormatLength::SHORT;
+          i++;
+          break;
+
+        case 'l':
+          if (i + 1 < formatLen && format[i + 1] == 'l')
+          {
+            spec.Length = FastFormatLength::LONG_LONG;
+            i++;
+          }
+          else
+            spec.Length = FastFormatLength::LONG;
+          i++;
+          break;
+
+        case 'j':
+          spec.Length = FastFormatLength::INTMAX;
+          i++;
+          break;
+
+        case 'z':
+          spec.Length = FastFormatLength::SIZE;
+          i++;
+          break;
+
+        case 't':
+          spec.Length = FastFormatLength::PTRDIFF;
+          i++;
+          break;
+
+        case 'L':
+          c.LongDouble = true;
+          fast = false;
+          i++;
+          break;
+
+        default:
+          break;
+        }
+      }
+
+      if (i >= formatLen)
+        return FormatParseResult::AT_END;
+
+      c.Conversion = format[i];
+
+      bool upper = false;
+      switch (c.Conversion)
+      {
+      case 's': spec.Kind = FastFormatKind::FORMAT_S; break;
+      case 'c': spec.Kind = FastFormatKind::FORMAT_C; break;
+      case 'p': spec.Kind = FastFormatKind::FORMAT_P; break;
+      case 'd': spec.Kind = FastFormatKind::FORMAT_D; break;
+      case 'i': spec.Kind = FastFormatKind::FORMAT_I; break;
+      case 'u': spec.Kind = FastFormatKind::FORMAT_U; break;
+      case 'o': spec.Kind = FastFormatKind::FORMAT_O; break;
+      case 'x': spec.Kind = FastFormatKind::FORMAT_X; break;
+      case 'X': spec.Kind = FastFormatKind::FORMAT_X; upper = true; break;
+      case 'f': spec.Kind = FastFormatKind::FORMAT_F; break;
+      case 'F': spec.Kind = FastFormatKind::FORMAT_F; upper = true; break;
+      case 'e': spec.Kind = FastFormatKind::FORMAT_E; break;
+      case 'E': spec.Kind = FastFormatKind::FORMAT_E; upper = true; break;
+      case 'g': spec.Kind = FastFormatKind::FORMAT_G; break;
+      case 'G': spec.Kind = FastFormatKind::FORMAT_G; upper = true; break;
+      case '%': spec.Kind = FastFormatKind::FORMAT_PERCENT; break;
+
+      case 'a':
+      case 'A':
+      case 'n':
+        fast = false;
+        break;
+
+      default:
+        return FormatParseResult::UNKNOWN;
+      }
+
+      if (upper)
+        spec.Flags |= FAST_FORMAT_FLAG_UPPER;
+
+      const uint8_t NUMERIC_FLAGS =
+        FAST_FORMAT_FLAG_ZERO
+        | FAST_FORMAT_FLAG_PLUS
+        | FAST_FORMAT_FLAG_SPACE
+        | FAST_FORMAT_FLAG_ALT;
+
+      bool valid = true;
+      switch (c.Conversion)
+      {
+      case 's':
+      case 'c':
+        // %ls and %lc take wide characters
+        valid = !c.LongDouble
+          && (spec.Length == FastFormatLength::DEFAULT || spec.Length == FastFormatLength::LONG);
+        fast = fast
+          && spec.Length == FastFormatLength::DEFAULT
+          && (spec.Flags & NUMERIC_FLAGS) == 0
+          && (c.Conversion == 's' || spec.Precision < 0);
+        break;
+
+      case 'p':
+        valid = !c.LongDouble && spec.Length == FastFormatLength::DEFAULT;
+        fast = fast && (spec.Flags & NUMERIC_FLAGS) == 0 && spec.Precision < 0;
+        break;
+
+      case 'd':
+      case 'i':
+      case 'u':
+        valid = !c.LongDouble;
+        fast = fast && (spec.Flags & FAST_FORMAT_FLAG_ALT) == 0;
+        break;
+
+      case 'o':
+      case 'x':
+      case 'X':
+      case 'n':
+        valid = !c.LongDouble;
+        break;
+
+      case '%':
+        fast = fast
+          && spec.Length == FastFormatLength::DEFAULT
+          && !c.LongDouble
+          && spec.Flags == 0
+          && spec.Width == 0
+          && spec.Precision < 0;
+        break;
+
+      // "%#f" and long double stay with vsnprintf
+      default:
+        valid = spec.Length == FastFormatLength::DEFAULT || spec.Length == FastFormatLength::LONG;
+        fast = fast && LOGME_FAST_FORMAT_FLOAT && (spec.Flags & FAST_FORMAT_FLAG_ALT) == 0;
+        break;
+      }
+
+      if (!valid)
+        return FormatParseResult::UNKNOWN;
+
+      return fast ? FormatParseResult::FAST : FormatParseResult::SLOW;
+    }
+
+    constexpr uint16_t AlignBufferSizeHint(size_t size)
+    {
+      constexpr size_t ALIGNMENT = 32;
+
+      size = (size + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1);
+      if (size > 0xFFFFu)
+        size = 0xFFFFu;
+
+      return (uint16_t)size;
+    }
+
+    // Longest text of a conversion, or 0 when it is not bounded
+    constexpr size_t GetMaxArgTextSize(const FastFormatSpec& spec)
+    {
+      bool wide = spec.Length != FastFormatLength::DEFAULT
+        && spec.Length != FastFormatLength::CHAR
+        && spec.Length != FastFormatLength::SHORT;
+
+      size_t precision = spec.Precision < 0 ? 0 : size_t(spec.Precision);
+      size_t digits = 0;
+      size_t size = 0;
+
+      switch (spec.Kind)
+      {
+      case FastFormatKind::FORMAT_S:
+        if (spec.Precision < 0)
+          return 0;
+
+        size = precision;
+        break;
+
+      case FastFormatKind::FORMAT_C:
+      case FastFormatKind::FORMAT_PERCENT:
+        size = 1;
+        break;
+
+      case FastFormatKind::FORMAT_P:
+        size = 2 + sizeof(uintptr_t) * 2;
+        break;
+
+      // Sign or "0x" and the digits, at least precision of them
+      case FastFormatKind::FORMAT_D:
+      case FastFormatKind::FORMAT_I:
+      case FastFormatKind::FORMAT_U:
+      case FastFormatKind::FORMAT_X:
+      case FastFormatKind::FORMAT_O:
+        if (spec.Kind == FastFormatKind::FORMAT_X)
+          digits = wide ? 16 : 8;
+        else if (spec.Kind == FastFormatKind::FORMAT_O)
+          digits = wide ? 22 : 11;
+        else
+          digits = wide ? 20 : 10;
+
+        size = 2 + (digits > precision ? digits : precision);
+        break;
+
+      case FastFormatKind::FORMAT_F:
+        precision = spec.Precision < 0 ? size_t(FAST_FORMAT_DEFAULT_PRECISION) : precision;
+        size = FAST_FORMAT_MAX_FIXED + 1 + precision;
+        break;
+
+      // Sign, leading digit, point, precision digits and "e+308"
+      case FastFormatKind::FORMAT_E:
+      case FastFormatKind::FORMAT_G:
+        precision = spec.Precision < 0 ? size_t(FAST_FORMAT_DEFAULT_PRECISION) : precision;
+        size = 8 + precision;
+        break;
+
+      default:
+        return 0;
+      }
+
+      return size > spec.Width ? size : spec.Width;
+    }
+
+    // Compiles a format into the program executed by TryFastFormat. It runs
+    // on the first call at a call site and, for literal formats of Logme
+    // macros, at compile time.
+    constexpr FastFormatBuildResult CompileFastFormat(
+      const char* format
+      , size_t formatLen
+      , FastFormatEntry& entry
+    )
+    {
+      entry.Format = format;
+      entry.Type = FastFormatType::NONE;
+      entry.SpecCount = 0;
+      entry.TailPos = 0;
+      entry.TailLen = 0;
+      entry.BufferSizeHint = 0;
+
+      if (formatLen >= FAST_FORMAT_SCAN_LIMIT)
+        return FastFormatBuildResult::TOO_LONG;
+
+      size_t literalPos = 0;
+      for (size_t i = 0; i < formatLen; i++)
+      {
+        if (format[i] != '%')
+          continue;
+
+        if (entry.SpecCount == FastFormatEntry::MAX_SPECS)
+        {
+          entry.SpecCount = 0;
+          return FastFormatBuildResult::TOO_MANY_SPECS;
+        }
+
+        FormatConversion c{};
+        c.Spec.LiteralPos = (uint16_t)literalPos;
+        c.Spec.LiteralLen = (uint16_t)(i - literalPos);
+
+        i++;
+        FormatParseResult rc = ParseConversion(format, formatLen, i, c);
+        if (rc != FormatParseResult::FAST)
+        {
+          entry.SpecCount = 0;
+          return rc == FormatParseResult::AT_END
+            ? FastFormatBuildResult::SPEC_AT_END
+            : FastFormatBuildResult::UNSUPPORTED_SPEC;
+        }
+
+        entry.Specs[entry.SpecCount++] = c.Spec;
+        literalPos = i + 1;
+      }
+
+      entry.TailPos = (uint16_t)literalPos;
+      entry.TailLen = (uint16_t)(formatLen - literalPos);
+
+      if (entry.SpecCount == 0)
+      {
+        entry.Type = FastFormatType::LITERAL;
+        entry.BufferSizeHint = AlignBufferSizeHint(formatLen + 2);
+        return FastFormatBuildResult::OK;
+      }
+
+      entry.Type = FastFormatType::PROGRAM;
+
+      // The hint is set only when every conversion is bounded
+      size_t maxSize = (size_t)entry.TailLen + 2;
+      for (uint8_t n = 0; n < entry.SpecCount; n++)
+      {
+        size_t maxArg = GetMaxArgTextSize(entry.Specs[n]);
+        if (maxArg == 0)
+          return FastFormatBuildResult::OK;
+
+        maxSize += entry.Specs[n].LiteralLen + maxArg;
+      }
+
+      entry.BufferSizeHint = AlignBufferSizeHint(maxSize);
+      return FastFormatBuildResult::OK;
+    }
+  }
+
+  LOGMELNK bool TryFastFormat(
     Context& context
     , char* buffer
     , size_t bufferSize
@@ -41,4 +547,8 @@ namespace Logme
     , va_list args
     , size_t* outLen = nullptr
   );
+
+  // Installs a program compiled from a literal format as the fast format
+  // entry of a call site that has not formatted anything yet
+  LOGMELNK void SetFastFormat(ContextCache& cache, const FastFormatEntry& entry);
 }
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <iosfwd>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -15,13 +19,47 @@ namespace Logme
 {
   typedef std::function<bool(const std::string&)> TFileInUseCallback;
 
+  // Called after a file was replaced by its compressed copy
+  typedef std::function<void(const std::string&, const std::string&)> TFileReplacedCallback;
+
+  // Format of compressed archive parts. Both are written as a sequence of
+  // independently compressed blocks: a multi-member gzip file or a
+  // multi-frame zstd file, which standard tools read as one stream.
+  enum class CompressionCodec
+  {
+    GZIP,
+    ZSTD,
+  };
+
+  // Totals of all compression managers of the process
+  struct CompressionCounters
+  {
+    std::uint64_t GzipFiles = 0;
+    std::uint64_t ZstdFiles = 0;
+    std::uint64_t FailedFiles = 0;
+    std::uint64_t Blocks = 0;
+    std::uint64_t InputBytes = 0;
+    std::uint64_t OutputBytes = 0;
+
+    // CPU time of all threads spent in the codecs
+    std::uint64_t CpuNanoseconds = 0;
+
+    // Time during which at least one file was being compressed
+    std::uint64_t ActiveNanoseconds = 0;
+
+    std::uint64_t Threads = 0;
+  };
+
   class CompressionManager;
   class CompressionManagerFactory;
+  struct CompressionBlock;
 
   class CompressionRegistration
   {
     CompressionManagerFactory* Factory;
     bool Active;
+    CompressionCodec Codec;
+    int Level;
 
   public:
     LOGMELNK CompressionRegistration();
@@ -40,38 +78,95 @@ namespace Logme
   private:
     friend class CompressionManagerFactory;
 
-    explicit CompressionRegistration(CompressionManagerFactory* factory);
+    CompressionRegistration(
+      CompressionManagerFactory* factory
+      , CompressionCodec codec
+      , int level
+    );
   };
 
   typedef std::unique_ptr<CompressionRegistration> CompressionRegistrationPtr;
 
+  // Compresses completed files on a pool of worker threads. A file is split
+  // into blocks of BLOCK_SIZE bytes; the thread that took the file reads the
+  // blocks and writes the results in order, while all threads of the pool,
+  // including that one, compress queued blocks. Several files rotated at
+  // once are compressed at the same time.
   class CompressionManager
   {
+    struct Job
+    {
+      std::string File;
+      CompressionCodec Codec;
+      int Level;
+    };
+
+    typedef std::shared_ptr<CompressionBlock> CompressionBlockPtr;
+
     bool StopRequested;
-    bool Stopped;
     std::size_t UserCount;
-    std::thread Worker;
+    std::size_t Threads;
+    std::size_t Running;
+    std::vector<std::thread> Workers;
 
     std::mutex Lock;
     std::condition_variable CV;
-    std::vector<std::string> Queue;
+    std::vector<Job> Queue;
+    std::deque<CompressionBlockPtr> Blocks;
+    std::size_t ActiveFiles;
+    std::chrono::steady_clock::time_point ActiveSince;
     TFileInUseCallback TestFileInUse;
+    TFileReplacedCallback FileReplaced;
 
   public:
-    LOGMELNK explicit CompressionManager(TFileInUseCallback testFileInUse);
+    enum
+    {
+      BLOCK_SIZE = 512 * 1024,
+      MAX_THREADS = 64,
+    };
+
+    LOGMELNK explicit CompressionManager(
+      TFileInUseCallback testFileInUse
+      , TFileReplacedCallback fileReplaced = nullptr
+    );
     LOGMELNK ~CompressionManager();
 
-    LOGMELNK void Submit(const std::string& file);
+    LOGMELNK void Submit(
+      const std::string& file
+      , CompressionCodec codec = CompressionCodec::GZIP
+      , int level = 0
+    );
     LOGMELNK void SetUserCount(std::size_t userCount);
+    LOGMELNK void SetThreads(std::size_t threads);
     LOGMELNK void StopWhenQueueEmpty();
     LOGMELNK void SetStopping();
     LOGMELNK void Join();
     LOGMELNK bool IsStopped();
 
+    // Number of threads used when none is configured: half of the CPUs,
+    // from 1 to 4, so that compression does not compete with the
+    // application for every core
+    LOGMELNK static std::size_t GetDefaultThreads();
+
+    LOGMELNK static bool IsCodecSupported(CompressionCodec codec);
+    LOGMELNK static const char* GetExtension(CompressionCodec codec);
+
+    // Highest level accepted by the codec. Level 0 selects its default
+    LOGMELNK static int GetMaxLevel(CompressionCodec codec);
+    LOGMELNK static CompressionCounters GetCounters();
+
   private:
-    void StartWorkerLocked();
+    void StartWorkersLocked();
     void WorkerFunc();
-    void CompressFile(const std::string& file);
+    void CompressFile(const Job& job);
+    bool CompressBlocks(
+      std::istream& input
+      , std::ostream& output
+      , const Job& job
+    );
+    bool WaitBlock(const CompressionBlockPtr& block);
+    void RunBlock(const CompressionBlockPtr& block);
+    void SetFileActive(bool active);
   };
 
   class CompressionManagerFactory
@@ -79,17 +174,33 @@ namespace Logme
     CS Lock;
     std::shared_ptr<CompressionManager> Instance;
     TFileInUseCallback TestFileInUse;
+    TFileReplacedCallback FileReplaced;
     std::size_t UserCount;
+    std::size_t Threads;
     bool Stopping;
 
   public:
     LOGMELNK CompressionManagerFactory();
-    LOGMELNK explicit CompressionManagerFactory(TFileInUseCallback testFileInUse);
+    LOGMELNK explicit CompressionManagerFactory(
+      TFileInUseCallback testFileInUse
+      , TFileReplacedCallback fileReplaced = nullptr
+    );
     LOGMELNK ~CompressionManagerFactory();
 
-    LOGMELNK CompressionRegistrationPtr RegisterUser();
+    LOGMELNK CompressionRegistrationPtr RegisterUser(
+      CompressionCodec codec = CompressionCodec::GZIP
+      , int level = 0
+    );
     LOGMELNK void ReleaseUser();
-    LOGMELNK void Submit(const std::string& file);
+    LOGMELNK void Submit(
+      const std::string& file
+      , CompressionCodec codec = CompressionCodec::GZIP
+      , int level = 0
+    );
+
+    // Size of the thread pool shared by all users; 0 selects
+    // CompressionManager::GetDefaultThreads()
+    LOGMELNK void SetThreads(std::size_t threads);
     LOGMELNK void SetStopping();
   };
 }
@@ -10,17 +10,22 @@
 #include <thread>
 #include <vector>
 
+#include <Logme/File/LogFileIndex.h>
+
 namespace Logme
 {
   typedef std::function<bool(const std::string&)> TTestFileInUse;
 
   // Log retention helper for limiting total disk usage of a log directory.
   // It complements per-file limits by deleting old matching files while
-  // respecting files that are still in use by active backends.
+  // respecting files that are still in use by active backends. The directory
+  // tree is read from the shared LogFileIndex instead of being walked on
+  // every check.
   class DirectorySizeWatchdog
   {
     const std::string& TargetDirectory;
     TTestFileInUse TestInUse;
+    LogFileIndexPtr Index;
 
     std::vector<std::string> Extensions;
     uint64_t MaximalSize;
@@ -32,7 +37,11 @@ namespace Logme
     std::thread Worker;
 
   public:
-    DirectorySizeWatchdog(const std::string& target, TTestFileInUse testInUse);
+    DirectorySizeWatchdog(
+      const std::string& target
+      , TTestFileInUse testInUse
+      , LogFileIndexPtr index
+    );
     ~DirectorySizeWatchdog();
 
     bool Run();
@@ -60,9 +69,9 @@ namespace Logme
     };
 
     void Monitor();
-    bool LimitExeeded(uintmax_t& total_size);
+    bool LimitExeeded(std::vector<LogFileRecord>& files, uintmax_t& total_size);
     
-    std::deque<FileInfo> Collect(uintmax_t total_size);
+    std::deque<FileInfo> Collect(const std::vector<LogFileRecord>& files, uintmax_t total_size);
     void DeleteFiles(const std::deque<FileInfo>& files);
 
     void InsertSorted(
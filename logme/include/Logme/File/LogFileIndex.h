@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Logme/Types.h>
+
+namespace Logme
+{
+  struct LogFileRecord
+  {
+    std::string PathName;
+    std::uint64_t Size = 0;
+    std::filesystem::file_time_type LastWrite;
+
+    // Backend that currently writes the file or nullptr
+    const void* Owner = nullptr;
+  };
+
+  // Index of log files shared by retention components (DirectorySizeWatchdog,
+  // CleanFiles, FileArchivePolicy). A directory is scanned once, on the first
+  // query. After that the index is kept current by FileBackend events
+  // (create, close, archive rename, compression, deletion) and, optionally,
+  // by inotify. Directories are rescanned after RescanInterval as a safety
+  // net for changes made by other processes.
+  class LogFileIndex
+  {
+    struct FileEntry
+    {
+      std::uint64_t Size = 0;
+      std::filesystem::file_time_type LastWrite;
+      const void* Owner = nullptr;
+    };
+
+    struct Directory
+    {
+      std::map<std::string, FileEntry> Files;
+      bool Loaded = false;
+      std::uint64_t LoadTime = 0;
+      int Watch = -1;
+    };
+
+    mutable std::mutex Lock;
+    std::map<std::string, Directory> Directories;
+    std::map<std::string, std::uint64_t> RecursiveRoots;
+    std::uint64_t RescanInterval;
+    std::atomic<std::uint64_t> Scans;
+
+    int WatchFd;
+    std::atomic<bool> WatchStop;
+    std::thread Watcher;
+    std::map<int, std::string> WatchDirs;
+
+  public:
+    enum : std::uint64_t
+    {
+      RESCAN_INTERVAL_DEFAULT = 10ULL * 60 * 1000
+    };
+
+    LOGMELNK LogFileIndex();
+    LOGMELNK ~LogFileIndex();
+
+    LogFileIndex(const LogFileIndex&) = delete;
+    LogFileIndex& operator=(const LogFileIndex&) = delete;
+
+    // Reads size and time of the file and stores them. Owner is the backend
+    // that writes the file now, nullptr for a completed file. A file that
+    // does not exist is removed from the index.
+    LOGMELNK void Update(const std::string& pathName, const void* owner = nullptr);
+    LOGMELNK void Remove(const std::string& pathName);
+    LOGMELNK void Rename(const std::string& from, const std::string& to);
+
+    // Files of one directory. PathName is built from dir as
+    // directory_iterator would do it.
+    LOGMELNK void List(const std::string& dir, std::vector<LogFileRecord>& files);
+
+    // Files of the directory tree under root
+    LOGMELNK void ListRecursive(const std::string& root, std::vector<LogFileRecord>& files);
+
+    LOGMELNK bool Exists(const std::string& pathName);
+
+    // Forgets cached content: the next query scans again
+    LOGMELNK void Invalidate();
+
+    // 0 disables periodic rescans
+    LOGMELNK void SetRescanInterval(std::uint64_t ms);
+    LOGMELNK std::uint64_t GetRescanInterval() const;
+
+    // Keeps loaded directories current with inotify. Returns false where
+    // this is not supported.
+    LOGMELNK bool EnableWatch(bool enable);
+    LOGMELNK bool IsWatchEnabled() const;
+
+    // Number of directory scans done so far
+    LOGMELNK std::uint64_t GetScanCount() const;
+
+  private:
+    static std::string DirectoryKey(const std::filesystem::path& dir);
+    bool IsFreshLocked(const Directory& d, std::uint64_t now) const;
+    void LoadDirectory(const std::string& key);
+    void LoadTree(const std::string& key);
+    void MergeLocked(const std::string& key, std::map<std::string, FileEntry>& files, std::uint64_t now);
+    void AddWatchLocked(const std::string& key, Directory& d);
+    void UpdateFile(const std::string& pathName, const void* owner, bool keepOwner);
+    void WatchProc();
+  };
+
+  typedef std::shared_ptr<LogFileIndex> LogFileIndexPtr;
+}
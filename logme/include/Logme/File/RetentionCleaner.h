@@ -5,6 +5,7 @@
 #include <regex>
 #include <string>
 
+#include <Logme/File/LogFileIndex.h>
 #include <Logme/Types.h>
 
 namespace Logme
@@ -21,10 +22,13 @@ namespace Logme
     }
   };
 
+  // Files are taken from index when it is set, otherwise the directory of
+  // keep is scanned
   LOGMELNK void CleanFiles(
     const std::regex& pattern
     , const std::string& keep
     , const RetentionOptions& options
+    , LogFileIndex* index = nullptr
   );
 
 }
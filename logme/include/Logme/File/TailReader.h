@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <Logme/Types.h>
+
+namespace Logme
+{
+  // Reads the end of a log file without reading the whole file. The file is
+  // read backwards in blocks with pread() and newlines are located with
+  // memrchr(), so the cost depends on the size of the returned suffix only.
+  //
+  // ReadLines() remembers the positions of the last newlines of recently
+  // read files (one entry per path, so rotated parts are cached separately).
+  // A repeated request for a file that only grew scans just the appended
+  // bytes; a file that was replaced or truncated is scanned again.
+  class TailReader
+  {
+    struct Entry
+    {
+      std::uint64_t FileId = 0;
+      std::uint64_t Size = 0;
+      std::uint64_t LastUse = 0;
+      size_t MaxLines = 0;
+
+      // Offsets of the last MaxLines + 1 newlines, ascending
+      std::deque<std::uint64_t> Newlines;
+
+      // Newlines holds every newline of the file
+      bool Complete = false;
+    };
+
+    std::mutex Lock;
+    std::map<std::string, Entry> Entries;
+    std::uint64_t UseCounter;
+
+    enum
+    {
+      MAX_ENTRIES = 8,
+    };
+
+  public:
+    enum
+    {
+      BLOCK_SIZE = 64 * 1024,
+    };
+
+    LOGMELNK TailReader();
+
+    // Reads the last maxLines lines of a file. maxLines == 0 reads the whole
+    // file. A trailing newline does not start an extra empty line. Returns
+    // 0 or an errno value.
+    LOGMELNK int ReadLines(
+      const std::string& pathName
+      , size_t maxLines
+      , std::string& content
+    );
+
+    // Reads at most maxBytes from the end of a file, starting at the first
+    // line boundary inside that range. Returns 0 or an errno value.
+    LOGMELNK static int ReadBytes(
+      const std::string& pathName
+      , std::uint64_t maxBytes
+      , std::string& content
+    );
+
+    // Position of the last c in p[0..size), or nullptr
+    LOGMELNK static const char* FindLast(const char* p, size_t size, char c);
+
+  private:
+    bool ScanBackward(int fd, Entry& entry);
+    bool ScanAppended(int fd, Entry& entry, std::uint64_t size);
+  };
+}
@@ -5,6 +5,7 @@
 #include <string>
 
 #include <Logme/CritSection.h>
+#include <Logme/File/TailReader.h>
 
 #if !defined(_WIN32) && !defined(__sun__)
 struct iovec;
@@ -52,5 +53,8 @@ namespace Logme
     bool NeedUnlock;
     time_t WriteTimeAtOpen;
     bool SuppressPathNotFoundOpenError;
+
+    // Last lines of the current file and rotated parts for Read(maxLines)
+    TailReader Tail;
   };
 }
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 namespace Logme
 {
   enum class LogStatisticsSort
@@ -15,4 +19,42 @@ namespace Logme
     WRITE_ERRORS,
     DROPPED_BYTES
   };
+
+  enum class LogLatencySort
+  {
+    TOTAL,
+    FORMAT,
+    APPLY,
+    DISPLAY
+  };
+
+  // Durations in nanoseconds
+  struct LogLatencyPercentiles
+  {
+    uint64_t Count = 0;
+    uint64_t P50 = 0;
+    uint64_t P99 = 0;
+    uint64_t P999 = 0;
+    uint64_t Max = 0;
+  };
+
+  struct LogBackendLatency
+  {
+    std::string Channel;
+    std::string BackendType;
+    LogLatencyPercentiles Display;
+  };
+
+  struct LogSiteLatency
+  {
+    std::string File;
+    std::string Method;
+    std::string Format;
+    int Line = 0;
+
+    LogLatencyPercentiles FormatTime;   // printf formatting of the message
+    LogLatencyPercentiles ApplyTime;    // Context::Apply calls of all backends
+    LogLatencyPercentiles TotalTime;    // formatting and delivery to backends
+    std::vector<LogBackendLatency> Backends;
+  };
 }
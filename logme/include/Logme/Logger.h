@@ -5,10 +5,12 @@
     #include <fmt/format.h>
     #define LOGME_VFORMAT fmt::vformat
     #define LOGME_MAKE_FORMAT_ARGS fmt::make_format_args
+    #define LOGME_FORMAT_ARGS fmt::format_args
   #else
     #include <format>
     #define LOGME_VFORMAT std::vformat
     #define LOGME_MAKE_FORMAT_ARGS std::make_format_args
+    #define LOGME_FORMAT_ARGS std::format_args
   #endif
 #endif
 
@@ -32,6 +34,7 @@
 #include <Logme/File/CompressionManager.h>
 #include <Logme/File/DirectorySizeWatchdog.h>
 #include <Logme/File/FileManagerFactory.h>
+#include <Logme/File/LogFileIndex.h>
 #include <Logme/Obfuscate.h>
 #include <Logme/LogStatistics.h>
 #include <Logme/Stream.h>
@@ -54,6 +57,7 @@ namespace Logme
 #endif
   struct ControlSslContext;
   class ControlDiscovery;
+  class ControlServer;
   LOGMELNK extern bool ShutdownCalled;
 
 
@@ -69,6 +73,7 @@ namespace Logme
     ChannelPtr Default;
     
     std::string HomeDirectory;
+    LogFileIndexPtr FileIndex;
     DirectorySizeWatchdog HomeDirectoryWatchDog;
 
     std::vector<uint64_t> BlockedSubsystems;
@@ -100,10 +105,90 @@ namespace Logme
     void PublishSubsystemLevelSnapshot();
     void ReclaimSubsystemLevelSnapshots();
 
+    // Read-only copy of BlockedSubsystems/AllowedSubsystems checked by DoLog.
+    // nullptr is published while both lists are empty.
+    struct SubsystemFilterSnapshot
+    {
+      std::vector<uint64_t> Blocked;
+      std::vector<uint64_t> Allowed;
+    };
+
+    static constexpr std::size_t SUBSYSTEM_FILTER_SNAPSHOT_LIMIT = 64;
+
+    std::vector<std::unique_ptr<SubsystemFilterSnapshot>> SubsystemFilterSnapshots;
+    std::atomic<const SubsystemFilterSnapshot*> ActiveSubsystemFilterSnapshot;
+    std::atomic<bool> SubsystemFilterSnapshotReclamation;
+    std::atomic<std::uint32_t> SubsystemFilterSnapshotReaders;
+
+    const SubsystemFilterSnapshot* AcquireSubsystemFilterSnapshot(
+      bool& readerAcquired
+    );
+    void ReleaseSubsystemFilterSnapshot();
+    void PublishSubsystemFilterSnapshot();
+    void ReclaimSubsystemFilterSnapshots();
+    bool IsSubsystemFiltered(uint64_t subsystem);
+
+    // Read-only copy of Channels used for lookups by name. It is an
+    // open-addressing table keyed by a precomputed hash of the name, so
+    // readers neither lock DataLock nor build a std::string key.
+    struct ChannelLookupSlot
+    {
+      uint64_t Hash;
+      std::string Name;
+      ChannelPtr Object;
+    };
+
+    struct ChannelLookupSnapshot
+    {
+      std::vector<ChannelLookupSlot> Slots;
+      std::size_t Mask;
+    };
+
+    std::vector<std::unique_ptr<ChannelLookupSnapshot>> ChannelLookupSnapshots;
+    std::atomic<const ChannelLookupSnapshot*> ActiveChannelLookupSnapshot;
+    std::atomic<bool> ChannelLookupSnapshotReclamation;
+    std::atomic<std::uint32_t> ChannelLookupSnapshotReaders;
+
+    // Bumped on every change of Channels. Call sites cache resolved channel
+    // pointers in ContextCache together with the generation they were
+    // resolved at.
+    std::atomic<std::uint64_t> ChannelGeneration;
+
+    const ChannelLookupSnapshot* AcquireChannelLookupSnapshot();
+    void ReleaseChannelLookupSnapshot();
+    void PublishChannelLookupSnapshot();
+    void ReclaimChannelLookupSnapshots();
+    ChannelPtr FindChannel(const char* name);
+    Channel* ResolveChannel(Context& context);
+
+    // Captures printf arguments and displays the record without formatting
+    // it when every backend of ch formats messages on its own worker.
+    enum { DEFERRED_ARGS_SIZE = 1024 };
+    bool TryDisplayDeferred(
+      Context& context
+      , Channel* ch
+      , const char* format
+      , va_list args
+    );
+
 #ifndef LOGME_DISABLE_STD_FORMAT
+    // Stack buffer used by StdFormat overloads. Longer messages are
+    // formatted into Context::Storage.
+    enum { STD_FORMAT_BUFFER_SIZE = 1024 };
+
     bool ShouldSkipStdFormat(
       const Context& context
       , const ChannelPtr& ch
+      , const SID* sid
+    )
+    {
+      return ShouldSkipStdFormatChannel(context, ch.get(), sid);
+    }
+
+    bool ShouldSkipStdFormatChannel(
+      const Context& context
+      , Channel* ch
+      , const SID* sid
     )
     {
       if (
@@ -114,10 +199,11 @@ namespace Logme
         return false;
       }
 
+      uint64_t subsystem = sid ? sid->Name : context.Subsystem.Name;
       if (
            HasSubsystemLevelOverrides()
         && (
-             context.Subsystem.Name != 0
+             subsystem != 0
           || IsSubsystemDefinedForCurrentThread()
         )
       )
@@ -127,6 +213,22 @@ namespace Logme
 
       return ch->IsOutputActive(context) == false;
     }
+
+    // id == nullptr selects the thread channel or the channel of the context.
+    // Channels that do not exist yet are never skipped because DoLog creates them.
+    LOGMELNK bool ShouldSkipStdFormatID(
+      const Context& context
+      , const ID* id
+      , const SID* sid
+    );
+
+    LOGMELNK const char* FormatStd(
+      const Context& context
+      , char* buffer
+      , std::size_t size
+      , const char* fmt
+      , LOGME_FORMAT_ARGS args
+    );
 #endif
 
     bool BlockReportedSubsystems;
@@ -156,9 +258,7 @@ namespace Logme
     ControlSslContext* ControlSsl;
     std::string ControlDiscoveryNamePrefix;
     std::unique_ptr<ControlDiscovery> ControlDiscoveryServer;
-    
-    typedef std::shared_ptr<std::thread> ThreadPtr;
-    ThreadPtr ListenerThread;
+    std::unique_ptr<ControlServer> ControlServerLoop;
 
     ChannelArray ToDelete;
     std::uint64_t LastDoAutodelete;
@@ -166,28 +266,13 @@ namespace Logme
 
     bool EnableVTMode;
 
-    struct ControlThread
-    {
-      ThreadPtr Thread;
-      bool Stopped;
-      bool Authorized;
-
-      ControlThread()
-        : Stopped(false)
-        , Authorized(false)
-      {
-      }
-    };
-
-    typedef std::map<int, ControlThread> ThreadMap;
-    ThreadMap ControlThreads;
-
     ObfKey Key;
     bool Obfuscate;
 
     TracePoint* TracePoints;
     std::unique_ptr<LogStatisticsCollector> LogStatistics;
     std::atomic<LogStatisticsCollector*> ActiveLogStatistics;
+    std::atomic<bool> LogStatisticsTiming;
 
   public:
     TCondition Condition;
@@ -543,8 +628,12 @@ namespace Logme
       if (ShutdownCalled)
         return;
 
-      std::string out = LOGME_VFORMAT(fmt, LOGME_MAKE_FORMAT_ARGS(args...));
-      Log(context, id, "%s", out.c_str());
+      if (ShouldSkipStdFormatID(context, &id, nullptr))
+        return;
+
+      char buffer[STD_FORMAT_BUFFER_SIZE];
+      const char* text = FormatStd(context, buffer, sizeof(buffer), fmt, LOGME_MAKE_FORMAT_ARGS(args...));
+      Log(context, id, "%s", text);
     }
 
     template<typename... Args>
@@ -553,11 +642,12 @@ namespace Logme
       if (ShutdownCalled)
         return;
 
-      if (ShouldSkipStdFormat(context, ch))
+      if (ShouldSkipStdFormat(context, ch, nullptr))
         return;
 
-      std::string out = LOGME_VFORMAT(fmt, LOGME_MAKE_FORMAT_ARGS(args...));
-      Log(context, ch, "%s", out.c_str());
+      char buffer[STD_FORMAT_BUFFER_SIZE];
+      const char* text = FormatStd(context, buffer, sizeof(buffer), fmt, LOGME_MAKE_FORMAT_ARGS(args...));
+      Log(context, ch, "%s", text);
     }
 
     template<typename... Args>
@@ -573,8 +663,12 @@ namespace Logme
       if (ShutdownCalled)
         return;
 
-      std::string out = LOGME_VFORMAT(fmt, LOGME_MAKE_FORMAT_ARGS(args...));
-      Log(context, id, sid, "%s", out.c_str());
+      if (ShouldSkipStdFormatID(context, &id, &sid))
+        return;
+
+      char buffer[STD_FORMAT_BUFFER_SIZE];
+      const char* text = FormatStd(context, buffer, sizeof(buffer), fmt, LOGME_MAKE_FORMAT_ARGS(args...));
+      Log(context, id, sid, "%s", text);
     }
 
     template<typename... Args>
@@ -590,8 +684,12 @@ namespace Logme
       if (ShutdownCalled)
         return;
 
-      std::string out = LOGME_VFORMAT(fmt, LOGME_MAKE_FORMAT_ARGS(args...));
-      Log(context, ch, sid, "%s", out.c_str());
+      if (ShouldSkipStdFormat(context, ch, &sid))
+        return;
+
+      char buffer[STD_FORMAT_BUFFER_SIZE];
+      const char* text = FormatStd(context, buffer, sizeof(buffer), fmt, LOGME_MAKE_FORMAT_ARGS(args...));
+      Log(context, ch, sid, "%s", text);
     }
 #endif
     LOGMELNK void Log(const Context& context, const ID& id, const char* format, ...);
@@ -604,8 +702,15 @@ namespace Logme
     template<typename... Args>
     void Log(const Context& context, const StdFormat*, Override& ovr, const char* fmt, Args&&... args)
     {
-      std::string out = LOGME_VFORMAT(fmt, LOGME_MAKE_FORMAT_ARGS(args...));
-      Log(context, ovr, "%s", out.c_str());
+      if (ShutdownCalled)
+        return;
+
+      if (ShouldSkipStdFormatID(context, nullptr, nullptr))
+        return;
+
+      char buffer[STD_FORMAT_BUFFER_SIZE];
+      const char* text = FormatStd(context, buffer, sizeof(buffer), fmt, LOGME_MAKE_FORMAT_ARGS(args...));
+      Log(context, ovr, "%s", text);
     }
 
     template<typename... Args>
@@ -614,8 +719,12 @@ namespace Logme
       if (ShutdownCalled)
         return;
 
-      std::string out = LOGME_VFORMAT(fmt, LOGME_MAKE_FORMAT_ARGS(args...));
-      Log(context, ovr, sid, "%s", out.c_str());
+      if (ShouldSkipStdFormatID(context, nullptr, &sid))
+        return;
+
+      char buffer[STD_FORMAT_BUFFER_SIZE];
+      const char* text = FormatStd(context, buffer, sizeof(buffer), fmt, LOGME_MAKE_FORMAT_ARGS(args...));
+      Log(context, ovr, sid, "%s", text);
     }
 #endif
     LOGMELNK void Log(const Context& context, Override& ovr, const char* format, ...);
@@ -628,8 +737,12 @@ namespace Logme
       if (ShutdownCalled)
         return;
 
-      std::string out = LOGME_VFORMAT(fmt, LOGME_MAKE_FORMAT_ARGS(args...));
-      Log(context, ovr, id, "%s", out.c_str());
+      if (ShouldSkipStdFormatID(context, &id, nullptr))
+        return;
+
+      char buffer[STD_FORMAT_BUFFER_SIZE];
+      const char* text = FormatStd(context, buffer, sizeof(buffer), fmt, LOGME_MAKE_FORMAT_ARGS(args...));
+      Log(context, ovr, id, "%s", text);
     }
 
     template<typename... Args>
@@ -638,11 +751,12 @@ namespace Logme
       if (ShutdownCalled)
         return;
 
-      if (ShouldSkipStdFormat(context, ch))
+      if (ShouldSkipStdFormat(context, ch, nullptr))
         return;
 
-      std::string out = LOGME_VFORMAT(fmt, LOGME_MAKE_FORMAT_ARGS(args...));
-      Log(context, ovr, ch, "%s", out.c_str());
+      char buffer[STD_FORMAT_BUFFER_SIZE];
+      const char* text = FormatStd(context, buffer, sizeof(buffer), fmt, LOGME_MAKE_FORMAT_ARGS(args...));
+      Log(context, ovr, ch, "%s", text);
     }
 
     template<typename... Args>
@@ -651,8 +765,12 @@ namespace Logme
       if (ShutdownCalled)
         return;
 
-      std::string out = LOGME_VFORMAT(fmt, LOGME_MAKE_FORMAT_ARGS(args...));
-      Log(context, ovr, id, sid, "%s", out.c_str());
+      if (ShouldSkipStdFormatID(context, &id, &sid))
+        return;
+
+      char buffer[STD_FORMAT_BUFFER_SIZE];
+      const char* text = FormatStd(context, buffer, sizeof(buffer), fmt, LOGME_MAKE_FORMAT_ARGS(args...));
+      Log(context, ovr, id, sid, "%s", text);
     }
 
     template<typename... Args>
@@ -661,8 +779,12 @@ namespace Logme
       if (ShutdownCalled)
         return;
 
-      std::string out = LOGME_VFORMAT(fmt, LOGME_MAKE_FORMAT_ARGS(args...));
-      Log(context, ovr, ch, sid, "%s", out.c_str());
+      if (ShouldSkipStdFormat(context, ch, &sid))
+        return;
+
+      char buffer[STD_FORMAT_BUFFER_SIZE];
+      const char* text = FormatStd(context, buffer, sizeof(buffer), fmt, LOGME_MAKE_FORMAT_ARGS(args...));
+      Log(context, ovr, ch, sid, "%s", text);
     }
 
     template<typename... Args>
@@ -671,8 +793,12 @@ namespace Logme
       if (ShutdownCalled)
         return;
 
-      std::string out = LOGME_VFORMAT(fmt, LOGME_MAKE_FORMAT_ARGS(args...));
-      Log(context, id, ovr, "%s", out.c_str());
+      if (ShouldSkipStdFormatID(context, &id, nullptr))
+        return;
+
+      char buffer[STD_FORMAT_BUFFER_SIZE];
+      const char* text = FormatStd(context, buffer, sizeof(buffer), fmt, LOGME_MAKE_FORMAT_ARGS(args...));
+      Log(context, id, ovr, "%s", text);
     }
 
     template<typename... Args>
@@ -681,11 +807,12 @@ namespace Logme
       if (ShutdownCalled)
         return;
 
-      if (ShouldSkipStdFormat(context, ch))
+      if (ShouldSkipStdFormat(context, ch, nullptr))
         return;
 
-      std::string out = LOGME_VFORMAT(fmt, LOGME_MAKE_FORMAT_ARGS(args...));
-      Log(context, ch, ovr, "%s", out.c_str());
+      char buffer[STD_FORMAT_BUFFER_SIZE];
+      const char* text = FormatStd(context, buffer, sizeof(buffer), fmt, LOGME_MAKE_FORMAT_ARGS(args...));
+      Log(context, ch, ovr, "%s", text);
     }
 #endif
     LOGMELNK void Log(const Context& context, Override& ovr, const ID& id, const char* format, ...);
@@ -702,8 +829,12 @@ namespace Logme
       if (ShutdownCalled)
         return;
 
-      std::string out = LOGME_VFORMAT(fmt, LOGME_MAKE_FORMAT_ARGS(args...));
-      Log(context, "%s", out.c_str());
+      if (ShouldSkipStdFormatID(context, nullptr, nullptr))
+        return;
+
+      char buffer[STD_FORMAT_BUFFER_SIZE];
+      const char* text = FormatStd(context, buffer, sizeof(buffer), fmt, LOGME_MAKE_FORMAT_ARGS(args...));
+      Log(context, "%s", text);
     }
 #endif
     LOGMELNK void Log(const Context& context, const char* format, ...);
@@ -859,6 +990,25 @@ namespace Logme
       return ActiveLogStatistics.load(std::memory_order_relaxed);
     }
 
+    /// <summary>
+    /// Enables per-site latency histograms while statistics collection is
+    /// active: message formatting, Context::Apply, each backend Display and
+    /// the whole call are timed for every record.
+    /// </summary>
+    LOGMELNK void SetLogStatisticsTiming(bool enable);
+
+    /// <summary>
+    /// Returns true if latency timing is enabled.
+    /// </summary>
+    LOGMELNK bool IsLogStatisticsTimingEnabled() const;
+
+    LOGMELNK void RecordLogBackendTiming(
+      Context& context
+      , Channel* channel
+      , Backend* backend
+      , uint64_t ticks
+    );
+
     LOGMELNK void RecordLogBackendOutput(
       Context& context
       , Channel* channel
@@ -932,6 +1082,20 @@ namespace Logme
       , size_t limit
     );
 
+    /// <summary>
+    /// Returns log sites with p50/p99/p999 latency of formatting, Context::Apply,
+    /// backend Display and the whole call. Requires SetLogStatisticsTiming(true).
+    /// </summary>
+    LOGMELNK std::string DumpLogStatisticsLatency(
+      LogLatencySort sort
+      , size_t limit
+    );
+
+    /// <summary>
+    /// Returns latency percentiles of all timed log sites.
+    /// </summary>
+    LOGMELNK std::vector<LogSiteLatency> GetLogStatisticsLatency();
+
     LOGMELNK void DeleteAllChannels();
 
     /// <summary>
@@ -1028,6 +1192,11 @@ namespace Logme
     /// </summary>
     LOGMELNK CompressionManagerFactory& GetCompressionManagerFactory();
 
+    /// <summary>
+    /// Returns index of log files shared by retention, archive naming and the home directory watchdog.
+    /// </summary>
+    LOGMELNK const LogFileIndexPtr& GetLogFileIndex() const;
+
     /// <summary>
     /// Enables or disables virtual terminal mode support.
     /// </summary>
@@ -1065,11 +1234,17 @@ namespace Logme
     bool CreateChannels(ChannelConfigArray& arr);
     void ReplaceChannels(ChannelConfigArray& arr);
 
-    void ControlListener(int listenSocket);
-    void ControlHandler(int socket);
+    std::string ControlRequest(const std::string& command, bool& authorized);
 
     void DoAutodelete(bool force);
     void HandleFatal();
+
+    void RecordLogTiming(
+      LogSiteStatistics* site
+      , uint64_t formatTicks
+      , uint64_t applyTicks
+      , uint64_t totalTicks
+    );
     void FreeControlSsl();
 
   public:
@@ -1096,6 +1271,8 @@ namespace Logme
     static bool CommandOverview(StringArray& arr, std::string& response);
 
     static bool CommandLogs(StringArray& arr, std::string& response);
+
+    static bool CommandFollow(StringArray& arr, std::string& response);
   };
 
   typedef std::shared_ptr<Logger> LoggerPtr;
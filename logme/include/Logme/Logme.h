@@ -47,7 +47,7 @@
 #ifdef _MSC_VER
   #define Logme_If(condition, logger, level, ...) \
     if (static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); (condition)) \
-      Logme::Detail::Dispatch( \
+      Logme::Detail::Dispatch<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
         logger \
         , LOGME_JOIN(_logme_ctx_, __LINE__) \
         , level \
@@ -60,7 +60,7 @@
       )
   #define Logme_Ifg(condition, logger, level, ...) \
     if (static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); (condition)) \
-      Logme::Detail::Dispatch( \
+      Logme::Detail::Dispatch<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
         logger \
         , LOGME_JOIN(_logme_ctx_, __LINE__) \
         , level \
@@ -74,7 +74,7 @@
 #else
   #define Logme_If(condition, logger, level, ...) \
     if (static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); (condition)) \
-      Logme::Detail::Dispatch( \
+      Logme::Detail::Dispatch<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
         logger \
         , LOGME_JOIN(_logme_ctx_, __LINE__) \
         , level \
@@ -87,7 +87,7 @@
       )
   #define Logme_Ifg(condition, logger, level, ...) \
     if (static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); (condition)) \
-      Logme::Detail::Dispatch( \
+      Logme::Detail::Dispatch<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
         logger \
         , LOGME_JOIN(_logme_ctx_, __LINE__) \
         , level \
@@ -229,7 +229,7 @@
 #ifdef _MSC_VER
   #define Logme_CollapseAt(level, limit, ...) \
     if (static Logme::CollapseContextCache LOGME_JOIN(_logme_ctx_, __LINE__)(limit); Logme::Instance->Condition() && LOGME_WOULD_LOG_ARGS(Logme::Instance.get(), level, &SUBSID, ## __VA_ARGS__)) \
-      Logme::Detail::DispatchCollapse( \
+      Logme::Detail::DispatchCollapse<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
         Logme::Instance \
         , LOGME_JOIN(_logme_ctx_, __LINE__) \
         , level \
@@ -242,7 +242,7 @@
       )
   #define Logme_CollapseIgnoreAt(level, ignoreRegex, limit, ...) \
     if (static Logme::CollapseContextCache LOGME_JOIN(_logme_ctx_, __LINE__)(ignoreRegex, limit); Logme::Instance->Condition() && LOGME_WOULD_LOG_ARGS(Logme::Instance.get(), level, &SUBSID, ## __VA_ARGS__)) \
-      Logme::Detail::DispatchCollapse( \
+      Logme::Detail::DispatchCollapse<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
         Logme::Instance \
         , LOGME_JOIN(_logme_ctx_, __LINE__) \
         , level \
@@ -255,7 +255,7 @@
       )
   #define Logme_CollapseEveryAt(level, intervalMs, ...) \
     if (static Logme::CollapseContextCache LOGME_JOIN(_logme_ctx_, __LINE__)(Logme::CollapseEveryTag(), intervalMs); Logme::Instance->Condition() && LOGME_WOULD_LOG_ARGS(Logme::Instance.get(), level, &SUBSID, ## __VA_ARGS__)) \
-      Logme::Detail::DispatchCollapse( \
+      Logme::Detail::DispatchCollapse<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
         Logme::Instance \
         , LOGME_JOIN(_logme_ctx_, __LINE__) \
         , level \
@@ -268,7 +268,33 @@
       )
   #define Logme_CollapseIgnoreEveryAt(level, ignoreRegex, intervalMs, ...) \
     if (static Logme::CollapseContextCache LOGME_JOIN(_logme_ctx_, __LINE__)(ignoreRegex, Logme::CollapseEveryTag(), intervalMs); Logme::Instance->Condition() && LOGME_WOULD_LOG_ARGS(Logme::Instance.get(), level, &SUBSID, ## __VA_ARGS__)) \
-      Logme::Detail::DispatchCollapse( \
+      Logme::Detail::DispatchCollapse<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
+        Logme::Instance \
+        , LOGME_JOIN(_logme_ctx_, __LINE__) \
+        , level \
+        , &CH \
+        , &SUBSID \
+        , __FUNCTION__ \
+        , __FILE__ \
+        , __LINE__ \
+        , ## __VA_ARGS__ \
+      )
+  #define Logme_CollapseKeysAt(level, keys, ignore, limit, ...) \
+    if (static Logme::CollapseContextCache LOGME_JOIN(_logme_ctx_, __LINE__)(ignore, limit, keys); Logme::Instance->Condition() && LOGME_WOULD_LOG_ARGS(Logme::Instance.get(), level, &SUBSID, ## __VA_ARGS__)) \
+      Logme::Detail::DispatchCollapse<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
+        Logme::Instance \
+        , LOGME_JOIN(_logme_ctx_, __LINE__) \
+        , level \
+        , &CH \
+        , &SUBSID \
+        , __FUNCTION__ \
+        , __FILE__ \
+        , __LINE__ \
+        , ## __VA_ARGS__ \
+      )
+  #define Logme_CollapseKeysEveryAt(level, keys, ignore, intervalMs, ...) \
+    if (static Logme::CollapseContextCache LOGME_JOIN(_logme_ctx_, __LINE__)(ignore, Logme::CollapseEveryTag(), intervalMs, keys); Logme::Instance->Condition() && LOGME_WOULD_LOG_ARGS(Logme::Instance.get(), level, &SUBSID, ## __VA_ARGS__)) \
+      Logme::Detail::DispatchCollapse<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
         Logme::Instance \
         , LOGME_JOIN(_logme_ctx_, __LINE__) \
         , level \
@@ -282,7 +308,7 @@
 #else
   #define Logme_CollapseAt(level, limit, ...) \
     if (static Logme::CollapseContextCache LOGME_JOIN(_logme_ctx_, __LINE__)(limit); Logme::Instance->Condition() && LOGME_WOULD_LOG_ARGS(Logme::Instance.get(), level, &SUBSID, __VA_ARGS__)) \
-      Logme::Detail::DispatchCollapse( \
+      Logme::Detail::DispatchCollapse<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
         Logme::Instance \
         , LOGME_JOIN(_logme_ctx_, __LINE__) \
         , level \
@@ -295,7 +321,7 @@
       )
   #define Logme_CollapseIgnoreAt(level, ignoreRegex, limit, ...) \
     if (static Logme::CollapseContextCache LOGME_JOIN(_logme_ctx_, __LINE__)(ignoreRegex, limit); Logme::Instance->Condition() && LOGME_WOULD_LOG_ARGS(Logme::Instance.get(), level, &SUBSID, __VA_ARGS__)) \
-      Logme::Detail::DispatchCollapse( \
+      Logme::Detail::DispatchCollapse<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
         Logme::Instance \
         , LOGME_JOIN(_logme_ctx_, __LINE__) \
         , level \
@@ -308,7 +334,7 @@
       )
   #define Logme_CollapseEveryAt(level, intervalMs, ...) \
     if (static Logme::CollapseContextCache LOGME_JOIN(_logme_ctx_, __LINE__)(Logme::CollapseEveryTag(), intervalMs); Logme::Instance->Condition() && LOGME_WOULD_LOG_ARGS(Logme::Instance.get(), level, &SUBSID, __VA_ARGS__)) \
-      Logme::Detail::DispatchCollapse( \
+      Logme::Detail::DispatchCollapse<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
         Logme::Instance \
         , LOGME_JOIN(_logme_ctx_, __LINE__) \
         , level \
@@ -321,7 +347,33 @@
       )
   #define Logme_CollapseIgnoreEveryAt(level, ignoreRegex, intervalMs, ...) \
     if (static Logme::CollapseContextCache LOGME_JOIN(_logme_ctx_, __LINE__)(ignoreRegex, Logme::CollapseEveryTag(), intervalMs); Logme::Instance->Condition() && LOGME_WOULD_LOG_ARGS(Logme::Instance.get(), level, &SUBSID, __VA_ARGS__)) \
-      Logme::Detail::DispatchCollapse( \
+      Logme::Detail::DispatchCollapse<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
+        Logme::Instance \
+        , LOGME_JOIN(_logme_ctx_, __LINE__) \
+        , level \
+        , &CH \
+        , &SUBSID \
+        , __FUNCTION__ \
+        , __FILE__ \
+        , __LINE__ \
+        , __VA_ARGS__ \
+      )
+  #define Logme_CollapseKeysAt(level, keys, ignore, limit, ...) \
+    if (static Logme::CollapseContextCache LOGME_JOIN(_logme_ctx_, __LINE__)(ignore, limit, keys); Logme::Instance->Condition() && LOGME_WOULD_LOG_ARGS(Logme::Instance.get(), level, &SUBSID, __VA_ARGS__)) \
+      Logme::Detail::DispatchCollapse<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
+        Logme::Instance \
+        , LOGME_JOIN(_logme_ctx_, __LINE__) \
+        , level \
+        , &CH \
+        , &SUBSID \
+        , __FUNCTION__ \
+        , __FILE__ \
+        , __LINE__ \
+        , __VA_ARGS__ \
+      )
+  #define Logme_CollapseKeysEveryAt(level, keys, ignore, intervalMs, ...) \
+    if (static Logme::CollapseContextCache LOGME_JOIN(_logme_ctx_, __LINE__)(ignore, Logme::CollapseEveryTag(), intervalMs, keys); Logme::Instance->Condition() && LOGME_WOULD_LOG_ARGS(Logme::Instance.get(), level, &SUBSID, __VA_ARGS__)) \
+      Logme::Detail::DispatchCollapse<LOGME_FORMAT_ARG(__VA_ARGS__)>( \
         Logme::Instance \
         , LOGME_JOIN(_logme_ctx_, __LINE__) \
         , level \
@@ -345,7 +397,7 @@
 /// <summary>
 /// Writes DEBUG log message and collapses repeated messages ignoring substrings matched by a regular expression.
 /// </summary>
-/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages.</param>
+/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages, or a Logme::CollapseNormalizer value.</param>
 /// <param name="limit">Number of repeated messages to skip before writing the collapsed summary.</param>
 /// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
 #define LogmeD_CollapseIgnore(ignoreRegex, limit, ...) \
@@ -362,12 +414,32 @@
 /// <summary>
 /// Writes DEBUG log message and collapses repeated messages using a time interval while ignoring substrings matched by a regular expression.
 /// </summary>
-/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages.</param>
+/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages, or a Logme::CollapseNormalizer value.</param>
 /// <param name="intervalMs">Minimum interval between repeated messages in milliseconds.</param>
 /// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
 #define LogmeD_CollapseIgnoreEvery(ignoreRegex, intervalMs, ...) \
   Logme_CollapseIgnoreEveryAt(Logme::Level::LEVEL_DEBUG, ignoreRegex, intervalMs, ## __VA_ARGS__)
 
+/// <summary>
+/// Writes DEBUG log message and collapses repeats of each of the last distinct messages of the call site.
+/// </summary>
+/// <param name="keys">Number of distinct messages tracked by the call site (1..16).</param>
+/// <param name="ignore">Regular expression, Logme::CollapseNormalizer value or nullptr.</param>
+/// <param name="limit">Number of repeated messages to skip before writing the collapsed summary.</param>
+/// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
+#define LogmeD_CollapseKeys(keys, ignore, limit, ...) \
+  Logme_CollapseKeysAt(Logme::Level::LEVEL_DEBUG, keys, ignore, limit, ## __VA_ARGS__)
+
+/// <summary>
+/// Writes DEBUG log message and collapses repeats of each of the last distinct messages of the call site using a time interval.
+/// </summary>
+/// <param name="keys">Number of distinct messages tracked by the call site (1..16).</param>
+/// <param name="ignore">Regular expression, Logme::CollapseNormalizer value or nullptr.</param>
+/// <param name="intervalMs">Minimum interval between repeated messages in milliseconds.</param>
+/// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
+#define LogmeD_CollapseKeysEvery(keys, ignore, intervalMs, ...) \
+  Logme_CollapseKeysEveryAt(Logme::Level::LEVEL_DEBUG, keys, ignore, intervalMs, ## __VA_ARGS__)
+
 /// <summary>
 /// Writes INFO log message and collapses repeated messages using the formatted message text as the repeat key.
 /// </summary>
@@ -379,7 +451,7 @@
 /// <summary>
 /// Writes INFO log message and collapses repeated messages ignoring substrings matched by a regular expression.
 /// </summary>
-/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages.</param>
+/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages, or a Logme::CollapseNormalizer value.</param>
 /// <param name="limit">Number of repeated messages to skip before writing the collapsed summary.</param>
 /// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
 #define LogmeI_CollapseIgnore(ignoreRegex, limit, ...) \
@@ -396,12 +468,32 @@
 /// <summary>
 /// Writes INFO log message and collapses repeated messages using a time interval while ignoring substrings matched by a regular expression.
 /// </summary>
-/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages.</param>
+/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages, or a Logme::CollapseNormalizer value.</param>
 /// <param name="intervalMs">Minimum interval between repeated messages in milliseconds.</param>
 /// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
 #define LogmeI_CollapseIgnoreEvery(ignoreRegex, intervalMs, ...) \
   Logme_CollapseIgnoreEveryAt(Logme::Level::LEVEL_INFO, ignoreRegex, intervalMs, ## __VA_ARGS__)
 
+/// <summary>
+/// Writes INFO log message and collapses repeats of each of the last distinct messages of the call site.
+/// </summary>
+/// <param name="keys">Number of distinct messages tracked by the call site (1..16).</param>
+/// <param name="ignore">Regular expression, Logme::CollapseNormalizer value or nullptr.</param>
+/// <param name="limit">Number of repeated messages to skip before writing the collapsed summary.</param>
+/// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
+#define LogmeI_CollapseKeys(keys, ignore, limit, ...) \
+  Logme_CollapseKeysAt(Logme::Level::LEVEL_INFO, keys, ignore, limit, ## __VA_ARGS__)
+
+/// <summary>
+/// Writes INFO log message and collapses repeats of each of the last distinct messages of the call site using a time interval.
+/// </summary>
+/// <param name="keys">Number of distinct messages tracked by the call site (1..16).</param>
+/// <param name="ignore">Regular expression, Logme::CollapseNormalizer value or nullptr.</param>
+/// <param name="intervalMs">Minimum interval between repeated messages in milliseconds.</param>
+/// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
+#define LogmeI_CollapseKeysEvery(keys, ignore, intervalMs, ...) \
+  Logme_CollapseKeysEveryAt(Logme::Level::LEVEL_INFO, keys, ignore, intervalMs, ## __VA_ARGS__)
+
 /// <summary>
 /// Writes WARN log message and collapses repeated messages using the formatted message text as the repeat key.
 /// </summary>
@@ -413,7 +505,7 @@
 /// <summary>
 /// Writes WARN log message and collapses repeated messages ignoring substrings matched by a regular expression.
 /// </summary>
-/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages.</param>
+/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages, or a Logme::CollapseNormalizer value.</param>
 /// <param name="limit">Number of repeated messages to skip before writing the collapsed summary.</param>
 /// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
 #define LogmeW_CollapseIgnore(ignoreRegex, limit, ...) \
@@ -430,12 +522,32 @@
 /// <summary>
 /// Writes WARN log message and collapses repeated messages using a time interval while ignoring substrings matched by a regular expression.
 /// </summary>
-/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages.</param>
+/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages, or a Logme::CollapseNormalizer value.</param>
 /// <param name="intervalMs">Minimum interval between repeated messages in milliseconds.</param>
 /// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
 #define LogmeW_CollapseIgnoreEvery(ignoreRegex, intervalMs, ...) \
   Logme_CollapseIgnoreEveryAt(Logme::Level::LEVEL_WARN, ignoreRegex, intervalMs, ## __VA_ARGS__)
 
+/// <summary>
+/// Writes WARN log message and collapses repeats of each of the last distinct messages of the call site.
+/// </summary>
+/// <param name="keys">Number of distinct messages tracked by the call site (1..16).</param>
+/// <param name="ignore">Regular expression, Logme::CollapseNormalizer value or nullptr.</param>
+/// <param name="limit">Number of repeated messages to skip before writing the collapsed summary.</param>
+/// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
+#define LogmeW_CollapseKeys(keys, ignore, limit, ...) \
+  Logme_CollapseKeysAt(Logme::Level::LEVEL_WARN, keys, ignore, limit, ## __VA_ARGS__)
+
+/// <summary>
+/// Writes WARN log message and collapses repeats of each of the last distinct messages of the call site using a time interval.
+/// </summary>
+/// <param name="keys">Number of distinct messages tracked by the call site (1..16).</param>
+/// <param name="ignore">Regular expression, Logme::CollapseNormalizer value or nullptr.</param>
+/// <param name="intervalMs">Minimum interval between repeated messages in milliseconds.</param>
+/// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
+#define LogmeW_CollapseKeysEvery(keys, ignore, intervalMs, ...) \
+  Logme_CollapseKeysEveryAt(Logme::Level::LEVEL_WARN, keys, ignore, intervalMs, ## __VA_ARGS__)
+
 /// <summary>
 /// Writes ERROR log message and collapses repeated messages using the formatted message text as the repeat key.
 /// </summary>
@@ -447,7 +559,7 @@
 /// <summary>
 /// Writes ERROR log message and collapses repeated messages ignoring substrings matched by a regular expression.
 /// </summary>
-/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages.</param>
+/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages, or a Logme::CollapseNormalizer value.</param>
 /// <param name="limit">Number of repeated messages to skip before writing the collapsed summary.</param>
 /// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
 #define LogmeE_CollapseIgnore(ignoreRegex, limit, ...) \
@@ -464,12 +576,32 @@
 /// <summary>
 /// Writes ERROR log message and collapses repeated messages using a time interval while ignoring substrings matched by a regular expression.
 /// </summary>
-/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages.</param>
+/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages, or a Logme::CollapseNormalizer value.</param>
 /// <param name="intervalMs">Minimum interval between repeated messages in milliseconds.</param>
 /// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
 #define LogmeE_CollapseIgnoreEvery(ignoreRegex, intervalMs, ...) \
   Logme_CollapseIgnoreEveryAt(Logme::Level::LEVEL_ERROR, ignoreRegex, intervalMs, ## __VA_ARGS__)
 
+/// <summary>
+/// Writes ERROR log message and collapses repeats of each of the last distinct messages of the call site.
+/// </summary>
+/// <param name="keys">Number of distinct messages tracked by the call site (1..16).</param>
+/// <param name="ignore">Regular expression, Logme::CollapseNormalizer value or nullptr.</param>
+/// <param name="limit">Number of repeated messages to skip before writing the collapsed summary.</param>
+/// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
+#define LogmeE_CollapseKeys(keys, ignore, limit, ...) \
+  Logme_CollapseKeysAt(Logme::Level::LEVEL_ERROR, keys, ignore, limit, ## __VA_ARGS__)
+
+/// <summary>
+/// Writes ERROR log message and collapses repeats of each of the last distinct messages of the call site using a time interval.
+/// </summary>
+/// <param name="keys">Number of distinct messages tracked by the call site (1..16).</param>
+/// <param name="ignore">Regular expression, Logme::CollapseNormalizer value or nullptr.</param>
+/// <param name="intervalMs">Minimum interval between repeated messages in milliseconds.</param>
+/// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
+#define LogmeE_CollapseKeysEvery(keys, ignore, intervalMs, ...) \
+  Logme_CollapseKeysEveryAt(Logme::Level::LEVEL_ERROR, keys, ignore, intervalMs, ## __VA_ARGS__)
+
 /// <summary>
 /// Writes CRITICAL log message and collapses repeated messages using the formatted message text as the repeat key.
 /// </summary>
@@ -481,7 +613,7 @@
 /// <summary>
 /// Writes CRITICAL log message and collapses repeated messages ignoring substrings matched by a regular expression.
 /// </summary>
-/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages.</param>
+/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages, or a Logme::CollapseNormalizer value.</param>
 /// <param name="limit">Number of repeated messages to skip before writing the collapsed summary.</param>
 /// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
 #define LogmeC_CollapseIgnore(ignoreRegex, limit, ...) \
@@ -498,12 +630,32 @@
 /// <summary>
 /// Writes CRITICAL log message and collapses repeated messages using a time interval while ignoring substrings matched by a regular expression.
 /// </summary>
-/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages.</param>
+/// <param name="ignoreRegex">Regular expression used to remove ignored substrings before comparing messages, or a Logme::CollapseNormalizer value.</param>
 /// <param name="intervalMs">Minimum interval between repeated messages in milliseconds.</param>
 /// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
 #define LogmeC_CollapseIgnoreEvery(ignoreRegex, intervalMs, ...) \
   Logme_CollapseIgnoreEveryAt(Logme::Level::LEVEL_CRITICAL, ignoreRegex, intervalMs, ## __VA_ARGS__)
 
+/// <summary>
+/// Writes CRITICAL log message and collapses repeats of each of the last distinct messages of the call site.
+/// </summary>
+/// <param name="keys">Number of distinct messages tracked by the call site (1..16).</param>
+/// <param name="ignore">Regular expression, Logme::CollapseNormalizer value or nullptr.</param>
+/// <param name="limit">Number of repeated messages to skip before writing the collapsed summary.</param>
+/// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
+#define LogmeC_CollapseKeys(keys, ignore, limit, ...) \
+  Logme_CollapseKeysAt(Logme::Level::LEVEL_CRITICAL, keys, ignore, limit, ## __VA_ARGS__)
+
+/// <summary>
+/// Writes CRITICAL log message and collapses repeats of each of the last distinct messages of the call site using a time interval.
+/// </summary>
+/// <param name="keys">Number of distinct messages tracked by the call site (1..16).</param>
+/// <param name="ignore">Regular expression, Logme::CollapseNormalizer value or nullptr.</param>
+/// <param name="intervalMs">Minimum interval between repeated messages in milliseconds.</param>
+/// <param name="...">Optional arguments: channel/id, override, subsystem id, format, args, etc.</param>
+#define LogmeC_CollapseKeysEvery(keys, ignore, intervalMs, ...) \
+  Logme_CollapseKeysEveryAt(Logme::Level::LEVEL_CRITICAL, keys, ignore, intervalMs, ## __VA_ARGS__)
+
 /// <summary>
 /// Writes ERROR log message when condition is true (printf-style when called with a format string) or returns a stream (C++ style of output).
 /// </summary>
@@ -623,7 +775,7 @@
       if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_DEBUG, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) \
       { \
         static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); \
-        Logme::Detail::Dispatch(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_DEBUG, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); \
+        Logme::Detail::Dispatch<LOGME_FORMAT_ARG(ch, __VA_ARGS__)>(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_DEBUG, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); \
       } \
     } \
   } while (0)
@@ -637,7 +789,7 @@
       if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_INFO, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) \
       { \
         static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); \
-        Logme::Detail::Dispatch(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_INFO, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); \
+        Logme::Detail::Dispatch<LOGME_FORMAT_ARG(ch, __VA_ARGS__)>(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_INFO, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); \
       } \
     } \
   } while (0)
@@ -651,7 +803,7 @@
       if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_WARN, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) \
       { \
         static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); \
-        Logme::Detail::Dispatch(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_WARN, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); \
+        Logme::Detail::Dispatch<LOGME_FORMAT_ARG(ch, __VA_ARGS__)>(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_WARN, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); \
       } \
     } \
   } while (0)
@@ -665,7 +817,7 @@
       if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_ERROR, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) \
       { \
         static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); \
-        Logme::Detail::Dispatch(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_ERROR, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); \
+        Logme::Detail::Dispatch<LOGME_FORMAT_ARG(ch, __VA_ARGS__)>(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_ERROR, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); \
       } \
     } \
   } while (0)
@@ -679,7 +831,7 @@
       if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_CRITICAL, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) \
       { \
         static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); \
-        Logme::Detail::Dispatch(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_CRITICAL, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); \
+        Logme::Detail::Dispatch<LOGME_FORMAT_ARG(ch, __VA_ARGS__)>(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_CRITICAL, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); \
       } \
     } \
   } while (0)
@@ -689,35 +841,35 @@
 /// <param name="ch">Channel id or channel pointer.</param>
 /// <param name="code">Code executed before writing the message.</param>
 /// <param name="...">Format and format arguments.</param>
-#define LogmeD_Do(ch, code, ...) do { auto&& _logme_ch_ = (ch); if (Logme::Instance->Condition()) { const auto& _logme_resolved_ch_ = Logme::Detail::ResolveDoChannel(Logme::Instance.get(), _logme_ch_); if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_DEBUG, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) { code; static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); Logme::Detail::Dispatch(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_DEBUG, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); } } } while (0)
+#define LogmeD_Do(ch, code, ...) do { auto&& _logme_ch_ = (ch); if (Logme::Instance->Condition()) { const auto& _logme_resolved_ch_ = Logme::Detail::ResolveDoChannel(Logme::Instance.get(), _logme_ch_); if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_DEBUG, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) { code; static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); Logme::Detail::Dispatch<LOGME_FORMAT_ARG(ch, __VA_ARGS__)>(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_DEBUG, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); } } } while (0)
 /// <summary>
 /// Executes code and writes INFO message using printf-style formatting only when the selected channel would log this level.
 /// </summary>
 /// <param name="ch">Channel id or channel pointer.</param>
 /// <param name="code">Code executed before writing the message.</param>
 /// <param name="...">Format and format arguments.</param>
-#define LogmeI_Do(ch, code, ...) do { auto&& _logme_ch_ = (ch); if (Logme::Instance->Condition()) { const auto& _logme_resolved_ch_ = Logme::Detail::ResolveDoChannel(Logme::Instance.get(), _logme_ch_); if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_INFO, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) { code; static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); Logme::Detail::Dispatch(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_INFO, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); } } } while (0)
+#define LogmeI_Do(ch, code, ...) do { auto&& _logme_ch_ = (ch); if (Logme::Instance->Condition()) { const auto& _logme_resolved_ch_ = Logme::Detail::ResolveDoChannel(Logme::Instance.get(), _logme_ch_); if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_INFO, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) { code; static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); Logme::Detail::Dispatch<LOGME_FORMAT_ARG(ch, __VA_ARGS__)>(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_INFO, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); } } } while (0)
 /// <summary>
 /// Executes code and writes WARN message using printf-style formatting only when the selected channel would log this level.
 /// </summary>
 /// <param name="ch">Channel id or channel pointer.</param>
 /// <param name="code">Code executed before writing the message.</param>
 /// <param name="...">Format and format arguments.</param>
-#define LogmeW_Do(ch, code, ...) do { auto&& _logme_ch_ = (ch); if (Logme::Instance->Condition()) { const auto& _logme_resolved_ch_ = Logme::Detail::ResolveDoChannel(Logme::Instance.get(), _logme_ch_); if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_WARN, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) { code; static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); Logme::Detail::Dispatch(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_WARN, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); } } } while (0)
+#define LogmeW_Do(ch, code, ...) do { auto&& _logme_ch_ = (ch); if (Logme::Instance->Condition()) { const auto& _logme_resolved_ch_ = Logme::Detail::ResolveDoChannel(Logme::Instance.get(), _logme_ch_); if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_WARN, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) { code; static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); Logme::Detail::Dispatch<LOGME_FORMAT_ARG(ch, __VA_ARGS__)>(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_WARN, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); } } } while (0)
 /// <summary>
 /// Executes code and writes ERROR message using printf-style formatting only when the selected channel would log this level.
 /// </summary>
 /// <param name="ch">Channel id or channel pointer.</param>
 /// <param name="code">Code executed before writing the message.</param>
 /// <param name="...">Format and format arguments.</param>
-#define LogmeE_Do(ch, code, ...) do { auto&& _logme_ch_ = (ch); if (Logme::Instance->Condition()) { const auto& _logme_resolved_ch_ = Logme::Detail::ResolveDoChannel(Logme::Instance.get(), _logme_ch_); if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_ERROR, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) { code; static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); Logme::Detail::Dispatch(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_ERROR, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); } } } while (0)
+#define LogmeE_Do(ch, code, ...) do { auto&& _logme_ch_ = (ch); if (Logme::Instance->Condition()) { const auto& _logme_resolved_ch_ = Logme::Detail::ResolveDoChannel(Logme::Instance.get(), _logme_ch_); if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_ERROR, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) { code; static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); Logme::Detail::Dispatch<LOGME_FORMAT_ARG(ch, __VA_ARGS__)>(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_ERROR, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); } } } while (0)
 /// <summary>
 /// Executes code and writes CRITICAL message using printf-style formatting only when the selected channel would log this level.
 /// </summary>
 /// <param name="ch">Channel id or channel pointer.</param>
 /// <param name="code">Code executed before writing the message.</param>
 /// <param name="...">Format and format arguments.</param>
-#define LogmeC_Do(ch, code, ...) do { auto&& _logme_ch_ = (ch); if (Logme::Instance->Condition()) { const auto& _logme_resolved_ch_ = Logme::Detail::ResolveDoChannel(Logme::Instance.get(), _logme_ch_); if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_CRITICAL, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) { code; static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); Logme::Detail::Dispatch(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_CRITICAL, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); } } } while (0)
+#define LogmeC_Do(ch, code, ...) do { auto&& _logme_ch_ = (ch); if (Logme::Instance->Condition()) { const auto& _logme_resolved_ch_ = Logme::Detail::ResolveDoChannel(Logme::Instance.get(), _logme_ch_); if (LOGME_WOULD_LOG_CHANNEL_ARGS(Logme::Instance.get(), Logme::Level::LEVEL_CRITICAL, &SUBSID, _logme_resolved_ch_, ## __VA_ARGS__)) { code; static Logme::ContextCache LOGME_JOIN(_logme_ctx_, __LINE__); Logme::Detail::Dispatch<LOGME_FORMAT_ARG(ch, __VA_ARGS__)>(Logme::Instance, LOGME_JOIN(_logme_ctx_, __LINE__), Logme::Level::LEVEL_CRITICAL, &CH, &SUBSID, __FUNCTION__, __FILE__, __LINE__, _logme_ch_, ## __VA_ARGS__); } } } while (0)
 #define LogmeD_Do1(ch, code, ...) LogmeD_Do(ch, code, ## __VA_ARGS__)
 #define LogmeI_Do1(ch, code, ...) LogmeI_Do(ch, code, ## __VA_ARGS__)
 #define LogmeW_Do1(ch, code, ...) LogmeW_Do(ch, code, ## __VA_ARGS__)
@@ -12,12 +12,22 @@
 
 #define LOGOBF_SIGNATURE   0xA55Au
 #define LOGOBF_HEADER_BYTES (2 + 2 + LOGOBF_NONCE_BYTES)
+#define LOGOBF_MAX_PLAINTEXT 0xFFFFu
 
 typedef struct ObfKey
 {
   uint8_t Bytes[LOGOBF_KEY_BYTES];
 } ObfKey;
 
+/* ChaCha20 implementations; AUTO uses the widest one supported by the CPU */
+typedef enum ObfKernel
+{
+  LOGOBF_KERNEL_AUTO,
+  LOGOBF_KERNEL_SCALAR,
+  LOGOBF_KERNEL_SSE2,    /* 4 blocks per step */
+  LOGOBF_KERNEL_AVX2,    /* 8 blocks per step */
+} ObfKernel;
+
 typedef struct NonceGen
 {
   uint64_t Counter;
@@ -35,6 +45,14 @@ LOGMELNK void NonceGenNext(
   , uint8_t nonce[LOGOBF_NONCE_BYTES]
 );
 
+/* Select ChaCha20 implementation; returns 0 if the CPU does not support it */
+LOGMELNK int ObfSetKernel(
+  ObfKernel kernel
+);
+
+/* ChaCha20 implementation currently used for records */
+LOGMELNK ObfKernel ObfGetKernel(void);
+
 /* Encrypt one log record */
 LOGMELNK int ObfEncryptRecord(
   const ObfKey* key
@@ -46,6 +64,16 @@ LOGMELNK int ObfEncryptRecord(
   , size_t* outRecordLen
 );
 
+/* Encrypt one log record in place; the record header is returned separately
+   and must precede the ciphertext in the output */
+LOGMELNK int ObfEncryptRecordInPlace(
+  const ObfKey* key
+  , NonceGen* nonceGen
+  , uint8_t* data
+  , size_t len
+  , uint8_t header[LOGOBF_HEADER_BYTES]
+);
+
 /* Decrypt one log record */
 LOGMELNK int ObfDecryptRecord(
   const ObfKey* key
@@ -90,7 +90,8 @@ namespace Logme
       uint32_t ThreadTransition : 1; // Log thread name transitions
       uint32_t Subsystem : 1; // Print name of subsystem
       uint32_t Format: 2; // Format of output: text / json / xml (OutputFormat enum)
-      uint32_t : 8;
+      uint32_t TimestampPrecision : 2; // Fraction digits of timestamp (TimePrecision enum)
+      uint32_t : 6;
       uint32_t ProcPrint : 1; // Working in the context of Procedure::xxx
       uint32_t ProcPrintIn : 1; // Input parameters
       uint32_t None : 1; // Invalid flags bit
@@ -109,6 +110,8 @@ namespace Logme
     LOGMELNK std::string ToString(const char* separator = " ", bool brackets = false) const;
     /// <summary>Returns the readable name of the selected timestamp mode.</summary>
     LOGMELNK std::string TimestampType() const;
+    /// <summary>Returns the readable name of the selected timestamp precision.</summary>
+    LOGMELNK std::string TimestampPrecisionType() const;
     /// <summary>Returns the readable name of the selected source-location mode.</summary>
     LOGMELNK std::string LocationType() const;
     /// <summary>Returns the readable name of the selected console-output routing mode.</summary>
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
 
@@ -31,13 +33,13 @@ namespace Logme
 
     /// <summary>Maximum number of times this override may allow a matching message; -1 means unlimited.</summary>
     int MaxRepetitions;
-    /// <summary>Number of times this override has already been used.</summary>
-    int Repetitions;
+    /// <summary>Number of times this override has already been used. Updated atomically by the logger.</summary>
+    std::atomic<int> Repetitions;
 
     /// <summary>Minimum delay between matching messages, in milliseconds; 0 disables rate limiting.</summary>
     uint64_t MaxFrequency;
-    /// <summary>Timestamp of the last message allowed by the frequency limiter.</summary>
-    uint64_t LastTime;
+    /// <summary>Timestamp of the last message allowed by the frequency limiter. Updated atomically by the logger.</summary>
+    std::atomic<uint64_t> LastTime;
 
     /// <summary>Optional method-name shortening table used while applying this override.</summary>
     ShortenerPair* Shortener;
@@ -51,6 +53,17 @@ namespace Logme
       int reps = -1
       , uint64_t noMoreThanOnceEveryXMillisec = 0
     );
+
+    LOGMELNK Override(const Override& other);
+    LOGMELNK Override& operator=(const Override& other);
+
+    /// <summary>
+    /// Reserves one output slot from the frequency and repetition limits. Concurrent callers
+    /// sharing the same override race with compare-and-swap, so no lock is needed.
+    /// </summary>
+    /// <param name="ticks">Current time in milliseconds.</param>
+    /// <returns>true if the message may be printed.</returns>
+    LOGMELNK bool TryAcquire(uint64_t ticks);
   };
 
   typedef std::shared_ptr<Override> OverridePtr;
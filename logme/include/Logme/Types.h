@@ -70,6 +70,13 @@ namespace Logme
     TIME_FORMAT_UTC,
   };
 
+  enum TimePrecision
+  {
+    TIME_PRECISION_MILLISECONDS,
+    TIME_PRECISION_MICROSECONDS,
+    TIME_PRECISION_NANOSECONDS,
+  };
+
   enum ConsoleStream
   {
     STREAM_ALL2COUT,
@@ -97,6 +104,10 @@ namespace Logme
     const char* Password;
     bool DiscoveryEnable = true;
     const char* DiscoveryNamePrefix = nullptr;
+
+    // Limits of the control server; 0 selects the default value
+    int MaxConnections = 0;
+    int IdleTimeout = 0;
   };
 
   struct NAMED_VALUE
@@ -209,4 +209,17 @@ namespace Logme
     , size_t size
     , int value
   );
+
+  /// <summary>
+  /// Prints 64-bit unsigned integer to character buffer.
+  /// </summary>
+  /// <param name="buffer">Destination buffer receiving null-terminated text.</param>
+  /// <param name="size">Destination buffer size in characters, including terminating null.</param>
+  /// <param name="value">Integer value to print.</param>
+  /// <returns>Number of printed characters, or -1 if buffer is null or too small.</returns>
+  LOGMELNK int PrintUIntJeaiii(
+    char* buffer
+    , size_t size
+    , uint64_t value
+  );
 }
@@ -78,6 +78,16 @@ bool Backend::IsAsyncActive() const
   return Async && IsAsyncSupported();
 }
 
+bool Backend::IsConcurrentDisplaySupported() const
+{
+  return false;
+}
+
+bool Backend::IsDeferredFormatSupported() const
+{
+  return false;
+}
+
 BackendConfigPtr Backend::CreateConfig()
 {
   return std::make_shared<BackendConfig>(Type);
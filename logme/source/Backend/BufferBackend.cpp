@@ -141,6 +141,11 @@ void BufferBackend::Append(const char* str, int nc)
   Buffer[pos + nc] = '\0';
 }
 
+bool BufferBackend::IsConcurrentDisplaySupported() const
+{
+  return true;
+}
+
 void BufferBackend::Display(Logme::Context& context)
 {
   OutputFlags flags = Owner->GetFlags();
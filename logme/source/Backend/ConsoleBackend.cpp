@@ -48,6 +48,11 @@ bool ConsoleBackend::IsAsyncSupported() const
   return true;
 }
 
+bool ConsoleBackend::IsConcurrentDisplaySupported() const
+{
+  return true;
+}
+
 void ConsoleBackend::SetQueueLimits(size_t maxRecords, size_t maxBytes)
 {
   ConsoleManager::SetQueueLimits(maxRecords, maxBytes);
@@ -7,11 +7,13 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <thread>
 #include <vector>
 
 #include <Logme/Backend/FileBackend.h>
 #include <Logme/Channel.h>
 #include <Logme/Context.h>
+#include <Logme/DeferredFormat.h>
 
 #include <Logme/File/exe_path.h>
 
@@ -26,6 +28,7 @@
 #include <Logme/Template.h>
 #include <Logme/Time/datetime.h> 
 #include <Logme/Types.h>
+#include <Logme/Utils.h>
 
 
 using namespace std::chrono_literals;
@@ -142,6 +145,103 @@ namespace
   std::atomic<std::uint64_t> GlobalCompressionSubmitCalls(0);
   std::atomic<std::uint64_t> GlobalRetentionRuns(0);
   std::atomic<std::uint64_t> GlobalShutdownCalls(0);
+
+  std::atomic<std::uint64_t> GlobalOverflowDroppedRecords[LEVEL_CRITICAL + 1]{};
+  std::atomic<std::uint64_t> GlobalOverflowDroppedBytes(0);
+  std::atomic<std::uint64_t> GlobalOverflowBlockedRecords(0);
+  std::atomic<std::uint64_t> GlobalOverflowSpilledRecords(0);
+  std::atomic<std::uint64_t> GlobalOverflowSpilledBytes(0);
+  std::atomic<std::uint64_t> GlobalOverflowDroppedOldestBuffers(0);
+  std::atomic<std::uint64_t> GlobalOverflowDroppedOldestBytes(0);
+
+  const char* GetOverflowPolicyName(FileOverflowPolicy policy)
+  {
+    switch (policy)
+    {
+    case FileOverflowPolicy::BLOCK: return "BLOCK";
+    case FileOverflowPolicy::DROP_BY_LEVEL: return "DROP_BY_LEVEL";
+    case FileOverflowPolicy::SPILL: return "SPILL";
+    case FileOverflowPolicy::DROP_OLDEST: return "DROP_OLDEST";
+    default: return "DROP_NEW";
+    }
+  }
+
+  Level ClampLevel(Level level)
+  {
+    if (level < LEVEL_DEBUG || level > LEVEL_CRITICAL)
+      return LEVEL_INFO;
+
+    return level;
+  }
+
+  // Overflow file of the SPILL policy
+  class SpillFile : public FileIo
+  {
+    std::string PathName;
+
+  public:
+    SpillFile(const std::string& pathName)
+      : PathName(pathName)
+    {
+    }
+
+    ~SpillFile()
+    {
+      Close();
+    }
+
+  protected:
+    std::string GetPathName(int index) override
+    {
+      (void)index;
+      return PathName;
+    }
+  };
+
+  enum : uint32_t
+  {
+    DEFERRED_RECORD_TEXT,
+    DEFERRED_RECORD_FORMAT,
+  };
+
+  enum
+  {
+    DEFERRED_CHANNEL,
+    DEFERRED_METHOD,
+    DEFERRED_FILE,
+    DEFERRED_FORMAT,
+    DEFERRED_TIMESTAMP,
+    DEFERRED_THREAD,
+    DEFERRED_ARGS,
+    DEFERRED_FIELDS
+  };
+
+  // Record queued by FileBackend in deferred mode. Fields follow the header
+  // in DEFERRED_* order; strings keep their terminating zero and have zero
+  // length when absent. TEXT records carry an already formatted line in
+  // the DEFERRED_ARGS field. A record is never split between DataBuffers.
+  struct DeferredRecordHeader
+  {
+    uint32_t Size;
+    uint32_t Kind;
+    uint64_t Subsystem;
+    uint32_t Flags;
+    int32_t Level;
+    int32_t Line;
+    uint32_t Length[DEFERRED_FIELDS];
+  };
+
+  void CopyField(char* dst, size_t size, const char* src, size_t len)
+  {
+    if (src == nullptr || len == 0 || len > size)
+    {
+      *dst = '\0';
+      return;
+    }
+
+    memcpy(dst, src, len);
+    dst[len - 1] = '\0';
+  }
 }
 
 size_t FileBackend::MaxSizeDefault = FileBackend::MAX_SIZE_DEFAULT;
@@ -166,6 +266,7 @@ FileBackend::FileBackend(ChannelPtr owner)
   , QueueSizeLimit(QueueSizeLimitDefault)
   , FlushAfter(FlushAfterDefault)
   , ArchivePolicy(new FileArchivePolicy())
+  , FileIndex(owner ? owner->GetOwner()->GetLogFileIndex() : nullptr)
   , Registered(false)
   , ShutdownFlag(false)
   , ShutdownCalled(owner == nullptr)
@@ -194,12 +295,36 @@ FileBackend::FileBackend(ChannelPtr owner)
   , RetentionMaxAge(0)
   , RetentionMaxTotalSize(0)
   , RetentionCleanOnStart(true)
-  , GzipCompression(false)
+  , ArchiveCompression(false)
+  , ArchiveCodec(CompressionCodec::GZIP)
   , RuntimeStatistics(nullptr)
   , RuntimeStatisticsGeneration(0)
+  , DeferredFormat(false)
+  , BatchObfuscation(false)
+  , ThreadStaging(false)
+  , Staging(
+    [this]
+    {
+      StagingQueue::Options o;
+      o.BufferSize = STAGING_BUFFER_SIZE;
+      o.MaxBuffers = QueueSizeLimit / STAGING_BUFFER_SIZE;
+      return o;
+    }()
+    , GetMemoryUsageTracker()
+  )
+  , StagingDrainTime(0)
+  , OverflowPolicy(FileOverflowPolicy::DROP_NEW)
+  , OverflowTimeout(OVERFLOW_TIMEOUT_DEFAULT)
+  , OverflowKeepLevel(LEVEL_ERROR)
+  , SpillOpenFailed(false)
+  , OverflowDropped{}
+  , OverflowBlocked(0)
+  , OverflowSpilled(0)
+  , OverflowDroppedOldest(0)
 {
   SetAsync(true);
   NonceGenInit(&Nonce);
+  NonceGenInit(&SpillNonce);
 }
 
 FileBackend::~FileBackend()
@@ -409,6 +534,16 @@ FileBackendCounters FileBackend::GetCounters()
   out.CompressionSubmitCalls = GlobalCompressionSubmitCalls.load(std::memory_order_relaxed);
   out.RetentionRuns = GlobalRetentionRuns.load(std::memory_order_relaxed);
   out.ShutdownCalls = GlobalShutdownCalls.load(std::memory_order_relaxed);
+
+  for (int i = LEVEL_DEBUG; i <= LEVEL_CRITICAL; i++)
+    out.OverflowDroppedRecords[i] = GlobalOverflowDroppedRecords[i].load(std::memory_order_relaxed);
+
+  out.OverflowDroppedBytes = GlobalOverflowDroppedBytes.load(std::memory_order_relaxed);
+  out.OverflowBlockedRecords = GlobalOverflowBlockedRecords.load(std::memory_order_relaxed);
+  out.OverflowSpilledRecords = GlobalOverflowSpilledRecords.load(std::memory_order_relaxed);
+  out.OverflowSpilledBytes = GlobalOverflowSpilledBytes.load(std::memory_order_relaxed);
+  out.OverflowDroppedOldestBuffers = GlobalOverflowDroppedOldestBuffers.load(std::memory_order_relaxed);
+  out.OverflowDroppedOldestBytes = GlobalOverflowDroppedOldestBytes.load(std::memory_order_relaxed);
   out.Queue = BufferQueue::GetGlobalCounters();
   return out;
 }
@@ -490,8 +625,55 @@ std::string FileBackend::FormatDetails()
     os << " RetentionMaxAge=" << RetentionMaxAge;
   if (RetentionMaxTotalSize != 0)
     os << " RetentionMaxTotalSize=" << RetentionMaxTotalSize;
-  os << " GzipCompression=" << (GzipCompression ? "YES" : "NO");
+  if (!ArchiveCompression)
+    os << " Compression=NONE";
+  else
+    os << " Compression=" << (ArchiveCodec == CompressionCodec::ZSTD ? "ZSTD" : "GZIP");
   os << " Async=" << (GetAsync() ? "YES" : "NO");
+  if (DeferredFormat.load(std::memory_order_relaxed))
+    os << " DeferredFormat=YES";
+  if (BatchObfuscation.load(std::memory_order_relaxed))
+    os << " BatchObfuscation=YES";
+  if (ThreadStaging.load(std::memory_order_relaxed))
+    os << " ThreadStaging=" << Staging.GetStripeCount();
+
+  FileOverflowPolicy policy = OverflowPolicy.load(std::memory_order_relaxed);
+  if (policy != FileOverflowPolicy::DROP_NEW)
+  {
+    os << " Overflow=" << GetOverflowPolicyName(policy);
+    if (policy == FileOverflowPolicy::BLOCK || policy == FileOverflowPolicy::DROP_BY_LEVEL)
+      os << " OverflowTimeout=" << OverflowTimeout.load(std::memory_order_relaxed);
+    if (policy == FileOverflowPolicy::DROP_BY_LEVEL)
+      os << " OverflowKeepLevel=" << GetLevelName(OverflowKeepLevel.load(std::memory_order_relaxed));
+  }
+
+  uint64_t dropped = 0;
+  for (int i = LEVEL_DEBUG; i <= LEVEL_CRITICAL; i++)
+    dropped += OverflowDropped[i].load(std::memory_order_relaxed);
+
+  if (dropped != 0)
+  {
+    os << " OverflowDropped=" << dropped << " (";
+    for (int i = LEVEL_DEBUG; i <= LEVEL_CRITICAL; i++)
+    {
+      if (i != LEVEL_DEBUG)
+        os << ' ';
+      os << GetLevelName((Level)i) << '=' << OverflowDropped[i].load(std::memory_order_relaxed);
+    }
+    os << ')';
+  }
+
+  uint64_t blocked = OverflowBlocked.load(std::memory_order_relaxed);
+  if (blocked != 0)
+    os << " OverflowBlocked=" << blocked;
+
+  uint64_t spilled = OverflowSpilled.load(std::memory_order_relaxed);
+  if (spilled != 0)
+    os << " OverflowSpilled=" << spilled;
+
+  uint64_t droppedOldest = OverflowDroppedOldest.load(std::memory_order_relaxed);
+  if (droppedOldest != 0)
+    os << " OverflowDroppedOldest=" << droppedOldest;
 
   size_t memoryUsage = GetMemoryUsage();
   if (memoryUsage != 0)
@@ -510,6 +692,167 @@ bool FileBackend::IsAsyncSupported() const
   return true;
 }
 
+bool FileBackend::IsDeferredFormatSupported() const
+{
+  return IsFramed();
+}
+
+bool FileBackend::SetDeferredFormat(bool enable)
+{
+  if (Owner == nullptr)
+  {
+    DeferredFormat.store(enable, std::memory_order_relaxed);
+    return true;
+  }
+
+  {
+    std::lock_guard guard(Owner->GetDataLock());
+
+    if (DeferredFormat.load(std::memory_order_relaxed) == enable)
+      return true;
+
+    // The worker decides how to read queued data by this flag
+    if (QueuedBytes.load(std::memory_order_relaxed) != 0)
+      return false;
+
+    DeferredFormat.store(enable, std::memory_order_relaxed);
+  }
+
+  Owner->UpdateBackendCapabilities();
+  return true;
+}
+
+bool FileBackend::GetDeferredFormat() const
+{
+  return DeferredFormat.load(std::memory_order_relaxed);
+}
+
+bool FileBackend::SetBatchObfuscation(bool enable)
+{
+  if (Owner == nullptr)
+  {
+    BatchObfuscation.store(enable, std::memory_order_relaxed);
+    return true;
+  }
+
+  std::lock_guard guard(Owner->GetDataLock());
+
+  if (BatchObfuscation.load(std::memory_order_relaxed) == enable)
+    return true;
+
+  // The worker decides whether queued data is already encrypted by this flag
+  if (QueuedBytes.load(std::memory_order_relaxed) != 0)
+    return false;
+
+  BatchObfuscation.store(enable, std::memory_order_relaxed);
+  return true;
+}
+
+bool FileBackend::GetBatchObfuscation() const
+{
+  return BatchObfuscation.load(std::memory_order_relaxed);
+}
+
+bool FileBackend::SetThreadStaging(bool enable)
+{
+  if (Owner == nullptr)
+  {
+    ThreadStaging.store(enable, std::memory_order_relaxed);
+    return true;
+  }
+
+  {
+    std::lock_guard guard(Owner->GetDataLock());
+
+    if (ThreadStaging.load(std::memory_order_relaxed) == enable)
+      return true;
+
+    // Obfuscation moves between the caller and the worker with this flag
+    if (QueuedBytes.load(std::memory_order_relaxed) != 0 || Staging.HasData())
+      return false;
+
+    ThreadStaging.store(enable, std::memory_order_relaxed);
+  }
+
+  Owner->UpdateBackendCapabilities();
+  return true;
+}
+
+bool FileBackend::GetThreadStaging() const
+{
+  return ThreadStaging.load(std::memory_order_relaxed);
+}
+
+bool FileBackend::IsConcurrentDisplaySupported() const
+{
+  // Display() takes DataLock itself unless thread staging is on, so it can
+  // release the lock while it waits for the queue or writes the spill file
+  return true;
+}
+
+bool FileBackend::IsFramed() const
+{
+  return DeferredFormat.load(std::memory_order_relaxed) && GetAsync();
+}
+
+bool FileBackend::IsStaged() const
+{
+  return ThreadStaging.load(std::memory_order_relaxed) && GetAsync();
+}
+
+bool FileBackend::IsWorkerObfuscation() const
+{
+  return BatchObfuscation.load(std::memory_order_relaxed) || IsStaged();
+}
+
+void FileBackend::SetOverflowPolicy(
+  FileOverflowPolicy policy
+  , uint64_t timeout
+  , Level keepLevel
+)
+{
+  OverflowTimeout.store(timeout, std::memory_order_relaxed);
+  OverflowKeepLevel.store(ClampLevel(keepLevel), std::memory_order_relaxed);
+  OverflowPolicy.store(policy, std::memory_order_relaxed);
+}
+
+FileOverflowPolicy FileBackend::GetOverflowPolicy() const
+{
+  return OverflowPolicy.load(std::memory_order_relaxed);
+}
+
+void FileBackend::SetOverflowFile(const std::string& name)
+{
+  std::lock_guard guard(SpillLock);
+
+  if (OverflowFilename == name)
+    return;
+
+  OverflowFilename = name;
+  SpillIo.reset();
+  SpillOpenFailed = false;
+}
+
+std::string FileBackend::GetOverflowPathName()
+{
+  std::string name;
+  {
+    std::lock_guard guard(SpillLock);
+    name = OverflowFilename;
+  }
+
+  if (name.empty())
+    return GetPathName() + ".overflow";
+
+  ProcessTemplateParam param;
+  name = ProcessTemplate(name.c_str(), param);
+
+  if (!IsAbsolutePath(name))
+    name = Owner->GetOwner()->GetHomeDirectory() + name;
+
+  return name;
+}
+
 void FileBackend::Flush()
 {
   if (!GetAsync())
@@ -519,17 +862,28 @@ void FileBackend::Flush()
   }
 
   FILE_CNT(GlobalFlushWaitCalls.fetch_add(1, std::memory_order_relaxed));
-  for (;;)
+
+  // A drain stops when the queue is full: the rest is taken after the
+  // worker has written the queue, which leaves room for it
+  for (int pass = 0;; pass++)
   {
-    bool needSignal = false;
-    if (!PublishCurrentCounted(needSignal, PublishCurrentSource::FLUSH))
-      break;
-  }
+    size_t drained = IsStaged() ? DrainStaging() : 0;
+
+    for (;;)
+    {
+      bool needSignal = false;
+      if (!PublishCurrentCounted(needSignal, PublishCurrentSource::FLUSH))
+        break;
+    }
+
+    RequestFlush(RIGHT_NOW, FlushRequestSource::FLUSH);
 
-  RequestFlush(RIGHT_NOW, FlushRequestSource::FLUSH);
+    std::unique_lock locker(BufferLock);
+    Done.wait(locker, [this]() { return QueuedBytes.load(std::memory_order_relaxed) == 0; });
 
-  std::unique_lock locker(BufferLock);
-  Done.wait(locker, [this]() { return QueuedBytes.load(std::memory_order_relaxed) == 0; });
+    if (!Staging.HasPending() || (pass != 0 && drained == 0))
+      break;
+  }
 }
 
 void FileBackend::Freeze()
@@ -543,7 +897,7 @@ void FileBackend::Freeze()
 
 bool FileBackend::IsIdle() const
 {
-  return QueuedBytes.load(std::memory_order_relaxed) == 0 && (ShutdownFlag.load(std::memory_order_relaxed) || Registered.load(std::memory_order_relaxed) == false);
+  return QueuedBytes.load(std::memory_order_relaxed) == 0 && !Staging.HasData() && (ShutdownFlag.load(std::memory_order_relaxed) || Registered.load(std::memory_order_relaxed) == false);
 }
 
 uint64_t FileBackend::GetFlushTime() const
@@ -570,17 +924,51 @@ bool FileBackend::ApplyConfig(BackendConfigPtr c)
   ArchivePolicy->Configure(
     p->ArchiveFilename
     , Owner->GetOwner()->GetHomeDirectory()
-    , p->GzipCompression
+    , p->GzipCompression || p->ZstdCompression
+    , FileIndex
   );
   TimeRotationPolicy->Configure(rotation);
   MaxParts = p->MaxParts;
   RetentionMaxAge = p->RetentionMaxAge;
   RetentionMaxTotalSize = p->RetentionMaxTotalSize;
   RetentionCleanOnStart = p->RetentionCleanOnStart;
-  GzipCompression = p->GzipCompression;
+  ArchiveCompression = p->GzipCompression || p->ZstdCompression;
+  ArchiveCodec = p->ZstdCompression ? CompressionCodec::ZSTD : CompressionCodec::GZIP;
+
+  if (ArchiveCodec == CompressionCodec::ZSTD
+    && !CompressionManager::IsCodecSupported(CompressionCodec::ZSTD))
+  {
+    LogmeW(CHINT, "zstd compression is not available, gzip is used");
+    ArchiveCodec = CompressionCodec::GZIP;
+  }
 
-  if (GzipCompression)
-    Compression = Owner->GetOwner()->GetCompressionManagerFactory().RegisterUser();
+  // The level was validated for the configured codec; a zstd level is
+  // out of range for the gzip fallback
+  int compressionLevel = p->CompressionLevel;
+  if (compressionLevel > CompressionManager::GetMaxLevel(ArchiveCodec))
+  {
+    LogmeW(
+      CHINT
+      , "compression level %d is not supported by gzip, level %d is used"
+      , compressionLevel
+      , CompressionManager::GetMaxLevel(ArchiveCodec)
+    );
+    compressionLevel = CompressionManager::GetMaxLevel(ArchiveCodec);
+  }
+  SetDeferredFormat(p->DeferredFormat);
+  SetBatchObfuscation(p->BatchObfuscation);
+  SetThreadStaging(p->ThreadStaging);
+  SetOverflowPolicy(p->OverflowPolicy, p->OverflowTimeout, p->OverflowKeepLevel);
+  SetOverflowFile(p->OverflowFilename);
+
+  if (ArchiveCompression)
+  {
+    CompressionManagerFactory& factory = Owner->GetOwner()->GetCompressionManagerFactory();
+    if (p->CompressionThreads != 0)
+      factory.SetThreads(p->CompressionThreads);
+
+    Compression = factory.RegisterUser(ArchiveCodec, compressionLevel);
+  }
   else
     Compression.reset();
 
@@ -678,6 +1066,9 @@ bool FileBackend::CreateLog(const char* v)
     return false;
   }
 
+  if (FileIndex)
+    FileIndex->Update(Name, this);
+
   if (!Append)
   {
     CurrentSize = 0;
@@ -697,9 +1088,14 @@ bool FileBackend::CreateLog(const char* v)
 
 void FileBackend::CloseLog()
 {
+  const bool open = IsLogOpen();
+
   FileIo::Close();
   if (BufferedIo)
     BufferedIo->Close();
+
+  if (open && FileIndex && !Name.empty())
+    FileIndex->Update(Name);
 }
 
 bool FileBackend::TestFileInUse(const std::string& file) const
@@ -750,8 +1146,14 @@ void FileBackend::Display(Context& context)
   if (GetAsync())
     RegisterAsync();
 
+  // With thread staging Display runs concurrently: the worker checks time
+  // rotation when it takes staged records
+  std::unique_lock guard(Owner->GetDataLock(), std::defer_lock);
+  if (!IsStaged())
+    guard.lock();
+
   std::time_t completedArchiveTime = 0;
-  if (TimeRotationPolicy->ShouldRotate(completedArchiveTime))
+  if (guard.owns_lock() && TimeRotationPolicy->ShouldRotate(completedArchiveTime))
   {
     if (!CompleteCurrentFile(
       FILE_COMPLETION_TIME_LIMIT
@@ -763,9 +1165,40 @@ void FileBackend::Display(Context& context)
     }
   }
 
+  if (context.DeferredFormat && IsFramed())
+  {
+    OutputFlags flags = Owner->GetFlags();
+    if (context.Ovr)
+    {
+      flags.Value |= context.Ovr->Add.Value;
+      flags.Value &= ~context.Ovr->Remove.Value;
+    }
+
+    // JSON and XML output include thread fields of the calling thread
+    if (flags.Format == OUTPUT_TEXT)
+    {
+      flags.ProcPrint = context.Applied.ProcPrint;
+      flags.ProcPrintIn = context.Applied.ProcPrintIn;
+
+      if (flags.Timestamp != TIME_FORMAT_NONE && *context.GetCold().Timestamp == '\0')
+        context.InitTimestamp((TimeFormat)flags.Timestamp, (TimePrecision)flags.TimestampPrecision);
+
+      if ((flags.ProcessID || flags.ThreadID) && *context.GetCold().ThreadProcessID == '\0')
+        context.InitThreadProcessID(Owner, flags);
+
+      (void)AppendFramed(&context, flags, nullptr, 0, context.ErrorLevel);
+      return;
+    }
+  }
+
+  context.MaterializeDeferred();
+
   int nc;
   const char* buffer = context.Apply(Owner, Owner->GetFlags(), nc);
-  size_t outputBytes = AppendStringInternal(buffer, nc);
+  size_t outputBytes = AppendStringInternal(buffer, nc, context.ErrorLevel);
+
+  if (guard.owns_lock())
+    guard.unlock();
 
   Logger* logger = Owner->GetOwner();
   if (outputBytes != 0 && logger->GetActiveLogStatisticsFast() != nullptr)
@@ -828,7 +1261,7 @@ void FileBackend::AppendString(const char* text, size_t len)
   (void)AppendStringInternal(text, len);
 }
 
-size_t FileBackend::AppendStringInternal(const char* text, size_t len)
+size_t FileBackend::AppendStringInternal(const char* text, size_t len, Level level)
 {
   if (text == nullptr)
     return 0;
@@ -836,14 +1269,293 @@ size_t FileBackend::AppendStringInternal(const char* text, size_t len)
   if (len == (size_t)-1)
     len = strlen(text);
 
-  return AppendObfuscated(text, len);
+  if (IsFramed())
+    return AppendFramed(nullptr, OutputFlags(), text, len, level);
+
+  if (GetAsync() && IsWorkerObfuscation())
+    return AppendOutputData(text, len, level);
+
+  return AppendObfuscated(text, len, level);
+}
+
+size_t FileBackend::AppendFramed(
+  Context* context
+  , OutputFlags flags
+  , const char* text
+  , size_t len
+  , Level level
+)
+{
+  DeferredRecordHeader h{};
+  const char* field[DEFERRED_FIELDS]{};
+
+  if (context)
+  {
+    h.Kind = DEFERRED_RECORD_FORMAT;
+    h.Subsystem = context->Subsystem.Name;
+    h.Flags = flags.Value;
+    h.Level = (int32_t)context->ErrorLevel;
+    h.Line = context->Line;
+
+    field[DEFERRED_CHANNEL] = context->Channel ? context->Channel->Name : nullptr;
+    field[DEFERRED_METHOD] = context->Method;
+    field[DEFERRED_FILE] = context->File.FullName;
+    field[DEFERRED_FORMAT] = context->DeferredFormat;
+    Context::Cold& cold = context->GetCold();
+    field[DEFERRED_TIMESTAMP] = cold.Timestamp;
+    field[DEFERRED_THREAD] = cold.ThreadProcessID;
+
+    for (int i = 0; i < DEFERRED_ARGS; ++i)
+      h.Length[i] = field[i] ? uint32_t(strlen(field[i]) + 1) : 0;
+
+    text = context->DeferredArgs;
+    len = context->DeferredArgsSize;
+  }
+  else
+    h.Kind = DEFERRED_RECORD_TEXT;
+
+  field[DEFERRED_ARGS] = text;
+  h.Length[DEFERRED_ARGS] = (uint32_t)len;
+
+  size_t size = sizeof(h);
+  for (int i = 0; i < DEFERRED_FIELDS; ++i)
+    size += h.Length[i];
+
+  if (len > UINT32_MAX / 2 || size > UINT32_MAX)
+    return 0;
+
+  h.Size = (uint32_t)size;
+
+  char stack[4096];
+  std::string heap;
+  char* record = stack;
+  if (size > sizeof(stack))
+  {
+    heap.resize(size);
+    record = &heap[0];
+  }
+
+  char* p = record;
+  memcpy(p, &h, sizeof(h));
+  p += sizeof(h);
+
+  for (int i = 0; i < DEFERRED_FIELDS; ++i)
+  {
+    if (h.Length[i] == 0)
+      continue;
+
+    memcpy(p, field[i], h.Length[i]);
+    p += h.Length[i];
+  }
+
+  return AppendOutputData(record, size, level);
+}
+
+size_t FileBackend::RenderDeferred(std::vector<DataBufferPtr>& data)
+{
+  // Worker thread only
+  DeferredOutput.clear();
+
+  const ObfKey* key = Owner->GetOwner()->GetObfuscationKey();
+  const bool batch = key != nullptr && IsWorkerObfuscation();
+
+  for (auto& b : data)
+  {
+    if (!b)
+      continue;
+
+    const char* p = b->Data();
+    const char* end = p + b->Size();
+
+    while ((size_t)(end - p) >= sizeof(DeferredRecordHeader))
+    {
+      DeferredRecordHeader h;
+      memcpy(&h, p, sizeof(h));
+
+      if (h.Size < sizeof(h) || h.Size > (size_t)(end - p))
+        break;
+
+      RenderDeferredRecord(p, h.Size, batch ? nullptr : key);
+      p += h.Size;
+    }
+  }
+
+  if (batch && !DeferredOutput.empty())
+  {
+    BatchPlain.swap(DeferredOutput);
+    DeferredOutput.clear();
+    AppendBatchRecords(BatchPlain.data(), BatchPlain.size(), key);
+  }
+
+  return DeferredOutput.size();
+}
+
+size_t FileBackend::ObfuscateBatch(std::vector<DataBufferPtr>& data, const ObfKey* key)
+{
+  // Worker thread only
+  size_t chunks = 0;
+  size_t bytes = 0;
+  for (auto& b : data)
+  {
+    if (b)
+    {
+      chunks += (b->Size() + LOGOBF_MAX_PLAINTEXT - 1) / LOGOBF_MAX_PLAINTEXT;
+      bytes += b->Size();
+    }
+  }
+
+  BatchHeaders.resize(chunks * LOGOBF_HEADER_BYTES);
+  uint8_t* header = BatchHeaders.data();
+
+  for (auto& b : data)
+  {
+    if (!b)
+      continue;
+
+    uint8_t* p = (uint8_t*)b->Data();
+    for (size_t left = b->Size(); left != 0; header += LOGOBF_HEADER_BYTES)
+    {
+      size_t n = (std::min)(left, (size_t)LOGOBF_MAX_PLAINTEXT);
+      ObfEncryptRecordInPlace(key, &Nonce, p, n, header);
+
+      p += n;
+      left -= n;
+    }
+  }
+
+  return bytes + BatchHeaders.size();
+}
+
+void FileBackend::AppendBatchRecords(const char* text, size_t len, const ObfKey* key)
+{
+  while (len != 0)
+  {
+    size_t n = (std::min)(len, (size_t)LOGOBF_MAX_PLAINTEXT);
+    AppendRendered(text, n, key);
+
+    text += n;
+    len -= n;
+  }
+}
+
+void FileBackend::RenderDeferredRecord(const char* record, size_t size, const ObfKey* key)
+{
+  DeferredRecordHeader h;
+  memcpy(&h, record, sizeof(h));
+
+  const char* field[DEFERRED_FIELDS]{};
+  const char* p = record + sizeof(h);
+  size_t left = size - sizeof(h);
+
+  for (int i = 0; i < DEFERRED_FIELDS; ++i)
+  {
+    if (h.Length[i] > left)
+      return;
+
+    if (h.Length[i])
+      field[i] = p;
+
+    p += h.Length[i];
+    left -= h.Length[i];
+  }
+
+  if (h.Kind == DEFERRED_RECORD_TEXT)
+  {
+    AppendRendered(field[DEFERRED_ARGS], h.Length[DEFERRED_ARGS], key);
+    return;
+  }
+
+  if (h.Kind != DEFERRED_RECORD_FORMAT || field[DEFERRED_FORMAT] == nullptr)
+    return;
+
+  ContextCache cache;
+  ID id{ field[DEFERRED_CHANNEL] ? field[DEFERRED_CHANNEL] : "" };
+  SID sid{ h.Subsystem };
+
+  Context context(cache, (Level)h.Level, &id, &sid);
+  context.Method = field[DEFERRED_METHOD];
+  context.File = Module(field[DEFERRED_FILE]);
+  context.Line = h.Line;
+
+  Context::Cold& cold = context.GetCold();
+
+  CopyField(
+    cold.Timestamp
+    , sizeof(cold.Timestamp)
+    , field[DEFERRED_TIMESTAMP]
+    , h.Length[DEFERRED_TIMESTAMP]
+  );
+
+  CopyField(
+    cold.ThreadProcessID
+    , sizeof(cold.ThreadProcessID)
+    , field[DEFERRED_THREAD]
+    , h.Length[DEFERRED_THREAD]
+  );
+
+  OutputFlags flags;
+  flags.Value = h.Flags;
+  context.Applied.ProcPrint = flags.ProcPrint;
+  context.Applied.ProcPrintIn = flags.ProcPrintIn;
+
+  DeferredText.clear();
+  if (!FormatDeferredArgs(
+    field[DEFERRED_FORMAT]
+    , field[DEFERRED_ARGS]
+    , h.Length[DEFERRED_ARGS]
+    , DeferredText
+  ))
+  {
+    DeferredText = "[format error]";
+  }
+
+  // Spare capacity lets Apply append EOL in place when no prefix is needed
+  size_t len = DeferredText.size();
+  DeferredText.resize(DeferredText.capacity());
+  context.SetBuffer(DeferredText.data(), len, DeferredText.size());
+
+  int nc = 0;
+  const char* line = context.Apply(Owner, flags, nc);
+  AppendRendered(line, (size_t)nc, key);
 }
 
-size_t FileBackend::AppendObfuscated(const char* text, size_t add)
+void FileBackend::AppendRendered(const char* text, size_t len, const ObfKey* key)
+{
+  if (text == nullptr || len == 0)
+    return;
+
+  if (key == nullptr)
+  {
+    DeferredOutput.append(text, len);
+    return;
+  }
+
+  size_t pos = DeferredOutput.size();
+  size_t output = ObfCalcRecordSize(len);
+  DeferredOutput.resize(pos + output);
+
+  size_t size = 0;
+  if (ObfEncryptRecord(
+    key
+    , &Nonce
+    , (const uint8_t*)text
+    , len
+    , (uint8_t*)&DeferredOutput[pos]
+    , output
+    , &size
+  ))
+  {
+    DeferredOutput.resize(pos + size);
+  }
+  else
+    DeferredOutput.resize(pos);
+}
+
+size_t FileBackend::AppendObfuscated(const char* text, size_t add, Level level)
 {
   auto key = Owner->GetOwner()->GetObfuscationKey();
   if (key == nullptr)
-    return AppendOutputData(text, add);
+    return AppendOutputData(text, add, level);
 
   auto output = ObfCalcRecordSize(add);
   if (output < 4ULL * 1024)
@@ -851,20 +1563,20 @@ size_t FileBackend::AppendObfuscated(const char* text, size_t add)
     size_t size = 0;
     uint8_t buffer[4ULL * 1024];
     if (ObfEncryptRecord(key, &Nonce, (const uint8_t*)text, add, buffer, sizeof(buffer), &size))
-      return AppendOutputData((const char*)buffer, size);
+      return AppendOutputData((const char*)buffer, size, level);
   }
   else
   {
     size_t size = 0;
     std::vector<uint8_t> buffer(output);
     if (ObfEncryptRecord(key, &Nonce, (const uint8_t*)text, add, buffer.data(), buffer.size(), &size))
-      return AppendOutputData((const char*)buffer.data(), size);
+      return AppendOutputData((const char*)buffer.data(), size, level);
   }
 
   return 0;
 }
 
-size_t FileBackend::AppendOutputData(const char* text, size_t add)
+size_t FileBackend::AppendOutputData(const char* text, size_t add, Level level)
 {
   if (ShutdownFlag.load(std::memory_order_relaxed))
     return 0;
@@ -894,6 +1606,9 @@ size_t FileBackend::AppendOutputData(const char* text, size_t add)
     return static_cast<size_t>(rc);
   }
 
+  if (IsStaged())
+    return AppendStaged(text, add, level);
+
   bool needSignal = false;
   bool firstData = false;
 
@@ -905,13 +1620,11 @@ size_t FileBackend::AppendOutputData(const char* text, size_t add)
       ? flushTime - FlushAfter
       : firstWriteTime;
 
-  if (Queue.Append(text, add, firstWriteTime, needSignal, firstData) == false)
+  uint64_t deadline = 0;
+  while (Queue.Append(text, add, firstWriteTime, needSignal, firstData) == false)
   {
-    Logger* logger = Owner->GetOwner();
-    if (logger->GetActiveLogStatisticsFast() != nullptr)
-      logger->RecordFileBackendQueueDrop(Owner.get(), this, add);
-
-    return 0;
+    if (!ResolveOverflow(text, add, level, OverflowSite::QUEUE, deadline))
+      return 0;
   }
 
   (void)needSignal;
@@ -980,6 +1693,292 @@ size_t FileBackend::AppendOutputData(const char* text, size_t add)
   return add;
 }
 
+size_t FileBackend::AppendStaged(const char* text, size_t add, Level level)
+{
+  // No lock is held here: the record goes to the stripe of this thread
+  bool firstData = false;
+  bool handedOff = false;
+
+  uint64_t deadline = 0;
+  bool ok = Staging.Append(text, add, (uint32_t)level, firstData, handedOff);
+  while (!ok && ResolveOverflow(text, add, level, OverflowSite::STAGING, deadline))
+    ok = Staging.Append(text, add, (uint32_t)level, firstData, handedOff);
+
+  if (handedOff && Staging.GetHandedOffBytes() >= Queue.OptionsValue.BufferSize)
+    RequestFlush(RIGHT_NOW, FlushRequestSource::PRESSURE_BYTES);
+  else if (firstData)
+  {
+    // Pairs with the fence in UpdateFlushTimeAfterWork()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    RequestFlush(GetTimeInMillisec64() + FlushAfter, FlushRequestSource::FIRST_DATA);
+  }
+
+  if (!ok)
+    return 0;
+
+  FILE_CNT(GlobalAppendCalls.fetch_add(1, std::memory_order_relaxed));
+  FILE_CNT(GlobalInputBytes.fetch_add(add, std::memory_order_relaxed));
+  return add;
+}
+
+size_t FileBackend::DrainStaging()
+{
+  if (!Staging.HasData())
+    return 0;
+
+  DrainState state{this, {}};
+  size_t bytes;
+  {
+    std::lock_guard guard(Owner->GetDataLock());
+
+    // Records staged before a period boundary may reach the new file, as
+    // they do when they are still queued at the moment of rotation
+    std::time_t completedArchiveTime = 0;
+    if (TimeRotationPolicy->ShouldRotate(completedArchiveTime))
+    {
+      std::lock_guard io(IoLock);
+      (void)CompleteCurrentFile(FILE_COMPLETION_TIME_LIMIT, true, completedArchiveTime);
+    }
+
+    StagingDrainTime = GetTimeInMillisec64();
+    bytes = Staging.Drain(&FileBackend::AppendDrainedRecord, &state);
+  }
+
+  for (auto& record : state.Spill)
+  {
+    if (!Spill(record.second.data(), record.second.size()))
+      CountOverflowDrop(record.first, record.second.size());
+  }
+
+  return bytes;
+}
+
+bool FileBackend::AppendDrainedRecord(
+  void* context
+  , const char* text
+  , size_t len
+  , uint32_t tag
+)
+{
+  // Called by DrainStaging() with DataLock held
+  DrainState* state = (DrainState*)context;
+  FileBackend* self = state->Self;
+  Level level = ClampLevel((Level)tag);
+
+  bool needSignal = false;
+  bool firstData = false;
+  while (!self->Queue.Append(text, len, self->StagingDrainTime, needSignal, firstData))
+  {
+    FileOverflowPolicy policy = self->OverflowPolicy.load(std::memory_order_relaxed);
+
+    if (len > self->Queue.OptionsValue.BufferSize)
+    {
+      // Never fits: spilled by DrainStaging() after DataLock is released
+      if (policy == FileOverflowPolicy::SPILL)
+        state->Spill.emplace_back(level, std::string(text, len));
+      else
+        self->CountOverflowDrop(level, len);
+
+      return true;
+    }
+
+    // Queue is full: the record and the ones after it stay staged until
+    // the worker frees a buffer, and producers apply the policy when the
+    // staging buffers are full
+    if (policy != FileOverflowPolicy::DROP_OLDEST || !self->DropOldestBuffer())
+      return false;
+  }
+
+  self->QueuedBytes.fetch_add(len, std::memory_order_relaxed);
+  return true;
+}
+
+bool FileBackend::ResolveOverflow(
+  const char* text
+  , size_t add
+  , Level level
+  , OverflowSite site
+  , uint64_t& deadline
+)
+{
+  // Returns true if the append should be retried. A record longer than a
+  // queue buffer never fits, so only SPILL can keep it.
+  level = ClampLevel(level);
+  const bool fits = site == OverflowSite::STAGING || add <= Queue.OptionsValue.BufferSize;
+
+  // Producers of the QUEUE site hold DataLock, taken once by Display() or
+  // AppendString(). Other producers of the channel must not wait for this
+  // one, so the lock is released while it sleeps or writes the spill file.
+  CS* dataLock = site == OverflowSite::QUEUE ? &Owner->GetDataLock() : nullptr;
+
+  bool retry = false;
+  bool spilled = false;
+  switch (OverflowPolicy.load(std::memory_order_relaxed))
+  {
+  case FileOverflowPolicy::BLOCK:
+    retry = fits && WaitOverflow(deadline, dataLock);
+    break;
+
+  case FileOverflowPolicy::DROP_BY_LEVEL:
+    retry = fits
+      && level >= OverflowKeepLevel.load(std::memory_order_relaxed)
+      && WaitOverflow(deadline, dataLock);
+    break;
+
+  case FileOverflowPolicy::SPILL:
+    if (dataLock)
+      dataLock->unlock();
+
+    spilled = Spill(text, add);
+
+    if (dataLock)
+      dataLock->lock();
+    break;
+
+  case FileOverflowPolicy::DROP_OLDEST:
+    retry = site != OverflowSite::STAGING && fits && DropOldestBuffer();
+    break;
+
+  default:
+    break;
+  }
+
+  if (!retry && !spilled)
+    CountOverflowDrop(level, add);
+
+  return retry;
+}
+
+bool FileBackend::DropOldestBuffer()
+{
+  // Must be called with DataLock held
+  size_t bytes = 0;
+  if (!Queue.DropOldestReady(bytes))
+    return false;
+
+  QueuedBytes.fetch_sub(bytes, std::memory_order_relaxed);
+
+  OverflowDroppedOldest.fetch_add(1, std::memory_order_relaxed);
+  GlobalOverflowDroppedOldestBuffers.fetch_add(1, std::memory_order_relaxed);
+  GlobalOverflowDroppedOldestBytes.fetch_add(bytes, std::memory_order_relaxed);
+
+  Logger* logger = Owner->GetOwner();
+  if (logger->GetActiveLogStatisticsFast() != nullptr)
+    logger->RecordFileBackendQueueDrop(Owner.get(), this, bytes);
+
+  return true;
+}
+
+bool FileBackend::WaitOverflow(uint64_t& deadline, CS* dataLock)
+{
+  uint64_t timeout = OverflowTimeout.load(std::memory_order_relaxed);
+  if (timeout == 0 || ShutdownFlag.load(std::memory_order_relaxed))
+    return false;
+
+  uint64_t now = GetTimeInMillisec64();
+  if (deadline == 0)
+  {
+    deadline = now + timeout;
+    OverflowBlocked.fetch_add(1, std::memory_order_relaxed);
+    GlobalOverflowBlockedRecords.fetch_add(1, std::memory_order_relaxed);
+  }
+  else if (now >= deadline)
+    return false;
+
+  RequestFlush(RIGHT_NOW, FlushRequestSource::PRESSURE_BUFFERS);
+
+  if (dataLock)
+    dataLock->unlock();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  if (dataLock)
+    dataLock->lock();
+
+  return true;
+}
+
+bool FileBackend::Spill(const char* text, size_t add)
+{
+  // Deferred records are binary frames that only the worker can render
+  if (IsFramed())
+    return false;
+
+  const ObfKey* key = nullptr;
+  if (IsWorkerObfuscation())
+    key = Owner->GetOwner()->GetObfuscationKey();
+
+  std::string pathName;
+  bool open;
+  {
+    std::lock_guard guard(SpillLock);
+    if (SpillOpenFailed)
+      return false;
+
+    open = SpillIo != nullptr;
+  }
+
+  if (!open)
+    pathName = GetOverflowPathName();
+
+  std::lock_guard guard(SpillLock);
+
+  if (SpillIo == nullptr)
+  {
+    std::unique_ptr<FileIo> io(new SpillFile(pathName));
+    if (!io->Open(true))
+    {
+      SpillOpenFailed = true;
+      return false;
+    }
+
+    (void)io->Seek(0, SEEK_END);
+    SpillIo = std::move(io);
+  }
+
+  // Queued plain text is encrypted by the worker, so encrypt it here
+  if (key != nullptr)
+  {
+    SpillBuffer.resize(ObfCalcRecordSize(add));
+
+    size_t size = 0;
+    if (!ObfEncryptRecord(
+      key
+      , &SpillNonce
+      , (const uint8_t*)text
+      , add
+      , (uint8_t*)&SpillBuffer[0]
+      , SpillBuffer.size()
+      , &size
+    ))
+    {
+      return false;
+    }
+
+    text = SpillBuffer.data();
+    add = size;
+  }
+
+  if (SpillIo->WriteAll(text, add) < 0)
+    return false;
+
+  OverflowSpilled.fetch_add(1, std::memory_order_relaxed);
+  GlobalOverflowSpilledRecords.fetch_add(1, std::memory_order_relaxed);
+  GlobalOverflowSpilledBytes.fetch_add(add, std::memory_order_relaxed);
+  return true;
+}
+
+void FileBackend::CountOverflowDrop(Level level, size_t add)
+{
+  OverflowDropped[level].fetch_add(1, std::memory_order_relaxed);
+  GlobalOverflowDroppedRecords[level].fetch_add(1, std::memory_order_relaxed);
+  GlobalOverflowDroppedBytes.fetch_add(add, std::memory_order_relaxed);
+
+  Logger* logger = Owner->GetOwner();
+  if (logger->GetActiveLogStatisticsFast() != nullptr)
+    logger->RecordFileBackendQueueDrop(Owner.get(), this, add);
+}
+
 void FileBackend::RequestFlush(
   uint64_t when
   , FlushRequestSource source
@@ -1093,7 +2092,7 @@ CompressionManagerFactory& FileBackend::GetCompressionFactory() const
 
 void FileBackend::SubmitCompletedFile(const std::string& file)
 {
-  if (!GzipCompression || !Compression)
+  if (!ArchiveCompression || !Compression)
     return;
 
   FILE_CNT(GlobalCompressionSubmitCalls.fetch_add(1, std::memory_order_relaxed));
@@ -1112,7 +2111,7 @@ void FileBackend::ApplyRetention()
 
   FILE_CNT(GlobalRetentionRuns.fetch_add(1, std::memory_order_relaxed));
   std::regex pattern = BuildCleanPattern();
-  CleanFiles(pattern, Name, retention);
+  CleanFiles(pattern, Name, retention, FileIndex.get());
 
   if (!ArchivePolicy->IsEnabled())
     return;
@@ -1123,7 +2122,7 @@ void FileBackend::ApplyRetention()
   if (archiveDir.empty() || archiveDir == activeDir)
     return;
 
-  CleanFiles(pattern, archiveProbe, retention);
+  CleanFiles(pattern, archiveProbe, retention, FileIndex.get());
 }
 
 bool FileBackend::CompleteCurrentFile(
@@ -1191,6 +2190,9 @@ bool FileBackend::CompleteCurrentFile(
       return false;
     }
 
+    if (FileIndex)
+      FileIndex->Rename(oldName, completedName);
+
     FILE_CNT(GlobalArchivedFiles.fetch_add(1, std::memory_order_relaxed));
   }
   else if (reason == FILE_COMPLETION_SIZE_LIMIT)
@@ -1243,8 +2245,8 @@ std::regex FileBackend::BuildCleanPattern() const
   if (ArchivePolicy->IsEnabled())
     re = "(" + re + ")|(" + ArchivePolicy->BuildCleanPattern() + ")";
 
-  if (GzipCompression)
-    re = "(" + re + ")(\\.gz)?";
+  if (ArchiveCompression)
+    re = "(" + re + ")(\\.gz|\\.zst)?";
 
   return std::regex(re);
 }
@@ -1272,6 +2274,19 @@ bool FileBackend::WriteReadyData(std::vector<DataBufferPtr>& data)
   for (auto& b : data)
     bytes += b ? b->Size() : 0;
 
+  // Queued bytes are accounted as taken from the queue; in deferred mode the
+  // file receives the rendered text instead
+  const bool deferred = DeferredFormat.load(std::memory_order_relaxed);
+  const ObfKey* batchKey = nullptr;
+  if (!deferred && IsWorkerObfuscation())
+    batchKey = Owner->GetOwner()->GetObfuscationKey();
+
+  size_t outputBytes = bytes;
+  if (deferred)
+    outputBytes = RenderDeferred(data);
+  else if (batchKey)
+    outputBytes = ObfuscateBatch(data, batchKey);
+
   Logger* logger = Owner->GetOwner();
   const bool collectStatistics =
     logger->GetActiveLogStatisticsFast() != nullptr;
@@ -1302,13 +2317,42 @@ bool FileBackend::WriteReadyData(std::vector<DataBufferPtr>& data)
   {
     std::lock_guard guard(IoLock);
 
-    if (!ApplySizeLimit(bytes))
+    if (!ApplySizeLimit(outputBytes))
     {
       ok = false;
       if (collectStatistics)
       {
         failedBuffers = data.size();
-        failedBytes = bytes;
+        failedBytes = outputBytes;
+      }
+    }
+    else if (deferred)
+    {
+      if (outputBytes != 0)
+      {
+        if (collectStatistics)
+          ++writeOperations;
+
+        int rc = FileIo::WriteAll(DeferredOutput.data(), DeferredOutput.size());
+        if (rc < 0)
+        {
+          ok = false;
+          if (collectStatistics)
+          {
+            ++failedWriteOperations;
+            failedBuffers += data.size();
+            failedBytes += outputBytes;
+          }
+        }
+        else
+        {
+          CurrentSize += (size_t)rc;
+          if (collectStatistics)
+          {
+            writtenBuffers += data.size();
+            writtenBytes += static_cast<size_t>(rc);
+          }
+        }
       }
     }
     else
@@ -1318,6 +2362,8 @@ bool FileBackend::WriteReadyData(std::vector<DataBufferPtr>& data)
     constexpr size_t WRITEV_CHUNK = 256;
     iovec iov[WRITEV_CHUNK];
     size_t iovcnt = 0;
+    size_t iovBuffers = 0;
+    uint8_t* header = BatchHeaders.data();
 
     auto writeVector = [&]()
     {
@@ -1343,7 +2389,7 @@ bool FileBackend::WriteReadyData(std::vector<DataBufferPtr>& data)
         if (collectStatistics)
         {
           ++failedWriteOperations;
-          failedBuffers += iovcnt;
+          failedBuffers += iovBuffers;
           failedBytes += inputBytes;
         }
       }
@@ -1352,12 +2398,13 @@ bool FileBackend::WriteReadyData(std::vector<DataBufferPtr>& data)
         CurrentSize += (size_t)rc;
         if (collectStatistics)
         {
-          writtenBuffers += iovcnt;
+          writtenBuffers += iovBuffers;
           writtenBytes += static_cast<size_t>(rc);
         }
       }
 
       iovcnt = 0;
+      iovBuffers = 0;
     };
 
     for (auto& b : data)
@@ -1375,16 +2422,45 @@ bool FileBackend::WriteReadyData(std::vector<DataBufferPtr>& data)
       ));
       FILE_WRCNT(UpdateMaxCounter(GlobalWriteReadyRawMaxBytes, b->Size()));
 
-      iov[iovcnt].iov_base = b->Data();
-      iov[iovcnt].iov_len = b->Size();
-      ++iovcnt;
+      if (batchKey == nullptr)
+      {
+        iov[iovcnt].iov_base = b->Data();
+        iov[iovcnt].iov_len = b->Size();
+        ++iovcnt;
+        ++iovBuffers;
+
+        if (iovcnt == WRITEV_CHUNK)
+          writeVector();
+
+        continue;
+      }
+
+      // Every encrypted chunk follows its record header
+      char* p = b->Data();
+      for (size_t left = b->Size(); left != 0; header += LOGOBF_HEADER_BYTES)
+      {
+        size_t n = (std::min)(left, (size_t)LOGOBF_MAX_PLAINTEXT);
+
+        iov[iovcnt].iov_base = header;
+        iov[iovcnt].iov_len = LOGOBF_HEADER_BYTES;
+        iov[iovcnt + 1].iov_base = p;
+        iov[iovcnt + 1].iov_len = n;
+        iovcnt += 2;
 
-      if (iovcnt == WRITEV_CHUNK)
-        writeVector();
+        if (iovcnt == WRITEV_CHUNK)
+          writeVector();
+
+        p += n;
+        left -= n;
+      }
+
+      ++iovBuffers;
     }
 
     writeVector();
 #else
+    uint8_t* header = BatchHeaders.data();
+
     for (auto& b : data)
     {
       if (!b)
@@ -1403,7 +2479,27 @@ bool FileBackend::WriteReadyData(std::vector<DataBufferPtr>& data)
       if (collectStatistics)
         ++writeOperations;
 
-      int rc = FileIo::WriteAll(b->Data(), b->Size());
+      int rc = 0;
+      if (batchKey == nullptr)
+        rc = FileIo::WriteAll(b->Data(), b->Size());
+      else
+      {
+        // Every encrypted chunk follows its record header
+        char* p = b->Data();
+        for (size_t left = b->Size(); left != 0; header += LOGOBF_HEADER_BYTES)
+        {
+          size_t n = (std::min)(left, (size_t)LOGOBF_MAX_PLAINTEXT);
+
+          int hr = FileIo::WriteAll(header, LOGOBF_HEADER_BYTES);
+          int cr = hr < 0 ? hr : FileIo::WriteAll(p, n);
+          if (rc >= 0)
+            rc = cr < 0 ? cr : rc + hr + cr;
+
+          p += n;
+          left -= n;
+        }
+      }
+
       if (rc < 0)
       {
         ok = false;
@@ -1433,8 +2529,8 @@ bool FileBackend::WriteReadyData(std::vector<DataBufferPtr>& data)
   if (ok)
   {
     FILE_CNT(GlobalWrittenBuffers.fetch_add(data.size(), std::memory_order_relaxed));
-    FILE_CNT(GlobalWrittenBytes.fetch_add(bytes, std::memory_order_relaxed));
-    FILE_CNT(GlobalOutputBytes.fetch_add(bytes, std::memory_order_relaxed));
+    FILE_CNT(GlobalWrittenBytes.fetch_add(outputBytes, std::memory_order_relaxed));
+    FILE_CNT(GlobalOutputBytes.fetch_add(outputBytes, std::memory_order_relaxed));
   }
   else
   {
@@ -1462,6 +2558,12 @@ bool FileBackend::WriteReadyData(std::vector<DataBufferPtr>& data)
 
   Queue.Recycle(data);
 
+  if (DeferredOutput.capacity() > 4 * QUEUE_BUFFER_SIZE)
+    std::string().swap(DeferredOutput);
+
+  if (BatchPlain.capacity() > 4 * QUEUE_BUFFER_SIZE)
+    std::string().swap(BatchPlain);
+
   if (!Queue.HasCurrentDataFlagged() && !Queue.HasReady())
     Queue.TrimFreeBuffersIfIdle();
 
@@ -1583,7 +2685,11 @@ void FileBackend::UpdateFlushTimeAfterWork()
     return;
   }
 
-  if (Queue.HasCurrentDataFlagged())
+  // A producer that staged its first record while FlushTime was still set
+  // did not schedule a run
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (Queue.HasCurrentDataFlagged() || Staging.HasData())
   {
     FlushTime.store(
       GetTimeInMillisec64() + FlushAfter
@@ -1611,6 +2717,11 @@ bool FileBackend::WorkerFunc()
   else
     FILE_CNT(GlobalWorkerTimedRuns.fetch_add(1, std::memory_order_relaxed));
 
+  // Staged records already waited for this run: write them out now instead
+  // of starting a new FlushAfter period for the queue
+  if (IsStaged() && DrainStaging() != 0)
+    forceFlush = true;
+
   FILE_WRCNT(int writeLoops = 0);
   for (int i = 0; i < maxWriteLoops; i++)
   {
@@ -1660,6 +2771,13 @@ bool FileBackend::WorkerFunc()
 
   FILE_WRCNT(UpdateMaxCounter(GlobalWorkerWriteLoopMaxIterations, writeLoops));
 
+  // The drain stopped on a full queue: take the rest on the next run
+  if (Staging.HasPending())
+  {
+    FlushTime.store(RIGHT_NOW, std::memory_order_relaxed);
+    return !ShutdownFlag.load(std::memory_order_relaxed);
+  }
+
   UpdateFlushTimeAfterWork();
   return !ShutdownFlag.load(std::memory_order_relaxed);
 }
@@ -1667,16 +2785,25 @@ bool FileBackend::WorkerFunc()
 void FileBackend::OnShutdown()
 {
   FILE_CNT(GlobalShutdownCalls.fetch_add(1, std::memory_order_relaxed));
-  while (QueuedBytes.load(std::memory_order_relaxed) != 0)
+
+  for (int pass = 0;; pass++)
   {
-    if (!WriteReadyData(ReadyData))
+    size_t drained = DrainStaging();
+
+    while (QueuedBytes.load(std::memory_order_relaxed) != 0)
     {
-      bool needSignal = false;
-      if (!PublishCurrentCounted(needSignal, PublishCurrentSource::ON_SHUTDOWN))
-        break;
+      if (!WriteReadyData(ReadyData))
+      {
+        bool needSignal = false;
+        if (!PublishCurrentCounted(needSignal, PublishCurrentSource::ON_SHUTDOWN))
+          break;
 
-      (void)needSignal;
+        (void)needSignal;
+      }
     }
+
+    if (!Staging.HasPending() || (pass != 0 && drained == 0))
+      break;
   }
 
   ShutdownCalled.store(true, std::memory_order_relaxed);
@@ -102,6 +102,30 @@ namespace
 
     return true;
   }
+
+  bool ParseOverflowPolicy(
+    const std::string& text
+    , FileOverflowPolicy& policy
+  )
+  {
+    std::string v = TrimSpaces(text);
+    ToLowerAsciiInplace(v);
+
+    if (v == "" || v == "drop-new" || v == "drop_new")
+      policy = FileOverflowPolicy::DROP_NEW;
+    else if (v == "block")
+      policy = FileOverflowPolicy::BLOCK;
+    else if (v == "drop-by-level" || v == "drop_by_level")
+      policy = FileOverflowPolicy::DROP_BY_LEVEL;
+    else if (v == "spill")
+      policy = FileOverflowPolicy::SPILL;
+    else if (v == "drop-oldest" || v == "drop_oldest")
+      policy = FileOverflowPolicy::DROP_OLDEST;
+    else
+      return false;
+
+    return true;
+  }
 #endif
 }
 
@@ -117,6 +141,15 @@ FileBackendConfig::FileBackendConfig()
   , RetentionMaxTotalSize(0)
   , RetentionCleanOnStart(true)
   , GzipCompression(false)
+  , ZstdCompression(false)
+  , CompressionLevel(0)
+  , CompressionThreads(0)
+  , DeferredFormat(false)
+  , BatchObfuscation(false)
+  , ThreadStaging(false)
+  , OverflowPolicy(FileOverflowPolicy::DROP_NEW)
+  , OverflowTimeout(FileBackend::OVERFLOW_TIMEOUT_DEFAULT)
+  , OverflowKeepLevel(LEVEL_ERROR)
 {
   Async = true;
 }
@@ -292,17 +325,128 @@ bool FileBackendConfig::Parse(const Json::Value* po)
     std::string v = TrimSpaces(o["compression"].asString());
     ToLowerAsciiInplace(v);
 
+    GzipCompression = false;
+    ZstdCompression = false;
+
     if (v == "gz" || v == "gzip")
       GzipCompression = true;
-    else if (v == "" || v == "none" || v == "off" || v == "disabled")
-      GzipCompression = false;
-    else
+    else if (v == "zst" || v == "zstd")
+      ZstdCompression = true;
+    else if (v != "" && v != "none" && v != "off" && v != "disabled")
     {
       LogmeE(CHINT, "unsupported value of \"compression\": %s", v.c_str());
       return false;
     }
   }
 
+  if (o.isMember("compression-level"))
+  {
+    if (!ParseRetentionInteger(o["compression-level"], "compression-level", CompressionLevel))
+      return false;
+
+    // 0 selects the default level of the codec
+    int maxLevel = CompressionManager::GetMaxLevel(
+      ZstdCompression ? CompressionCodec::ZSTD : CompressionCodec::GZIP
+    );
+    if (CompressionLevel > maxLevel)
+    {
+      LogmeE(CHINT, "\"compression-level\" must not exceed %d", maxLevel);
+      return false;
+    }
+  }
+
+  if (o.isMember("compression-threads"))
+  {
+    int threads = 0;
+    if (!ParseRetentionInteger(o["compression-threads"], "compression-threads", threads))
+      return false;
+
+    if (threads > CompressionManager::MAX_THREADS)
+    {
+      LogmeE(CHINT, "\"compression-threads\" must not exceed %d", (int)CompressionManager::MAX_THREADS);
+      return false;
+    }
+
+    CompressionThreads = static_cast<size_t>(threads);
+  }
+
+  if (o.isMember("deferred-format"))
+  {
+    if (!o["deferred-format"].isBool())
+    {
+      LogmeE(CHINT, "\"deferred-format\" is not a boolean value");
+      return false;
+    }
+
+    DeferredFormat = o["deferred-format"].asBool();
+  }
+
+  if (o.isMember("batch-obfuscation"))
+  {
+    if (!o["batch-obfuscation"].isBool())
+    {
+      LogmeE(CHINT, "\"batch-obfuscation\" is not a boolean value");
+      return false;
+    }
+
+    BatchObfuscation = o["batch-obfuscation"].asBool();
+  }
+
+  if (o.isMember("thread-staging"))
+  {
+    if (!o["thread-staging"].isBool())
+    {
+      LogmeE(CHINT, "\"thread-staging\" is not a boolean value");
+      return false;
+    }
+
+    ThreadStaging = o["thread-staging"].asBool();
+  }
+
+  if (o.isMember("overflow-policy"))
+  {
+    if (!o["overflow-policy"].isString())
+    {
+      LogmeE(CHINT, "\"overflow-policy\" is not a string value");
+      return false;
+    }
+
+    if (!ParseOverflowPolicy(o["overflow-policy"].asString(), OverflowPolicy))
+    {
+      LogmeE(CHINT, "unsupported value of \"overflow-policy\": %s", o["overflow-policy"].asString().c_str());
+      return false;
+    }
+  }
+
+  if (o.isMember("overflow-timeout"))
+  {
+    if (!ParseRetentionInterval(o["overflow-timeout"], "overflow-timeout", OverflowTimeout))
+      return false;
+  }
+
+  if (o.isMember("overflow-keep-level"))
+  {
+    int v = 0;
+    if (!o["overflow-keep-level"].isString() || !LevelFromName(o["overflow-keep-level"].asString(), v))
+    {
+      LogmeE(CHINT, "\"overflow-keep-level\" is not a level name");
+      return false;
+    }
+
+    OverflowKeepLevel = (Level)v;
+  }
+
+  if (o.isMember("overflow-file"))
+  {
+    if (!o["overflow-file"].isString())
+    {
+      LogmeE(CHINT, "\"overflow-file\" is not a string");
+      return false;
+    }
+
+    OverflowFilename = o["overflow-file"].asString();
+  }
+
   if (o.isMember("archive"))
   {
     if (!o["archive"].isString())
@@ -1,7 +1,8 @@
 #include <algorithm>
 #include <cstring>
-#include <iterator>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 #include <Logme/Backend/RingBufferBackend.h>
 #include <Logme/Channel.h>
@@ -10,11 +11,39 @@
 
 using namespace Logme;
 
+namespace
+{
+  template<typename F>
+  void ForFragments(const char* data, size_t capacity, uint64_t offset, size_t length, F f)
+  {
+    size_t pos = size_t(offset % capacity);
+    size_t first = (std::min)(length, capacity - pos);
+
+    f(data + pos, first);
+
+    if (first < length)
+      f(data, length - first);
+  }
+}
+
 RingBufferBackend::RingBufferBackend(Logme::ChannelPtr owner)
   : MemoryTrackedBackend(owner, TYPE_ID)
+  , Capacity(0)
+  , Slots(0)
+  , First(0)
+  , Count(0)
+  , Head(0)
+  , Tail(0)
 {
 }
 
+RingBufferBackend::~RingBufferBackend()
+{
+  std::lock_guard guard(Lock);
+  WaitForWriters();
+  Release();
+}
+
 BackendConfigPtr RingBufferBackend::CreateConfig()
 {
   return std::make_shared<RingBufferBackendConfig>();
@@ -26,21 +55,201 @@ bool RingBufferBackend::ApplyConfig(BackendConfigPtr c)
     return false;
 
   RingBufferBackendConfig* p = (RingBufferBackendConfig*)c.get();
-  
+
   std::lock_guard guard(Lock);
   Config = *p;
 
+  if (Data == nullptr)
+    return true;
+
+  // Storage without a byte limit keeps the size it has grown to
+  size_t capacity = Config.MaxBytes ? Config.MaxBytes : Capacity;
+  if (Capacity == capacity && Slots == Config.MaxItems)
+    return true;
+
+  WaitForWriters();
+  Resize(capacity, Config.MaxItems);
   return true;
 }
 
+void RingBufferBackend::Allocate(size_t capacity, size_t slots)
+{
+  Release();
+
+  if (capacity == 0 || slots == 0)
+    return;
+
+  Data.reset(new char[capacity]);
+  Records.reset(new Record[slots]);
+  Capacity = capacity;
+  Slots = slots;
+
+  for (size_t i = 0; i < Slots; i++)
+    Records[i].Ready.store(true, std::memory_order_relaxed);
+
+  GetMemoryUsageTracker()->AddMemoryUsage(Capacity + Slots * sizeof(Record));
+}
+
+void RingBufferBackend::Resize(size_t capacity, size_t slots)
+{
+  // Must be called with Lock held after WaitForWriters(). Moves the newest
+  // records that fit into storage of the new size.
+  std::vector<std::string> saved;
+  saved.reserve(Count);
+
+  for (size_t i = 0; i < Count; i++)
+  {
+    const Record& r = Records[(First + i) % Slots];
+
+    std::string text;
+    text.reserve(r.Length);
+    ForFragments(Data.get(), Capacity, r.Offset, r.Length, [&text](const char* p, size_t n) { text.append(p, n); });
+    saved.push_back(std::move(text));
+  }
+
+  Allocate(capacity, slots);
+
+  for (const auto& text : saved)
+  {
+    size_t slot;
+    uint64_t offset;
+    size_t length = text.size();
+
+    if (!Reserve(length, slot, offset))
+      break;
+
+    CopyIn(offset, text.data(), length);
+    Records[slot].Ready.store(true, std::memory_order_release);
+  }
+}
+
+void RingBufferBackend::Release()
+{
+  if (Data != nullptr)
+    GetMemoryUsageTracker()->RemoveMemoryUsage(Capacity + Slots * sizeof(Record));
+
+  Data.reset();
+  Records.reset();
+  Capacity = 0;
+  Slots = 0;
+  First = 0;
+  Count = 0;
+  Head = 0;
+  Tail = 0;
+}
+
+void RingBufferBackend::WaitForWriters()
+{
+  // Writers publish their record without the lock; storage must not be
+  // reused while any reserved record is still being copied
+  for (size_t i = 0; i < Count; i++)
+  {
+    const Record& r = Records[(First + i) % Slots];
+    while (!r.Ready.load(std::memory_order_acquire))
+      std::this_thread::yield();
+  }
+}
+
+bool RingBufferBackend::Reserve(size_t& length, size_t& slot, uint64_t& offset)
+{
+  if (Data == nullptr)
+  {
+    size_t capacity = Config.MaxBytes ? Config.MaxBytes : size_t(RingBufferBackendConfig::INITIAL_BYTES);
+    Allocate(capacity, Config.MaxItems);
+  }
+
+  if (Data == nullptr)
+    return false;
+
+  if (Config.MaxBytes == 0)
+  {
+    // No byte limit: grow instead of evicting, except the record that gives
+    // its slot to this one
+    size_t used = size_t(Tail - Head);
+    if (Count == Slots)
+      used -= Records[First].Length;
+
+    if (used + length > Capacity)
+    {
+      WaitForWriters();
+      Resize((std::max)(used + length, 2 * Capacity), Slots);
+    }
+  }
+
+  if (length > Capacity)
+    length = Capacity;
+
+  while (Count > 0 && (Count == Slots || Tail - Head + length > Capacity))
+  {
+    const Record& r = Records[First];
+    while (!r.Ready.load(std::memory_order_acquire))
+      std::this_thread::yield();
+
+    Head = r.Offset + r.Length;
+    First = (First + 1) % Slots;
+    Count--;
+  }
+
+  slot = (First + Count) % Slots;
+  offset = Tail;
+
+  Record& r = Records[slot];
+  r.Offset = offset;
+  r.Length = length;
+  r.Ready.store(false, std::memory_order_relaxed);
+
+  Tail += length;
+  Count++;
+  return true;
+}
+
+void RingBufferBackend::CopyIn(uint64_t offset, const char* str, size_t length)
+{
+  char* data = Data.get();
+  size_t pos = size_t(offset % Capacity);
+  size_t first = (std::min)(length, Capacity - pos);
+
+  memcpy(data + pos, str, first);
+
+  if (first < length)
+    memcpy(data, str + first, length - first);
+}
+
+void RingBufferBackend::VisitRecord(const Record& r, const RingBufferVisitor& visitor) const
+{
+  ForFragments(Data.get(), Capacity, r.Offset, r.Length, visitor);
+}
+
 void RingBufferBackend::Clear()
 {
   std::lock_guard guard(Lock);
 
-  for (const auto& item : Ring)
-    GetMemoryUsageTracker()->RemoveMemoryUsage(item.capacity());
+  if (Data == nullptr)
+    return;
+
+  WaitForWriters();
 
-  Ring.clear();
+  First = 0;
+  Count = 0;
+  Head = Tail;
+}
+
+size_t RingBufferBackend::Visit(const RingBufferVisitor& visitor)
+{
+  std::lock_guard guard(Lock);
+
+  size_t visited = 0;
+  for (size_t i = 0; i < Count; i++)
+  {
+    const Record& r = Records[(First + i) % Slots];
+    if (!r.Ready.load(std::memory_order_acquire))
+      continue;
+
+    VisitRecord(r, visitor);
+    visited++;
+  }
+
+  return visited;
 }
 
 std::string RingBufferBackend::Join()
@@ -48,38 +257,57 @@ std::string RingBufferBackend::Join()
   std::lock_guard guard(Lock);
 
   size_t size = 1;
-  for (const auto& s : Ring)
-    size += s.size();
+  for (size_t i = 0; i < Count; i++)
+    size += Records[(First + i) % Slots].Length;
 
   std::string result;
   result.reserve(size);
 
-  for (const auto& s : Ring)
-    result.append(s);
+  for (size_t i = 0; i < Count; i++)
+  {
+    const Record& r = Records[(First + i) % Slots];
+    if (!r.Ready.load(std::memory_order_acquire))
+      continue;
+
+    VisitRecord(r, [&result](const char* p, size_t n) { result.append(p, n); });
+  }
 
   return result;
 }
 
+size_t RingBufferBackend::GetCount()
+{
+  std::lock_guard guard(Lock);
+  return Count;
+}
+
+size_t RingBufferBackend::GetUsedBytes()
+{
+  std::lock_guard guard(Lock);
+  return size_t(Tail - Head);
+}
+
 void RingBufferBackend::Append(const char* str, int nc)
 {
   if (nc == -1)
     nc = (int)strlen(str);
 
-  if (nc == 0)
+  if (nc <= 0)
     return;
 
-  std::lock_guard guard(Lock);
-
-  Ring.emplace_back(str, nc);
-  GetMemoryUsageTracker()->AddMemoryUsage(Ring.back().capacity());
+  size_t length = size_t(nc);
+  size_t slot;
+  uint64_t offset;
 
-  while (Ring.size() > Config.MaxItems)
   {
-    GetMemoryUsageTracker()->RemoveMemoryUsage(Ring.front().capacity());
-    Ring.pop_front();
+    std::lock_guard guard(Lock);
+    if (!Reserve(length, slot, offset))
+      return;
   }
-}
 
+  CopyIn(offset, str, length);
+  Records[slot].Ready.store(true, std::memory_order_release);
+}
 
 std::string RingBufferBackend::FormatDetails()
 {
@@ -87,7 +315,9 @@ std::string RingBufferBackend::FormatDetails()
 
   std::ostringstream os;
   os << "MaxItems=" << Config.MaxItems;
-  os << " Used=" << Ring.size();
+  os << " MaxBytes=" << Config.MaxBytes;
+  os << " Used=" << Count;
+  os << " Bytes=" << (Tail - Head);
 
   size_t memoryUsage = GetMemoryUsage();
   if (memoryUsage != 0)
@@ -96,6 +326,11 @@ std::string RingBufferBackend::FormatDetails()
   return os.str();
 }
 
+bool RingBufferBackend::IsConcurrentDisplaySupported() const
+{
+  return true;
+}
+
 void RingBufferBackend::Display(Logme::Context& context)
 {
   OutputFlags flags = Owner->GetFlags();
@@ -116,4 +351,3 @@ void RingBufferBackend::Display(Logme::Context& context)
     );
   }
 }
-
@@ -12,6 +12,7 @@ using namespace Logme;
 RingBufferBackendConfig::RingBufferBackendConfig()
   : BackendConfig(RingBufferBackend::TYPE_ID)
   , MaxItems(MAX_ITEMS_DEFAULT)
+  , MaxBytes(MAX_BYTES_DEFAULT)
 {
 }
 
@@ -39,6 +40,24 @@ bool RingBufferBackendConfig::Parse(const Json::Value* po)
 
     MaxItems = v;
   }
+
+  if (o.isMember("max-bytes"))
+  {
+    if (!o["max-bytes"].isInt() && !o["max-bytes"].isString())
+    {
+      LogmeE(CHINT, "\"max-bytes\" is not an integer or a string value");
+      return false;
+    }
+
+    size_t v = size_t(GetByteSize(o, "max-bytes", 0));
+    if (v < 1)
+    {
+      LogmeE(CHINT, "\"max-bytes\" must be greater than 0");
+      return false;
+    }
+
+    MaxBytes = v;
+  }
 #endif
 
   return true;
@@ -1,22 +1,57 @@
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
 #include <sstream>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <sys/file.h>
+#include <unistd.h>
+#endif
 
 #include <Logme/Backend/SharedFileBackend.h>
 #include <Logme/Channel.h>
 #include <Logme/File/exe_path.h>
 #include <Logme/Logger.h>
+#include <Logme/Logme.h>
 #include <Logme/Template.h>
+#include <Logme/Time/datetime.h>
 
 using namespace Logme;
 
+#if !defined(_WIN32) && !defined(__sun__)
+// FileIo relies on flock() for cross-process exclusion, which is not available
+// on Solaris; on Windows the file is opened with a share mode denying other writers
+#define SHARED_FILE_PERSISTENT 1
+#else
+#define SHARED_FILE_PERSISTENT 0
+#endif
+
 SharedFileBackend::SharedFileBackend(ChannelPtr owner)
   : Backend(owner, TYPE_ID)
   , MaxSize(MAX_SIZE_DEFAULT)
   , Timeout(10)
+  , Persistent(false)
+  , FlushInterval(FLUSH_INTERVAL_DEFAULT)
+  , BatchSize(BATCH_SIZE_DEFAULT)
+  , PendingRecords(0)
+  , PendingSince(0)
+  , FlushFailed(false)
+  , DroppedRecords(0)
+  , DroppedBytes(0)
+  , FileDevice(0)
+  , FileInode(0)
+  , StopFlusher(false)
 {
 }
 
 SharedFileBackend::~SharedFileBackend()
 {
+  StopFlusherThread();
+
+  std::lock_guard guard(Lock);
+  FlushPending();
+  CloseLog();
 }
 
 void SharedFileBackend::SetMaxSize(size_t size)
@@ -25,10 +60,94 @@ void SharedFileBackend::SetMaxSize(size_t size)
   MaxSize = size;
 }
 
+void SharedFileBackend::SetPersistent(bool persistent, size_t flushInterval, size_t batchSize)
+{
+  StopFlusherThread();
+
+  std::lock_guard guard(Lock);
+  FlushPending();
+  DropPending();
+  CloseLog();
+
+  Persistent = persistent && SHARED_FILE_PERSISTENT;
+  FlushInterval = flushInterval;
+  BatchSize = batchSize;
+}
+
+bool SharedFileBackend::GetPersistent()
+{
+  std::lock_guard guard(Lock);
+  return Persistent;
+}
+
+uint64_t SharedFileBackend::GetDroppedRecords()
+{
+  std::lock_guard guard(Lock);
+  return DroppedRecords;
+}
+
+uint64_t SharedFileBackend::GetDroppedBytes()
+{
+  std::lock_guard guard(Lock);
+  return DroppedBytes;
+}
+
+bool SharedFileBackend::IsConcurrentDisplaySupported() const
+{
+  return true;
+}
+
+void SharedFileBackend::Flush()
+{
+  std::lock_guard guard(Lock);
+  FlushPending();
+}
+
 void SharedFileBackend::Display(Context& context)
 {
   std::lock_guard guard(Lock);
 
+  if (Persistent)
+  {
+    int nc;
+    const char* buffer = context.Apply(Owner, Owner->GetFlags(), nc);
+
+    bool wasEmpty = Pending.empty();
+    if (wasEmpty)
+      PendingSince = GetTimeInMillisec64();
+
+    Pending.append(buffer, size_t(nc));
+    PendingRecords++;
+
+    Logger* logger = Owner->GetOwner();
+    if (nc > 0 && logger->GetActiveLogStatisticsFast() != nullptr)
+    {
+      logger->RecordLogBackendOutput(
+        context
+        , Owner.get()
+        , this
+        , static_cast<size_t>(nc)
+      );
+    }
+
+    // After a failed write the batch is retried by the flusher instead of
+    // opening and locking the file again for every record, unless it
+    // outgrew the limit of kept data
+    bool full = Pending.size() >= BatchSize
+      && (!FlushFailed || Pending.size() > GetPendingLimit());
+
+    if (FlushInterval == 0 || full)
+      FlushPending();
+    else
+    {
+      StartFlusher();
+
+      if (wasEmpty)
+        FlushCV.notify_one();
+    }
+    return;
+  }
+
   if (CreateLog())
   {
     TruncateToMaxSize(MaxSize);
@@ -78,6 +197,17 @@ std::string SharedFileBackend::FormatDetails()
   os << " MaxSize=" << MaxSize;
   os << " Timeout=" << Timeout;
 
+  if (Persistent)
+  {
+    os << " Persistent=YES";
+    os << " FlushInterval=" << FlushInterval;
+    os << " BatchSize=" << BatchSize;
+    os << " Pending=" << Pending.size();
+
+    if (DroppedRecords)
+      os << " Dropped=" << DroppedRecords << "/" << DroppedBytes;
+  }
+
   return os.str();
 }
 
@@ -92,17 +222,25 @@ bool SharedFileBackend::ApplyConfig(BackendConfigPtr c)
     return false;
 
   SharedFileBackendConfig* p = (SharedFileBackendConfig*)c.get();
-  
+
+  StopFlusherThread();
+
   std::lock_guard guard(Lock);
+  FlushPending();
+  DropPending();
+  CloseLog();
 
   MaxSize = p->MaxSize;
   Timeout = p->Timeout;
   NameTemplate = p->Filename;
+  Persistent = p->Persistent && SHARED_FILE_PERSISTENT;
+  FlushInterval = p->FlushInterval;
+  BatchSize = p->BatchSize;
 
   return true;
 }
 
-bool SharedFileBackend::CreateLog()
+std::string SharedFileBackend::BuildName()
 {
   ProcessTemplateParam param;
   std::string name = ProcessTemplate(NameTemplate.c_str(), param);
@@ -110,10 +248,11 @@ bool SharedFileBackend::CreateLog()
   if (!IsAbsolutePath(name))
     name = Owner->GetOwner()->GetHomeDirectory() + name;
 
-  CloseLog();
-  Name.clear();
-  Name = name;
+  return name;
+}
 
+bool SharedFileBackend::CreateDirectories()
+{
   auto dir = std::filesystem::path(Name).parent_path();
   if (!dir.empty())
   {
@@ -124,6 +263,20 @@ bool SharedFileBackend::CreateLog()
       return false;
   }
 
+  return true;
+}
+
+bool SharedFileBackend::CreateLog()
+{
+  std::string name = BuildName();
+
+  CloseLog();
+  Name.clear();
+  Name = name;
+
+  if (!CreateDirectories())
+    return false;
+
   return Open(true, unsigned(Timeout));
 }
 
@@ -131,3 +284,239 @@ void SharedFileBackend::CloseLog()
 {
   Close();
 }
+
+bool SharedFileBackend::OpenPersistent()
+{
+#if SHARED_FILE_PERSISTENT
+  if (!CreateDirectories())
+    return false;
+
+  std::lock_guard guard(IoLock);
+
+  // O_APPEND makes every write land at the current end of file even when
+  // other processes appended or truncated it since our last batch
+  const int pmode = S_IROTH | S_IWOTH | S_IWGRP | S_IRGRP | S_IWUSR | S_IRUSR;
+  File = open(Name.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, pmode);
+  if (File < 0)
+  {
+    File = -1;
+    Error = errno;
+    LogmeE(CHINT, "SharedFileBackend(%s): open failed: %s", Name.c_str(), ERRNO_STR(Error));
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(File, &st) == 0)
+  {
+    FileDevice = uint64_t(st.st_dev);
+    FileInode = uint64_t(st.st_ino);
+  }
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool SharedFileBackend::LockFile()
+{
+#if SHARED_FILE_PERSISTENT
+  for (uint64_t start = GetTimeInMillisec64();; Sleep(1))
+  {
+    if (flock(File, LOCK_EX | LOCK_NB) == 0)
+      return true;
+
+    Error = errno;
+    uint64_t t = GetTimeInMillisec64();
+    if (Error != EWOULDBLOCK && Error != EINTR)
+      break;
+
+    if (t < start || t - start >= Timeout)
+      break;
+  }
+
+  LogmeE(CHINT, "SharedFileBackend(%s): flock(LOCK_EX) failed: %s", Name.c_str(), ERRNO_STR(Error));
+#endif
+  return false;
+}
+
+void SharedFileBackend::UnlockFile()
+{
+#if SHARED_FILE_PERSISTENT
+  if (flock(File, LOCK_UN) < 0)
+  {
+    Error = errno;
+    LogmeE(CHINT, "SharedFileBackend(%s): flock(LOCK_UN) failed: %s", Name.c_str(), ERRNO_STR(Error));
+  }
+#endif
+}
+
+bool SharedFileBackend::IsFileReplaced()
+{
+#if SHARED_FILE_PERSISTENT
+  struct stat st;
+  if (stat(Name.c_str(), &st) < 0)
+    return true;
+
+  return uint64_t(st.st_dev) != FileDevice || uint64_t(st.st_ino) != FileInode;
+#else
+  return false;
+#endif
+}
+
+void SharedFileBackend::TruncatePersistent()
+{
+#if SHARED_FILE_PERSISTENT
+  if (MaxSize == 0)
+    return;
+
+  struct stat st;
+  if (fstat(File, &st) < 0 || uint64_t(st.st_size) < MaxSize)
+    return;
+
+  // TruncateToMaxSize() rewrites the file from offset 0, which O_APPEND would
+  // redirect to the end. The advisory lock is held, so nobody appends meanwhile.
+  int flags = fcntl(File, F_GETFL);
+  if (flags < 0 || fcntl(File, F_SETFL, flags & ~O_APPEND) < 0)
+    return;
+
+  TruncateToMaxSize(MaxSize);
+  fcntl(File, F_SETFL, flags);
+#endif
+}
+
+void SharedFileBackend::FlushPending()
+{
+  if (Pending.empty())
+    return;
+
+  std::string name = BuildName();
+  if (IsOpen() && name != Name)
+    CloseLog();
+
+  bool locked = false;
+  for (int attempt = 0; attempt < 2 && !locked; attempt++)
+  {
+    if (!IsOpen())
+    {
+      Name = name;
+      if (!OpenPersistent())
+        break;
+    }
+
+    if (!LockFile())
+      break;
+
+    // Another process renamed or removed the file: reopen by name
+    if (IsFileReplaced())
+    {
+      UnlockFile();
+      CloseLog();
+      continue;
+    }
+
+    locked = true;
+  }
+
+  if (!locked)
+  {
+    KeepPending();
+    return;
+  }
+
+  TruncatePersistent();
+  int rc = WriteAll(Pending.data(), Pending.size());
+  UnlockFile();
+
+  if (rc < 0)
+  {
+    // The next attempt reopens the file by name
+    CloseLog();
+    KeepPending();
+    return;
+  }
+
+  FlushFailed = false;
+  PendingRecords = 0;
+  Pending.clear();
+  if (Pending.capacity() > 4 * BatchSize)
+    Pending.shrink_to_fit();
+}
+
+void SharedFileBackend::KeepPending()
+{
+  // Keep the batch for the next attempt unless it outgrew the file limit
+  FlushFailed = true;
+  PendingSince = GetTimeInMillisec64();
+
+  if (Pending.size() > GetPendingLimit())
+    DropPending();
+}
+
+size_t SharedFileBackend::GetPendingLimit() const
+{
+  return MaxSize ? MaxSize : size_t(MAX_SIZE_DEFAULT);
+}
+
+void SharedFileBackend::DropPending()
+{
+  if (Pending.empty())
+    return;
+
+  DroppedRecords += PendingRecords;
+  DroppedBytes += Pending.size();
+
+  FlushFailed = false;
+  PendingRecords = 0;
+  Pending.clear();
+  Pending.shrink_to_fit();
+}
+
+void SharedFileBackend::StartFlusher()
+{
+  if (Flusher.joinable())
+    return;
+
+  StopFlusher = false;
+  Flusher = std::thread(&SharedFileBackend::FlusherThread, this);
+}
+
+void SharedFileBackend::StopFlusherThread()
+{
+  std::unique_lock guard(Lock);
+  if (!Flusher.joinable())
+    return;
+
+  StopFlusher = true;
+  FlushCV.notify_all();
+
+  std::thread flusher;
+  flusher.swap(Flusher);
+  guard.unlock();
+
+  flusher.join();
+}
+
+void SharedFileBackend::FlusherThread()
+{
+  std::unique_lock guard(Lock);
+
+  while (!StopFlusher)
+  {
+    if (Pending.empty())
+    {
+      FlushCV.wait(guard);
+      continue;
+    }
+
+    uint64_t now = GetTimeInMillisec64();
+    uint64_t due = PendingSince + FlushInterval;
+    if (now < due)
+    {
+      FlushCV.wait_for(guard, std::chrono::milliseconds(due - now));
+      continue;
+    }
+
+    FlushPending();
+  }
+}
@@ -14,6 +14,9 @@ SharedFileBackendConfig::SharedFileBackendConfig()
   : BackendConfig(SharedFileBackend::TYPE_ID)
   , MaxSize(FileBackend::GetMaxSizeDefault())
   , Timeout(10)
+  , Persistent(false)
+  , FlushInterval(SharedFileBackend::FLUSH_INTERVAL_DEFAULT)
+  , BatchSize(SharedFileBackend::BATCH_SIZE_DEFAULT)
 {
 }
 
@@ -50,6 +53,39 @@ bool SharedFileBackendConfig::Parse(const Json::Value* po)
     Timeout = GetInterval(o, "timeout", MaxSize);
   }
 
+  if (o.isMember("persistent"))
+  {
+    if (!o["persistent"].isBool())
+    {
+      LogmeE(CHINT, "\"persistent\" is not a boolean value");
+      return false;
+    }
+
+    Persistent = o["persistent"].asBool();
+  }
+
+  if (o.isMember("flush-interval"))
+  {
+    if (!o["flush-interval"].isInt() && !o["flush-interval"].isString())
+    {
+      LogmeE(CHINT, "\"flush-interval\" is not an integer or a string value");
+      return false;
+    }
+
+    FlushInterval = GetInterval(o, "flush-interval", FlushInterval);
+  }
+
+  if (o.isMember("batch-size"))
+  {
+    if (!o["batch-size"].isInt() && !o["batch-size"].isString())
+    {
+      LogmeE(CHINT, "\"batch-size\" is not an integer or a string value");
+      return false;
+    }
+
+    BatchSize = GetByteSize(o, "batch-size", BatchSize);
+  }
+
   if (!o.isMember("file"))
   {
     LogmeE(CHINT, "\"file\" is not specified");
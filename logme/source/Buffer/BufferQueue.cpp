@@ -244,6 +244,30 @@ void BufferQueue::Recycle(std::vector<DataBufferPtr>& buffers)
   buffers.clear();
 }
 
+bool BufferQueue::DropOldestReady(std::size_t& bytes)
+{
+  bytes = 0;
+
+  DataBufferPtr buffer;
+  {
+    std::lock_guard guard(ReadyLock);
+
+    if (ReadyList.empty())
+      return false;
+
+    buffer = std::move(ReadyList.front());
+    ReadyList.pop_front();
+  }
+
+  if (!buffer)
+    return false;
+
+  bytes = buffer->Size();
+  CountDropped(bytes);
+  ReleaseBuffer(std::move(buffer));
+  return true;
+}
+
 BufferQueue::SoftFlushState BufferQueue::PrepareSoftFlushCurrent(DataBuffer* &expected)
 {
   expected = nullptr;
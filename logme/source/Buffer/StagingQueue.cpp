@@ -0,0 +1,356 @@
+#include <Logme/Buffer/StagingQueue.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+using namespace Logme;
+
+namespace
+{
+  // Record layout in a staging buffer: [key][size][tag][payload]
+  const std::size_t KEY_BYTES = sizeof(std::uint64_t);
+  const std::size_t SIZE_BYTES = sizeof(std::uint32_t);
+  const std::size_t TAG_BYTES = sizeof(std::uint32_t);
+  const std::size_t HEADER_BYTES = KEY_BYTES + SIZE_BYTES + TAG_BYTES;
+  const std::size_t MAX_STRIPES = 64;
+
+  std::atomic<unsigned> NextThreadStripe(0);
+  thread_local unsigned ThreadStripe = NextThreadStripe.fetch_add(1, std::memory_order_relaxed);
+
+  std::uint64_t GetKeyTime()
+  {
+    return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+  }
+
+  std::size_t GetStripeCountFor(std::size_t requested)
+  {
+    if (requested == 0)
+      requested = std::thread::hardware_concurrency();
+
+    requested = (std::min)((std::max)(requested, std::size_t(1)), MAX_STRIPES);
+
+    std::size_t count = 1;
+    while (count < requested)
+      count <<= 1;
+
+    return count;
+  }
+
+}
+
+StagingQueue::Block::Block(std::size_t capacity, MemoryUsageTracker* memoryTracker)
+  : Next(nullptr)
+  , Buffer(capacity, memoryTracker)
+{
+}
+
+StagingQueue::Stripe::Stripe()
+  : Busy(false)
+  , HasData(false)
+  , Current(nullptr)
+  , LastKey(0)
+{
+}
+
+StagingQueue::StagingQueue(const Options& options, MemoryUsageTracker* memoryTracker)
+  : OptionsValue(options)
+  , MemoryTracker(memoryTracker)
+  , StripeMask(0)
+  , Full(nullptr)
+  , FullBytes(0)
+  , TotalBuffers(0)
+  , HasPendingFlag(false)
+{
+  std::size_t count = GetStripeCountFor(options.Stripes);
+  Stripes.reset(new Stripe[count]);
+  StripeMask = count - 1;
+}
+
+StagingQueue::~StagingQueue()
+{
+  for (Cursor& c : Pending)
+    delete c.Owner;
+
+  for (std::size_t i = 0; i <= StripeMask; i++)
+    delete Stripes[i].Current;
+
+  for (Block* b = Full.exchange(nullptr); b != nullptr;)
+  {
+    Block* next = b->Next;
+    delete b;
+    b = next;
+  }
+
+  for (Block* b : FreeList)
+    delete b;
+}
+
+StagingQueue::Stripe& StagingQueue::GetStripe()
+{
+  return Stripes[ThreadStripe & StripeMask];
+}
+
+StagingQueue::Block* StagingQueue::TakeBlock(std::size_t cb)
+{
+  if (cb <= OptionsValue.BufferSize)
+  {
+    std::lock_guard guard(FreeLock);
+    if (!FreeList.empty())
+    {
+      Block* b = FreeList.back();
+      FreeList.pop_back();
+      return b;
+    }
+  }
+
+  std::size_t total = TotalBuffers.fetch_add(1, std::memory_order_relaxed);
+  if (OptionsValue.MaxBuffers != 0 && total >= OptionsValue.MaxBuffers)
+  {
+    TotalBuffers.fetch_sub(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  // A record longer than a buffer gets a dedicated one
+  return new Block((std::max)(cb, OptionsValue.BufferSize), MemoryTracker);
+}
+
+void StagingQueue::ReleaseBlock(Block* block)
+{
+  if (block->Buffer.Capacity() == OptionsValue.BufferSize)
+  {
+    block->Buffer.Reset();
+    block->Next = nullptr;
+
+    std::lock_guard guard(FreeLock);
+    FreeList.push_back(block);
+    return;
+  }
+
+  TotalBuffers.fetch_sub(1, std::memory_order_relaxed);
+  delete block;
+}
+
+void StagingQueue::PushFull(Block* block)
+{
+  FullBytes.fetch_add(block->Buffer.Size(), std::memory_order_relaxed);
+
+  Block* head = Full.load(std::memory_order_relaxed);
+  do
+  {
+    block->Next = head;
+  } while (!Full.compare_exchange_weak(
+    head
+    , block
+    , std::memory_order_release
+    , std::memory_order_relaxed
+  ));
+}
+
+bool StagingQueue::Append(
+  const char* p
+  , std::size_t cb
+  , std::uint32_t tag
+  , bool& firstData
+  , bool& handedOff
+)
+{
+  firstData = false;
+  handedOff = false;
+
+  if (cb == 0)
+    return true;
+
+  const std::size_t need = HEADER_BYTES + cb;
+  Stripe& s = GetStripe();
+
+  // Stripes are private to a thread unless there are more threads than
+  // stripes, so this lock is normally uncontended
+  while (s.Busy.exchange(true, std::memory_order_acquire))
+  {
+    while (s.Busy.load(std::memory_order_relaxed))
+      std::this_thread::yield();
+  }
+
+  Block* b = s.Current;
+  if (b != nullptr && !b->Buffer.CanAppend(need))
+  {
+    PushFull(b);
+    s.Current = b = nullptr;
+    handedOff = true;
+  }
+
+  if (b == nullptr)
+  {
+    b = TakeBlock(need);
+    if (b == nullptr)
+    {
+      s.HasData.store(false, std::memory_order_relaxed);
+      s.Busy.store(false, std::memory_order_release);
+      return false;
+    }
+
+    s.Current = b;
+  }
+
+  // Keys of a stripe are strictly increasing even if the clock is coarse
+  std::uint64_t key = GetKeyTime();
+  if (key <= s.LastKey)
+    key = s.LastKey + 1;
+  s.LastKey = key;
+
+  std::uint32_t size = (std::uint32_t)cb;
+  char header[HEADER_BYTES];
+  memcpy(header, &key, KEY_BYTES);
+  memcpy(header + KEY_BYTES, &size, SIZE_BYTES);
+  memcpy(header + KEY_BYTES + SIZE_BYTES, &tag, TAG_BYTES);
+
+  firstData = b->Buffer.Size() == 0;
+  b->Buffer.Append(header, HEADER_BYTES);
+  b->Buffer.Append(p, cb);
+
+  if (firstData)
+    s.HasData.store(true, std::memory_order_seq_cst);
+
+  s.Busy.store(false, std::memory_order_release);
+  return true;
+}
+
+std::size_t StagingQueue::Drain(RecordFunc f, void* context)
+{
+  std::lock_guard guard(DrainLock);
+
+  const auto readKey = [](Cursor& c)
+  {
+    memcpy(&c.Key, c.Pos, KEY_BYTES);
+  };
+
+  const auto laterKey = [](const Cursor& a, const Cursor& b)
+  {
+    return a.Key > b.Key;
+  };
+
+  const auto addBlock = [this, &readKey](Block* b)
+  {
+    Cursor c;
+    c.Owner = b;
+    c.Pos = b->Buffer.Data();
+    c.End = c.Pos + b->Buffer.Size();
+    readKey(c);
+    Pending.push_back(c);
+  };
+
+  // Records left by a stopped drain are merged with the new ones, so the
+  // order of every thread is kept. Stripes are taken before the full
+  // stack: a buffer handed off while a stripe is being taken must be
+  // drained together with its successor, otherwise records of one thread
+  // could be written out of order
+  for (std::size_t i = 0; i <= StripeMask; i++)
+  {
+    Stripe& s = Stripes[i];
+    if (!s.HasData.load(std::memory_order_seq_cst))
+      continue;
+
+    while (s.Busy.exchange(true, std::memory_order_acquire))
+      std::this_thread::yield();
+
+    Block* b = nullptr;
+    if (s.Current != nullptr && s.Current->Buffer.Size() != 0)
+    {
+      b = s.Current;
+      s.Current = nullptr;
+    }
+
+    s.HasData.store(false, std::memory_order_relaxed);
+    s.Busy.store(false, std::memory_order_release);
+
+    if (b != nullptr)
+      addBlock(b);
+  }
+
+  size_t fullBytes = 0;
+  for (Block* b = Full.exchange(nullptr, std::memory_order_acquire); b != nullptr;)
+  {
+    Block* next = b->Next;
+    fullBytes += b->Buffer.Size();
+    addBlock(b);
+    b = next;
+  }
+
+  if (fullBytes != 0)
+    FullBytes.fetch_sub(fullBytes, std::memory_order_relaxed);
+
+  // Every buffer is sorted by key, so a k-way merge restores the order
+  std::vector<Cursor>& heap = Pending;
+  std::make_heap(heap.begin(), heap.end(), laterKey);
+
+  std::size_t bytes = 0;
+  while (!heap.empty())
+  {
+    std::pop_heap(heap.begin(), heap.end(), laterKey);
+    Cursor& c = heap.back();
+
+    std::uint32_t size;
+    std::uint32_t tag;
+    memcpy(&size, c.Pos + KEY_BYTES, SIZE_BYTES);
+    memcpy(&tag, c.Pos + KEY_BYTES + SIZE_BYTES, TAG_BYTES);
+
+    if (!f(context, c.Pos + HEADER_BYTES, size, tag))
+    {
+      std::push_heap(heap.begin(), heap.end(), laterKey);
+      break;
+    }
+
+    bytes += size;
+
+    c.Pos += HEADER_BYTES + size;
+    if (c.Pos < c.End)
+    {
+      readKey(c);
+      std::push_heap(heap.begin(), heap.end(), laterKey);
+    }
+    else
+    {
+      ReleaseBlock(c.Owner);
+      heap.pop_back();
+    }
+  }
+
+  HasPendingFlag.store(!Pending.empty(), std::memory_order_seq_cst);
+  return bytes;
+}
+
+bool StagingQueue::HasData() const
+{
+  if (HasPending())
+    return true;
+
+  if (Full.load(std::memory_order_seq_cst) != nullptr)
+    return true;
+
+  for (std::size_t i = 0; i <= StripeMask; i++)
+  {
+    if (Stripes[i].HasData.load(std::memory_order_seq_cst))
+      return true;
+  }
+
+  return false;
+}
+
+bool StagingQueue::HasPending() const
+{
+  return HasPendingFlag.load(std::memory_order_seq_cst);
+}
+
+std::size_t StagingQueue::GetHandedOffBytes() const
+{
+  return FullBytes.load(std::memory_order_relaxed);
+}
+
+std::size_t StagingQueue::GetStripeCount() const
+{
+  return StripeMask + 1;
+}
@@ -6,9 +6,16 @@
 #include <cassert>
 #include <cstdio>
 #include <string.h>
+#include <thread>
+
+#include "LogStatisticsInternal.h"
 
 using namespace Logme;
 
+// Bumped on every change that can alter a "[PID:TID/name]" prefix of any
+// channel; per-thread prefix caches compare it to detect stale entries
+static std::atomic<uint64_t> ThreadNameGeneration(1);
+
 Channel::Channel(
   Logger* owner
   , const char* name
@@ -24,17 +31,137 @@ Channel::Channel(
   , Linked(false)
   , BackendCount(0)
   , Active(false)
+  , DeferredFormat(false)
   , AccessCount(0)
   , LoggedBytes(0)
   , ShortenerList(nullptr)
+  , ActiveDisplaySnapshot(nullptr)
+  , DisplaySnapshotReclamation(false)
+  , DisplaySnapshotReaders(0)
+  , DisplaySnapshotsRetired(false)
 {
+  PublishDisplaySnapshot();
 }
 
 Channel::~Channel()
 {
+  // A new channel may reuse this address
+  BumpThreadNameGeneration();
+
+  ActiveDisplaySnapshot.store(nullptr, std::memory_order_release);
+  DisplaySnapshots.clear();
+
   Backends.clear();
 }
 
+const Channel::DisplaySnapshot* Channel::AcquireDisplaySnapshot()
+{
+  for (;;)
+  {
+    while (DisplaySnapshotReclamation.load())
+      std::this_thread::yield();
+
+    DisplaySnapshotReaders.fetch_add(1);
+
+    if (DisplaySnapshotReclamation.load() == false)
+      return ActiveDisplaySnapshot.load(std::memory_order_acquire);
+
+    DisplaySnapshotReaders.fetch_sub(1);
+  }
+}
+
+void Channel::ReleaseDisplaySnapshot()
+{
+  if (DisplaySnapshotReaders.fetch_sub(1) != 1 || !DisplaySnapshotsRetired.load())
+    return;
+
+  // The last reader frees snapshots that a writer had to leave behind. If a
+  // writer holds the lock now, it reclaims them itself.
+  std::unique_lock guard(DisplaySnapshotLock, std::try_to_lock);
+  if (guard.owns_lock())
+    ReclaimDisplaySnapshots();
+}
+
+void Channel::PublishDisplaySnapshot()
+{
+  // Must be called with DataLock held (or from constructor)
+
+  auto snapshot = std::make_unique<DisplaySnapshot>();
+
+  bool deferred = !Backends.empty() && !Link && !LinkTo && !DisplayFilter;
+  for (auto& b : Backends)
+  {
+    if (b->IsConcurrentDisplaySupported())
+      snapshot->Concurrent.push_back(b);
+    else
+      snapshot->Serialized.push_back(b);
+
+    if (!b->IsDeferredFormatSupported())
+      deferred = false;
+  }
+
+  DeferredFormat.store(deferred, std::memory_order_relaxed);
+
+  snapshot->Link = Link;
+  snapshot->LinkTo = LinkTo;
+  snapshot->DisplayFilter = DisplayFilter;
+
+  // Thread names of the linked channel are used for the prefix
+  BumpThreadNameGeneration();
+
+  std::lock_guard guard(DisplaySnapshotLock);
+
+  const auto* active = snapshot.get();
+  DisplaySnapshots.push_back(std::move(snapshot));
+  ActiveDisplaySnapshot.store(active, std::memory_order_release);
+
+  ReclaimDisplaySnapshots();
+}
+
+void Channel::ReclaimDisplaySnapshots()
+{
+  // Must be called with DisplaySnapshotLock held. Readers may be blocked on
+  // DataLock held by the caller, so waiting for them is bounded: snapshots
+  // that cannot be freed now are retried by the last reader to leave or on
+  // the next publication.
+
+  if (DisplaySnapshots.size() < 2)
+    return;
+
+  // Set before readers are checked, so a reader that leaves after the check
+  // sees it
+  DisplaySnapshotsRetired.store(true);
+  DisplaySnapshotReclamation.store(true);
+
+  bool idle = false;
+  for (int spin = 0; spin < DISPLAY_SNAPSHOT_RECLAIM_SPINS; ++spin)
+  {
+    if (DisplaySnapshotReaders.load() == 0)
+    {
+      idle = true;
+      break;
+    }
+
+    std::this_thread::yield();
+  }
+
+  std::vector<std::unique_ptr<DisplaySnapshot>> retired;
+  if (idle)
+  {
+    auto activeSnapshot = std::move(DisplaySnapshots.back());
+    DisplaySnapshots.pop_back();
+    retired.swap(DisplaySnapshots);
+    DisplaySnapshots.push_back(std::move(activeSnapshot));
+    DisplaySnapshotsRetired.store(false);
+  }
+
+  DisplaySnapshotReclamation.store(false);
+
+  // Retired snapshots may hold the last reference to removed backends, so
+  // destroy them after readers are released.
+  retired.clear();
+}
+
 const ID& Channel::GetID() const
 {
   return ChannelID;
@@ -74,6 +201,7 @@ void Channel::AddLink(const ID& to)
 
   Linked.store(true, std::memory_order_relaxed);
   UpdateActive();
+  PublishDisplaySnapshot();
 }
 
 void Channel::AddLink(const ChannelPtr& to)
@@ -87,6 +215,7 @@ void Channel::AddLink(const ChannelPtr& to)
 
   Linked.store(true, std::memory_order_relaxed);
   UpdateActive();
+  PublishDisplaySnapshot();
 }
 
 void Channel::RemoveLink()
@@ -98,6 +227,18 @@ void Channel::RemoveLink()
 
   Linked.store(false, std::memory_order_relaxed);
   UpdateActive();
+  PublishDisplaySnapshot();
+}
+
+bool Channel::IsDeferredFormatEnabled() const
+{
+  return DeferredFormat.load(std::memory_order_relaxed);
+}
+
+void Channel::UpdateBackendCapabilities()
+{
+  std::lock_guard guard(DataLock);
+  PublishDisplaySnapshot();
 }
 
 bool Channel::IsLinked() const
@@ -129,6 +270,7 @@ void Channel::SetDisplayFilter(TDisplayFilter filter)
 {
   std::lock_guard guard(DataLock);
   DisplayFilter = filter;
+  PublishDisplaySnapshot();
 }
 
 void Channel::Display(Context& context)
@@ -138,30 +280,34 @@ void Channel::Display(Context& context)
 
   AccessCount.fetch_add(1, std::memory_order_relaxed);
 
-  DataLock.lock();
-
   if (Enabled.load(std::memory_order_relaxed) == false)
-  {
-    DataLock.unlock();
     return;
-  }
 
   DisplayReentryGuard guard(this);
   if (guard.IsActive() == false)
-  {
-    DataLock.unlock();
     return;
-  }
 
-  if (DisplayFilter)
-  {
-    TDisplayFilter f = DisplayFilter;
-    DataLock.unlock();
+  const DisplaySnapshot* snapshot = AcquireDisplaySnapshot();
+  if (snapshot)
+    DisplaySnapshotted(context, *snapshot);
 
-    if (f(context, context.GetText()) == false)
-      return;
+  ReleaseDisplaySnapshot();
+}
+
+void Channel::DisplaySnapshotted(Context& context, const DisplaySnapshot& snapshot)
+{
+  // Captured arguments may reach a channel whose setup changed after the
+  // caller checked IsDeferredFormatEnabled(): format them here
+  if (
+       context.DeferredFormat
+    && (snapshot.DisplayFilter || snapshot.Link || snapshot.LinkTo)
+  )
+    context.MaterializeDeferred();
 
-    DataLock.lock();
+  if (snapshot.DisplayFilter)
+  {
+    if (snapshot.DisplayFilter(context, context.GetText()) == false)
+      return;
   }
 
   Level filterLevel = LevelFilter.load(std::memory_order_relaxed);
@@ -170,10 +316,7 @@ void Channel::Display(Context& context)
     filterLevel = subsystemLevel;
 
   if (context.ErrorLevel < filterLevel)
-  {
-    DataLock.unlock();
     return;
-  }
 
   OutputFlags flags = Flags;
   if (context.Ovr)
@@ -182,14 +325,12 @@ void Channel::Display(Context& context)
     flags.Value &= ~context.Ovr->Remove.Value;
   }
 
-  if ((Link || LinkTo) && !flags.DisableLink)
+  if ((snapshot.Link || snapshot.LinkTo) && !flags.DisableLink)
   {
-    IDPtr link = Link;
-    ChannelPtr pch = LinkTo;
-
     // Owner->GetChannel / ch->Display have to be called w/o acquired lock!!
-    DataLock.unlock();
-    ChannelPtr ch = pch ? pch : Owner->GetChannel(*link);
+    ChannelPtr ch = snapshot.LinkTo
+      ? snapshot.LinkTo
+      : Owner->GetChannel(*snapshot.Link);
 
     if (ch)
     {
@@ -200,19 +341,50 @@ void Channel::Display(Context& context)
 
       ch->Display(context);
     }
+  }
+
+  for (auto& p : snapshot.Concurrent)
+  {
+    if (p->Freezed)
+      continue;
+
+    if (context.DeferredFormat && !p->IsDeferredFormatSupported())
+      context.MaterializeDeferred();
 
-    DataLock.lock();
+    if (context.TimedSite)
+      DisplayTimed(p.get(), context);
+    else
+      p->Display(context);
   }
 
-  for (auto it = Backends.begin(); it != Backends.end(); ++it)
+  if (snapshot.Serialized.empty())
+    return;
+
+  // Backends without internal synchronization keep the historical
+  // guarantee: they are entered by one thread at a time.
+  std::lock_guard lock(DataLock);
+
+  for (auto& p : snapshot.Serialized)
   {
-    auto& p = *it;
+    if (p->Freezed)
+      continue;
+
+    if (context.DeferredFormat && !p->IsDeferredFormatSupported())
+      context.MaterializeDeferred();
 
-    if (p->Freezed == false)
+    if (context.TimedSite)
+      DisplayTimed(p.get(), context);
+    else
       p->Display(context);
   }
+}
 
-  DataLock.unlock();
+// Displays a record whose latency is measured (see Logger::SetLogStatisticsTiming)
+void Channel::DisplayTimed(Backend* backend, Context& context)
+{
+  uint64_t started = ReadTimingTicks();
+  backend->Display(context);
+  Owner->RecordLogBackendTiming(context, this, backend, ReadTimingTicks() - started);
 }
 
 bool Channel::IsIdle()
@@ -280,6 +452,7 @@ void Channel::RemoveBackends()
 
   BackendCount.store(0, std::memory_order_relaxed);
   UpdateActive();
+  PublishDisplaySnapshot();
 }
 
 bool Channel::RemoveBackend(BackendPtr backend)
@@ -296,6 +469,7 @@ bool Channel::RemoveBackend(BackendPtr backend)
 
       BackendCount.store(Backends.size(), std::memory_order_relaxed);
       UpdateActive();
+      PublishDisplaySnapshot();
       return true;
     }
   }
@@ -321,6 +495,7 @@ void Channel::AddBackend(BackendPtr backend)
 
   BackendCount.store(Backends.size(), std::memory_order_relaxed);
   UpdateActive();
+  PublishDisplaySnapshot();
 }
 
 BackendPtr Channel::GetBackend(size_t index)
@@ -545,6 +720,16 @@ const char* Channel::ShortenerRun(
   return value;
 }
 
+uint64_t Channel::GetThreadNameGeneration()
+{
+  return ThreadNameGeneration.load(std::memory_order_acquire);
+}
+
+void Channel::BumpThreadNameGeneration()
+{
+  ThreadNameGeneration.fetch_add(1, std::memory_order_acq_rel);
+}
+
 void Channel::SetThreadName(uint64_t id, const char* name, bool log)
 {
   SetThreadName(id, name, log, nullptr);
@@ -558,6 +743,7 @@ void Channel::SetThreadName(
 )
 {
   std::lock_guard guard(DataLock);
+  BumpThreadNameGeneration();
 
   auto it = ThreadName.find(id);
   if (it != ThreadName.end())
@@ -620,6 +806,7 @@ const char* Channel::GetThreadName(
     if (it->second.Name.has_value() == false && it->second.Prev.has_value() == false)
     {
       ThreadName.erase(it);
+      BumpThreadNameGeneration();
       return nullptr;
     }
 
@@ -630,8 +817,10 @@ const char* Channel::GetThreadName(
         info.ForwardTransitionPrinted = it->second.ForwardTransitionPrinted;
     }
 
-    if (clear)
+    if (clear && it->second.Prev.has_value())
     {
+      // Transition is printed once; cached prefixes must not repeat it
+      BumpThreadNameGeneration();
       it->second.Prev.reset();
       it->second.ForwardTransitionPrinted = nullptr;
     }
@@ -163,6 +163,10 @@ bool Logger::LoadConfiguration(
   HomeDirectoryWatchDog.SetMaximalSize(hdc.MaximalSize);
   HomeDirectoryWatchDog.SetPeriodicity(hdc.CheckPeriodicity);
   HomeDirectoryWatchDog.SetExtensions(hdc.Extensions);
+
+  FileIndex->SetRescanInterval(hdc.FileIndexRescanInterval);
+  if (FileIndex->EnableWatch(hdc.WatchFileIndex) == false)
+    LogmeW(CHINT, "file index: inotify watch is not available");
   
   if (hdc.EnableWatchDog)
     HomeDirectoryWatchDog.Run();
@@ -73,10 +73,15 @@ struct HomeDirectoryConfig
   int CheckPeriodicity;
   std::vector<std::string> Extensions;
 
+  bool WatchFileIndex;
+  uint64_t FileIndexRescanInterval;
+
   HomeDirectoryConfig()
     : EnableWatchDog(false)
     , MaximalSize(0)
     , CheckPeriodicity(0)
+    , WatchFileIndex(false)
+    , FileIndexRescanInterval(Logme::LogFileIndex::RESCAN_INTERVAL_DEFAULT)
   {
   }
 };
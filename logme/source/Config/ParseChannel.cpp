@@ -349,6 +349,8 @@ void Logger::ReplaceChannels(ChannelConfigArray& arr)
     }
   }
 
+  PublishChannelLookupSnapshot();
+
   CreateDefaultChannelLayout(false);
 }
 
@@ -74,6 +74,28 @@ bool ParseControlConfig(const Json::Value& root, ControlConfig& cc)
     }
   }
 
+  if (o.isMember("maxConnections"))
+  {
+    if (!o["maxConnections"].isInt() || o["maxConnections"].asInt() < 0)
+    {
+      LogmeE(CHINT, "\"control.maxConnections\" is not a non-negative integer value");
+      return false;
+    }
+
+    cc.MaxConnections = o["maxConnections"].asInt();
+  }
+
+  if (o.isMember("idleTimeout"))
+  {
+    if (!o["idleTimeout"].isInt() || o["idleTimeout"].asInt() < 0)
+    {
+      LogmeE(CHINT, "\"control.idleTimeout\" is not a non-negative integer value");
+      return false;
+    }
+
+    cc.IdleTimeout = o["idleTimeout"].asInt();
+  }
+
   if (o.isMember("discovery"))
   {
     auto& d = o["discovery"];
@@ -26,6 +26,15 @@ static NAMED_VALUE TimeStampValues[] =
   {nullptr, 0}
 };
 
+static NAMED_VALUE TimePrecisionValues[] =
+{
+  {"", TIME_PRECISION_MILLISECONDS},
+  {"ms", TIME_PRECISION_MILLISECONDS},
+  {"us", TIME_PRECISION_MICROSECONDS},
+  {"ns", TIME_PRECISION_NANOSECONDS},
+  {nullptr, 0}
+};
+
 static NAMED_VALUE LocationValues[] =
 {
   {"", DETALITY_NONE},
@@ -137,6 +146,7 @@ bool ParseStructuredFieldNames(const Json::Value& root)
 static FLAG_CONFIG FlagConfig[] =
 {
   {"timestamp", TimeStampValues, [](OutputFlags& f, int v) {f.Timestamp = v; } },
+  {"timeprecision", TimePrecisionValues, [](OutputFlags& f, int v) {f.TimestampPrecision = v; } },
   {"signature", nullptr, [](OutputFlags& f, int v) {f.Signature = v; } },
   {"location", LocationValues, [](OutputFlags& f, int v) {f.Location = v; } },
   {"method", nullptr, [](OutputFlags& f, int v) {f.Method = v; } },
@@ -38,6 +38,39 @@ bool ParseHomeDirectoryConfig(
     hdc.HomeDirectory = ProcessTemplate(str.c_str(), param);
   }
 
+  if (c.isMember("file-index"))
+  {
+    auto& index = c["file-index"];
+
+    if (!index.isObject())
+    {
+      LogmeE(CHINT, "\"home-directory[\"file-index\"]\" is not an object");
+      return false;
+    }
+
+    if (index.isMember("watch"))
+    {
+      if (index["watch"].isBool() == false)
+      {
+        LogmeE(CHINT, "\"file-index[\"watch\"]\" is not a boolean");
+        return false;
+      }
+
+      hdc.WatchFileIndex = index["watch"].asBool();
+    }
+
+    if (index.isMember("rescan-interval"))
+    {
+      if (index["rescan-interval"].isString() == false && index["rescan-interval"].isInt() == false)
+      {
+        LogmeE(CHINT, "\"file-index[\"rescan-interval\"]\" is not a string or integer");
+        return false;
+      }
+
+      hdc.FileIndexRescanInterval = GetInterval(index, "rescan-interval", hdc.FileIndexRescanInterval);
+    }
+  }
+
   if (!c.isMember("watch-dog"))
     return true;
 
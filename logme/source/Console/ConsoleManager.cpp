@@ -1,5 +1,7 @@
 #include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <climits>
 #include <cstring>
 
 #include <Logme/AnsiColorEscape.h>
@@ -7,8 +9,88 @@
 #include <Logme/File/exe_path.h>
 #include <Logme/Utils.h>
 
+#ifndef _WIN32
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
 using namespace Logme;
 
+namespace
+{
+  // Internal record flag: the cells up to the end of the ring are skipped
+  const uint8_t CONSOLE_RECORD_PADDING = 0x80;
+
+#ifdef _WIN32
+  struct TextSegment
+  {
+    void* iov_base;
+    size_t iov_len;
+  };
+#else
+  typedef iovec TextSegment;
+#endif
+
+#if defined(IOV_MAX)
+  const size_t SEGMENT_LIMIT = IOV_MAX;
+#else
+  const size_t SEGMENT_LIMIT = 16;
+#endif
+
+  void WriteSegments(FILE* stream, TextSegment* segments, size_t count)
+  {
+#ifdef _WIN32
+    for (size_t i = 0; i < count; i++)
+      fwrite(segments[i].iov_base, 1, segments[i].iov_len, stream);
+#else
+    // Text written by stdio must reach the descriptor first
+    fflush(stream);
+    int fd = fileno(stream);
+
+    size_t i = 0;
+    while (i < count)
+    {
+      int n = (int)(std::min)(count - i, SEGMENT_LIMIT);
+      ssize_t rc = writev(fd, segments + i, n);
+      if (rc < 0 && errno == EINTR)
+        continue;
+
+      if (rc <= 0)
+      {
+        // Non-blocking or broken descriptor: leave it to stdio
+        for (; i < count; i++)
+          fwrite(segments[i].iov_base, 1, segments[i].iov_len, stream);
+
+        return;
+      }
+
+      size_t written = (size_t)rc;
+      while (i < count && written >= segments[i].iov_len)
+      {
+        written -= segments[i].iov_len;
+        i++;
+      }
+
+      if (written != 0)
+      {
+        segments[i].iov_base = (char*)segments[i].iov_base + written;
+        segments[i].iov_len -= written;
+      }
+    }
+#endif
+  }
+
+#if CONSOLE_ENABLE_COUNTERS
+  void UpdateMax(std::atomic<uint64_t>& value, uint64_t n)
+  {
+    uint64_t current = value.load(std::memory_order_relaxed);
+    while (current < n && !value.compare_exchange_weak(current, n, std::memory_order_relaxed))
+    {
+    }
+  }
+#endif
+}
+
 std::atomic<size_t> ConsoleManager::MaxRecords { ConsoleBackend::QUEUE_RECORD_LIMIT };
 std::atomic<size_t> ConsoleManager::MaxBytes { ConsoleBackend::QUEUE_BYTE_LIMIT };
 std::atomic<ConsoleOverflowPolicy> ConsoleManager::OverflowPolicy { ConsoleOverflowPolicy::BLOCK };
@@ -17,18 +99,41 @@ ConsoleManager::ConsoleManager()
   : StopRequested(false)
   , Reschedule(false)
   , WorkerRunning(false)
-  , Processing(false)
-  , QueuedRecords(0)
-  , QueuedBytes(0)
+  , Sleeping(false)
   , NotFullWaiters(0)
   , IdleWaiters(0)
+  , CellMask(0)
+  , Head(0)
+  , Tail(0)
+  , QueuedRecords(0)
+  , QueuedBytes(0)
+  , ReadPos(0)
+  , InFlight(false)
 #if CONSOLE_ENABLE_COUNTERS
   , Counters{}
 #endif
   , RedirectStdoutChecked(false)
   , RedirectStderrChecked(false)
 {
-  Buffer.reserve(256 * 1024);
+  // The ring is sized by the byte limit at creation time. If the limit is
+  // raised later, the ring size still bounds the queue.
+  size_t bytes = MaxBytes.load(std::memory_order_relaxed);
+  if (bytes == 0)
+    bytes = ConsoleBackend::QUEUE_BYTE_LIMIT;
+
+  size_t ring = MIN_RING_SIZE;
+  while (ring < bytes && ring < MAX_RING_SIZE)
+    ring <<= 1;
+
+  size_t cells = ring / CELL_SIZE;
+  CellMask = cells - 1;
+  Cells.reset(new char[ring]);
+  Sequence.reset(new std::atomic<uint64_t>[cells]);
+
+  for (size_t i = 0; i < cells; i++)
+    Sequence[i].store(0, std::memory_order_relaxed);
+
+  Batch.reserve(MAX_BATCH_RECORDS);
 }
 
 ConsoleManager::~ConsoleManager()
@@ -168,33 +273,181 @@ bool ConsoleManager::RemoveBackend(ConsoleBackend* backend)
   return empty;
 }
 
-bool ConsoleManager::HasSpace(size_t recordSize) const
+size_t ConsoleManager::GetCellCount(size_t bytes)
+{
+  return (bytes + CELL_SIZE - 1) / CELL_SIZE;
+}
+
+const char* ConsoleManager::GetRecordEscape(const ConsoleRecordHeader* header)
+{
+  if ((header->Flags & CONSOLE_RECORD_HIGHLIGHT) == 0)
+    return nullptr;
+
+  Level level = static_cast<Level>(header->ErrorLevel);
+  if (level < Level::LEVEL_WARN)
+    return nullptr;
+
+  return level == Level::LEVEL_WARN ? ANSI_YELLOW : ANSI_LIGHT_RED;
+}
+
+bool ConsoleManager::HasQuota(size_t recordSize) const
 {
   size_t maxRecords = MaxRecords.load(std::memory_order_relaxed);
   size_t maxBytes = MaxBytes.load(std::memory_order_relaxed);
+  size_t queuedRecords = QueuedRecords.load(std::memory_order_relaxed);
+  size_t queuedBytes = QueuedBytes.load(std::memory_order_relaxed);
 
-  bool recordsOk = maxRecords == 0 || QueuedRecords < maxRecords;
-  bool bytesOk = maxBytes == 0 || QueuedBytes == 0 || QueuedBytes + recordSize <= maxBytes;
+  bool recordsOk = maxRecords == 0 || queuedRecords < maxRecords;
+  bool bytesOk = maxBytes == 0 || queuedBytes == 0 || queuedBytes + recordSize <= maxBytes;
   return recordsOk && bytesOk;
 }
 
-bool ConsoleManager::DropOldest(size_t recordSize)
+bool ConsoleManager::HasSpace(size_t recordSize, uint64_t tail) const
+{
+  if (!HasQuota(recordSize))
+    return false;
+
+  // Room for the record and for a padding in front of it
+  uint64_t need = GetCellCount(recordSize);
+  return Head.load(std::memory_order_relaxed) - tail + 2 * need - 1 <= CellMask + 1;
+}
+
+bool ConsoleManager::ReserveQuota(size_t recordSize)
 {
-  while (!Buffer.empty() && !HasSpace(recordSize))
+  size_t maxRecords = MaxRecords.load(std::memory_order_relaxed);
+  size_t maxBytes = MaxBytes.load(std::memory_order_relaxed);
+
+  size_t records = QueuedRecords.fetch_add(1, std::memory_order_relaxed);
+  if (maxRecords != 0 && records >= maxRecords)
   {
-    auto header = reinterpret_cast<const ConsoleRecordHeader*>(Buffer.data());
-    if (header->Size == 0 || header->Size > Buffer.size())
+    QueuedRecords.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // An empty queue accepts a record longer than the byte limit
+  size_t bytes = QueuedBytes.fetch_add(recordSize, std::memory_order_relaxed);
+  if (maxBytes != 0 && bytes != 0 && bytes + recordSize > maxBytes)
+  {
+    ReleaseQuota(1, recordSize);
+    return false;
+  }
+
+  CONSOLE_CNT(UpdateMax(Counters.MaxQueuedRecords, records + 1));
+  CONSOLE_CNT(UpdateMax(Counters.MaxQueuedBytes, bytes + recordSize));
+  return true;
+}
+
+void ConsoleManager::ReleaseQuota(size_t records, size_t bytes)
+{
+  QueuedRecords.fetch_sub(records, std::memory_order_relaxed);
+  QueuedBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void ConsoleManager::PublishCell(uint64_t pos)
+{
+  Sequence[pos & CellMask].store(pos + 1, std::memory_order_release);
+}
+
+bool ConsoleManager::TryAppend(const ConsoleRecordHeader& header, const char* text)
+{
+  const uint64_t cells = CellMask + 1;
+  const uint64_t need = GetCellCount(header.Size);
+
+  uint64_t head = Head.load(std::memory_order_relaxed);
+  uint64_t pad = 0;
+
+  for (;;)
+  {
+    // A record is contiguous: when it does not fit before the end of the
+    // ring, the rest of the ring is taken by a padding record
+    uint64_t toEnd = cells - (head & CellMask);
+    pad = toEnd < need ? toEnd : 0;
+
+    if (head + pad + need - Tail.load(std::memory_order_acquire) > cells)
       return false;
 
-    CONSOLE_CNT(Counters.DroppedRecords++);
-    CONSOLE_CNT(Counters.DroppedBytes += header->Size);
+    if (Head.compare_exchange_weak(
+      head
+      , head + pad + need
+      , std::memory_order_relaxed
+      , std::memory_order_relaxed
+    ))
+    {
+      break;
+    }
+  }
 
-    Buffer.erase(Buffer.begin(), Buffer.begin() + header->Size);
-    QueuedRecords--;
-    QueuedBytes -= header->Size;
+  if (pad != 0)
+  {
+    ConsoleRecordHeader padding{};
+    padding.Size = static_cast<uint32_t>(pad * CELL_SIZE);
+    padding.Flags = CONSOLE_RECORD_PADDING;
+
+    memcpy(Cells.get() + (head & CellMask) * CELL_SIZE, &padding, sizeof(padding));
+    PublishCell(head);
+    head += pad;
   }
 
-  return HasSpace(recordSize);
+  char* p = Cells.get() + (head & CellMask) * CELL_SIZE;
+  memcpy(p, &header, sizeof(header));
+  memcpy(p + sizeof(header), text, header.TextSize);
+  PublishCell(head);
+  return true;
+}
+
+void ConsoleManager::WakeWorker()
+{
+  // Pairs with the fence in ManagementThread() before it goes to sleep
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (!Sleeping.load(std::memory_order_relaxed))
+    return;
+
+  if (!Sleeping.exchange(false, std::memory_order_relaxed))
+    return;
+
+  {
+    std::lock_guard lock(Lock);
+  }
+
+  CV.notify_one();
+}
+
+bool ConsoleManager::DropOldest(size_t recordSize)
+{
+  std::lock_guard lock(ReadLock);
+
+  uint64_t pos = ReadPos.load(std::memory_order_relaxed);
+  uint64_t head = Head.load(std::memory_order_acquire);
+
+  while (pos < head)
+  {
+    // Cells of a batch being written are released when it is done, so
+    // dropping more records would not make room
+    uint64_t tail = InFlight ? Tail.load(std::memory_order_relaxed) : pos;
+    if (HasSpace(recordSize, tail) || (InFlight && HasQuota(recordSize)))
+      break;
+
+    uint64_t cell = pos & CellMask;
+    if (Sequence[cell].load(std::memory_order_acquire) != pos + 1)
+      break;
+
+    auto header = reinterpret_cast<const ConsoleRecordHeader*>(Cells.get() + cell * CELL_SIZE);
+    if ((header->Flags & CONSOLE_RECORD_PADDING) == 0)
+    {
+      CONSOLE_CNT(Counters.DroppedRecords.fetch_add(1, std::memory_order_relaxed));
+      CONSOLE_CNT(Counters.DroppedBytes.fetch_add(header->Size, std::memory_order_relaxed));
+      ReleaseQuota(1, header->Size);
+    }
+
+    pos += GetCellCount(header->Size);
+  }
+
+  ReadPos.store(pos, std::memory_order_relaxed);
+  if (!InFlight)
+    Tail.store(pos, std::memory_order_release);
+
+  return HasSpace(recordSize, Tail.load(std::memory_order_relaxed));
 }
 
 bool ConsoleManager::Push(
@@ -247,88 +500,77 @@ bool ConsoleManager::PushRecord(
   header.Reserved = 0;
   header.ErrorLevel = level;
 
-  for (;;)
+  // A record longer than half of the ring might never find contiguous
+  // space. It is written directly after the records queued before it.
+  if (GetCellCount(recordSize) > (CellMask + 1) / 2)
   {
-    bool drainPending = false;
-    bool notifyWorker = false;
+    DrainPending();
+    ConsoleBackend::WriteText(
+      header.Target ? stderr : stdout
+      , text
+      , len
+      , GetRecordEscape(&header)
+    );
+    return true;
+  }
+
+  bool droppedOldest = false;
 
+  for (;;)
+  {
+    if (ReserveQuota(recordSize))
     {
-      std::unique_lock lock(Lock);
+      if (TryAppend(header, text))
+      {
+        WakeWorker();
+        return true;
+      }
+
+      ReleaseQuota(1, recordSize);
+    }
 
-      if (!HasSpace(recordSize))
+    ConsoleOverflowPolicy policy = forceBlock
+      ? ConsoleOverflowPolicy::BLOCK
+      : OverflowPolicy.load(std::memory_order_relaxed);
+
+    switch (policy)
+    {
+      case ConsoleOverflowPolicy::BLOCK:
       {
-        ConsoleOverflowPolicy policy = forceBlock
-          ? ConsoleOverflowPolicy::BLOCK
-          : OverflowPolicy.load(std::memory_order_relaxed);
+        CONSOLE_CNT(Counters.BlockedCalls.fetch_add(1, std::memory_order_relaxed));
 
-        switch (policy)
+        bool workerAvailable = false;
         {
-          case ConsoleOverflowPolicy::BLOCK:
-            CONSOLE_CNT(Counters.BlockedCalls++);
-            while (!HasSpace(recordSize) && !Stopping() && WorkerAvailableFastLocked())
-            {
-              WaitForSpaceLocked(lock);
-
-              if (!HasSpace(recordSize) && !Stopping() && !WorkerAvailableSlowLocked())
-                break;
-            }
-
-            if (!HasSpace(recordSize))
-            {
-              drainPending = true;
-              break;
-            }
-            break;
-
-          case ConsoleOverflowPolicy::DROP_NEW:
-            CONSOLE_CNT(Counters.DroppedRecords++);
-            CONSOLE_CNT(Counters.DroppedBytes += recordSize);
-            return true;
-
-          case ConsoleOverflowPolicy::DROP_OLDEST:
-            if (!DropOldest(recordSize))
-            {
-              CONSOLE_CNT(Counters.DroppedRecords++);
-              CONSOLE_CNT(Counters.DroppedBytes += recordSize);
-              return true;
-            }
-            break;
+          std::lock_guard lock(Lock);
+          workerAvailable = !Stopping()
+            && WorkerAvailableFastLocked()
+            && WorkerAvailableSlowLocked();
         }
+
+        if (workerAvailable)
+          WaitForSpace(recordSize);
+        else
+          DrainPending();
+
+        break;
       }
 
-      if (!drainPending)
-      {
-        const bool wasEmpty = Buffer.empty();
-        size_t oldSize = Buffer.size();
-        Buffer.resize(oldSize + recordSize);
-        memcpy(Buffer.data() + oldSize, &header, sizeof(header));
-        memcpy(Buffer.data() + oldSize + sizeof(header), text, len);
-
-        QueuedRecords++;
-        QueuedBytes += recordSize;
-        CONSOLE_CNT(Counters.QueuedRecords = QueuedRecords);
-        CONSOLE_CNT(Counters.QueuedBytes = QueuedBytes);
-        CONSOLE_CNT(Counters.MaxQueuedRecords = std::max<uint64_t>(Counters.MaxQueuedRecords, QueuedRecords));
-        CONSOLE_CNT(Counters.MaxQueuedBytes = std::max<uint64_t>(Counters.MaxQueuedBytes, QueuedBytes));
-
-        if (wasEmpty && !Processing)
+      case ConsoleOverflowPolicy::DROP_NEW:
+        CONSOLE_CNT(Counters.DroppedRecords.fetch_add(1, std::memory_order_relaxed));
+        CONSOLE_CNT(Counters.DroppedBytes.fetch_add(recordSize, std::memory_order_relaxed));
+        return true;
+
+      case ConsoleOverflowPolicy::DROP_OLDEST:
+        if (!droppedOldest && DropOldest(recordSize))
         {
-          Reschedule = true;
-          notifyWorker = true;
+          droppedOldest = true;
+          break;
         }
-      }
-    }
 
-    if (drainPending)
-    {
-      DrainPending();
-      continue;
+        CONSOLE_CNT(Counters.DroppedRecords.fetch_add(1, std::memory_order_relaxed));
+        CONSOLE_CNT(Counters.DroppedBytes.fetch_add(recordSize, std::memory_order_relaxed));
+        return true;
     }
-
-    if (notifyWorker)
-      CV.notify_one();
-
-    return true;
   }
 }
 
@@ -415,63 +657,23 @@ bool ConsoleManager::AppendRedirected(
     backend->AppendString(text, len);
   }
 
-  {
-    std::lock_guard lock(Lock);
-    CONSOLE_CNT(Counters.RedirectedRecords++);
-    CONSOLE_CNT(Counters.RedirectedBytes += len);
-  }
+  CONSOLE_CNT(Counters.RedirectedRecords.fetch_add(1, std::memory_order_relaxed));
+  CONSOLE_CNT(Counters.RedirectedBytes.fetch_add(len, std::memory_order_relaxed));
 
   return true;
 }
 
 void ConsoleManager::Flush()
 {
+  DrainPending();
+
   FileBackendPtr stdoutBackend;
   FileBackendPtr stderrBackend;
 
-  for (;;)
   {
-    bool drainPending = false;
-
-    {
-      std::unique_lock lock(Lock);
-
-      if (Processing && WorkerAvailableFastLocked())
-      {
-        WaitForIdleLocked(lock);
-
-        if (Processing && !WorkerAvailableSlowLocked())
-        {
-          Processing = false;
-          NotifyNotFullLocked();
-          NotifyIdleLocked();
-        }
-
-        continue;
-      }
-
-      if (Processing)
-      {
-        Processing = false;
-        NotifyNotFullLocked();
-        NotifyIdleLocked();
-        continue;
-      }
-
-      if (!Buffer.empty())
-      {
-        drainPending = true;
-      }
-      else
-      {
-        stdoutBackend = RedirectStdout;
-        stderrBackend = RedirectStderr;
-        break;
-      }
-    }
-
-    if (drainPending)
-      DrainPending();
+    std::lock_guard lock(Lock);
+    stdoutBackend = RedirectStdout;
+    stderrBackend = RedirectStderr;
   }
 
   if (stdoutBackend)
@@ -483,8 +685,7 @@ void ConsoleManager::Flush()
 
 bool ConsoleManager::Empty() const
 {
-  std::lock_guard lock(Lock);
-  return Buffer.empty() && !Processing;
+  return Tail.load(std::memory_order_acquire) == Head.load(std::memory_order_acquire);
 }
 
 void ConsoleManager::NotifySettingsChanged()
@@ -507,8 +708,17 @@ void ConsoleManager::SetOverflowPolicy(ConsoleOverflowPolicy policy)
 ConsoleQueueCounters ConsoleManager::GetCounters() const
 {
 #if CONSOLE_ENABLE_COUNTERS
-  std::lock_guard lock(Lock);
-  return Counters;
+  ConsoleQueueCounters counters{};
+  counters.QueuedRecords = QueuedRecords.load(std::memory_order_relaxed);
+  counters.QueuedBytes = QueuedBytes.load(std::memory_order_relaxed);
+  counters.MaxQueuedRecords = Counters.MaxQueuedRecords.load(std::memory_order_relaxed);
+  counters.MaxQueuedBytes = Counters.MaxQueuedBytes.load(std::memory_order_relaxed);
+  counters.DroppedRecords = Counters.DroppedRecords.load(std::memory_order_relaxed);
+  counters.DroppedBytes = Counters.DroppedBytes.load(std::memory_order_relaxed);
+  counters.BlockedCalls = Counters.BlockedCalls.load(std::memory_order_relaxed);
+  counters.RedirectedRecords = Counters.RedirectedRecords.load(std::memory_order_relaxed);
+  counters.RedirectedBytes = Counters.RedirectedBytes.load(std::memory_order_relaxed);
+  return counters;
 #else
   return ConsoleQueueCounters{};
 #endif
@@ -547,67 +757,150 @@ bool ConsoleManager::WorkerAvailableSlowLocked()
 #endif
 }
 
-void ConsoleManager::WaitForSpaceLocked(std::unique_lock<std::mutex>& lock)
+void ConsoleManager::WaitForSpace(size_t recordSize)
 {
-  NotFullWaiters++;
-  NotFull.wait_for(
-    lock
-    , std::chrono::milliseconds(100)
-  );
-  NotFullWaiters--;
+  std::unique_lock lock(Lock);
+
+  // Pairs with the fence in NotifyNotFull()
+  NotFullWaiters.fetch_add(1, std::memory_order_seq_cst);
+
+  if (!HasSpace(recordSize, Tail.load(std::memory_order_acquire)) && !Stopping())
+  {
+    NotFull.wait_for(
+      lock
+      , std::chrono::milliseconds(100)
+    );
+  }
+
+  NotFullWaiters.fetch_sub(1, std::memory_order_relaxed);
 }
 
-void ConsoleManager::WaitForIdleLocked(std::unique_lock<std::mutex>& lock)
+void ConsoleManager::WaitForIdleLocked(std::unique_lock<std::mutex>& lock, uint64_t pos)
 {
-  IdleWaiters++;
-  Idle.wait_for(
-    lock
-    , std::chrono::milliseconds(100)
-  );
-  IdleWaiters--;
+  // Pairs with the fence in NotifyIdle()
+  IdleWaiters.fetch_add(1, std::memory_order_seq_cst);
+
+  if (Tail.load(std::memory_order_acquire) < pos)
+  {
+    Idle.wait_for(
+      lock
+      , std::chrono::milliseconds(100)
+    );
+  }
+
+  IdleWaiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ConsoleManager::NotifyNotFull()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (NotFullWaiters.load(std::memory_order_relaxed) == 0)
+    return;
+
+  std::lock_guard lock(Lock);
+  NotFull.notify_all();
 }
 
 void ConsoleManager::NotifyNotFullLocked()
 {
-  if (NotFullWaiters != 0)
+  if (NotFullWaiters.load(std::memory_order_relaxed) != 0)
     NotFull.notify_all();
 }
 
+void ConsoleManager::NotifyIdle()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (IdleWaiters.load(std::memory_order_relaxed) == 0)
+    return;
+
+  std::lock_guard lock(Lock);
+  Idle.notify_all();
+}
+
 void ConsoleManager::NotifyIdleLocked()
 {
-  if (IdleWaiters != 0)
+  if (IdleWaiters.load(std::memory_order_relaxed) != 0)
     Idle.notify_all();
 }
 
 void ConsoleManager::DrainPending()
 {
-  for (;;)
-  {
-    std::vector<unsigned char> buffer;
+  DrainUntil(Head.load(std::memory_order_acquire));
+}
 
+void ConsoleManager::DrainUntil(uint64_t pos)
+{
+  // Returns when the records reserved before pos are written. They are
+  // written by the worker if it runs, otherwise by the caller.
+  while (Tail.load(std::memory_order_acquire) < pos)
+  {
     {
-      std::lock_guard lock(Lock);
+      std::unique_lock lock(Lock);
+      if (WorkerAvailableFastLocked() && WorkerAvailableSlowLocked())
+      {
+        WaitForIdleLocked(lock, pos);
+        continue;
+      }
+    }
 
-      if (Buffer.empty())
-        break;
+    // Nothing published yet: a producer is still copying its record
+    if (!ProcessBatch())
+      std::this_thread::yield();
+  }
+}
 
-      buffer.swap(Buffer);
-      Processing = true;
-      QueuedRecords = 0;
-      QueuedBytes = 0;
-      CONSOLE_CNT(Counters.QueuedRecords = 0);
-      CONSOLE_CNT(Counters.QueuedBytes = 0);
-      NotifyNotFullLocked();
-    }
+bool ConsoleManager::ProcessBatch()
+{
+  std::lock_guard writer(WriterLock);
+
+  {
+    std::lock_guard lock(ReadLock);
 
-    ProcessBuffer(buffer);
+    uint64_t start = ReadPos.load(std::memory_order_relaxed);
+    uint64_t head = Head.load(std::memory_order_acquire);
+    uint64_t pos = start;
+    size_t bytes = 0;
 
+    while (pos < head && Batch.size() < MAX_BATCH_RECORDS)
     {
-      std::lock_guard lock(Lock);
-      Processing = false;
-      NotifyIdleLocked();
+      uint64_t cell = pos & CellMask;
+      if (Sequence[cell].load(std::memory_order_acquire) != pos + 1)
+        break;
+
+      auto header = reinterpret_cast<const ConsoleRecordHeader*>(Cells.get() + cell * CELL_SIZE);
+      if ((header->Flags & CONSOLE_RECORD_PADDING) == 0)
+      {
+        Batch.push_back(RingRecord{header, reinterpret_cast<const char*>(header + 1)});
+        bytes += header->Size;
+      }
+
+      pos += GetCellCount(header->Size);
     }
+
+    if (pos == start)
+      return false;
+
+    ReadPos.store(pos, std::memory_order_relaxed);
+    InFlight = true;
+    ReleaseQuota(Batch.size(), bytes);
+  }
+
+  NotifyNotFull();
+
+  if (!Batch.empty())
+    WriteBatch(Batch);
+
+  Batch.clear();
+
+  {
+    std::lock_guard lock(ReadLock);
+    InFlight = false;
+    Tail.store(ReadPos.load(std::memory_order_relaxed), std::memory_order_release);
   }
+
+  NotifyNotFull();
+  NotifyIdle();
+  return true;
 }
 
 void ConsoleManager::SetStopping()
@@ -651,60 +944,45 @@ void ConsoleManager::Notify(ConsoleBackend* backend)
   CV.notify_one();
 }
 
-void ConsoleManager::ProcessBuffer(std::vector<unsigned char>& buffer)
+void ConsoleManager::WriteBatch(const std::vector<RingRecord>& records)
 {
-  const unsigned char* pos = buffer.data();
-  const unsigned char* end = pos + buffer.size();
+  // Plain records of one stream go out with a single writev()
+  TextSegment segments[MAX_BATCH_RECORDS];
+  size_t count = 0;
   FILE* batchStream = nullptr;
-  std::string batch;
   std::unique_lock<std::mutex> outputLock(ConsoleBackend::GetOutputLock());
 
-  auto flushPlainBatch = [&batchStream, &batch]()
+  auto flushPlainBatch = [&segments, &count, &batchStream]()
   {
-    if (!batch.empty() && batchStream)
-      ConsoleBackend::WriteTextUnlocked(batchStream, batch.data(), batch.size(), nullptr);
+    if (count != 0 && batchStream)
+      WriteSegments(batchStream, segments, count);
 
-    batch.clear();
+    count = 0;
     batchStream = nullptr;
   };
 
-  while (pos < end)
+  for (const RingRecord& record : records)
   {
-    if (static_cast<size_t>(end - pos) < sizeof(ConsoleRecordHeader))
-      break;
-
-    auto header = reinterpret_cast<const ConsoleRecordHeader*>(pos);
-    if (header->Size < sizeof(ConsoleRecordHeader) || pos + header->Size > end)
-      break;
-
-    const char* text = reinterpret_cast<const char*>(pos + sizeof(ConsoleRecordHeader));
+    const ConsoleRecordHeader* header = record.Header;
     FILE* stream = header->Target ? stderr : stdout;
-    const bool highlight = (header->Flags & CONSOLE_RECORD_HIGHLIGHT) != 0;
-    const bool hasAnsi = memchr(text, '\x1b', header->TextSize) != nullptr;
-    const char* escape = nullptr;
-
-    if (highlight)
-    {
-      Level level = static_cast<Level>(header->ErrorLevel);
-      if (level >= Level::LEVEL_WARN)
-        escape = level == Level::LEVEL_WARN ? ANSI_YELLOW : ANSI_LIGHT_RED;
-    }
+    const bool hasAnsi = memchr(record.Text, '\x1b', header->TextSize) != nullptr;
+    const char* escape = GetRecordEscape(header);
 
-    if (!highlight && !hasAnsi)
+    if (!escape && !hasAnsi)
     {
       if (batchStream != stream)
         flushPlainBatch();
 
       batchStream = stream;
-      batch.append(text, header->TextSize);
+      segments[count].iov_base = const_cast<char*>(record.Text);
+      segments[count].iov_len = header->TextSize;
+      count++;
     }
     else
     {
       flushPlainBatch();
-      ConsoleBackend::WriteTextUnlocked(stream, text, header->TextSize, escape);
+      ConsoleBackend::WriteTextUnlocked(stream, record.Text, header->TextSize, escape);
     }
-
-    pos += header->Size;
   }
 
   flushPlainBatch();
@@ -716,49 +994,46 @@ void ConsoleManager::ManagementThread()
 
   for (;;)
   {
-    std::vector<unsigned char> buffer;
-    bool stopping = false;
+    if (ProcessBatch())
+      continue;
 
+    // A record is reserved but not published yet
+    if (Head.load(std::memory_order_acquire) != ReadPos.load(std::memory_order_relaxed))
     {
-      std::unique_lock<std::mutex> lock(Lock);
-      CV.wait(lock, [this]() { return StopRequested.load(std::memory_order_relaxed) || Reschedule || !Buffer.empty(); });
-
-      Reschedule = false;
-      stopping = StopRequested.load(std::memory_order_relaxed);
-      buffer.swap(Buffer);
-      Processing = !buffer.empty();
-      QueuedRecords = 0;
-      QueuedBytes = 0;
-      CONSOLE_CNT(Counters.QueuedRecords = 0);
-      CONSOLE_CNT(Counters.QueuedBytes = 0);
-      NotifyNotFullLocked();
+      std::this_thread::yield();
+      continue;
     }
 
-    if (!buffer.empty())
-      ProcessBuffer(buffer);
+    if (StopRequested.load(std::memory_order_relaxed))
+      break;
+
+    // Pairs with the fence in WakeWorker(): either the producer sees the
+    // flag or the worker sees the new head
+    Sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
 
+    if (Head.load(std::memory_order_relaxed) != ReadPos.load(std::memory_order_relaxed))
     {
-      std::lock_guard<std::mutex> lock(Lock);
-      Processing = false;
-      NotifyIdleLocked();
+      Sleeping.store(false, std::memory_order_relaxed);
+      continue;
     }
 
-    if (stopping)
+    std::unique_lock<std::mutex> lock(Lock);
+    CV.wait(lock, [this]()
     {
-      std::lock_guard<std::mutex> lock(Lock);
-      if (Buffer.empty())
-        break;
+      return StopRequested.load(std::memory_order_relaxed)
+        || Reschedule
+        || !Sleeping.load(std::memory_order_relaxed);
+    });
 
-      Reschedule = true;
-    }
+    Reschedule = false;
+    Sleeping.store(false, std::memory_order_relaxed);
   }
 
   {
     std::lock_guard<std::mutex> lock(Lock);
     WorkerRunning.store(false, std::memory_order_relaxed);
-    Processing = false;
     NotifyNotFullLocked();
     NotifyIdleLocked();
   }
 }
-
@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <ctime>
 #include <string>
 #include <string.h>
 
@@ -10,10 +13,12 @@
 
 #include <Logme/Channel.h>
 #include <Logme/Context.h>
+#include <Logme/DeferredFormat.h>
 #include <Logme/ThreadField.h>
 #include <Logme/Time/datetime.h>
 #include <Logme/Utils.h>
 
+#include "LogStatisticsInternal.h"
 #include "StringHelpers.h"
 
 #ifdef _WIN32
@@ -52,6 +57,86 @@ namespace
     return repeated;
   }
 
+  // FNV-1a. Bytes are hashed one by one, so the hash of a normalized message
+  // does not depend on how the normalizer splits it into pieces.
+  struct KeyHash
+  {
+    uint64_t Value = 14695981039346656037ULL;
+
+    void Add(const char* text, size_t len)
+    {
+      uint64_t h = Value;
+      for (size_t i = 0; i < len; ++i)
+      {
+        h ^= (uint8_t)text[i];
+        h *= 1099511628211ULL;
+      }
+      Value = h;
+    }
+  };
+
+  bool IsDigit(char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  bool IsHexDigit(char c)
+  {
+    return IsDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+  }
+
+  bool IsWordChar(char c)
+  {
+    return IsDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+  }
+
+  bool IsDigitsPattern(const std::string& pattern)
+  {
+    return pattern == "\\d+"
+      || pattern == "\\d"
+      || pattern == "[0-9]+"
+      || pattern == "[0-9]"
+      || pattern == "[[:digit:]]+";
+  }
+
+  // Length of the volatile token at position i or zero: 0x-prefixed hex
+  // number, whole word of hex digits and dashes that contains a digit (hex
+  // ids, UUIDs, dates) or a run of decimal digits
+  size_t VolatileTokenLength(const char* text, size_t len, size_t i)
+  {
+    bool wordStart = i == 0 || !IsWordChar(text[i - 1]);
+
+    if (wordStart
+      && text[i] == '0'
+      && i + 2 < len
+      && (text[i + 1] == 'x' || text[i + 1] == 'X')
+      && IsHexDigit(text[i + 2]))
+    {
+      size_t n = 2;
+      while (i + n < len && IsHexDigit(text[i + n]))
+        ++n;
+
+      return n;
+    }
+
+    if (wordStart && IsHexDigit(text[i]))
+    {
+      bool digit = false;
+      size_t n = 0;
+      while (i + n < len && (IsHexDigit(text[i + n]) || text[i + n] == '-'))
+        digit |= IsDigit(text[i + n++]);
+
+      if (digit && (i + n == len || !IsWordChar(text[i + n])))
+        return n;
+    }
+
+    size_t n = 0;
+    while (i + n < len && IsDigit(text[i + n]))
+      ++n;
+
+    return n;
+  }
+
   const char* GetStructuredLevelName(Level level)
   {
     switch (level)
@@ -238,7 +323,6 @@ Context::Context(ContextCache& cache, Level level, const ID* ch, const SID* sid)
   , CollapseCache(nullptr)
   , CollapseRepeatCount(0)
   , Signature(0)
-  , ExtBufferSize(0)
   , TempBuffer(nullptr)
   , TempBufferSize(0)
   , TempBufferCapacity(0)
@@ -249,12 +333,12 @@ Context::Context(ContextCache& cache, Level level, const ID* ch, const SID* sid)
 
 CollapseContextCache::CollapseContextCache(uint64_t limit)
   : Mode(CollapseMode::COUNT)
+  , Normalizer(CollapseNormalizer::NONE)
   , Limit(limit)
   , IntervalMs(0)
-  , LastOutputTime(0)
-  , RepeatCount(0)
   , IgnoreRegexEnabled(false)
 {
+  InitSlots(1);
 }
 
 CollapseContextCache::CollapseContextCache(
@@ -262,40 +346,86 @@ CollapseContextCache::CollapseContextCache(
   , uint64_t intervalMs
 )
   : Mode(CollapseMode::TIME)
+  , Normalizer(CollapseNormalizer::NONE)
   , Limit(0)
   , IntervalMs(intervalMs)
-  , LastOutputTime(0)
-  , RepeatCount(0)
   , IgnoreRegexEnabled(false)
 {
+  InitSlots(1);
 }
 
-CollapseContextCache::CollapseContextCache(const char* ignoreRegex, uint64_t limit)
+CollapseContextCache::CollapseContextCache(
+  const char* ignoreRegex
+  , uint64_t limit
+  , uint32_t keys
+)
   : IgnoreRegexText(ignoreRegex ? ignoreRegex : "")
   , Mode(CollapseMode::COUNT)
+  , Normalizer(CollapseNormalizer::NONE)
   , Limit(limit)
   , IntervalMs(0)
-  , LastOutputTime(0)
-  , RepeatCount(0)
   , IgnoreRegexEnabled(false)
 {
   CompileIgnoreRegex();
+  InitSlots(keys);
 }
 
 CollapseContextCache::CollapseContextCache(
   const char* ignoreRegex
   , CollapseEveryTag
   , uint64_t intervalMs
+  , uint32_t keys
 )
   : IgnoreRegexText(ignoreRegex ? ignoreRegex : "")
   , Mode(CollapseMode::TIME)
+  , Normalizer(CollapseNormalizer::NONE)
   , Limit(0)
   , IntervalMs(intervalMs)
-  , LastOutputTime(0)
-  , RepeatCount(0)
   , IgnoreRegexEnabled(false)
 {
   CompileIgnoreRegex();
+  InitSlots(keys);
+}
+
+CollapseContextCache::CollapseContextCache(
+  CollapseNormalizer normalizer
+  , uint64_t limit
+  , uint32_t keys
+)
+  : Mode(CollapseMode::COUNT)
+  , Normalizer(normalizer == CollapseNormalizer::REGEX ? CollapseNormalizer::NONE : normalizer)
+  , Limit(limit)
+  , IntervalMs(0)
+  , IgnoreRegexEnabled(false)
+{
+  InitSlots(keys);
+}
+
+CollapseContextCache::CollapseContextCache(
+  CollapseNormalizer normalizer
+  , CollapseEveryTag
+  , uint64_t intervalMs
+  , uint32_t keys
+)
+  : Mode(CollapseMode::TIME)
+  , Normalizer(normalizer == CollapseNormalizer::REGEX ? CollapseNormalizer::NONE : normalizer)
+  , Limit(0)
+  , IntervalMs(intervalMs)
+  , IgnoreRegexEnabled(false)
+{
+  InitSlots(keys);
+}
+
+void CollapseContextCache::InitSlots(uint32_t keys)
+{
+  if (keys == 0)
+    keys = 1;
+  else if (keys > COLLAPSE_KEYS_MAX)
+    keys = COLLAPSE_KEYS_MAX;
+
+  Keys = keys;
+  NextSlot.store(0, std::memory_order_relaxed);
+  Slots.reset(new CollapseSlot[keys]);
 }
 
 void CollapseContextCache::CompileIgnoreRegex()
@@ -303,16 +433,81 @@ void CollapseContextCache::CompileIgnoreRegex()
   if (IgnoreRegexText.empty())
     return;
 
+  // The usual "ignore all numbers" expressions are handled without std::regex
+  if (IsDigitsPattern(IgnoreRegexText))
+  {
+    Normalizer = CollapseNormalizer::DIGITS;
+    return;
+  }
+
   try
   {
     IgnoreRegex = std::regex(IgnoreRegexText);
     IgnoreRegexEnabled = true;
+    Normalizer = CollapseNormalizer::REGEX;
   }
   catch (const std::regex_error&)
   {
   }
 }
 
+uint64_t CollapseContextCache::CalcKeyHash(const char* text, size_t len) const
+{
+  KeyHash hash;
+
+  switch (Normalizer)
+  {
+  case CollapseNormalizer::REGEX:
+  {
+    std::string normalizedText = std::regex_replace(
+      std::string(text, len)
+      , IgnoreRegex
+      , ""
+    );
+    hash.Add(normalizedText.data(), normalizedText.size());
+    break;
+  }
+
+  case CollapseNormalizer::DIGITS:
+    for (size_t i = 0; i < len;)
+    {
+      size_t n = 0;
+      while (i + n < len && !IsDigit(text[i + n]))
+        ++n;
+
+      hash.Add(text + i, n);
+      i += n;
+
+      while (i < len && IsDigit(text[i]))
+        ++i;
+    }
+    break;
+
+  case CollapseNormalizer::VOLATILE:
+    for (size_t i = 0; i < len;)
+    {
+      size_t skip = VolatileTokenLength(text, len, i);
+      if (skip)
+      {
+        i += skip;
+        continue;
+      }
+
+      hash.Add(text + i, 1);
+      ++i;
+    }
+    break;
+
+  default:
+    hash.Add(text, len);
+    break;
+  }
+
+  // Zero marks an empty slot
+  uint64_t value = hash.Value;
+  return value ? value : 1;
+}
+
 Context::Context(
   ContextCache& cache
   , Level level
@@ -338,7 +533,6 @@ Context::Context(
   , CollapseCache(nullptr)
   , CollapseRepeatCount(0)
   , Signature(0)
-  , ExtBufferSize(0)
   , TempBuffer(nullptr)
   , TempBufferSize(0)
   , TempBufferCapacity(0)
@@ -354,10 +548,13 @@ Context::Context(
 
 void Context::InitContext()
 {
-  *Timestamp = '\0';
-  *ThreadProcessID = '\0';
+  if (ColdPart)
+  {
+    *ColdPart->Timestamp = '\0';
+    *ColdPart->ThreadProcessID = '\0';
+    *ColdPart->Buffer = '\0';
+  }
 
-  *Buffer = '\0';
   LastData = nullptr;
   LastLen = 0;
   TempBuffer = nullptr;
@@ -366,10 +563,118 @@ void Context::InitContext()
   LoggedBytesCounted = false;
   CollapseRepeatCount = 0;
   Applied.None = true;
+  DeferredFormat = nullptr;
+  DeferredArgs = nullptr;
+  DeferredArgsSize = 0;
+  TimedSite = nullptr;
+  ApplyTicks = 0;
+}
+
+namespace
+{
+  enum
+  {
+    COLD_POOL_SIZE = 4,                     // Cold parts kept per thread
+    COLD_TRIM_SIZE = 64 * 1024,             // Larger heap buffers are freed on release
+  };
+
+  // Free list of cold parts. It is trivially destructible, so it can be used
+  // without a TLS guard and even after the thread started to exit.
+  struct ColdPool
+  {
+    Context::Cold* Head;
+    unsigned Count;
+    bool Closed;
+  };
+
+  thread_local ColdPool Pool{};
+
+  struct ColdPoolCleanup
+  {
+    bool Registered = false;
+
+    ~ColdPoolCleanup()
+    {
+      Pool.Closed = true;
+
+      while (Pool.Head)
+      {
+        Context::Cold* cold = Pool.Head;
+        Pool.Head = cold->Next;
+        delete cold;
+      }
+
+      Pool.Count = 0;
+    }
+  };
+
+  // Touched only when a cold part enters the pool, so threads that never
+  // render a record do not register a TLS destructor
+  thread_local ColdPoolCleanup PoolCleanup;
+}
+
+Context::Cold::Cold()
+  : Next(nullptr)
+  , ExtBufferSize(0)
+{
+  *Timestamp = '\0';
+  *ThreadProcessID = '\0';
+  *Buffer = '\0';
+}
+
+void Context::ColdRelease::operator()(Cold* cold) const
+{
+  if (Pool.Closed || Pool.Count >= COLD_POOL_SIZE)
+  {
+    delete cold;
+    return;
+  }
+
+  if (cold->ExtBufferSize > COLD_TRIM_SIZE)
+  {
+    cold->ExtBuffer.reset();
+    cold->ExtBufferSize = 0;
+  }
+
+  if (cold->Storage.capacity() > COLD_TRIM_SIZE)
+    std::string().swap(cold->Storage);
+
+  // The part may come from another thread whose pool allocated it
+  if (Pool.Count == 0)
+    PoolCleanup.Registered = true;
+
+  cold->Next = Pool.Head;
+  Pool.Head = cold;
+  Pool.Count++;
+}
+
+Context::Cold& Context::AcquireCold()
+{
+  Cold* cold = Pool.Head;
+  if (cold)
+  {
+    Pool.Head = cold->Next;
+    Pool.Count--;
+
+    cold->Next = nullptr;
+    *cold->Timestamp = '\0';
+    *cold->ThreadProcessID = '\0';
+    *cold->Buffer = '\0';
+
+    // Method may not point to text shortened for a previous record
+    cold->MethodShortener = ShortenerContext();
+  }
+  else
+    cold = new Cold;
+
+  ColdPart.reset(cold);
+  return *cold;
 }
 
 void Context::SetText(const char* text)
 {
+  Cold& cold = GetCold();
+
   assert(TempBuffer == nullptr);
   assert(TempBufferSize == 0);
   assert(TempBufferCapacity == 0);
@@ -380,16 +685,16 @@ void Context::SetText(const char* text)
   size_t len = strlen(text);
   size_t capacity = len + 16;
 
-  Storage.reserve(capacity);
-  capacity = Storage.capacity();
-  Storage.resize(capacity);
+  cold.Storage.reserve(capacity);
+  capacity = cold.Storage.capacity();
+  cold.Storage.resize(capacity);
 
   if (len)
-    memcpy(Storage.data(), text, len);
+    memcpy(cold.Storage.data(), text, len);
 
-  Storage.data()[len] = '\0';
+  cold.Storage.data()[len] = '\0';
 
-  TempBuffer = Storage.data();
+  TempBuffer = cold.Storage.data();
   TempBufferSize = len;
   TempBufferCapacity = capacity;
 }
@@ -405,6 +710,31 @@ void Context::SetBuffer(const char* buffer, size_t size, size_t capacity)
   TempBufferCapacity = capacity;
 }
 
+void Context::SetDeferred(const char* format, const char* args, size_t size)
+{
+  assert(TempBuffer == nullptr);
+
+  DeferredFormat = format;
+  DeferredArgs = args;
+  DeferredArgsSize = size;
+}
+
+void Context::MaterializeDeferred()
+{
+  if (DeferredFormat == nullptr)
+    return;
+
+  std::string text;
+  if (!FormatDeferredArgs(DeferredFormat, DeferredArgs, DeferredArgsSize, text))
+    text = "[format error]";
+
+  DeferredFormat = nullptr;
+  DeferredArgs = nullptr;
+  DeferredArgsSize = 0;
+
+  SetText(text.c_str());
+}
+
 bool Context::ApplyCollapse()
 {
   CollapseRepeatCount = 0;
@@ -420,52 +750,60 @@ bool Context::ApplyCollapse()
     return true;
 
   const char* text = TempBuffer;
+  size_t len = TempBufferSize;
   if (text == nullptr)
+  {
     text = "";
+    len = 0;
+  }
+
+  uint64_t hash = collapseCache->CalcKeyHash(text, len);
 
-  const char* key = text;
-  std::string normalizedText;
-  if (collapseCache->IgnoreRegexEnabled)
+  CollapseSlot* slot = nullptr;
+  for (uint32_t i = 0; i < collapseCache->Keys; ++i)
   {
-    normalizedText = std::regex_replace(
-      std::string(text)
-      , collapseCache->IgnoreRegex
-      , ""
-    );
-    key = normalizedText.c_str();
+    if (collapseCache->Slots[i].Hash.load(std::memory_order_acquire) == hash)
+    {
+      slot = &collapseCache->Slots[i];
+      break;
+    }
   }
 
-  std::lock_guard guard(collapseCache->Lock);
-
-  if (collapseCache->LastKey != key)
+  if (slot == nullptr)
   {
-    collapseCache->LastKey = key;
-    collapseCache->LastOutputTime = GetTimeInMillisec64();
-    collapseCache->RepeatCount = 0;
+    // A new message starts its series in place of the oldest one
+    uint32_t index = collapseCache->NextSlot.fetch_add(1, std::memory_order_relaxed);
+    slot = &collapseCache->Slots[index % collapseCache->Keys];
+
+    uint64_t now = collapseCache->Mode == CollapseMode::TIME ? GetTimeInMillisec64() : 0;
+    slot->RepeatCount.store(0, std::memory_order_relaxed);
+    slot->LastOutputTime.store(now, std::memory_order_relaxed);
+    slot->Hash.store(hash, std::memory_order_release);
     return true;
   }
 
   if (collapseCache->Mode == CollapseMode::COUNT)
   {
-    ++collapseCache->RepeatCount;
-    if (collapseCache->RepeatCount < collapseCache->Limit)
+    // The counter is not reset: every Limit-th repeat writes the summary
+    uint64_t count = slot->RepeatCount.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (count % collapseCache->Limit != 0)
       return false;
 
-    CollapseRepeatCount = collapseCache->RepeatCount;
-    collapseCache->RepeatCount = 0;
+    CollapseRepeatCount = collapseCache->Limit;
     return true;
   }
 
   uint64_t now = GetTimeInMillisec64();
-  if (now - collapseCache->LastOutputTime < collapseCache->IntervalMs)
+  uint64_t last = slot->LastOutputTime.load(std::memory_order_relaxed);
+  if (now < last
+    || now - last < collapseCache->IntervalMs
+    || !slot->LastOutputTime.compare_exchange_strong(last, now, std::memory_order_relaxed))
   {
-    ++collapseCache->RepeatCount;
+    slot->RepeatCount.fetch_add(1, std::memory_order_relaxed);
     return false;
   }
 
-  CollapseRepeatCount = collapseCache->RepeatCount;
-  collapseCache->RepeatCount = 0;
-  collapseCache->LastOutputTime = now;
+  CollapseRepeatCount = slot->RepeatCount.exchange(0, std::memory_order_relaxed);
   return true;
 }
 
@@ -502,103 +840,164 @@ void Context::CreateTZD(char* tzd)
   snprintf(tzd, size_t(TZD_BUFFER_SIZE) - 1, "%+.02i:%02i ", (int)h, (int)m);
 } 
 
-void Context::InitTimestamp(TimeFormat tf)
+namespace
+{
+  // Date and time up to the seconds, formatted once per second by each thread.
+  struct TimestampPrefix
+  {
+    int64_t Second;
+    size_t Length;
+    char Text[Context::TIMESTAMP_BUFFER_SIZE];
+  };
+
+  const int FractionDigits[] = {3, 6, 9};
+  const uint32_t FractionDivider[] = {1000000, 1000, 1};
+}
+
+void Context::InitTimestamp(TimeFormat tf, TimePrecision precision)
 {
-  auto n = GetTimeInMillisec64();
+  Cold& cold = GetCold();
 
-  switch (tf)
-  {
-  case TimeFormat::TIME_FORMAT_LOCAL:
-  case TimeFormat::TIME_FORMAT_TZ:
+  if (tf != TIME_FORMAT_LOCAL && tf != TIME_FORMAT_TZ && tf != TIME_FORMAT_UTC)
   {
-    static std::mutex Lock;
-    static DateTime LastStamp{};
-    static std::uint64_t LastStampTicks = 0;
-    static char timestamp[TIMESTAMP_BUFFER_SIZE]{};
-
-    std::lock_guard lock(Lock);
+    assert(!"unexpected TimeFormat");
+    *cold.Timestamp = '\0';
+    return;
+  }
 
-    if (n != LastStampTicks)
-    {
-      DateTime stamp = DateTime::Now();
-
-      LastStamp = stamp;
-      LastStampTicks = n;
-
-      snprintf(
-        timestamp
-        , size_t(TIMESTAMP_BUFFER_SIZE) - 1
-        , "%04i-%02i-%02i %02i:%02i:%02i:%03i "
-        , stamp.GetYear()
-        , stamp.GetMonth()
-        , stamp.GetDay()
-        , stamp.GetHour()
-        , stamp.GetMinute()
-        , stamp.GetSecond()
-        , stamp.GetMillisecond()
-      );
-
-      timestamp[TIMESTAMP_BUFFER_SIZE - 1] = '\0';
-    }
+  // Per-thread cache: the reader never takes a lock and only the fraction digits are
+  // rewritten for records logged within the same second.
+  thread_local TimestampPrefix cache[TIME_FORMAT_UTC + 1] = {
+    {INT64_MIN, 0, {}}
+    , {INT64_MIN, 0, {}}
+    , {INT64_MIN, 0, {}}
+    , {INT64_MIN, 0, {}}
+  };
 
-    memcpy(Timestamp, timestamp, TIMESTAMP_BUFFER_SIZE);
-    break;
+  auto since = std::chrono::system_clock::now().time_since_epoch();
+  int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(since).count();
+  int64_t second = ns / 1000000000;
+  int64_t fraction = ns % 1000000000;
+  if (fraction < 0)
+  {
+    fraction += 1000000000;
+    second--;
   }
 
-  case TimeFormat::TIME_FORMAT_UTC:
+  TimestampPrefix& prefix = cache[tf];
+  if (prefix.Second != second)
   {
-    static std::mutex Lock;
-    static DateTime LastStamp;
-    static std::uint64_t LastStampTicks{};
-    static char timestamp[TIMESTAMP_BUFFER_SIZE]{};
+    time_t t = (time_t)second;
+    struct tm tmv {};
 
-    std::lock_guard lock(Lock);
+#ifdef _WIN32
+    if (tf == TIME_FORMAT_UTC)
+      gmtime_s(&tmv, &t);
+    else
+      localtime_s(&tmv, &t);
+#else
+    if (tf == TIME_FORMAT_UTC)
+      gmtime_r(&t, &tmv);
+    else
+      localtime_r(&t, &tmv);
+#endif
+
+    int n = snprintf(
+      prefix.Text
+      , sizeof(prefix.Text)
+      , "%04i-%02i-%02i %02i:%02i:%02i:"
+      , tmv.tm_year + 1900
+      , tmv.tm_mon + 1
+      , tmv.tm_mday
+      , tmv.tm_hour
+      , tmv.tm_min
+      , tmv.tm_sec
+    );
 
-    if (n != LastStampTicks)
+    prefix.Length = n > 0 ? (std::min)(size_t(n), sizeof(prefix.Text) - 1) : 0;
+    prefix.Second = second;
+
+    // TZ form has no fraction: YYYY-MM-DDThh:mm:ss+hh:mm
+    if (tf == TIME_FORMAT_TZ && prefix.Length > TZD_E_POS)
     {
-      DateTime stamp = DateTime::NowUtc();
-
-      LastStamp = stamp;
-      LastStampTicks = n;
-
-      snprintf(
-        timestamp
-        , size_t(TIMESTAMP_BUFFER_SIZE) - 1
-        , "%04i-%02i-%02i %02i:%02i:%02i:%03i "
-        , stamp.GetYear()
-        , stamp.GetMonth()
-        , stamp.GetDay()
-        , stamp.GetHour()
-        , stamp.GetMinute()
-        , stamp.GetSecond()
-        , stamp.GetMillisecond()
-      );
-
-      timestamp[TIMESTAMP_BUFFER_SIZE - 1] = '\0';
-    }
+      char tzd[TIMESTAMP_BUFFER_SIZE];
+      CreateTZD(tzd);
 
-    memcpy(Timestamp, timestamp, TIMESTAMP_BUFFER_SIZE);
-    break;
+      prefix.Text[TZD_T_POS] = 'T';
+      strcpy_s(prefix.Text + TZD_E_POS, size_t(TIMESTAMP_BUFFER_SIZE) - TZD_E_POS, tzd);
+      prefix.Length = strlen(prefix.Text);
+    }
   }
 
-  default:
-    assert(!"unexpected TimeFormat");
+  memcpy(cold.Timestamp, prefix.Text, prefix.Length);
+  if (tf == TIME_FORMAT_TZ)
+  {
+    cold.Timestamp[prefix.Length] = '\0';
+    return;
   }
 
-  if (tf == TimeFormat::TIME_FORMAT_TZ)
+  int p = precision <= TIME_PRECISION_NANOSECONDS ? precision : TIME_PRECISION_MILLISECONDS;
+  int digits = FractionDigits[p];
+  uint32_t value = uint32_t(fraction / FractionDivider[p]);
+
+  char* d = cold.Timestamp + prefix.Length;
+  if (prefix.Length + digits + 2 > size_t(TIMESTAMP_BUFFER_SIZE))
   {
-    char tzd[TIMESTAMP_BUFFER_SIZE];
-    CreateTZD(tzd);
+    *d = '\0';
+    return;
+  }
 
-    Timestamp[TZD_T_POS] = 'T';
-    strcpy_s(Timestamp + TZD_E_POS, size_t(TIMESTAMP_BUFFER_SIZE) - TZD_E_POS, tzd);
+  for (int i = digits - 1; i >= 0; i--)
+  {
+    d[i] = char('0' + value % 10);
+    value /= 10;
   }
+
+  d[digits] = ' ';
+  d[digits + 1] = '\0';
+}
+
+namespace
+{
+  // Formatted "[PID:TID/name] " of the current thread for recently used channels.
+  // Valid while Channel::GetThreadNameGeneration() is unchanged.
+  struct ThreadPrefix
+  {
+    const Channel* Ch;
+    uint64_t Generation;
+    uint32_t Flags;
+    size_t Length;
+    char Text[Context::TID_BUFFER_SIZE + Context::PID_BUFFER_SIZE + 1];
+  };
+
+  enum { THREAD_PREFIX_CACHE_SIZE = 4 };
 }
 
 void Context::InitThreadProcessID(const ChannelPtr& ch, OutputFlags flags)
 {
-  if ((flags.ProcessID || flags.ThreadID) && *ThreadProcessID == '\0')
+  Cold& cold = GetCold();
+
+  if ((flags.ProcessID || flags.ThreadID) && *cold.ThreadProcessID == '\0')
   {
+    thread_local ThreadPrefix cache[THREAD_PREFIX_CACHE_SIZE]{};
+    thread_local unsigned cacheNext = 0;
+
+    // Read before the lookup: a concurrent rename bumps it, so the entry
+    // stored below is never newer than the names it was built from
+    uint64_t generation = Channel::GetThreadNameGeneration();
+    uint32_t key = uint32_t(flags.ProcessID)
+      | (uint32_t(flags.ThreadID) << 1)
+      | (uint32_t(flags.ThreadTransition) << 2);
+
+    for (const ThreadPrefix& e : cache)
+    {
+      if (e.Ch == ch.get() && e.Generation == generation && e.Flags == key)
+      {
+        memcpy(cold.ThreadProcessID, e.Text, e.Length + 1);
+        return;
+      }
+    }
+
 #ifdef _WIN32
     auto thread = GetCurrentThreadId();
     static auto process = GetCurrentProcessId();
@@ -608,8 +1007,8 @@ void Context::InitThreadProcessID(const ChannelPtr& ch, OutputFlags flags)
     auto process = pid;
 #endif
 
-    char* p = ThreadProcessID;
-    size_t remaining = sizeof(ThreadProcessID) - 4; // '[', ']', ' ' and \0
+    char* p = cold.ThreadProcessID;
+    size_t remaining = sizeof(cold.ThreadProcessID) - 4; // '[', ']', ' ' and \0
     *p++ = '[';
 
     if (flags.ProcessID)
@@ -708,9 +1107,16 @@ void Context::InitThreadProcessID(const ChannelPtr& ch, OutputFlags flags)
     *p++ = ']';
     *p++ = ' ';
     *p = '\0';
+
+    ThreadPrefix& e = cache[cacheNext++ % THREAD_PREFIX_CACHE_SIZE];
+    e.Ch = ch.get();
+    e.Generation = generation;
+    e.Flags = key;
+    e.Length = size_t(p - cold.ThreadProcessID);
+    memcpy(e.Text, cold.ThreadProcessID, e.Length + 1);
   }
   else if (!(flags.ProcessID || flags.ThreadID))
-    *ThreadProcessID = '\0';
+    *cold.ThreadProcessID = '\0';
 }
 
 void Context::InitSignature()
@@ -728,21 +1134,23 @@ void Context::InitSignature()
 
 const char* Context::ApplyJson(const ChannelPtr& ch, OutputFlags flags, int& nc)
 {
+  Cold& cold = GetCold();
+
   if (Applied.Value == flags.Value)
   {
     nc = LastLen;
     return LastData;
   }
 
-  if (flags.Timestamp != TIME_FORMAT_NONE && *Timestamp == '\0')
-    InitTimestamp((TimeFormat)flags.Timestamp);
+  if (flags.Timestamp != TIME_FORMAT_NONE && *cold.Timestamp == '\0')
+    InitTimestamp((TimeFormat)flags.Timestamp, (TimePrecision)flags.TimestampPrecision);
 
   if (flags.Method && Method && !flags.ProcPrint)
   {
-    Method = ch->ShortenerRun(Method, MethodShortener);
+    Method = ch->ShortenerRun(Method, cold.MethodShortener);
 
     if (Ovr != nullptr)
-      Method = ch->ShortenerRun(Method, MethodShortener, *Ovr);
+      Method = ch->ShortenerRun(Method, cold.MethodShortener, *Ovr);
   }
 
   const char* appendText = nullptr;
@@ -756,8 +1164,8 @@ const char* Context::ApplyJson(const ChannelPtr& ch, OutputFlags flags, int& nc)
   bool first = true;
   if (flags.Timestamp != TIME_FORMAT_NONE)
   {
-    size_t len = TrimRight(Timestamp, strlen(Timestamp));
-    AppendJsonStringField(output, first, OUTPUT_FIELD_TIMESTAMP, Timestamp, len);
+    size_t len = TrimRight(cold.Timestamp, strlen(cold.Timestamp));
+    AppendJsonStringField(output, first, OUTPUT_FIELD_TIMESTAMP, cold.Timestamp, len);
   }
 
   if (flags.Signature)
@@ -816,16 +1224,16 @@ const char* Context::ApplyJson(const ChannelPtr& ch, OutputFlags flags, int& nc)
     output.push_back('\n');
 
   size_t required = output.size() + 1;
-  char* buffer = Buffer;
-  if (required > sizeof(Buffer))
+  char* buffer = cold.Buffer;
+  if (required > sizeof(cold.Buffer))
   {
-    if (ExtBufferSize < required)
+    if (cold.ExtBufferSize < required)
     {
-      ExtBuffer = std::make_unique<char[]>(required);
-      ExtBufferSize = required;
+      cold.ExtBuffer = std::make_unique<char[]>(required);
+      cold.ExtBufferSize = required;
     }
 
-    buffer = ExtBuffer.get();
+    buffer = cold.ExtBuffer.get();
   }
 
   memcpy(buffer, output.data(), output.size());
@@ -840,21 +1248,23 @@ const char* Context::ApplyJson(const ChannelPtr& ch, OutputFlags flags, int& nc)
 
 const char* Context::ApplyXml(const ChannelPtr& ch, OutputFlags flags, int& nc)
 {
+  Cold& cold = GetCold();
+
   if (Applied.Value == flags.Value)
   {
     nc = LastLen;
     return LastData;
   }
 
-  if (flags.Timestamp != TIME_FORMAT_NONE && *Timestamp == '\0')
-    InitTimestamp((TimeFormat)flags.Timestamp);
+  if (flags.Timestamp != TIME_FORMAT_NONE && *cold.Timestamp == '\0')
+    InitTimestamp((TimeFormat)flags.Timestamp, (TimePrecision)flags.TimestampPrecision);
 
   if (flags.Method && Method && !flags.ProcPrint)
   {
-    Method = ch->ShortenerRun(Method, MethodShortener);
+    Method = ch->ShortenerRun(Method, cold.MethodShortener);
 
     if (Ovr != nullptr)
-      Method = ch->ShortenerRun(Method, MethodShortener, *Ovr);
+      Method = ch->ShortenerRun(Method, cold.MethodShortener, *Ovr);
   }
 
   const char* appendText = nullptr;
@@ -867,8 +1277,8 @@ const char* Context::ApplyXml(const ChannelPtr& ch, OutputFlags flags, int& nc)
 
   if (flags.Timestamp != TIME_FORMAT_NONE)
   {
-    size_t len = TrimRight(Timestamp, strlen(Timestamp));
-    AppendXmlElement(output, OUTPUT_FIELD_TIMESTAMP, Timestamp, len);
+    size_t len = TrimRight(cold.Timestamp, strlen(cold.Timestamp));
+    AppendXmlElement(output, OUTPUT_FIELD_TIMESTAMP, cold.Timestamp, len);
   }
 
   if (flags.Signature)
@@ -926,16 +1336,16 @@ const char* Context::ApplyXml(const ChannelPtr& ch, OutputFlags flags, int& nc)
     output.push_back('\n');
 
   size_t required = output.size() + 1;
-  char* buffer = Buffer;
-  if (required > sizeof(Buffer))
+  char* buffer = cold.Buffer;
+  if (required > sizeof(cold.Buffer))
   {
-    if (ExtBufferSize < required)
+    if (cold.ExtBufferSize < required)
     {
-      ExtBuffer = std::make_unique<char[]>(required);
-      ExtBufferSize = required;
+      cold.ExtBuffer = std::make_unique<char[]>(required);
+      cold.ExtBufferSize = required;
     }
 
-    buffer = ExtBuffer.get();
+    buffer = cold.ExtBuffer.get();
   }
 
   memcpy(buffer, output.data(), output.size());
@@ -950,6 +1360,19 @@ const char* Context::ApplyXml(const ChannelPtr& ch, OutputFlags flags, int& nc)
 
 const char* Context::Apply(const ChannelPtr& ch, OutputFlags flags, int& nc)
 {
+  if (TimedSite == nullptr)
+    return ApplyFlags(ch, flags, nc);
+
+  uint64_t started = ReadTimingTicks();
+  const char* data = ApplyFlags(ch, flags, nc);
+  ApplyTicks += ReadTimingTicks() - started;
+  return data;
+}
+
+const char* Context::ApplyFlags(const ChannelPtr& ch, OutputFlags flags, int& nc)
+{
+  Cold& cold = GetCold();
+
   assert(TempBuffer != nullptr);
 
   const char* text = TempBuffer;
@@ -981,15 +1404,15 @@ const char* Context::Apply(const ChannelPtr& ch, OutputFlags flags, int& nc)
     return CountLoggedBytesAndReturn(*this, ch, nc, LastData);
   }
 
-  *Buffer = '\0';
+  *cold.Buffer = '\0';
 
   int nTimestamp = 0;
   if (flags.Timestamp != TIME_FORMAT_NONE)
   {
-    if (*Timestamp == '\0')
-      InitTimestamp((TimeFormat)flags.Timestamp);
+    if (*cold.Timestamp == '\0')
+      InitTimestamp((TimeFormat)flags.Timestamp, (TimePrecision)flags.TimestampPrecision);
 
-    nTimestamp = (int)strlen(Timestamp);
+    nTimestamp = (int)strlen(cold.Timestamp);
   }
 
   int nSignature = 0;
@@ -1004,10 +1427,10 @@ const char* Context::Apply(const ChannelPtr& ch, OutputFlags flags, int& nc)
   int nID = 0;
   if (flags.ProcessID || flags.ThreadID)
   {
-    if (*ThreadProcessID == '\0')
+    if (*cold.ThreadProcessID == '\0')
       InitThreadProcessID(ch, flags);
 
-    nID = (int)strlen(ThreadProcessID);
+    nID = (int)strlen(cold.ThreadProcessID);
   }
 
   int nChannel = 0;
@@ -1052,10 +1475,10 @@ const char* Context::Apply(const ChannelPtr& ch, OutputFlags flags, int& nc)
   int nMethod = 0;
   if (flags.Method && Method && !flags.ProcPrint)
   {
-    Method = ch->ShortenerRun(Method, MethodShortener);
+    Method = ch->ShortenerRun(Method, cold.MethodShortener);
 
     if (Ovr != nullptr)
-      Method = ch->ShortenerRun(Method, MethodShortener, *Ovr);
+      Method = ch->ShortenerRun(Method, cold.MethodShortener, *Ovr);
 
     nMethod = (int)strlen(Method) + 4; // "Method(): "
   }
@@ -1131,23 +1554,23 @@ const char* Context::Apply(const ChannelPtr& ch, OutputFlags flags, int& nc)
     }
   }
 
-  char* buffer = Buffer;
+  char* buffer = cold.Buffer;
   int n = nTimestamp + nSignature + nID + nChannel + nSubsystem + nFile + nError + nMethod + nRepeatPrefix + nLine + nAppend + nEol + 1;
-  if (n > (int)sizeof(Buffer))
+  if (n > (int)sizeof(cold.Buffer))
   {
-    if (ExtBufferSize < size_t(n))
+    if (cold.ExtBufferSize < size_t(n))
     {
-      ExtBuffer = std::make_unique<char[]>(size_t(n));
-      ExtBufferSize = size_t(n);
+      cold.ExtBuffer = std::make_unique<char[]>(size_t(n));
+      cold.ExtBufferSize = size_t(n);
     }
 
-    buffer = ExtBuffer.get();
+    buffer = cold.ExtBuffer.get();
   }
 
   char* p = buffer;
   if (nTimestamp)
   {
-    strcpy_s(p, n - (p - buffer), Timestamp);
+    strcpy_s(p, n - (p - buffer), cold.Timestamp);
     p += nTimestamp;
   }
 
@@ -1160,7 +1583,7 @@ const char* Context::Apply(const ChannelPtr& ch, OutputFlags flags, int& nc)
 
   if (nID)
   {
-    strcpy_s(p, n - (p - buffer), ThreadProcessID);
+    strcpy_s(p, n - (p - buffer), cold.ThreadProcessID);
     p += nID;
   }
 
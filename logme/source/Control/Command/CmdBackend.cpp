@@ -289,6 +289,7 @@ bool Logger::CommandBackend(Logme::StringArray& arr, std::string& response)
         auto fileConfig = std::dynamic_pointer_cast<FileBackendConfig>(config);
         auto sharedFileConfig = std::dynamic_pointer_cast<SharedFileBackendConfig>(config);
         auto bufferConfig = std::dynamic_pointer_cast<BufferBackendConfig>(config);
+        auto ringBufferConfig = std::dynamic_pointer_cast<RingBufferBackendConfig>(config);
 
         if (fileConfig)
         {
@@ -308,6 +309,18 @@ bool Logger::CommandBackend(Logme::StringArray& arr, std::string& response)
           continue;
         }
 
+        if (ringBufferConfig)
+        {
+          if (value == 0)
+          {
+            response = "error: invalid max size";
+            return true;
+          }
+
+          ringBufferConfig->MaxBytes = static_cast<size_t>(value);
+          continue;
+        }
+
         response = "error: --max-size is only supported by file and buffer backends";
         return true;
       }
@@ -30,6 +30,15 @@ static NamedValue TimeStampValues[] =
   {nullptr, 0}
 };
 
+static NamedValue TimePrecisionValues[] =
+{
+  {"", TIME_PRECISION_MILLISECONDS},
+  {"ms", TIME_PRECISION_MILLISECONDS},
+  {"us", TIME_PRECISION_MICROSECONDS},
+  {"ns", TIME_PRECISION_NANOSECONDS},
+  {nullptr, 0}
+};
+
 static NamedValue LocationValues[] =
 {
   {"", DETALITY_NONE},
@@ -245,6 +254,23 @@ bool Logger::CommandFlags(Logme::StringArray& arr, std::string& response)
       continue;
     }
 
+    if (name == "timeprecision")
+    {
+      int v = 0;
+      if (value.empty())
+      {
+        if (!DefaultEnumValue1(TimePrecisionValues, v))
+          v = TIME_PRECISION_MICROSECONDS;
+      }
+      else if (!FindNamed(TimePrecisionValues, value, v) && !ParseInt(value, v))
+      {
+        response = "error: invalid value for timeprecision: " + value;
+        return true;
+      }
+      f.TimestampPrecision = v;
+      continue;
+    }
+
     if (name == "location")
     {
       int v = 0;
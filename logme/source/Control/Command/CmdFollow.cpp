@@ -0,0 +1,333 @@
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <Logme/Channel.h>
+#include <Logme/Logger.h>
+#include <Logme/SID.h>
+#include <Logme/Utils.h>
+
+#include "../CommandRegistrar.h"
+#include "../ControlStream.h"
+#include "../FollowTap.h"
+
+using namespace Logme;
+
+COMMAND_DESCRIPTOR2("follow", Logger::CommandFollow);
+
+namespace
+{
+  // Delay between checks of the client connection and of the duration
+  const std::chrono::milliseconds FOLLOW_POLL_INTERVAL(200);
+
+  struct FollowOptions
+  {
+    std::vector<std::string> Channels;
+    std::vector<uint64_t> Subsystems;
+    Level MinLevel = LEVEL_DEBUG;
+    size_t MaxRecords = FollowSubscriber::DEFAULT_MAX_RECORDS;
+    uint64_t Count = 0;
+    uint64_t Duration = 0;
+    bool HasMatch = false;
+    std::regex Match;
+  };
+
+  bool ParseNumber(const std::string& text, uint64_t& value)
+  {
+    if (text.empty())
+      return false;
+
+    for (char ch : text)
+    {
+      if (!std::isdigit((unsigned char)ch))
+        return false;
+    }
+
+    value = (uint64_t)std::strtoull(text.c_str(), nullptr, 10);
+    return true;
+  }
+
+  bool ParseOptions(
+    Logme::StringArray& arr
+    , FollowOptions& options
+    , std::string& response
+  )
+  {
+    for (size_t i = 1; i < arr.size(); i++)
+    {
+      const std::string& option = arr[i];
+
+      // The expression is the rest of the command and may contain spaces.
+      // Commands arrive in lower case, so the match ignores case.
+      if (option == "--match")
+      {
+        std::string expression;
+        for (size_t j = i + 1; j < arr.size(); j++)
+        {
+          if (!expression.empty())
+            expression += " ";
+
+          expression += arr[j];
+        }
+
+        if (expression.empty())
+        {
+          response += "error: missing regular expression";
+          return false;
+        }
+
+        try
+        {
+          options.Match = std::regex(expression, std::regex::icase);
+          options.HasMatch = true;
+        }
+        catch (const std::regex_error&)
+        {
+          response += "error: invalid regular expression: " + expression;
+          return false;
+        }
+
+        break;
+      }
+
+      if (i + 1 >= arr.size())
+      {
+        response += "error: missing value of " + option;
+        return false;
+      }
+
+      const std::string& value = arr[++i];
+
+      if (option == "--channel")
+      {
+        options.Channels.push_back(value);
+      }
+      else if (option == "--subsystem")
+      {
+        options.Subsystems.push_back(SID::Build(value).Name);
+      }
+      else if (option == "--level")
+      {
+        int level = 0;
+        if (!LevelFromName(value, level))
+        {
+          response += "error: invalid level: " + value;
+          return false;
+        }
+
+        options.MinLevel = (Level)level;
+      }
+      else if (option == "--buffer")
+      {
+        uint64_t n = 0;
+        if (!ParseNumber(value, n) || n == 0)
+        {
+          response += "error: invalid buffer size: " + value;
+          return false;
+        }
+
+        options.MaxRecords = (size_t)n;
+      }
+      else if (option == "--count")
+      {
+        if (!ParseNumber(value, options.Count))
+        {
+          response += "error: invalid record count: " + value;
+          return false;
+        }
+      }
+      else if (option == "--duration")
+      {
+        if (!ParseNumber(value, options.Duration))
+        {
+          response += "error: invalid duration: " + value;
+          return false;
+        }
+      }
+      else
+      {
+        response += "error: unsupported follow option: " + option;
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool WriteBatchHeader(
+    ControlStream* stream
+    , uint64_t payloadBytes
+    , uint64_t dropped
+  )
+  {
+    char header[64];
+    int n = std::snprintf(
+      header
+      , sizeof(header)
+      , "%llu\t%llu\n"
+      , (unsigned long long)payloadBytes
+      , (unsigned long long)dropped
+    );
+
+    return stream->Write(header, (size_t)n);
+  }
+
+  // Taps are attached for the lifetime of the subscription only
+  class FollowTaps
+  {
+    std::vector<std::pair<ChannelPtr, BackendPtr>> Taps;
+
+  public:
+    ~FollowTaps()
+    {
+      Detach();
+    }
+
+    void Detach()
+    {
+      for (auto& tap : Taps)
+        tap.first->RemoveBackend(tap.second);
+
+      Taps.clear();
+    }
+
+    void Attach(const ChannelPtr& ch, const FollowSubscriberPtr& subscriber)
+    {
+      BackendPtr backend = std::make_shared<FollowBackend>(ch, subscriber);
+      ch->AddBackend(backend);
+      Taps.emplace_back(ch, backend);
+    }
+  };
+}
+
+bool Logger::CommandFollow(Logme::StringArray& arr, std::string& response)
+{
+  ControlStream* stream = ControlStream::Current();
+  if (stream == nullptr)
+  {
+    response += "error: follow requires a control connection";
+    return true;
+  }
+
+  FollowOptions options;
+  if (!ParseOptions(arr, options, response))
+    return true;
+
+  std::vector<ChannelPtr> channels;
+
+  if (options.Channels.empty())
+  {
+    ChannelPtr ch = Instance->GetExistingChannel(::CH);
+    if (ch == nullptr)
+    {
+      response += "error: no default channel";
+      return true;
+    }
+
+    channels.push_back(ch);
+  }
+
+  for (const std::string& name : options.Channels)
+  {
+    ChannelPtr ch = Instance->GetExistingChannel(ID{name.c_str()});
+    if (ch == nullptr)
+    {
+      response += "error: no such channel: " + name;
+      return true;
+    }
+
+    channels.push_back(ch);
+  }
+
+  FollowSubscriberPtr subscriber = std::make_shared<FollowSubscriber>(
+    options.MaxRecords
+    , (size_t)FollowSubscriber::DEFAULT_MAX_BYTES
+    , options.MinLevel
+    , options.Subsystems
+  );
+
+  // Records written after the client has received the header are not missed
+  FollowTaps taps;
+  for (const ChannelPtr& ch : channels)
+    taps.Attach(ch, subscriber);
+
+  char header[96];
+  int n = std::snprintf(
+    header
+    , sizeof(header)
+    , "LOGME-FOLLOW\t%llu\t%llu\n"
+    , (unsigned long long)options.MaxRecords
+    , (unsigned long long)FollowSubscriber::DEFAULT_MAX_BYTES
+  );
+
+  if (!stream->Write(header, (size_t)n))
+    return true;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::string> records;
+  std::string payload;
+  uint64_t sent = 0;
+  uint64_t dropped = 0;
+
+  for (bool last = false;;)
+  {
+    // Any data from the client ends the subscription. Records queued before
+    // the taps are removed are still delivered.
+    if (stream->IsInputPending()
+      || (options.Duration
+        && std::chrono::steady_clock::now() - start >= std::chrono::seconds(options.Duration)))
+    {
+      taps.Detach();
+      last = true;
+    }
+
+    uint64_t lost = 0;
+    subscriber->Take(
+      records
+      , lost
+      , last ? std::chrono::milliseconds(0) : FOLLOW_POLL_INTERVAL
+    );
+    dropped += lost;
+
+    payload.clear();
+
+    for (std::string& record : records)
+    {
+      if (options.Count && sent == options.Count)
+        break;
+
+      if (options.HasMatch && !std::regex_search(record, options.Match))
+        continue;
+
+      payload += record;
+      if (payload.back() != '\n')
+        payload.push_back('\n');
+
+      sent++;
+    }
+
+    // Drops are reported with the next batch; a batch is never empty
+    if (!payload.empty())
+    {
+      if (!WriteBatchHeader(stream, payload.size(), dropped)
+        || !stream->Write(payload.data(), payload.size()))
+      {
+        return true;
+      }
+
+      dropped = 0;
+    }
+
+    if (last || (options.Count && sent == options.Count))
+      break;
+  }
+
+  taps.Detach();
+
+  (void)WriteBatchHeader(stream, 0, dropped);
+  return true;
+}
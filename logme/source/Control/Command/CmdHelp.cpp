@@ -124,7 +124,7 @@ bool Logger::CommandHelp(Logme::StringArray& arr, std::string& response)
     "backend option --file path                   FileBackend/SharedFileBackend: set output file\n"
     "backend option --append                      FileBackend only: append to output file\n"
     "backend option --overwrite                   FileBackend only: overwrite output file\n"
-    "backend option --max-size size               FileBackend/SharedFileBackend/BufferBackend maximum size\n"
+    "backend option --max-size size               File, shared file, buffer and ring buffer backends maximum size\n"
     "backend option --daily-rotation              FileBackend only: rotate by day\n"
     "backend option --no-daily-rotation           FileBackend only: disable daily rotation\n"
     "backend option --max-parts count             FileBackend only: keep rotated file parts\n"
@@ -141,6 +141,7 @@ bool Logger::CommandHelp(Logme::StringArray& arr, std::string& response)
     "channel --error name                          Set error channel\n"
     "channel --clear-error                         Clear error channel\n"
     "flags [--channel name] [flag[=value] ...]      Set or display channel flags\n"
+    "follow [--channel name] [--level level] [...]  Stream new records until the client sends data\n"
     "help                                           Print this help text\n"
     "level [--channel name] [level]                 Get or set channel level\n"
     "list                                           List channels\n"
@@ -150,6 +151,7 @@ bool Logger::CommandHelp(Logme::StringArray& arr, std::string& response)
     "logstat outputs [--backend type] [--sort ...]  Display source sites by backend output\n"
     "logstat backends [--backend type] [--sort ...] Display backend output totals\n"
     "logs [--info|--tree [path]|--tail path [bytes]] Browse log files under home directory\n"
+    "logs --stream path [offset] [--gzip]           Send a log file as binary chunks\n"
     "overview                                       Display runtime logging summary\n"
     "subsystem                                      Display subsystem filters\n"
     "subsystem --block name                         Add blocked subsystem\n"
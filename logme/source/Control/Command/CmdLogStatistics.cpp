@@ -232,6 +232,78 @@ namespace
 
     return true;
   }
+
+  bool ParseLatencyReportOptions(
+    const StringArray& arr
+    , size_t begin
+    , LogLatencySort& sort
+    , size_t& limit
+    , std::string& response
+  )
+  {
+    sort = LogLatencySort::TOTAL;
+    limit = DEFAULT_LIMIT;
+
+    for (size_t i = begin; i < arr.size(); ++i)
+    {
+      const std::string& option = arr[i];
+
+      if (option == "--sort")
+      {
+        if (++i >= arr.size())
+        {
+          response = "error: missing logstat latency sort value";
+          return false;
+        }
+
+        const std::string& value = arr[i];
+        if (value == "total")
+          sort = LogLatencySort::TOTAL;
+        else if (value == "format")
+          sort = LogLatencySort::FORMAT;
+        else if (value == "apply")
+          sort = LogLatencySort::APPLY;
+        else if (value == "display" || value == "backend")
+          sort = LogLatencySort::DISPLAY;
+        else
+        {
+          response = "error: invalid logstat latency sort value: " + value;
+          return false;
+        }
+
+        continue;
+      }
+
+      if (option == "--limit")
+      {
+        if (++i >= arr.size())
+        {
+          response = "error: missing logstat limit";
+          return false;
+        }
+
+        if (!ParseLimit(arr[i], limit))
+        {
+          response = "error: invalid logstat limit: " + arr[i];
+          return false;
+        }
+
+        continue;
+      }
+
+      size_t parsedLimit = 0;
+      if (ParseLimit(option, parsedLimit))
+      {
+        limit = parsedLimit;
+        continue;
+      }
+
+      response = "error: unknown logstat latency option: " + option;
+      return false;
+    }
+
+    return true;
+  }
 }
 
 bool Logger::CommandLogStatistics(
@@ -243,8 +315,45 @@ bool Logger::CommandLogStatistics(
 
   if (operation == "start")
   {
+    for (size_t i = 2; i < arr.size(); ++i)
+    {
+      if (arr[i] != "--timing")
+      {
+        response = "error: unknown logstat start option: " + arr[i];
+        return true;
+      }
+
+      Instance->SetLogStatisticsTiming(true);
+    }
+
     Instance->StartLogStatistics();
-    response = "ok: log statistics started";
+    response = Instance->IsLogStatisticsTimingEnabled()
+      ? "ok: log statistics started with latency timing"
+      : "ok: log statistics started";
+    return true;
+  }
+
+  if (operation == "timing")
+  {
+    if (arr.size() < 3)
+    {
+      response = Instance->IsLogStatisticsTimingEnabled()
+        ? "latency timing: on"
+        : "latency timing: off";
+      return true;
+    }
+
+    if (arr[2] == "on")
+      Instance->SetLogStatisticsTiming(true);
+    else if (arr[2] == "off")
+      Instance->SetLogStatisticsTiming(false);
+    else
+    {
+      response = "error: invalid logstat timing value: " + arr[2];
+      return true;
+    }
+
+    response = "ok: latency timing " + arr[2];
     return true;
   }
 
@@ -335,13 +444,25 @@ bool Logger::CommandLogStatistics(
     return true;
   }
 
+  if (operation == "latency")
+  {
+    LogLatencySort sort;
+    size_t limit;
+    if (!ParseLatencyReportOptions(arr, 2, sort, limit, response))
+      return true;
+
+    response = Instance->DumpLogStatisticsLatency(sort, limit);
+    return true;
+  }
+
   if (operation == "help")
   {
     response =
-      "logstat start                              Start a new statistics session\n"
+      "logstat start [--timing]                   Start a new statistics session\n"
       "logstat stop                               Stop collection and preserve results\n"
       "logstat status                             Display current session status\n"
       "logstat reset                              Reset counters without changing active state\n"
+      "logstat timing [on|off]                    Enable or disable per-site latency histograms\n"
       "logstat top [--sort bytes|records] [--limit count]\n"
       "                                           Display top source locations\n"
       "logstat channels [--sort bytes|records] [--limit count]\n"
@@ -351,7 +472,9 @@ bool Logger::CommandLogStatistics(
       "logstat backends [--sort bytes|records] [--limit count] [--backend type]\n"
       "                                           Display destination backend totals\n"
       "logstat files [--sort written-bytes|batches|errors|dropped-bytes] [--limit count]\n"
-      "                                           Display asynchronous FileBackend runtime statistics\n";
+      "                                           Display asynchronous FileBackend runtime statistics\n"
+      "logstat latency [--sort total|format|apply|display] [--limit count]\n"
+      "                                           Display p50/p99/p999 latency of log sites\n";
     return true;
   }
 
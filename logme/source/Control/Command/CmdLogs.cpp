@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <cctype>
+#include <cerrno>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -10,9 +11,25 @@
 #include <unordered_set>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <share.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <Logme/File/TailReader.h>
 #include <Logme/Logger.h>
 
 #include "../CommandRegistrar.h"
+#include "../ControlStream.h"
 
 using namespace Logme;
 
@@ -26,6 +43,7 @@ namespace
   const uint64_t DEFAULT_READ_BYTES = 512ULL * 1024ULL;
   const uint64_t MAX_READ_BYTES = 4ULL * 1024ULL * 1024ULL;
   const uint64_t MAX_DOWNLOAD_BYTES = 256ULL * 1024ULL * 1024ULL;
+  const uint64_t STREAM_CHUNK_BYTES = 1024ULL * 1024ULL;
 
   std::vector<std::string> GetLogExtensions()
   {
@@ -509,6 +527,229 @@ namespace
     return true;
   }
 
+  class StreamFile
+  {
+  public:
+    explicit StreamFile(const fs::path& file)
+    {
+#ifdef _WIN32
+      if (_wsopen_s(&Fd, file.c_str(), _O_RDONLY | _O_BINARY, _SH_DENYNO, 0) != 0)
+        Fd = -1;
+#else
+      Fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+    }
+
+    ~StreamFile()
+    {
+      if (Fd >= 0)
+      {
+#ifdef _WIN32
+        _close(Fd);
+#else
+        close(Fd);
+#endif
+      }
+    }
+
+    uint64_t GetSize() const
+    {
+#ifdef _WIN32
+      struct _stat64 st;
+      if (_fstat64(Fd, &st) != 0)
+        return 0;
+#else
+      struct stat st;
+      if (fstat(Fd, &st) != 0)
+        return 0;
+#endif
+      return (uint64_t)st.st_size;
+    }
+
+    bool Read(uint64_t offset, char* p, size_t size) const
+    {
+      while (size)
+      {
+#ifdef _WIN32
+        if (_lseeki64(Fd, (__int64)offset, SEEK_SET) < 0)
+          return false;
+
+        int rc = _read(Fd, p, (unsigned)size);
+#else
+        ssize_t rc = pread(Fd, p, size, (off_t)offset);
+#endif
+        if (rc < 0 && errno == EINTR)
+          continue;
+
+        if (rc <= 0)
+          return false;
+
+        p += rc;
+        size -= (size_t)rc;
+        offset += (uint64_t)rc;
+      }
+
+      return true;
+    }
+
+    int Fd;
+  };
+
+  bool WriteChunkHeader(
+    ControlStream* stream
+    , uint64_t payloadBytes
+    , uint64_t sourceBytes
+  )
+  {
+    char header[64];
+    int n = std::snprintf(
+      header
+      , sizeof(header)
+      , "%llu\t%llu\n"
+      , (unsigned long long)payloadBytes
+      , (unsigned long long)sourceBytes
+    );
+
+    return stream->Write(header, (size_t)n);
+  }
+
+#ifdef USE_ZLIB
+  // Every chunk is a complete gzip member, so a transfer resumed at the
+  // source offset of any chunk still produces a valid gzip file
+  bool StreamGzipChunks(
+    ControlStream* stream
+    , const StreamFile& input
+    , uint64_t offset
+    , uint64_t end
+  )
+  {
+    z_stream zs{};
+    if (deflateInit2(&zs, Z_BEST_SPEED, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+      stream->Abort();
+      return false;
+    }
+
+    std::vector<char> source((size_t)STREAM_CHUNK_BYTES);
+    std::vector<char> packed(deflateBound(&zs, (uLong)STREAM_CHUNK_BYTES));
+    bool ok = true;
+
+    while (ok && offset < end)
+    {
+      size_t n = (size_t)std::min(end - offset, STREAM_CHUNK_BYTES);
+      if (!input.Read(offset, source.data(), n))
+      {
+        stream->Abort();
+        ok = false;
+        break;
+      }
+
+      zs.next_in = (Bytef*)source.data();
+      zs.avail_in = (uInt)n;
+      zs.next_out = (Bytef*)packed.data();
+      zs.avail_out = (uInt)packed.size();
+
+      if (deflate(&zs, Z_FINISH) != Z_STREAM_END)
+      {
+        stream->Abort();
+        ok = false;
+        break;
+      }
+
+      size_t size = packed.size() - zs.avail_out;
+      ok = WriteChunkHeader(stream, size, n)
+        && stream->Write(packed.data(), size);
+
+      (void)deflateReset(&zs);
+      offset += n;
+    }
+
+    deflateEnd(&zs);
+    return ok;
+  }
+#endif
+
+  bool CommandStream(
+    Logme::StringArray& arr
+    , std::string& response
+  )
+  {
+    ControlStream* stream = ControlStream::Current();
+    if (stream == nullptr)
+    {
+      response += "error: streaming requires a control connection";
+      return false;
+    }
+
+    size_t pathEnd = arr.size();
+    bool gzip = false;
+
+    if (pathEnd > 3 && arr[pathEnd - 1] == "--gzip")
+    {
+      gzip = true;
+      pathEnd--;
+    }
+
+    uint64_t offset = 0;
+    if (pathEnd > 3 && IsUnsignedNumber(arr[pathEnd - 1]))
+    {
+      offset = (uint64_t)std::strtoull(arr[pathEnd - 1].c_str(), nullptr, 10);
+      pathEnd--;
+    }
+
+    if (pathEnd < 3)
+    {
+      response += "error: missing file path";
+      return false;
+    }
+
+    fs::path file;
+    std::string relativePath = JoinWords(arr, 2, pathEnd);
+    if (!ValidateLogFile(relativePath, file, response))
+      return false;
+
+    StreamFile input(file);
+    if (input.Fd < 0)
+    {
+      response += "error: unable to open file";
+      return false;
+    }
+
+    // Data appended while the file is sent is left for the next request
+    uint64_t end = input.GetSize();
+    if (offset > end)
+      offset = end;
+
+#ifdef USE_ZLIB
+    if (gzip && NormalizeExtension(file.extension().string()) == ".gz")
+      gzip = false;
+#else
+    gzip = false;
+#endif
+
+    std::ostringstream header;
+    header << "LOGMEWEB-STREAM\t" << offset << "\t" << end << "\t" << (gzip ? "gzip" : "identity") << "\n";
+    std::string text = header.str();
+    if (!stream->Write(text.data(), text.size()))
+      return false;
+
+#ifdef USE_ZLIB
+    if (gzip && !StreamGzipChunks(stream, input, offset, end))
+      return false;
+#endif
+
+    while (!gzip && offset < end)
+    {
+      uint64_t n = std::min(end - offset, STREAM_CHUNK_BYTES);
+      if (!WriteChunkHeader(stream, n, n) || !stream->WriteFile(input.Fd, offset, n))
+        return false;
+
+      offset += n;
+    }
+
+    return WriteChunkHeader(stream, 0, 0);
+  }
+
   bool CommandTail(
     Logme::StringArray& arr
     , std::string& response
@@ -560,28 +801,14 @@ namespace
       return false;
     }
 
-    uint64_t size = GetFileSize(file);
-    uint64_t offset = size > bytes ? size - bytes : 0;
-
-    std::ifstream input(file, std::ios::binary);
-    if (!input)
+    std::string content;
+    if (TailReader::ReadBytes(file.string(), bytes, content) != 0)
     {
       response += "error: unable to open file";
       return false;
     }
 
-    input.seekg((std::streamoff)offset, std::ios::beg);
-
-    if (offset != 0)
-    {
-      std::string partial;
-      std::getline(input, partial);
-    }
-
-    std::ostringstream out;
-    out << input.rdbuf();
-    response += out.str();
-
+    response += content;
     return true;
   }
 }
@@ -618,6 +845,12 @@ bool Logger::CommandLogs(Logme::StringArray& arr, std::string& response)
     return true;
   }
 
+  if (arr[1] == "--stream")
+  {
+    (void)CommandStream(arr, response);
+    return true;
+  }
+
   response += "error: unsupported logs command";
   return true;
 }
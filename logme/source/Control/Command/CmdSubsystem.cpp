@@ -129,6 +129,7 @@ bool Logger::CommandSubsystem(Logme::StringArray& arr, std::string& response)
     Instance->BlockedSubsystems.clear();
     Instance->AllowedSubsystems.clear();
     Instance->SubsystemLevels.clear();
+    Instance->PublishSubsystemFilterSnapshot();
     Instance->PublishSubsystemLevelSnapshot();
     Instance->Subsystems.clear();
     response = "ok";
@@ -138,6 +139,7 @@ bool Logger::CommandSubsystem(Logme::StringArray& arr, std::string& response)
   if (arr.size() == 2 && arr[1] == "--clear-blocked")
   {
     Instance->BlockedSubsystems.clear();
+    Instance->PublishSubsystemFilterSnapshot();
     response = "ok";
     return true;
   }
@@ -145,6 +147,7 @@ bool Logger::CommandSubsystem(Logme::StringArray& arr, std::string& response)
   if (arr.size() == 2 && arr[1] == "--clear-allowed")
   {
     Instance->AllowedSubsystems.clear();
+    Instance->PublishSubsystemFilterSnapshot();
     response = "ok";
     return true;
   }
@@ -228,6 +231,7 @@ bool Logger::CommandSubsystem(Logme::StringArray& arr, std::string& response)
       {
         auto it = std::lower_bound(Instance->BlockedSubsystems.begin(), Instance->BlockedSubsystems.end(), sid.Name);
         Instance->BlockedSubsystems.insert(it, sid.Name);
+        Instance->PublishSubsystemFilterSnapshot();
         response = "ok";
       }
       return true;
@@ -241,6 +245,7 @@ bool Logger::CommandSubsystem(Logme::StringArray& arr, std::string& response)
       else
       {
         Instance->BlockedSubsystems.erase(it);
+        Instance->PublishSubsystemFilterSnapshot();
         response = "ok";
       }
       return true;
@@ -254,6 +259,7 @@ bool Logger::CommandSubsystem(Logme::StringArray& arr, std::string& response)
       {
         auto it = std::lower_bound(Instance->AllowedSubsystems.begin(), Instance->AllowedSubsystems.end(), sid.Name);
         Instance->AllowedSubsystems.insert(it, sid.Name);
+        Instance->PublishSubsystemFilterSnapshot();
         response = "ok";
       }
       return true;
@@ -267,6 +273,7 @@ bool Logger::CommandSubsystem(Logme::StringArray& arr, std::string& response)
       else
       {
         Instance->AllowedSubsystems.erase(it);
+        Instance->PublishSubsystemFilterSnapshot();
         response = "ok";
       }
       return true;
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -47,58 +48,13 @@
 #include <Logme/Utils.h>
 
 #include "CommandDescriptor.h"
+#include "ControlServer.h"
+#include "ControlSsl.h"
 
 using namespace Logme;
 
 namespace
 {
-#if defined(_WIN32)
-  typedef HMODULE ControlLibHandle;
-#else
-  typedef void* ControlLibHandle;
-#endif
-
-  ControlLibHandle ControlLoadLibrary(const char* const* names)
-  {
-    for (const char* const* p = names; *p; ++p)
-    {
-#if defined(_WIN32)
-      HMODULE h = LoadLibraryA(*p);
-      if (h)
-        return h;
-#else
-      void* h = dlopen(*p, RTLD_NOW);
-      if (h)
-        return h;
-#endif
-    }
-
-    return nullptr;
-  }
-
-  void* ControlGetSymbol(ControlLibHandle handle, const char* name)
-  {
-    if (!handle)
-      return nullptr;
-
-#if defined(_WIN32)
-    return reinterpret_cast<void*>(GetProcAddress(handle, name));
-#else
-    return dlsym(handle, name);
-#endif
-  }
-
-  void ControlCloseLibrary(ControlLibHandle handle)
-  {
-#if defined(_WIN32)
-    if (handle)
-      FreeLibrary(handle);
-#else
-    if (handle)
-      dlclose(handle);
-#endif
-  }
-
   bool ControlTypeEquals(const std::string& type, const char* name)
   {
     return type == name;
@@ -297,6 +253,15 @@ namespace
       return false;
     }
 
+    if (c == "follow")
+    {
+      if (policy.AllowLogsCommand)
+        return true;
+
+      reason = "follow command is disabled";
+      return false;
+    }
+
     if (c == "format")
     {
       if (policy.AllowFormatCommand)
@@ -312,318 +277,12 @@ namespace
     reason = "extension commands are disabled";
     return false;
   }
-
-  void WakeControlListener(
-    uint32_t interfaceAddress
-    , int port
-  )
-  {
-    if (port <= 0)
-      return;
-
-    int wakeSocket = (int)socket(AF_INET, SOCK_STREAM, 0);
-    if (wakeSocket == -1)
-      return;
-
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(interfaceAddress ? interfaceAddress : INADDR_LOOPBACK);
-    addr.sin_port = htons((unsigned short)port);
-
-    (void)connect(
-      wakeSocket
-      , reinterpret_cast<sockaddr*>(&addr)
-      , sizeof(addr)
-    );
-
-    closesocket(wakeSocket);
-  }
-
-#ifndef _WIN32
-  void ControlBlockSigPipeForThread()
-  {
-    sigset_t set;
-    sigemptyset(&set);
-    sigaddset(&set, SIGPIPE);
-    pthread_sigmask(SIG_BLOCK, &set, nullptr);
-  }
-#endif
-}
-
-namespace Logme
-{
-  struct ControlSslContext
-  {
-    ControlLibHandle LibSsl;
-    ControlLibHandle LibCrypto;
-
-    int (*SSL_library_init_ptr)();
-    void (*SSL_load_error_strings_ptr)();
-    void* (*TLS_server_method_ptr)();
-
-    void* (*SSL_CTX_new_ptr)(void*);
-    void (*SSL_CTX_free_ptr)(void*);
-    int (*SSL_CTX_use_certificate_ptr)(void*, void*);
-    int (*SSL_CTX_use_PrivateKey_ptr)(void*, void*);
-    int (*SSL_CTX_check_private_key_ptr)(void*);
-
-    void* (*SSL_new_ptr)(void*);
-    void (*SSL_free_ptr)(void*);
-    int (*SSL_set_fd_ptr)(void*, int);
-    int (*SSL_accept_ptr)(void*);
-    int (*SSL_read_ptr)(void*, void*, int);
-    int (*SSL_write_ptr)(void*, const void*, int);
-    int (*SSL_shutdown_ptr)(void*);
-
-    void* Ctx;
-
-    ControlSslContext()
-      : LibSsl(nullptr)
-      , LibCrypto(nullptr)
-      , SSL_library_init_ptr(nullptr)
-      , SSL_load_error_strings_ptr(nullptr)
-      , TLS_server_method_ptr(nullptr)
-      , SSL_CTX_new_ptr(nullptr)
-      , SSL_CTX_free_ptr(nullptr)
-      , SSL_CTX_use_certificate_ptr(nullptr)
-      , SSL_CTX_use_PrivateKey_ptr(nullptr)
-      , SSL_CTX_check_private_key_ptr(nullptr)
-      , SSL_new_ptr(nullptr)
-      , SSL_free_ptr(nullptr)
-      , SSL_set_fd_ptr(nullptr)
-      , SSL_accept_ptr(nullptr)
-      , SSL_read_ptr(nullptr)
-      , SSL_write_ptr(nullptr)
-      , SSL_shutdown_ptr(nullptr)
-      , Ctx(nullptr)
-    {
-    }
-
-    ~ControlSslContext()
-    {
-      Cleanup();
-    }
-
-    void Cleanup()
-    {
-      if (Ctx && SSL_CTX_free_ptr)
-        SSL_CTX_free_ptr(Ctx);
-
-      Ctx = nullptr;
-
-      ControlCloseLibrary(LibSsl);
-      ControlCloseLibrary(LibCrypto);
-
-      LibSsl = nullptr;
-      LibCrypto = nullptr;
-    }
-
-    bool Init(
-      X509* cert
-      , EVP_PKEY* key
-      , std::string& error
-    )
-    {
-      if (!cert || !key)
-      {
-        error = "cert/key is null";
-        return false;
-      }
-
-#if defined(_WIN32)
-#if defined(_WIN64)
-      static const char* SSL_NAMES[] =
-      {
-        "libssl-3-x64.dll",
-        "libssl-1_1-x64.dll",
-        "libssl-1_1.dll",
-        "libssl.dll",
-        nullptr
-      };
-      static const char* CRYPTO_NAMES[] =
-      {
-        "libcrypto-3-x64.dll",
-        "libcrypto-1_1-x64.dll",
-        "libcrypto-1_1.dll",
-        "libcrypto.dll",
-        nullptr
-      };
-#else
-      static const char* SSL_NAMES[] =
-      {
-        "libssl-3.dll",
-        "libssl-1_1.dll",
-        "libssl.dll",
-        nullptr
-      };
-      static const char* CRYPTO_NAMES[] =
-      {
-        "libcrypto-3.dll",
-        "libcrypto-1_1.dll",
-        "libcrypto.dll",
-        nullptr
-      };
-#endif
-#else
-      static const char* SSL_NAMES[] =
-      {
-        "libssl.so.3",
-        "libssl.so.1.1",
-        "libssl.so",
-        nullptr
-      };
-      static const char* CRYPTO_NAMES[] =
-      {
-        "libcrypto.so.3",
-        "libcrypto.so.1.1",
-        "libcrypto.so",
-        nullptr
-      };
-#endif
-
-      LibSsl = ControlLoadLibrary(SSL_NAMES);
-      if (!LibSsl)
-      {
-        error = "Unable to load libssl shared library";
-        return false;
-      }
-
-      LibCrypto = ControlLoadLibrary(CRYPTO_NAMES);
-      if (!LibCrypto)
-      {
-        error = "Unable to load libcrypto shared library";
-        return false;
-      }
-
-#define LOAD_REQUIRED(ptr, lib, name)                                      \
-      do                                                                   \
-      {                                                                    \
-        ptr = reinterpret_cast<decltype(ptr)>(ControlGetSymbol(lib, name));\
-        if (!ptr)                                                          \
-        {                                                                  \
-          error = std::string("Missing OpenSSL symbol: ") + name;        \
-          return false;                                                    \
-        }                                                                  \
-      } while (false)
-
-      SSL_library_init_ptr = reinterpret_cast<decltype(SSL_library_init_ptr)>(
-        ControlGetSymbol(LibSsl, "SSL_library_init"));
-      SSL_load_error_strings_ptr = reinterpret_cast<decltype(SSL_load_error_strings_ptr)>(
-        ControlGetSymbol(LibSsl, "SSL_load_error_strings"));
-
-      LOAD_REQUIRED(TLS_server_method_ptr, LibSsl, "TLS_server_method");
-      LOAD_REQUIRED(SSL_CTX_new_ptr, LibSsl, "SSL_CTX_new");
-      LOAD_REQUIRED(SSL_CTX_free_ptr, LibSsl, "SSL_CTX_free");
-      LOAD_REQUIRED(SSL_CTX_use_certificate_ptr, LibSsl, "SSL_CTX_use_certificate");
-      LOAD_REQUIRED(SSL_CTX_use_PrivateKey_ptr, LibSsl, "SSL_CTX_use_PrivateKey");
-      LOAD_REQUIRED(SSL_CTX_check_private_key_ptr, LibSsl, "SSL_CTX_check_private_key");
-      LOAD_REQUIRED(SSL_new_ptr, LibSsl, "SSL_new");
-      LOAD_REQUIRED(SSL_free_ptr, LibSsl, "SSL_free");
-      LOAD_REQUIRED(SSL_set_fd_ptr, LibSsl, "SSL_set_fd");
-      LOAD_REQUIRED(SSL_accept_ptr, LibSsl, "SSL_accept");
-      LOAD_REQUIRED(SSL_read_ptr, LibSsl, "SSL_read");
-      LOAD_REQUIRED(SSL_write_ptr, LibSsl, "SSL_write");
-      LOAD_REQUIRED(SSL_shutdown_ptr, LibSsl, "SSL_shutdown");
-
-#undef LOAD_REQUIRED
-
-      if (SSL_library_init_ptr)
-        SSL_library_init_ptr();
-
-      if (SSL_load_error_strings_ptr)
-        SSL_load_error_strings_ptr();
-
-      void* method = TLS_server_method_ptr();
-      if (!method)
-      {
-        error = "TLS_server_method() returned null";
-        return false;
-      }
-
-      Ctx = SSL_CTX_new_ptr(method);
-      if (!Ctx)
-      {
-        error = "SSL_CTX_new() failed";
-        return false;
-      }
-
-      if (SSL_CTX_use_certificate_ptr(Ctx, cert) != 1)
-      {
-        error = "SSL_CTX_use_certificate() failed";
-        return false;
-      }
-
-      if (SSL_CTX_use_PrivateKey_ptr(Ctx, key) != 1)
-      {
-        error = "SSL_CTX_use_PrivateKey() failed";
-        return false;
-      }
-
-      if (SSL_CTX_check_private_key_ptr(Ctx) != 1)
-      {
-        error = "SSL_CTX_check_private_key() failed";
-        return false;
-      }
-
-      return true;
-    }
-
-    void* CreateSession(int socket)
-    {
-      void* ssl = SSL_new_ptr(Ctx);
-      if (!ssl)
-      {
-        LogmeE(CHINT, "SSL_new() failed for control connection");
-        return nullptr;
-      }
-
-      if (SSL_set_fd_ptr(ssl, socket) != 1)
-      {
-        LogmeE(CHINT, "SSL_set_fd() failed for control connection");
-        SSL_free_ptr(ssl);
-        return nullptr;
-      }
-
-      int r = SSL_accept_ptr(ssl);
-      if (r <= 0)
-      {
-        LogmeE(CHINT, "SSL_accept() failed for control connection");
-        SSL_shutdown_ptr(ssl);
-        SSL_free_ptr(ssl);
-        return nullptr;
-      }
-
-      return ssl;
-    }
-
-    int Read(void* ssl, void* buf, int len)
-    {
-      return SSL_read_ptr(ssl, buf, len);
-    }
-
-    int Write(void* ssl, const void* buf, int len)
-    {
-      return SSL_write_ptr(ssl, buf, len);
-    }
-
-    void Shutdown(void* ssl)
-    {
-      if (!ssl)
-        return;
-
-      SSL_shutdown_ptr(ssl);
-      SSL_free_ptr(ssl);
-    }
-  };
 }
 
 void Logger::StopControlServer()
 {
-  ThreadPtr thread;
-  bool wakeListener = false;
   int socketToClose = -1;
-  int controlPort = 0;
-  uint32_t controlInterface = 0;
+  std::unique_ptr<ControlServer> server;
 
   if (ControlDiscoveryServer)
   {
@@ -634,32 +293,17 @@ void Logger::StopControlServer()
   {
     std::lock_guard guard(DataLock);
 
-    if (ControlSocket != -1)
-    {
-      socketToClose = ControlSocket;
-      controlPort = ControlCfg.Port;
-      controlInterface = ControlCfg.Interface;
-      wakeListener = true;
-      ControlSocket = -1;
-    }
-
-    std::swap(thread, ListenerThread);
-  }
+    socketToClose = ControlSocket;
+    ControlSocket = -1;
 
-  if (wakeListener)
-  {
-    WakeControlListener(
-      controlInterface
-      , controlPort
-    );
+    std::swap(server, ControlServerLoop);
   }
 
-  if (thread)
+  // Joins the server threads; commands they execute may take DataLock
+  if (server)
   {
-    if (thread->joinable())
-      thread->join();
-
-    thread.reset();
+    server->Stop();
+    server.reset();
   }
 
   if (socketToClose != -1)
@@ -856,161 +500,41 @@ bool Logger::StartControlServer(
     }
   }
 
-  ListenerThread = std::make_shared<std::thread>(
-    &Logger::ControlListener
-    , this
-    , ControlSocket
-  );
-  return true;
-}
-
-void Logger::SetControlServerPolicy(const ControlPolicy& policy)
-{
-  std::lock_guard guard(DataLock);
-  ControlServerPolicy = policy;
-}
-
-void Logger::ControlListener(int listenSocket)
-{
-  RenameThread(uint64_t(-1), "LogCtrlListener");
-
-#ifndef _WIN32
-  ControlBlockSigPipeForThread();
-#endif
-
-  for (;;)
-  {
-    // Listen for new connection
-    int accept_sock = (int)accept(listenSocket, nullptr, nullptr);
-    if (accept_sock == -1)
-      break;
-
-    {
-      std::lock_guard guard(DataLock);
-      if (ControlSocket != listenSocket)
-      {
-        closesocket(accept_sock);
-        break;
-      }
-    }
-
-    // Start ControlHandler to handle new connection
-    if (true)
-    {
-      ControlThread ct{};
-      ct.Stopped = false;
-
-      bool hasPassword = false;
-      {
-        std::lock_guard guard(DataLock);
-        hasPassword = (ControlCfg.Password && *ControlCfg.Password);
-      }
-
-      ct.Authorized = !hasPassword;
-
-      std::lock_guard guard(DataLock);
-      ControlThreads[accept_sock] = ct;
-
-      ControlThreads[accept_sock].Thread = std::make_shared<std::thread>(
-        &Logger::ControlHandler
-        , this
-        , accept_sock
-      );
-    }
-
-    // Remove items for closed connections
-    std::vector<ThreadPtr> threadsToJoin;
-
-    {
-      std::lock_guard guard(DataLock);
-      for (auto it = ControlThreads.begin(); it != ControlThreads.end();)
-      {
-        if (!it->second.Stopped)
-        {
-          it++;
-          continue;
-        }
-
-        closesocket(it->first);
-
-        if (it->second.Thread)
-        {
-          threadsToJoin.push_back(it->second.Thread);
-        }
-
-        it->second.Thread.reset();
-        it = ControlThreads.erase(it);
-      }
-    }
-
-    for (auto& thread : threadsToJoin)
+  ControlServerLoop.reset(new ControlServer(
+    ControlSocket
+    , ControlSsl
+    , ControlCfg
+    , [this](const std::string& request, bool& authorized)
     {
-      if (thread && thread->joinable())
-      {
-        thread->join();
-      }
+      return ControlRequest(request, authorized);
     }
-  }
-
-  std::vector<ThreadPtr> threadsToJoin;
+  ));
 
-  // Shutdown action connections
+  if (!ControlServerLoop->Start())
   {
-    std::lock_guard guard(DataLock);
-    for (auto& t : ControlThreads)
-    {
-      shutdown(t.first, SD_RECEIVE);
-      closesocket(t.first);
+    LogmeE(CHINT, "Unable to start control server: %s", OSERR2);
 
-      if (t.second.Thread)
-      {
-        threadsToJoin.push_back(t.second.Thread);
-      }
-    }
+    ControlServerLoop.reset();
+    closesocket(ControlSocket);
+    ControlSocket = -1;
 
-    ControlThreads.clear();
+    return false;
   }
 
-  // Join connection threads outside DataLock.
-  for (auto& thread : threadsToJoin)
-  {
-    if (thread && thread->joinable())
-    {
-      thread->join();
-    }
-  }
+  return true;
 }
 
-void Logger::ControlHandler(int socket)
+void Logger::SetControlServerPolicy(const ControlPolicy& policy)
 {
-  RenameThread(uint64_t(-1), "LogCtrlHandler");
-
-#ifndef _WIN32
-  ControlBlockSigPipeForThread();
-#endif
-
-  ControlSslContext* sslCtx = nullptr;
-  {
-    std::lock_guard guard(DataLock);
-    sslCtx = ControlSsl;
-  }
-
-  void* ssl = nullptr;
-
-  if (sslCtx)
-  {
-    ssl = sslCtx->CreateSession(socket);
-    if (!ssl)
-    {
-      std::lock_guard guard(DataLock);
-      auto it = ControlThreads.find(socket);
-      if (it != ControlThreads.end())
-        it->second.Stopped = true;
-
-      return;
-    }
-  }
+  std::lock_guard guard(DataLock);
+  ControlServerPolicy = policy;
+}
 
+std::string Logger::ControlRequest(
+  const std::string& command
+  , bool& authorized
+)
+{
   auto SplitRemainderAfterWords = [](const std::string& s, int words) -> std::string
   {
     int w = 0;
@@ -1073,136 +597,64 @@ void Logger::ControlHandler(int socket)
     return true;
   };
 
-  bool authorized = false;
-  {
-    std::lock_guard guard(DataLock);
-    auto it = ControlThreads.find(socket);
-    if (it != ControlThreads.end())
-      authorized = it->second.Authorized;
-  }
-    
-  for (;;)
-  {
-    char buff[4096]{};
-    int n = -1;
+  std::string cmdName;
+  int prefixWords = 0;
+  (void)GetCommandName(command, cmdName, prefixWords);
 
-    if (sslCtx)
-      n = sslCtx->Read(ssl, buff, (int)sizeof(buff));
-    else
-      n = (int)recv(socket, buff, sizeof(buff), 0);
+  std::string response;
 
-    if (sslCtx)
-    {
-      if (n <= 0)
-        break;
-    }
-    else
+  bool hasPassword = false;
+  std::string password;
+  ControlPolicy policy;
+
+  {
+    std::lock_guard guard(DataLock);
+    hasPassword = (ControlCfg.Password && *ControlCfg.Password);
+    policy = ControlServerPolicy;
+    if (hasPassword)
     {
-      if (n == -1)
-        break;
+      password = ControlCfg.Password;
     }
+  }
 
-    std::string command(buff, n);
-    std::string cmdName;
-    int prefixWords = 0;
-    (void)GetCommandName(command, cmdName, prefixWords);
-
-    std::string response;
-
-    bool hasPassword = false;
-    std::string password;
-    ControlPolicy policy;
+  if (cmdName == "auth")
+  {
+    std::string pass = SplitRemainderAfterWords(command, prefixWords + 1);
+    Trim(pass);
 
+    if (!hasPassword)
     {
-      std::lock_guard guard(DataLock);
-      hasPassword = (ControlCfg.Password && *ControlCfg.Password);
-      policy = ControlServerPolicy;
-      if (hasPassword)
-      {
-        password = ControlCfg.Password;
-      }
+      authorized = true;
+      response = "ok";
     }
-
-    if (cmdName == "auth")
+    else
     {
-      std::string pass = SplitRemainderAfterWords(command, prefixWords + 1);
-      Trim(pass);
-
-      if (!hasPassword)
+      if (!pass.empty() && pass == password)
       {
         authorized = true;
         response = "ok";
       }
       else
       {
-        if (!pass.empty() && pass == password)
-        {
-          authorized = true;
-          response = "ok";
-        }
-        else
-        {
-          response = "error: invalid password";
-        }
-      }
-
-      {
-        std::lock_guard guard(DataLock);
-        auto it = ControlThreads.find(socket);
-        if (it != ControlThreads.end())
-          it->second.Authorized = authorized;
+        response = "error: invalid password";
       }
     }
-    else if (cmdName == "help")
+  }
+  else if (cmdName == "help")
+  {
+    response = Control(command, policy);
+  }
+  else
+  {
+    if (hasPassword && !authorized)
     {
-      response = Control(command, policy);
+      response = "error: unauthorized";
     }
     else
-    {
-      if (hasPassword && !authorized)
-      {
-        response = "error: unauthorized";
-      }
-      else
-        response = Control(command, policy);
-    }
-
-    if (!response.empty() && response.back() != '\n')
-      response.push_back('\n');
-
-    if (!response.empty())
-    {
-      if (sslCtx)
-        n = sslCtx->Write(ssl, response.c_str(), (int)response.size());
-      else
-      {
-        int flags = 0;
-#ifdef MSG_NOSIGNAL
-        flags |= MSG_NOSIGNAL;
-#endif
-        n = (int)send(socket, response.c_str(), (int)response.size(), flags);
-      }
-
-      if (sslCtx)
-      {
-        if (n <= 0)
-          break;
-      }
-      else
-      {
-        if (n == -1)
-          break;
-      }
-    }
+      response = Control(command, policy);
   }
 
-  if (sslCtx)
-    sslCtx->Shutdown(ssl);
-
-  std::lock_guard guard(DataLock);
-  auto it = ControlThreads.find(socket);
-  if (it != ControlThreads.end())
-    it->second.Stopped = true;
+  return response;
 }
 
 void Logger::SetControlExtension(Logme::TControlHandler handler)
@@ -1385,6 +837,12 @@ std::string Logger::Control(
           return response;
       }
 
+      if (c == "follow")
+      {
+        if (Logger::CommandFollow(items, response))
+          return response;
+      }
+
       for (CommandDescriptor* d = CommandDescriptor::Head; d; d = d->Next)
       {
         if (d->Command != c)
@@ -0,0 +1,858 @@
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+
+#define SHUT_RDWR SD_BOTH
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define closesocket close
+#endif
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#endif
+
+#include <Logme/Utils.h>
+
+#include "ControlServer.h"
+#include "ControlSsl.h"
+#include "ControlStream.h"
+
+using namespace Logme;
+
+namespace
+{
+#ifdef _WIN32
+  typedef int socklen_t;
+#endif
+
+  bool SetNonBlocking(int socket, bool enable)
+  {
+#ifdef _WIN32
+    u_long mode = enable ? 1 : 0;
+    return ioctlsocket((SOCKET)socket, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags < 0)
+      return false;
+
+    flags = enable ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return fcntl(socket, F_SETFL, flags) == 0;
+#endif
+  }
+
+  // A blocked send fails after this time, so a client that stopped reading
+  // cannot hold a worker forever
+  void SetSendTimeout(int socket, int seconds)
+  {
+#ifdef _WIN32
+    DWORD timeout = (DWORD)seconds * 1000;
+#else
+    timeval timeout{};
+    timeout.tv_sec = seconds;
+#endif
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+  }
+
+  bool WouldBlock()
+  {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+  }
+
+  bool Interrupted()
+  {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEINTR;
+#else
+    return errno == EINTR;
+#endif
+  }
+
+#ifndef _WIN32
+  void ControlBlockSigPipeForThread()
+  {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+  }
+#endif
+
+  class ControlConnectionStream : public ControlStream
+  {
+    int Socket;
+    ControlSslContext* SslCtx;
+    void* Ssl;
+    bool Queued;
+
+  public:
+    // queued is true when the connection has more requests to execute
+    ControlConnectionStream(int socket, ControlSslContext* sslCtx, void* ssl, bool queued)
+      : Socket(socket)
+      , SslCtx(sslCtx)
+      , Ssl(ssl)
+      , Queued(queued)
+    {
+    }
+
+  protected:
+    bool PollInput() override
+    {
+      if (Queued)
+        return true;
+
+#ifdef _WIN32
+      WSAPOLLFD pfd{};
+      pfd.fd = (SOCKET)Socket;
+      pfd.events = POLLIN;
+      return WSAPoll(&pfd, 1, 0) > 0;
+#else
+      pollfd pfd{};
+      pfd.fd = Socket;
+      pfd.events = POLLIN;
+      return poll(&pfd, 1, 0) > 0;
+#endif
+    }
+
+    bool Send(const void* data, size_t size) override
+    {
+      const char* p = (const char*)data;
+
+      while (size)
+      {
+        int part = size > (size_t)INT_MAX ? INT_MAX : (int)size;
+        int n = -1;
+
+        if (SslCtx)
+          n = SslCtx->Write(Ssl, p, part);
+        else
+        {
+          int flags = 0;
+#ifdef MSG_NOSIGNAL
+          flags |= MSG_NOSIGNAL;
+#endif
+          n = (int)send(Socket, p, part, flags);
+
+#ifndef _WIN32
+          if (n < 0 && errno == EINTR)
+            continue;
+#endif
+        }
+
+        if (n <= 0)
+          return false;
+
+        p += n;
+        size -= (size_t)n;
+      }
+
+      return true;
+    }
+
+    bool SendFile(int fd, uint64_t offset, uint64_t size) override
+    {
+#ifdef __linux__
+      // Without TLS the file goes from the page cache to the socket
+      // without being copied to user space
+      if (!SslCtx)
+      {
+        off_t pos = (off_t)offset;
+        bool first = true;
+
+        while (size)
+        {
+          size_t part = size > (uint64_t)SEND_FILE_CHUNK ? (size_t)SEND_FILE_CHUNK : (size_t)size;
+          ssize_t n = sendfile(Socket, fd, &pos, part);
+
+          if (n < 0 && errno == EINTR)
+            continue;
+
+          // The file system does not support sendfile()
+          if (n < 0 && first && (errno == EINVAL || errno == ENOSYS))
+            return ControlStream::SendFile(fd, offset, size);
+
+          if (n <= 0)
+            return false;
+
+          first = false;
+          size -= (uint64_t)n;
+        }
+
+        return true;
+      }
+#endif
+      return ControlStream::SendFile(fd, offset, size);
+    }
+
+  private:
+    enum
+    {
+      SEND_FILE_CHUNK = 0x7ffff000,
+    };
+  };
+}
+
+ControlServer::Connection::Connection(int socket, void* ssl)
+  : Socket(socket)
+  , Ssl(ssl)
+  , Handshake(ssl != nullptr)
+  , Authorized(false)
+  , Busy(false)
+  , PeerClosed(false)
+  , Broken(false)
+  , LastActivity(std::chrono::steady_clock::now())
+{
+}
+
+ControlServer::ControlServer(
+  int listenSocket
+  , ControlSslContext* ssl
+  , const ControlConfig& config
+  , TControlRequestHandler handler
+)
+  : ListenSocket(listenSocket)
+  , Ssl(ssl)
+  , Handler(handler)
+  , MaxConnections(config.MaxConnections > 0 ? (size_t)config.MaxConnections : (size_t)DEFAULT_MAX_CONNECTIONS)
+  , IdleTimeout(config.IdleTimeout > 0 ? config.IdleTimeout : (int)DEFAULT_IDLE_TIMEOUT)
+  , Poller(-1)
+  , WakeSocket(-1)
+  , IdleWorkers(0)
+  , Stopping(false)
+{
+}
+
+ControlServer::~ControlServer()
+{
+  Stop();
+}
+
+bool ControlServer::Start()
+{
+#ifdef __linux__
+  Poller = epoll_create1(EPOLL_CLOEXEC);
+  if (Poller < 0)
+    return false;
+#endif
+
+  if (!CreateWakeSocket())
+    return false;
+
+  if (!SetNonBlocking(ListenSocket, true))
+    return false;
+
+  if (!Watch(ListenSocket) || !Watch(WakeSocket))
+    return false;
+
+  try
+  {
+    // The loop thread adds workers later, so it starts last
+    for (int i = 0; i < WORKER_THREADS; i++)
+      Workers.emplace_back(&ControlServer::WorkerFunc, this);
+
+    Loop = std::thread(&ControlServer::LoopFunc, this);
+  }
+  catch (...)
+  {
+    Stop();
+    return false;
+  }
+
+  return true;
+}
+
+void ControlServer::Stop()
+{
+  {
+    std::lock_guard guard(Lock);
+    Stopping = true;
+  }
+
+  JobReady.notify_all();
+
+  if (WakeSocket != -1)
+    Wake();
+
+  if (Loop.joinable())
+    Loop.join();
+
+  for (auto& worker : Workers)
+  {
+    if (worker.joinable())
+      worker.join();
+  }
+
+  Workers.clear();
+
+  while (!Connections.empty())
+    Close(Connections.begin()->second);
+
+  Jobs.clear();
+  Finished.clear();
+
+  if (WakeSocket != -1)
+  {
+    closesocket(WakeSocket);
+    WakeSocket = -1;
+  }
+
+#ifdef __linux__
+  if (Poller != -1)
+  {
+    close(Poller);
+    Poller = -1;
+  }
+#endif
+
+  Watched.clear();
+}
+
+// Workers and Stop() wake the loop with a datagram sent to this socket
+bool ControlServer::CreateWakeSocket()
+{
+  int s = (int)socket(AF_INET, SOCK_DGRAM, 0);
+  if (s == -1)
+    return false;
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+
+  socklen_t len = sizeof(addr);
+
+  bool ok = bind(s, (sockaddr*)&addr, sizeof(addr)) == 0
+    && getsockname(s, (sockaddr*)&addr, &len) == 0
+    && connect(s, (sockaddr*)&addr, sizeof(addr)) == 0
+    && SetNonBlocking(s, true);
+
+  if (!ok)
+  {
+    closesocket(s);
+    return false;
+  }
+
+  WakeSocket = s;
+  return true;
+}
+
+void ControlServer::Wake()
+{
+  char c = 0;
+  (void)send(WakeSocket, &c, 1, 0);
+}
+
+#ifdef __linux__
+bool ControlServer::Watch(int socket)
+{
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = socket;
+  return epoll_ctl(Poller, EPOLL_CTL_ADD, socket, &ev) == 0;
+}
+
+void ControlServer::Unwatch(int socket)
+{
+  epoll_ctl(Poller, EPOLL_CTL_DEL, socket, nullptr);
+}
+
+bool ControlServer::Wait(std::vector<int>& ready, int timeoutMs)
+{
+  epoll_event events[64];
+
+  ready.clear();
+
+  int n = epoll_wait(Poller, events, 64, timeoutMs);
+  if (n < 0)
+    return errno == EINTR;
+
+  for (int i = 0; i < n; i++)
+    ready.push_back(events[i].data.fd);
+
+  return true;
+}
+#else
+bool ControlServer::Watch(int socket)
+{
+  Watched.push_back(socket);
+  return true;
+}
+
+void ControlServer::Unwatch(int socket)
+{
+  for (auto it = Watched.begin(); it != Watched.end(); ++it)
+  {
+    if (*it == socket)
+    {
+      Watched.erase(it);
+      break;
+    }
+  }
+}
+
+bool ControlServer::Wait(std::vector<int>& ready, int timeoutMs)
+{
+#ifdef _WIN32
+  std::vector<WSAPOLLFD> fds(Watched.size());
+#else
+  std::vector<pollfd> fds(Watched.size());
+#endif
+
+  for (size_t i = 0; i < Watched.size(); i++)
+  {
+    fds[i].fd = Watched[i];
+    fds[i].events = POLLIN;
+    fds[i].revents = 0;
+  }
+
+  ready.clear();
+
+#ifdef _WIN32
+  int n = WSAPoll(fds.data(), (ULONG)fds.size(), timeoutMs);
+#else
+  int n = poll(fds.data(), (nfds_t)fds.size(), timeoutMs);
+#endif
+  if (n < 0)
+    return Interrupted();
+
+  for (size_t i = 0; i < fds.size(); i++)
+  {
+    if (fds[i].revents)
+      ready.push_back((int)fds[i].fd);
+  }
+
+  return true;
+}
+#endif
+
+void ControlServer::LoopFunc()
+{
+  RenameThread(uint64_t(-1), "LogCtrlListener");
+
+#ifndef _WIN32
+  ControlBlockSigPipeForThread();
+#endif
+
+  std::vector<int> ready;
+
+  for (;;)
+  {
+    {
+      std::lock_guard guard(Lock);
+      if (Stopping)
+        break;
+    }
+
+    // The timeout bounds the delay of idle connection checks
+    if (!Wait(ready, 1000))
+      break;
+
+    for (int s : ready)
+    {
+      if (s == ListenSocket)
+      {
+        AcceptConnections();
+        continue;
+      }
+
+      if (s == WakeSocket)
+      {
+        char buffer[64];
+        while (recv(WakeSocket, buffer, sizeof(buffer), 0) > 0)
+          ;
+
+        continue;
+      }
+
+      auto it = Connections.find(s);
+      if (it != Connections.end() && !it->second->Busy)
+        ReadConnection(it->second);
+    }
+
+    ResumeFinished();
+    CloseIdle();
+  }
+
+  // Fail sends of workers that still serve connections
+  for (auto& item : Connections)
+  {
+    if (item.second->Busy)
+      shutdown(item.first, SHUT_RDWR);
+  }
+}
+
+void ControlServer::WorkerFunc()
+{
+  RenameThread(uint64_t(-1), "LogCtrlWorker");
+
+#ifndef _WIN32
+  ControlBlockSigPipeForThread();
+#endif
+
+  for (;;)
+  {
+    ConnectionPtr c;
+
+    {
+      std::unique_lock guard(Lock);
+
+      IdleWorkers++;
+      JobReady.wait(guard, [this]() { return Stopping || !Jobs.empty(); });
+      IdleWorkers--;
+
+      if (Stopping)
+        return;
+
+      c = Jobs.front();
+      Jobs.pop_front();
+    }
+
+    Execute(*c);
+
+    {
+      std::lock_guard guard(Lock);
+      Finished.push_back(c);
+    }
+
+    Wake();
+  }
+}
+
+void ControlServer::AcceptConnections()
+{
+  for (;;)
+  {
+    int s = (int)accept(ListenSocket, nullptr, nullptr);
+    if (s == -1)
+      break;
+
+    if (Connections.size() >= MaxConnections)
+    {
+      if (!Ssl)
+      {
+        static const char error[] = "error: too many control connections\n";
+
+        int flags = 0;
+#ifdef MSG_NOSIGNAL
+        flags |= MSG_NOSIGNAL;
+#endif
+        (void)send(s, error, (int)sizeof(error) - 1, flags);
+      }
+
+      closesocket(s);
+      continue;
+    }
+
+    if (!SetNonBlocking(s, true))
+    {
+      closesocket(s);
+      continue;
+    }
+
+    SetSendTimeout(s, SEND_TIMEOUT);
+
+    void* ssl = nullptr;
+    if (Ssl)
+    {
+      ssl = Ssl->CreateSession(s);
+      if (!ssl)
+      {
+        closesocket(s);
+        continue;
+      }
+    }
+
+    ConnectionPtr c = std::make_shared<Connection>(s, ssl);
+    Connections[s] = c;
+
+    if (!Watch(s))
+      Close(c);
+  }
+}
+
+void ControlServer::ReadConnection(const ConnectionPtr& c)
+{
+  c->LastActivity = std::chrono::steady_clock::now();
+
+  if (c->Handshake)
+  {
+    int rc = Ssl->Accept(c->Ssl);
+    if (rc < 0)
+    {
+      Close(c);
+      return;
+    }
+
+    if (rc == 0)
+      return;
+
+    c->Handshake = false;
+  }
+
+  char buffer[16 * 1024];
+
+  while (c->Input.size() <= MAX_REQUEST_BYTES)
+  {
+    int n = -1;
+
+    if (c->Ssl)
+    {
+      n = Ssl->Read(c->Ssl, buffer, (int)sizeof(buffer));
+      if (n <= 0)
+      {
+        if (!Ssl->ShouldRetry(c->Ssl, n))
+          c->PeerClosed = true;
+
+        break;
+      }
+    }
+    else
+    {
+      n = (int)recv(c->Socket, buffer, (int)sizeof(buffer), 0);
+      if (n < 0 && Interrupted())
+        continue;
+
+      if (n < 0 && WouldBlock())
+        break;
+
+      if (n <= 0)
+      {
+        c->PeerClosed = true;
+        break;
+      }
+    }
+
+    c->Input.append(buffer, (size_t)n);
+  }
+
+  ParseRequests(*c);
+
+  if (!c->Requests.empty())
+  {
+    c->Busy = true;
+    Unwatch(c->Socket);
+
+    bool addWorker = false;
+
+    {
+      std::lock_guard guard(Lock);
+      Jobs.push_back(c);
+
+      // Streaming commands hold a worker for a long time; a job that no
+      // idle worker can take gets a new one
+      addWorker = Jobs.size() > IdleWorkers && Workers.size() < MaxConnections;
+    }
+
+    if (addWorker)
+    {
+      try
+      {
+        Workers.emplace_back(&ControlServer::WorkerFunc, this);
+      }
+      catch (...)
+      {
+      }
+    }
+
+    JobReady.notify_one();
+    return;
+  }
+
+  if (c->PeerClosed)
+    Close(c);
+}
+
+bool ControlServer::ParseRequests(Connection& c)
+{
+  while (!c.Input.empty())
+  {
+    // Everything a client sent at once is one unframed request
+    if (c.Input[0] != '#')
+    {
+      if (c.Input.size() > MAX_REQUEST_BYTES)
+      {
+        c.Requests.push_back({"error: request is too large", false, true});
+        c.Input.clear();
+        return false;
+      }
+
+      c.Requests.push_back({c.Input, false, false});
+      c.Input.clear();
+      return true;
+    }
+
+    size_t eol = c.Input.find('\n');
+    if (eol == std::string::npos)
+    {
+      if (c.Input.size() <= MAX_FRAME_HEADER)
+        return true;
+
+      eol = 0;
+    }
+
+    size_t length = 0;
+    bool valid = eol > 1 && eol <= MAX_FRAME_HEADER;
+
+    for (size_t i = 1; valid && i < eol; i++)
+    {
+      char ch = c.Input[i];
+      valid = ch >= '0' && ch <= '9' && length <= MAX_REQUEST_BYTES;
+      length = length * 10 + size_t(ch - '0');
+    }
+
+    if (!valid || length > MAX_REQUEST_BYTES)
+    {
+      c.Requests.push_back({"error: invalid request frame", true, true});
+      c.Input.clear();
+      return false;
+    }
+
+    if (c.Input.size() - eol - 1 < length)
+      return true;
+
+    c.Requests.push_back({c.Input.substr(eol + 1, length), true, false});
+    c.Input.erase(0, eol + 1 + length);
+  }
+
+  return true;
+}
+
+void ControlServer::Execute(Connection& c)
+{
+  // Responses and streamed data are written with blocking sends
+  SetNonBlocking(c.Socket, false);
+
+  while (!c.Requests.empty() && !c.Broken)
+  {
+    Request r = std::move(c.Requests.front());
+    c.Requests.pop_front();
+
+    ControlConnectionStream stream(c.Socket, Ssl, c.Ssl, !c.Requests.empty());
+    std::string response;
+
+    if (r.Fatal)
+    {
+      response = r.Text;
+      c.Broken = true;
+    }
+    else
+    {
+      ControlStream::Scope scope(&stream);
+      response = Handler(r.Text, c.Authorized);
+
+      if (stream.IsBroken())
+      {
+        c.Broken = true;
+        break;
+      }
+
+      if (stream.IsUsed())
+        continue;
+    }
+
+    if (!response.empty() && response.back() != '\n')
+      response.push_back('\n');
+
+    if (r.Framed)
+    {
+      // Built by appends: GCC 12 reports a false -Wrestrict for
+      // "#" + std::to_string() + "\n"
+      std::string header("#");
+      header += std::to_string(response.size());
+      header += '\n';
+      response.insert(0, header);
+    }
+
+    if (!response.empty() && !stream.Write(response.data(), response.size()))
+      c.Broken = true;
+  }
+
+  c.Requests.clear();
+  SetNonBlocking(c.Socket, true);
+}
+
+void ControlServer::ResumeFinished()
+{
+  std::vector<ConnectionPtr> finished;
+
+  {
+    std::lock_guard guard(Lock);
+    finished.swap(Finished);
+  }
+
+  for (auto& c : finished)
+  {
+    c->Busy = false;
+
+    if (c->Broken || c->PeerClosed || !Watch(c->Socket))
+    {
+      Close(c);
+      continue;
+    }
+
+    // Requests that arrived while the worker was busy. TLS may also hold
+    // decrypted data that the poller does not report.
+    ReadConnection(c);
+  }
+}
+
+void ControlServer::CloseIdle()
+{
+  auto now = std::chrono::steady_clock::now();
+  std::vector<ConnectionPtr> idle;
+
+  for (auto& item : Connections)
+  {
+    const ConnectionPtr& c = item.second;
+    if (c->Busy)
+      continue;
+
+    std::chrono::seconds limit = c->Handshake
+      ? std::chrono::seconds(HANDSHAKE_TIMEOUT)
+      : IdleTimeout;
+
+    if (now - c->LastActivity >= limit)
+      idle.push_back(c);
+  }
+
+  for (auto& c : idle)
+    Close(c);
+}
+
+void ControlServer::Close(const ConnectionPtr& c)
+{
+  if (!c->Busy)
+    Unwatch(c->Socket);
+
+  if (c->Ssl)
+  {
+    Ssl->Shutdown(c->Ssl);
+    c->Ssl = nullptr;
+  }
+
+  closesocket(c->Socket);
+  Connections.erase(c->Socket);
+}
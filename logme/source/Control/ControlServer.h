@@ -0,0 +1,131 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Logme/Types.h>
+
+namespace Logme
+{
+  struct ControlSslContext;
+
+  // Executes one control request. authorized is the authentication state of
+  // the connection that sent the request.
+  typedef std::function<std::string(const std::string& request, bool& authorized)> TControlRequestHandler;
+
+  // Control server with one event-loop thread and a small pool of workers.
+  // The loop accepts connections, completes TLS handshakes, reads and splits
+  // requests and closes idle connections. A connection with complete
+  // requests is handed to a worker, which executes them in order, writes the
+  // responses and returns the connection to the loop. The pool starts with
+  // WORKER_THREADS workers and grows only while streaming commands occupy
+  // all of them, never beyond the connection limit.
+  //
+  // A request is either framed as "#<length>\n<command>" or is everything a
+  // client sent at once (the original protocol of logmectl). Responses to
+  // framed requests use the same framing, so clients can pipeline requests
+  // and commands of any length are never split.
+  class ControlServer
+  {
+    struct Request
+    {
+      std::string Text;
+      bool Framed;
+
+      // Error response to a malformed request; the connection is closed
+      // after it is sent
+      bool Fatal;
+    };
+
+    struct Connection
+    {
+      int Socket;
+      void* Ssl;
+      bool Handshake;
+      bool Authorized;
+      bool Busy;
+      bool PeerClosed;
+      bool Broken;
+      std::string Input;
+      std::deque<Request> Requests;
+      std::chrono::steady_clock::time_point LastActivity;
+
+      Connection(int socket, void* ssl);
+    };
+
+    typedef std::shared_ptr<Connection> ConnectionPtr;
+
+    int ListenSocket;
+    ControlSslContext* Ssl;
+    TControlRequestHandler Handler;
+    size_t MaxConnections;
+    std::chrono::seconds IdleTimeout;
+
+    int Poller;
+    int WakeSocket;
+    std::vector<int> Watched;
+
+    std::thread Loop;
+    std::vector<std::thread> Workers;
+
+    std::mutex Lock;
+    std::condition_variable JobReady;
+    std::deque<ConnectionPtr> Jobs;
+    std::vector<ConnectionPtr> Finished;
+    size_t IdleWorkers;
+    bool Stopping;
+
+    // Owned by the loop thread
+    std::map<int, ConnectionPtr> Connections;
+
+  public:
+    enum
+    {
+      DEFAULT_MAX_CONNECTIONS = 32,
+      DEFAULT_IDLE_TIMEOUT = 300,
+      HANDSHAKE_TIMEOUT = 10,
+      SEND_TIMEOUT = 30,
+      WORKER_THREADS = 4,
+      MAX_REQUEST_BYTES = 64 * 1024,
+      MAX_FRAME_HEADER = 16,
+    };
+
+    ControlServer(
+      int listenSocket
+      , ControlSslContext* ssl
+      , const ControlConfig& config
+      , TControlRequestHandler handler
+    );
+    ~ControlServer();
+
+    bool Start();
+    void Stop();
+
+  private:
+    bool CreateWakeSocket();
+    void Wake();
+    bool Watch(int socket);
+    void Unwatch(int socket);
+    bool Wait(std::vector<int>& ready, int timeoutMs);
+
+    void LoopFunc();
+    void WorkerFunc();
+
+    void AcceptConnections();
+    void ReadConnection(const ConnectionPtr& c);
+    bool ParseRequests(Connection& c);
+    void ResumeFinished();
+    void CloseIdle();
+    void Close(const ConnectionPtr& c);
+
+    void Execute(Connection& c);
+  };
+}
@@ -0,0 +1,350 @@
+#pragma once
+
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include <Logme/Logme.h>
+
+namespace Logme
+{
+#if defined(_WIN32)
+  typedef HMODULE ControlLibHandle;
+#else
+  typedef void* ControlLibHandle;
+#endif
+
+  inline ControlLibHandle ControlLoadLibrary(const char* const* names)
+  {
+    for (const char* const* p = names; *p; ++p)
+    {
+#if defined(_WIN32)
+      HMODULE h = LoadLibraryA(*p);
+      if (h)
+        return h;
+#else
+      void* h = dlopen(*p, RTLD_NOW);
+      if (h)
+        return h;
+#endif
+    }
+
+    return nullptr;
+  }
+
+  inline void* ControlGetSymbol(ControlLibHandle handle, const char* name)
+  {
+    if (!handle)
+      return nullptr;
+
+#if defined(_WIN32)
+    return reinterpret_cast<void*>(GetProcAddress(handle, name));
+#else
+    return dlsym(handle, name);
+#endif
+  }
+
+  inline void ControlCloseLibrary(ControlLibHandle handle)
+  {
+#if defined(_WIN32)
+    if (handle)
+      FreeLibrary(handle);
+#else
+    if (handle)
+      dlclose(handle);
+#endif
+  }
+
+  struct ControlSslContext
+  {
+    ControlLibHandle LibSsl;
+    ControlLibHandle LibCrypto;
+
+    int (*SSL_library_init_ptr)();
+    void (*SSL_load_error_strings_ptr)();
+    void* (*TLS_server_method_ptr)();
+
+    void* (*SSL_CTX_new_ptr)(void*);
+    void (*SSL_CTX_free_ptr)(void*);
+    int (*SSL_CTX_use_certificate_ptr)(void*, void*);
+    int (*SSL_CTX_use_PrivateKey_ptr)(void*, void*);
+    int (*SSL_CTX_check_private_key_ptr)(void*);
+
+    void* (*SSL_new_ptr)(void*);
+    void (*SSL_free_ptr)(void*);
+    int (*SSL_set_fd_ptr)(void*, int);
+    int (*SSL_accept_ptr)(void*);
+    int (*SSL_read_ptr)(void*, void*, int);
+    int (*SSL_write_ptr)(void*, const void*, int);
+    int (*SSL_shutdown_ptr)(void*);
+    int (*SSL_get_error_ptr)(const void*, int);
+
+    void* Ctx;
+
+    // SSL_get_error() codes
+    enum
+    {
+      WANT_READ_ERROR = 2,
+      WANT_WRITE_ERROR = 3,
+    };
+
+    ControlSslContext()
+      : LibSsl(nullptr)
+      , LibCrypto(nullptr)
+      , SSL_library_init_ptr(nullptr)
+      , SSL_load_error_strings_ptr(nullptr)
+      , TLS_server_method_ptr(nullptr)
+      , SSL_CTX_new_ptr(nullptr)
+      , SSL_CTX_free_ptr(nullptr)
+      , SSL_CTX_use_certificate_ptr(nullptr)
+      , SSL_CTX_use_PrivateKey_ptr(nullptr)
+      , SSL_CTX_check_private_key_ptr(nullptr)
+      , SSL_new_ptr(nullptr)
+      , SSL_free_ptr(nullptr)
+      , SSL_set_fd_ptr(nullptr)
+      , SSL_accept_ptr(nullptr)
+      , SSL_read_ptr(nullptr)
+      , SSL_write_ptr(nullptr)
+      , SSL_shutdown_ptr(nullptr)
+      , SSL_get_error_ptr(nullptr)
+      , Ctx(nullptr)
+    {
+    }
+
+    ~ControlSslContext()
+    {
+      Cleanup();
+    }
+
+    void Cleanup()
+    {
+      if (Ctx && SSL_CTX_free_ptr)
+        SSL_CTX_free_ptr(Ctx);
+
+      Ctx = nullptr;
+
+      ControlCloseLibrary(LibSsl);
+      ControlCloseLibrary(LibCrypto);
+
+      LibSsl = nullptr;
+      LibCrypto = nullptr;
+    }
+
+    bool Init(
+      X509* cert
+      , EVP_PKEY* key
+      , std::string& error
+    )
+    {
+      if (!cert || !key)
+      {
+        error = "cert/key is null";
+        return false;
+      }
+
+#if defined(_WIN32)
+#if defined(_WIN64)
+      static const char* SSL_NAMES[] =
+      {
+        "libssl-3-x64.dll",
+        "libssl-1_1-x64.dll",
+        "libssl-1_1.dll",
+        "libssl.dll",
+        nullptr
+      };
+      static const char* CRYPTO_NAMES[] =
+      {
+        "libcrypto-3-x64.dll",
+        "libcrypto-1_1-x64.dll",
+        "libcrypto-1_1.dll",
+        "libcrypto.dll",
+        nullptr
+      };
+#else
+      static const char* SSL_NAMES[] =
+      {
+        "libssl-3.dll",
+        "libssl-1_1.dll",
+        "libssl.dll",
+        nullptr
+      };
+      static const char* CRYPTO_NAMES[] =
+      {
+        "libcrypto-3.dll",
+        "libcrypto-1_1.dll",
+        "libcrypto.dll",
+        nullptr
+      };
+#endif
+#else
+      static const char* SSL_NAMES[] =
+      {
+        "libssl.so.3",
+        "libssl.so.1.1",
+        "libssl.so",
+        nullptr
+      };
+      static const char* CRYPTO_NAMES[] =
+      {
+        "libcrypto.so.3",
+        "libcrypto.so.1.1",
+        "libcrypto.so",
+        nullptr
+      };
+#endif
+
+      LibSsl = ControlLoadLibrary(SSL_NAMES);
+      if (!LibSsl)
+      {
+        error = "Unable to load libssl shared library";
+        return false;
+      }
+
+      LibCrypto = ControlLoadLibrary(CRYPTO_NAMES);
+      if (!LibCrypto)
+      {
+        error = "Unable to load libcrypto shared library";
+        return false;
+      }
+
+#define LOAD_REQUIRED(ptr, lib, name)                                      \
+      do                                                                   \
+      {                                                                    \
+        ptr = reinterpret_cast<decltype(ptr)>(ControlGetSymbol(lib, name));\
+        if (!ptr)                                                          \
+        {                                                                  \
+          error = std::string("Missing OpenSSL symbol: ") + name;        \
+          return false;                                                    \
+        }                                                                  \
+      } while (false)
+
+      SSL_library_init_ptr = reinterpret_cast<decltype(SSL_library_init_ptr)>(
+        ControlGetSymbol(LibSsl, "SSL_library_init"));
+      SSL_load_error_strings_ptr = reinterpret_cast<decltype(SSL_load_error_strings_ptr)>(
+        ControlGetSymbol(LibSsl, "SSL_load_error_strings"));
+
+      LOAD_REQUIRED(TLS_server_method_ptr, LibSsl, "TLS_server_method");
+      LOAD_REQUIRED(SSL_CTX_new_ptr, LibSsl, "SSL_CTX_new");
+      LOAD_REQUIRED(SSL_CTX_free_ptr, LibSsl, "SSL_CTX_free");
+      LOAD_REQUIRED(SSL_CTX_use_certificate_ptr, LibSsl, "SSL_CTX_use_certificate");
+      LOAD_REQUIRED(SSL_CTX_use_PrivateKey_ptr, LibSsl, "SSL_CTX_use_PrivateKey");
+      LOAD_REQUIRED(SSL_CTX_check_private_key_ptr, LibSsl, "SSL_CTX_check_private_key");
+      LOAD_REQUIRED(SSL_new_ptr, LibSsl, "SSL_new");
+      LOAD_REQUIRED(SSL_free_ptr, LibSsl, "SSL_free");
+      LOAD_REQUIRED(SSL_set_fd_ptr, LibSsl, "SSL_set_fd");
+      LOAD_REQUIRED(SSL_accept_ptr, LibSsl, "SSL_accept");
+      LOAD_REQUIRED(SSL_read_ptr, LibSsl, "SSL_read");
+      LOAD_REQUIRED(SSL_write_ptr, LibSsl, "SSL_write");
+      LOAD_REQUIRED(SSL_shutdown_ptr, LibSsl, "SSL_shutdown");
+      LOAD_REQUIRED(SSL_get_error_ptr, LibSsl, "SSL_get_error");
+
+#undef LOAD_REQUIRED
+
+      if (SSL_library_init_ptr)
+        SSL_library_init_ptr();
+
+      if (SSL_load_error_strings_ptr)
+        SSL_load_error_strings_ptr();
+
+      void* method = TLS_server_method_ptr();
+      if (!method)
+      {
+        error = "TLS_server_method() returned null";
+        return false;
+      }
+
+      Ctx = SSL_CTX_new_ptr(method);
+      if (!Ctx)
+      {
+        error = "SSL_CTX_new() failed";
+        return false;
+      }
+
+      if (SSL_CTX_use_certificate_ptr(Ctx, cert) != 1)
+      {
+        error = "SSL_CTX_use_certificate() failed";
+        return false;
+      }
+
+      if (SSL_CTX_use_PrivateKey_ptr(Ctx, key) != 1)
+      {
+        error = "SSL_CTX_use_PrivateKey() failed";
+        return false;
+      }
+
+      if (SSL_CTX_check_private_key_ptr(Ctx) != 1)
+      {
+        error = "SSL_CTX_check_private_key() failed";
+        return false;
+      }
+
+      return true;
+    }
+
+    void* CreateSession(int socket)
+    {
+      void* ssl = SSL_new_ptr(Ctx);
+      if (!ssl)
+      {
+        LogmeE(CHINT, "SSL_new() failed for control connection");
+        return nullptr;
+      }
+
+      if (SSL_set_fd_ptr(ssl, socket) != 1)
+      {
+        LogmeE(CHINT, "SSL_set_fd() failed for control connection");
+        SSL_free_ptr(ssl);
+        return nullptr;
+      }
+
+      return ssl;
+    }
+
+    // Performs the next step of the server handshake on a non-blocking
+    // socket. Returns 1 when the handshake is complete, 0 when it waits for
+    // more data and -1 on failure.
+    int Accept(void* ssl)
+    {
+      int r = SSL_accept_ptr(ssl);
+      if (r == 1)
+        return 1;
+
+      if (ShouldRetry(ssl, r))
+        return 0;
+
+      LogmeE(CHINT, "SSL_accept() failed for control connection");
+      return -1;
+    }
+
+    // Read() or Write() on a non-blocking socket returned r because the
+    // socket is not ready
+    bool ShouldRetry(void* ssl, int r)
+    {
+      int e = SSL_get_error_ptr(ssl, r);
+      return e == WANT_READ_ERROR || e == WANT_WRITE_ERROR;
+    }
+
+    int Read(void* ssl, void* buf, int len)
+    {
+      return SSL_read_ptr(ssl, buf, len);
+    }
+
+    int Write(void* ssl, const void* buf, int len)
+    {
+      return SSL_write_ptr(ssl, buf, len);
+    }
+
+    void Shutdown(void* ssl)
+    {
+      if (!ssl)
+        return;
+
+      SSL_shutdown_ptr(ssl);
+      SSL_free_ptr(ssl);
+    }
+  };
+}
@@ -0,0 +1,133 @@
+#include <cerrno>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "ControlStream.h"
+
+using namespace Logme;
+
+namespace
+{
+  enum
+  {
+    SEND_FILE_BLOCK = 256 * 1024,
+  };
+
+  thread_local ControlStream* CurrentStream = nullptr;
+}
+
+ControlStream::ControlStream()
+  : Used(false)
+  , Broken(false)
+{
+}
+
+ControlStream::~ControlStream()
+{
+}
+
+bool ControlStream::Write(const void* data, size_t size)
+{
+  Used = true;
+
+  if (Broken)
+    return false;
+
+  if (size && !Send(data, size))
+    Broken = true;
+
+  return !Broken;
+}
+
+bool ControlStream::WriteFile(int fd, uint64_t offset, uint64_t size)
+{
+  Used = true;
+
+  if (Broken)
+    return false;
+
+  if (size && !SendFile(fd, offset, size))
+    Broken = true;
+
+  return !Broken;
+}
+
+void ControlStream::Abort()
+{
+  Used = true;
+  Broken = true;
+}
+
+bool ControlStream::IsUsed() const
+{
+  return Used;
+}
+
+bool ControlStream::IsBroken() const
+{
+  return Broken;
+}
+
+bool ControlStream::IsInputPending()
+{
+  return Broken || PollInput();
+}
+
+ControlStream* ControlStream::Current()
+{
+  return CurrentStream;
+}
+
+ControlStream::Scope::Scope(ControlStream* stream)
+  : Previous(CurrentStream)
+{
+  CurrentStream = stream;
+}
+
+ControlStream::Scope::~Scope()
+{
+  CurrentStream = Previous;
+}
+
+bool ControlStream::SendFile(int fd, uint64_t offset, uint64_t size)
+{
+  std::vector<char> block(SEND_FILE_BLOCK);
+
+  while (size)
+  {
+    size_t n = size < SEND_FILE_BLOCK ? (size_t)size : (size_t)SEND_FILE_BLOCK;
+
+#ifdef _WIN32
+    if (_lseeki64(fd, (__int64)offset, SEEK_SET) < 0)
+      return false;
+
+    int rc = _read(fd, &block[0], (unsigned)n);
+#else
+    ssize_t rc = pread(fd, &block[0], n, (off_t)offset);
+#endif
+    if (rc < 0 && errno == EINTR)
+      continue;
+
+    // A truncated file cannot deliver the announced size
+    if (rc <= 0)
+      return false;
+
+    if (!Send(&block[0], (size_t)rc))
+      return false;
+
+    offset += (uint64_t)rc;
+    size -= (uint64_t)rc;
+  }
+
+  return true;
+}
+
+bool ControlStream::PollInput()
+{
+  return false;
+}
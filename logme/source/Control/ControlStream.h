@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Logme
+{
+  // Connection of the control handler that executes the current command.
+  // Commands that transfer large binary data write it to the connection
+  // directly instead of returning it in the response string. The handler
+  // does not send the response of a command that used the stream.
+  class ControlStream
+  {
+    bool Used;
+    bool Broken;
+
+  public:
+    ControlStream();
+    virtual ~ControlStream();
+
+    // Returns false when the connection is broken
+    bool Write(const void* data, size_t size);
+
+    // Sends size bytes of the file fd starting at offset
+    bool WriteFile(int fd, uint64_t offset, uint64_t size);
+
+    // The transfer cannot be completed; the connection is closed after the
+    // command returns
+    void Abort();
+
+    bool IsUsed() const;
+    bool IsBroken() const;
+
+    // True when the client has sent more data or closed the connection.
+    // Commands that stream until they are stopped return when it is set.
+    bool IsInputPending();
+
+    // Stream of the calling thread or nullptr when the command is not
+    // executed by a control connection handler
+    static ControlStream* Current();
+
+    class Scope
+    {
+      ControlStream* Previous;
+
+    public:
+      explicit Scope(ControlStream* stream);
+      ~Scope();
+    };
+
+  protected:
+    virtual bool Send(const void* data, size_t size) = 0;
+
+    // Reads the file in blocks and sends them with Send()
+    virtual bool SendFile(int fd, uint64_t offset, uint64_t size);
+
+    virtual bool PollInput();
+  };
+}
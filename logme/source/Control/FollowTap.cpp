@@ -0,0 +1,124 @@
+#include <algorithm>
+
+#include <Logme/Channel.h>
+#include <Logme/Context.h>
+
+#include "FollowTap.h"
+
+using namespace Logme;
+
+FollowSubscriber::FollowSubscriber(
+  size_t maxRecords
+  , size_t maxBytes
+  , Level minLevel
+  , const std::vector<uint64_t>& subsystems
+)
+  : Bytes(0)
+  , Dropped(0)
+  , Waiting(false)
+  , MaxRecords(maxRecords)
+  , MaxBytes(maxBytes)
+  , MinLevel(minLevel)
+  , Subsystems(subsystems)
+{
+}
+
+bool FollowSubscriber::Accepts(const Context& context) const
+{
+  if (context.ErrorLevel < MinLevel)
+    return false;
+
+  if (Subsystems.empty())
+    return true;
+
+  return std::find(Subsystems.begin(), Subsystems.end(), context.Subsystem.Name) != Subsystems.end();
+}
+
+void FollowSubscriber::Push(const char* text, size_t size)
+{
+  // The copy is made before the lock is taken; the lock only guards the
+  // queue, which the consumer swaps out in one step
+  std::string record(text, size);
+  bool wake = false;
+
+  {
+    std::lock_guard guard(Lock);
+
+    if (Records.size() >= MaxRecords || Bytes + size > MaxBytes)
+    {
+      Dropped++;
+      return;
+    }
+
+    Bytes += size;
+    Records.push_back(std::move(record));
+
+    wake = Waiting;
+    Waiting = false;
+  }
+
+  if (wake)
+    Ready.notify_one();
+}
+
+void FollowSubscriber::Take(
+  std::vector<std::string>& records
+  , uint64_t& dropped
+  , std::chrono::milliseconds timeout
+)
+{
+  std::deque<std::string> taken;
+
+  {
+    std::unique_lock guard(Lock);
+
+    if (Records.empty() && Dropped == 0)
+    {
+      Waiting = true;
+      Ready.wait_for(guard, timeout, [this]() { return !Records.empty(); });
+      Waiting = false;
+    }
+
+    taken.swap(Records);
+    Bytes = 0;
+
+    dropped = Dropped;
+    Dropped = 0;
+  }
+
+  records.clear();
+  records.reserve(taken.size());
+
+  for (auto& record : taken)
+    records.push_back(std::move(record));
+}
+
+FollowBackend::FollowBackend(ChannelPtr owner, FollowSubscriberPtr subscriber)
+  : Backend(owner, TYPE_ID)
+  , Subscriber(subscriber)
+{
+}
+
+bool FollowBackend::IsConcurrentDisplaySupported() const
+{
+  return true;
+}
+
+std::string FollowBackend::FormatDetails()
+{
+  return "Subscription=follow";
+}
+
+void FollowBackend::Display(Context& context)
+{
+  if (!Subscriber->Accepts(context))
+    return;
+
+  OutputFlags flags = Owner->GetFlags();
+
+  int nc;
+  const char* str = context.Apply(Owner, flags, nc);
+
+  if (nc > 0)
+    Subscriber->Push(str, size_t(nc));
+}
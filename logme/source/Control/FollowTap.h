@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <Logme/Backend/Backend.h>
+
+namespace Logme
+{
+  // Records of one "follow" subscription. Producers append formatted
+  // records; the control worker of the subscriber takes them in batches.
+  // The queue is bounded by records and bytes. A record that does not fit
+  // is dropped and counted, so a slow client never delays the threads that
+  // write logs.
+  class FollowSubscriber
+  {
+    std::mutex Lock;
+    std::condition_variable Ready;
+    std::deque<std::string> Records;
+    size_t Bytes;
+    uint64_t Dropped;
+    bool Waiting;
+
+    size_t MaxRecords;
+    size_t MaxBytes;
+    Level MinLevel;
+    std::vector<uint64_t> Subsystems;
+
+  public:
+    enum
+    {
+      DEFAULT_MAX_RECORDS = 1000,
+      DEFAULT_MAX_BYTES = 1024 * 1024,
+    };
+
+    FollowSubscriber(
+      size_t maxRecords
+      , size_t maxBytes
+      , Level minLevel
+      , const std::vector<uint64_t>& subsystems
+    );
+
+    // Level and subsystem filters; checked before the record is formatted
+    bool Accepts(const Context& context) const;
+
+    void Push(const char* text, size_t size);
+
+    // Waits up to timeout for records and moves all queued records to
+    // records. dropped receives the number of records dropped since the
+    // previous call.
+    void Take(
+      std::vector<std::string>& records
+      , uint64_t& dropped
+      , std::chrono::milliseconds timeout
+    );
+  };
+
+  typedef std::shared_ptr<FollowSubscriber> FollowSubscriberPtr;
+
+  // Tap attached to a channel for the lifetime of a subscription. Channels
+  // without subscribers have no tap and pay nothing for this feature.
+  struct FollowBackend : public Backend
+  {
+    FollowSubscriberPtr Subscriber;
+
+    constexpr static const char* TYPE_ID = "FollowBackend";
+
+    FollowBackend(ChannelPtr owner, FollowSubscriberPtr subscriber);
+
+    bool IsConcurrentDisplaySupported() const override;
+    std::string FormatDetails() override;
+
+  protected:
+    void Display(Context& context) override;
+  };
+}
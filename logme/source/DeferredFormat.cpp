@@ -0,0 +1,562 @@
+#include <Logme/DeferredFormat.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+using namespace Logme;
+
+namespace
+{
+  enum class ArgClass : uint8_t
+  {
+    SIGNED,
+    UNSIGNED,
+    CHAR,
+    DOUBLE,
+    STRING,
+    POINTER
+  };
+
+  enum class ArgLength : uint8_t
+  {
+    NONE,
+    HH,
+    H,
+    L,
+    LL,
+    J,
+    Z,
+    T,
+    BIG_L
+  };
+
+  constexpr size_t MAX_SPEC_FLAGS = 8;
+  constexpr uint32_t NULL_STRING = UINT32_MAX;
+
+  struct FormatSpec
+  {
+    char Flags[MAX_SPEC_FLAGS];
+    size_t FlagsLen;
+    bool WidthStar;
+    int Width;
+    bool PrecisionStar;
+    int Precision;
+    ArgLength Length;
+    ArgClass Class;
+    char Conversion;
+    const char* End;
+  };
+
+  bool ParseNumber(const char*& p, int& value)
+  {
+    value = 0;
+    while (*p >= '0' && *p <= '9')
+    {
+      if (value > 100000)
+        return false;
+
+      value = value * 10 + (*p++ - '0');
+    }
+
+    // Positional arguments (%1$d) are not supported
+    return *p != '$';
+  }
+
+  // p points to the character following '%'
+  bool ParseSpec(const char* p, FormatSpec& spec)
+  {
+    spec.FlagsLen = 0;
+    spec.WidthStar = false;
+    spec.Width = -1;
+    spec.PrecisionStar = false;
+    spec.Precision = -1;
+    spec.Length = ArgLength::NONE;
+
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+    {
+      if (spec.FlagsLen == MAX_SPEC_FLAGS)
+        return false;
+
+      spec.Flags[spec.FlagsLen++] = *p++;
+    }
+
+    if (*p == '*')
+    {
+      spec.WidthStar = true;
+      ++p;
+    }
+    else if (*p >= '0' && *p <= '9')
+    {
+      if (!ParseNumber(p, spec.Width))
+        return false;
+    }
+
+    if (*p == '.')
+    {
+      ++p;
+      if (*p == '*')
+      {
+        spec.PrecisionStar = true;
+        ++p;
+      }
+      else if (!ParseNumber(p, spec.Precision))
+        return false;
+    }
+
+    switch (*p)
+    {
+    case 'h':
+      spec.Length = p[1] == 'h' ? ArgLength::HH : ArgLength::H;
+      p += p[1] == 'h' ? 2 : 1;
+      break;
+
+    case 'l':
+      spec.Length = p[1] == 'l' ? ArgLength::LL : ArgLength::L;
+      p += p[1] == 'l' ? 2 : 1;
+      break;
+
+    case 'q': spec.Length = ArgLength::LL; ++p; break;
+    case 'j': spec.Length = ArgLength::J; ++p; break;
+    case 'z': spec.Length = ArgLength::Z; ++p; break;
+    case 't': spec.Length = ArgLength::T; ++p; break;
+    case 'L': spec.Length = ArgLength::BIG_L; ++p; break;
+    default: break;
+    }
+
+    spec.Conversion = *p;
+
+    switch (*p)
+    {
+    case 'd':
+    case 'i':
+      spec.Class = ArgClass::SIGNED;
+      break;
+
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      spec.Class = ArgClass::UNSIGNED;
+      break;
+
+    case 'c':
+      spec.Class = ArgClass::CHAR;
+      break;
+
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      spec.Class = ArgClass::DOUBLE;
+      break;
+
+    case 's':
+      spec.Class = ArgClass::STRING;
+      break;
+
+    case 'p':
+      spec.Class = ArgClass::POINTER;
+      break;
+
+    default:
+      return false;
+    }
+
+    if (spec.Class == ArgClass::SIGNED || spec.Class == ArgClass::UNSIGNED)
+    {
+      if (spec.Length == ArgLength::BIG_L)
+        return false;
+    }
+    else if (spec.Class == ArgClass::DOUBLE)
+    {
+      // long double is not captured
+      if (spec.Length != ArgLength::NONE && spec.Length != ArgLength::L)
+        return false;
+    }
+    else if (spec.Length != ArgLength::NONE)
+    {
+      // %lc, %ls and modified %p
+      return false;
+    }
+
+    spec.End = p + 1;
+    return true;
+  }
+
+  struct Writer
+  {
+    char* Pos;
+    char* End;
+
+    bool Put(const void* data, size_t size)
+    {
+      if ((size_t)(End - Pos) < size)
+        return false;
+
+      memcpy(Pos, data, size);
+      Pos += size;
+      return true;
+    }
+
+    template<typename T>
+    bool Put(T value)
+    {
+      return Put(&value, sizeof(value));
+    }
+  };
+
+  struct Reader
+  {
+    const char* Pos;
+    const char* End;
+
+    bool Get(void* data, size_t size)
+    {
+      if ((size_t)(End - Pos) < size)
+        return false;
+
+      memcpy(data, Pos, size);
+      Pos += size;
+      return true;
+    }
+
+    template<typename T>
+    bool Get(T& value)
+    {
+      return Get(&value, sizeof(value));
+    }
+  };
+
+  template<typename T>
+  void AppendFormatted(std::string& out, const char* spec, T value)
+  {
+    char temp[128];
+    int n = snprintf(temp, sizeof(temp), spec, value);
+    if (n <= 0)
+      return;
+
+    if ((size_t)n < sizeof(temp))
+    {
+      out.append(temp, (size_t)n);
+      return;
+    }
+
+    size_t pos = out.size();
+    out.resize(pos + (size_t)n + 1);
+    snprintf(&out[pos], (size_t)n + 1, spec, value);
+    out.resize(pos + (size_t)n);
+  }
+
+  void AppendString(
+    std::string& out
+    , const char* spec
+    , int precision
+    , const char* value
+  )
+  {
+    char temp[128];
+    int n = snprintf(temp, sizeof(temp), spec, precision, value);
+    if (n <= 0)
+      return;
+
+    if ((size_t)n < sizeof(temp))
+    {
+      out.append(temp, (size_t)n);
+      return;
+    }
+
+    size_t pos = out.size();
+    out.resize(pos + (size_t)n + 1);
+    snprintf(&out[pos], (size_t)n + 1, spec, precision, value);
+    out.resize(pos + (size_t)n);
+  }
+}
+
+bool Logme::CaptureDeferredArgs(
+  const char* format
+  , va_list args
+  , char* buffer
+  , size_t size
+  , size_t* used
+)
+{
+  if (format == nullptr || buffer == nullptr)
+    return false;
+
+  Writer w{buffer, buffer + size};
+
+  for (const char* p = format; *p;)
+  {
+    if (*p != '%')
+    {
+      ++p;
+      continue;
+    }
+
+    if (p[1] == '%')
+    {
+      p += 2;
+      continue;
+    }
+
+    FormatSpec spec;
+    if (!ParseSpec(p + 1, spec))
+      return false;
+
+    p = spec.End;
+
+    if (spec.WidthStar && !w.Put((int32_t)va_arg(args, int)))
+      return false;
+
+    int precision = spec.Precision;
+    if (spec.PrecisionStar)
+    {
+      precision = va_arg(args, int);
+      if (!w.Put((int32_t)precision))
+        return false;
+    }
+
+    bool ok = false;
+    switch (spec.Class)
+    {
+    case ArgClass::SIGNED:
+    {
+      int64_t value = 0;
+      switch (spec.Length)
+      {
+      case ArgLength::HH: value = (signed char)va_arg(args, int); break;
+      case ArgLength::H: value = (short)va_arg(args, int); break;
+      case ArgLength::L: value = va_arg(args, long); break;
+      case ArgLength::LL: value = va_arg(args, long long); break;
+      case ArgLength::J: value = va_arg(args, intmax_t); break;
+      case ArgLength::Z: value = va_arg(args, std::make_signed_t<size_t>); break;
+      case ArgLength::T: value = va_arg(args, ptrdiff_t); break;
+      default: value = va_arg(args, int); break;
+      }
+
+      ok = w.Put(value);
+      break;
+    }
+
+    case ArgClass::UNSIGNED:
+    {
+      uint64_t value = 0;
+      switch (spec.Length)
+      {
+      case ArgLength::HH: value = (unsigned char)va_arg(args, unsigned int); break;
+      case ArgLength::H: value = (unsigned short)va_arg(args, unsigned int); break;
+      case ArgLength::L: value = va_arg(args, unsigned long); break;
+      case ArgLength::LL: value = va_arg(args, unsigned long long); break;
+      case ArgLength::J: value = va_arg(args, uintmax_t); break;
+      case ArgLength::Z: value = va_arg(args, size_t); break;
+      case ArgLength::T: value = va_arg(args, std::make_unsigned_t<ptrdiff_t>); break;
+      default: value = va_arg(args, unsigned int); break;
+      }
+
+      ok = w.Put(value);
+      break;
+    }
+
+    case ArgClass::CHAR:
+      ok = w.Put((int32_t)va_arg(args, int));
+      break;
+
+    case ArgClass::DOUBLE:
+      ok = w.Put(va_arg(args, double));
+      break;
+
+    case ArgClass::POINTER:
+      ok = w.Put((uint64_t)(uintptr_t)va_arg(args, void*));
+      break;
+
+    case ArgClass::STRING:
+    {
+      const char* text = va_arg(args, const char*);
+      if (text == nullptr)
+      {
+        ok = w.Put(NULL_STRING);
+        break;
+      }
+
+      // Precision may limit a string which is not zero terminated
+      size_t len = precision >= 0 ? strnlen(text, (size_t)precision) : strlen(text);
+      if (len >= NULL_STRING)
+        return false;
+
+      ok = w.Put((uint32_t)len) && w.Put(text, len);
+      break;
+    }
+    }
+
+    if (!ok)
+      return false;
+  }
+
+  if (used)
+    *used = (size_t)(w.Pos - buffer);
+
+  return true;
+}
+
+bool Logme::FormatDeferredArgs(
+  const char* format
+  , const char* data
+  , size_t size
+  , std::string& out
+)
+{
+  if (format == nullptr)
+    return false;
+
+  Reader r{data, data + size};
+
+  const char* literal = format;
+  for (const char* p = format; *p;)
+  {
+    if (*p != '%')
+    {
+      ++p;
+      continue;
+    }
+
+    out.append(literal, (size_t)(p - literal));
+
+    if (p[1] == '%')
+    {
+      out += '%';
+      p += 2;
+      literal = p;
+      continue;
+    }
+
+    FormatSpec spec;
+    if (!ParseSpec(p + 1, spec))
+      return false;
+
+    p = spec.End;
+    literal = p;
+
+    int32_t width = spec.Width;
+    if (spec.WidthStar && !r.Get(width))
+      return false;
+
+    int32_t precision = spec.Precision;
+    if (spec.PrecisionStar && !r.Get(precision))
+      return false;
+
+    // Rebuild the conversion with captured star values and a length
+    // modifier matching the widened argument
+    char fmt[64];
+    char* f = fmt;
+    *f++ = '%';
+    memcpy(f, spec.Flags, spec.FlagsLen);
+    f += spec.FlagsLen;
+
+    if (width >= 0 || spec.WidthStar)
+      f += snprintf(f, 16, "%d", (int)width);
+
+    if (spec.Class == ArgClass::STRING)
+    {
+      uint32_t len = 0;
+      if (!r.Get(len))
+        return false;
+
+      memcpy(f, ".*s", 4);
+
+      if (len == NULL_STRING)
+      {
+        AppendString(out, fmt, precision >= 0 ? precision : 6, "(null)");
+        continue;
+      }
+
+      if ((size_t)(r.End - r.Pos) < len)
+        return false;
+
+      AppendString(out, fmt, (int)len, r.Pos);
+      r.Pos += len;
+      continue;
+    }
+
+    if (precision >= 0)
+      f += snprintf(f, 16, ".%d", (int)precision);
+
+    switch (spec.Class)
+    {
+    case ArgClass::SIGNED:
+    {
+      int64_t value = 0;
+      if (!r.Get(value))
+        return false;
+
+      *f++ = 'l';
+      *f++ = 'l';
+      *f++ = spec.Conversion;
+      *f = '\0';
+      AppendFormatted(out, fmt, (long long)value);
+      break;
+    }
+
+    case ArgClass::UNSIGNED:
+    {
+      uint64_t value = 0;
+      if (!r.Get(value))
+        return false;
+
+      *f++ = 'l';
+      *f++ = 'l';
+      *f++ = spec.Conversion;
+      *f = '\0';
+      AppendFormatted(out, fmt, (unsigned long long)value);
+      break;
+    }
+
+    case ArgClass::CHAR:
+    {
+      int32_t value = 0;
+      if (!r.Get(value))
+        return false;
+
+      *f++ = spec.Conversion;
+      *f = '\0';
+      AppendFormatted(out, fmt, (int)value);
+      break;
+    }
+
+    case ArgClass::DOUBLE:
+    {
+      double value = 0;
+      if (!r.Get(value))
+        return false;
+
+      *f++ = spec.Conversion;
+      *f = '\0';
+      AppendFormatted(out, fmt, value);
+      break;
+    }
+
+    case ArgClass::POINTER:
+    {
+      uint64_t value = 0;
+      if (!r.Get(value))
+        return false;
+
+      *f++ = spec.Conversion;
+      *f = '\0';
+      AppendFormatted(out, fmt, (void*)(uintptr_t)value);
+      break;
+    }
+
+    default:
+      return false;
+    }
+  }
+
+  out.append(literal);
+  return r.Pos == r.End;
+}
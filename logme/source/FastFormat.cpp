@@ -2,9 +2,11 @@
 #include <Logme/FastFormat.h>
 #include <Logme/Utils.h>
 
+#include <algorithm>
 #include <charconv>
 #include <cstdint>
 #include <cstring>
+#include <type_traits>
 
 #ifndef LOGME_FAST_FORMAT_STATS
 #define LOGME_FAST_FORMAT_STATS 0
@@ -15,14 +17,12 @@
 #include <cstdio>
 #endif
 
-#define LOGME_INT2STR_JEAIII 0
-
 using namespace Logme;
 
 namespace
 {
   constexpr int FAST_FORMAT_CACHE_SIZE = 2;
-  constexpr int FAST_FORMAT_SCAN_LIMIT = 48;
+  constexpr size_t FAST_FORMAT_TEMP_SIZE = 512;
 
 #if LOGME_FAST_FORMAT_STATS
   struct FastFormatStats
@@ -33,25 +33,14 @@ namespace
     std::atomic<uint64_t> CacheStores{0};
     std::atomic<uint64_t> DetectedRejected{0};
     std::atomic<uint64_t> DetectedLiteral{0};
-    std::atomic<uint64_t> DetectedOneSpec{0};
-    std::atomic<uint64_t> DetectedTwoSpecs{0};
-    std::atomic<uint64_t> DetectedS{0};
-    std::atomic<uint64_t> DetectedD{0};
-    std::atomic<uint64_t> DetectedI{0};
-    std::atomic<uint64_t> DetectedU{0};
-    std::atomic<uint64_t> DetectedP{0};
+    std::atomic<uint64_t> DetectedProgram{0};
     std::atomic<uint64_t> ExecuteRejected{0};
     std::atomic<uint64_t> ExecuteLiteral{0};
-    std::atomic<uint64_t> ExecuteOneSpec{0};
-    std::atomic<uint64_t> ExecuteTwoSpecs{0};
-    std::atomic<uint64_t> ExecuteS{0};
-    std::atomic<uint64_t> ExecuteD{0};
-    std::atomic<uint64_t> ExecuteI{0};
-    std::atomic<uint64_t> ExecuteU{0};
-    std::atomic<uint64_t> ExecuteP{0};
+    std::atomic<uint64_t> ExecuteProgram{0};
+    std::atomic<uint64_t> ExecuteSpecs{0};
     std::atomic<uint64_t> AnalyzeNullFormat{0};
     std::atomic<uint64_t> AnalyzeNoPercent{0};
-    std::atomic<uint64_t> AnalyzeMoreThanTwoSpecs{0};
+    std::atomic<uint64_t> AnalyzeTooManySpecs{0};
     std::atomic<uint64_t> AnalyzeUnsupportedSpec{0};
     std::atomic<uint64_t> AnalyzeSpecAtEnd{0};
     std::atomic<uint64_t> AnalyzeTooLong{0};
@@ -59,9 +48,9 @@ namespace
 
   FastFormatStats Stats;
 
-  inline void AddStat(std::atomic<uint64_t>& value)
+  inline void AddStat(std::atomic<uint64_t>& value, uint64_t n = 1)
   {
-    value.fetch_add(1, std::memory_order_relaxed);
+    value.fetch_add(n, std::memory_order_relaxed);
   }
 
   struct FastFormatStatsPrinter
@@ -77,25 +66,14 @@ namespace
         " stores=%llu"
         " detected_rejected=%llu"
         " detected_literal=%llu"
-        " detected_one_spec=%llu"
-        " detected_two_specs=%llu"
-        " detected_s=%llu"
-        " detected_d=%llu"
-        " detected_i=%llu"
-        " detected_u=%llu"
-        " detected_p=%llu"
+        " detected_program=%llu"
         " execute_rejected=%llu"
         " execute_literal=%llu"
-        " execute_one_spec=%llu"
-        " execute_two_specs=%llu"
-        " execute_s=%llu"
-        " execute_d=%llu"
-        " execute_i=%llu"
-        " execute_u=%llu"
-        " execute_p=%llu"
+        " execute_program=%llu"
+        " execute_specs=%llu"
         " analyze_null_format=%llu"
         " analyze_no_percent=%llu"
-        " analyze_more_than_two_specs=%llu"
+        " analyze_too_many_specs=%llu"
         " analyze_unsupported_spec=%llu"
         " analyze_spec_at_end=%llu"
         " analyze_too_long=%llu"
@@ -106,25 +84,14 @@ namespace
         (unsigned long long)Stats.CacheStores.load(std::memory_order_relaxed),
         (unsigned long long)Stats.DetectedRejected.load(std::memory_order_relaxed),
         (unsigned long long)Stats.DetectedLiteral.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.DetectedOneSpec.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.DetectedTwoSpecs.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.DetectedS.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.DetectedD.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.DetectedI.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.DetectedU.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.DetectedP.load(std::memory_order_relaxed),
+        (unsigned long long)Stats.DetectedProgram.load(std::memory_order_relaxed),
         (unsigned long long)Stats.ExecuteRejected.load(std::memory_order_relaxed),
         (unsigned long long)Stats.ExecuteLiteral.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.ExecuteOneSpec.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.ExecuteTwoSpecs.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.ExecuteS.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.ExecuteD.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.ExecuteI.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.ExecuteU.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.ExecuteP.load(std::memory_order_relaxed),
+        (unsigned long long)Stats.ExecuteProgram.load(std::memory_order_relaxed),
+        (unsigned long long)Stats.ExecuteSpecs.load(std::memory_order_relaxed),
         (unsigned long long)Stats.AnalyzeNullFormat.load(std::memory_order_relaxed),
         (unsigned long long)Stats.AnalyzeNoPercent.load(std::memory_order_relaxed),
-        (unsigned long long)Stats.AnalyzeMoreThanTwoSpecs.load(std::memory_order_relaxed),
+        (unsigned long long)Stats.AnalyzeTooManySpecs.load(std::memory_order_relaxed),
         (unsigned long long)Stats.AnalyzeUnsupportedSpec.load(std::memory_order_relaxed),
         (unsigned long long)Stats.AnalyzeSpecAtEnd.load(std::memory_order_relaxed),
         (unsigned long long)Stats.AnalyzeTooLong.load(std::memory_order_relaxed)
@@ -135,8 +102,10 @@ namespace
   FastFormatStatsPrinter StatsPrinter;
 
 #define FAST_FORMAT_STAT(x) AddStat(Stats.x)
+#define FAST_FORMAT_STAT_N(x, n) AddStat(Stats.x, n)
 #else
 #define FAST_FORMAT_STAT(x) do { } while (0)
+#define FAST_FORMAT_STAT_N(x, n) do { } while (0)
 #endif
 
   thread_local FastFormatEntry FastFormatCache[FAST_FORMAT_CACHE_SIZE]{};
@@ -165,11 +134,11 @@ namespace
       if (entry.Format == format)
       {
         if (cache.State.load(std::memory_order_acquire) == ContextCacheState::EMPTY)
-        { 
+        {
           std::lock_guard guard(FastCacheLock);
 
           if (cache.State.load(std::memory_order_relaxed) == ContextCacheState::EMPTY)
-          { 
+          {
             cache.Ffe = entry;
             cache.State.store(ContextCacheState::READY, std::memory_order_release);
           }
@@ -211,133 +180,262 @@ namespace
     *dst = '\0';
   }
 
-  inline void AppendInt(
+  inline void FillBounded(
     char*& dst
     , size_t& left
-    , int value
+    , char ch
+    , size_t count
   )
   {
-    if (left <= 1)
+    if (left <= 1 || count == 0)
       return;
 
-    char temp[32];
+    size_t n = count;
+    if (n >= left)
+      n = left - 1;
 
-#if LOGME_INT2STR_JEAIII
-    int len = Logme::PrintIntJeaiii(
-      temp
-      , sizeof(temp)
-      , value
-    );
-    if (len < 0)
-      return;
-    
-    CopyBounded(dst, left, temp, (size_t)len);
-#else
-    auto rc = std::to_chars(temp, temp + sizeof(temp), value);
-    if (rc.ec != std::errc())
-      return;
-    
-    CopyBounded(dst, left, temp, (size_t)(rc.ptr - temp));
-#endif
+    memset(dst, ch, n);
+    dst += n;
+    left -= n;
+    *dst = '\0';
   }
 
-  inline void AddDetectSpecStat(FastFormatKind kind)
+  // Writes prefix, zeros and body padded to the spec width like printf does.
+  // zeroPad moves the padding between the prefix and the body.
+  void AppendField(
+    const FastFormatSpec& spec
+    , char*& dst
+    , size_t& left
+    , const char* prefix
+    , size_t prefixLen
+    , size_t zeros
+    , const char* body
+    , size_t bodyLen
+    , bool zeroPad
+  )
   {
-    switch (kind)
+    size_t total = prefixLen + zeros + bodyLen;
+    size_t pad = spec.Width > total ? spec.Width - total : 0;
+    bool leftAlign = (spec.Flags & FAST_FORMAT_FLAG_LEFT) != 0;
+
+    if (pad && !leftAlign)
     {
-    case FastFormatKind::FORMAT_S:
-      FAST_FORMAT_STAT(DetectedS);
-      break;
+      if (zeroPad)
+        zeros += pad;
+      else
+        FillBounded(dst, left, ' ', pad);
+    }
 
-    case FastFormatKind::FORMAT_D:
-      FAST_FORMAT_STAT(DetectedD);
-      break;
+    CopyBounded(dst, left, prefix, prefixLen);
+    FillBounded(dst, left, '0', zeros);
+    CopyBounded(dst, left, body, bodyLen);
 
-    case FastFormatKind::FORMAT_I:
-      FAST_FORMAT_STAT(DetectedI);
-      break;
+    if (pad && leftAlign)
+      FillBounded(dst, left, ' ', pad);
+  }
 
-    case FastFormatKind::FORMAT_U:
-      FAST_FORMAT_STAT(DetectedU);
-      break;
+  inline void ToUpper(char* text, size_t len)
+  {
+    for (size_t i = 0; i < len; i++)
+    {
+      if (text[i] >= 'a' && text[i] <= 'z')
+        text[i] = char(text[i] - 'a' + 'A');
+    }
+  }
 
-    case FastFormatKind::FORMAT_P:
-      FAST_FORMAT_STAT(DetectedP);
-      break;
+  template<typename TArgs>
+  int64_t ReadSigned(FastFormatLength length, TArgs& args)
+  {
+    switch (length)
+    {
+    case FastFormatLength::CHAR:
+      return (signed char)va_arg(args, int);
+
+    case FastFormatLength::SHORT:
+      return (short)va_arg(args, int);
+
+    case FastFormatLength::LONG:
+      return va_arg(args, long);
+
+    case FastFormatLength::LONG_LONG:
+      return va_arg(args, long long);
+
+    case FastFormatLength::INTMAX:
+      return va_arg(args, intmax_t);
+
+    case FastFormatLength::SIZE:
+      return va_arg(args, std::make_signed_t<size_t>);
+
+    case FastFormatLength::PTRDIFF:
+      return va_arg(args, ptrdiff_t);
 
     default:
-      break;
+      return va_arg(args, int);
     }
   }
 
-  inline void AddExecuteSpecStat(FastFormatKind kind)
+  template<typename TArgs>
+  uint64_t ReadUnsigned(FastFormatLength length, TArgs& args)
   {
-    switch (kind)
+    switch (length)
     {
-    case FastFormatKind::FORMAT_S:
-      FAST_FORMAT_STAT(ExecuteS);
-      break;
+    case FastFormatLength::CHAR:
+      return (unsigned char)va_arg(args, unsigned int);
 
-    case FastFormatKind::FORMAT_D:
-      FAST_FORMAT_STAT(ExecuteD);
-      break;
+    case FastFormatLength::SHORT:
+      return (unsigned short)va_arg(args, unsigned int);
 
-    case FastFormatKind::FORMAT_I:
-      FAST_FORMAT_STAT(ExecuteI);
-      break;
+    case FastFormatLength::LONG:
+      return va_arg(args, unsigned long);
 
-    case FastFormatKind::FORMAT_U:
-      FAST_FORMAT_STAT(ExecuteU);
-      break;
+    case FastFormatLength::LONG_LONG:
+      return va_arg(args, unsigned long long);
 
-    case FastFormatKind::FORMAT_P:
-      FAST_FORMAT_STAT(ExecuteP);
-      break;
+    case FastFormatLength::INTMAX:
+      return va_arg(args, uintmax_t);
+
+    case FastFormatLength::SIZE:
+      return va_arg(args, size_t);
+
+    case FastFormatLength::PTRDIFF:
+      return va_arg(args, std::make_unsigned_t<ptrdiff_t>);
 
     default:
-      break;
+      return va_arg(args, unsigned int);
     }
   }
 
-  inline uint16_t AlignBufferSizeHint(size_t size)
+  template<typename TArgs>
+  void AppendInteger(
+    const FastFormatSpec& spec
+    , char*& dst
+    , size_t& left
+    , TArgs& args
+  )
   {
-    constexpr size_t ALIGNMENT = 32;
+    bool negative = false;
+    bool isSigned = spec.Kind == FastFormatKind::FORMAT_D || spec.Kind == FastFormatKind::FORMAT_I;
+    uint64_t value;
+
+    if (isSigned)
+    {
+      int64_t v = ReadSigned(spec.Length, args);
+      negative = v < 0;
+      value = negative ? 0 - (uint64_t)v : (uint64_t)v;
+    }
+    else
+      value = ReadUnsigned(spec.Length, args);
+
+    char digits[32];
+    size_t n = 0;
+
+    // "%.0d" prints nothing for zero
+    if (value != 0 || spec.Precision != 0)
+    {
+      if (spec.Kind == FastFormatKind::FORMAT_X || spec.Kind == FastFormatKind::FORMAT_O)
+      {
+        int base = spec.Kind == FastFormatKind::FORMAT_X ? 16 : 8;
+        auto rc = std::to_chars(digits, digits + sizeof(digits), value, base);
+        n = size_t(rc.ptr - digits);
+
+        if (spec.Flags & FAST_FORMAT_FLAG_UPPER)
+          ToUpper(digits, n);
+      }
+      else
+        n = (size_t)PrintUIntJeaiii(digits, sizeof(digits), value);
+    }
 
-    size = (size + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1);
-    if (size > 0xFFFFu)
-      size = 0xFFFFu;
+    size_t zeros = spec.Precision > 0 && size_t(spec.Precision) > n
+      ? size_t(spec.Precision) - n
+      : 0;
+
+    char prefix[2];
+    size_t prefixLen = 0;
+
+    // printf ignores '+' and ' ' for unsigned conversions
+    if (negative)
+      prefix[prefixLen++] = '-';
+    else if (isSigned && (spec.Flags & FAST_FORMAT_FLAG_PLUS))
+      prefix[prefixLen++] = '+';
+    else if (isSigned && (spec.Flags & FAST_FORMAT_FLAG_SPACE))
+      prefix[prefixLen++] = ' ';
+
+    if (spec.Flags & FAST_FORMAT_FLAG_ALT)
+    {
+      if (spec.Kind == FastFormatKind::FORMAT_X && value != 0)
+      {
+        prefix[prefixLen++] = '0';
+        prefix[prefixLen++] = (spec.Flags & FAST_FORMAT_FLAG_UPPER) ? 'X' : 'x';
+      }
+      else if (spec.Kind == FastFormatKind::FORMAT_O && zeros == 0 && (n == 0 || digits[0] != '0'))
+        zeros = 1;
+    }
 
-    return (uint16_t)size;
+    bool zeroPad = (spec.Flags & FAST_FORMAT_FLAG_ZERO) && spec.Precision < 0;
+    AppendField(spec, dst, left, prefix, prefixLen, zeros, digits, n, zeroPad);
   }
 
-  inline uint16_t GetMaxArgTextSize(FastFormatKind kind)
+#if LOGME_FAST_FORMAT_FLOAT
+  template<typename TArgs>
+  void AppendFloat(
+    const FastFormatSpec& spec
+    , char*& dst
+    , size_t& left
+    , TArgs& args
+  )
   {
-    switch (kind)
-    {
-    case FastFormatKind::FORMAT_D:
-    case FastFormatKind::FORMAT_I:
-      return 11;
+    double value = va_arg(args, double);
+    int precision = spec.Precision < 0 ? int(Detail::FAST_FORMAT_DEFAULT_PRECISION) : spec.Precision;
+
+    std::chars_format fmt = std::chars_format::general;
+    if (spec.Kind == FastFormatKind::FORMAT_F)
+      fmt = std::chars_format::fixed;
+    else if (spec.Kind == FastFormatKind::FORMAT_E)
+      fmt = std::chars_format::scientific;
+
+    // std::to_chars with precision produces the same text as "%.*f",
+    // "%.*e" and "%.*g" in the C locale
+    char temp[FAST_FORMAT_TEMP_SIZE];
+    auto rc = std::to_chars(temp, temp + sizeof(temp), value, fmt, precision);
+    if (rc.ec != std::errc())
+      return;
 
-    case FastFormatKind::FORMAT_U:
-      return 10;
+    char* body = temp;
+    size_t n = size_t(rc.ptr - temp);
 
-    case FastFormatKind::FORMAT_P:
-      return (uint16_t)(2 + sizeof(uintptr_t) * 2);
+    char prefix[1];
+    size_t prefixLen = 0;
 
-    default:
-      return 0;
+    if (*body == '-')
+    {
+      prefix[prefixLen++] = '-';
+      body++;
+      n--;
     }
+    else if (spec.Flags & FAST_FORMAT_FLAG_PLUS)
+      prefix[prefixLen++] = '+';
+    else if (spec.Flags & FAST_FORMAT_FLAG_SPACE)
+      prefix[prefixLen++] = ' ';
+
+    if (spec.Flags & FAST_FORMAT_FLAG_UPPER)
+      ToUpper(body, n);
+
+    // inf and nan are padded with spaces
+    bool finite = n && *body >= '0' && *body <= '9';
+    bool zeroPad = finite && (spec.Flags & FAST_FORMAT_FLAG_ZERO);
+    AppendField(spec, dst, left, prefix, prefixLen, 0, body, n, zeroPad);
   }
+#endif
 
   template<typename TArgs>
-  inline bool AppendArg(
-    FastFormatKind kind
+  void AppendArg(
+    const FastFormatSpec& spec
     , char*& dst
     , size_t& left
     , TArgs& args
   )
   {
-    switch (kind)
+    switch (spec.Kind)
     {
     case FastFormatKind::FORMAT_S:
     {
@@ -345,29 +443,26 @@ namespace
       if (text == nullptr)
         text = "(null)";
 
-      CopyBounded(dst, left, text, BoundedStringLen(text, left > 0 ? left - 1 : 0));
-      return true;
-    }
+      size_t limit = left > 0 ? left - 1 : 0;
+      if (limit < spec.Width)
+        limit = spec.Width;
 
-    case FastFormatKind::FORMAT_D:
-    case FastFormatKind::FORMAT_I:
-    {
-      int value = va_arg(args, int);
-      AppendInt(dst, left, value);
-      return true;
+      if (spec.Precision >= 0 && limit > size_t(spec.Precision))
+        limit = size_t(spec.Precision);
+
+      size_t len = BoundedStringLen(text, limit);
+      if (spec.Width == 0)
+        CopyBounded(dst, left, text, len);
+      else
+        AppendField(spec, dst, left, nullptr, 0, 0, text, len, false);
+      break;
     }
 
-    case FastFormatKind::FORMAT_U:
+    case FastFormatKind::FORMAT_C:
     {
-      unsigned int value = va_arg(args, unsigned int);
-
-      char temp[32];
-      auto rc = std::to_chars(temp, temp + sizeof(temp), value);
-      if (rc.ec != std::errc())
-        return false;
-
-      CopyBounded(dst, left, temp, (size_t)(rc.ptr - temp));
-      return true;
+      char ch = (char)va_arg(args, int);
+      AppendField(spec, dst, left, nullptr, 0, 0, &ch, 1, false);
+      break;
     }
 
     case FastFormatKind::FORMAT_P:
@@ -375,23 +470,33 @@ namespace
       void* value = va_arg(args, void*);
 
       char temp[32];
-      temp[0] = '0';
-      temp[1] = 'x';
-      auto rc = std::to_chars(
-        temp + 2
-        , temp + sizeof(temp)
-        , (uintptr_t)value
-        , 16
-      );
-      if (rc.ec != std::errc())
-        return false;
-
-      CopyBounded(dst, left, temp, (size_t)(rc.ptr - temp));
-      return true;
+      auto rc = std::to_chars(temp, temp + sizeof(temp), (uintptr_t)value, 16);
+      AppendField(spec, dst, left, "0x", 2, 0, temp, size_t(rc.ptr - temp), false);
+      break;
     }
 
+    case FastFormatKind::FORMAT_D:
+    case FastFormatKind::FORMAT_I:
+    case FastFormatKind::FORMAT_U:
+    case FastFormatKind::FORMAT_X:
+    case FastFormatKind::FORMAT_O:
+      AppendInteger(spec, dst, left, args);
+      break;
+
+#if LOGME_FAST_FORMAT_FLOAT
+    case FastFormatKind::FORMAT_F:
+    case FastFormatKind::FORMAT_E:
+    case FastFormatKind::FORMAT_G:
+      AppendFloat(spec, dst, left, args);
+      break;
+#endif
+
+    case FastFormatKind::FORMAT_PERCENT:
+      CopyBounded(dst, left, "%", 1);
+      break;
+
     default:
-      return false;
+      break;
     }
   }
 
@@ -399,10 +504,7 @@ namespace
   {
     FastFormatEntry entry{};
     entry.Format = format;
-    entry.Kind1 = FastFormatKind::NONE;
-    entry.Kind2 = FastFormatKind::NONE;
-    entry.BufferSizeHint = 0;
-    entry.SpecCount = 0;
+    entry.Type = FastFormatType::NONE;
 
     if (format == nullptr)
     {
@@ -411,122 +513,38 @@ namespace
       return entry;
     }
 
-    auto formatLen = strlen(format);
-    if (formatLen >= FAST_FORMAT_SCAN_LIMIT)
+    auto rc = Detail::CompileFastFormat(format, strlen(format), entry);
+    switch (rc)
     {
+    case Detail::FastFormatBuildResult::TOO_LONG:
       FAST_FORMAT_STAT(AnalyzeTooLong);
-      FAST_FORMAT_STAT(DetectedRejected);
-      return entry;
-    }
-
-    for (size_t i = 0; i < formatLen; i++)
-    {
-      char ch = format[i];
-
-      if (ch != '%')
-        continue;
+      break;
 
-      if (i + 1 >= formatLen)
-      {
-        FAST_FORMAT_STAT(AnalyzeSpecAtEnd);
-        FAST_FORMAT_STAT(DetectedRejected);
-        entry.SpecCount = 0;
-        entry.Kind1 = FastFormatKind::NONE;
-        entry.Kind2 = FastFormatKind::NONE;
-        return entry;
-      }
+    case Detail::FastFormatBuildResult::TOO_MANY_SPECS:
+      FAST_FORMAT_STAT(AnalyzeTooManySpecs);
+      break;
 
-      char spec = format[i + 1];
-
-      FastFormatKind kind = FastFormatKind::NONE;
-      if (spec == 's')
-        kind = FastFormatKind::FORMAT_S;
-      else if (spec == 'd')
-        kind = FastFormatKind::FORMAT_D;
-      else if (spec == 'i')
-        kind = FastFormatKind::FORMAT_I;
-      else if (spec == 'u')
-        kind = FastFormatKind::FORMAT_U;
-      else if (spec == 'p')
-        kind = FastFormatKind::FORMAT_P;
-      else
-      {
-        FAST_FORMAT_STAT(AnalyzeUnsupportedSpec);
-        FAST_FORMAT_STAT(DetectedRejected);
-        entry.SpecCount = 0;
-        entry.Kind1 = FastFormatKind::NONE;
-        entry.Kind2 = FastFormatKind::NONE;
-        return entry;
-      }
+    case Detail::FastFormatBuildResult::UNSUPPORTED_SPEC:
+      FAST_FORMAT_STAT(AnalyzeUnsupportedSpec);
+      break;
 
-      if (entry.SpecCount == 0)
-      {
-        entry.Kind1 = kind;
-        entry.Part0Len = (uint16_t)i;
-        entry.Part1Pos = (uint16_t)(i + 2);
-        entry.SpecCount = 1;
-      }
-      else if (entry.SpecCount == 1)
-      {
-        entry.Kind2 = kind;
-        entry.Part1Len = (uint16_t)(i - entry.Part1Pos);
-        entry.Part2Pos = (uint16_t)(i + 2);
-        entry.SpecCount = 2;
-      }
-      else
-      {
-        FAST_FORMAT_STAT(AnalyzeMoreThanTwoSpecs);
-        FAST_FORMAT_STAT(DetectedRejected);
-        entry.SpecCount = 0;
-        entry.Kind1 = FastFormatKind::NONE;
-        entry.Kind2 = FastFormatKind::NONE;
-        return entry;
-      }
+    case Detail::FastFormatBuildResult::SPEC_AT_END:
+      FAST_FORMAT_STAT(AnalyzeSpecAtEnd);
+      break;
 
-      i++;
+    default:
+      break;
     }
 
-    if (entry.SpecCount == 0)
+    if (entry.Type == FastFormatType::NONE)
+      FAST_FORMAT_STAT(DetectedRejected);
+    else if (entry.Type == FastFormatType::LITERAL)
     {
-      entry.Kind1 = FastFormatKind::LITERAL;
-      entry.Part0Len = (uint16_t)formatLen;
-      entry.BufferSizeHint = AlignBufferSizeHint(formatLen + 2);
       FAST_FORMAT_STAT(AnalyzeNoPercent);
       FAST_FORMAT_STAT(DetectedLiteral);
-      return entry;
     }
-
-    if (entry.SpecCount == 1)
-      entry.Part1Len = (uint16_t)(formatLen - entry.Part1Pos);
-    else
-      entry.Part2Len = (uint16_t)(formatLen - entry.Part2Pos);
-
-    if (entry.SpecCount == 1)
-      FAST_FORMAT_STAT(DetectedOneSpec);
     else
-      FAST_FORMAT_STAT(DetectedTwoSpecs);
-
-    AddDetectSpecStat(entry.Kind1);
-    if (entry.SpecCount == 2)
-      AddDetectSpecStat(entry.Kind2);
-
-    uint16_t maxArg1 = GetMaxArgTextSize(entry.Kind1);
-    uint16_t maxArg2 = 0;
-    if (entry.SpecCount == 2)
-      maxArg2 = GetMaxArgTextSize(entry.Kind2);
-
-    if (maxArg1 > 0 && (entry.SpecCount < 2 || maxArg2 > 0))
-    {
-      size_t maxSize = 
-        (size_t)entry.Part0Len
-        + (size_t)entry.Part1Len
-        + (size_t)entry.Part2Len
-        + maxArg1
-        + maxArg2
-        + 2;
-
-      entry.BufferSizeHint = AlignBufferSizeHint(maxSize);
-    }
+      FAST_FORMAT_STAT(DetectedProgram);
 
     return entry;
   }
@@ -550,57 +568,50 @@ namespace
 
     *dst = '\0';
 
-    if (entry.Kind1 == FastFormatKind::NONE)
+    // Only this check may fail: the caller formats the same arguments with
+    // vsnprintf, so none of them may be consumed before it
+    if (entry.Type == FastFormatType::NONE)
     {
       FAST_FORMAT_STAT(ExecuteRejected);
       return false;
     }
 
-    if (entry.Kind1 == FastFormatKind::LITERAL)
-    {
+    if (entry.Type == FastFormatType::LITERAL)
       FAST_FORMAT_STAT(ExecuteLiteral);
-      CopyBounded(dst, left, entry.Format, entry.Part0Len);
-      if (outLen)
-        *outLen = (size_t)(dst - buffer);
-      return true;
-    }
-
-    if (entry.SpecCount == 1)
-      FAST_FORMAT_STAT(ExecuteOneSpec);
-    else if (entry.SpecCount == 2)
-      FAST_FORMAT_STAT(ExecuteTwoSpecs);
-
-    AddExecuteSpecStat(entry.Kind1);
-    CopyBounded(dst, left, entry.Format, entry.Part0Len);
-    if (AppendArg(entry.Kind1, dst, left, args) == false)
-      return false;
-
-    if (entry.SpecCount == 1)
+    else
     {
-      CopyBounded(dst, left, entry.Format + entry.Part1Pos, entry.Part1Len);
-      if (outLen)
-        *outLen = (size_t)(dst - buffer);
-      return true;
+      FAST_FORMAT_STAT(ExecuteProgram);
+      FAST_FORMAT_STAT_N(ExecuteSpecs, entry.SpecCount);
     }
 
-    if (entry.SpecCount != 2)
+    for (uint8_t n = 0; n < entry.SpecCount; n++)
     {
-      FAST_FORMAT_STAT(ExecuteRejected);
-      return false;
-    }
+      const FastFormatSpec& spec = entry.Specs[n];
 
-    CopyBounded(dst, left, entry.Format + entry.Part1Pos, entry.Part1Len);
-    AddExecuteSpecStat(entry.Kind2);
-    if (AppendArg(entry.Kind2, dst, left, args) == false)
-      return false;
+      CopyBounded(dst, left, entry.Format + spec.LiteralPos, spec.LiteralLen);
+      AppendArg(spec, dst, left, args);
+    }
 
-    CopyBounded(dst, left, entry.Format + entry.Part2Pos, entry.Part2Len);
+    CopyBounded(dst, left, entry.Format + entry.TailPos, entry.TailLen);
     if (outLen)
       *outLen = (size_t)(dst - buffer);
     return true;
   }
 }
 
+void Logme::SetFastFormat(ContextCache& cache, const FastFormatEntry& entry)
+{
+  if (cache.State.load(std::memory_order_acquire) != ContextCacheState::EMPTY)
+    return;
+
+  std::lock_guard guard(FastCacheLock);
+  if (cache.State.load(std::memory_order_relaxed) == ContextCacheState::EMPTY)
+  {
+    cache.Ffe = entry;
+    cache.State.store(ContextCacheState::READY, std::memory_order_release);
+  }
+}
+
 bool Logme::TryFastFormat(
   Context& context
   , char* buffer
@@ -627,15 +638,6 @@ bool Logme::TryFastFormat(
   FastFormatEntry entry = BuildFastFormat(format);
   StoreFastFormat(entry);
 
-  if (context.Cache.State.load(std::memory_order_acquire) == ContextCacheState::EMPTY)
-  { 
-    std::lock_guard guard(FastCacheLock);
-    if (context.Cache.State.load(std::memory_order_relaxed) == ContextCacheState::EMPTY)
-    {
-      context.Cache.Ffe = entry;
-      context.Cache.State.store(ContextCacheState::READY, std::memory_order_release);
-    }
-  }
-
+  SetFastFormat(context.Cache, entry);
   return ExecuteFastFormat(entry, buffer, bufferSize, args, outLen);
 }
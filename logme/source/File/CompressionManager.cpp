@@ -1,5 +1,5 @@
+#include <algorithm>
 #include <atomic>
-#include <array>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
@@ -9,17 +9,57 @@
 #include <Logme/Logme.h>
 #include <Logme/Utils.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
 #ifdef USE_ZLIB
 #include <zlib.h>
 #endif
 
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
 using namespace Logme;
 
-#ifdef USE_ZLIB
+namespace Logme
+{
+  struct CompressionBlock
+  {
+    CompressionCodec Codec;
+    int Level;
+    std::string Input;
+    std::string Output;
+    bool Done;
+    bool Failed;
+
+    CompressionBlock(CompressionCodec codec, int level)
+      : Codec(codec)
+      , Level(level)
+      , Done(false)
+      , Failed(false)
+    {
+    }
+  };
+}
+
 namespace
 {
   std::atomic<std::uint64_t> TempFileCounter(0);
 
+  std::atomic<std::uint64_t> GlobalGzipFiles(0);
+  std::atomic<std::uint64_t> GlobalZstdFiles(0);
+  std::atomic<std::uint64_t> GlobalFailedFiles(0);
+  std::atomic<std::uint64_t> GlobalBlocks(0);
+  std::atomic<std::uint64_t> GlobalInputBytes(0);
+  std::atomic<std::uint64_t> GlobalOutputBytes(0);
+  std::atomic<std::uint64_t> GlobalCpuNanoseconds(0);
+  std::atomic<std::uint64_t> GlobalActiveNanoseconds(0);
+  std::atomic<std::uint64_t> GlobalThreads(0);
+
   bool EndsWith(
     const std::string& value
     , const std::string& suffix
@@ -35,7 +75,7 @@ namespace
     ) == 0;
   }
 
-  std::string MakeTemporaryGzipName(const std::string& finalName)
+  std::string MakeTemporaryName(const std::string& finalName)
   {
     auto now = std::chrono::steady_clock::now().time_since_epoch().count();
     auto counter = TempFileCounter.fetch_add(1, std::memory_order_relaxed);
@@ -46,18 +86,144 @@ namespace
       + "."
       + std::to_string(counter);
   }
-}
+
+  std::uint64_t GetThreadCpuTime()
+  {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+      return 0;
+
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+
+    // FILETIME counts 100 ns intervals
+    return (k.QuadPart + u.QuadPart) * 100;
+#else
+    timespec ts{};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+      return 0;
+
+    return std::uint64_t(ts.tv_sec) * 1000000000ULL + std::uint64_t(ts.tv_nsec);
+#endif
+  }
+
+  // Each block becomes a complete gzip member
+  bool CompressGzip(
+    const std::string& input
+    , int level
+    , std::string& output
+  )
+  {
+#ifndef USE_ZLIB
+    (void)input;
+    (void)level;
+    (void)output;
+    return false;
+#else
+    z_stream zs{};
+    int rc = deflateInit2(
+      &zs
+      , level ? level : Z_DEFAULT_COMPRESSION
+      , Z_DEFLATED
+      , 15 + 16
+      , 8
+      , Z_DEFAULT_STRATEGY
+    );
+
+    if (rc != Z_OK)
+      return false;
+
+    output.resize(deflateBound(&zs, static_cast<uLong>(input.size())));
+
+    zs.next_in = (Bytef*)input.data();
+    zs.avail_in = static_cast<uInt>(input.size());
+    zs.next_out = (Bytef*)output.data();
+    zs.avail_out = static_cast<uInt>(output.size());
+
+    rc = deflate(&zs, Z_FINISH);
+    output.resize(zs.total_out);
+    deflateEnd(&zs);
+
+    return rc == Z_STREAM_END;
 #endif
+  }
+
+#ifdef USE_ZSTD
+  struct ZstdContext
+  {
+    ZSTD_CCtx* Context;
+
+    ZstdContext()
+      : Context(ZSTD_createCCtx())
+    {
+    }
+
+    ~ZstdContext()
+    {
+      ZSTD_freeCCtx(Context);
+    }
+  };
+#endif
+
+  // Each block becomes a complete zstd frame
+  bool CompressZstd(
+    const std::string& input
+    , int level
+    , std::string& output
+  )
+  {
+#ifndef USE_ZSTD
+    (void)input;
+    (void)level;
+    (void)output;
+    return false;
+#else
+    thread_local ZstdContext zstd;
+    if (zstd.Context == nullptr)
+      return false;
+
+    output.resize(ZSTD_compressBound(input.size()));
+
+    // Level 0 selects the default level of the library
+    size_t n = ZSTD_compressCCtx(
+      zstd.Context
+      , &output[0]
+      , output.size()
+      , input.data()
+      , input.size()
+      , level
+    );
+
+    if (ZSTD_isError(n))
+      return false;
+
+    output.resize(n);
+    return true;
+#endif
+  }
+}
 
 CompressionRegistration::CompressionRegistration()
   : Factory(nullptr)
   , Active(false)
+  , Codec(CompressionCodec::GZIP)
+  , Level(0)
 {
 }
 
-CompressionRegistration::CompressionRegistration(CompressionManagerFactory* factory)
+CompressionRegistration::CompressionRegistration(
+  CompressionManagerFactory* factory
+  , CompressionCodec codec
+  , int level
+)
   : Factory(factory)
   , Active(factory != nullptr)
+  , Codec(codec)
+  , Level(level)
 {
 }
 
@@ -69,6 +235,8 @@ CompressionRegistration::~CompressionRegistration()
 CompressionRegistration::CompressionRegistration(CompressionRegistration&& other) noexcept
   : Factory(other.Factory)
   , Active(other.Active)
+  , Codec(other.Codec)
+  , Level(other.Level)
 {
   other.Factory = nullptr;
   other.Active = false;
@@ -85,6 +253,8 @@ CompressionRegistration& CompressionRegistration::operator=(
 
   Factory = other.Factory;
   Active = other.Active;
+  Codec = other.Codec;
+  Level = other.Level;
   other.Factory = nullptr;
   other.Active = false;
 
@@ -96,7 +266,7 @@ void CompressionRegistration::Submit(const std::string& file)
   if (!Active || Factory == nullptr)
     return;
 
-  Factory->Submit(file);
+  Factory->Submit(file, Codec, Level);
 }
 
 void CompressionRegistration::Reset()
@@ -116,11 +286,17 @@ bool CompressionRegistration::IsActive() const
   return Active;
 }
 
-CompressionManager::CompressionManager(TFileInUseCallback testFileInUse)
+CompressionManager::CompressionManager(
+  TFileInUseCallback testFileInUse
+  , TFileReplacedCallback fileReplaced
+)
   : StopRequested(false)
-  , Stopped(true)
   , UserCount(0)
+  , Threads(GetDefaultThreads())
+  , Running(0)
+  , ActiveFiles(0)
   , TestFileInUse(std::move(testFileInUse))
+  , FileReplaced(std::move(fileReplaced))
 {
 }
 
@@ -130,7 +306,11 @@ CompressionManager::~CompressionManager()
   Join();
 }
 
-void CompressionManager::Submit(const std::string& file)
+void CompressionManager::Submit(
+  const std::string& file
+  , CompressionCodec codec
+  , int level
+)
 {
   if (file.empty())
     return;
@@ -140,8 +320,8 @@ void CompressionManager::Submit(const std::string& file)
   if (StopRequested)
     return;
 
-  Queue.push_back(file);
-  StartWorkerLocked();
+  Queue.push_back(Job{file, codec, level});
+  StartWorkersLocked();
   CV.notify_all();
 }
 
@@ -154,6 +334,14 @@ void CompressionManager::SetUserCount(std::size_t userCount)
     CV.notify_all();
 }
 
+void CompressionManager::SetThreads(std::size_t threads)
+{
+  std::lock_guard guard(Lock);
+
+  // A smaller pool takes effect when the running workers have finished
+  Threads = threads ? std::min<std::size_t>(threads, MAX_THREADS) : GetDefaultThreads();
+}
+
 void CompressionManager::StopWhenQueueEmpty()
 {
   std::lock_guard guard(Lock);
@@ -171,72 +359,302 @@ void CompressionManager::SetStopping()
 
 void CompressionManager::Join()
 {
-  if (Worker.joinable())
-    Worker.join();
+  std::vector<std::thread> workers;
+
+  {
+    std::lock_guard guard(Lock);
+    workers.swap(Workers);
+  }
+
+  for (auto& worker : workers)
+  {
+    if (worker.joinable())
+      worker.join();
+  }
 }
 
 bool CompressionManager::IsStopped()
 {
   std::lock_guard guard(Lock);
-  return Stopped;
+  return Running == 0;
 }
 
-void CompressionManager::StartWorkerLocked()
+std::size_t CompressionManager::GetDefaultThreads()
 {
-  if (Worker.joinable() && Stopped)
-    Worker.join();
+  std::size_t cpus = std::thread::hardware_concurrency();
+  return std::clamp<std::size_t>(cpus / 2, 1, 4);
+}
 
-  if (Worker.joinable())
-    return;
+bool CompressionManager::IsCodecSupported(CompressionCodec codec)
+{
+  switch (codec)
+  {
+  case CompressionCodec::GZIP:
+#ifdef USE_ZLIB
+    return true;
+#else
+    return false;
+#endif
 
-  StopRequested = false;
-  Stopped = false;
-  Worker = std::thread(&CompressionManager::WorkerFunc, this);
+  case CompressionCodec::ZSTD:
+#ifdef USE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  return false;
+}
+
+const char* CompressionManager::GetExtension(CompressionCodec codec)
+{
+  return codec == CompressionCodec::ZSTD ? ".zst" : ".gz";
+}
+
+int CompressionManager::GetMaxLevel(CompressionCodec codec)
+{
+  return codec == CompressionCodec::ZSTD ? 22 : 9;
+}
+
+CompressionCounters CompressionManager::GetCounters()
+{
+  CompressionCounters out;
+  out.GzipFiles = GlobalGzipFiles.load(std::memory_order_relaxed);
+  out.ZstdFiles = GlobalZstdFiles.load(std::memory_order_relaxed);
+  out.FailedFiles = GlobalFailedFiles.load(std::memory_order_relaxed);
+  out.Blocks = GlobalBlocks.load(std::memory_order_relaxed);
+  out.InputBytes = GlobalInputBytes.load(std::memory_order_relaxed);
+  out.OutputBytes = GlobalOutputBytes.load(std::memory_order_relaxed);
+  out.CpuNanoseconds = GlobalCpuNanoseconds.load(std::memory_order_relaxed);
+  out.ActiveNanoseconds = GlobalActiveNanoseconds.load(std::memory_order_relaxed);
+  out.Threads = GlobalThreads.load(std::memory_order_relaxed);
+  return out;
+}
+
+void CompressionManager::StartWorkersLocked()
+{
+  if (Running == 0)
+  {
+    // Workers that have left WorkerFunc only need to be joined
+    for (auto& worker : Workers)
+    {
+      if (worker.joinable())
+        worker.join();
+    }
+
+    Workers.clear();
+    StopRequested = false;
+  }
+
+  while (Running < Threads)
+  {
+    Workers.emplace_back(&CompressionManager::WorkerFunc, this);
+    Running++;
+    GlobalThreads.fetch_add(1, std::memory_order_relaxed);
+  }
 }
 
 void CompressionManager::WorkerFunc()
 {
   RenameThread(uint64_t(-1), "CompressionManager::WorkerFunc");
 
+  std::unique_lock guard(Lock);
+
   for (;;)
   {
-    std::string file;
+    CV.wait(
+      guard
+      , [this]()
+      {
+        return StopRequested
+          || !Blocks.empty()
+          || !Queue.empty()
+          || UserCount == 0;
+      }
+    );
 
+    // Blocks of files that are already being compressed go first
+    if (!Blocks.empty())
     {
-      std::unique_lock guard(Lock);
-      CV.wait(
-        guard
-        , [this]()
-        {
-          return StopRequested || !Queue.empty() || UserCount == 0;
-        }
-      );
-
-      if (Queue.empty())
-      {
-        if (StopRequested || UserCount == 0)
-          break;
+      CompressionBlockPtr block = std::move(Blocks.front());
+      Blocks.pop_front();
 
-        continue;
-      }
+      guard.unlock();
+      RunBlock(block);
+      guard.lock();
+      continue;
+    }
 
-      file = std::move(Queue.front());
+    if (!Queue.empty())
+    {
+      Job job = std::move(Queue.front());
       Queue.erase(Queue.begin());
+
+      guard.unlock();
+      CompressFile(job);
+      guard.lock();
+      continue;
     }
 
-    CompressFile(file);
+    if (StopRequested || UserCount == 0)
+      break;
+  }
+
+  Running--;
+  GlobalThreads.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void CompressionManager::RunBlock(const CompressionBlockPtr& block)
+{
+  std::uint64_t cpu = GetThreadCpuTime();
+  bool ok = false;
+
+  try
+  {
+    if (block->Codec == CompressionCodec::ZSTD)
+      ok = CompressZstd(block->Input, block->Level, block->Output);
+    else
+      ok = CompressGzip(block->Input, block->Level, block->Output);
   }
+  catch (const std::bad_alloc&)
+  {
+    ok = false;
+  }
+
+  GlobalCpuNanoseconds.fetch_add(GetThreadCpuTime() - cpu, std::memory_order_relaxed);
 
   std::lock_guard guard(Lock);
-  Stopped = true;
+  block->Failed = !ok;
+  block->Done = true;
+  CV.notify_all();
 }
 
-void CompressionManager::CompressFile(const std::string& file)
+bool CompressionManager::WaitBlock(const CompressionBlockPtr& block)
 {
-#ifndef USE_ZLIB
-  (void)file;
-#else
-  if (EndsWith(file, ".gz"))
+  std::unique_lock guard(Lock);
+
+  // The waiting thread compresses queued blocks itself, so a file never
+  // waits for a pool occupied by other files
+  while (!block->Done)
+  {
+    if (Blocks.empty())
+    {
+      CV.wait(guard);
+      continue;
+    }
+
+    CompressionBlockPtr next = std::move(Blocks.front());
+    Blocks.pop_front();
+
+    guard.unlock();
+    RunBlock(next);
+    guard.lock();
+  }
+
+  return !block->Failed;
+}
+
+bool CompressionManager::CompressBlocks(
+  std::istream& input
+  , std::ostream& output
+  , const Job& job
+)
+{
+  std::size_t window;
+
+  {
+    std::lock_guard guard(Lock);
+    window = std::max<std::size_t>(Threads * 2, 2);
+  }
+
+  std::deque<CompressionBlockPtr> pending;
+  std::uint64_t blocks = 0;
+  std::uint64_t inputBytes = 0;
+  std::uint64_t outputBytes = 0;
+  bool eof = false;
+
+  for (;;)
+  {
+    // Read ahead so that every thread of the pool has a block to compress
+    while (!eof && pending.size() < window)
+    {
+      auto block = std::make_shared<CompressionBlock>(job.Codec, job.Level);
+      block->Input.resize(BLOCK_SIZE);
+
+      input.read(&block->Input[0], BLOCK_SIZE);
+      std::streamsize read = input.gcount();
+
+      if (read < BLOCK_SIZE)
+        eof = true;
+
+      // An empty file still gets one block, which makes a valid empty archive
+      if (read <= 0 && blocks != 0)
+        break;
+
+      block->Input.resize(read > 0 ? static_cast<std::size_t>(read) : 0);
+      blocks++;
+
+      {
+        std::lock_guard guard(Lock);
+        Blocks.push_back(block);
+      }
+
+      CV.notify_one();
+      pending.push_back(std::move(block));
+    }
+
+    if (pending.empty())
+      break;
+
+    CompressionBlockPtr block = std::move(pending.front());
+    pending.pop_front();
+
+    if (!WaitBlock(block))
+      return false;
+
+    output.write(block->Output.data(), static_cast<std::streamsize>(block->Output.size()));
+    if (!output)
+      return false;
+
+    inputBytes += block->Input.size();
+    outputBytes += block->Output.size();
+  }
+
+  if (input.bad())
+    return false;
+
+  GlobalBlocks.fetch_add(blocks, std::memory_order_relaxed);
+  GlobalInputBytes.fetch_add(inputBytes, std::memory_order_relaxed);
+  GlobalOutputBytes.fetch_add(outputBytes, std::memory_order_relaxed);
+  return true;
+}
+
+void CompressionManager::SetFileActive(bool active)
+{
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard guard(Lock);
+
+  if (active)
+  {
+    if (ActiveFiles++ == 0)
+      ActiveSince = now;
+
+    return;
+  }
+
+  if (--ActiveFiles == 0)
+  {
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - ActiveSince);
+    GlobalActiveNanoseconds.fetch_add(elapsed.count(), std::memory_order_relaxed);
+  }
+}
+
+void CompressionManager::CompressFile(const Job& job)
+{
+  const std::string& file = job.File;
+
+  if (EndsWith(file, ".gz") || EndsWith(file, ".zst"))
     return;
 
   if (TestFileInUse && TestFileInUse(file))
@@ -249,7 +667,7 @@ void CompressionManager::CompressFile(const std::string& file)
   if (!std::filesystem::is_regular_file(file, ec) || ec)
     return;
 
-  std::string finalName = file + ".gz";
+  std::string finalName = file + GetExtension(job.Codec);
 
   if (std::filesystem::exists(finalName, ec) && !ec)
   {
@@ -257,7 +675,7 @@ void CompressionManager::CompressFile(const std::string& file)
     return;
   }
 
-  std::string tmpName = MakeTemporaryGzipName(finalName);
+  std::string tmpName = MakeTemporaryName(finalName);
 
   std::ifstream input(file, std::ios::binary);
   if (!input)
@@ -266,54 +684,26 @@ void CompressionManager::CompressFile(const std::string& file)
     return;
   }
 
-  gzFile output = gzopen(tmpName.c_str(), "wb");
-  if (output == nullptr)
+  std::ofstream output(tmpName, std::ios::binary | std::ios::trunc);
+  if (!output)
   {
     LogmeE(CHINT, "failed to open compression target: %s", tmpName.c_str());
     return;
   }
 
-  bool ok = true;
-  std::array<char, 64 * 1024> buffer;
-
-  while (input)
-  {
-    input.read(buffer.data(), buffer.size());
-    std::streamsize read = input.gcount();
-
-    if (read <= 0)
-      break;
-
-    if (read > static_cast<std::streamsize>(std::numeric_limits<unsigned int>::max()))
-    {
-      ok = false;
-      break;
-    }
-
-    int written = gzwrite(
-      output
-      , buffer.data()
-      , static_cast<unsigned int>(read)
-    );
-
-    if (written != read)
-    {
-      ok = false;
-      break;
-    }
-  }
-
-  if (input.bad())
-    ok = false;
+  SetFileActive(true);
+  bool ok = CompressBlocks(input, output, job);
+  SetFileActive(false);
 
   input.close();
+  output.close();
 
-  int closeResult = gzclose(output);
-  if (closeResult != Z_OK)
+  if (output.fail())
     ok = false;
 
   if (!ok)
   {
+    GlobalFailedFiles.fetch_add(1, std::memory_order_relaxed);
     std::filesystem::remove(tmpName, ec);
     LogmeE(CHINT, "failed to compress file: %s", file.c_str());
     return;
@@ -327,23 +717,37 @@ void CompressionManager::CompressFile(const std::string& file)
     return;
   }
 
+  if (job.Codec == CompressionCodec::ZSTD)
+    GlobalZstdFiles.fetch_add(1, std::memory_order_relaxed);
+  else
+    GlobalGzipFiles.fetch_add(1, std::memory_order_relaxed);
+
   std::filesystem::remove(file, ec);
   if (ec)
   {
     LogmeE(CHINT, "failed to delete compressed source: %s", file.c_str());
+    return;
   }
-#endif
+
+  if (FileReplaced)
+    FileReplaced(file, finalName);
 }
 
 CompressionManagerFactory::CompressionManagerFactory()
   : UserCount(0)
+  , Threads(0)
   , Stopping(false)
 {
 }
 
-CompressionManagerFactory::CompressionManagerFactory(TFileInUseCallback testFileInUse)
+CompressionManagerFactory::CompressionManagerFactory(
+  TFileInUseCallback testFileInUse
+  , TFileReplacedCallback fileReplaced
+)
   : TestFileInUse(std::move(testFileInUse))
+  , FileReplaced(std::move(fileReplaced))
   , UserCount(0)
+  , Threads(0)
   , Stopping(false)
 {
 }
@@ -353,7 +757,10 @@ CompressionManagerFactory::~CompressionManagerFactory()
   SetStopping();
 }
 
-CompressionRegistrationPtr CompressionManagerFactory::RegisterUser()
+CompressionRegistrationPtr CompressionManagerFactory::RegisterUser(
+  CompressionCodec codec
+  , int level
+)
 {
   std::lock_guard guard(Lock);
 
@@ -364,7 +771,7 @@ CompressionRegistrationPtr CompressionManagerFactory::RegisterUser()
   if (Instance)
     Instance->SetUserCount(UserCount);
 
-  return CompressionRegistrationPtr(new CompressionRegistration(this));
+  return CompressionRegistrationPtr(new CompressionRegistration(this, codec, level));
 }
 
 void CompressionManagerFactory::ReleaseUser()
@@ -392,11 +799,15 @@ void CompressionManagerFactory::ReleaseUser()
     instance->StopWhenQueueEmpty();
 }
 
-void CompressionManagerFactory::Submit(const std::string& file)
+void CompressionManagerFactory::Submit(
+  const std::string& file
+  , CompressionCodec codec
+  , int level
+)
 {
-#ifndef USE_ZLIB
-  (void)file;
-#else
+  if (!CompressionManager::IsCodecSupported(codec))
+    return;
+
   std::shared_ptr<CompressionManager> instance;
 
   {
@@ -409,14 +820,23 @@ void CompressionManagerFactory::Submit(const std::string& file)
       Instance->Join();
 
     if (Instance == nullptr)
-      Instance = std::make_shared<CompressionManager>(TestFileInUse);
+      Instance = std::make_shared<CompressionManager>(TestFileInUse, FileReplaced);
 
     Instance->SetUserCount(UserCount);
+    Instance->SetThreads(Threads);
     instance = Instance;
   }
 
-  instance->Submit(file);
-#endif
+  instance->Submit(file, codec, level);
+}
+
+void CompressionManagerFactory::SetThreads(std::size_t threads)
+{
+  std::lock_guard guard(Lock);
+  Threads = threads;
+
+  if (Instance)
+    Instance->SetThreads(Threads);
 }
 
 void CompressionManagerFactory::SetStopping()
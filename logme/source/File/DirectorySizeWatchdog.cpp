@@ -12,9 +12,11 @@ namespace fs = std::filesystem;
 DirectorySizeWatchdog::DirectorySizeWatchdog(
   const std::string& target
   , TTestFileInUse testInUse
+  , LogFileIndexPtr index
 )
   : TargetDirectory(target)
   , TestInUse(testInUse)
+  , Index(index)
   , MaximalSize(uint64_t(-1))
   , CheckPeriodicity(0)
   , StopFlag(false)
@@ -110,35 +112,28 @@ void DirectorySizeWatchdog::WorkerProc()
   }
 }
 
-bool DirectorySizeWatchdog::LimitExeeded(uintmax_t& total_size)
+bool DirectorySizeWatchdog::LimitExeeded(
+  std::vector<LogFileRecord>& files
+  , uintmax_t& total_size
+)
 {
   if (Extensions.empty() || MaximalSize == 0 || MaximalSize == uint64_t(-1))
     return false;
 
   std::unordered_set<std::string> ext_set(Extensions.begin(), Extensions.end());
 
-  auto rdi = fs::recursive_directory_iterator(
-    TargetDirectory
-    , fs::directory_options::skip_permission_denied
-  );
+  std::vector<LogFileRecord> all;
+  Index->ListRecursive(TargetDirectory, all);
 
   total_size = 0;
 
-  for (const auto& e : rdi)
+  for (auto& e : all)
   {
-    if (StopFlag.load()) 
-      break;
-
-    if (!fs::is_regular_file(e.status())) 
-      continue;
-
-    auto ext = e.path().extension().string();
+    auto ext = fs::path(e.PathName).extension().string();
     if (ext_set.find(ext) == ext_set.end()) continue;
 
-    std::error_code ec;
-    uintmax_t fsize = fs::file_size(e, ec);
-    if (!ec)
-      total_size += fsize;
+    total_size += e.Size;
+    files.push_back(std::move(e));
   }
 
   if (total_size > MaximalSize)
@@ -197,6 +192,9 @@ void DirectorySizeWatchdog::DeleteFiles(
     std::error_code ec;
     fs::remove(file.Path, ec);
 
+    if (!ec)
+      Index->Remove(file.Path.string());
+
     if (ec)
     {
       std::string path = file.Path.string();
@@ -213,7 +211,8 @@ void DirectorySizeWatchdog::DeleteFiles(
 }
 
 std::deque<DirectorySizeWatchdog::FileInfo> DirectorySizeWatchdog::Collect(
-  uintmax_t total_size
+  const std::vector<LogFileRecord>& files
+  , uintmax_t total_size
 )
 {
   const size_t maxBatch = 32ULL * 1024 * 1024;
@@ -225,43 +224,26 @@ std::deque<DirectorySizeWatchdog::FileInfo> DirectorySizeWatchdog::Collect(
   if (total_size > MaximalSize)
     max_batch_size += total_size - MaximalSize;
 
-  std::unordered_set<std::string> ext_set(Extensions.begin(), Extensions.end());
-
   std::deque<FileInfo> candidate_files;
 
-  auto rdi = fs::recursive_directory_iterator(
-    TargetDirectory
-    , fs::directory_options::skip_permission_denied
-  );
-
-  for (const auto& entry : rdi) 
+  for (const auto& entry : files) 
   {
     if (StopFlag.load()) 
       break;
 
-    if (!fs::is_regular_file(entry.status())) 
+    if (entry.Owner != nullptr)
       continue;
 
-    auto ext = entry.path().extension().string();
-    if (ext_set.find(ext) == ext_set.end()) continue;
-
-    if (TestInUse && TestInUse(entry.path().string()))
+    if (TestInUse && TestInUse(entry.PathName))
       continue;
 
-    std::error_code ec;
-    uintmax_t fsize = fs::file_size(entry, ec);
-    if (ec)
-      continue;
-
-    auto ftime = fs::last_write_time(entry, ec);
-    if (ec)
-      continue;
+    auto ftime = entry.LastWrite;
     auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
       ftime - decltype(ftime)::clock::now() + std::chrono::system_clock::now()
     );
     InsertSorted(
       candidate_files
-      , { fsize, entry.path(), sctp }
+      , { entry.Size, fs::path(entry.PathName), sctp }
       , max_batch_size
     );
   }
@@ -271,10 +253,11 @@ std::deque<DirectorySizeWatchdog::FileInfo> DirectorySizeWatchdog::Collect(
 
 void DirectorySizeWatchdog::Monitor()
 {
+  std::vector<LogFileRecord> files;
   uintmax_t total_size = 0;
-  if (!LimitExeeded(total_size))
+  if (!LimitExeeded(files, total_size))
     return;
 
-  auto candidate = Collect(total_size);
+  auto candidate = Collect(files, total_size);
   DeleteFiles(candidate);
 }
@@ -3,6 +3,7 @@
 #include <charconv>
 #include <filesystem>
 #include <system_error>
+#include <vector>
 
 #include <Logme/File/exe_path.h>
 #include <Logme/Template.h>
@@ -95,11 +96,13 @@ namespace Logme
     const std::string& archiveTemplate
     , const std::string& homeDirectory
     , bool gzipCompression
+    , LogFileIndexPtr index
   )
   {
     ArchiveTemplate = archiveTemplate;
     HomeDirectory = homeDirectory;
     GzipCompression = gzipCompression;
+    Index = index;
     ArchiveIndex = 0;
     ArchiveTime = 0;
   }
@@ -228,13 +231,23 @@ namespace Logme
 
     re = ReplaceDatetimePlaceholders(re, ".+");
     re = ReplaceAll(re, indexMarker, "([0-9]+)");
-    re += "(\\.gz)?";
+    re += "(\\.gz|\\.zst)?";
 
     return std::regex(re);
   }
 
   bool FileArchivePolicy::NameExists(const std::string& archive) const
   {
+    if (Index
+      && (Index->Exists(archive)
+        || Index->Exists(archive + ".gz")
+        || Index->Exists(archive + ".zst")))
+    {
+      return true;
+    }
+
+    // The index does not see files of other processes until the next
+    // rescan, so a free name is confirmed on disk
     std::error_code ec;
     if (std::filesystem::exists(archive, ec))
     {
@@ -246,13 +259,21 @@ namespace Logme
       return true;
     }
 
-    ec.clear();
-    if (std::filesystem::exists(archive + ".gz", ec))
+    for (const char* extension : {".gz", ".zst"})
     {
-      return true;
+      ec.clear();
+      if (std::filesystem::exists(archive + extension, ec))
+      {
+        return true;
+      }
+
+      if (ec)
+      {
+        return true;
+      }
     }
 
-    return static_cast<bool>(ec);
+    return false;
   }
 
   uint64_t FileArchivePolicy::FindLastIndex(std::time_t archiveTime) const
@@ -269,31 +290,49 @@ namespace Logme
       return 0;
     }
 
-    std::error_code ec;
-    if (!std::filesystem::exists(dir, ec) || ec)
+    std::vector<std::string> names;
+    if (Index)
     {
-      return 0;
-    }
+      std::vector<LogFileRecord> files;
+      Index->List(dir.string(), files);
 
-    std::filesystem::directory_iterator it(dir, ec);
-    if (ec)
+      for (auto& file : files)
+      {
+        names.push_back(std::move(file.PathName));
+      }
+    }
+    else
     {
-      return 0;
+      std::error_code ec;
+      if (!std::filesystem::exists(dir, ec) || ec)
+      {
+        return 0;
+      }
+
+      std::filesystem::directory_iterator it(dir, ec);
+      if (ec)
+      {
+        return 0;
+      }
+
+      for (const auto& entry : it)
+      {
+        if (!entry.is_regular_file(ec) || ec)
+        {
+          ec.clear();
+          continue;
+        }
+
+        names.push_back(entry.path().string());
+      }
     }
 
     std::regex pattern = BuildIndexPattern(archiveTime);
     uint64_t maxIndex = 0;
 
-    for (const auto& entry : it)
+    for (const auto& pathName : names)
     {
-      if (!entry.is_regular_file(ec) || ec)
-      {
-        ec.clear();
-        continue;
-      }
-
       std::smatch match;
-      std::string pathName = entry.path().string();
       if (!std::regex_match(pathName, match, pattern) || match.size() < 2)
       {
         continue;
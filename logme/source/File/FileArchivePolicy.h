@@ -5,6 +5,8 @@
 #include <stdint.h>
 #include <string>
 
+#include <Logme/File/LogFileIndex.h>
+
 namespace Logme
 {
   class FileArchivePolicy
@@ -16,6 +18,7 @@ namespace Logme
       const std::string& archiveTemplate
       , const std::string& homeDirectory
       , bool gzipCompression
+      , LogFileIndexPtr index = nullptr
     );
 
     bool IsEnabled() const;
@@ -41,6 +44,7 @@ namespace Logme
     std::string ArchiveTemplate;
     std::string HomeDirectory;
     bool GzipCompression;
+    LogFileIndexPtr Index;
     uint64_t ArchiveIndex;
     std::time_t ArchiveTime;
   };
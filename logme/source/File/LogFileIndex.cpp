@@ -0,0 +1,617 @@
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <Logme/File/LogFileIndex.h>
+#include <Logme/Logme.h>
+#include <Logme/Time/datetime.h>
+#include <Logme/Utils.h>
+
+using namespace Logme;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+  bool IsSeparator(char c)
+  {
+    return c == '/' || c == '\\';
+  }
+
+  bool IsUnder(const std::string& key, const std::string& root)
+  {
+    if (key.size() < root.size() || key.compare(0, root.size(), root) != 0)
+      return false;
+
+    if (key.size() == root.size())
+      return true;
+
+    return IsSeparator(root.back()) || IsSeparator(key[root.size()]);
+  }
+
+  bool ReadFileEntry(
+    const fs::path& path
+    , std::uint64_t& size
+    , fs::file_time_type& lastWrite
+  )
+  {
+    std::error_code ec;
+    if (!fs::is_regular_file(path, ec) || ec)
+      return false;
+
+    lastWrite = fs::last_write_time(path, ec);
+    if (ec)
+      return false;
+
+    size = static_cast<std::uint64_t>(fs::file_size(path, ec));
+    if (ec)
+      size = 0;
+
+    return true;
+  }
+
+  void RefreshActive(std::vector<LogFileRecord>& files, size_t first)
+  {
+    // Active files grow all the time, so they are read at query time
+    for (size_t i = first; i < files.size(); ++i)
+    {
+      LogFileRecord& file = files[i];
+      if (file.Owner == nullptr)
+        continue;
+
+      std::uint64_t size = 0;
+      fs::file_time_type lastWrite;
+      if (ReadFileEntry(file.PathName, size, lastWrite))
+      {
+        file.Size = size;
+        file.LastWrite = lastWrite;
+      }
+    }
+  }
+}
+
+LogFileIndex::LogFileIndex()
+  : RescanInterval(RESCAN_INTERVAL_DEFAULT)
+  , Scans(0)
+  , WatchFd(-1)
+  , WatchStop(false)
+{
+}
+
+LogFileIndex::~LogFileIndex()
+{
+  EnableWatch(false);
+}
+
+std::string LogFileIndex::DirectoryKey(const fs::path& dir)
+{
+  std::string key = dir.lexically_normal().string();
+
+  while (key.size() > 1 && IsSeparator(key.back()))
+    key.pop_back();
+
+  if (key.empty())
+    key = ".";
+
+  return key;
+}
+
+bool LogFileIndex::IsFreshLocked(const Directory& d, std::uint64_t now) const
+{
+  if (!d.Loaded)
+    return false;
+
+  return d.Watch >= 0 || RescanInterval == 0 || now - d.LoadTime < RescanInterval;
+}
+
+void LogFileIndex::MergeLocked(
+  const std::string& key
+  , std::map<std::string, FileEntry>& files
+  , std::uint64_t now
+)
+{
+  Directory& d = Directories[key];
+
+  for (auto& file : files)
+  {
+    auto it = d.Files.find(file.first);
+    if (it != d.Files.end())
+      file.second.Owner = it->second.Owner;
+  }
+
+  d.Files.swap(files);
+  d.Loaded = true;
+  d.LoadTime = now;
+
+  AddWatchLocked(key, d);
+}
+
+void LogFileIndex::LoadDirectory(const std::string& key)
+{
+  std::map<std::string, FileEntry> files;
+
+  std::error_code ec;
+  fs::directory_iterator it(key, ec);
+  if (!ec)
+  {
+    for (const auto& entry : it)
+    {
+      if (!entry.is_regular_file(ec) || ec)
+      {
+        ec.clear();
+        continue;
+      }
+
+      FileEntry file;
+      file.LastWrite = entry.last_write_time(ec);
+      if (ec)
+      {
+        ec.clear();
+        continue;
+      }
+
+      file.Size = static_cast<std::uint64_t>(entry.file_size(ec));
+      if (ec)
+      {
+        ec.clear();
+        file.Size = 0;
+      }
+
+      files[entry.path().filename().string()] = file;
+    }
+  }
+
+  Scans.fetch_add(1, std::memory_order_relaxed);
+
+  std::lock_guard guard(Lock);
+  MergeLocked(key, files, GetTimeInMillisec64());
+}
+
+void LogFileIndex::LoadTree(const std::string& key)
+{
+  std::map<std::string, std::map<std::string, FileEntry>> tree;
+  tree[key];
+
+  std::error_code ec;
+  fs::recursive_directory_iterator it(key, fs::directory_options::skip_permission_denied, ec);
+  if (!ec)
+  {
+    for (const auto& entry : it)
+    {
+      if (entry.is_directory(ec) && !ec)
+      {
+        tree[DirectoryKey(entry.path())];
+        continue;
+      }
+
+      if (!entry.is_regular_file(ec) || ec)
+      {
+        ec.clear();
+        continue;
+      }
+
+      FileEntry file;
+      file.LastWrite = entry.last_write_time(ec);
+      if (ec)
+      {
+        ec.clear();
+        continue;
+      }
+
+      file.Size = static_cast<std::uint64_t>(entry.file_size(ec));
+      if (ec)
+      {
+        ec.clear();
+        file.Size = 0;
+      }
+
+      tree[DirectoryKey(entry.path().parent_path())][entry.path().filename().string()] = file;
+    }
+  }
+
+  Scans.fetch_add(1, std::memory_order_relaxed);
+
+  std::uint64_t now = GetTimeInMillisec64();
+  std::lock_guard guard(Lock);
+
+  // Directories removed since the last scan
+  for (auto it = Directories.lower_bound(key); it != Directories.end();)
+  {
+    if (it->first.compare(0, key.size(), key) != 0)
+      break;
+
+    if (IsUnder(it->first, key) && tree.find(it->first) == tree.end())
+    {
+      if (it->second.Watch >= 0)
+        WatchDirs.erase(it->second.Watch);
+
+      it = Directories.erase(it);
+      continue;
+    }
+
+    ++it;
+  }
+
+  for (auto& d : tree)
+    MergeLocked(d.first, d.second, now);
+
+  RecursiveRoots[key] = now;
+}
+
+void LogFileIndex::UpdateFile(
+  const std::string& pathName
+  , const void* owner
+  , bool keepOwner
+)
+{
+  fs::path path(pathName);
+
+  FileEntry file;
+  if (!ReadFileEntry(path, file.Size, file.LastWrite))
+  {
+    Remove(pathName);
+    return;
+  }
+
+  std::string key = DirectoryKey(path.parent_path());
+  std::string name = path.filename().string();
+
+  std::lock_guard guard(Lock);
+
+  FileEntry& e = Directories[key].Files[name];
+  if (keepOwner)
+    file.Owner = e.Owner;
+  else
+    file.Owner = owner;
+
+  e = file;
+}
+
+void LogFileIndex::Update(const std::string& pathName, const void* owner)
+{
+  UpdateFile(pathName, owner, false);
+}
+
+void LogFileIndex::Remove(const std::string& pathName)
+{
+  fs::path path(pathName);
+  std::string key = DirectoryKey(path.parent_path());
+
+  std::lock_guard guard(Lock);
+
+  auto it = Directories.find(key);
+  if (it != Directories.end())
+    it->second.Files.erase(path.filename().string());
+}
+
+void LogFileIndex::Rename(const std::string& from, const std::string& to)
+{
+  Remove(from);
+  UpdateFile(to, nullptr, false);
+}
+
+void LogFileIndex::List(const std::string& dir, std::vector<LogFileRecord>& files)
+{
+  std::string key = DirectoryKey(dir);
+
+  bool fresh;
+  {
+    std::lock_guard guard(Lock);
+    auto it = Directories.find(key);
+    fresh = it != Directories.end() && IsFreshLocked(it->second, GetTimeInMillisec64());
+  }
+
+  if (!fresh)
+    LoadDirectory(key);
+
+  size_t first = files.size();
+  {
+    std::lock_guard guard(Lock);
+
+    auto it = Directories.find(key);
+    if (it == Directories.end())
+      return;
+
+    fs::path base(dir);
+    for (const auto& file : it->second.Files)
+    {
+      LogFileRecord record;
+      record.PathName = (base / file.first).string();
+      record.Size = file.second.Size;
+      record.LastWrite = file.second.LastWrite;
+      record.Owner = file.second.Owner;
+
+      files.push_back(std::move(record));
+    }
+  }
+
+  RefreshActive(files, first);
+}
+
+void LogFileIndex::ListRecursive(const std::string& root, std::vector<LogFileRecord>& files)
+{
+  std::string key = DirectoryKey(root);
+
+  bool fresh;
+  {
+    std::lock_guard guard(Lock);
+    auto it = RecursiveRoots.find(key);
+    fresh = it != RecursiveRoots.end()
+      && (WatchFd >= 0 || RescanInterval == 0 || GetTimeInMillisec64() - it->second < RescanInterval);
+  }
+
+  if (!fresh)
+    LoadTree(key);
+
+  size_t first = files.size();
+  {
+    std::lock_guard guard(Lock);
+
+    for (auto it = Directories.lower_bound(key); it != Directories.end(); ++it)
+    {
+      if (it->first.compare(0, key.size(), key) != 0)
+        break;
+
+      if (!IsUnder(it->first, key))
+        continue;
+
+      size_t pos = key.size();
+      while (pos < it->first.size() && IsSeparator(it->first[pos]))
+        ++pos;
+
+      fs::path base(root);
+      if (pos < it->first.size())
+        base /= it->first.substr(pos);
+
+      for (const auto& file : it->second.Files)
+      {
+        LogFileRecord record;
+        record.PathName = (base / file.first).string();
+        record.Size = file.second.Size;
+        record.LastWrite = file.second.LastWrite;
+        record.Owner = file.second.Owner;
+
+        files.push_back(std::move(record));
+      }
+    }
+  }
+
+  RefreshActive(files, first);
+}
+
+bool LogFileIndex::Exists(const std::string& pathName)
+{
+  fs::path path(pathName);
+  std::string key = DirectoryKey(path.parent_path());
+  std::string name = path.filename().string();
+
+  bool fresh;
+  {
+    std::lock_guard guard(Lock);
+    auto it = Directories.find(key);
+    fresh = it != Directories.end() && IsFreshLocked(it->second, GetTimeInMillisec64());
+  }
+
+  if (!fresh)
+    LoadDirectory(key);
+
+  std::lock_guard guard(Lock);
+
+  auto it = Directories.find(key);
+  if (it == Directories.end())
+    return false;
+
+  return it->second.Files.find(name) != it->second.Files.end();
+}
+
+void LogFileIndex::Invalidate()
+{
+  std::lock_guard guard(Lock);
+
+  for (auto& d : Directories)
+    d.second.Loaded = false;
+
+  RecursiveRoots.clear();
+}
+
+void LogFileIndex::SetRescanInterval(std::uint64_t ms)
+{
+  std::lock_guard guard(Lock);
+  RescanInterval = ms;
+}
+
+std::uint64_t LogFileIndex::GetRescanInterval() const
+{
+  std::lock_guard guard(Lock);
+  return RescanInterval;
+}
+
+std::uint64_t LogFileIndex::GetScanCount() const
+{
+  return Scans.load(std::memory_order_relaxed);
+}
+
+bool LogFileIndex::IsWatchEnabled() const
+{
+  std::lock_guard guard(Lock);
+  return WatchFd >= 0;
+}
+
+#ifdef __linux__
+
+namespace
+{
+  const uint32_t WATCH_MASK = IN_CREATE
+    | IN_DELETE
+    | IN_MOVED_FROM
+    | IN_MOVED_TO
+    | IN_CLOSE_WRITE
+    | IN_DELETE_SELF;
+}
+
+void LogFileIndex::AddWatchLocked(const std::string& key, Directory& d)
+{
+  if (WatchFd < 0 || d.Watch >= 0)
+    return;
+
+  int wd = inotify_add_watch(WatchFd, key.c_str(), WATCH_MASK);
+  if (wd < 0)
+    return;
+
+  d.Watch = wd;
+  WatchDirs[wd] = key;
+}
+
+bool LogFileIndex::EnableWatch(bool enable)
+{
+  if (enable)
+  {
+    std::lock_guard guard(Lock);
+    if (WatchFd >= 0)
+      return true;
+
+    WatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (WatchFd < 0)
+    {
+      LogmeE(CHINT, "inotify_init1() failed: %s", ERRNO_STR(errno));
+      return false;
+    }
+
+    for (auto& d : Directories)
+    {
+      if (d.second.Loaded)
+        AddWatchLocked(d.first, d.second);
+    }
+
+    WatchStop.store(false);
+    Watcher = std::thread(&LogFileIndex::WatchProc, this);
+    return true;
+  }
+
+  if (Watcher.joinable())
+  {
+    WatchStop.store(true);
+    Watcher.join();
+  }
+
+  std::lock_guard guard(Lock);
+  if (WatchFd >= 0)
+  {
+    close(WatchFd);
+    WatchFd = -1;
+  }
+
+  for (auto& d : Directories)
+    d.second.Watch = -1;
+
+  WatchDirs.clear();
+  return true;
+}
+
+void LogFileIndex::WatchProc()
+{
+  RenameThread(uint64_t(-1), "LogFileIndex");
+
+  alignas(struct inotify_event) char buffer[4096];
+
+  while (!WatchStop.load())
+  {
+    struct pollfd pfd = {WatchFd, POLLIN, 0};
+    if (poll(&pfd, 1, 200) <= 0)
+      continue;
+
+    for (;;)
+    {
+      ssize_t n = read(WatchFd, buffer, sizeof(buffer));
+      if (n <= 0)
+        break;
+
+      for (char* p = buffer; p < buffer + n;)
+      {
+        const struct inotify_event* e = (const struct inotify_event*)p;
+        p += sizeof(struct inotify_event) + e->len;
+
+        if (e->mask & IN_Q_OVERFLOW)
+        {
+          Invalidate();
+          continue;
+        }
+
+        std::string key;
+        {
+          std::lock_guard guard(Lock);
+          auto it = WatchDirs.find(e->wd);
+          if (it == WatchDirs.end())
+            continue;
+
+          key = it->second;
+
+          if (e->mask & (IN_IGNORED | IN_DELETE_SELF))
+          {
+            WatchDirs.erase(it);
+
+            auto d = Directories.find(key);
+            if (d != Directories.end())
+              Directories.erase(d);
+
+            continue;
+          }
+        }
+
+        if (e->len == 0)
+          continue;
+
+        std::string pathName = (fs::path(key) / e->name).string();
+
+        if (e->mask & IN_ISDIR)
+        {
+          // New subdirectory of a tree that is indexed recursively
+          if (e->mask & (IN_CREATE | IN_MOVED_TO))
+          {
+            bool tracked = false;
+            {
+              std::lock_guard guard(Lock);
+              for (auto& root : RecursiveRoots)
+                tracked |= IsUnder(key, root.first);
+            }
+
+            if (tracked)
+              LoadDirectory(DirectoryKey(pathName));
+          }
+
+          continue;
+        }
+
+        if (e->mask & (IN_DELETE | IN_MOVED_FROM))
+          Remove(pathName);
+        else
+          UpdateFile(pathName, nullptr, true);
+      }
+    }
+  }
+}
+
+#else
+
+void LogFileIndex::AddWatchLocked(const std::string& key, Directory& d)
+{
+  (void)key;
+  (void)d;
+}
+
+bool LogFileIndex::EnableWatch(bool enable)
+{
+  return !enable;
+}
+
+void LogFileIndex::WatchProc()
+{
+}
+
+#endif
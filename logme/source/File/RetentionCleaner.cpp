@@ -29,6 +29,37 @@ namespace
     return left == right;
   }
 
+  std::vector<FileInfo> FindIndexedFiles(
+    const std::regex& pattern
+    , const fs::path& dir
+    , Logme::LogFileIndex& index
+  )
+  {
+    std::vector<FileInfo> matchedFiles;
+
+    if (dir.empty())
+      return matchedFiles;
+
+    std::vector<Logme::LogFileRecord> files;
+    index.List(dir.string(), files);
+
+    for (auto& file : files)
+    {
+      if (!std::regex_match(file.PathName, pattern))
+        continue;
+
+      FileInfo info;
+      info.Path = file.PathName;
+      info.PathName = std::move(file.PathName);
+      info.LastWrite = file.LastWrite;
+      info.Size = file.Size;
+
+      matchedFiles.push_back(std::move(info));
+    }
+
+    return matchedFiles;
+  }
+
   std::vector<FileInfo> FindMatchingFiles(
     const std::regex& pattern
     , const fs::path& dir
@@ -268,16 +299,16 @@ void Logme::CleanFiles(
   const std::regex& pattern
   , const std::string& keep
   , const RetentionOptions& options
+  , LogFileIndex* index
 )
 {
   if (keep.empty() || options.IsEmpty())
     return;
 
   fs::path file(keep);
-  std::vector<FileInfo> matchedFiles = FindMatchingFiles(
-    pattern
-    , file.parent_path()
-  );
+  std::vector<FileInfo> matchedFiles = index
+    ? FindIndexedFiles(pattern, file.parent_path(), *index)
+    : FindMatchingFiles(pattern, file.parent_path());
 
   if (matchedFiles.empty())
     return;
@@ -287,5 +318,14 @@ void Logme::CleanFiles(
   ApplyMaxFiles(matchedFiles, keep, options.MaxFiles);
   ApplyMaxAge(matchedFiles, keep, options.MaxAgeMs);
   ApplyMaxTotalSize(matchedFiles, keep, options.MaxTotalSize);
+
+  if (index == nullptr)
+    return;
+
+  for (const auto& f : matchedFiles)
+  {
+    if (f.Deleted)
+      index->Remove(f.PathName);
+  }
 }
 
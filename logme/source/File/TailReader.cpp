@@ -0,0 +1,361 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <vector>
+
+#include <Logme/File/TailReader.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#include <share.h>
+#endif
+
+using namespace Logme;
+
+namespace
+{
+  struct FileInfo
+  {
+    std::uint64_t Id;
+    std::uint64_t Size;
+  };
+
+  class ReadOnlyFile
+  {
+  public:
+    explicit ReadOnlyFile(const std::string& pathName)
+    {
+#ifdef _WIN32
+      if (_sopen_s(&Fd, pathName.c_str(), _O_RDONLY | _O_BINARY, _SH_DENYNO, 0) != 0)
+        Fd = -1;
+#else
+      Fd = open(pathName.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+      Error = Fd < 0 ? errno : 0;
+    }
+
+    ~ReadOnlyFile()
+    {
+      if (Fd >= 0)
+      {
+#ifdef _WIN32
+        _close(Fd);
+#else
+        close(Fd);
+#endif
+      }
+    }
+
+    int Fd;
+    int Error;
+  };
+
+  int GetFileInfo(int fd, FileInfo& info)
+  {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_fstat64(fd, &st) != 0)
+      return errno;
+
+    // NTFS does not report inode numbers through _fstat64
+    info.Id = (std::uint64_t)st.st_ctime;
+#else
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+      return errno;
+
+    info.Id = ((std::uint64_t)st.st_dev << 32) ^ (std::uint64_t)st.st_ino;
+#endif
+
+    info.Size = (std::uint64_t)st.st_size;
+    return 0;
+  }
+
+  bool ReadAt(int fd, char* p, size_t size, std::uint64_t offset)
+  {
+    while (size)
+    {
+#ifdef _WIN32
+      if (_lseeki64(fd, (__int64)offset, SEEK_SET) < 0)
+        return false;
+
+      int rc = _read(fd, p, (unsigned)size);
+#else
+      ssize_t rc = pread(fd, p, size, (off_t)offset);
+#endif
+      if (rc < 0 && errno == EINTR)
+        continue;
+
+      // The file was truncated while it was read
+      if (rc == 0)
+        errno = EIO;
+
+      if (rc <= 0)
+        return false;
+
+      p += rc;
+      size -= (size_t)rc;
+      offset += (std::uint64_t)rc;
+    }
+
+    return true;
+  }
+
+  int ReadRange(int fd, std::uint64_t start, std::uint64_t end, std::string& content)
+  {
+    content.resize((size_t)(end - start));
+    if (content.empty())
+      return 0;
+
+    if (!ReadAt(fd, &content[0], content.size(), start))
+    {
+      int error = errno ? errno : EIO;
+      content.clear();
+      return error;
+    }
+
+    return 0;
+  }
+}
+
+TailReader::TailReader()
+  : UseCounter(0)
+{
+}
+
+const char* TailReader::FindLast(const char* p, size_t size, char c)
+{
+#if defined(__GLIBC__)
+  return (const char*)memrchr(p, c, size);
+#else
+  // Eight bytes per step: a zero byte in v ^ pattern marks a match
+  const std::uint64_t ONES = 0x0101010101010101ULL;
+  const std::uint64_t HIGHS = 0x8080808080808080ULL;
+  const std::uint64_t pattern = ONES * (unsigned char)c;
+
+  while (size >= sizeof(std::uint64_t))
+  {
+    std::uint64_t v;
+    memcpy(&v, p + size - sizeof(v), sizeof(v));
+
+    v ^= pattern;
+    if ((v - ONES) & ~v & HIGHS)
+      break;
+
+    size -= sizeof(v);
+  }
+
+  while (size)
+  {
+    if (p[--size] == c)
+      return p + size;
+  }
+
+  return nullptr;
+#endif
+}
+
+bool TailReader::ScanBackward(int fd, Entry& entry)
+{
+  entry.Newlines.clear();
+  entry.Complete = false;
+
+  std::vector<char> block(BLOCK_SIZE);
+  std::uint64_t end = entry.Size;
+
+  while (end)
+  {
+    size_t size = end < BLOCK_SIZE ? (size_t)end : (size_t)BLOCK_SIZE;
+    std::uint64_t start = end - size;
+
+    if (!ReadAt(fd, &block[0], size, start))
+      return false;
+
+    for (const char* p = FindLast(&block[0], size, '\n'); p; )
+    {
+      size_t pos = size_t(p - &block[0]);
+      entry.Newlines.push_front(start + pos);
+
+      if (entry.Newlines.size() > entry.MaxLines)
+        return true;
+
+      p = pos ? FindLast(&block[0], pos, '\n') : nullptr;
+    }
+
+    end = start;
+  }
+
+  entry.Complete = true;
+  return true;
+}
+
+bool TailReader::ScanAppended(int fd, Entry& entry, std::uint64_t size)
+{
+  std::vector<char> block(BLOCK_SIZE);
+  std::uint64_t offset = entry.Size;
+
+  while (offset < size)
+  {
+    size_t n = size - offset < BLOCK_SIZE ? (size_t)(size - offset) : (size_t)BLOCK_SIZE;
+    if (!ReadAt(fd, &block[0], n, offset))
+      return false;
+
+    const char* p = &block[0];
+    const char* end = p + n;
+    while ((p = (const char*)memchr(p, '\n', size_t(end - p))) != nullptr)
+    {
+      entry.Newlines.push_back(offset + std::uint64_t(p - &block[0]));
+      if (entry.Newlines.size() > entry.MaxLines + 1)
+      {
+        entry.Newlines.pop_front();
+        entry.Complete = false;
+      }
+
+      p++;
+    }
+
+    offset += n;
+  }
+
+  entry.Size = size;
+  return true;
+}
+
+int TailReader::ReadLines(
+  const std::string& pathName
+  , size_t maxLines
+  , std::string& content
+)
+{
+  content.clear();
+
+  ReadOnlyFile file(pathName);
+  if (file.Fd < 0)
+    return file.Error;
+
+  FileInfo info;
+  int rc = GetFileInfo(file.Fd, info);
+  if (rc)
+    return rc;
+
+  if (maxLines == 0)
+    return ReadRange(file.Fd, 0, info.Size, content);
+
+  std::lock_guard guard(Lock);
+
+  auto it = Entries.find(pathName);
+  if (it == Entries.end())
+  {
+    if (Entries.size() >= MAX_ENTRIES)
+    {
+      auto oldest = Entries.begin();
+      for (auto i = Entries.begin(); i != Entries.end(); ++i)
+      {
+        if (i->second.LastUse < oldest->second.LastUse)
+          oldest = i;
+      }
+
+      Entries.erase(oldest);
+    }
+
+    it = Entries.emplace(pathName, Entry()).first;
+  }
+
+  Entry& entry = it->second;
+  entry.LastUse = ++UseCounter;
+
+  // Only appended data is scanned when the file is the same and grew. The
+  // last known newline is checked to catch files rewritten in place.
+  bool appended = entry.FileId == info.Id
+    && entry.MaxLines == maxLines
+    && entry.Size != 0
+    && info.Size >= entry.Size;
+
+  if (appended && !entry.Newlines.empty())
+  {
+    char c = 0;
+    appended = ReadAt(file.Fd, &c, 1, entry.Newlines.back()) && c == '\n';
+  }
+
+  bool scanned = appended
+    ? ScanAppended(file.Fd, entry, info.Size)
+    : false;
+
+  if (!scanned)
+  {
+    entry.FileId = info.Id;
+    entry.Size = info.Size;
+    entry.MaxLines = maxLines;
+
+    if (!ScanBackward(file.Fd, entry))
+    {
+      Entries.erase(it);
+      return errno ? errno : EIO;
+    }
+  }
+
+  // A newline that ends the file does not start another line
+  size_t count = entry.Newlines.size();
+  size_t lines = maxLines;
+  if (count && entry.Newlines.back() + 1 == info.Size)
+    lines++;
+
+  std::uint64_t start = 0;
+  if (count >= lines)
+    start = entry.Newlines[count - lines] + 1;
+  else if (!entry.Complete && count)
+    start = entry.Newlines.front() + 1;
+
+  return ReadRange(file.Fd, start, info.Size, content);
+}
+
+int TailReader::ReadBytes(
+  const std::string& pathName
+  , std::uint64_t maxBytes
+  , std::string& content
+)
+{
+  content.clear();
+
+  ReadOnlyFile file(pathName);
+  if (file.Fd < 0)
+    return file.Error;
+
+  FileInfo info;
+  int rc = GetFileInfo(file.Fd, info);
+  if (rc)
+    return rc;
+
+  std::uint64_t start = 0;
+  if (maxBytes && info.Size > maxBytes)
+  {
+    // Skip the partial line cut by the range, unless the range starts
+    // right after a newline
+    start = info.Size - maxBytes - 1;
+
+    std::vector<char> block(BLOCK_SIZE);
+    for (;;)
+    {
+      if (start >= info.Size)
+        break;
+
+      size_t n = info.Size - start < BLOCK_SIZE ? (size_t)(info.Size - start) : (size_t)BLOCK_SIZE;
+      if (!ReadAt(file.Fd, &block[0], n, start))
+        return errno ? errno : EIO;
+
+      const char* p = (const char*)memchr(&block[0], '\n', n);
+      if (p)
+      {
+        start += std::uint64_t(p - &block[0]) + 1;
+        break;
+      }
+
+      start += n;
+    }
+  }
+
+  return ReadRange(file.Fd, start, info.Size, content);
+}
@@ -213,5 +213,9 @@ int BufferedFileIo::Read(void* p, size_t size)
 
 unsigned BufferedFileIo::Read(int maxLines, std::string& content, int part)
 {
+  // Records buffered in the stream belong to the current file
+  if (part == 0)
+    Flush();
+
   return FileIo::Read(maxLines, content, part);
 }
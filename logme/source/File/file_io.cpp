@@ -482,40 +482,11 @@ int FileIo::Read(void* p, size_t size)
 
 unsigned FileIo::Read(int maxLines, std::string& content, int part)
 {
-  content.clear();
-
   std::string pathName = GetPathName(part);
 
-#ifdef _WIN32
-  FILE* fp = nullptr;
-  fopen_s(&fp, pathName.c_str(), "r");
-#else
-  FILE* fp = fopen(pathName.c_str(), "r");
-#endif
-
-  if (!fp)
+  int rc = Tail.ReadLines(pathName, maxLines > 0 ? (size_t)maxLines : 0, content);
+  if (rc != 0)
     return RC_NO_ACCESS;
 
-  std::string data;
-  std::vector<size_t> offset;
-
-  char buffer[4096];
-  while (fgets(buffer, sizeof(buffer), fp))
-  {
-    offset.push_back(data.size());
-    data += buffer;
-  }
-
-  if (!offset.empty())
-  {
-    size_t pos = 0;
-    size_t n = offset.size();
-    if (maxLines > 0 && (size_t)maxLines < n)
-      pos = offset[n - 1 - maxLines];
-
-    content = data.substr(pos);
-  }
-
-  fclose(fp);
   return RC_NOERROR;
 }
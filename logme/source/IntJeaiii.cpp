@@ -3,13 +3,9 @@
 
 #include <Logme/Utils.h>
 
-int Logme::PrintIntJeaiii(
-  char* buffer
-  , size_t size
-  , int value
-)
+namespace
 {
-  static const char DIGITS[201] =
+  const char DIGITS[201] =
     "00010203040506070809"
     "10111213141516171819"
     "20212223242526272829"
@@ -20,7 +16,14 @@ int Logme::PrintIntJeaiii(
     "70717273747576777879"
     "80818283848586878889"
     "90919293949596979899";
+}
 
+int Logme::PrintIntJeaiii(
+  char* buffer
+  , size_t size
+  , int value
+)
+{
   if (buffer == nullptr || size == 0)
     return -1;
 
@@ -139,4 +142,69 @@ int Logme::PrintIntJeaiii(
   buffer[total] = 0;
 
   return total;
-}
\ No newline at end of file
+}
+int Logme::PrintUIntJeaiii(
+  char* buffer
+  , size_t size
+  , uint64_t value
+)
+{
+  if (buffer == nullptr || size == 0)
+    return -1;
+
+  if (value <= INT32_MAX)
+    return PrintIntJeaiii(buffer, size, (int)value);
+
+  int len = 10;
+  for (uint64_t limit = 10000000000ULL; len < 20 && value >= limit; limit *= 10)
+    len++;
+
+  if (size <= (size_t)len)
+    return -1;
+
+  char* q = buffer + len;
+  *q = 0;
+
+  // Eight digits at a time keep the divisions in 32 bits
+  while (value >= 100000000)
+  {
+    uint64_t high = value / 100000000;
+    uint32_t low = (uint32_t)(value - high * 100000000);
+
+    for (int i = 0; i < 4; i++)
+    {
+      uint32_t r = low % 100;
+      low /= 100;
+
+      q -= 2;
+      q[0] = DIGITS[r * 2];
+      q[1] = DIGITS[r * 2 + 1];
+    }
+
+    value = high;
+  }
+
+  uint32_t v = (uint32_t)value;
+  while (v >= 100)
+  {
+    uint32_t r = v % 100;
+    v /= 100;
+
+    q -= 2;
+    q[0] = DIGITS[r * 2];
+    q[1] = DIGITS[r * 2 + 1];
+  }
+
+  if (v < 10)
+  {
+    *--q = (char)('0' + v);
+  }
+  else
+  {
+    q -= 2;
+    q[0] = DIGITS[v * 2];
+    q[1] = DIGITS[v * 2 + 1];
+  }
+
+  return len;
+}
@@ -1,6 +1,7 @@
 #include "LogStatisticsInternal.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <cstring>
 #include <thread>
@@ -16,7 +17,23 @@ using namespace Logme;
 
 namespace
 {
+  const size_t MAX_STATISTICS_SHARDS = 64;
+
   std::atomic<uint64_t> NextGeneration(1);
+  std::atomic<unsigned> NextThreadShard(0);
+  thread_local unsigned ThreadShard = NextThreadShard.fetch_add(1, std::memory_order_relaxed);
+
+  size_t CalculateShardCount()
+  {
+    size_t requested = std::thread::hardware_concurrency();
+    requested = (std::min)((std::max)(requested, size_t(1)), MAX_STATISTICS_SHARDS);
+
+    size_t count = 1;
+    while (count < requested)
+      count <<= 1;
+
+    return count;
+  }
 
   const void* GetSiteKey(Context& context)
   {
@@ -97,21 +114,42 @@ namespace
     );
   }
 
-  void UpdateMaximum(
-    std::atomic<uint64_t>& target
-    , uint64_t value
+  // TSC value and time taken at the first use of latency timing. The tick
+  // rate is derived from the distance to the current values on report.
+  struct TimingCalibration
+  {
+    uint64_t Ticks;
+    std::chrono::steady_clock::time_point Time;
+
+    TimingCalibration()
+      : Ticks(ReadTimingTicks())
+      , Time(std::chrono::steady_clock::now())
+    {
+    }
+  };
+
+  const TimingCalibration& GetTimingCalibration()
+  {
+    static const TimingCalibration calibration;
+    return calibration;
+  }
+
+  LogSiteStatistics::BackendStatistics* FindBackend(
+    LogSiteStatistics& site
+    , uint64_t backendId
   )
   {
-    uint64_t current = target.load(std::memory_order_relaxed);
-    while (current < value
-      && !target.compare_exchange_weak(
-        current
-        , value
-        , std::memory_order_relaxed
-        , std::memory_order_relaxed
-      ))
+    for (auto& slot : site.BackendSlots)
     {
+      LogSiteStatistics::BackendStatistics* statistics = slot.load(
+        std::memory_order_acquire
+      );
+
+      if (statistics == nullptr || statistics->BackendId == backendId)
+        return statistics;
     }
+
+    return nullptr;
   }
 
   std::string CopyMetadata(
@@ -238,6 +276,248 @@ namespace
     );
     response += line;
   }
+
+  const char* GetLatencySortName(LogLatencySort sort)
+  {
+    switch (sort)
+    {
+      case LogLatencySort::FORMAT:
+        return "format-p99";
+
+      case LogLatencySort::APPLY:
+        return "apply-p99";
+
+      case LogLatencySort::DISPLAY:
+        return "display-p99";
+
+      case LogLatencySort::TOTAL:
+      default:
+        return "total-p99";
+    }
+  }
+
+  void AppendPercentiles(
+    std::string& response
+    , const char* name
+    , const LogLatencyPercentiles& p
+    , const std::string& suffix = std::string()
+  )
+  {
+    char line[256];
+    snprintf(
+      line
+      , sizeof(line)
+      , "   %-8s count=%llu p50=%lluns p99=%lluns p999=%lluns max=%lluns"
+      , name
+      , static_cast<unsigned long long>(p.Count)
+      , static_cast<unsigned long long>(p.P50)
+      , static_cast<unsigned long long>(p.P99)
+      , static_cast<unsigned long long>(p.P999)
+      , static_cast<unsigned long long>(p.Max)
+    );
+    response += line;
+    response += suffix;
+    response += "\n";
+  }
+
+  // FileBackend overflow counters are process totals, not session values
+  void AppendFileOverflowStatus(std::string& response)
+  {
+    FileBackendCounters c = FileBackend::GetCounters();
+
+    char line[640];
+    snprintf(
+      line
+      , sizeof(line)
+      , "File overflow dropped records: DEBUG=%llu INFO=%llu WARN=%llu ERROR=%llu CRITICAL=%llu\nFile overflow dropped bytes: %llu\nFile overflow blocked records: %llu\nFile overflow spilled records: %llu\nFile overflow spilled bytes: %llu\nFile overflow dropped oldest buffers: %llu\nFile overflow dropped oldest bytes: %llu\n"
+      , static_cast<unsigned long long>(c.OverflowDroppedRecords[LEVEL_DEBUG])
+      , static_cast<unsigned long long>(c.OverflowDroppedRecords[LEVEL_INFO])
+      , static_cast<unsigned long long>(c.OverflowDroppedRecords[LEVEL_WARN])
+      , static_cast<unsigned long long>(c.OverflowDroppedRecords[LEVEL_ERROR])
+      , static_cast<unsigned long long>(c.OverflowDroppedRecords[LEVEL_CRITICAL])
+      , static_cast<unsigned long long>(c.OverflowDroppedBytes)
+      , static_cast<unsigned long long>(c.OverflowBlockedRecords)
+      , static_cast<unsigned long long>(c.OverflowSpilledRecords)
+      , static_cast<unsigned long long>(c.OverflowSpilledBytes)
+      , static_cast<unsigned long long>(c.OverflowDroppedOldestBuffers)
+      , static_cast<unsigned long long>(c.OverflowDroppedOldestBytes)
+    );
+    response += line;
+  }
+
+  void AppendCompressionStatus(std::string& response)
+  {
+    CompressionCounters c = CompressionManager::GetCounters();
+
+    double cpu = double(c.CpuNanoseconds) / 1e9;
+    double active = double(c.ActiveNanoseconds) / 1e9;
+    double ratio = c.InputBytes ? double(c.OutputBytes) / double(c.InputBytes) : 0.0;
+    double throughput = active > 0 ? double(c.InputBytes) / active / (1024.0 * 1024.0) : 0.0;
+
+    char line[640];
+    snprintf(
+      line
+      , sizeof(line)
+      , "Compression threads: %llu\nCompressed files: gzip=%llu zstd=%llu failed=%llu\nCompression blocks: %llu\nCompression input bytes: %llu\nCompression output bytes: %llu\nCompression ratio: %.3f\nCompression CPU time: %.3f s\nCompression active time: %.3f s\nCompression throughput: %.1f MB/s\n"
+      , static_cast<unsigned long long>(c.Threads)
+      , static_cast<unsigned long long>(c.GzipFiles)
+      , static_cast<unsigned long long>(c.ZstdFiles)
+      , static_cast<unsigned long long>(c.FailedFiles)
+      , static_cast<unsigned long long>(c.Blocks)
+      , static_cast<unsigned long long>(c.InputBytes)
+      , static_cast<unsigned long long>(c.OutputBytes)
+      , ratio
+      , cpu
+      , active
+      , throughput
+    );
+    response += line;
+  }
+}
+
+size_t Logme::GetStatisticsShardCount()
+{
+  static const size_t count = CalculateShardCount();
+  return count;
+}
+
+size_t Logme::GetStatisticsShard()
+{
+  return ThreadShard & (GetStatisticsShardCount() - 1);
+}
+
+double Logme::GetNanosecondsPerTick()
+{
+#ifdef LOGME_TIMING_TSC
+  const TimingCalibration& calibration = GetTimingCalibration();
+
+  // A short interval gives an imprecise rate: wait for at least 10 ms
+  std::chrono::steady_clock::time_point now;
+  while (true)
+  {
+    now = std::chrono::steady_clock::now();
+    if (now - calibration.Time >= std::chrono::milliseconds(10))
+      break;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  uint64_t ticks = ReadTimingTicks();
+  double ns = static_cast<double>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      now - calibration.Time
+    ).count()
+  );
+
+  if (ticks <= calibration.Ticks)
+    return 1.0;
+
+  return ns / static_cast<double>(ticks - calibration.Ticks);
+#else
+  return 1.0;
+#endif
+}
+
+LatencyHistogram::LatencyHistogram()
+  : Counters(MAX_SHARDS)
+{
+}
+
+size_t LatencyHistogram::GetBucket(uint64_t ticks)
+{
+  if (ticks < SUB_BUCKETS)
+    return static_cast<size_t>(ticks);
+
+  const uint64_t maximum = (uint64_t(1) << MAX_BITS) - 1;
+  if (ticks > maximum)
+    ticks = maximum;
+
+  size_t msb = 0;
+  for (uint64_t v = ticks; v >>= 1;)
+    msb++;
+
+  size_t shift = msb - SUB_BITS;
+  size_t sub = static_cast<size_t>(ticks >> shift) & (SUB_BUCKETS - 1);
+  return (shift + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::GetBucketLimit(size_t bucket)
+{
+  if (bucket < SUB_BUCKETS)
+    return bucket;
+
+  size_t shift = bucket / SUB_BUCKETS - 1;
+  uint64_t sub = bucket % SUB_BUCKETS;
+  return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t ticks)
+{
+  auto& shard = Counters.Local();
+  shard.Add(GetBucket(ticks), 1);
+  shard.Add(COUNT, 1);
+  shard.Add(SUM, ticks);
+  shard.Maximum(MAXIMUM, ticks);
+}
+
+void LatencyHistogram::Reset()
+{
+  Counters.Reset();
+}
+
+LogLatencyPercentiles LatencyHistogram::Snapshot(double nsPerTick) const
+{
+  LogLatencyPercentiles result;
+
+  std::vector<uint64_t> buckets(BUCKET_COUNT);
+  uint64_t count = 0;
+  for (size_t i = 0; i < BUCKET_COUNT; i++)
+  {
+    buckets[i] = Counters.Sum(i);
+    count += buckets[i];
+  }
+
+  if (count == 0)
+    return result;
+
+  uint64_t maximum = Counters.Max(MAXIMUM);
+  auto toNs = [nsPerTick](uint64_t ticks)
+  {
+    return static_cast<uint64_t>(static_cast<double>(ticks) * nsPerTick + 0.5);
+  };
+
+  auto percentile = [&](double fraction)
+  {
+    uint64_t rank = static_cast<uint64_t>(
+      std::ceil(fraction * static_cast<double>(count))
+    );
+    if (rank < 1)
+      rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++)
+    {
+      seen += buckets[i];
+      if (seen >= rank)
+        return toNs((std::min)(GetBucketLimit(i), maximum));
+    }
+
+    return toNs(maximum);
+  };
+
+  result.Count = count;
+  result.P50 = percentile(0.50);
+  result.P99 = percentile(0.99);
+  result.P999 = percentile(0.999);
+  result.Max = toNs(maximum);
+  return result;
+}
+
+void LogSiteTiming::Reset()
+{
+  Format.Reset();
+  Apply.Reset();
+  Total.Reset();
 }
 
 LogSiteChannelStatistics::LogSiteChannelStatistics(
@@ -246,24 +526,21 @@ LogSiteChannelStatistics::LogSiteChannelStatistics(
 )
   : ChannelKey(channel)
   , ChannelName(channelName)
-  , Records(0)
-  , MessageBytes(0)
-  , MaxMessageBytes(0)
+  , Counters(SITE_STATISTICS_MAX_SHARDS)
 {
 }
 
 void LogSiteChannelStatistics::Reset()
 {
-  Records.store(0, std::memory_order_relaxed);
-  MessageBytes.store(0, std::memory_order_relaxed);
-  MaxMessageBytes.store(0, std::memory_order_relaxed);
+  Counters.Reset();
 }
 
 void LogSiteChannelStatistics::Record(size_t messageBytes)
 {
-  Records.fetch_add(1, std::memory_order_relaxed);
-  MessageBytes.fetch_add(messageBytes, std::memory_order_relaxed);
-  UpdateMaximum(MaxMessageBytes, messageBytes);
+  auto& shard = Counters.Local();
+  shard.Add(RECORDS, 1);
+  shard.Add(MESSAGE_BYTES, messageBytes);
+  shard.Maximum(MAX_MESSAGE_BYTES, messageBytes);
 }
 
 LogSiteStatistics::LogSiteStatistics(
@@ -277,12 +554,8 @@ LogSiteStatistics::LogSiteStatistics(
   , Format(CopyMetadata(format, 1024))
   , Line(context.Line)
   , ErrorLevel(context.ErrorLevel)
-  , OverflowRecords(0)
-  , OverflowMessageBytes(0)
-  , OverflowMaxMessageBytes(0)
-  , OverflowBackendRecords(0)
-  , OverflowBackendBytes(0)
-  , OverflowBackendMaxBytes(0)
+  , Overflow(SITE_STATISTICS_MAX_SHARDS)
+  , Timing(nullptr)
 {
   for (auto& slot : ChannelSlots)
     slot.store(nullptr, std::memory_order_relaxed);
@@ -293,18 +566,16 @@ LogSiteStatistics::LogSiteStatistics(
 
 void LogSiteStatistics::Reset()
 {
-  OverflowRecords.store(0, std::memory_order_relaxed);
-  OverflowMessageBytes.store(0, std::memory_order_relaxed);
-  OverflowMaxMessageBytes.store(0, std::memory_order_relaxed);
-  OverflowBackendRecords.store(0, std::memory_order_relaxed);
-  OverflowBackendBytes.store(0, std::memory_order_relaxed);
-  OverflowBackendMaxBytes.store(0, std::memory_order_relaxed);
+  Overflow.Reset();
 
   for (auto& channel : OwnedChannels)
     channel->Reset();
 
   for (auto& backend : OwnedBackends)
     backend->Reset();
+
+  if (OwnedTiming)
+    OwnedTiming->Reset();
 }
 
 LogSiteStatistics::BackendStatistics::BackendStatistics(
@@ -315,24 +586,25 @@ LogSiteStatistics::BackendStatistics::BackendStatistics(
   : BackendId(backendId)
   , ChannelName(channelName)
   , BackendType(backendType)
-  , Records(0)
-  , OutputBytes(0)
-  , MaxOutputBytes(0)
+  , Counters(SITE_STATISTICS_MAX_SHARDS)
+  , DisplayTiming(nullptr)
 {
 }
 
 void LogSiteStatistics::BackendStatistics::Reset()
 {
-  Records.store(0, std::memory_order_relaxed);
-  OutputBytes.store(0, std::memory_order_relaxed);
-  MaxOutputBytes.store(0, std::memory_order_relaxed);
+  Counters.Reset();
+
+  if (OwnedDisplayTiming)
+    OwnedDisplayTiming->Reset();
 }
 
 void LogSiteStatistics::BackendStatistics::Record(size_t outputBytes)
 {
-  Records.fetch_add(1, std::memory_order_relaxed);
-  OutputBytes.fetch_add(outputBytes, std::memory_order_relaxed);
-  UpdateMaximum(MaxOutputBytes, outputBytes);
+  auto& shard = Counters.Local();
+  shard.Add(RECORDS, 1);
+  shard.Add(OUTPUT_BYTES, outputBytes);
+  shard.Maximum(MAX_OUTPUT_BYTES, outputBytes);
 }
 
 BackendRuntimeStatistics::BackendRuntimeStatistics(
@@ -344,22 +616,6 @@ BackendRuntimeStatistics::BackendRuntimeStatistics(
   , BackendType(backend->GetType() != nullptr ? backend->GetType() : "<unknown>")
   , Details(backend->FormatDetails())
   , Async(backend->GetAsync())
-  , AcceptedRecords(0)
-  , AcceptedBytes(0)
-  , QueueDroppedRecords(0)
-  , QueueDroppedBytes(0)
-  , WriteBatches(0)
-  , WriteOperations(0)
-  , BatchBuffers(0)
-  , BatchBytes(0)
-  , MaxBatchBuffers(0)
-  , MaxBatchBytes(0)
-  , WrittenBuffers(0)
-  , WrittenBytes(0)
-  , FailedBatches(0)
-  , FailedWriteOperations(0)
-  , FailedBuffers(0)
-  , FailedBytes(0)
 {
   if (ChannelName.empty())
     ChannelName = "<default>";
@@ -370,34 +626,21 @@ BackendRuntimeStatistics::BackendRuntimeStatistics(
 
 void BackendRuntimeStatistics::Reset()
 {
-  AcceptedRecords.store(0, std::memory_order_relaxed);
-  AcceptedBytes.store(0, std::memory_order_relaxed);
-  QueueDroppedRecords.store(0, std::memory_order_relaxed);
-  QueueDroppedBytes.store(0, std::memory_order_relaxed);
-  WriteBatches.store(0, std::memory_order_relaxed);
-  WriteOperations.store(0, std::memory_order_relaxed);
-  BatchBuffers.store(0, std::memory_order_relaxed);
-  BatchBytes.store(0, std::memory_order_relaxed);
-  MaxBatchBuffers.store(0, std::memory_order_relaxed);
-  MaxBatchBytes.store(0, std::memory_order_relaxed);
-  WrittenBuffers.store(0, std::memory_order_relaxed);
-  WrittenBytes.store(0, std::memory_order_relaxed);
-  FailedBatches.store(0, std::memory_order_relaxed);
-  FailedWriteOperations.store(0, std::memory_order_relaxed);
-  FailedBuffers.store(0, std::memory_order_relaxed);
-  FailedBytes.store(0, std::memory_order_relaxed);
+  Counters.Reset();
 }
 
 void BackendRuntimeStatistics::RecordAccepted(size_t outputBytes)
 {
-  AcceptedRecords.fetch_add(1, std::memory_order_relaxed);
-  AcceptedBytes.fetch_add(outputBytes, std::memory_order_relaxed);
+  auto& shard = Counters.Local();
+  shard.Add(ACCEPTED_RECORDS, 1);
+  shard.Add(ACCEPTED_BYTES, outputBytes);
 }
 
 void BackendRuntimeStatistics::RecordQueueDrop(size_t outputBytes)
 {
-  QueueDroppedRecords.fetch_add(1, std::memory_order_relaxed);
-  QueueDroppedBytes.fetch_add(outputBytes, std::memory_order_relaxed);
+  auto& shard = Counters.Local();
+  shard.Add(QUEUE_DROPPED_RECORDS, 1);
+  shard.Add(QUEUE_DROPPED_BYTES, outputBytes);
 }
 
 void BackendRuntimeStatistics::RecordWrite(
@@ -411,29 +654,26 @@ void BackendRuntimeStatistics::RecordWrite(
   , size_t failedBytes
 )
 {
-  WriteBatches.fetch_add(1, std::memory_order_relaxed);
-  WriteOperations.fetch_add(writeOperations, std::memory_order_relaxed);
-  BatchBuffers.fetch_add(batchBuffers, std::memory_order_relaxed);
-  BatchBytes.fetch_add(batchBytes, std::memory_order_relaxed);
-  UpdateMaximum(MaxBatchBuffers, batchBuffers);
-  UpdateMaximum(MaxBatchBytes, batchBytes);
-  WrittenBuffers.fetch_add(writtenBuffers, std::memory_order_relaxed);
-  WrittenBytes.fetch_add(writtenBytes, std::memory_order_relaxed);
+  auto& shard = Counters.Local();
+  shard.Add(WRITE_BATCHES, 1);
+  shard.Add(WRITE_OPERATIONS, writeOperations);
+  shard.Add(BATCH_BUFFERS, batchBuffers);
+  shard.Add(BATCH_BYTES, batchBytes);
+  shard.Maximum(MAX_BATCH_BUFFERS, batchBuffers);
+  shard.Maximum(MAX_BATCH_BYTES, batchBytes);
+  shard.Add(WRITTEN_BUFFERS, writtenBuffers);
+  shard.Add(WRITTEN_BYTES, writtenBytes);
 
   if (failedWriteOperations != 0 || failedBuffers != 0 || failedBytes != 0)
-    FailedBatches.fetch_add(1, std::memory_order_relaxed);
+    shard.Add(FAILED_BATCHES, 1);
 
-  FailedWriteOperations.fetch_add(
-    failedWriteOperations
-    , std::memory_order_relaxed
-  );
-  FailedBuffers.fetch_add(failedBuffers, std::memory_order_relaxed);
-  FailedBytes.fetch_add(failedBytes, std::memory_order_relaxed);
+  shard.Add(FAILED_WRITE_OPERATIONS, failedWriteOperations);
+  shard.Add(FAILED_BUFFERS, failedBuffers);
+  shard.Add(FAILED_BYTES, failedBytes);
 }
 
 LogStatisticsCollector::LogStatisticsCollector()
   : Generation(NextGeneration.fetch_add(1, std::memory_order_relaxed))
-  , InFlight(0)
   , HasSession(false)
 {
 }
@@ -443,19 +683,21 @@ uint64_t LogStatisticsCollector::GetGeneration() const
   return Generation;
 }
 
+// A thread leaves through the same shard it entered, so every shard stays
+// non-negative and the collector is idle when all of them are zero
 void LogStatisticsCollector::Enter()
 {
-  InFlight.fetch_add(1, std::memory_order_acquire);
+  InFlight.Local().Value[0].fetch_add(1, std::memory_order_seq_cst);
 }
 
 void LogStatisticsCollector::Leave()
 {
-  InFlight.fetch_sub(1, std::memory_order_release);
+  InFlight.Local().Value[0].fetch_sub(1, std::memory_order_release);
 }
 
 void LogStatisticsCollector::WaitForIdle() const
 {
-  while (InFlight.load(std::memory_order_acquire) != 0)
+  while (InFlight.Sum(0, std::memory_order_seq_cst) != 0)
     std::this_thread::yield();
 }
 
@@ -493,7 +735,7 @@ void LogStatisticsCollector::Reset()
   }
 }
 
-void LogStatisticsCollector::Record(
+LogSiteStatistics* LogStatisticsCollector::Record(
   Context& context
   , Channel* channel
   , const char* format
@@ -517,7 +759,7 @@ void LogStatisticsCollector::Record(
     if (channelStatistics->ChannelKey == channel)
     {
       channelStatistics->Record(messageBytes);
-      return;
+      return site;
     }
   }
 
@@ -525,13 +767,59 @@ void LogStatisticsCollector::Record(
   if (channelStatistics != nullptr)
   {
     channelStatistics->Record(messageBytes);
-    return;
+    return site;
   }
 
-  site->OverflowRecords.fetch_add(1, std::memory_order_relaxed);
-  site->OverflowMessageBytes.fetch_add(messageBytes, std::memory_order_relaxed);
-  UpdateMaximum(site->OverflowMaxMessageBytes, messageBytes);
-  return;
+  auto& shard = site->Overflow.Local();
+  shard.Add(LogSiteStatistics::OVERFLOW_RECORDS, 1);
+  shard.Add(LogSiteStatistics::OVERFLOW_MESSAGE_BYTES, messageBytes);
+  shard.Maximum(LogSiteStatistics::OVERFLOW_MAX_MESSAGE_BYTES, messageBytes);
+  return site;
+}
+
+void LogStatisticsCollector::RecordTiming(
+  LogSiteStatistics* site
+  , uint64_t formatTicks
+  , uint64_t applyTicks
+  , uint64_t totalTicks
+)
+{
+  LogSiteTiming* timing = site->Timing.load(std::memory_order_acquire);
+  if (timing == nullptr)
+    timing = GetOrCreateTiming(*site);
+
+  timing->Format.Record(formatTicks);
+  timing->Apply.Record(applyTicks);
+  timing->Total.Record(totalTicks);
+}
+
+void LogStatisticsCollector::RecordBackendTiming(
+  LogSiteStatistics* site
+  , Channel* channel
+  , Backend* backend
+  , uint64_t ticks
+)
+{
+  LogSiteStatistics::BackendStatistics* statistics = FindBackend(
+    *site
+    , backend->GetStatisticsId()
+  );
+
+  if (statistics == nullptr)
+    statistics = GetOrCreateBackend(*site, channel, backend);
+
+  // Backends beyond BACKEND_SLOT_COUNT are not timed
+  if (statistics == nullptr)
+    return;
+
+  LatencyHistogram* histogram = statistics->DisplayTiming.load(
+    std::memory_order_acquire
+  );
+
+  if (histogram == nullptr)
+    histogram = GetOrCreateDisplayTiming(*statistics);
+
+  histogram->Record(ticks);
 }
 
 void LogStatisticsCollector::RecordBackend(
@@ -558,24 +846,18 @@ void LogStatisticsCollector::RecordBackend(
       runtime->RecordAccepted(outputBytes);
   }
 
-  uint64_t backendId = backend->GetStatisticsId();
-  for (auto& slot : site->BackendSlots)
-  {
-    LogSiteStatistics::BackendStatistics* statistics = slot.load(
-      std::memory_order_acquire
-    );
-
-    if (statistics == nullptr)
-      break;
+  LogSiteStatistics::BackendStatistics* statistics = FindBackend(
+    *site
+    , backend->GetStatisticsId()
+  );
 
-    if (statistics->BackendId == backendId)
-    {
-      statistics->Record(outputBytes);
-      return;
-    }
+  if (statistics != nullptr)
+  {
+    statistics->Record(outputBytes);
+    return;
   }
 
-  LogSiteStatistics::BackendStatistics* statistics = GetOrCreateBackend(
+  statistics = GetOrCreateBackend(
     *site
     , channel
     , backend
@@ -587,9 +869,10 @@ void LogStatisticsCollector::RecordBackend(
     return;
   }
 
-  site->OverflowBackendRecords.fetch_add(1, std::memory_order_relaxed);
-  site->OverflowBackendBytes.fetch_add(outputBytes, std::memory_order_relaxed);
-  UpdateMaximum(site->OverflowBackendMaxBytes, outputBytes);
+  auto& shard = site->Overflow.Local();
+  shard.Add(LogSiteStatistics::OVERFLOW_BACKEND_RECORDS, 1);
+  shard.Add(LogSiteStatistics::OVERFLOW_BACKEND_BYTES, outputBytes);
+  shard.Maximum(LogSiteStatistics::OVERFLOW_BACKEND_MAX_BYTES, outputBytes);
 }
 
 void LogStatisticsCollector::RecordFileBackendQueueDrop(
@@ -824,6 +1107,39 @@ BackendRuntimeStatistics* LogStatisticsCollector::GetOrCreateRuntimeBackend(
   return result;
 }
 
+LogSiteTiming* LogStatisticsCollector::GetOrCreateTiming(LogSiteStatistics& site)
+{
+  std::lock_guard guard(Lock);
+
+  LogSiteTiming* timing = site.Timing.load(std::memory_order_relaxed);
+  if (timing != nullptr)
+    return timing;
+
+  site.OwnedTiming = std::make_unique<LogSiteTiming>();
+  timing = site.OwnedTiming.get();
+  site.Timing.store(timing, std::memory_order_release);
+  return timing;
+}
+
+LatencyHistogram* LogStatisticsCollector::GetOrCreateDisplayTiming(
+  LogSiteStatistics::BackendStatistics& backend
+)
+{
+  std::lock_guard guard(Lock);
+
+  LatencyHistogram* histogram = backend.DisplayTiming.load(
+    std::memory_order_relaxed
+  );
+
+  if (histogram != nullptr)
+    return histogram;
+
+  backend.OwnedDisplayTiming = std::make_unique<LatencyHistogram>();
+  histogram = backend.OwnedDisplayTiming.get();
+  backend.DisplayTiming.store(histogram, std::memory_order_release);
+  return histogram;
+}
+
 std::vector<LogStatisticsCollector::EntrySnapshot>
 LogStatisticsCollector::SnapshotEntries() const
 {
@@ -840,7 +1156,7 @@ LogStatisticsCollector::SnapshotEntries() const
       if (channel == nullptr)
         break;
 
-      uint64_t records = channel->Records.load(std::memory_order_relaxed);
+      uint64_t records = channel->Counters.Sum(LogSiteChannelStatistics::RECORDS);
       if (records == 0)
         continue;
 
@@ -852,12 +1168,12 @@ LogStatisticsCollector::SnapshotEntries() const
       entry.Line = site->Line;
       entry.ErrorLevel = site->ErrorLevel;
       entry.Records = records;
-      entry.MessageBytes = channel->MessageBytes.load(std::memory_order_relaxed);
-      entry.MaxMessageBytes = channel->MaxMessageBytes.load(std::memory_order_relaxed);
+      entry.MessageBytes = channel->Counters.Sum(LogSiteChannelStatistics::MESSAGE_BYTES);
+      entry.MaxMessageBytes = channel->Counters.Max(LogSiteChannelStatistics::MAX_MESSAGE_BYTES);
       result.push_back(std::move(entry));
     }
 
-    uint64_t overflowRecords = site->OverflowRecords.load(std::memory_order_relaxed);
+    uint64_t overflowRecords = site->Overflow.Sum(LogSiteStatistics::OVERFLOW_RECORDS);
     if (overflowRecords != 0)
     {
       EntrySnapshot entry;
@@ -868,8 +1184,8 @@ LogStatisticsCollector::SnapshotEntries() const
       entry.Line = site->Line;
       entry.ErrorLevel = site->ErrorLevel;
       entry.Records = overflowRecords;
-      entry.MessageBytes = site->OverflowMessageBytes.load(std::memory_order_relaxed);
-      entry.MaxMessageBytes = site->OverflowMaxMessageBytes.load(std::memory_order_relaxed);
+      entry.MessageBytes = site->Overflow.Sum(LogSiteStatistics::OVERFLOW_MESSAGE_BYTES);
+      entry.MaxMessageBytes = site->Overflow.Max(LogSiteStatistics::OVERFLOW_MAX_MESSAGE_BYTES);
       result.push_back(std::move(entry));
     }
   }
@@ -927,7 +1243,9 @@ LogStatisticsCollector::SnapshotBackendEntries(
       if (!backendType.empty() && backend->BackendType != backendType)
         continue;
 
-      uint64_t records = backend->Records.load(std::memory_order_relaxed);
+      uint64_t records = backend->Counters.Sum(
+        LogSiteStatistics::BackendStatistics::RECORDS
+      );
       if (records == 0)
         continue;
 
@@ -940,15 +1258,17 @@ LogStatisticsCollector::SnapshotBackendEntries(
       entry.Line = site->Line;
       entry.ErrorLevel = site->ErrorLevel;
       entry.Records = records;
-      entry.OutputBytes = backend->OutputBytes.load(std::memory_order_relaxed);
-      entry.MaxOutputBytes = backend->MaxOutputBytes.load(
-        std::memory_order_relaxed
+      entry.OutputBytes = backend->Counters.Sum(
+        LogSiteStatistics::BackendStatistics::OUTPUT_BYTES
+      );
+      entry.MaxOutputBytes = backend->Counters.Max(
+        LogSiteStatistics::BackendStatistics::MAX_OUTPUT_BYTES
       );
       result.push_back(std::move(entry));
     }
 
-    uint64_t overflowRecords = site->OverflowBackendRecords.load(
-      std::memory_order_relaxed
+    uint64_t overflowRecords = site->Overflow.Sum(
+      LogSiteStatistics::OVERFLOW_BACKEND_RECORDS
     );
 
     if (overflowRecords != 0 && backendType.empty())
@@ -962,11 +1282,11 @@ LogStatisticsCollector::SnapshotBackendEntries(
       entry.Line = site->Line;
       entry.ErrorLevel = site->ErrorLevel;
       entry.Records = overflowRecords;
-      entry.OutputBytes = site->OverflowBackendBytes.load(
-        std::memory_order_relaxed
+      entry.OutputBytes = site->Overflow.Sum(
+        LogSiteStatistics::OVERFLOW_BACKEND_BYTES
       );
-      entry.MaxOutputBytes = site->OverflowBackendMaxBytes.load(
-        std::memory_order_relaxed
+      entry.MaxOutputBytes = site->Overflow.Max(
+        LogSiteStatistics::OVERFLOW_BACKEND_MAX_BYTES
       );
       result.push_back(std::move(entry));
     }
@@ -1026,54 +1346,23 @@ LogStatisticsCollector::SnapshotFileBackends() const
     snapshot.BackendType = runtime->BackendType;
     snapshot.Details = runtime->Details;
     snapshot.Async = runtime->Async;
-    snapshot.AcceptedRecords = runtime->AcceptedRecords.load(
-      std::memory_order_relaxed
-    );
-    snapshot.AcceptedBytes = runtime->AcceptedBytes.load(
-      std::memory_order_relaxed
-    );
-    snapshot.QueueDroppedRecords = runtime->QueueDroppedRecords.load(
-      std::memory_order_relaxed
-    );
-    snapshot.QueueDroppedBytes = runtime->QueueDroppedBytes.load(
-      std::memory_order_relaxed
-    );
-    snapshot.WriteBatches = runtime->WriteBatches.load(
-      std::memory_order_relaxed
-    );
-    snapshot.WriteOperations = runtime->WriteOperations.load(
-      std::memory_order_relaxed
-    );
-    snapshot.BatchBuffers = runtime->BatchBuffers.load(
-      std::memory_order_relaxed
-    );
-    snapshot.BatchBytes = runtime->BatchBytes.load(
-      std::memory_order_relaxed
-    );
-    snapshot.MaxBatchBuffers = runtime->MaxBatchBuffers.load(
-      std::memory_order_relaxed
-    );
-    snapshot.MaxBatchBytes = runtime->MaxBatchBytes.load(
-      std::memory_order_relaxed
-    );
-    snapshot.WrittenBuffers = runtime->WrittenBuffers.load(
-      std::memory_order_relaxed
-    );
-    snapshot.WrittenBytes = runtime->WrittenBytes.load(
-      std::memory_order_relaxed
-    );
-    snapshot.FailedBatches = runtime->FailedBatches.load(
-      std::memory_order_relaxed
-    );
-    snapshot.FailedWriteOperations = runtime->FailedWriteOperations.load(
-      std::memory_order_relaxed
-    );
-    snapshot.FailedBuffers = runtime->FailedBuffers.load(
-      std::memory_order_relaxed
-    );
-    snapshot.FailedBytes = runtime->FailedBytes.load(
-      std::memory_order_relaxed
-    );
+    const auto& counters = runtime->Counters;
+    snapshot.AcceptedRecords = counters.Sum(BackendRuntimeStatistics::ACCEPTED_RECORDS);
+    snapshot.AcceptedBytes = counters.Sum(BackendRuntimeStatistics::ACCEPTED_BYTES);
+    snapshot.QueueDroppedRecords = counters.Sum(BackendRuntimeStatistics::QUEUE_DROPPED_RECORDS);
+    snapshot.QueueDroppedBytes = counters.Sum(BackendRuntimeStatistics::QUEUE_DROPPED_BYTES);
+    snapshot.WriteBatches = counters.Sum(BackendRuntimeStatistics::WRITE_BATCHES);
+    snapshot.WriteOperations = counters.Sum(BackendRuntimeStatistics::WRITE_OPERATIONS);
+    snapshot.BatchBuffers = counters.Sum(BackendRuntimeStatistics::BATCH_BUFFERS);
+    snapshot.BatchBytes = counters.Sum(BackendRuntimeStatistics::BATCH_BYTES);
+    snapshot.MaxBatchBuffers = counters.Max(BackendRuntimeStatistics::MAX_BATCH_BUFFERS);
+    snapshot.MaxBatchBytes = counters.Max(BackendRuntimeStatistics::MAX_BATCH_BYTES);
+    snapshot.WrittenBuffers = counters.Sum(BackendRuntimeStatistics::WRITTEN_BUFFERS);
+    snapshot.WrittenBytes = counters.Sum(BackendRuntimeStatistics::WRITTEN_BYTES);
+    snapshot.FailedBatches = counters.Sum(BackendRuntimeStatistics::FAILED_BATCHES);
+    snapshot.FailedWriteOperations = counters.Sum(BackendRuntimeStatistics::FAILED_WRITE_OPERATIONS);
+    snapshot.FailedBuffers = counters.Sum(BackendRuntimeStatistics::FAILED_BUFFERS);
+    snapshot.FailedBytes = counters.Sum(BackendRuntimeStatistics::FAILED_BYTES);
 
     if (snapshot.AcceptedRecords == 0
       && snapshot.QueueDroppedRecords == 0
@@ -1154,7 +1443,10 @@ std::string LogStatisticsCollector::FormatStatus(bool active) const
     , static_cast<unsigned long long>(fileDroppedBytes)
   );
 
-  return line;
+  std::string response(line);
+  AppendFileOverflowStatus(response);
+  AppendCompressionStatus(response);
+  return response;
 }
 
 std::string LogStatisticsCollector::FormatTop(
@@ -1655,6 +1947,171 @@ std::string LogStatisticsCollector::FormatFileBackends(
   return response;
 }
 
+std::vector<LogSiteLatency> LogStatisticsCollector::SnapshotLatency() const
+{
+  double nsPerTick = GetNanosecondsPerTick();
+
+  std::lock_guard guard(Lock);
+
+  std::vector<LogSiteLatency> result;
+  for (const auto& site : Sites)
+  {
+    LogSiteTiming* timing = site->Timing.load(std::memory_order_acquire);
+    if (timing == nullptr)
+      continue;
+
+    LogSiteLatency latency;
+    latency.TotalTime = timing->Total.Snapshot(nsPerTick);
+    if (latency.TotalTime.Count == 0)
+      continue;
+
+    latency.File = site->File;
+    latency.Method = site->Method;
+    latency.Format = site->Format;
+    latency.Line = site->Line;
+    latency.FormatTime = timing->Format.Snapshot(nsPerTick);
+    latency.ApplyTime = timing->Apply.Snapshot(nsPerTick);
+
+    for (const auto& slot : site->BackendSlots)
+    {
+      LogSiteStatistics::BackendStatistics* backend = slot.load(
+        std::memory_order_acquire
+      );
+
+      if (backend == nullptr)
+        break;
+
+      LatencyHistogram* display = backend->DisplayTiming.load(
+        std::memory_order_acquire
+      );
+
+      if (display == nullptr)
+        continue;
+
+      LogBackendLatency backendLatency;
+      backendLatency.Channel = backend->ChannelName;
+      backendLatency.BackendType = backend->BackendType;
+      backendLatency.Display = display->Snapshot(nsPerTick);
+
+      if (backendLatency.Display.Count != 0)
+        latency.Backends.push_back(std::move(backendLatency));
+    }
+
+    result.push_back(std::move(latency));
+  }
+
+  return result;
+}
+
+std::string LogStatisticsCollector::FormatLatency(
+  bool active
+  , bool timing
+  , LogLatencySort sort
+  , size_t limit
+) const
+{
+  std::vector<LogSiteLatency> sites = SnapshotLatency();
+
+  auto sortValue = [sort](const LogSiteLatency& site) -> uint64_t
+  {
+    switch (sort)
+    {
+      case LogLatencySort::FORMAT:
+        return site.FormatTime.P99;
+
+      case LogLatencySort::APPLY:
+        return site.ApplyTime.P99;
+
+      case LogLatencySort::DISPLAY:
+      {
+        uint64_t value = 0;
+        for (const auto& backend : site.Backends)
+          value = std::max(value, backend.Display.P99);
+
+        return value;
+      }
+
+      case LogLatencySort::TOTAL:
+      default:
+        return site.TotalTime.P99;
+    }
+  };
+
+  std::sort(
+    sites.begin()
+    , sites.end()
+    , [&sortValue](const LogSiteLatency& left, const LogSiteLatency& right)
+    {
+      uint64_t leftValue = sortValue(left);
+      uint64_t rightValue = sortValue(right);
+      if (leftValue != rightValue)
+        return leftValue > rightValue;
+
+      if (left.File != right.File)
+        return left.File < right.File;
+
+      return left.Line < right.Line;
+    }
+  );
+
+  uint64_t records = 0;
+  for (const LogSiteLatency& site : sites)
+    records += site.TotalTime.Count;
+
+  char header[512];
+  snprintf(
+    header
+    , sizeof(header)
+    , "Log latency statistics: %s\nTiming: %s\nDuration: %.3f s\nSort: %s\nTotal: timed-records=%llu\n"
+    , active ? "running" : "stopped"
+    , timing ? "enabled" : "disabled"
+    , GetDurationSeconds(active)
+    , GetLatencySortName(sort)
+    , static_cast<unsigned long long>(records)
+  );
+
+  std::string response = header;
+  if (sites.empty())
+  {
+    response += "No timed log records collected.\n";
+    return response;
+  }
+
+  size_t count = std::min(limit, sites.size());
+  for (size_t i = 0; i < count; ++i)
+  {
+    const LogSiteLatency& site = sites[i];
+
+    response += "\n";
+    response += std::to_string(i + 1);
+    response += ". ";
+    response += site.File;
+    response += ":";
+    response += std::to_string(site.Line);
+    response += " ";
+    response += site.Method;
+    response += "\n   format: ";
+    response += site.Format.empty() ? "<stream or empty>" : site.Format;
+    response += "\n";
+
+    AppendPercentiles(response, "total", site.TotalTime);
+    AppendPercentiles(response, "format", site.FormatTime);
+    AppendPercentiles(response, "apply", site.ApplyTime);
+
+    for (const auto& backend : site.Backends)
+    {
+      AppendPercentiles(
+        response
+        , "display"
+        , backend.Display
+        , " channel=" + backend.Channel + " backend=" + backend.BackendType
+      );
+    }
+  }
+
+  return response;
+}
+
 void Logger::RecordLogBackendOutput(
   Context& context
   , Channel* channel
@@ -1822,7 +2279,7 @@ std::string Logger::DumpLogStatisticsStatus()
 
   if (LogStatistics == nullptr)
   {
-    return
+    std::string response =
       "Log statistics: stopped\n"
       "Session: not started\n"
       "Duration: 0.000 s\n"
@@ -1836,6 +2293,10 @@ std::string Logger::DumpLogStatisticsStatus()
       "File written bytes: 0\n"
       "File failed batches: 0\n"
       "File queue dropped bytes: 0\n";
+
+    AppendFileOverflowStatus(response);
+    AppendCompressionStatus(response);
+    return response;
   }
 
   return LogStatistics->FormatStatus(IsLogStatisticsActive());
@@ -1933,6 +2394,102 @@ std::string Logger::DumpLogStatisticsBackends(
   );
 }
 
+void Logger::SetLogStatisticsTiming(bool enable)
+{
+  LogStatisticsTiming.store(enable, std::memory_order_relaxed);
+}
+
+bool Logger::IsLogStatisticsTimingEnabled() const
+{
+  return LogStatisticsTiming.load(std::memory_order_relaxed);
+}
+
+void Logger::RecordLogTiming(
+  LogSiteStatistics* site
+  , uint64_t formatTicks
+  , uint64_t applyTicks
+  , uint64_t totalTicks
+)
+{
+  LogStatisticsCollector* statistics = ActiveLogStatistics.load(
+    std::memory_order_relaxed
+  );
+
+  if (statistics == nullptr)
+    return;
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  statistics->Enter();
+
+  if (ActiveLogStatistics.load(std::memory_order_acquire) == statistics)
+    statistics->RecordTiming(site, formatTicks, applyTicks, totalTicks);
+
+  statistics->Leave();
+}
+
+void Logger::RecordLogBackendTiming(
+  Context& context
+  , Channel* channel
+  , Backend* backend
+  , uint64_t ticks
+)
+{
+  LogStatisticsCollector* statistics = ActiveLogStatistics.load(
+    std::memory_order_relaxed
+  );
+
+  if (statistics == nullptr || context.TimedSite == nullptr)
+    return;
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  statistics->Enter();
+
+  if (ActiveLogStatistics.load(std::memory_order_acquire) == statistics)
+  {
+    statistics->RecordBackendTiming(
+      context.TimedSite
+      , channel
+      , backend
+      , ticks
+    );
+  }
+
+  statistics->Leave();
+}
+
+std::string Logger::DumpLogStatisticsLatency(
+  LogLatencySort sort
+  , size_t limit
+)
+{
+  std::lock_guard guard(LogStatisticsControlLock);
+
+  if (LogStatistics == nullptr)
+  {
+    return
+      "Log latency statistics: stopped\n"
+      "Duration: 0.000 s\n"
+      "No timed log records collected.\n";
+  }
+
+  return LogStatistics->FormatLatency(
+    IsLogStatisticsActive()
+    , IsLogStatisticsTimingEnabled()
+    , sort
+    , limit
+  );
+}
+
+std::vector<LogSiteLatency> Logger::GetLogStatisticsLatency()
+{
+  std::lock_guard guard(LogStatisticsControlLock);
+
+  if (LogStatistics == nullptr)
+    return {};
+
+  return LogStatistics->SnapshotLatency();
+}
+
 std::string Logger::DumpLogStatisticsFileBackends(
   LogFileStatisticsSort sort
   , size_t limit
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cstddef>
@@ -13,6 +14,15 @@
 #include <Logme/LogStatistics.h>
 #include <Logme/Types.h>
 
+#if defined(_M_X64) || defined(__x86_64__)
+#define LOGME_TIMING_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
 namespace Logme
 {
   struct Backend;
@@ -23,13 +33,177 @@ namespace Logme
 
   uintptr_t* GetCLogStatisticsCache(Context& context);
 
+  // Shard used by the calling thread. A thread keeps its shard for its
+  // whole lifetime.
+  size_t GetStatisticsShardCount();
+  size_t GetStatisticsShard();
+
+  // Counters split in cache line sized shards. Each thread updates its own
+  // shard, so a log site hit from many threads does not bounce one cache
+  // line between cores. Readers aggregate the shards.
+  //
+  // A group of N counters takes one 64 byte line per 8 counters in every
+  // shard: up to 4 KB for 3 counters with 64 shards. A site can hold
+  // 1 + CHANNEL_SLOT_COUNT + BACKEND_SLOT_COUNT groups, so groups kept per
+  // site are limited to SITE_STATISTICS_MAX_SHARDS shards (at most 13 KB per
+  // site). Per backend groups and the in-flight counter use all shards.
+  enum : size_t
+  {
+    SITE_STATISTICS_MAX_SHARDS = 16
+  };
+
+  template<size_t N>
+  class ShardedCounters
+  {
+  public:
+    struct alignas(64) Shard
+    {
+      std::atomic<uint64_t> Value[N];
+
+      void Add(size_t index, uint64_t value)
+      {
+        Value[index].fetch_add(value, std::memory_order_relaxed);
+      }
+
+      void Maximum(size_t index, uint64_t value)
+      {
+        uint64_t current = Value[index].load(std::memory_order_relaxed);
+        while (current < value
+          && !Value[index].compare_exchange_weak(
+            current
+            , value
+            , std::memory_order_relaxed
+            , std::memory_order_relaxed
+          ))
+        {
+        }
+      }
+    };
+
+  private:
+    size_t Mask;
+    std::unique_ptr<Shard[]> Shards;
+
+  public:
+    // maxShards is a power of two
+    explicit ShardedCounters(size_t maxShards = SIZE_MAX)
+      : Mask((std::min)(GetStatisticsShardCount(), maxShards) - 1)
+      , Shards(new Shard[Mask + 1])
+    {
+      Reset();
+    }
+
+    Shard& Local()
+    {
+      return Shards[GetStatisticsShard() & Mask];
+    }
+
+    uint64_t Sum(
+      size_t index
+      , std::memory_order order = std::memory_order_relaxed
+    ) const
+    {
+      uint64_t sum = 0;
+      for (size_t i = 0; i <= Mask; i++)
+        sum += Shards[i].Value[index].load(order);
+
+      return sum;
+    }
+
+    uint64_t Max(size_t index) const
+    {
+      uint64_t value = 0;
+      for (size_t i = 0; i <= Mask; i++)
+        value = (std::max)(value, Shards[i].Value[index].load(std::memory_order_relaxed));
+
+      return value;
+    }
+
+    void Reset()
+    {
+      for (size_t i = 0; i <= Mask; i++)
+      {
+        for (auto& value : Shards[i].Value)
+          value.store(0, std::memory_order_relaxed);
+      }
+    }
+  };
+
+  // Timestamp of latency measurements: TSC where available, steady_clock
+  // nanoseconds otherwise. Ticks are converted to nanoseconds on report.
+  inline uint64_t ReadTimingTicks()
+  {
+#ifdef LOGME_TIMING_TSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+      ).count()
+    );
+#endif
+  }
+
+  double GetNanosecondsPerTick();
+
+  // Log-bucketed (HDR style) histogram of durations in ticks. Values below
+  // SUB_BUCKETS have a bucket each, larger ones get SUB_BUCKETS buckets per
+  // power of two, so a reported value is at most 1/SUB_BUCKETS above the
+  // measured one.
+  class LatencyHistogram
+  {
+  public:
+    enum : size_t
+    {
+      SUB_BITS = 3,
+      SUB_BUCKETS = size_t(1) << SUB_BITS,
+      MAX_BITS = 40,
+      BUCKET_COUNT = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS,
+
+      COUNT = BUCKET_COUNT,
+      SUM,
+      MAXIMUM,
+      COUNTER_COUNT,
+
+      MAX_SHARDS = 4
+    };
+
+  private:
+    ShardedCounters<COUNTER_COUNT> Counters;
+
+  public:
+    LatencyHistogram();
+
+    static size_t GetBucket(uint64_t ticks);
+    static uint64_t GetBucketLimit(size_t bucket);
+
+    void Record(uint64_t ticks);
+    void Reset();
+    LogLatencyPercentiles Snapshot(double nsPerTick) const;
+  };
+
+  struct LogSiteTiming
+  {
+    LatencyHistogram Format;
+    LatencyHistogram Apply;
+    LatencyHistogram Total;
+
+    void Reset();
+  };
+
   struct LogSiteChannelStatistics
   {
+    enum
+    {
+      RECORDS,
+      MESSAGE_BYTES,
+      MAX_MESSAGE_BYTES,
+      COUNTER_COUNT
+    };
+
     Channel* ChannelKey;
     std::string ChannelName;
-    std::atomic<uint64_t> Records;
-    std::atomic<uint64_t> MessageBytes;
-    std::atomic<uint64_t> MaxMessageBytes;
+    ShardedCounters<COUNTER_COUNT> Counters;
 
     LogSiteChannelStatistics(
       Channel* channel
@@ -55,19 +229,39 @@ namespace Logme
     int Line;
     Level ErrorLevel;
 
+    // Records of channels and backends that did not get a slot
+    enum
+    {
+      OVERFLOW_RECORDS,
+      OVERFLOW_MESSAGE_BYTES,
+      OVERFLOW_MAX_MESSAGE_BYTES,
+      OVERFLOW_BACKEND_RECORDS,
+      OVERFLOW_BACKEND_BYTES,
+      OVERFLOW_BACKEND_MAX_BYTES,
+      OVERFLOW_COUNTER_COUNT
+    };
+
     std::atomic<LogSiteChannelStatistics*> ChannelSlots[CHANNEL_SLOT_COUNT];
-    std::atomic<uint64_t> OverflowRecords;
-    std::atomic<uint64_t> OverflowMessageBytes;
-    std::atomic<uint64_t> OverflowMaxMessageBytes;
+    ShardedCounters<OVERFLOW_COUNTER_COUNT> Overflow;
 
     struct BackendStatistics
     {
+      enum
+      {
+        RECORDS,
+        OUTPUT_BYTES,
+        MAX_OUTPUT_BYTES,
+        COUNTER_COUNT
+      };
+
       uint64_t BackendId;
       std::string ChannelName;
       std::string BackendType;
-      std::atomic<uint64_t> Records;
-      std::atomic<uint64_t> OutputBytes;
-      std::atomic<uint64_t> MaxOutputBytes;
+      ShardedCounters<COUNTER_COUNT> Counters;
+
+      // Created when the first timed record reaches the backend
+      std::atomic<LatencyHistogram*> DisplayTiming;
+      std::unique_ptr<LatencyHistogram> OwnedDisplayTiming;
 
       BackendStatistics(
         uint64_t backendId
@@ -80,13 +274,14 @@ namespace Logme
     };
 
     std::atomic<BackendStatistics*> BackendSlots[BACKEND_SLOT_COUNT];
-    std::atomic<uint64_t> OverflowBackendRecords;
-    std::atomic<uint64_t> OverflowBackendBytes;
-    std::atomic<uint64_t> OverflowBackendMaxBytes;
 
     std::vector<std::unique_ptr<LogSiteChannelStatistics>> OwnedChannels;
     std::vector<std::unique_ptr<BackendStatistics>> OwnedBackends;
 
+    // Created when the first timed record is made at the site
+    std::atomic<LogSiteTiming*> Timing;
+    std::unique_ptr<LogSiteTiming> OwnedTiming;
+
     LogSiteStatistics(
       const void* siteKey
       , const Context& context
@@ -98,28 +293,34 @@ namespace Logme
 
   struct BackendRuntimeStatistics
   {
+    enum
+    {
+      ACCEPTED_RECORDS,
+      ACCEPTED_BYTES,
+      QUEUE_DROPPED_RECORDS,
+      QUEUE_DROPPED_BYTES,
+      WRITE_BATCHES,
+      WRITE_OPERATIONS,
+      BATCH_BUFFERS,
+      BATCH_BYTES,
+      MAX_BATCH_BUFFERS,
+      MAX_BATCH_BYTES,
+      WRITTEN_BUFFERS,
+      WRITTEN_BYTES,
+      FAILED_BATCHES,
+      FAILED_WRITE_OPERATIONS,
+      FAILED_BUFFERS,
+      FAILED_BYTES,
+      COUNTER_COUNT
+    };
+
     uint64_t BackendId;
     std::string ChannelName;
     std::string BackendType;
     std::string Details;
     bool Async;
 
-    std::atomic<uint64_t> AcceptedRecords;
-    std::atomic<uint64_t> AcceptedBytes;
-    std::atomic<uint64_t> QueueDroppedRecords;
-    std::atomic<uint64_t> QueueDroppedBytes;
-    std::atomic<uint64_t> WriteBatches;
-    std::atomic<uint64_t> WriteOperations;
-    std::atomic<uint64_t> BatchBuffers;
-    std::atomic<uint64_t> BatchBytes;
-    std::atomic<uint64_t> MaxBatchBuffers;
-    std::atomic<uint64_t> MaxBatchBytes;
-    std::atomic<uint64_t> WrittenBuffers;
-    std::atomic<uint64_t> WrittenBytes;
-    std::atomic<uint64_t> FailedBatches;
-    std::atomic<uint64_t> FailedWriteOperations;
-    std::atomic<uint64_t> FailedBuffers;
-    std::atomic<uint64_t> FailedBytes;
+    ShardedCounters<COUNTER_COUNT> Counters;
 
     BackendRuntimeStatistics(
       Backend* backend
@@ -219,7 +420,7 @@ namespace Logme
     std::unordered_map<uint64_t, BackendRuntimeStatistics*> RuntimeBackendById;
     std::vector<std::unique_ptr<BackendRuntimeStatistics>> RuntimeBackends;
 
-    std::atomic<uint64_t> InFlight;
+    ShardedCounters<1> InFlight;
     std::chrono::steady_clock::time_point StartedAt;
     std::chrono::steady_clock::time_point StoppedAt;
     bool HasSession;
@@ -237,13 +438,27 @@ namespace Logme
     void Stop();
     void Reset();
 
-    void Record(
+    LogSiteStatistics* Record(
       Context& context
       , Channel* channel
       , const char* format
       , size_t messageBytes
     );
 
+    void RecordTiming(
+      LogSiteStatistics* site
+      , uint64_t formatTicks
+      , uint64_t applyTicks
+      , uint64_t totalTicks
+    );
+
+    void RecordBackendTiming(
+      LogSiteStatistics* site
+      , Channel* channel
+      , Backend* backend
+      , uint64_t ticks
+    );
+
     void RecordBackend(
       LogSiteStatistics* site
       , Channel* channel
@@ -304,6 +519,15 @@ namespace Logme
       , size_t limit
     ) const;
 
+    std::string FormatLatency(
+      bool active
+      , bool timing
+      , LogLatencySort sort
+      , size_t limit
+    ) const;
+
+    std::vector<LogSiteLatency> SnapshotLatency() const;
+
   private:
     LogSiteStatistics* GetOrCreateSite(
       Context& context
@@ -326,6 +550,11 @@ namespace Logme
       , Backend* backend
     );
 
+    LogSiteTiming* GetOrCreateTiming(LogSiteStatistics& site);
+    LatencyHistogram* GetOrCreateDisplayTiming(
+      LogSiteStatistics::BackendStatistics& backend
+    );
+
     std::vector<EntrySnapshot> SnapshotEntries() const;
     std::vector<ChannelSnapshot> SnapshotChannels() const;
     std::vector<BackendEntrySnapshot> SnapshotBackendEntries(
@@ -4,11 +4,13 @@
 #include <cstring>
 #include <filesystem>
 #include <functional>
+#include <iterator>
 #include <stdarg.h>
 #include <utility>
 
 #include <Logme/Backend/ConsoleBackend.h>
 #include <Logme/Backend/DebugBackend.h>
+#include <Logme/DeferredFormat.h>
 #include <Logme/FastFormat.h>
 #include <Logme/File/exe_path.h>
 #include <Logme/Logger.h>
@@ -16,6 +18,7 @@
 #include <Logme/Utils.h>
 
 #include "Control/ControlDiscovery.h"
+#include "Control/ControlServer.h"
 #include "LogStatisticsInternal.h"
 #include "StringHelpers.h"
 
@@ -43,13 +46,28 @@ namespace
 }
 
 Logger::Logger()
-  : HomeDirectoryWatchDog(HomeDirectory, std::bind(&Logger::TestFileInUse, this, std::placeholders::_1))
+  : FileIndex(std::make_shared<LogFileIndex>())
+  , HomeDirectoryWatchDog(
+    HomeDirectory
+    , std::bind(&Logger::TestFileInUse, this, std::placeholders::_1)
+    , FileIndex
+  )
   , ActiveSubsystemLevelSnapshot(nullptr)
   , SubsystemLevelSnapshotReclamation(false)
   , SubsystemLevelSnapshotReaders(0)
+  , ActiveSubsystemFilterSnapshot(nullptr)
+  , SubsystemFilterSnapshotReclamation(false)
+  , SubsystemFilterSnapshotReaders(0)
+  , ActiveChannelLookupSnapshot(nullptr)
+  , ChannelLookupSnapshotReclamation(false)
+  , ChannelLookupSnapshotReaders(0)
+  , ChannelGeneration(1)
   , BlockReportedSubsystems(true)
   , IDGenerator(1)
-  , CompressionFactory(std::bind(&Logger::TestFileInUse, this, std::placeholders::_1))
+  , CompressionFactory(
+    std::bind(&Logger::TestFileInUse, this, std::placeholders::_1)
+    , std::bind(&LogFileIndex::Rename, FileIndex, std::placeholders::_1, std::placeholders::_2)
+  )
   , FatalHandling(false)
   , CrashFileHandle(-1)
   , CrashOutputMask(CRASH_OUTPUT_STDERR)
@@ -64,6 +82,7 @@ Logger::Logger()
   , TracePoints(nullptr)
   , LogStatistics(nullptr)
   , ActiveLogStatistics(nullptr)
+  , LogStatisticsTiming(false)
   , Condition(&Logger::DefaultCondition)
 {
   CreateDefaultChannelLayout();
@@ -139,6 +158,8 @@ void Logger::DeleteAllChannels()
   }
 
   Channels.clear();
+  PublishChannelLookupSnapshot();
+
   Default.reset();
 }
 
@@ -204,6 +225,11 @@ CompressionManagerFactory& Logger::GetCompressionManagerFactory()
   return CompressionFactory;
 }
 
+const LogFileIndexPtr& Logger::GetLogFileIndex() const
+{
+  return FileIndex;
+}
+
 ConsoleManagerFactory& Logger::GetConsoleManagerFactory()
 {
   return ConsoleFactory;
@@ -434,20 +460,310 @@ ChannelPtr Logger::GetDefaultChannelPtr()
   return Default;
 }
 
+static uint64_t HashChannelName(const char* name)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (; *name; ++name)
+  {
+    hash ^= (unsigned char)*name;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+const Logger::ChannelLookupSnapshot* Logger::AcquireChannelLookupSnapshot()
+{
+  for (;;)
+  {
+    while (ChannelLookupSnapshotReclamation.load())
+      std::this_thread::yield();
+
+    ChannelLookupSnapshotReaders.fetch_add(1);
+
+    if (ChannelLookupSnapshotReclamation.load() == false)
+      return ActiveChannelLookupSnapshot.load(std::memory_order_acquire);
+
+    ChannelLookupSnapshotReaders.fetch_sub(1);
+  }
+}
+
+void Logger::ReleaseChannelLookupSnapshot()
+{
+  ChannelLookupSnapshotReaders.fetch_sub(1);
+}
+
+void Logger::PublishChannelLookupSnapshot()
+{
+  // Must be called with DataLock held
+
+  if (Channels.empty())
+  {
+    ActiveChannelLookupSnapshot.store(nullptr, std::memory_order_release);
+  }
+  else
+  {
+    size_t size = 8;
+    while (size < Channels.size() * 2)
+      size *= 2;
+
+    auto snapshot = std::make_unique<ChannelLookupSnapshot>();
+    snapshot->Slots.resize(size);
+    snapshot->Mask = size - 1;
+
+    for (const auto& [name, channel] : Channels)
+    {
+      uint64_t hash = HashChannelName(name.c_str());
+
+      size_t i = hash & snapshot->Mask;
+      while (snapshot->Slots[i].Object)
+        i = (i + 1) & snapshot->Mask;
+
+      auto& slot = snapshot->Slots[i];
+      slot.Hash = hash;
+      slot.Name = name;
+      slot.Object = channel;
+    }
+
+    const auto* active = snapshot.get();
+    ChannelLookupSnapshots.push_back(std::move(snapshot));
+    ActiveChannelLookupSnapshot.store(active, std::memory_order_release);
+  }
+
+  ChannelGeneration.fetch_add(1, std::memory_order_release);
+  ReclaimChannelLookupSnapshots();
+}
+
+void Logger::ReclaimChannelLookupSnapshots()
+{
+  // Lookups hold the reader count only while probing the table, so old
+  // snapshots are released right away. This also drops references to
+  // deleted channels.
+
+  const auto* active =
+    ActiveChannelLookupSnapshot.load(std::memory_order_acquire);
+
+  size_t keep = active ? 1 : 0;
+  if (ChannelLookupSnapshots.size() <= keep)
+    return;
+
+  ChannelLookupSnapshotReclamation.store(true);
+
+  while (ChannelLookupSnapshotReaders.load() != 0)
+    std::this_thread::yield();
+
+  std::vector<std::unique_ptr<ChannelLookupSnapshot>> retired;
+  retired.swap(ChannelLookupSnapshots);
+
+  if (active)
+  {
+    ChannelLookupSnapshots.push_back(std::move(retired.back()));
+    retired.pop_back();
+  }
+
+  ChannelLookupSnapshotReclamation.store(false);
+}
+
+ChannelPtr Logger::FindChannel(const char* name)
+{
+  if (ActiveChannelLookupSnapshot.load(std::memory_order_acquire) == nullptr)
+    return ChannelPtr();
+
+  uint64_t hash = HashChannelName(name);
+  ChannelPtr channel;
+
+  const auto* snapshot = AcquireChannelLookupSnapshot();
+  if (snapshot != nullptr)
+  {
+    for (size_t i = hash & snapshot->Mask;; i = (i + 1) & snapshot->Mask)
+    {
+      const auto& slot = snapshot->Slots[i];
+      if (!slot.Object)
+        break;
+
+      if (slot.Hash == hash && slot.Name == name)
+      {
+        channel = slot.Object;
+        break;
+      }
+    }
+  }
+
+  ReleaseChannelLookupSnapshot();
+  return channel;
+}
+
+Channel* Logger::ResolveChannel(Context& context)
+{
+  if (context.Ch)
+    return context.Ch;
+
+  const ID& id = *context.Channel;
+  if (id.Name == nullptr || *id.Name == '\0')
+    return Default.get();
+
+  ContextCache& cache = context.Cache;
+  uint64_t generation = ChannelGeneration.load(std::memory_order_acquire);
+
+  if (cache.ChannelGeneration.load(std::memory_order_acquire) == generation)
+  {
+    const char* name = cache.ChannelName.load(std::memory_order_relaxed);
+    Channel* ch = cache.ChannelObject.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // Name check keeps the result correct when one call site is used with
+    // different IDs or when a concurrent update is observed half-written.
+    if (
+         cache.ChannelGeneration.load(std::memory_order_relaxed) == generation
+      && ch != nullptr
+      && name == id.Name
+      && *ch == id.Name
+    )
+    {
+      return ch;
+    }
+  }
+
+  ChannelPtr channel = GetChannel(id);
+  if (channel == nullptr)
+    return nullptr;
+
+  uint64_t cached = cache.ChannelGeneration.load(std::memory_order_relaxed);
+  if (
+       cached != ContextCache::CHANNEL_CACHE_BUSY
+    && cache.ChannelGeneration.compare_exchange_strong(
+         cached
+         , ContextCache::CHANNEL_CACHE_BUSY
+         , std::memory_order_acquire
+       )
+  )
+  {
+    cache.ChannelName.store(id.Name, std::memory_order_relaxed);
+    cache.ChannelObject.store(channel.get(), std::memory_order_relaxed);
+    cache.ChannelGeneration.store(generation, std::memory_order_release);
+  }
+
+  return channel.get();
+}
+
 ChannelPtr Logger::GetExistingChannel(const ID& id)
 {
   if (id.Name == nullptr || *id.Name == '\0')
     return Default;
 
-  std::lock_guard guard(DataLock);
+  return FindChannel(id.Name);
+}
 
-  auto it = Channels.find(id.Name);
-  if (it != Channels.end())
-    return it->second;
+#ifndef LOGME_DISABLE_STD_FORMAT
+namespace
+{
+#ifndef LOGME_USE_FMT_FORMAT
+  // std::vformat_to has no _n form: this iterator drops characters past the
+  // end of the buffer but keeps counting them
+  struct TruncatingOutput
+  {
+    using iterator_category = std::output_iterator_tag;
+    using value_type = void;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = void;
+
+    char* Pos;
+    char* End;
+    size_t Count;
 
-  return ChannelPtr();
+    TruncatingOutput& operator*() { return *this; }
+    TruncatingOutput& operator++() { return *this; }
+    TruncatingOutput& operator++(int) { return *this; }
+
+    TruncatingOutput& operator=(char c)
+    {
+      if (Pos < End)
+        *Pos++ = c;
+
+      Count++;
+      return *this;
+    }
+  };
+#endif
+
+  size_t VFormatToN(
+    char* buffer
+    , size_t size
+    , const char* fmt
+    , LOGME_FORMAT_ARGS args
+  )
+  {
+#ifdef LOGME_USE_FMT_FORMAT
+    return fmt::vformat_to_n(buffer, size, fmt, args).size;
+#else
+    return std::vformat_to(TruncatingOutput{buffer, buffer + size, 0}, fmt, args).Count;
+#endif
+  }
 }
 
+bool Logger::ShouldSkipStdFormatID(
+  const Context& context
+  , const ID* id
+  , const SID* sid
+)
+{
+  if (context.ErrorLevel >= Level::LEVEL_ERROR)
+    return false;
+
+  if (id == nullptr)
+    id = HasThreadChannel ? (const ID*)&CurrentThreadChannel : context.Channel;
+
+  if (id == nullptr)
+    return false;
+
+  ChannelPtr ch = GetExistingChannel(*id);
+  return ShouldSkipStdFormatChannel(context, ch.get(), sid);
+}
+
+const char* Logger::FormatStd(
+  const Context& context
+  , char* buffer
+  , size_t size
+  , const char* fmt
+  , LOGME_FORMAT_ARGS args
+)
+{
+  Context& context2 = *(Context*)&context;
+  ContextCache& cache = context2.Cache;
+
+  // Call sites that overflowed the stack buffer before go straight to
+  // storage of the remembered size
+  size_t hint = cache.StdFormatSizeHint.load(std::memory_order_relaxed);
+  if (hint > size)
+  {
+    std::string& storage = context2.GetCold().Storage;
+    storage.resize(hint);
+    buffer = storage.data();
+    size = hint;
+  }
+
+  size_t len = VFormatToN(buffer, size - 1, fmt, args);
+  if (len >= size)
+  {
+    // Reserve a few bytes for text appended in place by Context::Apply()
+    size = len + 16;
+    if (size <= UINT32_MAX && size > hint)
+      cache.StdFormatSizeHint.store(uint32_t(size), std::memory_order_relaxed);
+
+    std::string& storage = context2.GetCold().Storage;
+    storage.resize(size);
+    buffer = storage.data();
+
+    len = VFormatToN(buffer, size - 1, fmt, args);
+  }
+
+  buffer[len] = '\0';
+  context2.SetBuffer(buffer, len, size);
+  return buffer;
+}
+#endif
+
 ChannelPtr Logger::GetChannel(const ID& id)
 {
   ChannelPtr v = GetExistingChannel(id);
@@ -510,6 +826,7 @@ void Logger::Autodelete(const ID& id)
   {
     ChannelPtr ch = it->second;
     Channels.erase(it);
+    PublishChannelLookupSnapshot();
 
     ch->Freeze();
     ToDelete.push_back(ch);
@@ -530,6 +847,7 @@ void Logger::DeleteChannel(const ID& id)
     {
       ch = it->second;
       Channels.erase(it);
+      PublishChannelLookupSnapshot();
     }
 
   } while (false);
@@ -600,6 +918,7 @@ ChannelPtr Logger::CreateChannelInternal(
 
   ChannelPtr channel = std::make_shared<Channel>(this, id.Name, flags, level);
   Channels[id.Name] = channel;
+  PublishChannelLookupSnapshot();
 
   return channel;
 }
@@ -634,6 +953,7 @@ void Logger::AddBlockedSubsystem(const SID& sid)
 
   std::lock_guard guard(DataLock);
   AddSubsystemToList(BlockedSubsystems, sid.Name);
+  PublishSubsystemFilterSnapshot();
 }
 
 void Logger::RemoveBlockedSubsystem(const SID& sid)
@@ -643,6 +963,7 @@ void Logger::RemoveBlockedSubsystem(const SID& sid)
 
   std::lock_guard guard(DataLock);
   RemoveSubsystemFromList(BlockedSubsystems, sid.Name);
+  PublishSubsystemFilterSnapshot();
 }
 
 void Logger::AddAllowedSubsystem(const SID& sid)
@@ -655,6 +976,7 @@ void Logger::AddAllowedSubsystem(const SID& sid)
 
   std::lock_guard guard(DataLock);
   AddSubsystemToList(AllowedSubsystems, sid.Name);
+  PublishSubsystemFilterSnapshot();
 }
 
 void Logger::RemoveAllowedSubsystem(const SID& sid)
@@ -664,18 +986,21 @@ void Logger::RemoveAllowedSubsystem(const SID& sid)
 
   std::lock_guard guard(DataLock);
   RemoveSubsystemFromList(AllowedSubsystems, sid.Name);
+  PublishSubsystemFilterSnapshot();
 }
 
 void Logger::ClearBlockedSubsystems()
 {
   std::lock_guard guard(DataLock);
   BlockedSubsystems.clear();
+  PublishSubsystemFilterSnapshot();
 }
 
 void Logger::ClearAllowedSubsystems()
 {
   std::lock_guard guard(DataLock);
   AllowedSubsystems.clear();
+  PublishSubsystemFilterSnapshot();
 }
 
 void Logger::ClearSubsystemFilters()
@@ -684,6 +1009,121 @@ void Logger::ClearSubsystemFilters()
   BlockedSubsystems.clear();
   AllowedSubsystems.clear();
   Subsystems.clear();
+  PublishSubsystemFilterSnapshot();
+}
+
+const Logger::SubsystemFilterSnapshot* Logger::AcquireSubsystemFilterSnapshot(
+  bool& readerAcquired
+)
+{
+  readerAcquired = false;
+
+  if (
+    ActiveSubsystemFilterSnapshot.load(std::memory_order_acquire) == nullptr
+  )
+  {
+    return nullptr;
+  }
+
+  for (;;)
+  {
+    while (SubsystemFilterSnapshotReclamation.load())
+      std::this_thread::yield();
+
+    SubsystemFilterSnapshotReaders.fetch_add(1);
+
+    if (SubsystemFilterSnapshotReclamation.load() == false)
+    {
+      readerAcquired = true;
+      return ActiveSubsystemFilterSnapshot.load(std::memory_order_acquire);
+    }
+
+    SubsystemFilterSnapshotReaders.fetch_sub(1);
+  }
+}
+
+void Logger::ReleaseSubsystemFilterSnapshot()
+{
+  SubsystemFilterSnapshotReaders.fetch_sub(1);
+}
+
+void Logger::PublishSubsystemFilterSnapshot()
+{
+  if (BlockedSubsystems.empty() && AllowedSubsystems.empty())
+  {
+    ActiveSubsystemFilterSnapshot.store(nullptr, std::memory_order_release);
+  }
+  else
+  {
+    auto snapshot = std::make_unique<SubsystemFilterSnapshot>();
+    snapshot->Blocked = BlockedSubsystems;
+    snapshot->Allowed = AllowedSubsystems;
+
+    const auto* active = snapshot.get();
+    SubsystemFilterSnapshots.push_back(std::move(snapshot));
+    ActiveSubsystemFilterSnapshot.store(active, std::memory_order_release);
+  }
+
+  ReclaimSubsystemFilterSnapshots();
+}
+
+void Logger::ReclaimSubsystemFilterSnapshots()
+{
+  if (
+    SubsystemFilterSnapshots.size()
+    <= SUBSYSTEM_FILTER_SNAPSHOT_LIMIT
+  )
+  {
+    return;
+  }
+
+  SubsystemFilterSnapshotReclamation.store(true);
+
+  while (SubsystemFilterSnapshotReaders.load() != 0)
+  {
+    std::this_thread::yield();
+  }
+
+  const auto* active =
+    ActiveSubsystemFilterSnapshot.load(std::memory_order_acquire);
+
+  if (active == nullptr)
+  {
+    SubsystemFilterSnapshots.clear();
+  }
+  else
+  {
+    auto activeSnapshot = std::move(SubsystemFilterSnapshots.back());
+    SubsystemFilterSnapshots.clear();
+    SubsystemFilterSnapshots.push_back(std::move(activeSnapshot));
+  }
+
+  SubsystemFilterSnapshotReclamation.store(false);
+}
+
+bool Logger::IsSubsystemFiltered(uint64_t subsystem)
+{
+  bool readerAcquired = false;
+  const auto* snapshot = AcquireSubsystemFilterSnapshot(readerAcquired);
+  bool filtered = false;
+
+  if (snapshot != nullptr)
+  {
+    if (std::binary_search(snapshot->Blocked.begin(), snapshot->Blocked.end(), subsystem))
+      filtered = true;
+    else if (
+         snapshot->Allowed.empty() == false
+      && std::binary_search(snapshot->Allowed.begin(), snapshot->Allowed.end(), subsystem) == false
+    )
+    {
+      filtered = true;
+    }
+  }
+
+  if (readerAcquired)
+    ReleaseSubsystemFilterSnapshot();
+
+  return filtered;
 }
 
 const Logger::SubsystemLevelSnapshot* Logger::AcquireSubsystemLevelSnapshot(
@@ -886,6 +1326,8 @@ void Logger::SetBlockReportedSubsystems(bool block)
     else
       AddSubsystemToList(AllowedSubsystems, id);
   }
+
+  PublishSubsystemFilterSnapshot();
 }
 
 void Logger::ReportSubsystem(const SID& sid)
@@ -903,6 +1345,8 @@ void Logger::ReportSubsystem(const SID& sid)
     AddSubsystemToList(BlockedSubsystems, sid.Name);
   else
     AddSubsystemToList(AllowedSubsystems, sid.Name);
+
+  PublishSubsystemFilterSnapshot();
 }
 
 void Logger::UnreportSubsystem(const SID& sid)
@@ -917,6 +1361,8 @@ void Logger::UnreportSubsystem(const SID& sid)
     RemoveSubsystemFromList(BlockedSubsystems, sid.Name);
   else
     RemoveSubsystemFromList(AllowedSubsystems, sid.Name);
+
+  PublishSubsystemFilterSnapshot();
 }
 
 Stream Logger::Log(const Context& context) // @1
@@ -1408,46 +1854,66 @@ void Logger::Log(const Context& context, const char* format, ...)
   va_end(args);
 }
 
-void Logger::DoLog(Context& context, const char* format, va_list args)
+bool Logger::TryDisplayDeferred(
+  Context& context
+  , Channel* ch
+  , const char* format
+  , va_list args
+)
 {
-  DoAutodelete(false);
+  // Records that need the text on this thread (collapse, statistics,
+  // Output copy, error channel, AppendProc, override shortener) and the
+  // already formatted "%s" path of StdFormat overloads are not deferred
+  if (
+       ch->IsDeferredFormatEnabled() == false
+    || context.ErrorLevel >= Level::LEVEL_ERROR
+    || context.CollapseCache
+    || context.Output
+    || context.AppendProc
+    || (context.Ovr && context.Ovr->Shortener)
+    || context.TempBuffer
+    || ActiveLogStatistics.load(std::memory_order_relaxed) != nullptr
+    || (format[0] == '%' && format[1] == 's' && format[2] == '\0')
+  )
+    return false;
 
-  if (ShutdownCalled)
-    return;
+  char* data = (char*)alloca(DEFERRED_ARGS_SIZE);
+  size_t used = 0;
 
-  if (context.Ovr && context.Ovr->MaxFrequency)
-  {
-    auto ticks = GetTimeInMillisec64();
+  va_list copy;
+  va_copy(copy, args);
+  bool captured = CaptureDeferredArgs(format, copy, data, DEFERRED_ARGS_SIZE, &used);
+  va_end(copy);
 
-    std::lock_guard guard(DataLock);
-    if (context.Ovr->LastTime && ticks - context.Ovr->LastTime < context.Ovr->MaxFrequency)
-      return;
+  if (!captured)
+    return false;
 
-    context.Ovr->LastTime = ticks;
-  }
+  context.SetDeferred(format, data, used);
+  ch->Display(context);
+  return true;
+}
 
-  if (context.Ovr && context.Ovr->MaxRepetitions != -1)
-  {
-    std::lock_guard guard(DataLock);
-    if (context.Ovr->Repetitions >= context.Ovr->MaxRepetitions)
-      return;
+void Logger::DoLog(Context& context, const char* format, va_list args)
+{
+  DoAutodelete(false);
 
-    context.Ovr->Repetitions++;
-  }
+  if (ShutdownCalled)
+    return;
 
-  if (context.Subsystem.Name)
+  if (
+       context.Ovr
+    && (context.Ovr->MaxFrequency || context.Ovr->MaxRepetitions != -1)
+  )
   {
-    std::lock_guard guard(DataLock);
-
-    if (std::binary_search(BlockedSubsystems.begin(), BlockedSubsystems.end(), context.Subsystem.Name))
-      return;
-
-    if (AllowedSubsystems.empty() == false
-        && std::binary_search(AllowedSubsystems.begin(), AllowedSubsystems.end(), context.Subsystem.Name) == false)
+    auto ticks = context.Ovr->MaxFrequency ? GetTimeInMillisec64() : 0;
+    if (context.Ovr->TryAcquire(ticks) == false)
       return;
   }
 
-  Channel* ch = context.Ch ? context.Ch : GetChannel(*context.Channel).get();
+  if (context.Subsystem.Name && IsSubsystemFiltered(context.Subsystem.Name))
+    return;
+
+  Channel* ch = ResolveChannel(context);
   if (ch == nullptr)
     return;
 
@@ -1463,11 +1929,26 @@ void Logger::DoLog(Context& context, const char* format, va_list args)
 
   if (format)
   {
+    if (TryDisplayDeferred(context, ch, format, args))
+      return;
+
+    uint64_t timingStarted = 0;
+    if (
+         LogStatisticsTiming.load(std::memory_order_relaxed)
+      && ActiveLogStatistics.load(std::memory_order_relaxed) != nullptr
+    )
+    {
+      timingStarted = ReadTimingTicks();
+    }
+
     char* buffer = nullptr;
     if (format[0] == '%' && format[1] == 's' && format[2] == '\0')
     { 
       buffer = va_arg(args, char*);
-      context.SetText(buffer);
+
+      // StdFormat overloads have already published the text with SetBuffer()
+      if (context.TempBuffer != buffer)
+        context.SetText(buffer);
     }
     else
     {
@@ -1506,6 +1987,8 @@ void Logger::DoLog(Context& context, const char* format, va_list args)
       context.SetBuffer(buffer, bufferLen, size);
     }
 
+    uint64_t formatTicks = timingStarted ? ReadTimingTicks() - timingStarted : 0;
+
     if (context.CollapseCache)
     {
       if (context.ApplyCollapse() == false)
@@ -1523,12 +2006,15 @@ void Logger::DoLog(Context& context, const char* format, va_list args)
 
       if (ActiveLogStatistics.load(std::memory_order_acquire) == statistics)
       {
-        statistics->Record(
+        LogSiteStatistics* site = statistics->Record(
           context
           , ch
           , format
           , context.TempBufferSize
         );
+
+        if (timingStarted)
+          context.TimedSite = site;
       }
 
       statistics->Leave();
@@ -1536,6 +2022,19 @@ void Logger::DoLog(Context& context, const char* format, va_list args)
 
     ch->Display(context);
 
+    if (context.TimedSite)
+    {
+      LogSiteStatistics* site = context.TimedSite;
+      context.TimedSite = nullptr;
+
+      RecordLogTiming(
+        site
+        , formatTicks
+        , context.ApplyTicks
+        , ReadTimingTicks() - timingStarted
+      );
+    }
+
     if (context.ErrorLevel >= Level::LEVEL_ERROR)
     {
       StringPtr errorChannel = GetErrorChannel();
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <cstring>
 #include <string.h>
 #include <time.h>
@@ -6,6 +7,23 @@
 #include <Logme/Logme.h>
 #include <Logme/Obfuscate.h>
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LOGOBF_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define LOGOBF_X86 0
+#endif
+
+// MSVC emits any intrinsic without per-function target options
+#if defined(_MSC_VER) && !defined(__clang__)
+#define LOGOBF_TARGET(isa)
+#else
+#define LOGOBF_TARGET(isa) __attribute__((target(isa)))
+#endif
+
 #if LOGME_ACTIVE
 static const char* ErrnoText(int e)
 {
@@ -119,16 +137,13 @@ static void QuarterRound(
   *b = Rotl32(*b, 7);
 }
 
-static void ChaCha20Block(
-  const uint8_t key[32]
+static void ChaCha20Init(
+  uint32_t state[16]
+  , const uint8_t key[32]
   , uint32_t counter
   , const uint8_t nonce[12]
-  , uint8_t out[64]
 )
 {
-  uint32_t state[16]{};
-  uint32_t work[16]{};
-
   state[0]  = 0x61707865u;
   state[1]  = 0x3320646eu;
   state[2]  = 0x79622d32u;
@@ -147,8 +162,16 @@ static void ChaCha20Block(
   state[13] = LoadLe32(nonce + 0);
   state[14] = LoadLe32(nonce + 4);
   state[15] = LoadLe32(nonce + 8);
+}
 
-  memcpy(work, state, sizeof(state));
+static void ChaCha20Block(
+  const uint32_t state[16]
+  , uint8_t out[64]
+)
+{
+  uint32_t work[16]{};
+
+  memcpy(work, state, sizeof(work));
 
   for (int i = 0; i < 10; i++)
   {
@@ -169,6 +192,247 @@ static void ChaCha20Block(
   }
 }
 
+#if LOGOBF_X86
+/*
+ * Multi-block kernels: word i of N consecutive blocks lives in lane j of
+ * vector x[i], so one instruction advances all blocks. Counters of the blocks
+ * are state[12] + j (wrapping like the scalar code). After the rounds the
+ * words are transposed back to block order and XORed with the input.
+ */
+
+#define SSE2_ROTL(v, r) \
+  _mm_or_si128(_mm_slli_epi32(v, r), _mm_srli_epi32(v, 32 - (r)))
+
+#define SSE2_QR(a, b, c, d) \
+  a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = SSE2_ROTL(d, 16); \
+  c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = SSE2_ROTL(b, 12); \
+  a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = SSE2_ROTL(d, 8); \
+  c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = SSE2_ROTL(b, 7)
+
+LOGOBF_TARGET("sse2")
+static void ChaCha20Xor4Sse2(
+  const uint32_t state[16]
+  , const uint8_t* in
+  , uint8_t* out
+)
+{
+  __m128i s[16];
+  __m128i x[16];
+
+  for (int i = 0; i < 16; i++)
+    s[i] = _mm_set1_epi32((int)state[i]);
+
+  s[12] = _mm_add_epi32(s[12], _mm_set_epi32(3, 2, 1, 0));
+
+  for (int i = 0; i < 16; i++)
+    x[i] = s[i];
+
+  for (int i = 0; i < 10; i++)
+  {
+    SSE2_QR(x[0], x[4], x[8],  x[12]);
+    SSE2_QR(x[1], x[5], x[9],  x[13]);
+    SSE2_QR(x[2], x[6], x[10], x[14]);
+    SSE2_QR(x[3], x[7], x[11], x[15]);
+
+    SSE2_QR(x[0], x[5], x[10], x[15]);
+    SSE2_QR(x[1], x[6], x[11], x[12]);
+    SSE2_QR(x[2], x[7], x[8],  x[13]);
+    SSE2_QR(x[3], x[4], x[9],  x[14]);
+  }
+
+  for (int i = 0; i < 16; i++)
+    x[i] = _mm_add_epi32(x[i], s[i]);
+
+  for (int g = 0; g < 4; g++)
+  {
+    __m128i t0 = _mm_unpacklo_epi32(x[4 * g + 0], x[4 * g + 1]);
+    __m128i t1 = _mm_unpacklo_epi32(x[4 * g + 2], x[4 * g + 3]);
+    __m128i t2 = _mm_unpackhi_epi32(x[4 * g + 0], x[4 * g + 1]);
+    __m128i t3 = _mm_unpackhi_epi32(x[4 * g + 2], x[4 * g + 3]);
+
+    __m128i b[4];
+    b[0] = _mm_unpacklo_epi64(t0, t1);
+    b[1] = _mm_unpackhi_epi64(t0, t1);
+    b[2] = _mm_unpacklo_epi64(t2, t3);
+    b[3] = _mm_unpackhi_epi64(t2, t3);
+
+    for (int j = 0; j < 4; j++)
+    {
+      size_t pos = (size_t)j * 64 + (size_t)g * 16;
+      __m128i v = _mm_loadu_si128((const __m128i*)(in + pos));
+      _mm_storeu_si128((__m128i*)(out + pos), _mm_xor_si128(v, b[j]));
+    }
+  }
+}
+
+#define AVX2_ROTL(v, r) \
+  _mm256_or_si256(_mm256_slli_epi32(v, r), _mm256_srli_epi32(v, 32 - (r)))
+
+#define AVX2_QR(a, b, c, d) \
+  a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = _mm256_shuffle_epi8(d, rot16); \
+  c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = AVX2_ROTL(b, 12); \
+  a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = _mm256_shuffle_epi8(d, rot8); \
+  c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = AVX2_ROTL(b, 7)
+
+LOGOBF_TARGET("avx2")
+static void ChaCha20Xor8Avx2(
+  const uint32_t state[16]
+  , const uint8_t* in
+  , uint8_t* out
+)
+{
+  // Rotations by 16 and 8 bits are byte shuffles
+  const __m256i rot16 = _mm256_setr_epi8(
+    2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13
+    , 2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13
+  );
+  const __m256i rot8 = _mm256_setr_epi8(
+    3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14
+    , 3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14
+  );
+
+  __m256i s[16];
+  __m256i x[16];
+
+  for (int i = 0; i < 16; i++)
+    s[i] = _mm256_set1_epi32((int)state[i]);
+
+  s[12] = _mm256_add_epi32(s[12], _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+  for (int i = 0; i < 16; i++)
+    x[i] = s[i];
+
+  for (int i = 0; i < 10; i++)
+  {
+    AVX2_QR(x[0], x[4], x[8],  x[12]);
+    AVX2_QR(x[1], x[5], x[9],  x[13]);
+    AVX2_QR(x[2], x[6], x[10], x[14]);
+    AVX2_QR(x[3], x[7], x[11], x[15]);
+
+    AVX2_QR(x[0], x[5], x[10], x[15]);
+    AVX2_QR(x[1], x[6], x[11], x[12]);
+    AVX2_QR(x[2], x[7], x[8],  x[13]);
+    AVX2_QR(x[3], x[4], x[9],  x[14]);
+  }
+
+  for (int i = 0; i < 16; i++)
+    x[i] = _mm256_add_epi32(x[i], s[i]);
+
+  // Transposing within 128-bit lanes gives, for word group g and j < 4,
+  // b[g][j] = { block j words 4g..4g+3 | block j + 4 words 4g..4g+3 }
+  __m256i b[4][4];
+  for (int g = 0; g < 4; g++)
+  {
+    __m256i t0 = _mm256_unpacklo_epi32(x[4 * g + 0], x[4 * g + 1]);
+    __m256i t1 = _mm256_unpacklo_epi32(x[4 * g + 2], x[4 * g + 3]);
+    __m256i t2 = _mm256_unpackhi_epi32(x[4 * g + 0], x[4 * g + 1]);
+    __m256i t3 = _mm256_unpackhi_epi32(x[4 * g + 2], x[4 * g + 3]);
+
+    b[g][0] = _mm256_unpacklo_epi64(t0, t1);
+    b[g][1] = _mm256_unpackhi_epi64(t0, t1);
+    b[g][2] = _mm256_unpacklo_epi64(t2, t3);
+    b[g][3] = _mm256_unpackhi_epi64(t2, t3);
+  }
+
+  for (int j = 0; j < 4; j++)
+  {
+    __m256i k[4];
+    k[0] = _mm256_permute2x128_si256(b[0][j], b[1][j], 0x20);
+    k[1] = _mm256_permute2x128_si256(b[2][j], b[3][j], 0x20);
+    k[2] = _mm256_permute2x128_si256(b[0][j], b[1][j], 0x31);
+    k[3] = _mm256_permute2x128_si256(b[2][j], b[3][j], 0x31);
+
+    size_t pos[4] = {
+      (size_t)j * 64
+      , (size_t)j * 64 + 32
+      , (size_t)(j + 4) * 64
+      , (size_t)(j + 4) * 64 + 32
+    };
+
+    for (int i = 0; i < 4; i++)
+    {
+      __m256i v = _mm256_loadu_si256((const __m256i*)(in + pos[i]));
+      _mm256_storeu_si256((__m256i*)(out + pos[i]), _mm256_xor_si256(v, k[i]));
+    }
+  }
+}
+
+static bool CpuSupports(ObfKernel kernel)
+{
+  if (kernel == LOGOBF_KERNEL_SCALAR)
+    return true;
+
+#if defined(_MSC_VER) && !defined(__clang__)
+  int r[4];
+  __cpuid(r, 0);
+  int maxLeaf = r[0];
+
+  __cpuid(r, 1);
+  if (kernel == LOGOBF_KERNEL_SSE2)
+    return (r[3] & (1 << 26)) != 0;
+
+  // AVX2 also needs the OS to save YMM registers
+  if ((r[2] & (1 << 27)) == 0 || (r[2] & (1 << 28)) == 0)
+    return false;
+
+  if ((_xgetbv(0) & 6) != 6 || maxLeaf < 7)
+    return false;
+
+  __cpuidex(r, 7, 0);
+  return (r[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+
+  if (kernel == LOGOBF_KERNEL_SSE2)
+    return __builtin_cpu_supports("sse2");
+
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#else
+static bool CpuSupports(ObfKernel kernel)
+{
+  return kernel == LOGOBF_KERNEL_SCALAR;
+}
+#endif
+
+static ObfKernel DetectKernel()
+{
+  if (CpuSupports(LOGOBF_KERNEL_AVX2))
+    return LOGOBF_KERNEL_AVX2;
+
+  if (CpuSupports(LOGOBF_KERNEL_SSE2))
+    return LOGOBF_KERNEL_SSE2;
+
+  return LOGOBF_KERNEL_SCALAR;
+}
+
+static std::atomic<int> ActiveKernel(LOGOBF_KERNEL_AUTO);
+
+static ObfKernel GetActiveKernel()
+{
+  int kernel = ActiveKernel.load(std::memory_order_relaxed);
+  if (kernel != LOGOBF_KERNEL_AUTO)
+    return (ObfKernel)kernel;
+
+  static const ObfKernel detected = DetectKernel();
+  return detected;
+}
+
+int ObfSetKernel(ObfKernel kernel)
+{
+  if (kernel != LOGOBF_KERNEL_AUTO && !CpuSupports(kernel))
+    return 0;
+
+  ActiveKernel.store(kernel, std::memory_order_relaxed);
+  return 1;
+}
+
+ObfKernel ObfGetKernel(void)
+{
+  return GetActiveKernel();
+}
+
 static void ChaCha20Xor(
   const uint8_t key[32]
   , const uint8_t nonce[12]
@@ -178,11 +442,41 @@ static void ChaCha20Xor(
   , size_t len
 )
 {
+  uint32_t state[16];
+  ChaCha20Init(state, key, counter, nonce);
+
+#if LOGOBF_X86
+  ObfKernel kernel = GetActiveKernel();
+
+  if (kernel == LOGOBF_KERNEL_AVX2)
+  {
+    for (; len >= 8 * 64; len -= 8 * 64)
+    {
+      ChaCha20Xor8Avx2(state, in, out);
+      state[12] += 8;
+      in += 8 * 64;
+      out += 8 * 64;
+    }
+  }
+
+  if (kernel == LOGOBF_KERNEL_AVX2 || kernel == LOGOBF_KERNEL_SSE2)
+  {
+    for (; len >= 4 * 64; len -= 4 * 64)
+    {
+      ChaCha20Xor4Sse2(state, in, out);
+      state[12] += 4;
+      in += 4 * 64;
+      out += 4 * 64;
+    }
+  }
+#endif
+
   uint8_t block[64];
 
   while (len != 0)
   {
-    ChaCha20Block(key, counter++, nonce, block);
+    ChaCha20Block(state, block);
+    state[12]++;
 
     size_t n = (len > 64) ? 64 : len;
     for (size_t i = 0; i < n; i++)
@@ -196,6 +490,7 @@ static void ChaCha20Xor(
   }
 
   memset(block, 0, sizeof(block));
+  memset(state, 0, sizeof(state));
 }
 
 int ObfEncryptRecord(
@@ -240,6 +535,39 @@ int ObfEncryptRecord(
   return 1;
 }
 
+int ObfEncryptRecordInPlace(
+  const ObfKey* key
+  , NonceGen* nonceGen
+  , uint8_t* data
+  , size_t len
+  , uint8_t header[LOGOBF_HEADER_BYTES]
+)
+{
+  if (key == NULL || nonceGen == NULL || header == NULL || (data == NULL && len != 0))
+    return 0;
+
+  if (len > 0xffffu)
+    return 0;
+
+  uint8_t* nonce = header + 4;
+
+  StoreLe16(header + 0, LOGOBF_SIGNATURE);
+  StoreLe16(header + 2, (uint16_t)len);
+
+  NonceGenNext(nonceGen, nonce);
+
+  ChaCha20Xor(
+    key->Bytes
+    , nonce
+    , 1
+    , data
+    , data
+    , len
+  );
+
+  return 1;
+}
+
 int ObfDecryptRecord(
   const ObfKey* key
   , const uint8_t* record
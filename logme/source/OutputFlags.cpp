@@ -131,6 +131,17 @@ std::string OutputFlags::TimestampType() const
   }
 }
 
+std::string OutputFlags::TimestampPrecisionType() const
+{
+  switch (TimestampPrecision)
+  {
+  case TIME_PRECISION_MILLISECONDS: return "ms";
+  case TIME_PRECISION_MICROSECONDS: return "us";
+  case TIME_PRECISION_NANOSECONDS: return "ns";
+  default: return "Unknown";
+  }
+}
+
 std::string OutputFlags::LocationType() const
 {
   Detality det = (Detality)Location;
@@ -171,6 +182,7 @@ std::string OutputFlags::ToString(const char* separator, bool brackets) const
   std::vector<std::string> flags;
 
   APPEND_FLAG(Timestamp, [this]() {return TimestampType(); });
+  APPEND_FLAG(TimestampPrecision, [this]() {return TimestampPrecisionType(); });
   APPEND_FLAG(Signature);
   APPEND_FLAG(Location, [this]() {return LocationType(); });
   APPEND_FLAG(Method);
@@ -16,6 +16,64 @@ Override::Override(int reps, uint64_t noMoreThanOnceEveryXMillisec)
   Shortener = nullptr;
 }
 
+Override::Override(const Override& other)
+  : Add(other.Add)
+  , Remove(other.Remove)
+  , MaxRepetitions(other.MaxRepetitions)
+  , Repetitions(other.Repetitions.load(std::memory_order_relaxed))
+  , MaxFrequency(other.MaxFrequency)
+  , LastTime(other.LastTime.load(std::memory_order_relaxed))
+  , Shortener(other.Shortener)
+{
+}
+
+Override& Override::operator=(const Override& other)
+{
+  Add = other.Add;
+  Remove = other.Remove;
+
+  MaxRepetitions = other.MaxRepetitions;
+  Repetitions.store(other.Repetitions.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+  MaxFrequency = other.MaxFrequency;
+  LastTime.store(other.LastTime.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+  Shortener = other.Shortener;
+  return *this;
+}
+
+bool Override::TryAcquire(uint64_t ticks)
+{
+  if (MaxFrequency)
+  {
+    uint64_t last = LastTime.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      // A newer timestamp stored by another thread means that thread won the slot
+      if (last && (ticks < last || ticks - last < MaxFrequency))
+        return false;
+
+      if (LastTime.compare_exchange_weak(last, ticks, std::memory_order_relaxed))
+        break;
+    }
+  }
+
+  if (MaxRepetitions != -1)
+  {
+    int reps = Repetitions.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      if (reps >= MaxRepetitions)
+        return false;
+
+      if (Repetitions.compare_exchange_weak(reps, reps + 1, std::memory_order_relaxed))
+        break;
+    }
+  }
+
+  return true;
+}
+
 static uint64_t MakeKey(const char* func, int line)
 {
   uint64_t h = (uint64_t)(uintptr_t)func;
@@ -0,0 +1,145 @@
+#include <Common/TestBackend.h>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <Logme/Logme.h>
+
+namespace
+{
+  std::shared_ptr<TestBackend> AttachBackend(const Logme::ID& id)
+  {
+    auto channel = Logme::Instance->CreateChannel(id);
+    channel->RemoveBackends();
+
+    Logme::OutputFlags flags;
+    flags.Value = 0;
+    channel->SetFlags(flags);
+    channel->SetFilterLevel(Logme::LEVEL_DEBUG);
+
+    auto backend = std::make_shared<TestBackend>(channel);
+    channel->AddBackend(backend);
+    return backend;
+  }
+
+  void LogTo(const Logme::ID& id, const char* text)
+  {
+    // Single call site: its ContextCache holds the resolved channel.
+    LogmeI(id, "%s", text);
+  }
+}
+
+TEST(ChannelLookup, ExistingChannelIsFoundByName)
+{
+  Logme::ID id{ "lookup-existing" };
+  EXPECT_EQ(Logme::Instance->GetExistingChannel(id), nullptr);
+
+  auto channel = Logme::Instance->CreateChannel(id);
+  std::string name = "lookup-existing";
+  EXPECT_EQ(Logme::Instance->GetExistingChannel(Logme::ID{ name.c_str() }), channel);
+
+  Logme::Instance->DeleteChannel(id);
+  EXPECT_EQ(Logme::Instance->GetExistingChannel(id), nullptr);
+}
+
+TEST(ChannelLookup, CallSiteCacheFollowsIdAndRecreatedChannel)
+{
+  Logme::ID first{ "lookup-first" };
+  Logme::ID second{ "lookup-second" };
+
+  auto firstBackend = AttachBackend(first);
+  auto secondBackend = AttachBackend(second);
+
+  LogTo(first, "one");
+  LogTo(second, "two");
+  LogTo(first, "three");
+
+  ASSERT_EQ(firstBackend->History.size(), 2u);
+  EXPECT_EQ(firstBackend->History[0], "one");
+  EXPECT_EQ(firstBackend->History[1], "three");
+  ASSERT_EQ(secondBackend->History.size(), 1u);
+  EXPECT_EQ(secondBackend->History[0], "two");
+
+  Logme::Instance->DeleteChannel(first);
+
+  auto recreatedBackend = AttachBackend(first);
+  LogTo(first, "four");
+
+  EXPECT_EQ(firstBackend->History.size(), 2u);
+  ASSERT_EQ(recreatedBackend->History.size(), 1u);
+  EXPECT_EQ(recreatedBackend->History[0], "four");
+
+  Logme::Instance->DeleteChannel(first);
+  Logme::Instance->DeleteChannel(second);
+}
+
+TEST(ChannelLookup, ReusedNameBufferIsNotConfused)
+{
+  Logme::ID a{ "lookup-a" };
+  Logme::ID b{ "lookup-b" };
+
+  auto aBackend = AttachBackend(a);
+  auto bBackend = AttachBackend(b);
+
+  char name[16];
+  Logme::ID id{ name };
+
+  strcpy(name, "lookup-a");
+  LogTo(id, "to-a");
+
+  strcpy(name, "lookup-b");
+  LogTo(id, "to-b");
+
+  ASSERT_EQ(aBackend->History.size(), 1u);
+  EXPECT_EQ(aBackend->History[0], "to-a");
+  ASSERT_EQ(bBackend->History.size(), 1u);
+  EXPECT_EQ(bBackend->History[0], "to-b");
+
+  Logme::Instance->DeleteChannel(a);
+  Logme::Instance->DeleteChannel(b);
+}
+
+TEST(ChannelLookup, LookupsRaceWithChannelCreation)
+{
+  Logme::ID id{ "lookup-race" };
+  auto channel = Logme::Instance->CreateChannel(id);
+
+  std::atomic<bool> stop{ false };
+  std::atomic<int> misses{ 0 };
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i)
+  {
+    readers.emplace_back([&]()
+    {
+      while (!stop.load(std::memory_order_relaxed))
+      {
+        if (Logme::Instance->GetExistingChannel(id) != channel)
+          misses.fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  }
+
+  std::vector<std::string> names;
+  for (int i = 0; i < 200; ++i)
+    names.push_back("lookup-race-" + std::to_string(i));
+
+  for (auto& name : names)
+    Logme::Instance->CreateChannel(Logme::ID{ name.c_str() });
+
+  for (auto& name : names)
+    Logme::Instance->DeleteChannel(Logme::ID{ name.c_str() });
+
+  stop.store(true);
+  for (auto& t : readers)
+    t.join();
+
+  EXPECT_EQ(misses.load(), 0);
+  Logme::Instance->DeleteChannel(id);
+}
@@ -2,6 +2,7 @@
 
 #include <atomic>
 #include <chrono>
+#include <memory>
 #include <thread>
 
 #include <gtest/gtest.h>
@@ -10,6 +11,44 @@
 
 namespace
 {
+  struct ConcurrentTestBackend : public TestBackend
+  {
+    std::atomic<int> Calls{ 0 };
+
+    ConcurrentTestBackend(Logme::ChannelPtr owner)
+      : TestBackend(owner)
+    {
+    }
+
+    bool IsConcurrentDisplaySupported() const override
+    {
+      return true;
+    }
+
+    void Display(Logme::Context& context) override
+    {
+      Calls.fetch_add(1, std::memory_order_relaxed);
+    }
+  };
+
+  struct BlockingTestBackend : public ConcurrentTestBackend
+  {
+    std::atomic<bool> Entered{ false };
+    std::atomic<bool> Released{ false };
+
+    BlockingTestBackend(Logme::ChannelPtr owner)
+      : ConcurrentTestBackend(owner)
+    {
+    }
+
+    void Display(Logme::Context& context) override
+    {
+      Entered.store(true, std::memory_order_release);
+      while (!Released.load(std::memory_order_acquire))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  };
+
   Logme::ID OutputLockChannelID{ "channel-output-lock" };
   Logme::ChannelPtr OutputLockChannel;
   std::shared_ptr<TestBackend> OutputLockBackend;
@@ -69,6 +108,86 @@ TEST(ChannelOutputLock, BlocksOtherThreadsAndAllowsNestedOutput)
   EXPECT_EQ(OutputLockBackend->History[1], "worker");
 }
 
+TEST(ChannelOutputLock, ConcurrentBackendDoesNotWaitForOutputLock)
+{
+  Logme::ID id{ "channel-output-lock-concurrent" };
+  auto channel = Logme::Instance->CreateChannel(id);
+  channel->RemoveBackends();
+  channel->SetFilterLevel(Logme::LEVEL_DEBUG);
+
+  auto backend = std::make_shared<ConcurrentTestBackend>(channel);
+  channel->AddBackend(backend);
+
+  std::atomic<bool> completed{ false };
+  std::thread worker;
+
+  {
+    auto outputLock = channel->LockOutput();
+
+    worker = std::thread([&completed, id]()
+    {
+      LogmeI(id, "worker");
+      completed.store(true, std::memory_order_release);
+    });
+
+    for (int index = 0; index < 1000 && !completed.load(std::memory_order_acquire); ++index)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    EXPECT_TRUE(completed.load(std::memory_order_acquire));
+  }
+
+  worker.join();
+  EXPECT_EQ(backend->Calls.load(), 1);
+
+  channel->RemoveBackends();
+  LogmeI(id, "after remove");
+  EXPECT_EQ(backend->Calls.load(), 1);
+
+  Logme::Instance->DeleteChannel(id);
+}
+
+TEST(ChannelOutputLock, RemovedBackendIsFreedWhenReadersLeave)
+{
+  Logme::ID id{ "channel-output-lock-reclaim" };
+  auto channel = Logme::Instance->CreateChannel(id);
+  channel->RemoveBackends();
+  channel->SetFilterLevel(Logme::LEVEL_DEBUG);
+
+  auto blocking = std::make_shared<BlockingTestBackend>(channel);
+  channel->AddBackend(blocking);
+
+  std::weak_ptr<ConcurrentTestBackend> removed;
+  std::thread worker;
+  {
+    auto backend = std::make_shared<ConcurrentTestBackend>(channel);
+    removed = backend;
+    channel->AddBackend(backend);
+
+    worker = std::thread([id]()
+    {
+      LogmeI(id, "reader");
+    });
+
+    for (int index = 0; index < 1000 && !blocking->Entered.load(std::memory_order_acquire); ++index)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    EXPECT_TRUE(blocking->Entered.load(std::memory_order_acquire));
+    EXPECT_TRUE(channel->RemoveBackend(backend));
+  }
+
+  // The reader still uses the snapshot that holds the removed backend
+  EXPECT_FALSE(removed.expired());
+
+  blocking->Released.store(true, std::memory_order_release);
+  worker.join();
+
+  // No publication follows: the leaving reader frees the snapshot
+  EXPECT_TRUE(removed.expired());
+
+  channel->RemoveBackends();
+  Logme::Instance->DeleteChannel(id);
+}
+
 int main(int argc, char* argv[])
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -1,5 +1,7 @@
 #include <chrono>
+#include <cstring>
 #include <thread>
+#include <vector>
 
 #include <Common/TestBackend.h>
 
@@ -53,6 +55,33 @@ static void LogEveryKeyB()
   LogmeE_CollapseEvery(5000, "collapse every key B");
 }
 
+static void LogVolatile(const char* request, unsigned handle, int attempt)
+{
+  LogmeE_CollapseIgnore(
+    Logme::CollapseNormalizer::VOLATILE
+    , 2
+    , "collapse volatile request=%s handle=0x%08x attempt %d"
+    , request
+    , handle
+    , attempt
+  );
+}
+
+static void LogKeys(const char* key)
+{
+  LogmeE_CollapseKeys(2, nullptr, 2, "collapse keys %s", key);
+}
+
+static void LogSingleKey(const char* key)
+{
+  LogmeE_CollapseKeys(1, nullptr, 2, "collapse single key %s", key);
+}
+
+static void LogConcurrent()
+{
+  LogmeE_Collapse(10, "collapse concurrent");
+}
+
 static void LogAllLevels(int value)
 {
   LogmeD_Collapse(1, "debug collapse");
@@ -158,6 +187,107 @@ TEST(Collapse, TimeBasedKeyChangeDoesNotFlushPreviousSummary)
   EXPECT_FALSE(Contains(Be->History[1], "repeated"));
 }
 
+TEST(Collapse, DigitsRegexUsesBuiltinNormalizer)
+{
+  Logme::CollapseContextCache cache("\\d+", 2);
+
+  EXPECT_EQ(cache.Normalizer, Logme::CollapseNormalizer::DIGITS);
+  EXPECT_FALSE(cache.IgnoreRegexEnabled);
+  EXPECT_EQ(cache.CalcKeyHash("value=1 of 22", 13), cache.CalcKeyHash("value=333 of 4", 14));
+  EXPECT_NE(cache.CalcKeyHash("value=1 of 22", 13), cache.CalcKeyHash("value=1 in 22", 13));
+
+  Logme::CollapseContextCache regex("[a-z]+", 2);
+  EXPECT_EQ(regex.Normalizer, Logme::CollapseNormalizer::REGEX);
+  EXPECT_TRUE(regex.IgnoreRegexEnabled);
+}
+
+TEST(Collapse, VolatileNormalizerSkipsIdsAndUuids)
+{
+  Logme::CollapseContextCache cache(Logme::CollapseNormalizer::VOLATILE, 2);
+
+  auto hash = [&cache](const char* text) { return cache.CalcKeyHash(text, strlen(text)); };
+
+  EXPECT_EQ(
+    hash("id=0x1f2e uuid=123e4567-e89b-12d3-a456-426614174000 n=7")
+    , hash("id=0xABCDEF01 uuid=00000000-0000-0000-0000-000000000000 n=42")
+  );
+  EXPECT_EQ(hash("session deadbee1 failed"), hash("session 9f00c3 failed"));
+  EXPECT_EQ(hash("retry2 of3"), hash("retry17 of4"));
+  EXPECT_NE(hash("session deadbeef failed"), hash("session cafebabe failed"));
+  EXPECT_NE(hash("connect failed"), hash("connect refused"));
+}
+
+TEST(Collapse, VolatileNormalizerCollapsesMessages)
+{
+  Be->Clear();
+
+  LogVolatile("a1b2c3d4-0000-4000-8000-000000000001", 0x10, 1);
+  LogVolatile("a1b2c3d4-0000-4000-8000-000000000002", 0x20, 2);
+  LogVolatile("a1b2c3d4-0000-4000-8000-000000000003", 0x30, 3);
+
+  ASSERT_EQ(Be->History.size(), 2u);
+  EXPECT_TRUE(Contains(Be->History[0], "handle=0x00000010 attempt 1"));
+  EXPECT_TRUE(Contains(Be->History[1], "repeated 2 times: collapse volatile"));
+  EXPECT_TRUE(Contains(Be->History[1], "attempt 3"));
+}
+
+TEST(Collapse, MultipleKeysCollapseAlternatingMessages)
+{
+  Be->Clear();
+
+  for (int i = 0; i < 3; i++)
+  {
+    LogKeys("A");
+    LogKeys("B");
+  }
+
+  ASSERT_EQ(Be->History.size(), 4u);
+  EXPECT_TRUE(Contains(Be->History[0], "collapse keys A"));
+  EXPECT_TRUE(Contains(Be->History[1], "collapse keys B"));
+  EXPECT_TRUE(Contains(Be->History[2], "repeated 2 times: collapse keys A"));
+  EXPECT_TRUE(Contains(Be->History[3], "repeated 2 times: collapse keys B"));
+}
+
+TEST(Collapse, SingleKeyRestartsOnAlternatingMessages)
+{
+  Be->Clear();
+
+  for (int i = 0; i < 3; i++)
+  {
+    LogSingleKey("A");
+    LogSingleKey("B");
+  }
+
+  ASSERT_EQ(Be->History.size(), 6u);
+  for (auto& line : Be->History)
+    EXPECT_FALSE(Contains(line, "repeated"));
+}
+
+TEST(Collapse, ConcurrentRepeatsAreCounted)
+{
+  const int threads = 4;
+  const int records = 2500;
+
+  Be->Clear();
+  LogConcurrent();
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++)
+  {
+    workers.emplace_back([]()
+    {
+      for (int i = 0; i < records; i++)
+        LogConcurrent();
+    });
+  }
+
+  for (auto& worker : workers)
+    worker.join();
+
+  ASSERT_EQ(Be->History.size(), 1u + threads * records / 10);
+  EXPECT_TRUE(Contains(Be->History.back(), "repeated 10 times: collapse concurrent"));
+}
+
 TEST(Collapse, AllLevelsAreAvailable)
 {
   Be->Clear();
@@ -14,6 +14,7 @@
 #include <future>
 #include <iterator>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
@@ -468,8 +469,9 @@ TEST(ConsoleBackendTest, ManagerByteLimitIsHonored)
     );
     Logme::ConsoleBackend::SetOverflowPolicy(Logme::ConsoleOverflowPolicy::DROP_NEW);
 
+    // Without a worker the first record stays queued while the second is pushed
     Logme::ConsoleManager manager;
-    manager.AddBackend(fixture.Backend);
+    manager.AddBackend(fixture.Backend, false);
 
     EXPECT_TRUE(manager.Push(Logme::ConsoleTarget::STDOUT, Logme::LEVEL_INFO, false, "1234", 4));
     EXPECT_TRUE(manager.Push(Logme::ConsoleTarget::STDOUT, Logme::LEVEL_INFO, false, "5678", 4));
@@ -488,3 +490,100 @@ TEST(ConsoleBackendTest, ManagerByteLimitIsHonored)
 
   RemoveIfExists(stdoutPath);
 }
+
+TEST(ConsoleBackendTest, ManagerRingKeepsPerThreadOrder)
+{
+  auto stdoutPath = MakePath("manager-ring-order");
+  RemoveIfExists(stdoutPath);
+
+  constexpr int THREADS = 4;
+  constexpr int MESSAGES = 5000;
+
+  {
+    StreamRedirect stdoutRedirect(stdout, stdoutPath);
+    auto fixture = CreateBackend(false, Logme::STREAM_ALL2COUT);
+
+    // A small ring is reused many times and producers have to wait for it
+    Logme::ConsoleBackend::SetQueueLimits(64, 16 * 1024);
+    Logme::ConsoleBackend::SetOverflowPolicy(Logme::ConsoleOverflowPolicy::BLOCK);
+
+    Logme::ConsoleManager manager;
+    manager.AddBackend(fixture.Backend);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t)
+    {
+      threads.emplace_back(
+        [&manager, t]()
+        {
+          char line[64];
+          for (int i = 0; i < MESSAGES; ++i)
+          {
+            int n = snprintf(line, sizeof(line), "ring %d %d\n", t, i);
+            manager.Push(Logme::ConsoleTarget::STDOUT, Logme::LEVEL_INFO, false, line, size_t(n));
+          }
+        }
+      );
+    }
+
+    for (auto& thread : threads)
+      thread.join();
+
+    manager.Flush();
+    EXPECT_TRUE(manager.Empty());
+  }
+
+  std::vector<int> next(THREADS, 0);
+  size_t lines = 0;
+
+  std::istringstream input(ReadFile(stdoutPath));
+  for (std::string line; std::getline(input, line); ++lines)
+  {
+    int t = -1;
+    int i = -1;
+    ASSERT_EQ(sscanf(line.c_str(), "ring %d %d", &t, &i), 2) << line;
+    ASSERT_GE(t, 0);
+    ASSERT_LT(t, THREADS);
+    ASSERT_EQ(i, next[t]) << line;
+    next[t] = i + 1;
+  }
+
+  EXPECT_EQ(lines, size_t(THREADS * MESSAGES));
+
+  Logme::ConsoleBackend::SetQueueLimits(
+    Logme::ConsoleBackend::QUEUE_RECORD_LIMIT
+    , Logme::ConsoleBackend::QUEUE_BYTE_LIMIT
+  );
+
+  RemoveIfExists(stdoutPath);
+}
+
+TEST(ConsoleBackendTest, ManagerRecordLongerThanRingIsWrittenInOrder)
+{
+  auto stdoutPath = MakePath("manager-ring-large");
+  RemoveIfExists(stdoutPath);
+
+  std::string large(256 * 1024, 'x');
+
+  {
+    StreamRedirect stdoutRedirect(stdout, stdoutPath);
+    Logme::ConsoleBackend::SetQueueLimits(0, 16 * 1024);
+
+    Logme::ConsoleManager manager;
+
+    EXPECT_TRUE(manager.Push(Logme::ConsoleTarget::STDOUT, Logme::LEVEL_INFO, false, "first", 5));
+    EXPECT_TRUE(manager.Push(Logme::ConsoleTarget::STDOUT, Logme::LEVEL_INFO, false, large.data(), large.size()));
+    EXPECT_TRUE(manager.Push(Logme::ConsoleTarget::STDOUT, Logme::LEVEL_INFO, false, "last", 4));
+    manager.Flush();
+  }
+
+  auto out = ReadFile(stdoutPath);
+  EXPECT_EQ(out, "first" + large + "last");
+
+  Logme::ConsoleBackend::SetQueueLimits(
+    Logme::ConsoleBackend::QUEUE_RECORD_LIMIT
+    , Logme::ConsoleBackend::QUEUE_BYTE_LIMIT
+  );
+
+  RemoveIfExists(stdoutPath);
+}
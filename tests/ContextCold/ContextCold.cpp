@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <Logme/Context.h>
+#include <Logme/Logme.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+Logme::ID CHC{ "context_cold" };
+
+TEST(ContextCold, ReusedPartIsReset)
+{
+  Logme::ContextCache cache;
+  Logme::Context::Cold* first = nullptr;
+
+  {
+    Logme::Context context(cache, Logme::LEVEL_INFO, &CHC, nullptr);
+    Logme::Context::Cold& cold = context.GetCold();
+    first = &cold;
+
+    strcpy(cold.Timestamp, "2026-01-01 00:00:00");
+    strcpy(cold.ThreadProcessID, "[1:2]");
+    strcpy(cold.Buffer, "previous record");
+    strcpy(cold.MethodShortener.StaticBuffer, "short::Method");
+    cold.MethodShortener.Buffer = std::make_unique<std::string>("long::Method");
+  }
+
+  // The part released by the previous context is taken from the free list
+  Logme::Context context(cache, Logme::LEVEL_INFO, &CHC, nullptr);
+  Logme::Context::Cold& cold = context.GetCold();
+
+  EXPECT_EQ(&cold, first);
+  EXPECT_STREQ(cold.Timestamp, "");
+  EXPECT_STREQ(cold.ThreadProcessID, "");
+  EXPECT_STREQ(cold.Buffer, "");
+  EXPECT_STREQ(cold.MethodShortener.StaticBuffer, "");
+  EXPECT_EQ(cold.MethodShortener.Buffer, nullptr);
+}
+
+TEST(ContextCold, LargeStorageIsTrimmed)
+{
+  Logme::ContextCache cache;
+  const size_t large = 1024 * 1024;
+
+  {
+    Logme::Context context(cache, Logme::LEVEL_INFO, &CHC, nullptr);
+    context.GetStorage().reserve(large);
+    ASSERT_GE(context.GetStorage().capacity(), large);
+  }
+
+  Logme::Context context(cache, Logme::LEVEL_INFO, &CHC, nullptr);
+  EXPECT_LT(context.GetStorage().capacity(), large);
+}
+
+TEST(ContextCold, MovedContextKeepsPart)
+{
+  Logme::ContextCache cache;
+
+  Logme::Context context(cache, Logme::LEVEL_INFO, &CHC, nullptr);
+  Logme::Context::Cold* cold = &context.GetCold();
+  strcpy(cold->Buffer, "moved");
+
+  Logme::Context moved(std::move(context));
+  EXPECT_EQ(&moved.GetCold(), cold);
+  EXPECT_STREQ(moved.GetBuffer(), "moved");
+}
+
+TEST(ContextCold, PartCanBeReleasedByAnotherThread)
+{
+  Logme::ContextCache cache;
+
+  auto context = std::make_unique<Logme::Context>(cache, Logme::LEVEL_INFO, &CHC, nullptr);
+  strcpy(context->GetBuffer(), "released by worker");
+
+  // The part enters the free list of the worker and is deleted when the
+  // worker exits
+  std::thread worker([&context]()
+  {
+    EXPECT_STREQ(context->GetBuffer(), "released by worker");
+    context.reset();
+
+    Logme::ContextCache localCache;
+    Logme::Context local(localCache, Logme::LEVEL_INFO, &CHC, nullptr);
+    EXPECT_STREQ(local.GetBuffer(), "");
+  });
+
+  worker.join();
+  EXPECT_EQ(context, nullptr);
+}
+
+TEST(ContextCold, AccessorsReferToPart)
+{
+  Logme::ContextCache cache;
+  Logme::Context context(cache, Logme::LEVEL_INFO, &CHC, nullptr);
+  Logme::Context::Cold& cold = context.GetCold();
+
+  EXPECT_EQ(context.GetTimestamp(), cold.Timestamp);
+  EXPECT_EQ(context.GetThreadProcessID(), cold.ThreadProcessID);
+  EXPECT_EQ(context.GetBuffer(), cold.Buffer);
+  EXPECT_EQ(&context.GetStorage(), &cold.Storage);
+  EXPECT_EQ(&context.GetMethodShortener(), &cold.MethodShortener);
+}
@@ -0,0 +1,419 @@
+#include <gtest/gtest.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include <Logme/Logme.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+#ifdef _WIN32
+  typedef SOCKET SocketHandle;
+  const SocketHandle BadSocket = INVALID_SOCKET;
+
+  void CloseSocket(SocketHandle socket)
+  {
+    closesocket(socket);
+  }
+#else
+  typedef int SocketHandle;
+  const SocketHandle BadSocket = -1;
+
+  void CloseSocket(SocketHandle socket)
+  {
+    close(socket);
+  }
+#endif
+
+  const Logme::ID CHF{"control_follow"};
+  Logme::ChannelPtr Ch;
+
+  class Connection
+  {
+    SocketHandle Socket;
+    std::string Buffer;
+
+  public:
+    explicit Connection(int port)
+      : Socket(socket(AF_INET, SOCK_STREAM, 0))
+    {
+      if (Socket == BadSocket)
+        return;
+
+#ifdef _WIN32
+      DWORD timeout = 5000;
+#else
+      timeval timeout{};
+      timeout.tv_sec = 5;
+#endif
+      setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+
+      sockaddr_in addr{};
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      addr.sin_port = htons((unsigned short)port);
+
+      if (connect(Socket, (sockaddr*)&addr, sizeof(addr)) != 0)
+      {
+        CloseSocket(Socket);
+        Socket = BadSocket;
+      }
+    }
+
+    ~Connection()
+    {
+      if (Socket != BadSocket)
+        CloseSocket(Socket);
+    }
+
+    bool IsConnected() const
+    {
+      return Socket != BadSocket;
+    }
+
+    bool Send(const std::string& data)
+    {
+      return send(Socket, data.c_str(), (int)data.size(), 0) == (int)data.size();
+    }
+
+    static std::string Frame(const std::string& command)
+    {
+      return "#" + std::to_string(command.size()) + "\n" + command;
+    }
+
+    bool ReadLine(std::string& line)
+    {
+      size_t pos;
+      while ((pos = Buffer.find('\n')) == std::string::npos)
+      {
+        if (!Receive())
+          return false;
+      }
+
+      line = Buffer.substr(0, pos);
+      Buffer.erase(0, pos + 1);
+      return true;
+    }
+
+    bool ReadBytes(size_t length, std::string& data)
+    {
+      while (Buffer.size() < length)
+      {
+        if (!Receive())
+          return false;
+      }
+
+      data = Buffer.substr(0, length);
+      Buffer.erase(0, length);
+      return true;
+    }
+
+    bool ReadFrame(std::string& response)
+    {
+      std::string line;
+      if (!ReadLine(line) || line.empty() || line[0] != '#')
+        return false;
+
+      return ReadBytes((size_t)std::strtoull(line.c_str() + 1, nullptr, 10), response);
+    }
+
+  private:
+    bool Receive()
+    {
+      char data[16 * 1024];
+      int n = (int)recv(Socket, data, (int)sizeof(data), 0);
+      if (n <= 0)
+        return false;
+
+      Buffer.append(data, (size_t)n);
+      return true;
+    }
+  };
+
+  struct FollowResult
+  {
+    std::string Text;
+    uint64_t Records = 0;
+    uint64_t Dropped = 0;
+  };
+
+  // Reads batches until the terminating empty batch
+  bool ReadBatches(Connection& connection, FollowResult& result)
+  {
+    for (;;)
+    {
+      std::string line;
+      if (!connection.ReadLine(line))
+        return false;
+
+      size_t tab = line.find('\t');
+      if (tab == std::string::npos)
+        return false;
+
+      size_t bytes = (size_t)std::strtoull(line.c_str(), nullptr, 10);
+      result.Dropped += std::strtoull(line.c_str() + tab + 1, nullptr, 10);
+
+      if (bytes == 0)
+        return true;
+
+      std::string payload;
+      if (!connection.ReadBytes(bytes, payload))
+        return false;
+
+      for (char ch : payload)
+      {
+        if (ch == '\n')
+          result.Records++;
+      }
+
+      result.Text += payload;
+    }
+  }
+
+  int FindFreePort()
+  {
+    SocketHandle socketHandle = socket(AF_INET, SOCK_STREAM, 0);
+    if (socketHandle == BadSocket)
+      return 0;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+#ifdef _WIN32
+    int len = sizeof(addr);
+#else
+    socklen_t len = sizeof(addr);
+#endif
+
+    int port = 0;
+    if (bind(socketHandle, (sockaddr*)&addr, sizeof(addr)) == 0
+      && getsockname(socketHandle, (sockaddr*)&addr, &len) == 0)
+    {
+      port = ntohs(addr.sin_port);
+    }
+
+    CloseSocket(socketHandle);
+    return port;
+  }
+
+  class ControlFollow : public ::testing::Test
+  {
+  protected:
+    int Port = 0;
+
+    static void SetUpTestSuite()
+    {
+#ifdef _WIN32
+      WSADATA wsa{};
+      WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+    }
+
+    void SetUp() override
+    {
+      Port = FindFreePort();
+
+      Logme::ControlConfig cfg{};
+      cfg.Enable = true;
+      cfg.Port = Port;
+      cfg.Interface = 0;
+      cfg.DiscoveryEnable = false;
+
+      ASSERT_NE(Port, 0);
+      ASSERT_TRUE(Logme::Instance->StartControlServer(cfg));
+    }
+
+    void TearDown() override
+    {
+      Logme::Instance->StopControlServer();
+    }
+
+    // Sends the command and reads the stream header
+    static bool Subscribe(Connection& connection, const std::string& command)
+    {
+      std::string header;
+      return connection.Send(Connection::Frame(command))
+        && connection.ReadLine(header)
+        && header.rfind("LOGME-FOLLOW\t", 0) == 0;
+    }
+  };
+}
+
+TEST_F(ControlFollow, RecordsAreStreamed)
+{
+  EXPECT_EQ(Ch->NumberOfBackends(), 0U);
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+  ASSERT_TRUE(Subscribe(connection, "follow --channel control_follow --count 2"));
+
+  // The tap exists only while the subscription is active
+  EXPECT_EQ(Ch->NumberOfBackends(), 1U);
+
+  LogmeI(Ch, "first streamed record");
+  LogmeW(Ch, "second streamed record");
+  LogmeE(Ch, "record after the count");
+
+  FollowResult result;
+  ASSERT_TRUE(ReadBatches(connection, result));
+
+  EXPECT_EQ(result.Records, 2U);
+  EXPECT_EQ(result.Dropped, 0U);
+  EXPECT_NE(result.Text.find("first streamed record"), std::string::npos);
+  EXPECT_NE(result.Text.find("second streamed record"), std::string::npos);
+  EXPECT_EQ(result.Text.find("record after the count"), std::string::npos);
+  EXPECT_EQ(Ch->NumberOfBackends(), 0U);
+}
+
+TEST_F(ControlFollow, FiltersAreAppliedByServer)
+{
+  const Logme::SID net = Logme::SID::Build("NET");
+  const Logme::SID disk = Logme::SID::Build("DISK");
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+  ASSERT_TRUE(Subscribe(
+    connection
+    , "follow --channel control_follow --level warn --subsystem NET --count 1 --match keep [0-9]+"
+  ));
+
+  LogmeI(Ch, net, "keep 1 info level");
+  LogmeW(Ch, disk, "keep 2 other subsystem");
+  LogmeW(Ch, net, "no match");
+  LogmeE(Ch, net, "keep 3 accepted");
+
+  FollowResult result;
+  ASSERT_TRUE(ReadBatches(connection, result));
+
+  EXPECT_EQ(result.Records, 1U);
+  EXPECT_NE(result.Text.find("keep 3 accepted"), std::string::npos);
+}
+
+TEST_F(ControlFollow, ClientDataEndsSubscription)
+{
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+  ASSERT_TRUE(Subscribe(connection, "follow --channel control_follow"));
+
+  LogmeI(Ch, "record before the stop");
+
+  // The next request ends the subscription and is executed after it
+  ASSERT_TRUE(connection.Send(Connection::Frame("auth")));
+
+  FollowResult result;
+  ASSERT_TRUE(ReadBatches(connection, result));
+  EXPECT_NE(result.Text.find("record before the stop"), std::string::npos);
+
+  std::string response;
+  ASSERT_TRUE(connection.ReadFrame(response));
+  EXPECT_EQ(response, "ok\n");
+  EXPECT_EQ(Ch->NumberOfBackends(), 0U);
+}
+
+TEST_F(ControlFollow, DroppedRecordsAreCounted)
+{
+  const int total = 500;
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+  ASSERT_TRUE(Subscribe(connection, "follow --channel control_follow --buffer 2"));
+
+  for (int i = 0; i < total; i++)
+    LogmeI(Ch, "burst record %d", i);
+
+  ASSERT_TRUE(connection.Send(Connection::Frame("auth")));
+
+  // Every record is either delivered or reported as dropped
+  FollowResult result;
+  ASSERT_TRUE(ReadBatches(connection, result));
+  EXPECT_EQ(result.Records + result.Dropped, (uint64_t)total);
+  EXPECT_GT(result.Records, 0U);
+}
+
+TEST_F(ControlFollow, InvalidRequestsReturnErrors)
+{
+  EXPECT_EQ(
+    Logme::Instance->Control("follow")
+    , "error: follow requires a control connection"
+  );
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+
+  std::string response;
+  ASSERT_TRUE(connection.Send(Connection::Frame("follow --channel no_such_channel")));
+  ASSERT_TRUE(connection.ReadFrame(response));
+  EXPECT_EQ(response, "error: no such channel: no_such_channel\n");
+
+  ASSERT_TRUE(connection.Send(Connection::Frame("follow --level loud")));
+  ASSERT_TRUE(connection.ReadFrame(response));
+  EXPECT_EQ(response, "error: invalid level: loud\n");
+
+  ASSERT_TRUE(connection.Send(Connection::Frame("follow --match (")));
+  ASSERT_TRUE(connection.ReadFrame(response));
+  EXPECT_EQ(response, "error: invalid regular expression: (\n");
+}
+
+TEST_F(ControlFollow, SubscriptionsDoNotBlockOtherClients)
+{
+  // More subscriptions than the initial number of workers
+  std::vector<std::unique_ptr<Connection>> subscriptions;
+  for (int i = 0; i < 6; i++)
+  {
+    subscriptions.emplace_back(new Connection(Port));
+    ASSERT_TRUE(subscriptions.back()->IsConnected());
+    ASSERT_TRUE(Subscribe(*subscriptions.back(), "follow --channel control_follow"));
+  }
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+  ASSERT_TRUE(connection.Send(Connection::Frame("auth")));
+
+  std::string response;
+  ASSERT_TRUE(connection.ReadFrame(response));
+  EXPECT_EQ(response, "ok\n");
+
+  LogmeI(Ch, "record for every subscriber");
+
+  for (auto& subscription : subscriptions)
+  {
+    ASSERT_TRUE(subscription->Send(Connection::Frame("auth")));
+
+    FollowResult result;
+    ASSERT_TRUE(ReadBatches(*subscription, result));
+    EXPECT_EQ(result.Records, 1U);
+  }
+
+  EXPECT_EQ(Ch->NumberOfBackends(), 0U);
+}
+
+int main(int argc, char* argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+
+  Ch = Logme::Instance->CreateChannel(CHF);
+  Ch->SetFilterLevel(Logme::LEVEL_INFO);
+
+  int result = RUN_ALL_TESTS();
+
+  Logme::Instance->StopControlServer();
+  return result;
+}
@@ -0,0 +1,394 @@
+#include <gtest/gtest.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include <Logme/Logme.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+#ifdef _WIN32
+  typedef SOCKET SocketHandle;
+  const SocketHandle BadSocket = INVALID_SOCKET;
+
+  void CloseSocket(SocketHandle socket)
+  {
+    closesocket(socket);
+  }
+#else
+  typedef int SocketHandle;
+  const SocketHandle BadSocket = -1;
+
+  void CloseSocket(SocketHandle socket)
+  {
+    close(socket);
+  }
+#endif
+
+  class Connection
+  {
+    SocketHandle Socket;
+    std::string Buffer;
+
+  public:
+    explicit Connection(int port)
+      : Socket(socket(AF_INET, SOCK_STREAM, 0))
+    {
+      if (Socket == BadSocket)
+        return;
+
+#ifdef _WIN32
+      DWORD timeout = 5000;
+#else
+      timeval timeout{};
+      timeout.tv_sec = 5;
+#endif
+      setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+
+      sockaddr_in addr{};
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      addr.sin_port = htons((unsigned short)port);
+
+      if (connect(Socket, (sockaddr*)&addr, sizeof(addr)) != 0)
+      {
+        CloseSocket(Socket);
+        Socket = BadSocket;
+      }
+    }
+
+    ~Connection()
+    {
+      if (Socket != BadSocket)
+        CloseSocket(Socket);
+    }
+
+    bool IsConnected() const
+    {
+      return Socket != BadSocket;
+    }
+
+    bool Send(const std::string& data)
+    {
+      return send(Socket, data.c_str(), (int)data.size(), 0) == (int)data.size();
+    }
+
+    static std::string Frame(const std::string& command)
+    {
+      return "#" + std::to_string(command.size()) + "\n" + command;
+    }
+
+    bool ReadFrame(std::string& response)
+    {
+      size_t pos;
+      while ((pos = Buffer.find('\n')) == std::string::npos)
+      {
+        if (!Receive())
+          return false;
+      }
+
+      if (Buffer[0] != '#')
+        return false;
+
+      size_t length = (size_t)std::strtoull(Buffer.c_str() + 1, nullptr, 10);
+      Buffer.erase(0, pos + 1);
+
+      while (Buffer.size() < length)
+      {
+        if (!Receive())
+          return false;
+      }
+
+      response = Buffer.substr(0, length);
+      Buffer.erase(0, length);
+      return true;
+    }
+
+    // Unframed responses are read with one recv()
+    std::string ReceiveText()
+    {
+      if (Buffer.empty() && !Receive())
+        return std::string();
+
+      std::string text;
+      text.swap(Buffer);
+      return text;
+    }
+
+    // True when the server closed the connection
+    bool WaitClosed()
+    {
+      while (Receive())
+        Buffer.clear();
+
+      return IsClosed;
+    }
+
+  private:
+    bool IsClosed = false;
+
+    bool Receive()
+    {
+      char data[16 * 1024];
+      int n = (int)recv(Socket, data, (int)sizeof(data), 0);
+      if (n <= 0)
+      {
+        IsClosed = n == 0;
+        return false;
+      }
+
+      Buffer.append(data, (size_t)n);
+      return true;
+    }
+  };
+
+  int FindFreePort()
+  {
+    SocketHandle socketHandle = socket(AF_INET, SOCK_STREAM, 0);
+    if (socketHandle == BadSocket)
+      return 0;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+#ifdef _WIN32
+    int len = sizeof(addr);
+#else
+    socklen_t len = sizeof(addr);
+#endif
+
+    int port = 0;
+    if (bind(socketHandle, (sockaddr*)&addr, sizeof(addr)) == 0
+      && getsockname(socketHandle, (sockaddr*)&addr, &len) == 0)
+    {
+      port = ntohs(addr.sin_port);
+    }
+
+    CloseSocket(socketHandle);
+    return port;
+  }
+
+  class ControlServerLoop : public ::testing::Test
+  {
+  protected:
+    int Port = 0;
+
+    static void SetUpTestSuite()
+    {
+#ifdef _WIN32
+      WSADATA wsa{};
+      WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+    }
+
+    void TearDown() override
+    {
+      Logme::Instance->StopControlServer();
+    }
+
+    bool Start(int maxConnections = 0, int idleTimeout = 0)
+    {
+      Port = FindFreePort();
+
+      Logme::ControlConfig cfg{};
+      cfg.Enable = true;
+      cfg.Port = Port;
+      cfg.Interface = 0;
+      cfg.DiscoveryEnable = false;
+      cfg.MaxConnections = maxConnections;
+      cfg.IdleTimeout = idleTimeout;
+
+      return Port != 0 && Logme::Instance->StartControlServer(cfg);
+    }
+
+    static std::string Expected(const std::string& command)
+    {
+      std::string response = Logme::Instance->Control(command);
+      if (!response.empty() && response.back() != '\n')
+        response.push_back('\n');
+
+      return response;
+    }
+  };
+}
+
+TEST_F(ControlServerLoop, FramedRequestsArePipelined)
+{
+  ASSERT_TRUE(Start());
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+
+  // All requests are sent before the first response is read
+  std::string batch = Connection::Frame("auth")
+    + Connection::Frame("help")
+    + Connection::Frame("auth");
+  ASSERT_TRUE(connection.Send(batch));
+
+  std::string response;
+  ASSERT_TRUE(connection.ReadFrame(response));
+  EXPECT_EQ(response, "ok\n");
+
+  ASSERT_TRUE(connection.ReadFrame(response));
+  EXPECT_EQ(response, Expected("help"));
+
+  ASSERT_TRUE(connection.ReadFrame(response));
+  EXPECT_EQ(response, "ok\n");
+}
+
+TEST_F(ControlServerLoop, FrameSplitAcrossSends)
+{
+  ASSERT_TRUE(Start());
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+
+  std::string frame = Connection::Frame("help");
+  ASSERT_TRUE(connection.Send(frame.substr(0, 2)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_TRUE(connection.Send(frame.substr(2, 4)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_TRUE(connection.Send(frame.substr(6)));
+
+  std::string response;
+  ASSERT_TRUE(connection.ReadFrame(response));
+  EXPECT_EQ(response, Expected("help"));
+}
+
+TEST_F(ControlServerLoop, UnframedRequestsKeepWorking)
+{
+  ASSERT_TRUE(Start());
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+
+  ASSERT_TRUE(connection.Send("auth"));
+  EXPECT_EQ(connection.ReceiveText(), "ok\n");
+
+  // Framed and unframed requests can be mixed on one connection
+  ASSERT_TRUE(connection.Send(Connection::Frame("auth")));
+
+  std::string response;
+  ASSERT_TRUE(connection.ReadFrame(response));
+  EXPECT_EQ(response, "ok\n");
+}
+
+TEST_F(ControlServerLoop, InvalidFrameClosesConnection)
+{
+  ASSERT_TRUE(Start());
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+  ASSERT_TRUE(connection.Send("#12x\nhelp"));
+
+  std::string response;
+  ASSERT_TRUE(connection.ReadFrame(response));
+  EXPECT_EQ(response, "error: invalid request frame\n");
+  EXPECT_TRUE(connection.WaitClosed());
+
+  Connection large(Port);
+  ASSERT_TRUE(large.IsConnected());
+  ASSERT_TRUE(large.Send("#1000000\n"));
+
+  ASSERT_TRUE(large.ReadFrame(response));
+  EXPECT_EQ(response, "error: invalid request frame\n");
+  EXPECT_TRUE(large.WaitClosed());
+}
+
+TEST_F(ControlServerLoop, ConnectionLimit)
+{
+  ASSERT_TRUE(Start(2));
+
+  std::vector<std::unique_ptr<Connection>> connections;
+  for (int i = 0; i < 2; i++)
+  {
+    connections.emplace_back(new Connection(Port));
+    ASSERT_TRUE(connections.back()->IsConnected());
+
+    // A response proves that the server has accepted the connection
+    std::string response;
+    ASSERT_TRUE(connections.back()->Send(Connection::Frame("auth")));
+    ASSERT_TRUE(connections.back()->ReadFrame(response));
+  }
+
+  Connection extra(Port);
+  ASSERT_TRUE(extra.IsConnected());
+  EXPECT_EQ(extra.ReceiveText(), "error: too many control connections\n");
+  EXPECT_TRUE(extra.WaitClosed());
+
+  connections.clear();
+
+  // Closed connections free their slots
+  for (int attempt = 0; attempt < 50; attempt++)
+  {
+    Connection next(Port);
+    ASSERT_TRUE(next.IsConnected());
+    ASSERT_TRUE(next.Send(Connection::Frame("auth")));
+
+    std::string response;
+    if (next.ReadFrame(response))
+    {
+      EXPECT_EQ(response, "ok\n");
+      return;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+
+  FAIL() << "connection slots were not released";
+}
+
+TEST_F(ControlServerLoop, IdleConnectionIsClosed)
+{
+  ASSERT_TRUE(Start(0, 1));
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+  ASSERT_TRUE(connection.Send(Connection::Frame("auth")));
+
+  std::string response;
+  ASSERT_TRUE(connection.ReadFrame(response));
+  EXPECT_EQ(response, "ok\n");
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(connection.WaitClosed());
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+}
+
+TEST_F(ControlServerLoop, ManyConnectionsAreServed)
+{
+  ASSERT_TRUE(Start(64));
+
+  std::vector<std::unique_ptr<Connection>> connections;
+  for (int i = 0; i < 48; i++)
+  {
+    connections.emplace_back(new Connection(Port));
+    ASSERT_TRUE(connections.back()->IsConnected());
+    ASSERT_TRUE(connections.back()->Send(Connection::Frame("auth")));
+  }
+
+  for (auto& connection : connections)
+  {
+    std::string response;
+    ASSERT_TRUE(connection->ReadFrame(response));
+    EXPECT_EQ(response, "ok\n");
+  }
+}
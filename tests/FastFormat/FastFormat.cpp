@@ -122,6 +122,28 @@ static void ExpectCacheHitFitsBufferHint(
   EXPECT_EQ(cachedSize, std::strlen(expected));
 }
 
+static void ExpectSameAsVsnprintf(const char* format, ...)
+{
+  Logme::ContextCache cache;
+  char fast[512]{};
+  char expected[512]{};
+  size_t outLen = 0;
+
+  va_list args;
+  va_start(args, format);
+  bool rc = FormatFast(cache, fast, sizeof(fast), format, &outLen, args);
+  va_end(args);
+
+  va_start(args, format);
+  int n = vsnprintf(expected, sizeof(expected), format, args);
+  va_end(args);
+
+  EXPECT_TRUE(rc) << format;
+  EXPECT_EQ(cache.Ffe.Type, Logme::FastFormatType::PROGRAM) << format;
+  EXPECT_STREQ(fast, expected) << format;
+  EXPECT_EQ(outLen, size_t(n)) << format;
+}
+
 static void ExpectLoggerCacheHitOutput(
   void (*logProc)()
   , const char* expected
@@ -206,7 +228,7 @@ TEST(FastFormat, LiteralUsesFastPathAndBufferSizeHint)
   EXPECT_STREQ(buffer, "literal text");
   EXPECT_EQ(outLen, std::strlen("literal text"));
   ExpectReady(cache);
-  EXPECT_EQ(cache.Ffe.Kind1, Logme::FastFormatKind::LITERAL);
+  EXPECT_EQ(cache.Ffe.Type, Logme::FastFormatType::LITERAL);
   EXPECT_EQ(cache.Ffe.SpecCount, 0);
   EXPECT_GT(cache.Ffe.BufferSizeHint, 0);
 }
@@ -230,7 +252,7 @@ TEST(FastFormat, BoundedOneSpecifierUsesFastPathAndBufferSizeHint)
   EXPECT_STREQ(buffer, "value=42");
   EXPECT_EQ(outLen, std::strlen("value=42"));
   ExpectReady(cache);
-  EXPECT_EQ(cache.Ffe.Kind1, Logme::FastFormatKind::FORMAT_D);
+  EXPECT_EQ(cache.Ffe.Specs[0].Kind, Logme::FastFormatKind::FORMAT_D);
   EXPECT_EQ(cache.Ffe.SpecCount, 1);
   EXPECT_GT(cache.Ffe.BufferSizeHint, 0);
 }
@@ -255,8 +277,8 @@ TEST(FastFormat, BoundedTwoSpecifiersUseFastPathAndBufferSizeHint)
   EXPECT_STREQ(buffer, "a=-7 b=77");
   EXPECT_EQ(outLen, std::strlen("a=-7 b=77"));
   ExpectReady(cache);
-  EXPECT_EQ(cache.Ffe.Kind1, Logme::FastFormatKind::FORMAT_D);
-  EXPECT_EQ(cache.Ffe.Kind2, Logme::FastFormatKind::FORMAT_U);
+  EXPECT_EQ(cache.Ffe.Specs[0].Kind, Logme::FastFormatKind::FORMAT_D);
+  EXPECT_EQ(cache.Ffe.Specs[1].Kind, Logme::FastFormatKind::FORMAT_U);
   EXPECT_EQ(cache.Ffe.SpecCount, 2);
   EXPECT_GT(cache.Ffe.BufferSizeHint, 0);
 }
@@ -280,7 +302,7 @@ TEST(FastFormat, StringOneSpecifierUsesFastPathWithoutBufferSizeHint)
   EXPECT_STREQ(buffer, "file=test.log");
   EXPECT_EQ(outLen, std::strlen("file=test.log"));
   ExpectReady(cache);
-  EXPECT_EQ(cache.Ffe.Kind1, Logme::FastFormatKind::FORMAT_S);
+  EXPECT_EQ(cache.Ffe.Specs[0].Kind, Logme::FastFormatKind::FORMAT_S);
   EXPECT_EQ(cache.Ffe.SpecCount, 1);
   EXPECT_EQ(cache.Ffe.BufferSizeHint, 0);
 }
@@ -305,8 +327,8 @@ TEST(FastFormat, BoundedThenStringUsesFastPathWithoutBufferSizeHint)
   EXPECT_STREQ(buffer, "fd=3 file=test.log");
   EXPECT_EQ(outLen, std::strlen("fd=3 file=test.log"));
   ExpectReady(cache);
-  EXPECT_EQ(cache.Ffe.Kind1, Logme::FastFormatKind::FORMAT_D);
-  EXPECT_EQ(cache.Ffe.Kind2, Logme::FastFormatKind::FORMAT_S);
+  EXPECT_EQ(cache.Ffe.Specs[0].Kind, Logme::FastFormatKind::FORMAT_D);
+  EXPECT_EQ(cache.Ffe.Specs[1].Kind, Logme::FastFormatKind::FORMAT_S);
   EXPECT_EQ(cache.Ffe.SpecCount, 2);
   EXPECT_EQ(cache.Ffe.BufferSizeHint, 0);
 }
@@ -331,13 +353,13 @@ TEST(FastFormat, StringThenBoundedUsesFastPathWithoutBufferSizeHint)
   EXPECT_STREQ(buffer, "file=test.log fd=3");
   EXPECT_EQ(outLen, std::strlen("file=test.log fd=3"));
   ExpectReady(cache);
-  EXPECT_EQ(cache.Ffe.Kind1, Logme::FastFormatKind::FORMAT_S);
-  EXPECT_EQ(cache.Ffe.Kind2, Logme::FastFormatKind::FORMAT_D);
+  EXPECT_EQ(cache.Ffe.Specs[0].Kind, Logme::FastFormatKind::FORMAT_S);
+  EXPECT_EQ(cache.Ffe.Specs[1].Kind, Logme::FastFormatKind::FORMAT_D);
   EXPECT_EQ(cache.Ffe.SpecCount, 2);
   EXPECT_EQ(cache.Ffe.BufferSizeHint, 0);
 }
 
-TEST(FastFormat, MoreThanTwoSpecifiersDisableFastPath)
+TEST(FastFormat, MoreThanTwoSpecifiersUseFastPath)
 {
   Logme::ContextCache cache;
   char buffer[128]{};
@@ -354,13 +376,40 @@ TEST(FastFormat, MoreThanTwoSpecifiersDisableFastPath)
     , 3
   );
 
+  EXPECT_TRUE(rc);
+  EXPECT_STREQ(buffer, "a=1 b=2 c=3");
+  EXPECT_EQ(outLen, std::strlen("a=1 b=2 c=3"));
+  ExpectReady(cache);
+  EXPECT_EQ(cache.Ffe.Type, Logme::FastFormatType::PROGRAM);
+  EXPECT_EQ(cache.Ffe.SpecCount, 3);
+  EXPECT_GT(cache.Ffe.BufferSizeHint, 0);
+}
+
+TEST(FastFormat, TooManySpecifiersDisableFastPath)
+{
+  std::string format;
+  for (int i = 0; i <= Logme::FastFormatEntry::MAX_SPECS; ++i)
+    format += "%c";
+
+  Logme::ContextCache cache;
+  char buffer[128]{};
+  size_t outLen = 0;
+
+  bool rc = TryFormat(
+    cache
+    , format.c_str()
+    , buffer
+    , sizeof(buffer)
+    , &outLen
+    , 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i'
+    , 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q'
+  );
+
   EXPECT_FALSE(rc);
   EXPECT_STREQ(buffer, "");
-  EXPECT_EQ(outLen, 0u);
   ExpectReady(cache);
-  EXPECT_EQ(cache.Ffe.Kind1, Logme::FastFormatKind::NONE);
+  EXPECT_EQ(cache.Ffe.Type, Logme::FastFormatType::NONE);
   EXPECT_EQ(cache.Ffe.SpecCount, 0);
-  EXPECT_EQ(cache.Ffe.BufferSizeHint, 0);
 }
 
 TEST(FastFormat, UnsupportedSpecifierDisablesFastPath)
@@ -371,31 +420,34 @@ TEST(FastFormat, UnsupportedSpecifierDisablesFastPath)
 
   bool rc = TryFormat(
     cache
-    , "value=%lld"
+    , "value=%*d"
     , buffer
     , sizeof(buffer)
     , &outLen
-    , 42LL
+    , 5
+    , 42
   );
 
   EXPECT_FALSE(rc);
   EXPECT_STREQ(buffer, "");
   EXPECT_EQ(outLen, 0u);
   ExpectReady(cache);
-  EXPECT_EQ(cache.Ffe.Kind1, Logme::FastFormatKind::NONE);
+  EXPECT_EQ(cache.Ffe.Type, Logme::FastFormatType::NONE);
   EXPECT_EQ(cache.Ffe.SpecCount, 0);
   EXPECT_EQ(cache.Ffe.BufferSizeHint, 0);
 }
 
 TEST(FastFormat, LongFormatDisablesFastPath)
 {
+  const std::string format(1024, 'x');
+
   Logme::ContextCache cache;
   char buffer[128]{};
   size_t outLen = 0;
 
   bool rc = TryFormat(
     cache
-    , "012345678901234567890123456789012345678901234567"
+    , format.c_str()
     , buffer
     , sizeof(buffer)
     , &outLen
@@ -405,7 +457,7 @@ TEST(FastFormat, LongFormatDisablesFastPath)
   EXPECT_STREQ(buffer, "");
   EXPECT_EQ(outLen, 0u);
   ExpectReady(cache);
-  EXPECT_EQ(cache.Ffe.Kind1, Logme::FastFormatKind::NONE);
+  EXPECT_EQ(cache.Ffe.Type, Logme::FastFormatType::NONE);
   EXPECT_EQ(cache.Ffe.SpecCount, 0);
   EXPECT_EQ(cache.Ffe.BufferSizeHint, 0);
 }
@@ -555,6 +607,126 @@ TEST(FastFormat, LoggerCacheHitDoesNotTruncateStringThenBounded)
   EXPECT_EQ(Be->Line, std::string("file=") + file + " fd=4");
 }
 
+TEST(FastFormat, IntegerConversionsMatchVsnprintf)
+{
+  ExpectSameAsVsnprintf("%lld", std::numeric_limits<long long>::min());
+  ExpectSameAsVsnprintf("%llu", std::numeric_limits<unsigned long long>::max());
+  ExpectSameAsVsnprintf("%zu bytes", size_t(123456789012ULL));
+  ExpectSameAsVsnprintf("%zd", -(ptrdiff_t)42);
+  ExpectSameAsVsnprintf("%ld %lu", -1234567L, 1234567UL);
+  ExpectSameAsVsnprintf("%jd %td", (intmax_t)-9, (ptrdiff_t)9);
+  ExpectSameAsVsnprintf("%hd %hu %hhd %hhu", 70000, 70000, 300, 300);
+  ExpectSameAsVsnprintf("%08x|%#x|%#X|%X", 0xbeefu, 0xbeefu, 0xbeefu, 0u);
+  ExpectSameAsVsnprintf("%#x|%#o|%o|%#.0o", 0u, 8u, 8u, 0u);
+  ExpectSameAsVsnprintf("%016llx", 0x1234abcdULL);
+  ExpectSameAsVsnprintf("[%5d|%-5d|%05d|%+d|% d]", 42, 42, -42, 42, 42);
+  ExpectSameAsVsnprintf("[%.3d|%8.3d|%-8.3d|%08.3d]", 7, -7, 7, 7);
+  ExpectSameAsVsnprintf("[%.0d|%.0u|%5.0d]", 0, 0u, 0);
+  ExpectSameAsVsnprintf("%u%%", 100u);
+}
+
+TEST(FastFormat, SignFlagsAreIgnoredForUnsignedConversions)
+{
+  ExpectSameAsVsnprintf("[%+u|% u|%+ u]", 42u, 42u, 0u);
+  ExpectSameAsVsnprintf("[%+x|% X|%+#x|% #o]", 0xbeefu, 0xbeefu, 0xbeefu, 8u);
+  ExpectSameAsVsnprintf("[%+08u|% 8x|%-+6o|%+.3u]", 42u, 0xabu, 8u, 7u);
+  ExpectSameAsVsnprintf("[%+llu|% zu|%+hhu]", 123ULL, size_t(5), 200);
+  ExpectSameAsVsnprintf("[%+ d|% +i|%+05d|% 05i]", 3, 3, 3, -3);
+}
+
+TEST(FastFormat, StringAndCharConversionsMatchVsnprintf)
+{
+  ExpectSameAsVsnprintf("[%-10s|%10s|%.3s|%-6.2s]", "abc", "abc", "abcdef", "abcdef");
+  ExpectSameAsVsnprintf("[%c|%3c|%-3c]", 'x', 'y', 'z');
+  ExpectSameAsVsnprintf("%s=%d;%s=%u;%s=%x;%s=%c", "a", 1, "b", 2u, "c", 3u, "d", 'e');
+  ExpectSameAsVsnprintf("%20p", reinterpret_cast<void*>(uintptr_t(0x1234)));
+}
+
+TEST(FastFormat, FloatConversionsMatchVsnprintf)
+{
+  ExpectSameAsVsnprintf("%f", 3.14159265358979);
+  ExpectSameAsVsnprintf("%.3f ms", 12.3456);
+  ExpectSameAsVsnprintf("[%8.2f|%-8.2f|%08.2f|%+.1f|% .1f]", 3.14159, 3.14159, -3.14159, 2.5, 2.5);
+  ExpectSameAsVsnprintf("%.0f %.0f %.0f", 0.5, 1.5, 2.5);
+  ExpectSameAsVsnprintf("%e %E %.2e", 12345.678, 0.000123, -1e-300);
+  ExpectSameAsVsnprintf("%g %g %g %G", 100000.0, 1000000.0, 0.0001, 1e-5);
+  ExpectSameAsVsnprintf("%.3g %.10g %g", 3.14159, 1.0 / 3, 0.0);
+  ExpectSameAsVsnprintf("%lf", 1e15);
+  ExpectSameAsVsnprintf("%.2f", 1e300);
+  ExpectSameAsVsnprintf(
+    "%f %F %5f %05f"
+    , std::numeric_limits<double>::infinity()
+    , -std::numeric_limits<double>::infinity()
+    , std::numeric_limits<double>::infinity()
+    , std::numeric_limits<double>::infinity()
+  );
+}
+
+TEST(FastFormat, CacheHitBufferHintReservesLoggerAndTerminatorForProgram)
+{
+  Logme::ContextCache cache;
+
+  ExpectCacheHitFitsBufferHint(
+    cache
+    , "%016llx %+.2e %5.1f %c"
+    , "ffffffffffffffff -1.80e+308   2.5 x"
+    , std::numeric_limits<unsigned long long>::max()
+    , -std::numeric_limits<double>::max()
+    , 2.5
+    , 'x'
+  );
+}
+
+#if LOGME_COMPILE_TIME_FORMAT
+static_assert(LOGME_FORMAT_ARG("%d", 1) == 0);
+static_assert(LOGME_FORMAT_ARG(CHT, Func(1, "x"), "%s", "y") == 2);
+static_assert(LOGME_FORMAT_ARG(CHT, std::forward<Args>(args)...) == -1);
+
+static_assert(Logme::Detail::IsLiteralFormatCall<0, const char(&)[3], int>);
+static_assert(Logme::Detail::IsLiteralFormatCall<2, Logme::ID&, const Logme::SID&, const char(&)[3]>);
+static_assert(!Logme::Detail::IsLiteralFormatCall<-1, Logme::ID&, const char(&)[3]>);
+static_assert(!Logme::Detail::IsLiteralFormatCall<0, const char*&, int>);
+
+TEST(FastFormat, LiteralFormatIsCompiledAtBuildTime)
+{
+  constexpr Logme::Detail::FormatString<int, const char*, double> format("id=%d name=%-8s ratio=%.2f");
+  static_assert(format.Entry.Type == Logme::FastFormatType::PROGRAM);
+  static_assert(format.Entry.SpecCount == 3);
+  static_assert(format.Entry.Specs[1].Kind == Logme::FastFormatKind::FORMAT_S);
+
+  constexpr Logme::Detail::FormatString<int, int> star("%*d|");
+  static_assert(star.Entry.Type == Logme::FastFormatType::NONE);
+
+  Logme::OutputFlags flags;
+  flags.Value = 0;
+  Be->Owner->SetFlags(flags);
+
+  Logme::ContextCache cache;
+  Be->Clear();
+
+  Logme::Detail::Dispatch<1>(
+    Logme::Instance
+    , cache
+    , Logme::LEVEL_INFO
+    , &CHT
+    , &SUBSID
+    , __FUNCTION__
+    , __FILE__
+    , __LINE__
+    , CHT
+    , "id=%d name=%-8s ratio=%.2f"
+    , 7
+    , "worker"
+    , 0.5
+  );
+
+  ExpectReady(cache);
+  EXPECT_EQ(cache.Ffe.Type, Logme::FastFormatType::PROGRAM);
+  EXPECT_EQ(cache.Ffe.SpecCount, 3);
+  EXPECT_EQ(Be->Line, "id=7 name=worker   ratio=0.50");
+}
+#endif
+
 int main(int argc, char* argv[])
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -118,3 +118,30 @@ TEST(FileBackendConfigTest, AcceptsRetentionRules)
   EXPECT_EQ(backendConfig.RetentionMaxTotalSize, 128ULL * 1024ULL);
   EXPECT_FALSE(backendConfig.RetentionCleanOnStart);
 }
+
+TEST(FileBackendConfigTest, AcceptsOverflowPolicy)
+{
+  Json::Value config = MakeFileConfig();
+  config["overflow-policy"] = "drop-by-level";
+  config["overflow-timeout"] = "2s";
+  config["overflow-keep-level"] = "warning";
+  config["overflow-file"] = "spill.log";
+
+  Logme::FileBackendConfig backendConfig;
+
+  ASSERT_TRUE(backendConfig.Parse(&config));
+  EXPECT_EQ(backendConfig.OverflowPolicy, Logme::FileOverflowPolicy::DROP_BY_LEVEL);
+  EXPECT_EQ(backendConfig.OverflowTimeout, 2000ULL);
+  EXPECT_EQ(backendConfig.OverflowKeepLevel, Logme::LEVEL_WARN);
+  EXPECT_EQ(backendConfig.OverflowFilename, "spill.log");
+}
+
+TEST(FileBackendConfigTest, RejectsUnknownOverflowPolicy)
+{
+  Json::Value config = MakeFileConfig();
+  config["overflow-policy"] = "drop-random";
+
+  Logme::FileBackendConfig backendConfig;
+
+  EXPECT_FALSE(backendConfig.Parse(&config));
+}
@@ -3,12 +3,16 @@
 #include <algorithm>
 
 #include <Logme/Backend/FileBackend.h>
+#include <Logme/File/CompressionManager.h>
 #include <Logme/File/file_io.h>
 #include <Logme/Channel.h>
+#include <Logme/DeferredFormat.h>
 #include <Logme/Logme.h>
 
 #include <atomic>
 #include <chrono>
+#include <cstdarg>
+#include <cstdio>
 #include <filesystem>
 #include <fstream>
 #include <iterator>
@@ -157,6 +161,35 @@ namespace
   }
 #endif
 
+  std::string FormatDeferred(const char* format, ...)
+  {
+    char data[1024];
+    size_t used = 0;
+
+    va_list args;
+    va_start(args, format);
+    bool captured = Logme::CaptureDeferredArgs(format, args, data, sizeof(data), &used);
+    va_end(args);
+
+    std::string text;
+    if (!captured || !Logme::FormatDeferredArgs(format, data, used, text))
+      return "<not captured>";
+
+    return text;
+  }
+
+  std::string FormatPrintf(const char* format, ...)
+  {
+    char buffer[1024];
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    return buffer;
+  }
+
   class FileBackendIntegrationTest : public ::testing::Test
   {
   protected:
@@ -735,4 +768,136 @@ TEST_F(FileBackendIntegrationTest, GzipCompressionAppliesOnlyToCompletedArchive)
   EXPECT_FALSE(fs::exists(ActiveGz));
   EXPECT_EQ(ReadFile(Active), second);
 }
+
+TEST_F(FileBackendIntegrationTest, ZstdLevelIsLimitedWhenFallingBackToGzip)
+{
+  if (Logme::CompressionManager::IsCodecSupported(Logme::CompressionCodec::ZSTD))
+    GTEST_SKIP() << "zstd is available";
+
+  auto config = MakeConfig(Logme::SIZE_LIMIT_ROTATE, 2048);
+  config->ZstdCompression = true;
+  config->CompressionLevel = 19;
+  ApplyConfig(config);
+
+  const std::string first(1500, 'A');
+  const std::string second(1500, 'B');
+
+  Write(first);
+  Write(second);
+
+  // gzip rejects levels above 9, so the archive is only created if the
+  // level was limited
+  ASSERT_TRUE(WaitForCompressedFile(Archive1, Archive1Gz, std::chrono::seconds(5)));
+  EXPECT_EQ(ReadFile(Active), second);
+}
 #endif
+
+TEST(DeferredFormat, CapturedArgumentsFormatLikePrintf)
+{
+  const char* text = "deferred";
+  short s = -7;
+  unsigned char uc = 250;
+  long long ll = -1234567890123LL;
+  size_t z = 42;
+  void* ptr = &z;
+
+  EXPECT_EQ(
+    FormatDeferred("%d %i %u %x %X %o %%", -1, 2, 3u, 0xabu, 0xCDu, 8u)
+    , FormatPrintf("%d %i %u %x %X %o %%", -1, 2, 3u, 0xabu, 0xCDu, 8u)
+  );
+  EXPECT_EQ(
+    FormatDeferred("%hd %hhu %lld %zu %p", s, uc, ll, z, ptr)
+    , FormatPrintf("%hd %hhu %lld %zu %p", s, uc, ll, z, ptr)
+  );
+  EXPECT_EQ(
+    FormatDeferred("[%-10s] [%.3s] [%*d] [%.*f] [%c]", text, text, 6, 5, 2, 3.14159, 'z')
+    , FormatPrintf("[%-10s] [%.3s] [%*d] [%.*f] [%c]", text, text, 6, 5, 2, 3.14159, 'z')
+  );
+  EXPECT_EQ(
+    FormatDeferred("%e %g %08.3f %+d", 12345.678, 0.0001, -2.5, 9)
+    , FormatPrintf("%e %g %08.3f %+d", 12345.678, 0.0001, -2.5, 9)
+  );
+  EXPECT_EQ(FormatDeferred("%s", (const char*)nullptr), FormatPrintf("%s", "(null)"));
+}
+
+TEST(DeferredFormat, UnsupportedConversionsAreNotCaptured)
+{
+  int n = 0;
+
+  EXPECT_EQ(FormatDeferred("%n", &n), "<not captured>");
+  EXPECT_EQ(FormatDeferred("%Lf", 1.0L), "<not captured>");
+  EXPECT_EQ(FormatDeferred("%1$d", 1), "<not captured>");
+  EXPECT_EQ(FormatDeferred("%ls", L"wide"), "<not captured>");
+  EXPECT_EQ(FormatDeferred("%s", std::string(2000, 'x').c_str()), "<not captured>");
+}
+
+TEST_F(FileBackendIntegrationTest, DeferredFormatRendersRecordsOnWorker)
+{
+  Logme::OutputFlags flags;
+  flags.Value = 0;
+  flags.Signature = true;
+  flags.Eol = true;
+  Channel->SetFlags(flags);
+
+  auto config = MakeConfig(Logme::SIZE_LIMIT_TRUNCATE, 1024 * 1024);
+  config->Async = true;
+  config->DeferredFormat = true;
+  ApplyConfig(config);
+
+  ASSERT_TRUE(Backend->GetDeferredFormat());
+  ASSERT_TRUE(Channel->IsDeferredFormatEnabled());
+
+  std::string name = "worker";
+  LogmeW(Channel, "value=%d name=%s pi=%.2f", 7, name.c_str(), 3.14159);
+  name = "changed";
+
+  Backend->AppendString("raw\n", 4);
+  LogmeW(Channel, "%s", "plain");
+  LogmeW(Channel, "%5.1f%%", 99.44);
+  Backend->Flush();
+
+  const std::string prefix = "W ";
+  EXPECT_EQ(
+    ReadFile(Active)
+    , prefix + "value=7 name=worker pi=3.14\n"
+      + "raw\n"
+      + prefix + "plain\n"
+      + prefix + " 99.4%\n"
+  );
+}
+
+TEST_F(FileBackendIntegrationTest, DeferredFormatFallsBackWhenChannelNeedsText)
+{
+  Logme::OutputFlags flags;
+  flags.Value = 0;
+  flags.Eol = true;
+  Channel->SetFlags(flags);
+
+  auto config = MakeConfig(Logme::SIZE_LIMIT_TRUNCATE, 1024 * 1024);
+  config->Async = true;
+  config->DeferredFormat = true;
+  ApplyConfig(config);
+
+  std::string filtered;
+  Channel->SetDisplayFilter(
+    [&filtered](Logme::Context&, const char* text)
+    {
+      filtered = text;
+      return true;
+    }
+  );
+
+  EXPECT_FALSE(Channel->IsDeferredFormatEnabled());
+
+  LogmeI(Channel, "value=%d", 12);
+  Backend->Flush();
+
+  EXPECT_EQ(filtered, "value=12");
+  EXPECT_EQ(ReadFile(Active), "value=12\n");
+
+  Channel->SetDisplayFilter();
+  EXPECT_TRUE(Channel->IsDeferredFormatEnabled());
+
+  EXPECT_TRUE(Backend->SetDeferredFormat(false));
+  EXPECT_FALSE(Channel->IsDeferredFormatEnabled());
+}
@@ -0,0 +1,448 @@
+#include <gtest/gtest.h>
+
+#include <Logme/Backend/FileBackend.h>
+#include <Logme/Channel.h>
+#include <Logme/Logme.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+  std::atomic<unsigned> Counter(0);
+
+  const size_t BUFFER_SIZE = 4096;
+  const int RECORDS = 3000;
+  const int STAGED_RECORDS = 60000;
+
+  fs::path MakeTestDirectory()
+  {
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    unsigned id = Counter.fetch_add(1, std::memory_order_relaxed);
+
+    fs::path dir = fs::temp_directory_path()
+      / ("logme-overflow-policy-test-" + std::to_string(now) + "-" + std::to_string(id));
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir, ec);
+
+    EXPECT_FALSE(ec);
+    return dir;
+  }
+
+  std::vector<int> ReadRecords(const fs::path& file)
+  {
+    std::vector<int> records;
+
+    std::ifstream input(file, std::ios::binary);
+    for (std::string line; std::getline(input, line);)
+    {
+      int i = -1;
+      EXPECT_EQ(sscanf(line.c_str(), "record %d", &i), 1) << line;
+      records.push_back(i);
+    }
+
+    return records;
+  }
+
+  uint64_t TotalDropped(const Logme::FileBackendCounters& c)
+  {
+    uint64_t total = 0;
+    for (int i = Logme::LEVEL_DEBUG; i <= Logme::LEVEL_CRITICAL; i++)
+      total += c.OverflowDroppedRecords[i];
+
+    return total;
+  }
+
+  // Backend with a queue of two small buffers: the worker runs only when
+  // the first record is FlushAfter old, so a burst overflows the queue
+  struct OverflowFixture
+  {
+    Logme::ID Id;
+    Logme::ChannelPtr Ch;
+    Logme::FileBackendPtr Backend;
+
+    OverflowFixture(
+      const char* name
+      , const fs::path& file
+      , Logme::FileOverflowPolicy policy
+      , bool staging = false
+      , size_t queueSizeLimit = 0
+    )
+      : Id{name}
+    {
+      Ch = Logme::Instance->CreateChannel(Id);
+      Ch->RemoveBackends();
+
+      Logme::OutputFlags flags;
+      flags.Value = 0;
+      flags.Eol = true;
+      Ch->SetFlags(flags);
+      Ch->SetFilterLevel(Logme::LEVEL_DEBUG);
+
+      size_t bufferSize = Logme::FileBackend::GetDataBufferSizeDefault();
+      size_t bufferLimit = Logme::FileBackend::GetQueueBufferLimitDefault();
+      size_t sizeLimit = Logme::FileBackend::GetQueueSizeLimitDefault();
+      Logme::FileBackend::SetDataBufferSizeDefault(BUFFER_SIZE);
+      Logme::FileBackend::SetQueueBufferLimitDefault(2);
+      Logme::FileBackend::SetQueueSizeLimitDefault(queueSizeLimit);
+
+      Backend = std::make_shared<Logme::FileBackend>(Ch);
+
+      Logme::FileBackend::SetDataBufferSizeDefault(bufferSize);
+      Logme::FileBackend::SetQueueBufferLimitDefault(bufferLimit);
+      Logme::FileBackend::SetQueueSizeLimitDefault(sizeLimit);
+
+      auto config = std::make_shared<Logme::FileBackendConfig>();
+      config->Filename = file.string();
+      config->MaxSize = 0;
+      config->Append = false;
+      config->ThreadStaging = staging;
+      config->OverflowPolicy = policy;
+      config->OverflowTimeout = 10000;
+      EXPECT_TRUE(Backend->ApplyConfig(config));
+
+      Ch->AddBackend(Backend);
+    }
+
+    ~OverflowFixture()
+    {
+      Ch->RemoveBackends();
+      Backend.reset();
+      Logme::Instance->DeleteChannel(Id);
+    }
+  };
+}
+
+TEST(FileOverflowPolicy, DropNewCountsDropsByLevel)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "overflow.log";
+
+  Logme::FileBackendCounters before = Logme::FileBackend::GetCounters();
+  {
+    OverflowFixture f("overflow-drop-new", file, Logme::FileOverflowPolicy::DROP_NEW);
+
+    for (int i = 0; i < RECORDS; ++i)
+      LogmeW(f.Ch, "record %05d", i);
+
+    f.Backend->Flush();
+    EXPECT_NE(f.Backend->FormatDetails().find("OverflowDropped="), std::string::npos);
+  }
+  Logme::FileBackendCounters after = Logme::FileBackend::GetCounters();
+
+  std::vector<int> records = ReadRecords(file);
+  uint64_t dropped = after.OverflowDroppedRecords[Logme::LEVEL_WARN] - before.OverflowDroppedRecords[Logme::LEVEL_WARN];
+
+  EXPECT_GT(dropped, 0U);
+  EXPECT_EQ(records.size() + dropped, size_t(RECORDS));
+  EXPECT_EQ(TotalDropped(after) - TotalDropped(before), dropped);
+  EXPECT_EQ(records.front(), 0);
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(FileOverflowPolicy, BlockWaitsForWorker)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "overflow.log";
+
+  Logme::FileBackendCounters before = Logme::FileBackend::GetCounters();
+  {
+    OverflowFixture f("overflow-block", file, Logme::FileOverflowPolicy::BLOCK);
+
+    for (int i = 0; i < RECORDS; ++i)
+      LogmeI(f.Ch, "record %05d", i);
+
+    f.Backend->Flush();
+  }
+  Logme::FileBackendCounters after = Logme::FileBackend::GetCounters();
+
+  std::vector<int> records = ReadRecords(file);
+  ASSERT_EQ(records.size(), size_t(RECORDS));
+  for (int i = 0; i < RECORDS; ++i)
+    EXPECT_EQ(records[i], i);
+
+  EXPECT_GT(after.OverflowBlockedRecords, before.OverflowBlockedRecords);
+  EXPECT_EQ(TotalDropped(after), TotalDropped(before));
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(FileOverflowPolicy, DropByLevelKeepsErrors)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "overflow.log";
+
+  Logme::FileBackendCounters before = Logme::FileBackend::GetCounters();
+  {
+    OverflowFixture f("overflow-by-level", file, Logme::FileOverflowPolicy::DROP_BY_LEVEL);
+
+    for (int i = 0; i < RECORDS; ++i)
+    {
+      if (i % 10 == 0)
+      {
+        LogmeE(f.Ch, "record %05d", i);
+      }
+      else
+      {
+        LogmeI(f.Ch, "record %05d", i);
+      }
+    }
+
+    f.Backend->Flush();
+  }
+  Logme::FileBackendCounters after = Logme::FileBackend::GetCounters();
+
+  std::vector<int> records = ReadRecords(file);
+  std::set<int> written(records.begin(), records.end());
+
+  for (int i = 0; i < RECORDS; i += 10)
+    EXPECT_TRUE(written.count(i)) << i;
+
+  uint64_t droppedInfo = after.OverflowDroppedRecords[Logme::LEVEL_INFO] - before.OverflowDroppedRecords[Logme::LEVEL_INFO];
+  EXPECT_GT(droppedInfo, 0U);
+  EXPECT_EQ(after.OverflowDroppedRecords[Logme::LEVEL_ERROR], before.OverflowDroppedRecords[Logme::LEVEL_ERROR]);
+  EXPECT_EQ(records.size() + droppedInfo, size_t(RECORDS));
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(FileOverflowPolicy, SpillWritesOverflowFile)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "overflow.log";
+  fs::path spill = dir / "overflow.log.overflow";
+
+  Logme::FileBackendCounters before = Logme::FileBackend::GetCounters();
+  {
+    OverflowFixture f("overflow-spill", file, Logme::FileOverflowPolicy::SPILL);
+    EXPECT_EQ(f.Backend->GetOverflowPathName(), spill.string());
+
+    for (int i = 0; i < RECORDS; ++i)
+      LogmeI(f.Ch, "record %05d", i);
+
+    f.Backend->Flush();
+  }
+  Logme::FileBackendCounters after = Logme::FileBackend::GetCounters();
+
+  std::vector<int> queued = ReadRecords(file);
+  std::vector<int> spilled = ReadRecords(spill);
+
+  EXPECT_FALSE(spilled.empty());
+  EXPECT_EQ(after.OverflowSpilledRecords - before.OverflowSpilledRecords, spilled.size());
+  EXPECT_EQ(TotalDropped(after), TotalDropped(before));
+
+  std::set<int> all(queued.begin(), queued.end());
+  all.insert(spilled.begin(), spilled.end());
+  EXPECT_EQ(queued.size() + spilled.size(), size_t(RECORDS));
+  EXPECT_EQ(all.size(), size_t(RECORDS));
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(FileOverflowPolicy, DropOldestKeepsNewest)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "overflow.log";
+
+  Logme::FileBackendCounters before = Logme::FileBackend::GetCounters();
+  {
+    OverflowFixture f("overflow-drop-oldest", file, Logme::FileOverflowPolicy::DROP_OLDEST);
+
+    for (int i = 0; i < RECORDS; ++i)
+      LogmeI(f.Ch, "record %05d", i);
+
+    f.Backend->Flush();
+  }
+  Logme::FileBackendCounters after = Logme::FileBackend::GetCounters();
+
+  std::vector<int> records = ReadRecords(file);
+  ASSERT_FALSE(records.empty());
+  EXPECT_NE(records.front(), 0);
+  EXPECT_EQ(records.back(), RECORDS - 1);
+
+  for (size_t i = 1; i < records.size(); ++i)
+    EXPECT_LT(records[i - 1], records[i]);
+
+  EXPECT_GT(after.OverflowDroppedOldestBuffers, before.OverflowDroppedOldestBuffers);
+  EXPECT_EQ(TotalDropped(after), TotalDropped(before));
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(FileOverflowPolicy, BlockWithThreadStagingKeepsAllRecords)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "overflow.log";
+
+  Logme::FileBackendCounters before = Logme::FileBackend::GetCounters();
+  {
+    OverflowFixture f("overflow-block-staging", file, Logme::FileOverflowPolicy::BLOCK, true);
+
+    // More than the staging buffers can hold
+    for (int i = 0; i < STAGED_RECORDS; ++i)
+      LogmeI(f.Ch, "record %05d", i);
+
+    f.Backend->Flush();
+  }
+  Logme::FileBackendCounters after = Logme::FileBackend::GetCounters();
+
+  std::vector<int> records = ReadRecords(file);
+  ASSERT_EQ(records.size(), size_t(STAGED_RECORDS));
+  for (int i = 0; i < STAGED_RECORDS; ++i)
+    ASSERT_EQ(records[i], i);
+
+  EXPECT_EQ(TotalDropped(after), TotalDropped(before));
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(FileOverflowPolicy, StagedDrainKeepsQueueLimit)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "overflow.log";
+
+  // Staging buffers for the smallest queue size limit in front of a queue
+  // of two buffers
+  const size_t stagingBytes = 2 * Logme::FileBackend::QUEUE_BUFFER_SIZE;
+  const int records = 10000;
+
+  size_t staged = 0;
+  size_t peak = 0;
+  {
+    OverflowFixture f(
+      "overflow-staged-limit"
+      , file
+      , Logme::FileOverflowPolicy::BLOCK
+      , true
+      , stagingBytes
+    );
+
+    // The worker of a staged backend takes its channel lock. While the
+    // test holds that lock, the worker cannot write the queue of f.
+    uint64_t flushAfter = Logme::FileBackend::GetFlushAfterDefault();
+    Logme::FileBackend::SetFlushAfterDefault(10);
+    OverflowFixture stalled("overflow-staged-stalled", dir / "stalled.log", Logme::FileOverflowPolicy::DROP_NEW, true);
+    Logme::FileBackend::SetFlushAfterDefault(flushAfter);
+
+    std::thread flush;
+    {
+      auto stall = stalled.Ch->LockOutput();
+      LogmeI(stalled.Ch, "record 00000");
+      std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+      for (int i = 0; i < records; ++i)
+        LogmeI(f.Ch, "record %05d", i);
+
+      staged = f.Backend->GetMemoryUsage();
+
+      // Flush() drains the staged records into the queue and waits for the
+      // worker
+      flush = std::thread([&]() { f.Backend->Flush(); });
+
+      for (int i = 0; i < 300; ++i)
+      {
+        peak = (std::max)(peak, f.Backend->GetMemoryUsage());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+
+    flush.join();
+  }
+
+  std::vector<int> written = ReadRecords(file);
+  ASSERT_EQ(written.size(), size_t(records));
+  for (int i = 0; i < records; ++i)
+    ASSERT_EQ(written[i], i);
+
+  // The drain moved no more than the queue can hold
+  EXPECT_LE(peak, staged + 2 * BUFFER_SIZE);
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(FileOverflowPolicy, BlockReleasesChannelLock)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "overflow.log";
+
+  Logme::FileBackendCounters before = Logme::FileBackend::GetCounters();
+  {
+    OverflowFixture f("overflow-block-unlocked", file, Logme::FileOverflowPolicy::BLOCK);
+
+    // Stalls the worker as in StagedDrainKeepsQueueLimit
+    uint64_t flushAfter = Logme::FileBackend::GetFlushAfterDefault();
+    Logme::FileBackend::SetFlushAfterDefault(10);
+    OverflowFixture stalled("overflow-block-stalled", dir / "stalled.log", Logme::FileOverflowPolicy::DROP_NEW, true);
+    Logme::FileBackend::SetFlushAfterDefault(flushAfter);
+
+    std::thread producer;
+    {
+      auto stall = stalled.Ch->LockOutput();
+      LogmeI(stalled.Ch, "record 00000");
+      std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+      producer = std::thread([&]()
+      {
+        for (int i = 0; i < RECORDS; ++i)
+          LogmeI(f.Ch, "record %05d", i);
+      });
+
+      auto blocked = [&]()
+      {
+        return Logme::FileBackend::GetCounters().OverflowBlockedRecords > before.OverflowBlockedRecords;
+      };
+
+      for (int i = 0; i < 5000 && !blocked(); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+      EXPECT_TRUE(blocked());
+
+      // The blocked producer does not keep the channel locked
+      bool locked = false;
+      for (int i = 0; i < 2000 && !locked; ++i)
+      {
+        auto lock = f.Ch->GetDataLock().TryLock();
+        locked = lock;
+        if (!locked)
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+
+      EXPECT_TRUE(locked);
+    }
+
+    producer.join();
+    f.Backend->Flush();
+  }
+  Logme::FileBackendCounters after = Logme::FileBackend::GetCounters();
+
+  std::vector<int> records = ReadRecords(file);
+  ASSERT_EQ(records.size(), size_t(RECORDS));
+  for (int i = 0; i < RECORDS; ++i)
+    EXPECT_EQ(records[i], i);
+
+  EXPECT_EQ(TotalDropped(after), TotalDropped(before));
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
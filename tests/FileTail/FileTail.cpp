@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+
+#include <Logme/File/TailReader.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+  std::atomic<unsigned> Counter(0);
+
+  fs::path MakeTestFile()
+  {
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    unsigned id = Counter.fetch_add(1, std::memory_order_relaxed);
+
+    return fs::temp_directory_path()
+      / ("logme-file-tail-test-" + std::to_string(now) + "-" + std::to_string(id) + ".log");
+  }
+
+  void WriteFile(const fs::path& file, const std::string& data, bool append = false)
+  {
+    std::ofstream output(
+      file
+      , append ? std::ios::binary | std::ios::app : std::ios::binary | std::ios::trunc
+    );
+    output << data;
+  }
+
+  std::string MakeLines(int first, int count)
+  {
+    std::string data;
+    for (int i = first; i < first + count; i++)
+      data += "line " + std::to_string(i) + "\n";
+
+    return data;
+  }
+
+  std::string ReadLines(Logme::TailReader& reader, const fs::path& file, size_t maxLines)
+  {
+    std::string content;
+    EXPECT_EQ(reader.ReadLines(file.string(), maxLines, content), 0);
+    return content;
+  }
+}
+
+TEST(FileTail, ReturnsLastLines)
+{
+  fs::path file = MakeTestFile();
+  WriteFile(file, MakeLines(0, 10));
+
+  Logme::TailReader reader;
+  EXPECT_EQ(ReadLines(reader, file, 1), "line 9\n");
+  EXPECT_EQ(ReadLines(reader, file, 3), MakeLines(7, 3));
+  EXPECT_EQ(ReadLines(reader, file, 10), MakeLines(0, 10));
+  EXPECT_EQ(ReadLines(reader, file, 50), MakeLines(0, 10));
+  EXPECT_EQ(ReadLines(reader, file, 0), MakeLines(0, 10));
+
+  fs::remove(file);
+}
+
+TEST(FileTail, LastLineWithoutNewline)
+{
+  fs::path file = MakeTestFile();
+  WriteFile(file, "a\nb\nc");
+
+  Logme::TailReader reader;
+  EXPECT_EQ(ReadLines(reader, file, 1), "c");
+  EXPECT_EQ(ReadLines(reader, file, 2), "b\nc");
+  EXPECT_EQ(ReadLines(reader, file, 5), "a\nb\nc");
+
+  fs::remove(file);
+}
+
+TEST(FileTail, EmptyAndMissingFiles)
+{
+  fs::path file = MakeTestFile();
+  WriteFile(file, "");
+
+  Logme::TailReader reader;
+  EXPECT_EQ(ReadLines(reader, file, 5), "");
+
+  fs::remove(file);
+
+  std::string content = "stale";
+  EXPECT_NE(reader.ReadLines(file.string(), 5, content), 0);
+  EXPECT_TRUE(content.empty());
+}
+
+TEST(FileTail, LinesAcrossBlocks)
+{
+  fs::path file = MakeTestFile();
+
+  std::string data = MakeLines(0, 20000);
+  std::string longLine(Logme::TailReader::BLOCK_SIZE * 2 + 17, 'y');
+  data += longLine + "\n";
+  data += MakeLines(20000, 2);
+  WriteFile(file, data);
+
+  Logme::TailReader reader;
+  EXPECT_EQ(ReadLines(reader, file, 2), MakeLines(20000, 2));
+  EXPECT_EQ(ReadLines(reader, file, 3), longLine + "\n" + MakeLines(20000, 2));
+  EXPECT_EQ(ReadLines(reader, file, 4), "line 19999\n" + longLine + "\n" + MakeLines(20000, 2));
+
+  fs::remove(file);
+}
+
+TEST(FileTail, AppendedDataIsScannedIncrementally)
+{
+  fs::path file = MakeTestFile();
+  WriteFile(file, MakeLines(0, 5));
+
+  Logme::TailReader reader;
+  EXPECT_EQ(ReadLines(reader, file, 3), MakeLines(2, 3));
+
+  WriteFile(file, "line 5", true);
+  EXPECT_EQ(ReadLines(reader, file, 3), "line 3\nline 4\nline 5");
+
+  WriteFile(file, "\n" + MakeLines(6, 100), true);
+  EXPECT_EQ(ReadLines(reader, file, 3), MakeLines(103, 3));
+
+  fs::remove(file);
+}
+
+TEST(FileTail, RewrittenFileIsScannedAgain)
+{
+  fs::path file = MakeTestFile();
+  WriteFile(file, MakeLines(0, 100));
+
+  Logme::TailReader reader;
+  EXPECT_EQ(ReadLines(reader, file, 2), MakeLines(98, 2));
+
+  // Truncated and refilled in place past the old size
+  WriteFile(file, std::string(20, '-') + "\n" + MakeLines(500, 100));
+  EXPECT_EQ(ReadLines(reader, file, 2), MakeLines(598, 2));
+
+  WriteFile(file, MakeLines(0, 3));
+  EXPECT_EQ(ReadLines(reader, file, 2), MakeLines(1, 2));
+
+  fs::remove(file);
+}
+
+TEST(FileTail, ReadBytesStartsAtLineBoundary)
+{
+  fs::path file = MakeTestFile();
+  WriteFile(file, "first\nsecond\nthird\n");
+
+  std::string content;
+  EXPECT_EQ(Logme::TailReader::ReadBytes(file.string(), 0, content), 0);
+  EXPECT_EQ(content, "first\nsecond\nthird\n");
+
+  EXPECT_EQ(Logme::TailReader::ReadBytes(file.string(), 100, content), 0);
+  EXPECT_EQ(content, "first\nsecond\nthird\n");
+
+  // Range starts inside "second"
+  EXPECT_EQ(Logme::TailReader::ReadBytes(file.string(), 10, content), 0);
+  EXPECT_EQ(content, "third\n");
+
+  // Range starts right after a newline
+  EXPECT_EQ(Logme::TailReader::ReadBytes(file.string(), 13, content), 0);
+  EXPECT_EQ(content, "second\nthird\n");
+
+  fs::remove(file);
+}
+
+TEST(FileTail, FindLast)
+{
+  std::string text = "a\nbcdefghijklmnopq\nrstuvwxyz";
+
+  const char* p = Logme::TailReader::FindLast(text.data(), text.size(), '\n');
+  ASSERT_NE(p, nullptr);
+  EXPECT_EQ(size_t(p - text.data()), text.rfind('\n'));
+
+  p = Logme::TailReader::FindLast(text.data(), text.rfind('\n'), '\n');
+  ASSERT_NE(p, nullptr);
+  EXPECT_EQ(size_t(p - text.data()), 1u);
+
+  EXPECT_EQ(Logme::TailReader::FindLast(text.data(), 1, '\n'), nullptr);
+  EXPECT_EQ(Logme::TailReader::FindLast(text.data(), 0, '\n'), nullptr);
+}
@@ -2,6 +2,10 @@
 
 #include <zlib.h>
 
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
 #include <chrono>
 #include <exception>
 #include <filesystem>
@@ -9,6 +13,7 @@
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 static void Check(
   bool condition
@@ -61,6 +66,34 @@ static std::string ReadGzipFile(const std::filesystem::path& file)
   return result;
 }
 
+static std::string ReadBinaryFile(const std::filesystem::path& file)
+{
+  std::ifstream input(file, std::ios::binary);
+  Check(input.good(), "failed to open file");
+
+  return std::string(
+    std::istreambuf_iterator<char>(input)
+    , std::istreambuf_iterator<char>()
+  );
+}
+
+// Several blocks of text that compresses like a log
+static std::string MakeLogText(std::size_t size, int seed)
+{
+  std::string text;
+  text.reserve(size + 128);
+
+  for (unsigned n = 0; text.size() < size; n++)
+  {
+    text += "2026-01-01 12:00:00:" + std::to_string(n % 1000);
+    text += " I worker " + std::to_string(seed) + ": request ";
+    text += std::to_string(n * 2654435761u % 100000);
+    text += " completed\n";
+  }
+
+  return text;
+}
+
 static std::filesystem::path MakeTestDirectory()
 {
   auto now = std::chrono::steady_clock::now().time_since_epoch().count();
@@ -124,11 +157,125 @@ static void TestGzipCompression()
   std::filesystem::remove_all(dir, ec);
 }
 
+static void TestParallelGzipCompression()
+{
+  auto dir = MakeTestDirectory();
+  Logme::CompressionCounters before = Logme::CompressionManager::GetCounters();
+
+  // Files larger than a block, rotated at the same time
+  std::vector<std::string> texts;
+  std::uint64_t inputBytes = 0;
+
+  for (int i = 0; i < 3; i++)
+  {
+    texts.push_back(MakeLogText(Logme::CompressionManager::BLOCK_SIZE * 3 + 1000 * i, i));
+    inputBytes += texts.back().size();
+    WriteTextFile(dir / ("part" + std::to_string(i) + ".log"), texts.back());
+  }
+
+  Logme::CompressionManagerFactory factory(
+    [](const std::string& file)
+    {
+      (void)file;
+      return false;
+    }
+  );
+
+  factory.SetThreads(4);
+
+  auto registration = factory.RegisterUser(Logme::CompressionCodec::GZIP, 1);
+  Check(registration->IsActive(), "compression registration is inactive");
+
+  for (int i = 0; i < 3; i++)
+    registration->Submit((dir / ("part" + std::to_string(i) + ".log")).string());
+
+  registration.reset();
+  factory.SetStopping();
+
+  for (int i = 0; i < 3; i++)
+  {
+    auto compressed = dir / ("part" + std::to_string(i) + ".log.gz");
+    Check(std::filesystem::exists(compressed), "compressed part was not created");
+
+    // zlib reads all members of a multi-member file
+    Check(ReadGzipFile(compressed) == texts[i], "compressed part content mismatch");
+  }
+
+  Logme::CompressionCounters after = Logme::CompressionManager::GetCounters();
+  Check(after.GzipFiles - before.GzipFiles == 3, "gzip file counter mismatch");
+  Check(after.InputBytes - before.InputBytes == inputBytes, "input byte counter mismatch");
+  Check(after.Blocks - before.Blocks >= 12, "files were not split into blocks");
+  Check(after.OutputBytes - before.OutputBytes < inputBytes / 4, "unexpected compression ratio");
+  Check(after.ActiveNanoseconds > before.ActiveNanoseconds, "active time was not counted");
+
+  std::error_code ec;
+  std::filesystem::remove_all(dir, ec);
+}
+
+static void TestEmptyFileCompression()
+{
+  auto dir = MakeTestDirectory();
+  auto source = dir / "empty.log";
+  WriteTextFile(source, std::string());
+
+  Logme::CompressionManagerFactory factory(nullptr);
+  auto registration = factory.RegisterUser();
+
+  registration->Submit(source.string());
+  registration.reset();
+  factory.SetStopping();
+
+  Check(ReadGzipFile(dir / "empty.log.gz").empty(), "empty file content mismatch");
+
+  std::error_code ec;
+  std::filesystem::remove_all(dir, ec);
+}
+
+static void TestZstdCompression()
+{
+  if (!Logme::CompressionManager::IsCodecSupported(Logme::CompressionCodec::ZSTD))
+    return;
+
+#ifdef USE_ZSTD
+  auto dir = MakeTestDirectory();
+  auto source = dir / "completed.log";
+  auto compressed = dir / "completed.log.zst";
+
+  const std::string text = MakeLogText(Logme::CompressionManager::BLOCK_SIZE * 2 + 123, 7);
+  WriteTextFile(source, text);
+
+  Logme::CompressionManagerFactory factory(nullptr);
+  auto registration = factory.RegisterUser(Logme::CompressionCodec::ZSTD, 5);
+
+  registration->Submit(source.string());
+  registration.reset();
+  factory.SetStopping();
+
+  Check(!std::filesystem::exists(source), "source file was not removed");
+
+  std::string data = ReadBinaryFile(compressed);
+
+  // ZSTD_decompress() reads all frames of a multi-frame file
+  std::string result(text.size() + 1, '\0');
+  size_t n = ZSTD_decompress(&result[0], result.size(), data.data(), data.size());
+  Check(!ZSTD_isError(n) && n == text.size(), "failed to decompress zstd file");
+
+  result.resize(n);
+  Check(result == text, "zstd file content mismatch");
+
+  std::error_code ec;
+  std::filesystem::remove_all(dir, ec);
+#endif
+}
+
 int main()
 {
   try
   {
     TestGzipCompression();
+    TestParallelGzipCompression();
+    TestEmptyFileCompression();
+    TestZstdCompression();
     return 0;
   }
   catch (const std::exception& e)
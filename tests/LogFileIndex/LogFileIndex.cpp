@@ -0,0 +1,259 @@
+#include <gtest/gtest.h>
+
+#include <Logme/File/LogFileIndex.h>
+#include <Logme/File/RetentionCleaner.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+  std::atomic<unsigned> Counter(0);
+
+  fs::path MakeTestDirectory()
+  {
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    unsigned id = Counter.fetch_add(1, std::memory_order_relaxed);
+
+    fs::path dir = fs::temp_directory_path()
+      / ("logme-file-index-test-" + std::to_string(now) + "-" + std::to_string(id));
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir, ec);
+
+    EXPECT_FALSE(ec);
+    return dir;
+  }
+
+  void WriteFile(const fs::path& file, size_t size)
+  {
+    std::ofstream output(file, std::ios::binary);
+    output << std::string(size, 'x');
+  }
+
+  std::vector<std::string> Names(const std::vector<Logme::LogFileRecord>& files)
+  {
+    std::vector<std::string> names;
+    for (auto& f : files)
+      names.push_back(fs::path(f.PathName).filename().string());
+
+    std::sort(names.begin(), names.end());
+    return names;
+  }
+}
+
+TEST(LogFileIndex, ScansDirectoryOnce)
+{
+  fs::path dir = MakeTestDirectory();
+  WriteFile(dir / "a.log", 10);
+  WriteFile(dir / "b.log", 20);
+
+  Logme::LogFileIndex index;
+  std::vector<Logme::LogFileRecord> files;
+
+  index.List(dir.string(), files);
+  EXPECT_EQ(index.GetScanCount(), 1U);
+  ASSERT_EQ(files.size(), 2U);
+  EXPECT_EQ(Names(files), (std::vector<std::string>{"a.log", "b.log"}));
+  EXPECT_EQ(files[0].PathName, (dir / Names(files)[0]).string());
+
+  files.clear();
+  index.List(dir.string(), files);
+  index.List((dir / "").string(), files);
+  EXPECT_EQ(index.GetScanCount(), 1U);
+  EXPECT_EQ(files.size(), 4U);
+
+  index.Invalidate();
+  files.clear();
+  index.List(dir.string(), files);
+  EXPECT_EQ(index.GetScanCount(), 2U);
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(LogFileIndex, EventsKeepIndexCurrent)
+{
+  fs::path dir = MakeTestDirectory();
+  WriteFile(dir / "a.log", 10);
+
+  Logme::LogFileIndex index;
+  std::vector<Logme::LogFileRecord> files;
+  index.List(dir.string(), files);
+
+  int owner = 0;
+  WriteFile(dir / "b.log", 30);
+  index.Update((dir / "b.log").string(), &owner);
+
+  files.clear();
+  index.List(dir.string(), files);
+  ASSERT_EQ(files.size(), 2U);
+  for (auto& f : files)
+  {
+    if (fs::path(f.PathName).filename() == "b.log")
+    {
+      EXPECT_EQ(f.Owner, &owner);
+      EXPECT_EQ(f.Size, 30U);
+    }
+    else
+      EXPECT_EQ(f.Owner, nullptr);
+  }
+
+  // The active file grows without events: size is read at query time
+  WriteFile(dir / "b.log", 50);
+  files.clear();
+  index.List(dir.string(), files);
+  for (auto& f : files)
+  {
+    if (f.Owner)
+      EXPECT_EQ(f.Size, 50U);
+  }
+
+  fs::rename(dir / "b.log", dir / "b.1.log");
+  index.Rename((dir / "b.log").string(), (dir / "b.1.log").string());
+  EXPECT_TRUE(index.Exists((dir / "b.1.log").string()));
+  EXPECT_FALSE(index.Exists((dir / "b.log").string()));
+
+  fs::remove(dir / "a.log");
+  index.Remove((dir / "a.log").string());
+
+  files.clear();
+  index.List(dir.string(), files);
+  EXPECT_EQ(Names(files), (std::vector<std::string>{"b.1.log"}));
+  EXPECT_EQ(files[0].Owner, nullptr);
+  EXPECT_EQ(index.GetScanCount(), 1U);
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(LogFileIndex, ListsDirectoryTree)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::create_directories(dir / "sub" / "deep");
+  WriteFile(dir / "a.log", 1);
+  WriteFile(dir / "sub" / "b.log", 2);
+  WriteFile(dir / "sub" / "deep" / "c.log", 3);
+
+  Logme::LogFileIndex index;
+  std::vector<Logme::LogFileRecord> files;
+
+  index.ListRecursive(dir.string(), files);
+  EXPECT_EQ(Names(files), (std::vector<std::string>{"a.log", "b.log", "c.log"}));
+
+  uint64_t scans = index.GetScanCount();
+  files.clear();
+  index.ListRecursive(dir.string(), files);
+  EXPECT_EQ(files.size(), 3U);
+  EXPECT_EQ(index.GetScanCount(), scans);
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(LogFileIndex, RescanIntervalPicksUpExternalChanges)
+{
+  fs::path dir = MakeTestDirectory();
+
+  Logme::LogFileIndex index;
+  index.SetRescanInterval(1);
+
+  std::vector<Logme::LogFileRecord> files;
+  index.List(dir.string(), files);
+  EXPECT_TRUE(files.empty());
+
+  WriteFile(dir / "external.log", 5);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  index.List(dir.string(), files);
+  EXPECT_EQ(Names(files), (std::vector<std::string>{"external.log"}));
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+#ifdef __linux__
+TEST(LogFileIndex, WatchPicksUpExternalChanges)
+{
+  fs::path dir = MakeTestDirectory();
+
+  Logme::LogFileIndex index;
+  index.SetRescanInterval(0);
+  ASSERT_TRUE(index.EnableWatch(true));
+
+  std::vector<Logme::LogFileRecord> files;
+  index.List(dir.string(), files);
+  EXPECT_TRUE(files.empty());
+
+  WriteFile(dir / "external.log", 5);
+
+  bool found = false;
+  for (int i = 0; i < 100 && !found; ++i)
+  {
+    files.clear();
+    index.List(dir.string(), files);
+    found = files.size() == 1 && files[0].Size == 5;
+
+    if (!found)
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+
+  EXPECT_TRUE(found);
+  EXPECT_EQ(index.GetScanCount(), 1U);
+
+  fs::remove(dir / "external.log");
+  for (int i = 0; i < 100 && found; ++i)
+  {
+    found = index.Exists((dir / "external.log").string());
+    if (found)
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+
+  EXPECT_FALSE(found);
+  EXPECT_TRUE(index.EnableWatch(false));
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+#endif
+
+TEST(LogFileIndex, CleanFilesUpdatesIndex)
+{
+  fs::path dir = MakeTestDirectory();
+  for (int i = 1; i <= 5; ++i)
+    WriteFile(dir / ("app." + std::to_string(i) + ".log"), 10);
+
+  Logme::LogFileIndex index;
+  index.SetRescanInterval(0);
+
+  Logme::RetentionOptions options;
+  options.MaxFiles = 2;
+
+  std::regex pattern(".*app\\.[0-9]+\\.log");
+  Logme::CleanFiles(pattern, (dir / "app.5.log").string(), options, &index);
+
+  std::vector<Logme::LogFileRecord> files;
+  index.List(dir.string(), files);
+  EXPECT_EQ(files.size(), 2U);
+  EXPECT_EQ(index.GetScanCount(), 1U);
+
+  size_t onDisk = 0;
+  for (auto& e : fs::directory_iterator(dir))
+  {
+    (void)e;
+    onDisk++;
+  }
+  EXPECT_EQ(onDisk, files.size());
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
@@ -9,6 +9,7 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
 #include <memory>
@@ -117,6 +118,14 @@ namespace
     LogmeW(channel, "site-b value=%s", value);
   }
 
+  void LogSiteSharded(
+    const ChannelPtr& channel
+    , int value
+  )
+  {
+    LogmeI(channel, "sharded value=%05d", value);
+  }
+
   void BenchmarkSite(
     const ChannelPtr& channel
     , size_t iterations
@@ -481,6 +490,61 @@ TEST(LogStatistics, SupportsConcurrentRecording)
   EXPECT_TRUE(Contains(top, "records=4000"));
 }
 
+TEST(LogStatistics, ShardedCountersMatchConcurrentWriters)
+{
+  ResetStatistics();
+  ChannelPtr channel = MakeOutputChannel("log_statistics_sharded");
+
+  // Each thread takes the next shard, so more threads than shards make
+  // every shard collect records from several writers
+  const size_t threadCount = 80;
+  const size_t recordsPerThread = 500;
+  const uint64_t records = threadCount * recordsPerThread;
+  const uint64_t messageBytes = strlen("sharded value=00000");
+
+  Instance->StartLogStatistics();
+
+  std::vector<std::thread> threads;
+  for (size_t thread = 0; thread < threadCount; ++thread)
+  {
+    threads.emplace_back(
+      [&channel]()
+      {
+        for (size_t i = 0; i < recordsPerThread; ++i)
+          LogSiteSharded(channel, static_cast<int>(i));
+      }
+    );
+  }
+
+  for (std::thread& thread : threads)
+    thread.join();
+
+  Instance->StopLogStatistics();
+
+  std::string top = Instance->DumpLogStatisticsTop(
+    LogStatisticsSort::RECORDS
+    , 10
+  );
+
+  EXPECT_EQ(ReadUnsignedAfter(top, "Total: records="), records);
+  EXPECT_EQ(ReadUnsignedAfter(top, "message-bytes="), records * messageBytes);
+  EXPECT_EQ(ReadUnsignedAfter(top, "max="), messageBytes);
+
+  std::string outputs = Instance->DumpLogStatisticsOutputs(
+    LogStatisticsSort::RECORDS
+    , 10
+    , BufferBackend::TYPE_ID
+  );
+
+  // Every record has the same output size
+  uint64_t outputMax = ReadUnsignedAfter(outputs, "max=");
+  EXPECT_EQ(ReadUnsignedAfter(outputs, "Total: records="), records);
+  EXPECT_GT(outputMax, 0U);
+  EXPECT_EQ(ReadUnsignedAfter(outputs, "output-bytes="), records * outputMax);
+
+  Instance->DeleteChannel(ID{"log_statistics_sharded"});
+}
+
 TEST(LogStatistics, ControlCommandProvidesTextAndJsonResponses)
 {
   ResetStatistics();
@@ -504,6 +568,71 @@ TEST(LogStatistics, ControlCommandProvidesTextAndJsonResponses)
   EXPECT_TRUE(Contains(json, "Log statistics"));
 }
 
+TEST(LogStatistics, CollectsLatencyHistograms)
+{
+  ResetStatistics();
+
+  Instance->StartLogStatistics();
+  LogSiteA(OutputChannel, 1);
+  Instance->StopLogStatistics();
+  EXPECT_TRUE(Instance->GetLogStatisticsLatency().empty());
+
+  Instance->SetLogStatisticsTiming(true);
+  Instance->StartLogStatistics();
+
+  for (int i = 0; i < 1000; ++i)
+    LogSiteA(OutputChannel, i);
+
+  Instance->StopLogStatistics();
+  Instance->SetLogStatisticsTiming(false);
+
+  std::vector<LogSiteLatency> sites = Instance->GetLogStatisticsLatency();
+  ASSERT_EQ(sites.size(), 1U);
+
+  const LogSiteLatency& site = sites[0];
+  EXPECT_TRUE(Contains(site.Method, "LogSiteA"));
+  EXPECT_EQ(site.Format, "site-a value=%d");
+  EXPECT_EQ(site.TotalTime.Count, 1000U);
+  EXPECT_EQ(site.FormatTime.Count, 1000U);
+  EXPECT_EQ(site.ApplyTime.Count, 1000U);
+
+  EXPECT_GT(site.TotalTime.P50, 0U);
+  EXPECT_LE(site.TotalTime.P50, site.TotalTime.P99);
+  EXPECT_LE(site.TotalTime.P99, site.TotalTime.P999);
+  EXPECT_LE(site.TotalTime.P999, site.TotalTime.Max);
+  EXPECT_LE(site.FormatTime.P50, site.TotalTime.Max);
+
+  ASSERT_EQ(site.Backends.size(), 1U);
+  EXPECT_EQ(site.Backends[0].BackendType, "BufferBackend");
+  EXPECT_EQ(site.Backends[0].Channel, "log_statistics_output");
+  EXPECT_EQ(site.Backends[0].Display.Count, 1000U);
+  EXPECT_LE(site.Backends[0].Display.P50, site.Backends[0].Display.P999);
+}
+
+TEST(LogStatistics, ControlCommandReportsLatency)
+{
+  ResetStatistics();
+
+  EXPECT_TRUE(Contains(Instance->Control("logstat start --timing"), "latency timing"));
+  EXPECT_TRUE(Contains(Instance->Control("logstat timing"), "on"));
+  LogSiteB(OutputChannel, "value");
+  LogSiteB(OutputChannel, "value");
+  EXPECT_TRUE(Contains(Instance->Control("logstat stop"), "stopped"));
+  EXPECT_TRUE(Contains(Instance->Control("logstat timing off"), "ok"));
+
+  std::string report = Instance->Control("logstat latency --sort display --limit 5");
+  EXPECT_TRUE(Contains(report, "Sort: display-p99"));
+  EXPECT_TRUE(Contains(report, "LogSiteB"));
+  EXPECT_TRUE(Contains(report, "total    count=2 "));
+  EXPECT_TRUE(Contains(report, "p999="));
+  EXPECT_TRUE(Contains(report, "backend=BufferBackend"));
+
+  EXPECT_TRUE(Contains(
+    Instance->Control("logstat latency --sort slowest")
+    , "error: invalid logstat latency sort value"
+  ));
+}
+
 TEST(LogStatistics, DisabledHotPathBenchmark)
 {
   BenchmarkSite(ChannelA, 1000);
@@ -519,6 +648,14 @@ TEST(LogStatistics, DisabledHotPathBenchmark)
   auto enabledDuration = std::chrono::steady_clock::now() - enabledStarted;
   Instance->StopLogStatistics();
 
+  Instance->SetLogStatisticsTiming(true);
+  Instance->StartLogStatistics();
+  auto timedStarted = std::chrono::steady_clock::now();
+  BenchmarkSite(ChannelA, BENCHMARK_ITERATIONS);
+  auto timedDuration = std::chrono::steady_clock::now() - timedStarted;
+  Instance->StopLogStatistics();
+  Instance->SetLogStatisticsTiming(false);
+
   double disabledNs = NanosecondsPerCall(
     disabledDuration
     , BENCHMARK_ITERATIONS
@@ -527,6 +664,10 @@ TEST(LogStatistics, DisabledHotPathBenchmark)
     enabledDuration
     , BENCHMARK_ITERATIONS
   );
+  double timedNs = NanosecondsPerCall(
+    timedDuration
+    , BENCHMARK_ITERATIONS
+  );
 
   std::cout
     << "[ LOGSTAT HOTPATH ] disabled="
@@ -535,6 +676,8 @@ TEST(LogStatistics, DisabledHotPathBenchmark)
     << enabledNs
     << " ns/call overhead="
     << (enabledNs - disabledNs)
+    << " ns/call timed="
+    << timedNs
     << " ns/call"
     << std::endl;
 
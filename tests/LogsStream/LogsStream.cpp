@@ -0,0 +1,421 @@
+#include <gtest/gtest.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <Logme/Logme.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+#ifdef _WIN32
+  typedef SOCKET SocketHandle;
+  const SocketHandle BadSocket = INVALID_SOCKET;
+
+  void CloseSocket(SocketHandle socket)
+  {
+    closesocket(socket);
+  }
+#else
+  typedef int SocketHandle;
+  const SocketHandle BadSocket = -1;
+
+  void CloseSocket(SocketHandle socket)
+  {
+    close(socket);
+  }
+#endif
+
+  struct StreamChunk
+  {
+    std::string Payload;
+    uint64_t SourceBytes;
+  };
+
+  struct StreamResult
+  {
+    std::string Header;
+    std::vector<StreamChunk> Chunks;
+    bool Complete = false;
+
+    std::string GetPayload() const
+    {
+      std::string data;
+      for (const StreamChunk& chunk : Chunks)
+        data += chunk.Payload;
+
+      return data;
+    }
+  };
+
+  class Connection
+  {
+    SocketHandle Socket;
+    std::string Buffer;
+
+  public:
+    explicit Connection(int port)
+      : Socket(socket(AF_INET, SOCK_STREAM, 0))
+    {
+      if (Socket == BadSocket)
+        return;
+
+#ifdef _WIN32
+      DWORD timeout = 5000;
+#else
+      timeval timeout{};
+      timeout.tv_sec = 5;
+#endif
+      setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+
+      sockaddr_in addr{};
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      addr.sin_port = htons((unsigned short)port);
+
+      if (connect(Socket, (sockaddr*)&addr, sizeof(addr)) != 0)
+      {
+        CloseSocket(Socket);
+        Socket = BadSocket;
+      }
+    }
+
+    ~Connection()
+    {
+      if (Socket != BadSocket)
+        CloseSocket(Socket);
+    }
+
+    bool IsConnected() const
+    {
+      return Socket != BadSocket;
+    }
+
+    bool Send(const std::string& command)
+    {
+      return send(Socket, command.c_str(), (int)command.size(), 0) == (int)command.size();
+    }
+
+    // Text responses are not framed; one recv() returns the whole response
+    std::string ReceiveText()
+    {
+      if (Buffer.empty() && !Receive())
+        return std::string();
+
+      std::string text;
+      text.swap(Buffer);
+      return text;
+    }
+
+    bool ReadStream(StreamResult& result)
+    {
+      if (!ReadLine(result.Header))
+        return false;
+
+      if (result.Header.rfind("LOGMEWEB-STREAM\t", 0) != 0)
+        return false;
+
+      for (;;)
+      {
+        std::string line;
+        if (!ReadLine(line))
+          return false;
+
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos)
+          return false;
+
+        uint64_t payloadBytes = std::strtoull(line.c_str(), nullptr, 10);
+        uint64_t sourceBytes = std::strtoull(line.c_str() + tab + 1, nullptr, 10);
+        if (payloadBytes == 0)
+        {
+          result.Complete = sourceBytes == 0;
+          return result.Complete;
+        }
+
+        while (Buffer.size() < payloadBytes)
+        {
+          if (!Receive())
+            return false;
+        }
+
+        result.Chunks.push_back({Buffer.substr(0, (size_t)payloadBytes), sourceBytes});
+        Buffer.erase(0, (size_t)payloadBytes);
+      }
+    }
+
+  private:
+    bool Receive()
+    {
+      char data[64 * 1024];
+      int n = (int)recv(Socket, data, (int)sizeof(data), 0);
+      if (n <= 0)
+        return false;
+
+      Buffer.append(data, (size_t)n);
+      return true;
+    }
+
+    bool ReadLine(std::string& line)
+    {
+      size_t pos;
+      while ((pos = Buffer.find('\n')) == std::string::npos)
+      {
+        if (!Receive())
+          return false;
+      }
+
+      line = Buffer.substr(0, pos);
+      Buffer.erase(0, pos + 1);
+      return true;
+    }
+  };
+
+  int FindFreePort()
+  {
+    SocketHandle socketHandle = socket(AF_INET, SOCK_STREAM, 0);
+    if (socketHandle == BadSocket)
+      return 0;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+#ifdef _WIN32
+    int len = sizeof(addr);
+#else
+    socklen_t len = sizeof(addr);
+#endif
+
+    int port = 0;
+    if (bind(socketHandle, (sockaddr*)&addr, sizeof(addr)) == 0
+      && getsockname(socketHandle, (sockaddr*)&addr, &len) == 0)
+    {
+      port = ntohs(addr.sin_port);
+    }
+
+    CloseSocket(socketHandle);
+    return port;
+  }
+
+  std::string MakeData(size_t size)
+  {
+    std::string data;
+    data.reserve(size + 64);
+
+    for (int i = 0; data.size() < size; i++)
+      data += "record " + std::to_string(i) + " of the streamed log file\n";
+
+    data.resize(size);
+    return data;
+  }
+
+#ifdef USE_ZLIB
+  std::string Gunzip(const std::string& member, uint64_t size)
+  {
+    z_stream zs{};
+    if (inflateInit2(&zs, MAX_WBITS + 16) != Z_OK)
+      return std::string();
+
+    std::string data((size_t)size, '\0');
+    zs.next_in = (Bytef*)member.data();
+    zs.avail_in = (uInt)member.size();
+    zs.next_out = (Bytef*)&data[0];
+    zs.avail_out = (uInt)data.size();
+
+    int rc = inflate(&zs, Z_FINISH);
+    inflateEnd(&zs);
+
+    if (rc != Z_STREAM_END || zs.avail_out != 0 || zs.avail_in != 0)
+      return std::string();
+
+    return data;
+  }
+#endif
+
+  class LogsStream : public ::testing::Test
+  {
+  protected:
+    static fs::path Home;
+    static int Port;
+
+    static void SetUpTestSuite()
+    {
+#ifdef _WIN32
+      WSADATA wsa{};
+      WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+
+      auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+      Home = fs::temp_directory_path() / ("logme-logs-stream-test-" + std::to_string(now));
+      fs::create_directories(Home);
+
+      Logme::Instance->SetHomeDirectory(Home.string());
+
+      Port = FindFreePort();
+
+      Logme::ControlConfig cfg{};
+      cfg.Enable = true;
+      cfg.Port = Port;
+      cfg.Interface = 0;
+      cfg.DiscoveryEnable = false;
+
+      if (Port == 0 || !Logme::Instance->StartControlServer(cfg))
+        Port = 0;
+    }
+
+    static void TearDownTestSuite()
+    {
+      Logme::Instance->StopControlServer();
+
+      std::error_code ec;
+      fs::remove_all(Home, ec);
+    }
+
+    static void WriteLogFile(const std::string& name, const std::string& data)
+    {
+      std::ofstream output(Home / name, std::ios::binary | std::ios::trunc);
+      output << data;
+    }
+  };
+
+  fs::path LogsStream::Home;
+  int LogsStream::Port = 0;
+}
+
+TEST_F(LogsStream, StreamsWholeFileInChunks)
+{
+  ASSERT_NE(Port, 0);
+
+  std::string data = MakeData(3 * 1024 * 1024 + 123);
+  WriteLogFile("whole.log", data);
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+  ASSERT_TRUE(connection.Send("logs --stream whole.log"));
+
+  StreamResult result;
+  ASSERT_TRUE(connection.ReadStream(result));
+  EXPECT_EQ(result.Header, "LOGMEWEB-STREAM\t0\t" + std::to_string(data.size()) + "\tidentity");
+  EXPECT_GT(result.Chunks.size(), 1u);
+  EXPECT_TRUE(result.GetPayload() == data);
+
+  for (const StreamChunk& chunk : result.Chunks)
+    EXPECT_EQ(chunk.Payload.size(), chunk.SourceBytes);
+}
+
+TEST_F(LogsStream, ResumesAtOffset)
+{
+  ASSERT_NE(Port, 0);
+
+  std::string data = MakeData(200000);
+  WriteLogFile("resume.log", data);
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+  ASSERT_TRUE(connection.Send("logs --stream resume.log 150001"));
+
+  StreamResult result;
+  ASSERT_TRUE(connection.ReadStream(result));
+  EXPECT_EQ(result.Header, "LOGMEWEB-STREAM\t150001\t200000\tidentity");
+  EXPECT_TRUE(result.GetPayload() == data.substr(150001));
+
+  // An offset past the end sends only the terminating chunk
+  ASSERT_TRUE(connection.Send("logs --stream resume.log 300000"));
+
+  StreamResult empty;
+  ASSERT_TRUE(connection.ReadStream(empty));
+  EXPECT_EQ(empty.Header, "LOGMEWEB-STREAM\t200000\t200000\tidentity");
+  EXPECT_TRUE(empty.Chunks.empty());
+}
+
+TEST_F(LogsStream, ConnectionAcceptsCommandsAfterStream)
+{
+  ASSERT_NE(Port, 0);
+
+  WriteLogFile("short.log", "one\ntwo\n");
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+  ASSERT_TRUE(connection.Send("logs --stream short.log"));
+
+  StreamResult result;
+  ASSERT_TRUE(connection.ReadStream(result));
+  EXPECT_EQ(result.GetPayload(), "one\ntwo\n");
+
+  ASSERT_TRUE(connection.Send("logs --tail short.log"));
+  EXPECT_EQ(connection.ReceiveText(), "one\ntwo\n");
+}
+
+TEST_F(LogsStream, ErrorsAreTextResponses)
+{
+  ASSERT_NE(Port, 0);
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+
+  ASSERT_TRUE(connection.Send("logs --stream missing.log"));
+  EXPECT_EQ(connection.ReceiveText(), "error: file is not found\n");
+
+  ASSERT_TRUE(connection.Send("logs --stream ../outside.log"));
+  EXPECT_EQ(connection.ReceiveText(), "error: path is outside home directory\n");
+}
+
+TEST_F(LogsStream, RequiresControlConnection)
+{
+  WriteLogFile("local.log", "data\n");
+
+  std::string response = Logme::Instance->Control("logs --stream local.log");
+  EXPECT_EQ(response, "error: streaming requires a control connection");
+}
+
+#ifdef USE_ZLIB
+TEST_F(LogsStream, GzipChunksAreIndependentMembers)
+{
+  ASSERT_NE(Port, 0);
+
+  std::string data = MakeData(2 * 1024 * 1024 + 777);
+  WriteLogFile("packed.log", data);
+
+  Connection connection(Port);
+  ASSERT_TRUE(connection.IsConnected());
+  ASSERT_TRUE(connection.Send("logs --stream packed.log 1000 --gzip"));
+
+  StreamResult result;
+  ASSERT_TRUE(connection.ReadStream(result));
+  EXPECT_EQ(result.Header, "LOGMEWEB-STREAM\t1000\t" + std::to_string(data.size()) + "\tgzip");
+  ASSERT_GT(result.Chunks.size(), 1u);
+
+  std::string unpacked;
+  for (const StreamChunk& chunk : result.Chunks)
+  {
+    EXPECT_LT(chunk.Payload.size(), chunk.SourceBytes);
+    unpacked += Gunzip(chunk.Payload, chunk.SourceBytes);
+  }
+
+  EXPECT_TRUE(unpacked == data.substr(1000));
+}
+#endif
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+
+#include <Logme/Backend/FileBackend.h>
+#include <Logme/Channel.h>
+#include <Logme/Logme.h>
+#include <Logme/Obfuscate.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+  std::atomic<unsigned> Counter(0);
+
+  const ObfKernel Kernels[] = {
+    LOGOBF_KERNEL_SCALAR
+    , LOGOBF_KERNEL_SSE2
+    , LOGOBF_KERNEL_AVX2
+  };
+
+  ObfKey MakeKey()
+  {
+    ObfKey key;
+    for (int i = 0; i < LOGOBF_KEY_BYTES; ++i)
+      key.Bytes[i] = (uint8_t)i;
+    return key;
+  }
+
+  std::vector<uint8_t> Encrypt(const ObfKey& key, const std::vector<uint8_t>& text)
+  {
+    NonceGen gen;
+    gen.Salt = 0x01020304;
+    gen.Counter = 0x4a000000;
+
+    std::vector<uint8_t> record(ObfCalcRecordSize(text.size()));
+    size_t size = 0;
+    EXPECT_EQ(
+      ObfEncryptRecord(&key, &gen, text.data(), text.size(), record.data(), record.size(), &size)
+      , 1
+    );
+
+    record.resize(size);
+    return record;
+  }
+
+  fs::path MakeTestDirectory()
+  {
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    unsigned id = Counter.fetch_add(1, std::memory_order_relaxed);
+
+    fs::path dir = fs::temp_directory_path()
+      / ("logme-obfuscation-test-" + std::to_string(now) + "-" + std::to_string(id));
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir, ec);
+
+    EXPECT_FALSE(ec);
+    return dir;
+  }
+
+  std::string ReadFile(const fs::path& file)
+  {
+    std::ifstream input(file, std::ios::binary);
+    std::stringstream ss;
+    ss << input.rdbuf();
+    return ss.str();
+  }
+
+  size_t CountRecords(const std::string& data)
+  {
+    size_t n = 0;
+    for (size_t pos = 0; pos + LOGOBF_HEADER_BYTES <= data.size(); ++n)
+    {
+      size_t len = (uint8_t)data[pos + 2] | ((size_t)(uint8_t)data[pos + 3] << 8);
+      pos += LOGOBF_HEADER_BYTES + len;
+    }
+    return n;
+  }
+}
+
+TEST(Obfuscation, ChaCha20MatchesRfc8439Vector)
+{
+  // RFC 8439, 2.4.2: key 00..1f, nonce 00:00:00:00:00:00:00:4a:00:00:00:00, counter 1
+  const char* plaintext =
+    "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the "
+    "future, sunscreen would be it.";
+
+  const uint8_t expected[] = {
+    0x6e, 0x2e, 0x35, 0x9a, 0x25, 0x68, 0xf9, 0x80, 0x41, 0xba, 0x07, 0x28, 0xdd, 0x0d, 0x69, 0x81
+    , 0xe9, 0x7e, 0x7a, 0xec, 0x1d, 0x43, 0x60, 0xc2, 0x0a, 0x27, 0xaf, 0xcc, 0xfd, 0x9f, 0xae, 0x0b
+    , 0xf9, 0x1b, 0x65, 0xc5, 0x52, 0x47, 0x33, 0xab, 0x8f, 0x59, 0x3d, 0xab, 0xcd, 0x62, 0xb3, 0x57
+    , 0x16, 0x39, 0xd6, 0x24, 0xe6, 0x51, 0x52, 0xab, 0x8f, 0x53, 0x0c, 0x35, 0x9f, 0x08, 0x61, 0xd8
+    , 0x07, 0xca, 0x0d, 0xbf, 0x50, 0x0d, 0x6a, 0x61, 0x56, 0xa3, 0x8e, 0x08, 0x8a, 0x22, 0xb6, 0x5e
+    , 0x52, 0xbc, 0x51, 0x4d, 0x16, 0xcc, 0xf8, 0x06, 0x81, 0x8c, 0xe9, 0x1a, 0xb7, 0x79, 0x37, 0x36
+    , 0x5a, 0xf9, 0x0b, 0xbf, 0x74, 0xa3, 0x5b, 0xe6, 0xb4, 0x0b, 0x8e, 0xed, 0xf2, 0x78, 0x5e, 0x42
+    , 0x87, 0x4d
+  };
+
+  ObfKey key = MakeKey();
+  NonceGen gen;
+  gen.Salt = 0;
+  gen.Counter = 0x4a000000;
+
+  size_t len = strlen(plaintext);
+  ASSERT_EQ(len, sizeof(expected));
+
+  std::vector<uint8_t> record(ObfCalcRecordSize(len));
+  size_t size = 0;
+  ASSERT_EQ(ObfEncryptRecord(&key, &gen, (const uint8_t*)plaintext, len, record.data(), record.size(), &size), 1);
+  ASSERT_EQ(size, LOGOBF_HEADER_BYTES + len);
+
+  EXPECT_EQ(memcmp(record.data() + LOGOBF_HEADER_BYTES, expected, len), 0);
+}
+
+TEST(Obfuscation, KernelsProduceIdenticalRecords)
+{
+  ObfKey key = MakeKey();
+
+  std::vector<uint8_t> text(LOGOBF_MAX_PLAINTEXT);
+  for (size_t i = 0; i < text.size(); ++i)
+    text[i] = (uint8_t)(i * 31 + (i >> 8));
+
+  const size_t lengths[] = { 0, 1, 63, 64, 65, 255, 256, 257, 511, 512, 513, 1000, 4096, 4097, LOGOBF_MAX_PLAINTEXT };
+
+  ASSERT_EQ(ObfSetKernel(LOGOBF_KERNEL_SCALAR), 1);
+
+  std::vector<std::vector<uint8_t>> reference;
+  for (size_t len : lengths)
+    reference.push_back(Encrypt(key, std::vector<uint8_t>(text.begin(), text.begin() + len)));
+
+  for (ObfKernel kernel : Kernels)
+  {
+    if (!ObfSetKernel(kernel))
+      continue;
+
+    EXPECT_EQ(ObfGetKernel(), kernel);
+
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i)
+    {
+      std::vector<uint8_t> plain(text.begin(), text.begin() + lengths[i]);
+      std::vector<uint8_t> record = Encrypt(key, plain);
+      EXPECT_EQ(record, reference[i]) << "kernel " << kernel << " length " << lengths[i];
+
+      std::vector<uint8_t> decrypted(plain.size() + 1);
+      size_t size = 0;
+      ASSERT_EQ(ObfDecryptRecord(&key, record.data(), record.size(), decrypted.data(), decrypted.size(), &size, nullptr), 1);
+      decrypted.resize(size);
+      EXPECT_EQ(decrypted, plain);
+    }
+  }
+
+  EXPECT_EQ(ObfSetKernel(LOGOBF_KERNEL_AUTO), 1);
+}
+
+namespace
+{
+  void TestBatchObfuscation(const char* name, bool deferred)
+  {
+    fs::path dir = MakeTestDirectory();
+    fs::path file = dir / "batch.log";
+    fs::path plain = dir / "batch.txt";
+
+    ObfKey key = MakeKey();
+    Logme::Instance->SetObfuscationKey(&key);
+
+    Logme::ID id{ name };
+    auto ch = Logme::Instance->CreateChannel(id);
+    ch->RemoveBackends();
+
+    Logme::OutputFlags flags;
+    flags.Value = 0;
+    flags.Eol = true;
+    ch->SetFlags(flags);
+    ch->SetFilterLevel(Logme::LEVEL_DEBUG);
+
+    auto backend = std::make_shared<Logme::FileBackend>(ch);
+    auto config = std::make_shared<Logme::FileBackendConfig>();
+    config->Filename = file.string();
+    config->MaxSize = 0;
+    config->Append = false;
+    config->BatchObfuscation = true;
+    config->DeferredFormat = deferred;
+    ASSERT_TRUE(backend->ApplyConfig(config));
+    EXPECT_TRUE(backend->GetBatchObfuscation());
+    ch->AddBackend(backend);
+
+    const int records = 2000;
+    std::string expected;
+    for (int i = 0; i < records; ++i)
+    {
+      LogmeI(ch, "batch record %d", i);
+      expected += "batch record " + std::to_string(i) + "\n";
+    }
+
+    backend->Flush();
+
+    std::string data = ReadFile(file);
+    size_t count = CountRecords(data);
+    EXPECT_GT(count, 0U);
+    EXPECT_LT(count, size_t(records));
+    EXPECT_EQ(data.size(), expected.size() + count * LOGOBF_HEADER_BYTES);
+
+    EXPECT_TRUE(IsObfuscatedLogFile(file.string()));
+    EXPECT_TRUE(DeobfuscateLogFile(id, &key, file.string(), plain.string()));
+    EXPECT_EQ(ReadFile(plain), expected);
+
+    ch->RemoveBackends();
+    backend.reset();
+    Logme::Instance->DeleteChannel(id);
+    Logme::Instance->SetObfuscationKey(nullptr);
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+  }
+}
+
+TEST(Obfuscation, BatchObfuscationWritesLargeRecords)
+{
+  TestBatchObfuscation("obfuscation-batch", false);
+}
+
+TEST(Obfuscation, BatchObfuscationOfDeferredRecords)
+{
+  TestBatchObfuscation("obfuscation-batch-deferred", true);
+}
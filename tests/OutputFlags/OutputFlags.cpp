@@ -700,6 +700,50 @@ TEST(OutputFlags, Xml)
     << Be->Line;
 }
 
+TEST(OutputFlags, ThreadNameCachedPrefixFollowsRename)
+{
+  SetThreadNameOutputFlags(true, true, false);
+
+  SetTestThreadName("Cached1");
+  Be->Clear();
+
+  WriteTestThreadNameMessage();
+  WriteTestThreadNameMessage();
+  ASSERT_EQ(Be->History.size(), 2);
+  ExpectThreadNameMessage("Cached1", 0);
+  EXPECT_EQ(Be->History[0], Be->History[1]);
+
+  SetTestThreadName("Cached2");
+  WriteTestThreadNameMessage();
+  ASSERT_EQ(Be->History.size(), 3);
+  ExpectThreadNameMessage("Cached2", 2);
+
+  SetTestThreadName(nullptr);
+  WriteTestThreadNameMessage();
+  ASSERT_EQ(Be->History.size(), 4);
+  EXPECT_EQ(Be->History[3].find("Cached2"), std::string::npos) << Be->History[3];
+}
+
+TEST(OutputFlags, ThreadNameCachedPrefixPrintsTransitionOnce)
+{
+  SetThreadNameOutputFlags(false, true, true);
+
+  SetTestThreadName(nullptr);
+  Be->Clear();
+
+  Be->Owner->SetThreadName(GetCurrentThreadId(), "Worker", true);
+  WriteTestThreadNameMessage();
+  WriteTestThreadNameMessage();
+  WriteTestThreadNameMessage();
+
+  ASSERT_EQ(Be->History.size(), 3);
+  EXPECT_NE(Be->History[0].find(" -> Worker] message"), std::string::npos) << Be->History[0];
+  ExpectThreadNameMessage("Worker", 1);
+  ExpectThreadNameMessage("Worker", 2);
+
+  SetTestThreadName(nullptr);
+}
+
 TEST(OutputFlags, Timestamp)
 {
   OutputFlags flags;
@@ -766,6 +810,62 @@ TEST(OutputFlags, Timestamp)
   EXPECT_LE(d, MAXDIFFUTC);
 }
 
+TEST(OutputFlags, TimestampPrecision)
+{
+  OutputFlags flags;
+  flags.Value = 0;
+  flags.Timestamp = TIME_FORMAT_LOCAL;
+  flags.TimestampPrecision = TIME_PRECISION_MICROSECONDS;
+  Be->Owner->SetFlags(flags);
+
+  Be->Clear();
+  LogmeE(CHT, "_");
+
+  std::regex rus("\\d{4}-\\d{2}-\\d{2}\\s\\d{2}:\\d{2}:\\d{2}:\\d{6}\\s_");
+  EXPECT_TRUE(std::regex_match(Be->Line, rus)) << Be->Line;
+
+  flags.TimestampPrecision = TIME_PRECISION_NANOSECONDS;
+  Be->Owner->SetFlags(flags);
+  LogmeE(CHT, "_");
+
+  std::regex rns("\\d{4}-\\d{2}-\\d{2}\\s\\d{2}:\\d{2}:\\d{2}:\\d{9}\\s_");
+  EXPECT_TRUE(std::regex_match(Be->Line, rns)) << Be->Line;
+
+  flags.Timestamp = TIME_FORMAT_UTC;
+  Be->Owner->SetFlags(flags);
+  LogmeE(CHT, "_");
+  EXPECT_TRUE(std::regex_match(Be->Line, rns)) << Be->Line;
+
+  // TZ form carries no fraction regardless of precision
+  flags.Timestamp = TIME_FORMAT_TZ;
+  Be->Owner->SetFlags(flags);
+  LogmeE(CHT, "_");
+
+  std::regex rtz("\\d{4}-\\d{2}-\\d{2}T\\d{2}:\\d{2}:\\d{2}(\\+|\\-)\\d{2}:\\d{2}\\s_");
+  EXPECT_TRUE(std::regex_match(Be->Line, rtz)) << Be->Line;
+
+  EXPECT_EQ(flags.TimestampPrecisionType(), "ns");
+  EXPECT_NE(flags.ToString().find("TimestampPrecision:ns"), std::string::npos);
+}
+
+TEST(OutputFlags, TimestampIsMonotonicWithinThread)
+{
+  OutputFlags flags;
+  flags.Value = 0;
+  flags.Timestamp = TIME_FORMAT_UTC;
+  flags.TimestampPrecision = TIME_PRECISION_NANOSECONDS;
+  Be->Owner->SetFlags(flags);
+
+  std::string last;
+  for (int i = 0; i < 1000; i++)
+  {
+    Be->Clear();
+    LogmeE(CHT, "_");
+    EXPECT_GE(Be->Line, last);
+    last = Be->Line;
+  }
+}
+
 int main(int argc, char* argv[])
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -476,6 +476,66 @@ TEST(Precheck, SubsystemLevelSnapshotsSupportConcurrentUpdates)
   EXPECT_EQ(level, Logme::LEVEL_INFO);
 }
 
+TEST(Precheck, SubsystemFilterSnapshotFollowsBlockAndAllowLists)
+{
+  auto ch = MakeChannel("precheck_subsystem_filter", true);
+  ch->AddBackend(Be);
+
+  const Logme::SID dsl = Logme::SID::Build("DSL");
+  const Logme::SID cloud = Logme::SID::Build("CLOUD");
+
+  Be->Clear();
+  Logme::Instance->AddBlockedSubsystem(dsl);
+  LogmeI(ch, dsl, "blocked");
+  LogmeI(ch, cloud, "passed");
+  ASSERT_EQ(Be->History.size(), 1u);
+  EXPECT_EQ(Be->History[0], "passed");
+
+  Be->Clear();
+  Logme::Instance->ClearBlockedSubsystems();
+  Logme::Instance->AddAllowedSubsystem(dsl);
+  LogmeI(ch, dsl, "allowed");
+  LogmeI(ch, cloud, "not allowed");
+  ASSERT_EQ(Be->History.size(), 1u);
+  EXPECT_EQ(Be->History[0], "allowed");
+
+  Be->Clear();
+  Logme::Instance->ClearSubsystemFilters();
+  LogmeI(ch, cloud, "unfiltered");
+  EXPECT_EQ(Be->History.size(), 1u);
+}
+
+TEST(Precheck, OverrideRepetitionsAreExactUnderContention)
+{
+  auto ch = MakeChannel("precheck_override_repetitions", true);
+  ch->AddBackend(Be);
+  Be->Clear();
+
+  Logme::Override ovr(100);
+
+  std::vector<std::thread> writers;
+  for (int i = 0; i < 4; ++i)
+  {
+    writers.emplace_back([&]()
+    {
+      for (int j = 0; j < 200; ++j)
+        LogmeI(ovr, ch, "repetition");
+    });
+  }
+
+  for (auto& writer : writers)
+    writer.join();
+
+  EXPECT_EQ(ovr.Repetitions.load(), 100);
+  EXPECT_EQ(Be->History.size(), 100u);
+
+  Logme::Override every(-1, 60000);
+  EXPECT_TRUE(every.TryAcquire(1000));
+  EXPECT_FALSE(every.TryAcquire(1500));
+  EXPECT_FALSE(every.TryAcquire(999));
+  EXPECT_TRUE(every.TryAcquire(61000));
+}
+
 #ifndef LOGME_DISABLE_STD_FORMAT
 TEST(Precheck, StdFormatCompilesAllForwardedArgumentLayouts)
 {
@@ -528,6 +588,26 @@ TEST(Precheck, StdFormatSupportsIdAndChannelSubsystemOverloads)
   EXPECT_NE(Be->History[1].find("channel sid value=12"), std::string::npos);
 }
 
+TEST(Precheck, StdFormatLongMessageIsNotTruncated)
+{
+  auto ch = MakeChannel("precheck_std_format_long", true);
+  ch->AddBackend(Be);
+
+  Be->Clear();
+
+  std::string shortText(16, 's');
+  std::string longText(5000, 'x');
+
+  // Same call site: the second long message uses the cached size hint
+  for (const auto* text : {&longText, &shortText, &longText})
+    fLogmeI(ch, "[{}]", *text);
+
+  ASSERT_EQ(Be->History.size(), 3u);
+  EXPECT_EQ(Be->History[0], "[" + longText + "]");
+  EXPECT_EQ(Be->History[1], "[" + shortText + "]");
+  EXPECT_EQ(Be->History[2], "[" + longText + "]");
+}
+
 TEST(Precheck, StdFormatExplicitSubsystemCanRelaxChannelLevel)
 {
   auto ch = MakeChannel("precheck_std_format_explicit_relax", true);
@@ -0,0 +1,219 @@
+#include <gtest/gtest.h>
+
+#include <Logme/Backend/RingBufferBackend.h>
+#include <Logme/Logme.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Logme;
+
+namespace
+{
+  std::shared_ptr<RingBufferBackend> MakeRing(size_t maxItems, size_t maxBytes)
+  {
+    static int counter = 0;
+    std::string name = "ring-buffer-test-" + std::to_string(counter++);
+
+    auto ch = Instance->CreateChannel(ID{name.c_str()});
+    auto ring = std::make_shared<RingBufferBackend>(ch);
+
+    auto config = std::make_shared<RingBufferBackendConfig>();
+    config->MaxItems = maxItems;
+    config->MaxBytes = maxBytes;
+    EXPECT_TRUE(ring->ApplyConfig(config));
+
+    return ring;
+  }
+}
+
+TEST(RingBufferBackend, KeepsLastItems)
+{
+  auto ring = MakeRing(3, 1024);
+
+  for (int i = 0; i < 5; ++i)
+    ring->Append(std::to_string(i).c_str(), -1);
+
+  EXPECT_EQ(ring->GetCount(), 3U);
+  EXPECT_EQ(ring->Join(), "234");
+}
+
+TEST(RingBufferBackend, EvictsByBytes)
+{
+  auto ring = MakeRing(100, 10);
+
+  ring->Append("aaaa", 4);
+  ring->Append("bbbb", 4);
+  ring->Append("cccc", 4);
+
+  EXPECT_EQ(ring->GetCount(), 2U);
+  EXPECT_EQ(ring->GetUsedBytes(), 8U);
+  EXPECT_EQ(ring->Join(), "bbbbcccc");
+}
+
+TEST(RingBufferBackend, RecordWrapsAroundEnd)
+{
+  auto ring = MakeRing(100, 10);
+
+  ring->Append("0123456", 7);
+  ring->Append("abcdef", 6);
+
+  EXPECT_EQ(ring->Join(), "abcdef");
+
+  std::vector<std::string> fragments;
+  size_t n = ring->Visit([&fragments](const char* p, size_t size) { fragments.emplace_back(p, size); });
+
+  EXPECT_EQ(n, 1U);
+  ASSERT_EQ(fragments.size(), 2U);
+  EXPECT_EQ(fragments[0], "abc");
+  EXPECT_EQ(fragments[1], "def");
+}
+
+TEST(RingBufferBackend, CutsRecordLongerThanCapacity)
+{
+  auto ring = MakeRing(100, 4);
+
+  ring->Append("0123456789", 10);
+  EXPECT_EQ(ring->Join(), "0123");
+}
+
+TEST(RingBufferBackend, ClearKeepsStorage)
+{
+  auto ring = MakeRing(10, 64);
+
+  ring->Append("record", -1);
+  size_t memory = ring->GetMemoryUsage();
+  EXPECT_GT(memory, 64U);
+
+  ring->Clear();
+  EXPECT_EQ(ring->GetCount(), 0U);
+  EXPECT_EQ(ring->Join(), "");
+  EXPECT_EQ(ring->GetMemoryUsage(), memory);
+
+  ring->Append("next", -1);
+  EXPECT_EQ(ring->Join(), "next");
+}
+
+TEST(RingBufferBackend, ResizeKeepsNewestRecords)
+{
+  auto ring = MakeRing(10, 64);
+
+  for (int i = 0; i < 5; ++i)
+    ring->Append(std::to_string(i).c_str(), -1);
+
+  auto config = std::make_shared<RingBufferBackendConfig>();
+  config->MaxItems = 2;
+  config->MaxBytes = 64;
+  EXPECT_TRUE(ring->ApplyConfig(config));
+
+  EXPECT_EQ(ring->Join(), "34");
+
+  ring->Append("5", -1);
+  EXPECT_EQ(ring->Join(), "45");
+}
+
+TEST(RingBufferBackend, MaxItemsAloneKeepsLongRecords)
+{
+  // No max-bytes in the config: records longer than 256 bytes are all kept
+  auto ring = MakeRing(1000, RingBufferBackendConfig().MaxBytes);
+
+  std::string expected;
+  for (int i = 0; i < 1200; ++i)
+  {
+    std::string text = std::to_string(i) + std::string(1000, 'x') + "\n";
+    ring->Append(text.c_str(), (int)text.size());
+
+    if (i >= 200)
+      expected += text;
+  }
+
+  EXPECT_EQ(ring->GetCount(), 1000U);
+  EXPECT_EQ(ring->Join(), expected);
+}
+
+TEST(RingBufferBackend, ResizeWithoutByteLimitKeepsGrownStorage)
+{
+  auto ring = MakeRing(10, 0);
+
+  std::string text(RingBufferBackendConfig::INITIAL_BYTES / 4, 'y');
+  for (int i = 0; i < 8; ++i)
+    ring->Append(text.c_str(), (int)text.size());
+
+  EXPECT_EQ(ring->GetCount(), 8U);
+
+  auto config = std::make_shared<RingBufferBackendConfig>();
+  config->MaxItems = 4;
+  EXPECT_TRUE(ring->ApplyConfig(config));
+
+  EXPECT_EQ(ring->GetCount(), 4U);
+  EXPECT_EQ(ring->GetUsedBytes(), 4 * text.size());
+}
+
+TEST(RingBufferBackend, ConcurrentWritersKeepRecordsIntact)
+{
+  const int threads = 4;
+  const int records = 20000;
+  auto ring = MakeRing(64, 4096);
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([&ring, t]()
+    {
+      std::string text = "[" + std::string(size_t(10 + t * 7), char('a' + t)) + "]";
+      for (int i = 0; i < records; ++i)
+        ring->Append(text.c_str(), (int)text.size());
+    });
+  }
+
+  for (auto& w : workers)
+    w.join();
+
+  std::string joined = ring->Join();
+  EXPECT_EQ(ring->GetCount(), 64U);
+
+  size_t pos = 0;
+  while (pos < joined.size())
+  {
+    ASSERT_EQ(joined[pos], '[');
+    size_t end = joined.find(']', pos);
+    ASSERT_NE(end, std::string::npos);
+
+    char c = joined[pos + 1];
+    for (size_t i = pos + 1; i < end; ++i)
+      ASSERT_EQ(joined[i], c);
+
+    pos = end + 1;
+  }
+}
+
+TEST(RingBufferBackend, ConcurrentWritersGrowStorage)
+{
+  const int threads = 4;
+  const int records = 2000;
+  auto ring = MakeRing(size_t(threads * records), 0);
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([&ring, t]()
+    {
+      std::string text = "[" + std::string(size_t(100 + t * 7), char('a' + t)) + "]";
+      for (int i = 0; i < records; ++i)
+        ring->Append(text.c_str(), (int)text.size());
+    });
+  }
+
+  for (auto& w : workers)
+    w.join();
+
+  EXPECT_EQ(ring->GetCount(), size_t(threads * records));
+
+  size_t expected = 0;
+  for (int t = 0; t < threads; ++t)
+    expected += size_t(records) * (102 + t * 7);
+
+  EXPECT_EQ(ring->GetUsedBytes(), expected);
+  EXPECT_EQ(ring->Join().size(), expected);
+}
@@ -0,0 +1,364 @@
+#include <gtest/gtest.h>
+
+#include <Logme/Backend/SharedFileBackend.h>
+#include <Logme/Logme.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+  std::atomic<unsigned> Counter(0);
+
+  fs::path MakeTestDirectory()
+  {
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    unsigned id = Counter.fetch_add(1, std::memory_order_relaxed);
+
+    fs::path dir = fs::temp_directory_path()
+      / ("logme-shared-file-test-" + std::to_string(now) + "-" + std::to_string(id));
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir, ec);
+
+    EXPECT_FALSE(ec);
+    return dir;
+  }
+
+  std::string ReadFile(const fs::path& file)
+  {
+    std::ifstream input(file, std::ios::binary);
+    std::stringstream ss;
+    ss << input.rdbuf();
+    return ss.str();
+  }
+
+  size_t CountLines(const std::string& text)
+  {
+    size_t n = 0;
+    for (char c : text)
+    {
+      if (c == '\n')
+        n++;
+    }
+    return n;
+  }
+
+  struct SharedFileFixture
+  {
+    Logme::ID Id;
+    Logme::ChannelPtr Ch;
+    Logme::SharedFileBackendPtr Backend;
+
+    SharedFileFixture(const char* name, const fs::path& file, size_t maxSize = 0)
+      : Id{name}
+    {
+      Ch = Logme::Instance->CreateChannel(Id);
+      Ch->RemoveBackends();
+
+      Logme::OutputFlags flags;
+      flags.Value = 0;
+      flags.Eol = true;
+      Ch->SetFlags(flags);
+      Ch->SetFilterLevel(Logme::LEVEL_DEBUG);
+
+      Backend = std::make_shared<Logme::SharedFileBackend>(Ch);
+
+      auto config = std::make_shared<Logme::SharedFileBackendConfig>();
+      config->Filename = file.string();
+      config->MaxSize = maxSize;
+      config->Timeout = 1000;
+      EXPECT_TRUE(Backend->ApplyConfig(config));
+
+      Ch->AddBackend(Backend);
+    }
+
+    ~SharedFileFixture()
+    {
+      Ch->RemoveBackends();
+      Backend.reset();
+      Logme::Instance->DeleteChannel(Id);
+    }
+  };
+}
+
+TEST(SharedFileBackend, PersistentModeWritesBatchOnFlush)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "shared.log";
+
+  SharedFileFixture f("shared-batch", file);
+  f.Backend->SetPersistent(true, 60 * 1000, 1024 * 1024);
+  if (!f.Backend->GetPersistent())
+    GTEST_SKIP() << "persistent mode is not supported on this platform";
+
+  for (int i = 0; i < 3; ++i)
+    LogmeI(f.Ch, "record %d", i);
+
+  EXPECT_EQ(ReadFile(file), "");
+
+  f.Backend->Flush();
+  EXPECT_EQ(ReadFile(file), "record 0\nrecord 1\nrecord 2\n");
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(SharedFileBackend, PersistentModeWritesWhenBatchIsFull)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "shared.log";
+
+  SharedFileFixture f("shared-full", file);
+  f.Backend->SetPersistent(true, 60 * 1000, 16);
+  if (!f.Backend->GetPersistent())
+    GTEST_SKIP() << "persistent mode is not supported on this platform";
+
+  LogmeI(f.Ch, "0123456789");
+  EXPECT_EQ(ReadFile(file), "");
+
+  LogmeI(f.Ch, "abcdefghij");
+  EXPECT_EQ(ReadFile(file), "0123456789\nabcdefghij\n");
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(SharedFileBackend, FlushIntervalWritesPendingRecords)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "shared.log";
+
+  SharedFileFixture f("shared-interval", file);
+  f.Backend->SetPersistent(true, 20, 1024 * 1024);
+  if (!f.Backend->GetPersistent())
+    GTEST_SKIP() << "persistent mode is not supported on this platform";
+
+  LogmeI(f.Ch, "delayed");
+
+  std::string content;
+  for (int i = 0; i < 200 && content.empty(); ++i)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    content = ReadFile(file);
+  }
+
+  EXPECT_EQ(content, "delayed\n");
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(SharedFileBackend, PersistentModeReopensRenamedFile)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "shared.log";
+  fs::path rotated = dir / "shared.log.1";
+
+  SharedFileFixture f("shared-rename", file);
+  f.Backend->SetPersistent(true, 0);
+  if (!f.Backend->GetPersistent())
+    GTEST_SKIP() << "persistent mode is not supported on this platform";
+
+  LogmeI(f.Ch, "first");
+  fs::rename(file, rotated);
+
+  LogmeI(f.Ch, "second");
+
+  EXPECT_EQ(ReadFile(rotated), "first\n");
+  EXPECT_EQ(ReadFile(file), "second\n");
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(SharedFileBackend, PersistentAndPerRecordWritersShareFile)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "shared.log";
+
+  SharedFileFixture persistent("shared-mixed-persistent", file);
+  persistent.Backend->SetPersistent(true, 60 * 1000, 256);
+  if (!persistent.Backend->GetPersistent())
+    GTEST_SKIP() << "persistent mode is not supported on this platform";
+
+  SharedFileFixture legacy("shared-mixed-legacy", file);
+
+  const int records = 200;
+  std::thread t1([&]() { for (int i = 0; i < records; ++i) LogmeI(persistent.Ch, "persistent %d", i); });
+  std::thread t2([&]() { for (int i = 0; i < records; ++i) LogmeI(legacy.Ch, "legacy %d", i); });
+  t1.join();
+  t2.join();
+
+  persistent.Backend->Flush();
+
+  std::string content = ReadFile(file);
+  EXPECT_EQ(CountLines(content), size_t(2 * records));
+  EXPECT_NE(content.find("persistent 199\n"), std::string::npos);
+  EXPECT_NE(content.find("legacy 199\n"), std::string::npos);
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(SharedFileBackend, PersistentModeTruncatesToMaxSize)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "shared.log";
+
+  const size_t maxSize = 4096;
+  SharedFileFixture f("shared-truncate", file, maxSize);
+  f.Backend->SetPersistent(true, 60 * 1000, 512);
+  if (!f.Backend->GetPersistent())
+    GTEST_SKIP() << "persistent mode is not supported on this platform";
+
+  for (int i = 0; i < 1000; ++i)
+    LogmeI(f.Ch, "record %04d", i);
+
+  f.Backend->Flush();
+
+  std::string content = ReadFile(file);
+  EXPECT_LT(content.size(), maxSize + 1024);
+  EXPECT_EQ(content.rfind("record 0999\n"), content.size() - 12);
+  EXPECT_EQ(content.find("--- dropped "), 0U);
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(SharedFileBackend, FailedBatchIsRetried)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path blocker = dir / "blocker";
+  fs::path file = blocker / "shared.log";
+
+  // A regular file in place of the directory makes the open fail
+  std::ofstream(blocker).put('x');
+
+  SharedFileFixture f("shared-retry", file);
+  f.Backend->SetPersistent(true, 60 * 1000, 1024 * 1024);
+  if (!f.Backend->GetPersistent())
+    GTEST_SKIP() << "persistent mode is not supported on this platform";
+
+  LogmeI(f.Ch, "kept 1");
+  LogmeI(f.Ch, "kept 2");
+  f.Backend->Flush();
+
+  std::error_code ec;
+  fs::remove(blocker, ec);
+  fs::create_directories(blocker, ec);
+  ASSERT_FALSE(ec);
+
+  f.Backend->Flush();
+  EXPECT_EQ(ReadFile(file), "kept 1\nkept 2\n");
+  EXPECT_EQ(f.Backend->GetDroppedRecords(), 0U);
+
+  fs::remove_all(dir, ec);
+}
+
+TEST(SharedFileBackend, FailedBatchIsDroppedBeyondMaxSize)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path blocker = dir / "blocker";
+  fs::path file = blocker / "shared.log";
+
+  std::ofstream(blocker).put('x');
+
+  SharedFileFixture f("shared-drop", file, 64);
+  f.Backend->SetPersistent(true, 60 * 1000, 16);
+  if (!f.Backend->GetPersistent())
+    GTEST_SKIP() << "persistent mode is not supported on this platform";
+
+  // Every record fills a batch; the failed batch grows until it exceeds MaxSize
+  for (int i = 0; i < 10; ++i)
+    LogmeI(f.Ch, "record %04d", i);
+
+  f.Backend->Flush();
+
+  EXPECT_EQ(f.Backend->GetDroppedRecords(), 6U);
+  EXPECT_EQ(f.Backend->GetDroppedBytes(), 6U * 12);
+
+  std::error_code ec;
+  fs::remove(blocker, ec);
+  fs::create_directories(blocker, ec);
+  ASSERT_FALSE(ec);
+
+  f.Backend->Flush();
+  EXPECT_EQ(ReadFile(file), "record 0006\nrecord 0007\nrecord 0008\nrecord 0009\n");
+
+  fs::remove_all(dir, ec);
+}
+
+TEST(SharedFileBackend, FailedWriteIsRetried)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "shared.log";
+
+  // Writes to /dev/full fail with ENOSPC
+  std::error_code ec;
+  fs::create_symlink("/dev/full", file, ec);
+  if (ec || !fs::exists(file))
+    GTEST_SKIP() << "/dev/full is not available";
+
+  SharedFileFixture f("shared-write-retry", file);
+  f.Backend->SetPersistent(true, 60 * 1000, 1024 * 1024);
+  if (!f.Backend->GetPersistent())
+    GTEST_SKIP() << "persistent mode is not supported on this platform";
+
+  LogmeI(f.Ch, "kept 1");
+  LogmeI(f.Ch, "kept 2");
+  f.Backend->Flush();
+
+  EXPECT_EQ(f.Backend->GetDroppedRecords(), 0U);
+
+  // The descriptor was closed, so the next flush creates a regular file
+  fs::remove(file, ec);
+  ASSERT_FALSE(ec);
+
+  f.Backend->Flush();
+  EXPECT_EQ(ReadFile(file), "kept 1\nkept 2\n");
+  EXPECT_EQ(f.Backend->GetDroppedRecords(), 0U);
+
+  fs::remove_all(dir, ec);
+}
+
+TEST(SharedFileBackend, FailedWriteIsDroppedBeyondMaxSize)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "shared.log";
+
+  std::error_code ec;
+  fs::create_symlink("/dev/full", file, ec);
+  if (ec || !fs::exists(file))
+    GTEST_SKIP() << "/dev/full is not available";
+
+  SharedFileFixture f("shared-write-drop", file, 64);
+  f.Backend->SetPersistent(true, 60 * 1000, 16);
+  if (!f.Backend->GetPersistent())
+    GTEST_SKIP() << "persistent mode is not supported on this platform";
+
+  for (int i = 0; i < 10; ++i)
+    LogmeI(f.Ch, "record %04d", i);
+
+  f.Backend->Flush();
+
+  EXPECT_EQ(f.Backend->GetDroppedRecords(), 6U);
+  EXPECT_EQ(f.Backend->GetDroppedBytes(), 6U * 12);
+
+  fs::remove(file, ec);
+  ASSERT_FALSE(ec);
+
+  f.Backend->Flush();
+  EXPECT_EQ(ReadFile(file), "record 0006\nrecord 0007\nrecord 0008\nrecord 0009\n");
+
+  fs::remove_all(dir, ec);
+}
@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
 
+#include <Logme/Backend/BufferBackend.h>
 #include <Logme/Logme.h>
 
+#include <memory>
+#include <mutex>
 #include <string>
 
 using namespace Logme;
@@ -17,6 +20,12 @@ namespace
   {
     EXPECT_EQ(Instance->Control("subsystem --clear"), "ok");
   }
+
+  std::string GetText(const std::shared_ptr<BufferBackend>& backend)
+  {
+    std::lock_guard guard(backend->Lock);
+    return std::string(backend->Buffer.begin(), backend->Buffer.end());
+  }
 }
 
 TEST(SubsystemLevelControl, SetsListsChecksAndRemovesLevels)
@@ -101,6 +110,55 @@ TEST(SubsystemLevelControl, JsonIncludesLevelsAndCheckFields)
   EXPECT_TRUE(Contains(checkJson, "\"level\":\"DEBUG\""));
 }
 
+TEST(SubsystemLevelControl, BlockAndAllowChangeWhatIsLogged)
+{
+  ResetSubsystems();
+
+  const ID id{"subsystem_control_filter"};
+  auto ch = Instance->CreateChannel(id);
+  ch->SetFilterLevel(LEVEL_DEBUG);
+
+  auto backend = std::make_shared<BufferBackend>(ch);
+  ch->AddBackend(backend);
+
+  const SID net = SID::Build("NET");
+  const SID disk = SID::Build("DISK");
+
+  EXPECT_EQ(Instance->Control("subsystem --block NET"), "ok");
+  LogmeI(ch, net, "net while blocked");
+  LogmeI(ch, disk, "disk while net blocked");
+
+  EXPECT_EQ(Instance->Control("subsystem --unblock NET"), "ok");
+  LogmeI(ch, net, "net after unblock");
+
+  EXPECT_EQ(Instance->Control("subsystem --allow DISK"), "ok");
+  LogmeI(ch, net, "net while disk allowed");
+  LogmeI(ch, disk, "disk while allowed");
+
+  EXPECT_EQ(Instance->Control("subsystem --clear-allowed"), "ok");
+  LogmeI(ch, net, "net after clear-allowed");
+
+  EXPECT_EQ(Instance->Control("subsystem --block DISK"), "ok");
+  EXPECT_EQ(Instance->Control("subsystem --clear-blocked"), "ok");
+  LogmeI(ch, disk, "disk after clear-blocked");
+
+  EXPECT_EQ(Instance->Control("subsystem --block NET"), "ok");
+  EXPECT_EQ(Instance->Control("subsystem --clear"), "ok");
+  LogmeI(ch, net, "net after clear");
+
+  std::string text = GetText(backend);
+  EXPECT_FALSE(Contains(text, "net while blocked"));
+  EXPECT_TRUE(Contains(text, "disk while net blocked"));
+  EXPECT_TRUE(Contains(text, "net after unblock"));
+  EXPECT_FALSE(Contains(text, "net while disk allowed"));
+  EXPECT_TRUE(Contains(text, "disk while allowed"));
+  EXPECT_TRUE(Contains(text, "net after clear-allowed"));
+  EXPECT_TRUE(Contains(text, "disk after clear-blocked"));
+  EXPECT_TRUE(Contains(text, "net after clear"));
+
+  Instance->DeleteChannel(id);
+}
+
 int main(int argc, char* argv[])
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -159,6 +159,31 @@ static void TestFileBackendConfigValidation()
     assert(backendConfig.GzipCompression);
     assert(backendConfig.MaxParts == 0);
   }
+
+  {
+    Json::Value config;
+    config["file"] = "zstd-compression.log";
+    config["compression"] = "zstd";
+    config["compression-level"] = 19;
+    config["compression-threads"] = 8;
+
+    FileBackendConfig backendConfig;
+    assert(backendConfig.Parse(&config));
+    assert(!backendConfig.GzipCompression);
+    assert(backendConfig.ZstdCompression);
+    assert(backendConfig.CompressionLevel == 19);
+    assert(backendConfig.CompressionThreads == 8);
+  }
+
+  {
+    Json::Value config;
+    config["file"] = "invalid-compression-level.log";
+    config["compression"] = "gzip";
+    config["compression-level"] = 19;
+
+    FileBackendConfig backendConfig;
+    assert(!backendConfig.Parse(&config));
+  }
 }
 #endif
 
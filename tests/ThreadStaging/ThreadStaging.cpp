@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+
+#include <Logme/Backend/FileBackend.h>
+#include <Logme/Channel.h>
+#include <Logme/Logme.h>
+#include <Logme/Obfuscate.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+  std::atomic<unsigned> Counter(0);
+
+  fs::path MakeTestDirectory()
+  {
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    unsigned id = Counter.fetch_add(1, std::memory_order_relaxed);
+
+    fs::path dir = fs::temp_directory_path()
+      / ("logme-thread-staging-test-" + std::to_string(now) + "-" + std::to_string(id));
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir, ec);
+
+    EXPECT_FALSE(ec);
+    return dir;
+  }
+
+  std::string ReadFile(const fs::path& file)
+  {
+    std::ifstream input(file, std::ios::binary);
+    std::stringstream ss;
+    ss << input.rdbuf();
+    return ss.str();
+  }
+
+  struct StagingFixture
+  {
+    Logme::ID Id;
+    Logme::ChannelPtr Ch;
+    Logme::FileBackendPtr Backend;
+
+    StagingFixture(const char* name, const fs::path& file)
+      : Id{name}
+    {
+      Ch = Logme::Instance->CreateChannel(Id);
+      Ch->RemoveBackends();
+
+      Logme::OutputFlags flags;
+      flags.Value = 0;
+      flags.Eol = true;
+      Ch->SetFlags(flags);
+      Ch->SetFilterLevel(Logme::LEVEL_DEBUG);
+
+      Backend = std::make_shared<Logme::FileBackend>(Ch);
+
+      auto config = std::make_shared<Logme::FileBackendConfig>();
+      config->Filename = file.string();
+      config->MaxSize = 0;
+      config->Append = false;
+      config->ThreadStaging = true;
+      EXPECT_TRUE(Backend->ApplyConfig(config));
+
+      Ch->AddBackend(Backend);
+    }
+
+    ~StagingFixture()
+    {
+      Ch->RemoveBackends();
+      Backend.reset();
+      Logme::Instance->DeleteChannel(Id);
+    }
+  };
+}
+
+TEST(ThreadStaging, ConcurrentWritersKeepPerThreadOrder)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "staging.log";
+
+  StagingFixture f("thread-staging-order", file);
+  EXPECT_TRUE(f.Backend->GetThreadStaging());
+  EXPECT_TRUE(f.Backend->IsConcurrentDisplaySupported());
+
+  const int threads = 8;
+  const int records = 5000;
+
+  std::vector<std::thread> writers;
+  for (int t = 0; t < threads; ++t)
+  {
+    writers.emplace_back([&f, t]()
+    {
+      for (int i = 0; i < records; ++i)
+        LogmeI(f.Ch, "thread %d record %d", t, i);
+    });
+  }
+
+  for (auto& w : writers)
+    w.join();
+
+  f.Backend->Flush();
+
+  std::vector<int> next(threads, 0);
+  size_t lines = 0;
+
+  std::istringstream input(ReadFile(file));
+  for (std::string line; std::getline(input, line); ++lines)
+  {
+    int t = -1;
+    int i = -1;
+    ASSERT_EQ(sscanf(line.c_str(), "thread %d record %d", &t, &i), 2) << line;
+    ASSERT_GE(t, 0);
+    ASSERT_LT(t, threads);
+    EXPECT_EQ(i, next[t]) << line;
+    next[t] = i + 1;
+  }
+
+  EXPECT_EQ(lines, size_t(threads * records));
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(ThreadStaging, StagedRecordsAreWrittenWithoutFlush)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "staging.log";
+
+  StagingFixture f("thread-staging-interval", file);
+  LogmeI(f.Ch, "delayed");
+
+  std::string content;
+  for (int i = 0; i < 500 && content.empty(); ++i)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    content = ReadFile(file);
+  }
+
+  EXPECT_EQ(content, "delayed\n");
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(ThreadStaging, ModeCanBeSwitched)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "staging.log";
+
+  // Display takes the channel lock itself when staging is off
+  StagingFixture f("thread-staging-mode", file);
+  EXPECT_TRUE(f.Backend->IsConcurrentDisplaySupported());
+
+  LogmeI(f.Ch, "first");
+  f.Backend->Flush();
+
+  EXPECT_TRUE(f.Backend->SetThreadStaging(false));
+  EXPECT_TRUE(f.Backend->IsConcurrentDisplaySupported());
+
+  LogmeI(f.Ch, "second");
+  f.Backend->Flush();
+
+  EXPECT_TRUE(f.Backend->SetThreadStaging(true));
+
+  LogmeI(f.Ch, "third");
+  f.Backend->Flush();
+
+  EXPECT_EQ(ReadFile(file), "first\nsecond\nthird\n");
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(ThreadStaging, ObfuscationIsDoneByWorker)
+{
+  fs::path dir = MakeTestDirectory();
+  fs::path file = dir / "staging.log";
+  fs::path plain = dir / "staging.txt";
+
+  ObfKey key;
+  for (int i = 0; i < LOGOBF_KEY_BYTES; ++i)
+    key.Bytes[i] = (uint8_t)(i * 7);
+  Logme::Instance->SetObfuscationKey(&key);
+
+  {
+    StagingFixture f("thread-staging-obfuscation", file);
+
+    std::string expected;
+    for (int i = 0; i < 1000; ++i)
+    {
+      LogmeI(f.Ch, "secret %d", i);
+      expected += "secret " + std::to_string(i) + "\n";
+    }
+
+    f.Backend->Flush();
+
+    EXPECT_TRUE(IsObfuscatedLogFile(file.string()));
+    EXPECT_TRUE(DeobfuscateLogFile(f.Id, &key, file.string(), plain.string()));
+    EXPECT_EQ(ReadFile(plain), expected);
+  }
+
+  Logme::Instance->SetObfuscationKey(nullptr);
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
@@ -644,8 +644,11 @@ int main(int argc, char** argv)
     }
   }
 
-  auto DoRequest = [&](const std::string& request, std::string& response) -> bool
+  // Requests and responses are framed as "#<length>\n<data>", so the whole
+  // response is read without waiting for the connection to become idle
+  auto DoRequest = [&](const std::string& command, std::string& response) -> bool
   {
+    std::string request = "#" + std::to_string(command.size()) + "\n" + command;
     int sent = 0;
 
     if (useSsl)
@@ -657,14 +660,32 @@ int main(int argc, char** argv)
       return false;
 
     response.clear();
-
-    // Wait for the first response packet with a hard timeout, then drain
-    // any remaining packets with a short inter-packet timeout.
     (void)SetRecvTimeout(s, 5000);
-    bool gotFirst = false;
+
+    std::string input;
+    size_t header = std::string::npos;
+    size_t length = 0;
 
     for (;;)
     {
+      if (header == std::string::npos)
+      {
+        header = input.find('\n');
+        if (header != std::string::npos)
+        {
+          if (input[0] != '#')
+            return false;
+
+          length = (size_t)std::strtoull(input.c_str() + 1, nullptr, 10);
+        }
+      }
+
+      if (header != std::string::npos && input.size() - header - 1 >= length)
+      {
+        response = input.substr(header + 1, length);
+        return true;
+      }
+
       char buf[4096];
       int n = 0;
 
@@ -673,35 +694,110 @@ int main(int argc, char** argv)
       else
         n = (int)recv(s, buf, (int)sizeof(buf), 0);
 
-      if (n > 0)
-      {
-        response.append(buf, n);
+      if (n <= 0)
+        return false;
 
-        if (!gotFirst)
-        {
-          gotFirst = true;
-          (void)SetRecvTimeout(s, 100);
-        }
+      input.append(buf, n);
+    }
+  };
+
+  // "follow" is answered with a header line and batches of records
+  // "<bytes>\t<dropped>\n<records>" that end with a zero-length batch
+  auto DoFollow = [&](const std::string& command) -> bool
+  {
+    std::string request = "#" + std::to_string(command.size()) + "\n" + command;
+    int sent = 0;
+
+    if (useSsl)
+      sent = sslCtx.Write(ssl, request.c_str(), (int)request.size());
+    else
+      sent = send(s, request.c_str(), (int)request.size(), 0);
+
+    if (sent <= 0)
+      return false;
+
+    // Records may not arrive for a long time
+    (void)SetRecvTimeout(s, 0);
+
+    std::string input;
+
+    auto Receive = [&]() -> bool
+    {
+      char buf[16 * 1024];
+      int n = 0;
+
+      if (useSsl)
+        n = sslCtx.Read(ssl, buf, (int)sizeof(buf));
+      else
+        n = (int)recv(s, buf, (int)sizeof(buf), 0);
+
+      if (n <= 0)
+        return false;
 
-        continue;
+      input.append(buf, n);
+      return true;
+    };
+
+    auto ReadLine = [&](std::string& line) -> bool
+    {
+      size_t pos;
+      while ((pos = input.find('\n')) == std::string::npos)
+      {
+        if (!Receive())
+          return false;
       }
 
-      if (n == 0)
-        break;
+      line = input.substr(0, pos);
+      input.erase(0, pos + 1);
+      return true;
+    };
 
-#ifdef _WIN32
-      int e = WSAGetLastError();
-      if (e == WSAETIMEDOUT || e == WSAEWOULDBLOCK)
-        break;
-#else
-      if (errno == EAGAIN || errno == EWOULDBLOCK)
-        break;
-#endif
+    std::string line;
+    if (!ReadLine(line))
+      return false;
 
-      break;
+    // Errors are ordinary framed responses
+    if (line.rfind("LOGME-FOLLOW\t", 0) != 0)
+    {
+      size_t length = line.size() > 1 && line[0] == '#'
+        ? (size_t)std::strtoull(line.c_str() + 1, nullptr, 10)
+        : 0;
+
+      while (input.size() < length && Receive())
+        ;
+
+      std::cout << input.substr(0, length);
+      return false;
     }
 
-    return true;
+    for (;;)
+    {
+      if (!ReadLine(line))
+        return false;
+
+      size_t tab = line.find('\t');
+      if (tab == std::string::npos)
+        return false;
+
+      size_t bytes = (size_t)std::strtoull(line.c_str(), nullptr, 10);
+      unsigned long long dropped = std::strtoull(line.c_str() + tab + 1, nullptr, 10);
+
+      if (dropped)
+        std::cerr << "WARNING: " << dropped << " records dropped\n";
+
+      if (bytes == 0)
+        return true;
+
+      while (input.size() < bytes)
+      {
+        if (!Receive())
+          return false;
+      }
+
+      std::cout.write(input.data(), (std::streamsize)bytes);
+      std::cout.flush();
+      input.erase(0, bytes);
+    }
   };
 
   auto Trim = [](std::string& s)
@@ -729,7 +825,7 @@ int main(int argc, char** argv)
 
     if (!DoRequest(authCmd, authResponse))
     {
-      std::cerr << "ERROR: send failed\n";
+      std::cerr << "ERROR: request failed\n";
 
       if (useSsl)
         sslCtx.Shutdown(ssl);
@@ -773,11 +869,27 @@ int main(int argc, char** argv)
     }
   }
 
+  if (cmd == "follow" || cmd.rfind("follow ", 0) == 0)
+  {
+    bool ok = DoFollow(cmd);
+
+    if (useSsl)
+      sslCtx.Shutdown(ssl);
+
+    CloseSocket(s);
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+
+    return ok ? 0 : 1;
+  }
+
   std::string response;
 
   if (!DoRequest(cmd, response))
   {
-    std::cerr << "ERROR: send failed\n";
+    std::cerr << "ERROR: request failed\n";
 
     if (useSsl)
       sslCtx.Shutdown(ssl);
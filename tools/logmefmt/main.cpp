@@ -509,7 +509,7 @@ namespace
   static bool ParseTextRecord(const std::string& line, Record& record)
   {
     static const std::regex timestampRe(
-      R"LOGME(^([0-9]{4}-[0-9]{2}-[0-9]{2}[ T][0-9]{2}:[0-9]{2}:[0-9]{2}:[0-9]{3})( ?[+-][0-9]{2}:[0-9]{2})? ?)LOGME"
+      R"LOGME(^([0-9]{4}-[0-9]{2}-[0-9]{2}[ T][0-9]{2}:[0-9]{2}:[0-9]{2}:[0-9]{3,9})( ?[+-][0-9]{2}:[0-9]{2})? ?)LOGME"
     );
     static const std::regex levelRe(R"(^([DWEC])\s+)" );
     static const std::regex infoLevelRe(R"(^\s{2})" );
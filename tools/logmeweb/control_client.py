@@ -3,35 +3,47 @@ import socket
 import ssl
 
 
-RECV_FIRST_TIMEOUT = 5.0
-RECV_DRAIN_TIMEOUT = 0.15
+RECV_TIMEOUT = 5.0
+STREAM_RECV_TIMEOUT = 30.0
+STREAM_HEADER = b"LOGMEWEB-STREAM\t"
+FOLLOW_HEADER = b"LOGME-FOLLOW\t"
 
 
-def _recv_response(sock):
-  data = bytearray()
-  got_first = False
+def _recv_exact(sock, data, size):
+  while len(data) < size:
+    chunk = sock.recv(max(4096, size - len(data)))
+    if not chunk:
+      raise ConnectionError("control connection closed")
 
-  while True:
-    sock.settimeout(RECV_FIRST_TIMEOUT if not got_first else RECV_DRAIN_TIMEOUT)
+    data.extend(chunk)
 
-    try:
-      chunk = sock.recv(4096)
-    except TimeoutError:
-      break
-    except socket.timeout:
-      break
 
+def _recv_response(sock):
+  # Responses to framed requests are "#<length>\n<data>"
+  sock.settimeout(RECV_TIMEOUT)
+
+  data = bytearray()
+  while b"\n" not in data:
+    chunk = sock.recv(4096)
     if not chunk:
-      break
+      raise ConnectionError("control connection closed")
 
     data.extend(chunk)
-    got_first = True
 
-  return data.decode("utf-8", errors="replace")
+  pos = data.index(b"\n")
+  if not data.startswith(b"#"):
+    raise ConnectionError("invalid control response frame")
+
+  length = int(data[1:pos])
+  del data[:pos + 1]
+
+  _recv_exact(sock, data, length)
+  return bytes(data[:length]).decode("utf-8", errors="replace")
 
 
 def _send_request(sock, text):
-  sock.sendall(text.encode("utf-8"))
+  payload = text.encode("utf-8")
+  sock.sendall(b"#" + str(len(payload)).encode("ascii") + b"\n" + payload)
   return _recv_response(sock)
 
 
@@ -121,3 +133,174 @@ def SendControlCommand(host, port, protocol, password, command, fmt):
       raw_sock.close()
     except Exception:
       pass
+
+
+class _StreamReader:
+  def __init__(self, sock):
+    self.sock = sock
+    self.buffer = bytearray()
+
+  def _fill(self):
+    chunk = self.sock.recv(256 * 1024)
+    if not chunk:
+      raise ConnectionError("connection closed during log stream")
+
+    self.buffer.extend(chunk)
+
+  def ReadLine(self):
+    while True:
+      pos = self.buffer.find(b"\n")
+      if pos >= 0:
+        line = bytes(self.buffer[:pos])
+        del self.buffer[:pos + 1]
+        return line
+
+      self._fill()
+
+  def Read(self, size):
+    while len(self.buffer) < size:
+      self._fill()
+
+    data = bytes(self.buffer[:size])
+    del self.buffer[:size]
+    return data
+
+
+def StreamControlFile(host, port, protocol, password, path, offset=0, gzip=False):
+  """Opens a `logs --stream` transfer.
+
+  Returns (header, chunks). header holds offset, size and encoding of the
+  transfer; chunks is a generator of payload bytes that owns the connection.
+  Raises RuntimeError when the server rejects the request.
+  """
+  use_ssl = protocol.lower() == "https"
+  raw_sock = socket.create_connection((host, int(port)), timeout=5.0)
+  sock = raw_sock
+
+  try:
+    if use_ssl:
+      context = ssl.create_default_context()
+      context.check_hostname = False
+      context.verify_mode = ssl.CERT_NONE
+      sock = context.wrap_socket(raw_sock, server_hostname=host)
+
+    if password:
+      auth_response = _send_request(sock, "auth " + password)
+      if not _trim_response(auth_response).startswith("ok"):
+        raise RuntimeError("auth failed")
+
+    command = "logs --stream " + path.replace("\r", " ").replace("\n", " ").replace("\t", " ")
+    if offset:
+      command += " " + str(int(offset))
+    if gzip:
+      command += " --gzip"
+
+    sock.sendall(command.encode("utf-8"))
+    sock.settimeout(STREAM_RECV_TIMEOUT)
+
+    reader = _StreamReader(sock)
+    line = reader.ReadLine()
+    if not line.startswith(STREAM_HEADER):
+      text = (line + bytes(reader.buffer)).decode("utf-8", errors="replace")
+      raise RuntimeError(_trim_response(text) or "invalid stream response")
+
+    fields = line.decode("utf-8").split("\t")
+    header = {
+      "offset": int(fields[1]),
+      "size": int(fields[2]),
+      "encoding": fields[3]
+    }
+  except Exception:
+    sock.close()
+    raw_sock.close()
+    raise
+
+  def chunks():
+    try:
+      while True:
+        sizes = reader.ReadLine().split(b"\t")
+        payload_bytes = int(sizes[0])
+        if payload_bytes == 0:
+          return
+
+        yield reader.Read(payload_bytes)
+    finally:
+      sock.close()
+      raw_sock.close()
+
+  return header, chunks()
+
+
+def _command_arg(value):
+  return str(value).replace("\r", " ").replace("\n", " ").replace("\t", " ").strip()
+
+
+def FollowControl(host, port, protocol, password, channel="", level="", subsystem="", match=""):
+  """Opens a `follow` subscription.
+
+  Returns a generator of record text that owns the connection and runs until
+  the consumer closes it. Raises RuntimeError when the server rejects the
+  request.
+  """
+  use_ssl = protocol.lower() == "https"
+  raw_sock = socket.create_connection((host, int(port)), timeout=5.0)
+  sock = raw_sock
+
+  try:
+    if use_ssl:
+      context = ssl.create_default_context()
+      context.check_hostname = False
+      context.verify_mode = ssl.CERT_NONE
+      sock = context.wrap_socket(raw_sock, server_hostname=host)
+
+    if password:
+      auth_response = _send_request(sock, "auth " + password)
+      if not _trim_response(auth_response).startswith("ok"):
+        raise RuntimeError("auth failed")
+
+    command = "follow"
+    if _command_arg(channel):
+      command += " --channel " + _command_arg(channel)
+    if _command_arg(level):
+      command += " --level " + _command_arg(level)
+    if _command_arg(subsystem):
+      command += " --subsystem " + _command_arg(subsystem)
+    # The expression is the rest of the command
+    if _command_arg(match):
+      command += " --match " + _command_arg(match)
+
+    sock.sendall(command.encode("utf-8"))
+    sock.settimeout(STREAM_RECV_TIMEOUT)
+
+    reader = _StreamReader(sock)
+    line = reader.ReadLine()
+    if not line.startswith(FOLLOW_HEADER):
+      text = (line + bytes(reader.buffer)).decode("utf-8", errors="replace")
+      raise RuntimeError(_trim_response(text) or "invalid follow response")
+
+    # Records may not arrive for a long time
+    sock.settimeout(None)
+  except Exception:
+    sock.close()
+    raw_sock.close()
+    raise
+
+  def records():
+    try:
+      while True:
+        sizes = reader.ReadLine().split(b"\t")
+        payload_bytes = int(sizes[0])
+        dropped = int(sizes[1])
+
+        if dropped:
+          yield f"[logmeweb] {dropped} record(s) dropped by the server\n"
+
+        if payload_bytes == 0:
+          return
+
+        yield reader.Read(payload_bytes).decode("utf-8", errors="replace")
+    finally:
+      sock.close()
+      raw_sock.close()
+
+  return records()
@@ -27,6 +27,7 @@ try:
   from fastapi.responses import HTMLResponse
   from fastapi.responses import JSONResponse
   from fastapi.responses import RedirectResponse
+  from fastapi.responses import StreamingResponse
   from fastapi.staticfiles import StaticFiles
   from pydantic import BaseModel
   import uvicorn
@@ -35,7 +36,9 @@ except ImportError as e:
   print("Install dependencies with: pip install -r tools/logmeweb/requirements.txt")
   sys.exit(1)
 
+from control_client import FollowControl
 from control_client import SendControlCommand
+from control_client import StreamControlFile
 from discovery import DiscoverProcesses
 
 
@@ -55,6 +58,25 @@ class CommandRequest(BaseModel):
   format: str = "text"
 
 
+class DownloadRequest(BaseModel):
+  host: str
+  port: int
+  protocol: str = "http"
+  password: Optional[str] = ""
+  path: str
+
+
+class FollowRequest(BaseModel):
+  host: str
+  port: int
+  protocol: str = "http"
+  password: Optional[str] = ""
+  channel: Optional[str] = ""
+  level: Optional[str] = ""
+  subsystem: Optional[str] = ""
+  match: Optional[str] = ""
+
+
 class LoginRequest(BaseModel):
   password: str = ""
 
@@ -323,6 +345,52 @@ async def ApiCommand(request: CommandRequest):
     raise HTTPException(status_code=500, detail=str(e))
 
 
+@app.post("/api/download")
+def ApiDownload(request: DownloadRequest):
+  try:
+    header, chunks = StreamControlFile(
+      request.host
+      , request.port
+      , request.protocol
+      , request.password or ""
+      , request.path
+    )
+  except RuntimeError as e:
+    raise HTTPException(status_code=400, detail=str(e))
+  except Exception as e:
+    raise HTTPException(status_code=500, detail=str(e))
+
+  return StreamingResponse(
+    chunks
+    , media_type="application/octet-stream"
+    , headers={"Content-Length": str(header["size"] - header["offset"])}
+  )
+
+
+@app.post("/api/follow")
+def ApiFollow(request: FollowRequest):
+  try:
+    records = FollowControl(
+      request.host
+      , request.port
+      , request.protocol
+      , request.password or ""
+      , request.channel or ""
+      , request.level or ""
+      , request.subsystem or ""
+      , request.match or ""
+    )
+  except RuntimeError as e:
+    raise HTTPException(status_code=400, detail=str(e))
+  except Exception as e:
+    raise HTTPException(status_code=500, detail=str(e))
+
+  return StreamingResponse(
+    records
+    , media_type="text/plain; charset=utf-8"
+  )
+
+
 def AddHostToSan(host, san_items):
   try:
     ip = ipaddress.ip_address(host)
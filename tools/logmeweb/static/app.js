@@ -2682,29 +2682,32 @@ async function LoadLogRange(path, offset = 0, limit = LOG_CHUNK_SIZE)
   return ParseLogRange(result.text || '');
 }
 
-function DecodeBase64ToBytes(text)
-{
-  const binary = atob(text || '');
-  const bytes = new Uint8Array(binary.length);
-  for (let i = 0; i < binary.length; ++i)
-    bytes[i] = binary.charCodeAt(i);
-
-  return bytes;
-}
-
 async function DownloadLogFile(path)
 {
-  const result = await SendCommand(`logs --download ${LogPathArg(path)}`, 'text');
-  if (!result.ok)
-    throw new Error(result.error || result.text || 'unable to download log file');
+  if (!CurrentTarget)
+    throw new Error('No target selected');
 
-  const text = result.text || '';
-  const lineEnd = text.indexOf('\n');
-  if (!text.startsWith('LOGMEWEB-DOWNLOAD-B64\t') || lineEnd < 0)
-    throw new Error('invalid download response');
+  const response = await fetch('/api/download', {
+    method: 'POST',
+    headers: {
+      'Content-Type': 'application/json'
+    },
+    body: JSON.stringify({
+      host: CurrentTarget.host,
+      port: CurrentTarget.port,
+      protocol: CurrentTarget.protocol,
+      password: CurrentTarget.password,
+      path: LogPathArg(path)
+    })
+  });
+
+  if (!response.ok)
+  {
+    const data = await response.json().catch(() => ({}));
+    throw new Error(data.detail || 'unable to download log file');
+  }
 
-  const bytes = DecodeBase64ToBytes(text.substring(lineEnd + 1).trim());
-  const blob = new Blob([bytes], { type: 'application/octet-stream' });
+  const blob = await response.blob();
   const url = URL.createObjectURL(blob);
   const link = document.createElement('a');
   link.href = url;
@@ -3197,8 +3200,153 @@ async function RenderLogs(path = '', selectedPath = '', offset = 0)
 }
 
 
+const LIVE_MAX_LINES = 5000;
+
+let CurrentFollow = null;
+
+function StopFollow()
+{
+  if (CurrentFollow)
+  {
+    CurrentFollow.abort();
+    CurrentFollow = null;
+  }
+}
+
+function AppendLiveText(state, text)
+{
+  const viewer = $('liveViewer');
+  if (!viewer)
+    return;
+
+  // Records may be split between network reads; the tail waits for its newline
+  const data = state.carry + text;
+  const end = data.lastIndexOf('\n');
+  if (end < 0)
+  {
+    state.carry = data;
+    return;
+  }
+
+  state.carry = data.slice(end + 1);
+
+  const part = RenderLogTextPart(data.slice(0, end), '', state.level);
+  state.level = part.level;
+
+  const atBottom = viewer.scrollTop + viewer.clientHeight >= viewer.scrollHeight - 4;
+  viewer.insertAdjacentHTML('beforeend', part.html);
+
+  while (viewer.childElementCount > LIVE_MAX_LINES)
+    viewer.firstElementChild.remove();
+
+  if (atBottom)
+    viewer.scrollTop = viewer.scrollHeight;
+}
+
+async function StartFollow()
+{
+  StopFollow();
+
+  const controller = new AbortController();
+  CurrentFollow = controller;
+
+  const state = { carry: '', level: 'info' };
+  $('liveViewer').innerHTML = '';
+  $('liveStatus').textContent = 'Connecting...';
+
+  try
+  {
+    const response = await fetch('/api/follow', {
+      method: 'POST',
+      headers: {
+        'Content-Type': 'application/json'
+      },
+      body: JSON.stringify({
+        host: CurrentTarget.host,
+        port: CurrentTarget.port,
+        protocol: CurrentTarget.protocol,
+        password: CurrentTarget.password,
+        channel: $('liveChannel').value,
+        level: $('liveLevel').value,
+        subsystem: $('liveSubsystem').value,
+        match: $('liveMatch').value
+      }),
+      signal: controller.signal
+    });
+
+    if (!response.ok)
+    {
+      const data = await response.json().catch(() => ({}));
+      throw new Error(data.detail || 'unable to follow records');
+    }
+
+    $('liveStatus').textContent = 'Following';
+
+    const reader = response.body.getReader();
+    const decoder = new TextDecoder();
+
+    for (;;)
+    {
+      const { value, done } = await reader.read();
+      if (done)
+        break;
+
+      AppendLiveText(state, decoder.decode(value, { stream: true }));
+    }
+
+    if (CurrentFollow === controller)
+      $('liveStatus').textContent = 'Subscription ended';
+  }
+  catch (e)
+  {
+    if (e.name !== 'AbortError' && $('liveStatus'))
+      $('liveStatus').textContent = String(e.message || e);
+  }
+  finally
+  {
+    if (CurrentFollow === controller)
+      CurrentFollow = null;
+  }
+}
+
+async function RenderLive()
+{
+  const channels = await LoadChannels();
+
+  $('workArea').innerHTML = `
+    <div class="toolbar live-toolbar">
+      <select id="liveChannel">
+        ${channels.map(channel => `<option value="${EscapeHtml(channel)}">${EscapeHtml(ChannelNameForDisplay(channel))}</option>`).join('')}
+      </select>
+      <select id="liveLevel">
+        <option value="">All levels</option>
+        <option value="info">Info and above</option>
+        <option value="warn">Warnings and above</option>
+        <option value="error">Errors and above</option>
+        <option value="crit">Critical</option>
+      </select>
+      <input id="liveSubsystem" placeholder="Subsystem">
+      <input id="liveMatch" placeholder="Regular expression">
+      <button id="liveStartButton">Follow</button>
+      <button id="liveStopButton" class="secondary">Stop</button>
+      <span class="muted" id="liveStatus"></span>
+    </div>
+    <div class="card soft logs-viewer-card">
+      <div id="liveViewer" class="log-viewer live-viewer"></div>
+    </div>
+  `;
+
+  $('liveStartButton').addEventListener('click', () => StartFollow());
+  $('liveStopButton').addEventListener('click', () =>
+  {
+    StopFollow();
+    $('liveStatus').textContent = 'Stopped';
+  });
+}
+
 async function SelectView(view)
 {
+  StopFollow();
   CurrentView = view;
 
   document.querySelectorAll('.nav-item').forEach(item =>
@@ -3212,6 +3360,7 @@ async function SelectView(view)
     subsystems: 'Subsystems',
     tracepoints: 'Trace points',
     logs: 'Logs',
+    live: 'Live records',
     manual: 'Manual command'
   };
 
@@ -3229,6 +3378,8 @@ async function SelectView(view)
       await RenderTracepoints();
     else if (view === 'logs')
       await RenderLogs();
+    else if (view === 'live')
+      await RenderLive();
     else if (view === 'manual')
       await RenderManual();
   }
@@ -3259,6 +3410,7 @@ function SetupEvents()
 
   $('disconnectButton').addEventListener('click', () =>
   {
+    StopFollow();
     CurrentTarget = null;
     CachedChannels = null;
     SetScreen('connect');